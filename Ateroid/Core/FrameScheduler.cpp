@@ -0,0 +1,121 @@
+#include "Precompile.h"
+#include "FrameScheduler.h"
+#include "Util/Debug.h"
+#include <thread>
+
+#ifdef _WIN32
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+namespace ASTEROID_NAMESPACE
+{
+    FrameScheduler::FrameScheduler(const FrameSchedulerSettings& settings)
+        : m_Settings(settings), m_Accumulator(0.0), m_DroppedTime(0.0), m_FrameTime(0.0), m_StepsCount(0), m_FramesCount(0)
+    {
+        ASTEROID_ASSERT(settings.fixedTimestep > 0.0, "FrameScheduler needs a positive fixed timestep.");
+        m_Settings.maxStepsPerFrame = std::max(settings.maxStepsPerFrame, 1u);
+        SetMaxFrameRate(settings.maxFrameRate);
+
+        m_FrameStart = SteadyClock::now();
+        m_NextFrameStart = m_FrameStart;
+
+#ifdef _WIN32
+        // A high resolution timer wakes up within about half a millisecond, the system timer only every 15.6ms
+        m_Timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+        m_SleepMargin = std::chrono::milliseconds(1);
+        if (m_Timer == NULL)
+        {
+            ASTEROID_LOG_INFO("High resolution waitable timers are not supported, frame pacing falls back to the system timer.");
+            m_Timer = CreateWaitableTimerExW(NULL, NULL, 0, TIMER_ALL_ACCESS);
+            m_SleepMargin = std::chrono::milliseconds(2);
+        }
+#else
+        m_SleepMargin = std::chrono::microseconds(200);
+#endif
+    }
+
+    FrameScheduler::~FrameScheduler()
+    {
+#ifdef _WIN32
+        if (m_Timer != NULL)
+            CloseHandle(m_Timer);
+#endif
+    }
+
+    uint32_t FrameScheduler::BeginFrame()
+    {
+        SteadyClock::time_point now = SteadyClock::now();
+        m_FrameTime = std::chrono::duration<double>(now - m_FrameStart).count();
+        m_FrameStart = now;
+        ++m_FramesCount;
+
+        if (m_Settings.clock == EFrameClock::eUnpaced)
+        {
+            ++m_StepsCount;
+            return 1;
+        }
+
+        m_Accumulator += m_FrameTime;
+        double stepsCount = std::floor(m_Accumulator / m_Settings.fixedTimestep);
+        if (stepsCount > m_Settings.maxStepsPerFrame)
+        {
+            // Falling behind, e.g. after a hitch or a breakpoint. Drop the excess instead of catching up.
+            double dropped = (stepsCount - m_Settings.maxStepsPerFrame) * m_Settings.fixedTimestep;
+            m_DroppedTime += dropped;
+            m_Accumulator -= dropped;
+            stepsCount = m_Settings.maxStepsPerFrame;
+        }
+
+        m_Accumulator = std::max(m_Accumulator - stepsCount * m_Settings.fixedTimestep, 0.0);
+        m_StepsCount += (uint64_t)stepsCount;
+        return (uint32_t)stepsCount;
+    }
+
+    void FrameScheduler::EndFrame()
+    {
+        if (m_Settings.clock == EFrameClock::eUnpaced || m_Settings.maxFrameRate <= 0.0)
+            return;
+
+        // Targets advance by whole periods so the average rate matches the cap even when single waits run late,
+        // but a frame longer than a period restarts the schedule instead of being followed by a burst.
+        SteadyClock::duration period = std::chrono::duration_cast<SteadyClock::duration>(
+            std::chrono::duration<double>(1.0 / m_Settings.maxFrameRate));
+        SteadyClock::time_point now = SteadyClock::now();
+        m_NextFrameStart += period;
+        if (m_NextFrameStart < now - period)
+            m_NextFrameStart = now;
+
+        SleepUntil(m_NextFrameStart);
+    }
+
+    void FrameScheduler::SetMaxFrameRate(double framesPerSecond)
+    {
+        m_Settings.maxFrameRate = std::max(framesPerSecond, 0.0);
+        m_NextFrameStart = SteadyClock::now();
+    }
+
+    void FrameScheduler::SleepUntil(SteadyClock::time_point deadline)
+    {
+        // Sleeps may overshoot, so wake up a margin early and yield for the rest
+        SteadyClock::duration sleepDuration = deadline - m_SleepMargin - SteadyClock::now();
+        if (sleepDuration > SteadyClock::duration::zero())
+        {
+#ifdef _WIN32
+            // Negative due times are relative, in 100ns units
+            LARGE_INTEGER dueTime;
+            dueTime.QuadPart = -(LONGLONG)(std::chrono::duration_cast<std::chrono::nanoseconds>(sleepDuration).count() / 100);
+            if (m_Timer != NULL && SetWaitableTimer(m_Timer, &dueTime, 0, NULL, NULL, FALSE))
+                WaitForSingleObject(m_Timer, INFINITE);
+            else
+                Sleep((DWORD)std::chrono::duration_cast<std::chrono::milliseconds>(sleepDuration).count());
+#else
+            std::this_thread::sleep_for(sleepDuration);
+#endif
+        }
+
+        while (SteadyClock::now() < deadline)
+            std::this_thread::yield();
+    }
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <chrono>
+
+namespace ASTEROID_NAMESPACE
+{
+    /** Where FrameScheduler takes the time advancing the simulation from. */
+    enum class EFrameClock
+    {
+        /** Steps follow the wall clock and frames are paced to the frame rate cap. */
+        eRealTime,
+        /**
+         *  Every frame runs exactly one step without waiting, so the simulation runs as fast as the CPU allows.
+         *  Used by headless benchmarks and servers replaying input.
+         */
+        eUnpaced
+    };
+
+    struct FrameSchedulerSettings
+    {
+        /** Duration of a simulation step in seconds. */
+        double      fixedTimestep;
+        /**
+         *  Steps a frame may run at most. Time needing more steps is dropped, so a frame running slower than the
+         *  steps it simulates can't make the following frames slower and slower.
+         */
+        uint32_t    maxStepsPerFrame;
+        /** Frames per second the frame rate is capped to, 0 for no cap. */
+        double      maxFrameRate;
+        EFrameClock clock;
+    };
+
+
+    /**
+     *  Decides how many fixed simulation steps each frame runs and paces frames to a frame rate cap.\n
+     *  Wall time accumulates between frames and is consumed in steps of the fixed timestep, the remainder is
+     *  exposed as an interpolation factor to render states between the last two steps.\n
+     *  Usage per frame: BeginFrame, run the returned numbers of steps, render, then EndFrame.
+     *  @remarks
+     *      Frames wait on a high resolution waitable timer on Windows and the remaining fraction of a
+     *      millisecond is spent yielding. Before Windows 10 1803 the timer falls back to the system timer
+     *      resolution, capped frames may then run late.
+     */
+    class FrameScheduler
+    {
+    public:
+        explicit FrameScheduler(const FrameSchedulerSettings& settings);
+        ~FrameScheduler();
+
+        ASTEROID_NON_COPYABLE(FrameScheduler)
+
+        /**
+         *  Advance the clock to the beginning of a new frame.
+         *  @return
+         *      Numbers of fixed steps the frame has to run, may be 0 when frames are shorter than a step.
+         */
+        uint32_t BeginFrame();
+
+        /**
+         *  Wait until the frame rate cap allows the next frame to begin.
+         */
+        void EndFrame();
+
+        double FixedTimestep() const { return m_Settings.fixedTimestep; }
+
+        /**
+         *  How far the wall clock has moved past the last step, in [0, 1) steps. Render states interpolated
+         *  between the last two steps by this factor move smoothly at any frame rate.
+         */
+        float InterpolationAlpha() const { return (float)(m_Accumulator / m_Settings.fixedTimestep); }
+
+        /** Frames per second the frame rate is capped to, 0 for no cap. */
+        void SetMaxFrameRate(double framesPerSecond);
+        double MaxFrameRate() const { return m_Settings.maxFrameRate; }
+
+        EFrameClock Clock() const { return m_Settings.clock; }
+
+        /** Numbers of steps run since the scheduler was created. */
+        uint64_t StepsCount() const { return m_StepsCount; }
+        uint64_t FramesCount() const { return m_FramesCount; }
+        /** Simulated time in seconds, StepsCount times the fixed timestep. */
+        double SimulationTime() const { return m_StepsCount * m_Settings.fixedTimestep; }
+        /** Wall time in seconds dropped because frames needed more than maxStepsPerFrame steps. */
+        double DroppedTime() const { return m_DroppedTime; }
+        /** Wall time in seconds between the beginnings of the last two frames. */
+        double FrameTime() const { return m_FrameTime; }
+
+    private:
+        using SteadyClock = std::chrono::steady_clock;
+
+        void SleepUntil(SteadyClock::time_point deadline);
+
+    private:
+        FrameSchedulerSettings      m_Settings;
+        SteadyClock::time_point     m_FrameStart;
+        SteadyClock::time_point     m_NextFrameStart;
+        double                      m_Accumulator;
+        double                      m_DroppedTime;
+        double                      m_FrameTime;
+        uint64_t                    m_StepsCount;
+        uint64_t                    m_FramesCount;
+        SteadyClock::duration       m_SleepMargin;
+#ifdef _WIN32
+        HANDLE                      m_Timer;
+#endif
+    };
+}
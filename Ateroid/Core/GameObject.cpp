@@ -1,3 +1,18 @@
 #include "Precompile.h"
 #include "GameObject.h"
 
+namespace ASTEROID_NAMESPACE
+{
+    GameObject::GameObject()
+        : m_Transform(TransformSystem::kInvalidHandle)
+    {
+        if (TransformSystem::Singleton() != nullptr)
+            m_Transform = TransformSystem::Singleton()->CreateTransform();
+    }
+
+    GameObject::~GameObject()
+    {
+        if (m_Transform != TransformSystem::kInvalidHandle && TransformSystem::Singleton() != nullptr)
+            TransformSystem::Singleton()->DestroyTransform(m_Transform);
+    }
+}
@@ -1,16 +1,24 @@
 #pragma once
 
 #include "Object.h"
+#include "TransformSystem.h"
 
 namespace ASTEROID_NAMESPACE
 {
     class GameObject : public Object
     {
     public:
+        GameObject();
+        virtual ~GameObject();
+
         const std::string& Name() const { return m_Name; }
         std::string& Name() { return m_Name; }
 
+        /** Transform of the object in the TransformSystem, kInvalidHandle if the system is not created. */
+        TransformSystem::Handle Transform() const { return m_Transform; }
+
     private:
         std::string m_Name;
+        TransformSystem::Handle m_Transform;
     };
 }
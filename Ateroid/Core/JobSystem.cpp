@@ -0,0 +1,128 @@
+#include "Precompile.h"
+#include "JobSystem.h"
+#include "Util/Debug.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    JobSystem* JobSystem::_Singleton = nullptr;
+
+    JobSystem::JobSystem(uint32_t workersCount)
+        : m_IsQuitting(false)
+    {
+        m_Workers.reserve(workersCount);
+        for (uint32_t iWorker = 0; iWorker < workersCount; ++iWorker)
+            m_Workers.emplace_back(&JobSystem::WorkerMain, this);
+
+        ASTEROID_LOG_INFO_F("JobSystem created with %u worker threads.", workersCount);
+    }
+
+    JobSystem::~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_QueueMutex);
+            m_IsQuitting = true;
+        }
+        m_QueueCondition.notify_all();
+
+        for (std::thread& worker : m_Workers)
+            worker.join();
+    }
+
+    void JobSystem::Schedule(const JobFunction& job, JobCounter* counter)
+    {
+        if (counter != nullptr)
+            counter->m_Pending.fetch_add(1, std::memory_order_relaxed);
+
+        if (m_Workers.empty())
+        {
+            // Nobody else could pick it up, run it right away.
+            Execute({ job, counter });
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_QueueMutex);
+            m_Queue.push_back({ job, counter });
+        }
+        m_QueueCondition.notify_one();
+    }
+
+    void JobSystem::Wait(JobCounter* counter)
+    {
+        Job job;
+        while (!counter->IsDone())
+        {
+            if (TryPopJob(&job))
+                Execute(job);
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    void JobSystem::ParallelFor(uint32_t count, uint32_t batchSize, const RangeFunction& function)
+    {
+        ASTEROID_ASSERT(batchSize > 0, "ParallelFor batch size must not be zero.");
+        if (count == 0)
+            return;
+
+        if (count <= batchSize)
+        {
+            function(0, count);
+            return;
+        }
+
+        if (m_Workers.empty())
+        {
+            // Same batches as with workers, so what functions compute per batch doesn't depend on the machine
+            for (uint32_t begin = 0; begin < count; begin += batchSize)
+                function(begin, std::min(begin + batchSize, count));
+            return;
+        }
+
+        JobCounter counter;
+        // Keep the first batch for the calling thread.
+        for (uint32_t begin = batchSize; begin < count; begin += batchSize)
+        {
+            uint32_t end = std::min(begin + batchSize, count);
+            Schedule([&function, begin, end]() { function(begin, end); }, &counter);
+        }
+        function(0, batchSize);
+        Wait(&counter);
+    }
+
+    void JobSystem::WorkerMain()
+    {
+        for (;;)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(m_QueueMutex);
+                m_QueueCondition.wait(lock, [this]() { return m_IsQuitting || !m_Queue.empty(); });
+                if (m_Queue.empty())
+                    return;
+
+                job = std::move(m_Queue.front());
+                m_Queue.pop_front();
+            }
+            Execute(job);
+        }
+    }
+
+    bool JobSystem::TryPopJob(Job* job)
+    {
+        std::lock_guard<std::mutex> lock(m_QueueMutex);
+        if (m_Queue.empty())
+            return false;
+
+        *job = std::move(m_Queue.front());
+        m_Queue.pop_front();
+        return true;
+    }
+
+    void JobSystem::Execute(const Job& job)
+    {
+        job.function();
+        if (job.counter != nullptr)
+            job.counter->m_Pending.fetch_sub(1, std::memory_order_release);
+    }
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "Util/Containers.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  A counter tracking the number of unfinished jobs scheduled with it.\n
+     *  Pass it to JobSystem::Schedule and wait on it with JobSystem::Wait.
+     */
+    class JobCounter
+    {
+        friend class JobSystem;
+
+    public:
+        JobCounter() : m_Pending(0) {}
+
+        ASTEROID_NON_COPYABLE(JobCounter)
+
+        /** True if every job scheduled with this counter has finished. */
+        bool IsDone() const { return m_Pending.load(std::memory_order_acquire) == 0; }
+
+    private:
+        std::atomic<uint32_t> m_Pending;
+    };
+
+
+    /**
+     *  A pool of worker threads executing jobs from a shared queue.\n
+     *  Threads waiting on a JobCounter help executing queued jobs instead of blocking,
+     *  so it is safe to wait on jobs from inside another job.
+     */
+    class JobSystem
+    {
+    public:
+        using JobFunction   = std::function<void()>;
+        using RangeFunction = std::function<void(uint32_t begin, uint32_t end)>;
+
+    public:
+        ASTEROID_NON_COPYABLE(JobSystem)
+
+        /**
+         *  Create the JobSystem singleton.
+         *  @param workersCount
+         *      Numbers of worker threads to spawn. The thread calling Wait also executes jobs,
+         *      so processors count minus one is usually a good choice. Zero makes every job run
+         *      on the waiting thread.
+         */
+        static JobSystem* Create(uint32_t workersCount)
+        {
+            ASTEROID_ASSERT(_Singleton == nullptr, "There is already a JobSystem singleton created.");
+            _Singleton = ASTEROID_NEW JobSystem(workersCount);
+            return _Singleton;
+        }
+
+        /**
+         *  Destroy the JobSystem singleton. Queued jobs are finished before the workers exit.
+         */
+        static void Destroy()
+        {
+            ASTEROID_DELETE _Singleton;
+            _Singleton = nullptr;
+        }
+
+        /**
+         *  Current created singleton.
+         *  @return
+         *      Instance of current created singleton. nullptr if no instance created or singleton was destroyed.
+         */
+        static JobSystem* Singleton() { return _Singleton; }
+
+        ~JobSystem();
+
+        /**
+         *  Queue a job for execution on any worker thread.
+         *  @param counter
+         *      Optional counter incremented now and decremented when the job finishes.
+         */
+        void Schedule(const JobFunction& job, JobCounter* counter = nullptr);
+
+        /**
+         *  Block until all jobs scheduled with the counter have finished.
+         *  The calling thread executes queued jobs while waiting.
+         */
+        void Wait(JobCounter* counter);
+
+        /**
+         *  Split [0, count) into batches of batchSize elements and run them in parallel.
+         *  Returns when every batch has finished.
+         *  @remarks
+         *      Batches are processed in no specific order. A batch is never empty, and batches are the same
+         *      whatever the numbers of workers, so results gathered per batch in batch order are deterministic.
+         */
+        void ParallelFor(uint32_t count, uint32_t batchSize, const RangeFunction& function);
+
+        /** Numbers of worker threads, not including threads helping in Wait. */
+        uint32_t WorkersCount() const { return (uint32_t)m_Workers.size(); }
+
+    private:
+        struct Job
+        {
+            JobFunction function;
+            JobCounter* counter;
+        };
+
+        explicit JobSystem(uint32_t workersCount);
+
+        void WorkerMain();
+        bool TryPopJob(Job* job);
+        static void Execute(const Job& job);
+
+    private:
+        static JobSystem* _Singleton;
+
+    private:
+        Vector<std::thread>     m_Workers;
+        List<Job>               m_Queue;
+        std::mutex              m_QueueMutex;
+        std::condition_variable m_QueueCondition;
+        bool                    m_IsQuitting;
+    };
+}
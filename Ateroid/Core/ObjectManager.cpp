@@ -8,6 +8,7 @@ namespace ASTEROID_NAMESPACE
     ObjectManager* ObjectManager::_Singleton = nullptr;
 
     ObjectManager::ObjectManager()
+        : m_ObjectsCount(0)
     {
         ASTEROID_ASSERT(_Singleton == nullptr, "There is already a ObjectManager singleton created.");
         _Singleton = this;
@@ -21,31 +22,41 @@ namespace ASTEROID_NAMESPACE
     Object* ObjectManager::FindObject(ObjectInstanceID instanceId) const
     {
         Object* obj = nullptr;
-        auto itor = m_Objects.find(instanceId);
-        if (itor != m_Objects.end())
-            obj = itor->second;
+        if (instanceId >= 0 && (size_t)instanceId < m_Objects.size())
+            obj = m_Objects[instanceId];
         return obj;
     }
 
     ObjectInstanceID ObjectManager::RegisterObject(Object* obj)
     {
         ObjectInstanceID instanceId = m_InstanceIdManager.GetAvailableInstanceId();
-        m_Objects.insert(std::make_pair(instanceId, obj));
+        if ((size_t)instanceId >= m_Objects.size())
+            m_Objects.resize((size_t)instanceId + 1, nullptr);
+        m_Objects[instanceId] = obj;
+        ++m_ObjectsCount;
         return instanceId;
     }
 
     void ObjectManager::UnregisterObject(Object* obj)
     {
-        m_Objects.erase(obj->InstanceId());
+        ASTEROID_ASSERT(FindObject(obj->InstanceId()) == obj, "Object is not registered.");
+        m_Objects[obj->InstanceId()] = nullptr;
+        --m_ObjectsCount;
         m_InstanceIdManager.ReturnInstanceId(obj->InstanceId());
     }
 
     ObjectInstanceID ObjectManager::InstanceIDManager::GetAvailableInstanceId()
     {
-        return 0;
+        if (m_ReturnedIds.empty())
+            return m_NextId++;
+
+        ObjectInstanceID instanceId = m_ReturnedIds.back();
+        m_ReturnedIds.pop_back();
+        return instanceId;
     }
 
     void ObjectManager::InstanceIDManager::ReturnInstanceId(ObjectInstanceID id)
     {
+        m_ReturnedIds.push_back(id);
     }
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ObjectInstanceID.h"
+#include "Util/Containers.h"
 
 namespace ASTEROID_NAMESPACE
 {
@@ -9,12 +10,18 @@ namespace ASTEROID_NAMESPACE
     class ObjectManager
     {
     private:
+        /** Ids start at 1 and returned ids are reused first, so ids stay small enough to index arrays. */
         class InstanceIDManager
         {
         public:
+            InstanceIDManager() : m_NextId(1) {}
 
             ObjectInstanceID GetAvailableInstanceId();
             void ReturnInstanceId(ObjectInstanceID id);
+
+        private:
+            ObjectInstanceID            m_NextId;
+            Vector<ObjectInstanceID>    m_ReturnedIds;
         };
 
     public:
@@ -27,16 +34,35 @@ namespace ASTEROID_NAMESPACE
 
         Object* FindObject(ObjectInstanceID instanceId) const;
 
-        size_t ObjectCount() const { return m_Objects.size(); }
+        size_t ObjectCount() const { return m_ObjectsCount; }
 
         ObjectInstanceID RegisterObject(Object* obj);
         void UnregisterObject(Object* obj);
 
+        /**
+         *  Call function(Object*) for every registered object, in increasing ObjectInstanceID order.
+         *  The order only depends on the objects created and destroyed before, so it is the same on every run
+         *  and every platform doing the same, unlike the order of a hash map.
+         *  @remarks
+         *      Objects must not be registered or unregistered by the function.
+         */
+        template<typename Function>
+        void ForEachObject(Function function) const
+        {
+            for (Object* obj : m_Objects)
+            {
+                if (obj != nullptr)
+                    function(obj);
+            }
+        }
+
     public:
         static ObjectManager* _Singleton;
 
     private:
-        std::unordered_map<ObjectInstanceID, Object*> m_Objects;
+        /** Objects indexed by ObjectInstanceID, nullptr for ids not in use. */
+        Vector<Object*> m_Objects;
+        size_t m_ObjectsCount;
         InstanceIDManager m_InstanceIdManager;
     };
 }
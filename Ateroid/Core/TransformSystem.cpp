@@ -0,0 +1,365 @@
+#include "Precompile.h"
+#include "TransformSystem.h"
+#include "JobSystem.h"
+#include "Math/BatchMath.h"
+#include "Util/Debug.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /** Matrices multiplied per BatchMath call, small enough for the stack. */
+    static const uint32_t kBatchSize = 64;
+    /** Transforms per job when a level is split on the JobSystem. */
+    static const uint32_t kJobSize = 1024;
+    /** Children are found by scanning the level below once 1 / kScanChildrenRatio of a level is recomputed. */
+    static const uint32_t kScanChildrenRatio = 16;
+
+    static const Float4x4 kIdentity(1.0f, 0.0f, 0.0f, 0.0f,
+                                    0.0f, 1.0f, 0.0f, 0.0f,
+                                    0.0f, 0.0f, 1.0f, 0.0f,
+                                    0.0f, 0.0f, 0.0f, 1.0f);
+
+    TransformSystem* TransformSystem::_Singleton = nullptr;
+
+    TransformSystem::TransformSystem()
+        : m_TransformsCount(0)
+    {
+    }
+
+    TransformSystem::Handle TransformSystem::CreateTransform(Handle parent)
+    {
+        ASTEROID_ASSERT(parent == kInvalidHandle || m_Nodes[parent].depth != kFreeNode, "Parent transform was destroyed.");
+
+        Handle handle;
+        if (!m_FreeHandles.empty())
+        {
+            handle = m_FreeHandles.back();
+            m_FreeHandles.pop_back();
+        }
+        else
+        {
+            handle = (Handle)m_Nodes.size();
+            m_Nodes.emplace_back();
+        }
+
+        Node& node = m_Nodes[handle];
+        node.depth = kFreeNode;
+        node.firstChild = kInvalidHandle;
+        node.isQueued = false;
+        Link(handle, parent);
+
+        uint32_t depth = parent != kInvalidHandle ? m_Nodes[parent].depth + 1 : 0;
+        AppendToLevel(handle, depth, Float3(0.0f, 0.0f, 0.0f), Float4(0.0f, 0.0f, 0.0f, 1.0f), Float3(1.0f, 1.0f, 1.0f), kIdentity);
+        Queue(handle);
+        ++m_TransformsCount;
+        return handle;
+    }
+
+    void TransformSystem::DestroyTransform(Handle handle)
+    {
+        Node& node = m_Nodes[handle];
+        ASTEROID_ASSERT(node.depth != kFreeNode, "Transform was already destroyed.");
+
+        Handle child = node.firstChild;
+        while (child != kInvalidHandle)
+        {
+            Handle nextSibling = m_Nodes[child].nextSibling;
+            SetParent(child, node.parent);
+            child = nextSibling;
+        }
+
+        Unlink(handle);
+        RemoveFromLevel(handle);
+        node.depth = kFreeNode;
+        node.isQueued = false;
+        m_FreeHandles.push_back(handle);
+        --m_TransformsCount;
+    }
+
+    void TransformSystem::SetParent(Handle handle, Handle parent)
+    {
+        Node& node = m_Nodes[handle];
+        if (node.parent == parent)
+            return;
+
+        for (Handle ancestor = parent; ancestor != kInvalidHandle; ancestor = m_Nodes[ancestor].parent)
+            ASTEROID_ASSERT(ancestor != handle, "A transform can't be parented to itself or one of its descendants.");
+
+        Unlink(handle);
+        Link(handle, parent);
+
+        uint32_t depth = parent != kInvalidHandle ? m_Nodes[parent].depth + 1 : 0;
+        if (depth != node.depth)
+            MoveSubtree(handle);
+        else if (parent != kInvalidHandle)
+            m_Levels[depth].parents[node.index] = m_Nodes[parent].index;
+        else
+            m_Levels[depth].parents[node.index] = kNoParentIndex;
+        Queue(handle);
+    }
+
+    void TransformSystem::SetLocalPosition(Handle handle, const Float3& position)
+    {
+        const Node& node = m_Nodes[handle];
+        m_Levels[node.depth].localPositions[node.index] = position;
+        Queue(handle);
+    }
+
+    void TransformSystem::SetLocalRotation(Handle handle, const Float4& rotation)
+    {
+        const Node& node = m_Nodes[handle];
+        m_Levels[node.depth].localRotations[node.index] = rotation;
+        Queue(handle);
+    }
+
+    void TransformSystem::SetLocalScale(Handle handle, const Float3& scale)
+    {
+        const Node& node = m_Nodes[handle];
+        m_Levels[node.depth].localScales[node.index] = scale;
+        Queue(handle);
+    }
+
+    void TransformSystem::SetLocal(Handle handle, const Float3& position, const Float4& rotation, const Float3& scale)
+    {
+        const Node& node = m_Nodes[handle];
+        Level& level = m_Levels[node.depth];
+        level.localPositions[node.index] = position;
+        level.localRotations[node.index] = rotation;
+        level.localScales[node.index] = scale;
+        Queue(handle);
+    }
+
+    void TransformSystem::Update()
+    {
+        m_UpdatedTransforms.clear();
+        m_PropagatedIndices.clear();
+
+        // A level only reads world matrices of the level above, which are final once it is done
+        for (uint32_t iDepth = 0; iDepth < (uint32_t)m_Levels.size(); ++iDepth)
+            UpdateLevel(iDepth);
+    }
+
+    void TransformSystem::UpdateLevel(uint32_t depth)
+    {
+        Level& level = m_Levels[depth];
+
+        // Children of transforms recomputed in the level above, and the transforms queued in this one
+        m_UpdateIndices.swap(m_PropagatedIndices);
+        m_PropagatedIndices.clear();
+        size_t propagatedCount = m_UpdateIndices.size();
+        for (Handle handle : level.dirty)
+        {
+            Node& node = m_Nodes[handle];
+            if (node.depth == depth && node.isQueued)
+            {
+                node.isQueued = false;
+                m_UpdateIndices.push_back(node.index);
+            }
+        }
+        level.dirty.clear();
+        if (m_UpdateIndices.empty())
+            return;
+
+        // Walk the arrays front to back, which also makes the order of UpdatedTransforms deterministic.
+        // Both parts are usually sorted already, and a transform can be in both.
+        auto middle = m_UpdateIndices.begin() + propagatedCount;
+        if (!std::is_sorted(m_UpdateIndices.begin(), middle))
+            std::sort(m_UpdateIndices.begin(), middle);
+        if (!std::is_sorted(middle, m_UpdateIndices.end()))
+            std::sort(middle, m_UpdateIndices.end());
+        std::inplace_merge(m_UpdateIndices.begin(), middle, m_UpdateIndices.end());
+        m_UpdateIndices.erase(std::unique(m_UpdateIndices.begin(), m_UpdateIndices.end()), m_UpdateIndices.end());
+
+        const Float4x4* parentWorlds = depth > 0 ? m_Levels[depth - 1].worldMatrices.data() : nullptr;
+        auto updateRange = [this, &level, parentWorlds](uint32_t begin, uint32_t end)
+        {
+            Float4x4 locals[kBatchSize];
+            Float4x4 parents[kBatchSize];
+            for (uint32_t batchBegin = begin; batchBegin < end; batchBegin += kBatchSize)
+            {
+                uint32_t count = std::min(end - batchBegin, kBatchSize);
+                const uint32_t* indices = m_UpdateIndices.data() + batchBegin;
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    uint32_t index = indices[i];
+                    Mat4 local = Mat4::Affine(Vec4::Load(level.localScales[index], 0.0f),
+                        Quat::Load(level.localRotations[index]), Vec4::Load(level.localPositions[index], 1.0f));
+                    if (parentWorlds == nullptr)
+                    {
+                        local.Store(level.worldMatrices[index]);
+                        continue;
+                    }
+                    local.Store(locals[i]);
+                    parents[i] = parentWorlds[level.parents[index]];
+                }
+
+                if (parentWorlds != nullptr)
+                {
+                    BatchMath::MultiplyMatrices(locals, parents, count, locals);
+                    for (uint32_t i = 0; i < count; ++i)
+                        level.worldMatrices[indices[i]] = locals[i];
+                }
+            }
+        };
+
+        uint32_t updatesCount = (uint32_t)m_UpdateIndices.size();
+        JobSystem* jobSystem = JobSystem::Singleton();
+        if (jobSystem != nullptr)
+            jobSystem->ParallelFor(updatesCount, kJobSize, updateRange);
+        else
+            updateRange(0, updatesCount);
+
+        for (uint32_t index : m_UpdateIndices)
+            m_UpdatedTransforms.push_back(level.handles[index]);
+
+        // Children of recomputed transforms move with them. Following child links costs a cache miss per child,
+        // once a good part of the level changed a sequential pass over the parent indices below is cheaper.
+        if (depth + 1 >= m_Levels.size() || m_Levels[depth + 1].handles.empty())
+            return;
+        const Level& childLevel = m_Levels[depth + 1];
+        if (updatesCount * kScanChildrenRatio >= level.handles.size())
+        {
+            m_ChangedFlags.assign(level.handles.size(), 0);
+            for (uint32_t index : m_UpdateIndices)
+                m_ChangedFlags[index] = 1;
+            uint32_t childrenCount = (uint32_t)childLevel.parents.size();
+            for (uint32_t iChild = 0; iChild < childrenCount; ++iChild)
+            {
+                if (m_ChangedFlags[childLevel.parents[iChild]])
+                    m_PropagatedIndices.push_back(iChild);
+            }
+        }
+        else
+        {
+            for (uint32_t index : m_UpdateIndices)
+            {
+                for (Handle child = m_Nodes[level.handles[index]].firstChild; child != kInvalidHandle; child = m_Nodes[child].nextSibling)
+                    m_PropagatedIndices.push_back(m_Nodes[child].index);
+            }
+        }
+    }
+
+    void TransformSystem::Queue(Handle handle)
+    {
+        Node& node = m_Nodes[handle];
+        if (!node.isQueued)
+        {
+            node.isQueued = true;
+            m_Levels[node.depth].dirty.push_back(handle);
+        }
+    }
+
+    void TransformSystem::AppendToLevel(Handle handle, uint32_t depth, const Float3& position, const Float4& rotation,
+        const Float3& scale, const Float4x4& world)
+    {
+        if (depth >= m_Levels.size())
+            m_Levels.resize(depth + 1);
+
+        Node& node = m_Nodes[handle];
+        Level& level = m_Levels[depth];
+        node.depth = depth;
+        node.index = (uint32_t)level.handles.size();
+        level.localPositions.push_back(position);
+        level.localRotations.push_back(rotation);
+        level.localScales.push_back(scale);
+        level.worldMatrices.push_back(world);
+        uint32_t parentIndex = kNoParentIndex;
+        if (node.parent != kInvalidHandle)
+            parentIndex = m_Nodes[node.parent].index;
+        level.parents.push_back(parentIndex);
+        level.handles.push_back(handle);
+    }
+
+    void TransformSystem::RemoveFromLevel(Handle handle)
+    {
+        const Node& node = m_Nodes[handle];
+        Level& level = m_Levels[node.depth];
+        uint32_t index = node.index;
+        uint32_t lastIndex = (uint32_t)level.handles.size() - 1;
+        if (index != lastIndex)
+        {
+            level.localPositions[index] = level.localPositions[lastIndex];
+            level.localRotations[index] = level.localRotations[lastIndex];
+            level.localScales[index] = level.localScales[lastIndex];
+            level.worldMatrices[index] = level.worldMatrices[lastIndex];
+            level.parents[index] = level.parents[lastIndex];
+            level.handles[index] = level.handles[lastIndex];
+
+            Handle moved = level.handles[index];
+            m_Nodes[moved].index = index;
+            // Children still waiting in MoveSubtree are not in the level below yet and get the index when they move
+            for (Handle child = m_Nodes[moved].firstChild; child != kInvalidHandle; child = m_Nodes[child].nextSibling)
+            {
+                const Node& childNode = m_Nodes[child];
+                if (childNode.depth == node.depth + 1)
+                    m_Levels[childNode.depth].parents[childNode.index] = index;
+            }
+        }
+
+        level.localPositions.pop_back();
+        level.localRotations.pop_back();
+        level.localScales.pop_back();
+        level.worldMatrices.pop_back();
+        level.parents.pop_back();
+        level.handles.pop_back();
+    }
+
+    void TransformSystem::MoveSubtree(Handle handle)
+    {
+        // Parents move before their children, so children find the new index of their parent
+        m_MoveStack.clear();
+        m_MoveStack.push_back(handle);
+        while (!m_MoveStack.empty())
+        {
+            Handle moving = m_MoveStack.back();
+            m_MoveStack.pop_back();
+
+            Node& node = m_Nodes[moving];
+            const Level& level = m_Levels[node.depth];
+            Float3 position = level.localPositions[node.index];
+            Float4 rotation = level.localRotations[node.index];
+            Float3 scale = level.localScales[node.index];
+            Float4x4 world = level.worldMatrices[node.index];
+
+            RemoveFromLevel(moving);
+            // Its entry in the dirty list of the old level is skipped, queue it again below
+            node.isQueued = false;
+            uint32_t depth = node.parent != kInvalidHandle ? m_Nodes[node.parent].depth + 1 : 0;
+            AppendToLevel(moving, depth, position, rotation, scale, world);
+
+            for (Handle child = node.firstChild; child != kInvalidHandle; child = m_Nodes[child].nextSibling)
+                m_MoveStack.push_back(child);
+        }
+        Queue(handle);
+    }
+
+    void TransformSystem::Link(Handle handle, Handle parent)
+    {
+        Node& node = m_Nodes[handle];
+        node.parent = parent;
+        node.previousSibling = kInvalidHandle;
+        node.nextSibling = kInvalidHandle;
+        if (parent != kInvalidHandle)
+        {
+            Node& parentNode = m_Nodes[parent];
+            node.nextSibling = parentNode.firstChild;
+            if (parentNode.firstChild != kInvalidHandle)
+                m_Nodes[parentNode.firstChild].previousSibling = handle;
+            parentNode.firstChild = handle;
+        }
+    }
+
+    void TransformSystem::Unlink(Handle handle)
+    {
+        Node& node = m_Nodes[handle];
+        if (node.previousSibling != kInvalidHandle)
+            m_Nodes[node.previousSibling].nextSibling = node.nextSibling;
+        else if (node.parent != kInvalidHandle)
+            m_Nodes[node.parent].firstChild = node.nextSibling;
+        if (node.nextSibling != kInvalidHandle)
+            m_Nodes[node.nextSibling].previousSibling = node.previousSibling;
+
+        node.parent = kInvalidHandle;
+        node.previousSibling = kInvalidHandle;
+        node.nextSibling = kInvalidHandle;
+    }
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "Math/MathTypes.h"
+#include "Util/Containers.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  Local and world transforms of every object in a hierarchy.\n
+     *  Transforms are stored in SoA arrays, one set of arrays per depth in the hierarchy, so parents always
+     *  live in the level above their children. Changing a local value queues the transform, and Update only
+     *  recomputes world matrices of queued transforms and their descendants, level by level. Levels are
+     *  split into batches on the JobSystem if it is created and batches multiply matrices with BatchMath.
+     *  @remarks
+     *      Not thread-safe, transforms are modified and updated from the simulation thread.
+     */
+    class TransformSystem
+    {
+    public:
+        typedef uint32_t Handle;
+
+        static const Handle kInvalidHandle = 0xFFFFFFFF;
+
+    public:
+        ASTEROID_NON_COPYABLE(TransformSystem)
+
+        /**
+         *  Create the TransformSystem singleton.
+         */
+        static TransformSystem* Create()
+        {
+            ASTEROID_ASSERT(_Singleton == nullptr, "There is already a TransformSystem singleton created.");
+            _Singleton = ASTEROID_NEW TransformSystem();
+            return _Singleton;
+        }
+
+        /**
+         *  Destroy the TransformSystem singleton. Every transform is destroyed with it.
+         */
+        static void Destroy()
+        {
+            ASTEROID_DELETE _Singleton;
+            _Singleton = nullptr;
+        }
+
+        /**
+         *  Current created singleton.
+         *  @return
+         *      Instance of current created singleton. nullptr if no instance created or singleton was destroyed.
+         */
+        static TransformSystem* Singleton() { return _Singleton; }
+
+        /**
+         *  Create an identity transform. Its world matrix is valid after the next Update.
+         *  @param parent
+         *      Transform the new one is relative to, kInvalidHandle for a root.
+         */
+        Handle CreateTransform(Handle parent = kInvalidHandle);
+
+        /**
+         *  Destroy a transform. Its children move to its parent and keep their local values.
+         */
+        void DestroyTransform(Handle handle);
+
+        /**
+         *  Attach a transform to a new parent, keeping its local values.
+         *  @param parent
+         *      kInvalidHandle to make it a root. Must not be the transform itself or one of its descendants.
+         */
+        void SetParent(Handle handle, Handle parent);
+        Handle Parent(Handle handle) const { return m_Nodes[handle].parent; }
+        /** Depth in the hierarchy, 0 for roots. */
+        uint32_t Depth(Handle handle) const { return m_Nodes[handle].depth; }
+
+        void SetLocalPosition(Handle handle, const Float3& position);
+        /** @param rotation Unit quaternion (x, y, z, w). */
+        void SetLocalRotation(Handle handle, const Float4& rotation);
+        void SetLocalScale(Handle handle, const Float3& scale);
+        void SetLocal(Handle handle, const Float3& position, const Float4& rotation, const Float3& scale);
+
+        const Float3& LocalPosition(Handle handle) const { const Node& node = m_Nodes[handle]; return m_Levels[node.depth].localPositions[node.index]; }
+        const Float4& LocalRotation(Handle handle) const { const Node& node = m_Nodes[handle]; return m_Levels[node.depth].localRotations[node.index]; }
+        const Float3& LocalScale(Handle handle) const { const Node& node = m_Nodes[handle]; return m_Levels[node.depth].localScales[node.index]; }
+
+        /** Row-major local to world matrix as of the last Update. */
+        const Float4x4& WorldMatrix(Handle handle) const { const Node& node = m_Nodes[handle]; return m_Levels[node.depth].worldMatrices[node.index]; }
+
+        /**
+         *  Recompute the world matrices of every transform changed since the last Update and of their descendants.
+         */
+        void Update();
+
+        /** Transforms whose world matrix was recomputed by the last Update, parents before their children. */
+        const Vector<Handle>& UpdatedTransforms() const { return m_UpdatedTransforms; }
+
+        uint32_t TransformsCount() const { return m_TransformsCount; }
+        /** Numbers of depth levels, including levels emptied by destroyed transforms. */
+        uint32_t LevelsCount() const { return (uint32_t)m_Levels.size(); }
+
+    private:
+        /** Links of a transform, indexed by handle. */
+        struct Node
+        {
+            /** Level the transform is stored in, kFreeNode if the handle is free. */
+            uint32_t    depth;
+            /** Index in the arrays of the level. */
+            uint32_t    index;
+            Handle      parent;
+            Handle      firstChild;
+            Handle      nextSibling;
+            Handle      previousSibling;
+            /** Queued in the dirty list of its level. */
+            bool        isQueued;
+        };
+
+        /** SoA arrays of the transforms at one depth. */
+        struct Level
+        {
+            Vector<Float3>      localPositions;
+            Vector<Float4>      localRotations;
+            Vector<Float3>      localScales;
+            Vector<Float4x4>    worldMatrices;
+            /** Index of the parent in the level above. */
+            Vector<uint32_t>    parents;
+            Vector<Handle>      handles;
+            /** Transforms to recompute, entries of transforms that moved away are skipped. */
+            Vector<Handle>      dirty;
+        };
+
+        static const uint32_t kFreeNode = 0xFFFFFFFF;
+        static const uint32_t kNoParentIndex = 0xFFFFFFFF;
+
+        TransformSystem();
+
+        void Queue(Handle handle);
+        void AppendToLevel(Handle handle, uint32_t depth, const Float3& position, const Float4& rotation, const Float3& scale,
+            const Float4x4& world);
+        /** Swap-remove a transform from its level, fixing the parent indices of the children of the one moved. */
+        void RemoveFromLevel(Handle handle);
+        /** Move a transform and its descendants to the levels matching the depth of its new parent. */
+        void MoveSubtree(Handle handle);
+        void Link(Handle handle, Handle parent);
+        void Unlink(Handle handle);
+        void UpdateLevel(uint32_t depth);
+
+    private:
+        static TransformSystem* _Singleton;
+
+    private:
+        Vector<Node>        m_Nodes;
+        Vector<Handle>      m_FreeHandles;
+        Vector<Level>       m_Levels;
+        uint32_t            m_TransformsCount;
+
+        Vector<uint32_t>    m_UpdateIndices;
+        /** Indices in the next level whose parent was recomputed. */
+        Vector<uint32_t>    m_PropagatedIndices;
+        Vector<uint8_t>     m_ChangedFlags;
+        Vector<Handle>      m_UpdatedTransforms;
+        Vector<Handle>      m_MoveStack;
+    };
+}
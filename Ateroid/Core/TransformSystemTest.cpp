@@ -0,0 +1,300 @@
+#include "Precompile.h"
+#include "TransformSystemTest.h"
+#include "TransformSystem.h"
+#include "Math/BatchMath.h"
+#include "Util/Debug.h"
+#include <random>
+
+namespace ASTEROID_NAMESPACE
+{
+    typedef TransformSystem::Handle Handle;
+
+    static const uint32_t kInitialTransformsCount = 256;
+    /** New transforms get a root as parent with this probability, otherwise a random live transform. */
+    static const float kRootRatio = 0.2f;
+
+    enum class EOperation
+    {
+        eCreate, eDestroy, eReparent, eMove, eCount
+    };
+
+    /** What the test expects of a transform it created. */
+    struct ModelTransform
+    {
+        Handle      parent;
+        Float3      position;
+        Float4      rotation;
+        Float3      scale;
+    };
+
+    typedef UnorderedMap<Handle, ModelTransform> TransformModel;
+
+    static Float4 RandomRotation(std::mt19937& random)
+    {
+        std::normal_distribution<float> normal;
+        Float4 rotation(normal(random), normal(random), normal(random), normal(random));
+        float length = std::sqrt(rotation.x * rotation.x + rotation.y * rotation.y + rotation.z * rotation.z + rotation.w * rotation.w);
+        if (length == 0.0f)
+            return Float4(0.0f, 0.0f, 0.0f, 1.0f);
+        return Float4(rotation.x / length, rotation.y / length, rotation.z / length, rotation.w / length);
+    }
+
+    static Handle RandomTransform(const Vector<Handle>& handles, std::mt19937& random)
+    {
+        return handles[random() % handles.size()];
+    }
+
+    static bool IsDescendant(const TransformModel& model, Handle handle, Handle ancestor)
+    {
+        for (Handle parent = model.at(handle).parent; parent != TransformSystem::kInvalidHandle; parent = model.at(parent).parent)
+        {
+            if (parent == ancestor)
+                return true;
+        }
+        return false;
+    }
+
+    static uint32_t ModelDepth(const TransformModel& model, Handle handle)
+    {
+        uint32_t depth = 0;
+        for (Handle parent = model.at(handle).parent; parent != TransformSystem::kInvalidHandle; parent = model.at(parent).parent)
+            ++depth;
+        return depth;
+    }
+
+    /** World matrix computed from the root down, with the same math as TransformSystem::Update. */
+    static const Float4x4& ReferenceWorld(const TransformModel& model, Handle handle, UnorderedMap<Handle, Float4x4>* worlds)
+    {
+        auto found = worlds->find(handle);
+        if (found != worlds->end())
+            return found->second;
+
+        const ModelTransform& transform = model.at(handle);
+        Float4x4 world;
+        Mat4::Affine(Vec4::Load(transform.scale, 0.0f), Quat::Load(transform.rotation), Vec4::Load(transform.position, 1.0f)).Store(world);
+        if (transform.parent != TransformSystem::kInvalidHandle)
+        {
+            Float4x4 parentWorld = ReferenceWorld(model, transform.parent, worlds);
+            BatchMath::MultiplyMatrices(&world, &parentWorld, 1, &world);
+        }
+        return (*worlds)[handle] = world;
+    }
+
+    static Handle CreateTransform(TransformSystem* transforms, TransformModel* model, Vector<Handle>* handles, std::mt19937& random)
+    {
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        Handle parent = TransformSystem::kInvalidHandle;
+        if (!handles->empty() && uniform(random) >= kRootRatio)
+            parent = RandomTransform(*handles, random);
+
+        Handle handle = transforms->CreateTransform(parent);
+        ModelTransform transform;
+        transform.parent = parent;
+        transform.position = Float3(0.0f, 0.0f, 0.0f);
+        transform.rotation = Float4(0.0f, 0.0f, 0.0f, 1.0f);
+        transform.scale = Float3(1.0f, 1.0f, 1.0f);
+        (*model)[handle] = transform;
+        handles->push_back(handle);
+        return handle;
+    }
+
+    /** Check parents, depths, local values and world matrices of every transform of the model. */
+    static bool CheckTransforms(const TransformSystem* transforms, const TransformModel& model, uint32_t round)
+    {
+        UnorderedMap<Handle, Float4x4> worlds;
+        for (const auto& entry : model)
+        {
+            Handle handle = entry.first;
+            const ModelTransform& transform = entry.second;
+            if (transforms->Parent(handle) != transform.parent || transforms->Depth(handle) != ModelDepth(model, handle))
+            {
+                ASTEROID_LOG_ERROR_F("Transforms round %u: transform %u has parent %u at depth %u instead of %u at depth %u.", round,
+                    handle, transforms->Parent(handle), transforms->Depth(handle), transform.parent, ModelDepth(model, handle));
+                return false;
+            }
+            if (std::memcmp(&transforms->LocalPosition(handle), &transform.position, sizeof(Float3)) != 0 ||
+                std::memcmp(&transforms->LocalRotation(handle), &transform.rotation, sizeof(Float4)) != 0 ||
+                std::memcmp(&transforms->LocalScale(handle), &transform.scale, sizeof(Float3)) != 0)
+            {
+                ASTEROID_LOG_ERROR_F("Transforms round %u: local values of transform %u were lost.", round, handle);
+                return false;
+            }
+            if (std::memcmp(&transforms->WorldMatrix(handle), &ReferenceWorld(model, handle, &worlds), sizeof(Float4x4)) != 0)
+            {
+                ASTEROID_LOG_ERROR_F("Transforms round %u: world matrix of transform %u differs from the reference.", round, handle);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /** UpdatedTransforms must be the changed transforms and their descendants, each once, parents first. */
+    static bool CheckUpdated(const TransformSystem* transforms, const TransformModel& model, const UnorderedMap<Handle, bool>& changed,
+        uint32_t round)
+    {
+        UnorderedMap<Handle, uint32_t> positions;
+        const Vector<Handle>& updated = transforms->UpdatedTransforms();
+        for (uint32_t iUpdated = 0; iUpdated < (uint32_t)updated.size(); ++iUpdated)
+        {
+            if (model.find(updated[iUpdated]) == model.end() || !positions.insert(std::make_pair(updated[iUpdated], iUpdated)).second)
+            {
+                ASTEROID_LOG_ERROR_F("Transforms round %u: transform %u is listed twice or doesn't exist.", round, updated[iUpdated]);
+                return false;
+            }
+        }
+
+        for (const auto& entry : model)
+        {
+            Handle handle = entry.first;
+            bool isExpected = false;
+            for (Handle ancestor = handle; ancestor != TransformSystem::kInvalidHandle && !isExpected; ancestor = model.at(ancestor).parent)
+                isExpected = changed.find(ancestor) != changed.end();
+
+            auto found = positions.find(handle);
+            if (isExpected != (found != positions.end()))
+            {
+                ASTEROID_LOG_ERROR_F("Transforms round %u: transform %u was %s.", round, handle,
+                    isExpected ? "not recomputed although it or an ancestor changed" : "recomputed without changes");
+                return false;
+            }
+
+            Handle parent = entry.second.parent;
+            if (found != positions.end() && parent != TransformSystem::kInvalidHandle)
+            {
+                auto foundParent = positions.find(parent);
+                if (foundParent != positions.end() && foundParent->second > found->second)
+                {
+                    ASTEROID_LOG_ERROR_F("Transforms round %u: transform %u is listed before its parent %u.", round, handle, parent);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool TransformSystemTest::Run(const TransformSystemTestSettings& settings)
+    {
+        ASTEROID_LOG_INFO_F("Transform system test: %u rounds of %u operations.", settings.roundsCount, settings.operationsPerRound);
+
+        TransformSystem* transforms = TransformSystem::Singleton();
+        if (transforms == nullptr)
+        {
+            ASTEROID_LOG_ERROR("The transform system test needs a TransformSystem.");
+            return false;
+        }
+
+        std::mt19937 random(settings.seed);
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        TransformModel model;
+        Vector<Handle> handles;
+        UnorderedMap<Handle, bool> changed;
+        uint64_t updatedCount = 0;
+        uint32_t maxDepth = 0;
+
+        // The initial transforms are changed by their creation, so the first round recomputes them all
+        for (uint32_t iTransform = 0; iTransform < kInitialTransformsCount; ++iTransform)
+            changed[CreateTransform(transforms, &model, &handles, random)] = true;
+
+        bool isValid = true;
+        for (uint32_t iRound = 0; iRound < settings.roundsCount && isValid; ++iRound)
+        {
+            for (uint32_t iOperation = 0; iOperation < settings.operationsPerRound; ++iOperation)
+            {
+                EOperation operation = handles.empty() ? EOperation::eCreate : (EOperation)(random() % (uint32_t)EOperation::eCount);
+                switch (operation)
+                {
+                case EOperation::eCreate:
+                    changed[CreateTransform(transforms, &model, &handles, random)] = true;
+                    break;
+                case EOperation::eDestroy:
+                {
+                    uint32_t index = random() % (uint32_t)handles.size();
+                    Handle handle = handles[index];
+                    Handle parent = model.at(handle).parent;
+                    transforms->DestroyTransform(handle);
+
+                    // Children move to the parent of the destroyed transform
+                    for (auto& entry : model)
+                    {
+                        if (entry.second.parent == handle)
+                        {
+                            entry.second.parent = parent;
+                            changed[entry.first] = true;
+                        }
+                    }
+                    model.erase(handle);
+                    changed.erase(handle);
+                    handles[index] = handles.back();
+                    handles.pop_back();
+                    break;
+                }
+                case EOperation::eReparent:
+                {
+                    Handle handle = RandomTransform(handles, random);
+                    Handle parent = uniform(random) < kRootRatio ? TransformSystem::kInvalidHandle : RandomTransform(handles, random);
+                    if (parent == handle || (parent != TransformSystem::kInvalidHandle && IsDescendant(model, parent, handle)))
+                        break;
+
+                    transforms->SetParent(handle, parent);
+                    if (model.at(handle).parent != parent)
+                        changed[handle] = true;
+                    model.at(handle).parent = parent;
+                    break;
+                }
+                default:
+                {
+                    Handle handle = RandomTransform(handles, random);
+                    ModelTransform& transform = model.at(handle);
+                    transform.position = Float3((uniform(random) - 0.5f) * 20.0f, (uniform(random) - 0.5f) * 20.0f, (uniform(random) - 0.5f) * 20.0f);
+                    transform.rotation = RandomRotation(random);
+                    transform.scale = Float3(0.5f + uniform(random) * 1.5f, 0.5f + uniform(random) * 1.5f, 0.5f + uniform(random) * 1.5f);
+                    // Exercise every setter, they must all queue the transform
+                    switch (random() % 3)
+                    {
+                    case 0:
+                        transforms->SetLocal(handle, transform.position, transform.rotation, transform.scale);
+                        break;
+                    case 1:
+                        transforms->SetLocalPosition(handle, transform.position);
+                        transforms->SetLocalRotation(handle, transform.rotation);
+                        transforms->SetLocalScale(handle, transform.scale);
+                        break;
+                    default:
+                        transforms->SetLocalScale(handle, transform.scale);
+                        transforms->SetLocal(handle, transform.position, transform.rotation, transform.scale);
+                        break;
+                    }
+                    changed[handle] = true;
+                    break;
+                }
+                }
+            }
+
+            transforms->Update();
+            updatedCount += transforms->UpdatedTransforms().size();
+            isValid &= CheckUpdated(transforms, model, changed, iRound);
+            isValid &= CheckTransforms(transforms, model, iRound);
+            changed.clear();
+            for (Handle handle : handles)
+                maxDepth = std::max(maxDepth, transforms->Depth(handle));
+
+            // Nothing changed since, nothing is recomputed
+            transforms->Update();
+            if (!transforms->UpdatedTransforms().empty())
+            {
+                ASTEROID_LOG_ERROR_F("Transforms round %u: an update without changes recomputed %zu transforms.", iRound,
+                    transforms->UpdatedTransforms().size());
+                isValid = false;
+            }
+        }
+
+        ASTEROID_LOG_INFO_F("    %zu transforms alive, up to %u levels deep, %llu recomputed in total", handles.size(), maxDepth + 1,
+            (unsigned long long)updatedCount);
+
+        // Children first, so every destroy leaves the others' parents untouched
+        std::sort(handles.begin(), handles.end(), [&model](Handle a, Handle b) { return ModelDepth(model, a) > ModelDepth(model, b); });
+        for (Handle handle : handles)
+            transforms->DestroyTransform(handle);
+        return isValid;
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+namespace ASTEROID_NAMESPACE
+{
+    struct TransformSystemTestSettings
+    {
+        /** Rounds of random operations, each followed by an Update and the checks. */
+        uint32_t    roundsCount;
+        uint32_t    operationsPerRound;
+        uint32_t    seed;
+    };
+
+
+    /**
+     *  Checks the TransformSystem singleton against a naive model of the hierarchy. Every round creates,
+     *  destroys, reparents and moves random transforms, then updates. Parents and depths must match the model,
+     *  UpdatedTransforms must list exactly the changed transforms and their descendants with parents first, and
+     *  every world matrix must be bit-identical to a recursive computation. An Update without changes must not
+     *  recompute anything.
+     */
+    class TransformSystemTest
+    {
+    public:
+        ASTEROID_NO_DEFAULT_CTOR(TransformSystemTest)
+        ASTEROID_NON_COPYABLE(TransformSystemTest)
+
+        /**
+         *  @return
+         *      False if any check failed. Transforms created by the test are destroyed before returning.
+         */
+        static bool Run(const TransformSystemTestSettings& settings);
+    };
+}
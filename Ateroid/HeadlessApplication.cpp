@@ -0,0 +1,723 @@
+#include "Precompile.h"
+#include "HeadlessApplication.h"
+#include "Core/FrameScheduler.h"
+#include "Core/GameObject.h"
+#include "Core/JobSystem.h"
+#include "Core/ObjectManager.h"
+#include "Core/TransformSystem.h"
+#include "Core/TransformSystemTest.h"
+#include "Math/BatchMathBenchmark.h"
+#include "Physics/BroadPhaseBenchmark.h"
+#include "Physics/CcdTest.h"
+#include "Physics/PhysicsWorld.h"
+#include "Physics/SimulationRecord.h"
+#include "Rendering/CullingBenchmark.h"
+#include "Rendering/DrawListBenchmark.h"
+#include "Rendering/GoldenImageTest.h"
+#include "Rendering/InstanceBatcherTest.h"
+#include "Rendering/LightingBenchmark.h"
+#include "Rendering/MeshProcessingBenchmark.h"
+#include "Rendering/RenderGraphTest.h"
+#include "Rendering/UploadRingTest.h"
+#include "Util/ConsoleVariable.h"
+#include "Util/Debug.h"
+#include "Util/PlayerPrefs.h"
+#include "Util/SimdDispatch.h"
+#include "Util/SystemInfo.h"
+#include "Util/TLSFAllocatorTest.h"
+#include <cstdio>
+#include <limits>
+#include <random>
+
+namespace ASTEROID_NAMESPACE
+{
+    static const double kFixedTimestep = 1.0 / 60.0;
+    static const uint32_t kMaxStepsPerFrame = 5;
+    // Servers have nothing to present, pacing frames to the steps is enough
+    static const double kMaxFrameRate = 60.0;
+
+    /** Average distance between the asteroids of --physics-bodies. */
+    static const float kAsteroidSpacing = 12.0f;
+    static const float kMinAsteroidRadius = 0.5f;
+    static const float kMaxAsteroidRadius = 4.0f;
+    /** Exponent of the power law of asteroid sizes, small ones are the most common. */
+    static const float kAsteroidSizeExponent = 2.5f;
+    static const float kMaxAsteroidSpeed = 3.0f;
+    static const float kMaxAsteroidSpin = 1.0f;
+    /** Shapes of the asteroids that are not spheres, each shared by many asteroids. */
+    static const uint32_t kAsteroidHullsCount = 4;
+    static const uint32_t kAsteroidHullPointsCount = 24;
+    /** Fraction of the bodies that are projectiles, crossing many times their size per step. */
+    static const float kProjectilesRatio = 0.02f;
+    static const float kProjectileRadius = 0.1f;
+    static const float kProjectileSpeed = 300.0f;
+    /** Workers count of --workers when it is not given, the processors count minus one. */
+    static const uint32_t kDefaultWorkersCount = 0xFFFFFFFF;
+    /** Steps simulated at each SIMD level by --benchmark-simd. */
+    static const uint32_t kSimdBenchmarkStepsCount = 120;
+
+    static const char* kUsage =
+        "Usage: AsteroidHeadless [options]\n"
+        "    --frames N                  Quit after N frames.\n"
+        "    --unpaced                   Run one simulation step per frame without waiting.\n"
+        "    --workers N                 Run the JobSystem with N worker threads instead of one per processor but one.\n"
+        "    --benchmark-broadphase N    Time the broad-phases on N bodies, then quit.\n"
+        "    --benchmark-batchmath N     Time the BatchMath functions on N elements, then quit.\n"
+        "    --benchmark-culling N       Time frustum and occlusion culling of N objects, then quit.\n"
+        "    --benchmark-drawlist N      Time sorting draw lists of up to N draws, then quit.\n"
+        "    --benchmark-lighting N      Time assigning up to N lights to clusters, then quit.\n"
+        "    --benchmark-meshprocessing N    Time the MeshProcessing functions on N triangles, then quit.\n"
+        "    --benchmark-simd N          Check every SimdKernel level on N elements, then quit.\n"
+        "    --test-tlsf N               Check the TLSFAllocator over N random operations, then quit.\n"
+        "    --test-transforms N         Check the TransformSystem over N random rounds, then quit.\n"
+        "    --test-ccd N                Check N projectiles against every target shape with and without CCD, then quit.\n"
+        "    --test-rendergraph N        Check a frame graph and N random render graphs, then quit.\n"
+        "    --test-uploadring N         Check the UploadRing over N frames with the GPU lagging behind, then quit.\n"
+        "    --test-instancebatcher N    Check the InstanceBatcher draws over N random frames, then quit.\n"
+        "    --physics-bodies N          Simulate a field of N asteroids and projectiles.\n"
+        "    --deterministic             Run the PhysicsWorld in its deterministic mode.\n"
+        "    --record FILE               Run deterministically and record the session to FILE.\n"
+        "    --replay FILE               Replay a recorded session and compare every step.\n"
+        "    --render-image FILE         Render the golden image scene to a PPM file, then quit.\n"
+        "    --golden-image FILE         Render the golden image scene and compare it with a PPM file, then quit.\n";
+
+    /** @return False if the text is not a whole decimal number that fits in the count. */
+    template <typename T>
+    static bool ParseCount(const char* text, T* count)
+    {
+        if (*text < '0' || *text > '9')
+            return false;
+        char* end = nullptr;
+        errno = 0;
+        unsigned long long value = std::strtoull(text, &end, 10);
+        if (*end != '\0' || errno == ERANGE || value > std::numeric_limits<T>::max())
+            return false;
+        *count = (T)value;
+        return true;
+    }
+
+    static void HandleQuitSignal(int)
+    {
+        if (HeadlessApplication::Singleton())
+            HeadlessApplication::Singleton()->RequestQuit();
+    }
+
+    HeadlessApplication* HeadlessApplication::_Singleton = nullptr;
+
+    HeadlessApplication::HeadlessApplication(int argc, char** argv)
+        : m_MaxFramesCount(0), m_IsUnpaced(false), m_WorkersCount(kDefaultWorkersCount), m_BroadPhaseBenchmarkBodiesCount(0),
+          m_BatchMathBenchmarkCount(0), m_CullingBenchmarkObjectsCount(0), m_DrawListBenchmarkDrawsCount(0),
+          m_LightingBenchmarkLightsCount(0), m_MeshProcessingBenchmarkTrianglesCount(0), m_SimdBenchmarkCount(0),
+          m_TLSFTestOperationsCount(0), m_TransformsTestRoundsCount(0), m_CcdTestProjectilesCount(0), m_RenderGraphTestGraphsCount(0),
+          m_UploadRingTestFramesCount(0), m_InstanceBatcherTestFramesCount(0), m_PhysicsBodiesCount(0), m_IsDeterministic(false),
+          m_Record(nullptr), m_CheckedStepsCount(0), m_IsDiverged(false), m_IsQuitRequested(0), m_FrameScheduler(nullptr),
+          m_ObjectManager(nullptr), m_PhysicsTime(0.0)
+    {
+        ASTEROID_ASSERT(_Singleton == nullptr, "There is already a singleton created.");
+        _Singleton = this;
+
+        for (int iArg = 1; iArg < argc; ++iArg)
+        {
+            const char* option = argv[iArg];
+            bool isValid = true;
+            if (std::strcmp(argv[iArg], "--frames") == 0 && iArg + 1 < argc)
+                isValid = ParseCount(argv[++iArg], &m_MaxFramesCount);
+            else if (std::strcmp(argv[iArg], "--unpaced") == 0)
+                m_IsUnpaced = true;
+            else if (std::strcmp(argv[iArg], "--workers") == 0 && iArg + 1 < argc)
+                isValid = ParseCount(argv[++iArg], &m_WorkersCount);
+            else if (std::strcmp(argv[iArg], "--benchmark-broadphase") == 0 && iArg + 1 < argc)
+                isValid = ParseCount(argv[++iArg], &m_BroadPhaseBenchmarkBodiesCount);
+            else if (std::strcmp(argv[iArg], "--benchmark-batchmath") == 0 && iArg + 1 < argc)
+                isValid = ParseCount(argv[++iArg], &m_BatchMathBenchmarkCount);
+            else if (std::strcmp(argv[iArg], "--benchmark-culling") == 0 && iArg + 1 < argc)
+                isValid = ParseCount(argv[++iArg], &m_CullingBenchmarkObjectsCount);
+            else if (std::strcmp(argv[iArg], "--benchmark-drawlist") == 0 && iArg + 1 < argc)
+                isValid = ParseCount(argv[++iArg], &m_DrawListBenchmarkDrawsCount);
+            else if (std::strcmp(argv[iArg], "--benchmark-lighting") == 0 && iArg + 1 < argc)
+                isValid = ParseCount(argv[++iArg], &m_LightingBenchmarkLightsCount);
+            else if (std::strcmp(argv[iArg], "--benchmark-meshprocessing") == 0 && iArg + 1 < argc)
+                isValid = ParseCount(argv[++iArg], &m_MeshProcessingBenchmarkTrianglesCount);
+            else if (std::strcmp(argv[iArg], "--benchmark-simd") == 0 && iArg + 1 < argc)
+                isValid = ParseCount(argv[++iArg], &m_SimdBenchmarkCount);
+            else if (std::strcmp(argv[iArg], "--test-tlsf") == 0 && iArg + 1 < argc)
+                isValid = ParseCount(argv[++iArg], &m_TLSFTestOperationsCount);
+            else if (std::strcmp(argv[iArg], "--test-transforms") == 0 && iArg + 1 < argc)
+                isValid = ParseCount(argv[++iArg], &m_TransformsTestRoundsCount);
+            else if (std::strcmp(argv[iArg], "--test-ccd") == 0 && iArg + 1 < argc)
+                isValid = ParseCount(argv[++iArg], &m_CcdTestProjectilesCount);
+            else if (std::strcmp(argv[iArg], "--test-rendergraph") == 0 && iArg + 1 < argc)
+                isValid = ParseCount(argv[++iArg], &m_RenderGraphTestGraphsCount);
+            else if (std::strcmp(argv[iArg], "--test-uploadring") == 0 && iArg + 1 < argc)
+                isValid = ParseCount(argv[++iArg], &m_UploadRingTestFramesCount);
+            else if (std::strcmp(argv[iArg], "--test-instancebatcher") == 0 && iArg + 1 < argc)
+                isValid = ParseCount(argv[++iArg], &m_InstanceBatcherTestFramesCount);
+            else if (std::strcmp(argv[iArg], "--physics-bodies") == 0 && iArg + 1 < argc)
+                isValid = ParseCount(argv[++iArg], &m_PhysicsBodiesCount);
+            else if (std::strcmp(argv[iArg], "--deterministic") == 0)
+                m_IsDeterministic = true;
+            else if (std::strcmp(argv[iArg], "--record") == 0 && iArg + 1 < argc)
+                m_RecordPath = argv[++iArg];
+            else if (std::strcmp(argv[iArg], "--replay") == 0 && iArg + 1 < argc)
+                m_ReplayPath = argv[++iArg];
+            else if (std::strcmp(argv[iArg], "--render-image") == 0 && iArg + 1 < argc)
+                m_RenderImagePath = argv[++iArg];
+            else if (std::strcmp(argv[iArg], "--golden-image") == 0 && iArg + 1 < argc)
+                m_GoldenImagePath = argv[++iArg];
+            else
+                isValid = false;
+
+            if (!isValid)
+            {
+                m_InvalidArgument = option;
+                break;
+            }
+        }
+    }
+
+    HeadlessApplication::~HeadlessApplication()
+    {
+        Finalize();
+        _Singleton = nullptr;
+    }
+
+    int HeadlessApplication::Run()
+    {
+        if (!Initialize())
+            return 1;
+
+        if (m_BroadPhaseBenchmarkBodiesCount > 0)
+        {
+            BroadPhaseBenchmarkSettings benchmarkSettings;
+            benchmarkSettings.bodiesCount = m_BroadPhaseBenchmarkBodiesCount;
+            benchmarkSettings.framesCount = 60;
+            benchmarkSettings.seed = 1;
+            benchmarkSettings.maxBruteForceBodiesCount = 20000;
+            return BroadPhaseBenchmark::Run(benchmarkSettings) ? 0 : 1;
+        }
+
+        if (m_BatchMathBenchmarkCount > 0)
+        {
+            BatchMathBenchmarkSettings benchmarkSettings;
+            benchmarkSettings.count = m_BatchMathBenchmarkCount;
+            benchmarkSettings.iterationsCount = 20;
+            benchmarkSettings.seed = 1;
+            return BatchMathBenchmark::Run(benchmarkSettings) ? 0 : 1;
+        }
+
+        if (m_CullingBenchmarkObjectsCount > 0)
+        {
+            CullingBenchmarkSettings benchmarkSettings;
+            benchmarkSettings.objectsCount = m_CullingBenchmarkObjectsCount;
+            benchmarkSettings.framesCount = 60;
+            benchmarkSettings.seed = 1;
+            return CullingBenchmark::Run(benchmarkSettings) ? 0 : 1;
+        }
+
+        if (m_DrawListBenchmarkDrawsCount > 0)
+        {
+            DrawListBenchmarkSettings benchmarkSettings;
+            benchmarkSettings.maxDrawsCount = m_DrawListBenchmarkDrawsCount;
+            benchmarkSettings.framesCount = 20;
+            benchmarkSettings.seed = 1;
+            return DrawListBenchmark::Run(benchmarkSettings) ? 0 : 1;
+        }
+
+        if (m_LightingBenchmarkLightsCount > 0)
+        {
+            LightingBenchmarkSettings benchmarkSettings;
+            benchmarkSettings.maxLightsCount = m_LightingBenchmarkLightsCount;
+            benchmarkSettings.framesCount = 20;
+            benchmarkSettings.seed = 1;
+            return LightingBenchmark::Run(benchmarkSettings) ? 0 : 1;
+        }
+
+        if (m_MeshProcessingBenchmarkTrianglesCount > 0)
+        {
+            MeshProcessingBenchmarkSettings benchmarkSettings;
+            benchmarkSettings.trianglesCount = m_MeshProcessingBenchmarkTrianglesCount;
+            benchmarkSettings.iterationsCount = 3;
+            benchmarkSettings.seed = 1;
+            return MeshProcessingBenchmark::Run(benchmarkSettings) ? 0 : 1;
+        }
+
+        if (m_SimdBenchmarkCount > 0)
+            return RunSimdBenchmark(m_SimdBenchmarkCount) ? 0 : 1;
+
+        if (m_TLSFTestOperationsCount > 0)
+        {
+            TLSFAllocatorTestSettings testSettings;
+            testSettings.operationsCount = m_TLSFTestOperationsCount;
+            testSettings.capacity = 16 * 1024 * 1024;
+            testSettings.seed = 1;
+            return TLSFAllocatorTest::Run(testSettings) ? 0 : 1;
+        }
+
+        if (m_TransformsTestRoundsCount > 0)
+        {
+            TransformSystemTestSettings testSettings;
+            testSettings.roundsCount = m_TransformsTestRoundsCount;
+            testSettings.operationsPerRound = 64;
+            testSettings.seed = 1;
+            return TransformSystemTest::Run(testSettings) ? 0 : 1;
+        }
+
+        if (m_CcdTestProjectilesCount > 0)
+        {
+            CcdTestSettings testSettings;
+            testSettings.projectilesCount = m_CcdTestProjectilesCount;
+            testSettings.seed = 1;
+            return CcdTest::Run(testSettings) ? 0 : 1;
+        }
+
+        if (m_RenderGraphTestGraphsCount > 0)
+        {
+            RenderGraphTestSettings testSettings;
+            testSettings.graphsCount = m_RenderGraphTestGraphsCount;
+            testSettings.seed = 1;
+            return RenderGraphTest::Run(testSettings) ? 0 : 1;
+        }
+
+        if (m_UploadRingTestFramesCount > 0)
+        {
+            UploadRingTestSettings testSettings;
+            testSettings.framesCount = m_UploadRingTestFramesCount;
+            testSettings.seed = 1;
+            return UploadRingTest::Run(testSettings) ? 0 : 1;
+        }
+
+        if (m_InstanceBatcherTestFramesCount > 0)
+        {
+            InstanceBatcherTestSettings testSettings;
+            testSettings.framesCount = m_InstanceBatcherTestFramesCount;
+            testSettings.seed = 1;
+            return InstanceBatcherTest::Run(testSettings) ? 0 : 1;
+        }
+
+        if (!m_RenderImagePath.empty() || !m_GoldenImagePath.empty())
+        {
+            GoldenImageTestSettings testSettings;
+            testSettings.width = 640;
+            testSettings.height = 360;
+            testSettings.imagePath = m_RenderImagePath.empty() ? nullptr : m_RenderImagePath.c_str();
+            testSettings.goldenPath = m_GoldenImagePath.empty() ? nullptr : m_GoldenImagePath.c_str();
+            // Edges may move by a pixel with other math libraries, shading by a step
+            testSettings.channelTolerance = 2;
+            testSettings.maxDifferentPixelsCount = testSettings.width * testSettings.height / 1000;
+            return GoldenImageTest::Run(testSettings) ? 0 : 1;
+        }
+
+        int retCode = MainLoop();
+        ASTEROID_LOG_INFO_F("Exit with return code %d.", retCode);
+        return retCode;
+    }
+
+    bool HeadlessApplication::Initialize()
+    {
+        // Initialize the debug system, load symbol files, redirect stderr, etc.
+        Debug::Initialize();
+
+        if (!m_InvalidArgument.empty())
+        {
+            // The log goes to a file, the usage goes to the console too so whoever typed the command sees it
+            ASTEROID_LOG_ERROR_F("Unknown option, or option without a valid value: \"%s\".\n%s", m_InvalidArgument.c_str(), kUsage);
+            std::fprintf(stdout, "Unknown option, or option without a valid value: \"%s\".\n%s", m_InvalidArgument.c_str(), kUsage);
+            return false;
+        }
+
+        if (!SystemInfo::Initialize())
+        {
+            ASTEROID_LOG_ERROR("Application init failed: SystemInfo init failed.");
+            return false;
+        }
+
+        // The thread waiting on jobs helps executing them, so leave one processor for it.
+        if (m_WorkersCount == kDefaultWorkersCount)
+            m_WorkersCount = std::max(SystemInfo::ProcessorsCount(), 1u) - 1;
+        JobSystem::Create(m_WorkersCount);
+
+        PlayerPrefs::Create();
+        if (!PlayerPrefs::Singleton()->Load())
+        {
+            // PlayerPrefs load failed for some reason. Just print a log and continue.
+            ASTEROID_LOG_INFO("PlayerPrefs::Load failed.");
+        }
+
+        ConsoleVariableManager::Create(PlayerPrefs::Singleton());
+
+        // Reads its console variable, so it comes after ConsoleVariableManager
+        SimdDispatch::Initialize();
+
+        m_ObjectManager = ASTEROID_NEW ObjectManager();
+
+        TransformSystem::Create();
+
+        FrameSchedulerSettings schedulerSettings;
+        schedulerSettings.fixedTimestep = kFixedTimestep;
+        schedulerSettings.maxStepsPerFrame = kMaxStepsPerFrame;
+        schedulerSettings.maxFrameRate = kMaxFrameRate;
+        schedulerSettings.clock = m_IsUnpaced ? EFrameClock::eUnpaced : EFrameClock::eRealTime;
+
+        // Asteroids drift in space, nothing pulls them anywhere
+        PhysicsSettings physicsSettings;
+        physicsSettings.gravity = Float3(0.0f, 0.0f, 0.0f);
+        physicsSettings.velocityIterations = 4;
+        physicsSettings.contactMargin = 0.05f;
+        physicsSettings.restitution = 0.3f;
+        physicsSettings.friction = 0.5f;
+        physicsSettings.linearDamping = 0.0f;
+        physicsSettings.angularDamping = 0.05f;
+        physicsSettings.sleepLinearSpeed = 0.05f;
+        physicsSettings.sleepAngularSpeed = 0.05f;
+        physicsSettings.timeToSleep = 0.5f;
+        physicsSettings.isDeterministic = m_IsDeterministic || !m_RecordPath.empty();
+
+        if (!m_ReplayPath.empty())
+        {
+            if (!m_RecordPath.empty())
+            {
+                ASTEROID_LOG_WARNING("--record is ignored when replaying.");
+                m_RecordPath.clear();
+            }
+
+            m_Record = ASTEROID_NEW SimulationRecord();
+            if (!m_Record->Load(m_ReplayPath))
+            {
+                ASTEROID_LOG_ERROR("Application init failed: SimulationRecord load failed.");
+                return false;
+            }
+
+            // The recorded session as fast as possible, then quit
+            physicsSettings = m_Record->physicsSettings;
+            schedulerSettings.fixedTimestep = m_Record->fixedTimestep;
+            schedulerSettings.clock = EFrameClock::eUnpaced;
+            m_MaxFramesCount = std::max<uint64_t>(m_Record->steps.size(), 1);
+            m_PhysicsBodiesCount = (uint32_t)m_Record->bodies.size();
+
+            PhysicsWorld::Create(physicsSettings);
+            for (const Vector<Float3>& points : m_Record->hullPoints)
+                CreateAsteroidHull(points.data(), (uint32_t)points.size());
+            for (const RigidBodyDesc& desc : m_Record->bodies)
+                AddAsteroid(desc);
+            ASTEROID_LOG_INFO_F("Replaying %u steps of %u bodies from \"%s\".", (uint32_t)m_Record->steps.size(),
+                m_PhysicsBodiesCount, m_ReplayPath.c_str());
+        }
+        else
+        {
+            if (!m_RecordPath.empty())
+            {
+                m_Record = ASTEROID_NEW SimulationRecord();
+                m_Record->fixedTimestep = schedulerSettings.fixedTimestep;
+                m_Record->physicsSettings = physicsSettings;
+            }
+
+            PhysicsWorld::Create(physicsSettings);
+            if (m_PhysicsBodiesCount > 0)
+                SpawnAsteroids(m_PhysicsBodiesCount);
+        }
+
+        m_FrameScheduler = ASTEROID_NEW FrameScheduler(schedulerSettings);
+
+        std::signal(SIGINT, HandleQuitSignal);
+        std::signal(SIGTERM, HandleQuitSignal);
+        return true;
+    }
+
+    void HeadlessApplication::Finalize()
+    {
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+
+        ASTEROID_DELETE m_FrameScheduler;
+        m_FrameScheduler = nullptr;
+
+        ASTEROID_DELETE m_Record;
+        m_Record = nullptr;
+
+        for (GameObject* asteroid : m_Asteroids)
+            ASTEROID_DELETE asteroid;
+        m_Asteroids.clear();
+
+        if (PhysicsWorld::Singleton())
+            PhysicsWorld::Destroy();
+
+        if (TransformSystem::Singleton())
+            TransformSystem::Destroy();
+
+        ASTEROID_DELETE m_ObjectManager;
+        m_ObjectManager = nullptr;
+
+        if (ConsoleVariableManager::Singleton())
+        {
+            // Unregister all variables, all persistent variables will be saved.
+            ConsoleVariableManager::Singleton()->UnregisterAllVariables();
+            ConsoleVariableManager::Destroy();
+        }
+
+        if (PlayerPrefs::Singleton())
+        {
+            PlayerPrefs::Singleton()->Save();
+            PlayerPrefs::Destroy();
+        }
+
+        if (JobSystem::Singleton())
+            JobSystem::Destroy();
+
+        Debug::Finalize();
+    }
+
+    int HeadlessApplication::MainLoop()
+    {
+        while (!m_IsQuitRequested)
+        {
+            PerformMainLoop();
+
+            if (m_MaxFramesCount > 0 && m_FrameScheduler->FramesCount() >= m_MaxFramesCount)
+                break;
+        }
+
+        ASTEROID_LOG_INFO_F("Ran %llu frames, %llu steps, %.3f s simulated, %.3f s dropped.",
+            (unsigned long long)m_FrameScheduler->FramesCount(), (unsigned long long)m_FrameScheduler->StepsCount(),
+            m_FrameScheduler->SimulationTime(), m_FrameScheduler->DroppedTime());
+        if (m_PhysicsBodiesCount > 0 && m_FrameScheduler->StepsCount() > 0)
+        {
+            PhysicsWorld* physicsWorld = PhysicsWorld::Singleton();
+            ASTEROID_LOG_INFO_F("Physics: %.3f ms per step, %u bodies, %u awake, %u pairs, %u contacts in %u colors, %u impacts.",
+                m_PhysicsTime * 1000.0 / (double)m_FrameScheduler->StepsCount(), physicsWorld->BodiesCount(),
+                physicsWorld->AwakeBodiesCount(), physicsWorld->PairsCount(), physicsWorld->ContactsCount(), physicsWorld->ColorsCount(),
+                physicsWorld->ImpactsCount());
+        }
+
+        if (PhysicsWorld::Singleton()->Settings().isDeterministic)
+        {
+            ASTEROID_LOG_INFO_F("State checksum %016llx after %llu steps.", (unsigned long long)PhysicsWorld::Singleton()->StateChecksum(),
+                (unsigned long long)m_FrameScheduler->StepsCount());
+        }
+
+        if (!m_RecordPath.empty())
+        {
+            if (!m_Record->Save(m_RecordPath))
+                return 1;
+            ASTEROID_LOG_INFO_F("Recorded %u steps to \"%s\".", m_CheckedStepsCount, m_RecordPath.c_str());
+        }
+        else if (!m_ReplayPath.empty())
+        {
+            if (m_IsDiverged)
+                return 1;
+
+            double recordedTime = 0.0;
+            for (uint32_t iStep = 0; iStep < m_CheckedStepsCount; ++iStep)
+                recordedTime += m_Record->steps[iStep].physicsTime;
+            double stepsCount = (double)std::max(m_CheckedStepsCount, 1u);
+            ASTEROID_LOG_INFO_F("Replay matched %u of %u steps. Physics %.3f ms per step, recorded %.3f ms per step (%+.1f%%).",
+                m_CheckedStepsCount, (uint32_t)m_Record->steps.size(), m_PhysicsTime * 1000.0 / stepsCount,
+                recordedTime * 1000.0 / stepsCount, recordedTime > 0.0 ? (m_PhysicsTime / recordedTime - 1.0) * 100.0 : 0.0);
+        }
+        return 0;
+    }
+
+    void HeadlessApplication::PerformMainLoop()
+    {
+        uint32_t stepsCount = m_FrameScheduler->BeginFrame();
+        for (uint32_t iStep = 0; iStep < stepsCount; ++iStep)
+            FixedUpdate(m_FrameScheduler->FixedTimestep());
+
+        m_FrameScheduler->EndFrame();
+    }
+
+    bool HeadlessApplication::RunSimdBenchmark(uint32_t count)
+    {
+        BatchMathBenchmarkSettings batchMathSettings;
+        batchMathSettings.count = count;
+        batchMathSettings.iterationsCount = 20;
+        batchMathSettings.seed = 1;
+        bool isValid = BatchMathBenchmark::Run(batchMathSettings);
+
+        CullingBenchmarkSettings cullingSettings;
+        cullingSettings.objectsCount = count;
+        cullingSettings.framesCount = 60;
+        cullingSettings.seed = 1;
+        isValid &= CullingBenchmark::Run(cullingSettings);
+
+        // The broad-phase, narrow phase and integration kernels, through whole deterministic steps
+        uint32_t bodiesCount = std::max(count / 10, 1u);
+        PhysicsSettings physicsSettings = PhysicsWorld::Singleton()->Settings();
+        physicsSettings.isDeterministic = true;
+        ASTEROID_LOG_INFO_F("Physics benchmark: %u bodies, %u steps.", bodiesCount, kSimdBenchmarkStepsCount);
+
+        uint64_t referenceChecksum = 0;
+        ESimdLevel previousLevel = SimdDispatch::Level();
+        for (uint32_t iLevel = 0; iLevel <= (uint32_t)SimdDispatch::DetectedLevel(); ++iLevel)
+        {
+            ESimdLevel level = (ESimdLevel)iLevel;
+            SimdDispatch::SetLevel(level);
+
+            // Ids and transform handles are recycled last in first out, deleting in reverse gives every level the
+            // same ones, which the state checksum includes
+            for (auto it = m_Asteroids.rbegin(); it != m_Asteroids.rend(); ++it)
+                ASTEROID_DELETE *it;
+            m_Asteroids.clear();
+            PhysicsWorld::Destroy();
+            PhysicsWorld::Create(physicsSettings);
+            SpawnAsteroids(bodiesCount);
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (uint32_t iStep = 0; iStep < kSimdBenchmarkStepsCount; ++iStep)
+                PhysicsWorld::Singleton()->Step((float)kFixedTimestep);
+            double physicsTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            uint64_t checksum = PhysicsWorld::Singleton()->StateChecksum();
+            ASTEROID_LOG_INFO_F("    %-6s: physics %8.3f ms per step, state checksum %016llx", SimdDispatch::LevelName(level),
+                physicsTime / kSimdBenchmarkStepsCount, (unsigned long long)checksum);
+            if (level == ESimdLevel::eScalar)
+            {
+                referenceChecksum = checksum;
+            }
+            else if (checksum != referenceChecksum)
+            {
+                ASTEROID_LOG_ERROR_F("Physics at level %s ended with state checksum %016llx instead of %016llx.",
+                    SimdDispatch::LevelName(level), (unsigned long long)checksum, (unsigned long long)referenceChecksum);
+                isValid = false;
+            }
+        }
+        SimdDispatch::SetLevel(previousLevel);
+        return isValid;
+    }
+
+    void HeadlessApplication::FixedUpdate(double timestep)
+    {
+        // Simulation running at the fixed timestep goes here, same as WindowsApplication::FixedUpdate.
+
+        std::chrono::steady_clock::time_point physicsStart = std::chrono::steady_clock::now();
+        PhysicsWorld::Singleton()->Step((float)timestep);
+        double physicsTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - physicsStart).count();
+        m_PhysicsTime += physicsTime;
+        if (m_Record != nullptr)
+            CheckStep(physicsTime);
+
+        // World matrices of everything the step moved
+        TransformSystem::Singleton()->Update();
+    }
+
+    void HeadlessApplication::SpawnAsteroids(uint32_t count)
+    {
+        PhysicsWorld* physicsWorld = PhysicsWorld::Singleton();
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        std::normal_distribution<float> normal;
+
+        // Lumpy rocks, points on a sphere pushed in by up to a third
+        uint32_t hulls[kAsteroidHullsCount];
+        for (uint32_t& hull : hulls)
+        {
+            Float3 points[kAsteroidHullPointsCount];
+            for (Float3& point : points)
+            {
+                Float3 direction(normal(random), normal(random), normal(random));
+                float scale = (1.0f - uniform(random) / 3.0f) * 2.0f /
+                    std::max(std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z), 1e-6f);
+                point = Float3(direction.x * scale, direction.y * scale, direction.z * scale);
+            }
+            hull = CreateAsteroidHull(points, kAsteroidHullPointsCount);
+        }
+
+        float side = std::cbrt((float)count) * kAsteroidSpacing;
+        uint32_t projectilesCount = 0;
+        m_Asteroids.reserve(count);
+        for (uint32_t iAsteroid = 0; iAsteroid < count; ++iAsteroid)
+        {
+            RigidBodyDesc desc;
+            desc.isFast = false;
+            desc.radius = std::min(kMinAsteroidRadius * std::pow(1.0f - uniform(random), -1.0f / (kAsteroidSizeExponent - 1.0f)), kMaxAsteroidRadius);
+            desc.halfHeight = 0.0f;
+            desc.hull = PhysicsWorld::kInvalidHull;
+            float shape = uniform(random);
+            if (shape < 0.1f && hulls[iAsteroid % kAsteroidHullsCount] != PhysicsWorld::kInvalidHull)
+            {
+                desc.shape = EShapeType::eConvexHull;
+                desc.hull = hulls[iAsteroid % kAsteroidHullsCount];
+            }
+            else if (shape < 0.2f)
+            {
+                desc.shape = EShapeType::eCapsule;
+                desc.halfHeight = desc.radius;
+            }
+            else
+            {
+                desc.shape = EShapeType::eSphere;
+            }
+
+            float boundingRadius = desc.shape == EShapeType::eConvexHull ? physicsWorld->Hull(desc.hull).BoundingRadius() : desc.radius + desc.halfHeight;
+            desc.mass = boundingRadius * boundingRadius * boundingRadius;
+            desc.position = Float3((uniform(random) - 0.5f) * side, (uniform(random) - 0.5f) * side, (uniform(random) - 0.5f) * side);
+            Quat rotation = Quat::Normalize({ Vec4::Set(normal(random), normal(random), normal(random), normal(random)) });
+            rotation.Store(desc.rotation);
+            float speed = uniform(random) * kMaxAsteroidSpeed, spin = uniform(random) * kMaxAsteroidSpin;
+            Float3 direction(normal(random), normal(random), normal(random));
+            Float3 axis(normal(random), normal(random), normal(random));
+            desc.linearVelocity = Float3(direction.x * speed, direction.y * speed, direction.z * speed);
+            desc.angularVelocity = Float3(axis.x * spin, axis.y * spin, axis.z * spin);
+            if (uniform(random) < kProjectilesRatio)
+            {
+                desc.shape = EShapeType::eSphere;
+                desc.radius = kProjectileRadius;
+                desc.mass = kProjectileRadius * kProjectileRadius * kProjectileRadius;
+                float length = std::max(std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z), 1e-6f);
+                desc.linearVelocity = Float3(direction.x * kProjectileSpeed / length, direction.y * kProjectileSpeed / length,
+                    direction.z * kProjectileSpeed / length);
+                desc.isFast = true;
+                ++projectilesCount;
+            }
+
+            AddAsteroid(desc);
+        }
+        ASTEROID_LOG_INFO_F("Spawned %u asteroids and %u projectiles in a cube of side %.0f.", count - projectilesCount, projectilesCount, side);
+    }
+
+    uint32_t HeadlessApplication::CreateAsteroidHull(const Float3* points, uint32_t count)
+    {
+        if (m_Record != nullptr && !m_RecordPath.empty())
+            m_Record->hullPoints.emplace_back(points, points + count);
+        return PhysicsWorld::Singleton()->CreateConvexHull(points, count);
+    }
+
+    void HeadlessApplication::AddAsteroid(const RigidBodyDesc& desc)
+    {
+        if (m_Record != nullptr && !m_RecordPath.empty())
+            m_Record->bodies.push_back(desc);
+
+        GameObject* asteroid = ASTEROID_NEW GameObject();
+        RigidBodyDesc bodyDesc = desc;
+        bodyDesc.transform = asteroid->Transform();
+        PhysicsWorld::Singleton()->AddBody(asteroid->InstanceId(), bodyDesc);
+        m_Asteroids.push_back(asteroid);
+    }
+
+    void HeadlessApplication::CheckStep(double physicsTime)
+    {
+        uint64_t stateChecksum = PhysicsWorld::Singleton()->StateChecksum();
+        if (!m_RecordPath.empty())
+        {
+            m_Record->steps.push_back({ stateChecksum, physicsTime });
+            ++m_CheckedStepsCount;
+            return;
+        }
+
+        // Past the end of the record when the frames ran several steps, nothing to compare to
+        if (m_CheckedStepsCount >= m_Record->steps.size())
+            return;
+
+        // Stop at the first difference, later steps only diverge further
+        const SimulationRecord::Step& recordedStep = m_Record->steps[m_CheckedStepsCount];
+        if (stateChecksum != recordedStep.stateChecksum)
+        {
+            ASTEROID_LOG_ERROR_F("Replay diverged at step %u: state checksum %016llx, recorded %016llx.", m_CheckedStepsCount,
+                (unsigned long long)stateChecksum, (unsigned long long)recordedStep.stateChecksum);
+            m_IsDiverged = true;
+            RequestQuit();
+            return;
+        }
+        ++m_CheckedStepsCount;
+    }
+
+}
\ No newline at end of file
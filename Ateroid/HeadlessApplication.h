@@ -0,0 +1,124 @@
+#pragma once
+
+#include "Util/Containers.h"
+#include "Util/String.h"
+#include <csignal>
+
+namespace ASTEROID_NAMESPACE
+{
+    class FrameScheduler;
+    class GameObject;
+    class ObjectManager;
+    struct Float3;
+    struct RigidBodyDesc;
+    struct SimulationRecord;
+
+
+    /**
+     *  Root caller without a window or GPU, for dedicated simulation servers and benchmarks.
+     *  Engine initialize/finalize and the engine loop, which runs until SIGINT/SIGTERM or a frame limit.\n
+     *  Command line options:\n
+     *      --frames N  Quit after N frames.\n
+     *      --unpaced   Run one simulation step per frame without waiting, faster than real time.\n
+     *      --workers N     Run the JobSystem with N worker threads, 0 runs every job on the main thread. One per
+     *                      processor but one by default.\n
+     *      --benchmark-broadphase N    Time the broad-phases on synthetic scenes of N bodies, then quit.\n
+     *      --benchmark-batchmath N     Time the BatchMath functions on N elements at every SIMD level, then quit.\n
+     *      --benchmark-culling N       Time frustum culling N objects at every SIMD level and occlusion culling, then quit.\n
+     *      --benchmark-drawlist N      Time sorting draw lists of up to N draws and check the order is stable, then quit.\n
+     *      --benchmark-lighting N      Time assigning up to N lights to clusters and check every cluster list, then quit.\n
+     *      --benchmark-meshprocessing N    Time the MeshProcessing functions on meshes of N triangles, check them
+     *                                      against a scalar reference and with and without workers, then quit.\n
+     *      --benchmark-simd N  Run every SimdKernel at each level from scalar to the detected one: the batch math and
+     *                          culling benchmarks on N elements, then N/10 physics bodies, which must end with the same
+     *                          state checksum at every level. Quit after.\n
+     *      --test-tlsf N   Check TLSFAllocator coalescing, alignment and N random allocations and frees, then quit.\n
+     *      --test-transforms N     Check TransformSystem dirty propagation and reparenting over N random rounds, then quit.\n
+     *      --test-ccd N    Check N projectiles tunnel through each target shape without CCD and none with, then quit.\n
+     *      --test-rendergraph N    Check culling, aliasing and barriers of a frame graph and N random render graphs,
+     *                              then quit.\n
+     *      --test-uploadring N     Check UploadRing wrapping, overwrites and full rings over N frames at fence latencies
+     *                              2 and 3, then quit.\n
+     *      --test-instancebatcher N    Check the draws and instance stream of N frames of shuffled objects batched by
+     *                                  the InstanceBatcher, then quit.\n
+     *      --physics-bodies N  Simulate a field of N asteroids and projectiles colliding in the PhysicsWorld.\n
+     *      --deterministic     Run the PhysicsWorld in its deterministic mode and log the state checksum at the end.\n
+     *      --record FILE   Run deterministically and save the bodies, then the checksum and time of every step to FILE.\n
+     *      --replay FILE   Run a recorded session again unpaced, stop at the first step whose checksum differs and
+     *                      compare the physics time per step with the recorded one.\n
+     *      --render-image FILE     Render the golden image scene with the software rasterizer to a PPM file, then quit.\n
+     *      --golden-image FILE     Render the golden image scene and compare it with a PPM file, then quit.\n
+     *  Any other argument, or an option without a valid value, prints the usage and makes Run return 1.
+     */
+    class HeadlessApplication
+    {
+    public:
+        ASTEROID_NON_COPYABLE(HeadlessApplication)
+
+        static HeadlessApplication* Singleton() { return _Singleton; }
+
+        HeadlessApplication(int argc, char** argv);
+        ~HeadlessApplication();
+
+        int Run();
+
+        /** Make the main loop return after the current frame, safe to call from a signal handler. */
+        void RequestQuit() { m_IsQuitRequested = 1; }
+
+    public:
+        static HeadlessApplication* _Singleton;
+
+    private:
+        bool Initialize();
+        void Finalize();
+        int MainLoop();
+        void PerformMainLoop();
+        /** --benchmark-simd, returns false if a level did not match the scalar one. */
+        bool RunSimdBenchmark(uint32_t count);
+        void FixedUpdate(double timestep);
+        void SpawnAsteroids(uint32_t count);
+        /** Create a hull and add it to the record being saved, if any. */
+        uint32_t CreateAsteroidHull(const Float3* points, uint32_t count);
+        /** Create an asteroid game object with a body, and add the body to the record being saved, if any. */
+        void AddAsteroid(const RigidBodyDesc& desc);
+        /** Compare the replayed step with the recorded one, or record it. */
+        void CheckStep(double physicsTime);
+
+    private:
+        uint64_t                m_MaxFramesCount;
+        bool                    m_IsUnpaced;
+        uint32_t                m_WorkersCount;
+        uint32_t                m_BroadPhaseBenchmarkBodiesCount;
+        uint32_t                m_BatchMathBenchmarkCount;
+        uint32_t                m_CullingBenchmarkObjectsCount;
+        uint32_t                m_DrawListBenchmarkDrawsCount;
+        uint32_t                m_LightingBenchmarkLightsCount;
+        uint32_t                m_MeshProcessingBenchmarkTrianglesCount;
+        uint32_t                m_SimdBenchmarkCount;
+        uint32_t                m_TLSFTestOperationsCount;
+        uint32_t                m_TransformsTestRoundsCount;
+        uint32_t                m_CcdTestProjectilesCount;
+        uint32_t                m_RenderGraphTestGraphsCount;
+        uint32_t                m_UploadRingTestFramesCount;
+        uint32_t                m_InstanceBatcherTestFramesCount;
+        uint32_t                m_PhysicsBodiesCount;
+        bool                    m_IsDeterministic;
+        String                  m_RecordPath;
+        String                  m_ReplayPath;
+        String                  m_RenderImagePath;
+        String                  m_GoldenImagePath;
+        /** First command line argument that is not an option or has no valid value, empty if all are valid. */
+        String                  m_InvalidArgument;
+        /** Session being recorded or replayed, nullptr for neither. */
+        SimulationRecord*       m_Record;
+        /** Steps recorded or replayed so far. */
+        uint32_t                m_CheckedStepsCount;
+        bool                    m_IsDiverged;
+        volatile sig_atomic_t   m_IsQuitRequested;
+        FrameScheduler*         m_FrameScheduler;
+        ObjectManager*          m_ObjectManager;
+        Vector<GameObject*>     m_Asteroids;
+        /** Wall-clock time spent in PhysicsWorld::Step. */
+        double                  m_PhysicsTime;
+    };
+}
\ No newline at end of file
@@ -0,0 +1,8 @@
+#include "Precompile.h"
+#include "HeadlessApplication.h"
+
+int main(int argc, char** argv)
+{
+    ASTEROID_NAMESPACE::HeadlessApplication app(argc, argv);
+    return app.Run();
+}
@@ -0,0 +1,236 @@
+#include "Precompile.h"
+#include "BatchMath.h"
+#include "Util/SimdDispatch.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ASTEROID_BATCH_MATH_AVX
+#include <immintrin.h>
+#endif
+
+namespace ASTEROID_NAMESPACE
+{
+    // Every implementation evaluates ((x * m1 + m4) + y * m2) + z * m3 for points and
+    // ((a0 * b0 + a1 * b1) + a2 * b2) + a3 * b3 for matrix rows, the order Mat4 uses
+
+    static void TransformPointsScalar(const Float4x4& m, const float* x, const float* y, const float* z,
+        uint32_t begin, uint32_t end, float* outX, float* outY, float* outZ)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            float px = x[i], py = y[i], pz = z[i];
+            outX[i] = ((px * m._11 + m._41) + py * m._21) + pz * m._31;
+            outY[i] = ((px * m._12 + m._42) + py * m._22) + pz * m._32;
+            outZ[i] = ((px * m._13 + m._43) + py * m._23) + pz * m._33;
+        }
+    }
+
+    /** Four points at a time in Vec4, SSE on x86 and NEON on ARM. */
+    static void TransformPointsVec4(const Float4x4& m, const float* x, const float* y, const float* z,
+        uint32_t begin, uint32_t end, float* outX, float* outY, float* outZ)
+    {
+        Vec4 m11 = Vec4::Splat(m._11), m12 = Vec4::Splat(m._12), m13 = Vec4::Splat(m._13);
+        Vec4 m21 = Vec4::Splat(m._21), m22 = Vec4::Splat(m._22), m23 = Vec4::Splat(m._23);
+        Vec4 m31 = Vec4::Splat(m._31), m32 = Vec4::Splat(m._32), m33 = Vec4::Splat(m._33);
+        Vec4 m41 = Vec4::Splat(m._41), m42 = Vec4::Splat(m._42), m43 = Vec4::Splat(m._43);
+
+        uint32_t i = begin;
+        for (; i + 4 <= end; i += 4)
+        {
+            Vec4 px = Vec4::Load(x + i), py = Vec4::Load(y + i), pz = Vec4::Load(z + i);
+            Vec4::MultiplyAdd(pz, m31, Vec4::MultiplyAdd(py, m21, Vec4::MultiplyAdd(px, m11, m41))).Store(outX + i);
+            Vec4::MultiplyAdd(pz, m32, Vec4::MultiplyAdd(py, m22, Vec4::MultiplyAdd(px, m12, m42))).Store(outY + i);
+            Vec4::MultiplyAdd(pz, m33, Vec4::MultiplyAdd(py, m23, Vec4::MultiplyAdd(px, m13, m43))).Store(outZ + i);
+        }
+        TransformPointsScalar(m, x, y, z, i, end, outX, outY, outZ);
+    }
+
+#ifdef ASTEROID_BATCH_MATH_AVX
+    ASTEROID_TARGET_AVX2
+    static void TransformPointsAVX2(const Float4x4& m, const float* x, const float* y, const float* z,
+        uint32_t begin, uint32_t end, float* outX, float* outY, float* outZ)
+    {
+        __m256 m11 = _mm256_set1_ps(m._11), m12 = _mm256_set1_ps(m._12), m13 = _mm256_set1_ps(m._13);
+        __m256 m21 = _mm256_set1_ps(m._21), m22 = _mm256_set1_ps(m._22), m23 = _mm256_set1_ps(m._23);
+        __m256 m31 = _mm256_set1_ps(m._31), m32 = _mm256_set1_ps(m._32), m33 = _mm256_set1_ps(m._33);
+        __m256 m41 = _mm256_set1_ps(m._41), m42 = _mm256_set1_ps(m._42), m43 = _mm256_set1_ps(m._43);
+
+        uint32_t i = begin;
+        for (; i + 8 <= end; i += 8)
+        {
+            __m256 px = _mm256_loadu_ps(x + i), py = _mm256_loadu_ps(y + i), pz = _mm256_loadu_ps(z + i);
+            _mm256_storeu_ps(outX + i, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px, m11), m41),
+                _mm256_mul_ps(py, m21)), _mm256_mul_ps(pz, m31)));
+            _mm256_storeu_ps(outY + i, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px, m12), m42),
+                _mm256_mul_ps(py, m22)), _mm256_mul_ps(pz, m32)));
+            _mm256_storeu_ps(outZ + i, _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px, m13), m43),
+                _mm256_mul_ps(py, m23)), _mm256_mul_ps(pz, m33)));
+        }
+        TransformPointsVec4(m, x, y, z, i, end, outX, outY, outZ);
+    }
+
+    ASTEROID_TARGET_AVX512
+    static void TransformPointsAVX512(const Float4x4& m, const float* x, const float* y, const float* z,
+        uint32_t begin, uint32_t end, float* outX, float* outY, float* outZ)
+    {
+        __m512 m11 = _mm512_set1_ps(m._11), m12 = _mm512_set1_ps(m._12), m13 = _mm512_set1_ps(m._13);
+        __m512 m21 = _mm512_set1_ps(m._21), m22 = _mm512_set1_ps(m._22), m23 = _mm512_set1_ps(m._23);
+        __m512 m31 = _mm512_set1_ps(m._31), m32 = _mm512_set1_ps(m._32), m33 = _mm512_set1_ps(m._33);
+        __m512 m41 = _mm512_set1_ps(m._41), m42 = _mm512_set1_ps(m._42), m43 = _mm512_set1_ps(m._43);
+
+        uint32_t i = begin;
+        for (; i + 16 <= end; i += 16)
+        {
+            __m512 px = _mm512_loadu_ps(x + i), py = _mm512_loadu_ps(y + i), pz = _mm512_loadu_ps(z + i);
+            _mm512_storeu_ps(outX + i, _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(px, m11), m41),
+                _mm512_mul_ps(py, m21)), _mm512_mul_ps(pz, m31)));
+            _mm512_storeu_ps(outY + i, _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(px, m12), m42),
+                _mm512_mul_ps(py, m22)), _mm512_mul_ps(pz, m32)));
+            _mm512_storeu_ps(outZ + i, _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(px, m13), m43),
+                _mm512_mul_ps(py, m23)), _mm512_mul_ps(pz, m33)));
+        }
+        TransformPointsAVX2(m, x, y, z, i, end, outX, outY, outZ);
+    }
+#endif
+
+    using TransformPointsFunction = void(*)(const Float4x4& m, const float* x, const float* y, const float* z,
+        uint32_t begin, uint32_t end, float* outX, float* outY, float* outZ);
+#ifdef ASTEROID_BATCH_MATH_AVX
+    static SimdKernel<TransformPointsFunction> TransformPointsKernel("BatchMath.TransformPoints",
+        TransformPointsScalar, TransformPointsVec4, TransformPointsAVX2, TransformPointsAVX512);
+#else
+    static SimdKernel<TransformPointsFunction> TransformPointsKernel("BatchMath.TransformPoints",
+        TransformPointsScalar, TransformPointsVec4);
+#endif
+
+
+    /** @param bStride 1 to multiply by b[i], 0 to multiply every matrix by b[0]. */
+    static void MultiplyMatricesScalar(const Float4x4* a, const Float4x4* b, uint32_t bStride, uint32_t count, Float4x4* out)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const Float4x4& right = b[i * bStride];
+            Float4x4 result;
+            for (uint32_t iRow = 0; iRow < 4; ++iRow)
+            {
+                const float* row = a[i].m[iRow];
+                for (uint32_t iColumn = 0; iColumn < 4; ++iColumn)
+                {
+                    result.m[iRow][iColumn] = ((row[0] * right.m[0][iColumn] + row[1] * right.m[1][iColumn])
+                        + row[2] * right.m[2][iColumn]) + row[3] * right.m[3][iColumn];
+                }
+            }
+            out[i] = result;
+        }
+    }
+
+    static void MultiplyMatricesVec4(const Float4x4* a, const Float4x4* b, uint32_t bStride, uint32_t count, Float4x4* out)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+            Mat4::Multiply(Mat4::Load(a[i]), Mat4::Load(b[i * bStride])).Store(out[i]);
+    }
+
+#ifdef ASTEROID_BATCH_MATH_AVX
+    /** Two rows per register, each half multiplied by the same rows of b. */
+    ASTEROID_TARGET_AVX2
+    static void MultiplyMatricesAVX2(const Float4x4* a, const Float4x4* b, uint32_t bStride, uint32_t count, Float4x4* out)
+    {
+        if (count == 0)
+            return;
+
+        __m256 right[4];
+        for (uint32_t iRow = 0; iRow < 4; ++iRow)
+        {
+            __m128 row = _mm_loadu_ps(b[0].m[iRow]);
+            right[iRow] = _mm256_insertf128_ps(_mm256_castps128_ps256(row), row, 1);
+        }
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            if (bStride != 0 && i > 0)
+            {
+                for (uint32_t iRow = 0; iRow < 4; ++iRow)
+                {
+                    __m128 row = _mm_loadu_ps(b[i].m[iRow]);
+                    right[iRow] = _mm256_insertf128_ps(_mm256_castps128_ps256(row), row, 1);
+                }
+            }
+
+            __m256 left01 = _mm256_loadu_ps(a[i].m[0]);
+            __m256 left23 = _mm256_loadu_ps(a[i].m[2]);
+            __m256 result01 = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+                _mm256_mul_ps(_mm256_permute_ps(left01, _MM_SHUFFLE(0, 0, 0, 0)), right[0]),
+                _mm256_mul_ps(_mm256_permute_ps(left01, _MM_SHUFFLE(1, 1, 1, 1)), right[1])),
+                _mm256_mul_ps(_mm256_permute_ps(left01, _MM_SHUFFLE(2, 2, 2, 2)), right[2])),
+                _mm256_mul_ps(_mm256_permute_ps(left01, _MM_SHUFFLE(3, 3, 3, 3)), right[3]));
+            __m256 result23 = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+                _mm256_mul_ps(_mm256_permute_ps(left23, _MM_SHUFFLE(0, 0, 0, 0)), right[0]),
+                _mm256_mul_ps(_mm256_permute_ps(left23, _MM_SHUFFLE(1, 1, 1, 1)), right[1])),
+                _mm256_mul_ps(_mm256_permute_ps(left23, _MM_SHUFFLE(2, 2, 2, 2)), right[2])),
+                _mm256_mul_ps(_mm256_permute_ps(left23, _MM_SHUFFLE(3, 3, 3, 3)), right[3]));
+            _mm256_storeu_ps(out[i].m[0], result01);
+            _mm256_storeu_ps(out[i].m[2], result23);
+        }
+    }
+
+    /**
+     *  A whole matrix per register.\n
+     *  Broadcasts and permutes use the zero-masked forms with a full mask, which compile to the unmasked
+     *  instructions: GCC implements the unmasked intrinsics by merging into _mm512_undefined_ps and warns that
+     *  it may be used uninitialized.
+     */
+    ASTEROID_TARGET_AVX512
+    static void MultiplyMatricesAVX512(const Float4x4* a, const Float4x4* b, uint32_t bStride, uint32_t count, Float4x4* out)
+    {
+        if (count == 0)
+            return;
+
+        const __mmask16 kAllLanes = 0xFFFF;
+        __m512 right[4];
+        for (uint32_t iRow = 0; iRow < 4; ++iRow)
+            right[iRow] = _mm512_maskz_broadcast_f32x4(kAllLanes, _mm_loadu_ps(b[0].m[iRow]));
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            if (bStride != 0 && i > 0)
+            {
+                for (uint32_t iRow = 0; iRow < 4; ++iRow)
+                    right[iRow] = _mm512_maskz_broadcast_f32x4(kAllLanes, _mm_loadu_ps(b[i].m[iRow]));
+            }
+
+            __m512 left = _mm512_loadu_ps(a[i].m[0]);
+            __m512 result = _mm512_add_ps(_mm512_add_ps(_mm512_add_ps(
+                _mm512_mul_ps(_mm512_maskz_permute_ps(kAllLanes, left, _MM_SHUFFLE(0, 0, 0, 0)), right[0]),
+                _mm512_mul_ps(_mm512_maskz_permute_ps(kAllLanes, left, _MM_SHUFFLE(1, 1, 1, 1)), right[1])),
+                _mm512_mul_ps(_mm512_maskz_permute_ps(kAllLanes, left, _MM_SHUFFLE(2, 2, 2, 2)), right[2])),
+                _mm512_mul_ps(_mm512_maskz_permute_ps(kAllLanes, left, _MM_SHUFFLE(3, 3, 3, 3)), right[3]));
+            _mm512_storeu_ps(out[i].m[0], result);
+        }
+    }
+#endif
+
+    using MultiplyMatricesFunction = void(*)(const Float4x4* a, const Float4x4* b, uint32_t bStride, uint32_t count, Float4x4* out);
+#ifdef ASTEROID_BATCH_MATH_AVX
+    static SimdKernel<MultiplyMatricesFunction> MultiplyMatricesKernel("BatchMath.MultiplyMatrices",
+        MultiplyMatricesScalar, MultiplyMatricesVec4, MultiplyMatricesAVX2, MultiplyMatricesAVX512);
+#else
+    static SimdKernel<MultiplyMatricesFunction> MultiplyMatricesKernel("BatchMath.MultiplyMatrices",
+        MultiplyMatricesScalar, MultiplyMatricesVec4);
+#endif
+
+
+    void BatchMath::TransformPoints(const Float4x4& m, const float* x, const float* y, const float* z,
+        uint32_t count, float* outX, float* outY, float* outZ)
+    {
+        TransformPointsKernel(m, x, y, z, 0u, count, outX, outY, outZ);
+    }
+
+    void BatchMath::MultiplyMatrices(const Float4x4* a, const Float4x4* b, uint32_t count, Float4x4* out)
+    {
+        MultiplyMatricesKernel(a, b, 1u, count, out);
+    }
+
+    void BatchMath::MultiplyMatrices(const Float4x4* a, const Float4x4& b, uint32_t count, Float4x4* out)
+    {
+        MultiplyMatricesKernel(a, &b, 0u, count, out);
+    }
+}
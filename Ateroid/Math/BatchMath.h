@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Math/SimdMath.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  Math over arrays, for transform hierarchies, culling and physics.\n
+     *  Functions are SimdKernels dispatched to the best level the CPU supports. The SSE level is built on Vec4,
+     *  so it is also the NEON implementation on ARM. Every level computes the same operations in the same order
+     *  without fused multiply-adds, results are identical whichever implementation runs.
+     *  @remarks
+     *      Functions run on the calling thread, split large arrays with JobSystem::ParallelFor.
+     */
+    class BatchMath
+    {
+    public:
+        ASTEROID_NO_DEFAULT_CTOR(BatchMath)
+        ASTEROID_NON_COPYABLE(BatchMath)
+
+        /**
+         *  Transform points stored as separate x, y and z arrays by one matrix, w is taken as 1 and the
+         *  projection column is ignored.
+         *  @remarks
+         *      Outputs may be the input arrays. Arrays need no alignment.
+         */
+        static void TransformPoints(const Float4x4& m, const float* x, const float* y, const float* z,
+            uint32_t count, float* outX, float* outY, float* outZ);
+
+        /**
+         *  out[i] = a[i] * b[i] for count matrices, so out[i] applies a[i] first.
+         *  @remarks
+         *      out may be a or b.
+         */
+        static void MultiplyMatrices(const Float4x4* a, const Float4x4* b, uint32_t count, Float4x4* out);
+
+        /**
+         *  out[i] = a[i] * b for count matrices, e.g. local transforms of siblings by their parent.
+         *  @remarks
+         *      out may be a.
+         */
+        static void MultiplyMatrices(const Float4x4* a, const Float4x4& b, uint32_t count, Float4x4* out);
+    };
+}
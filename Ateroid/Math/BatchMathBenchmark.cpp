@@ -0,0 +1,129 @@
+#include "Precompile.h"
+#include "BatchMathBenchmark.h"
+#include "BatchMath.h"
+#include "Util/Debug.h"
+#include "Util/SimdDispatch.h"
+#include <random>
+
+namespace ASTEROID_NAMESPACE
+{
+    /** Coordinates of the points, and translations of the matrices. */
+    static const float kMaxCoordinate = 1000.0f;
+
+    typedef std::chrono::steady_clock BenchmarkClock;
+
+    static double ElapsedMilliseconds(BenchmarkClock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(BenchmarkClock::now() - start).count();
+    }
+
+    static Float4x4 RandomMatrix(std::mt19937& random)
+    {
+        std::uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+        Float4x4 m;
+        for (uint32_t iRow = 0; iRow < 3; ++iRow)
+        {
+            for (uint32_t iColumn = 0; iColumn < 3; ++iColumn)
+                m.m[iRow][iColumn] = uniform(random);
+            m.m[iRow][3] = 0.0f;
+        }
+        m._41 = uniform(random) * kMaxCoordinate;
+        m._42 = uniform(random) * kMaxCoordinate;
+        m._43 = uniform(random) * kMaxCoordinate;
+        m._44 = 1.0f;
+        return m;
+    }
+
+    /** Bitwise, so the sign of zeros and NaN payloads count too. */
+    static bool SameBits(const void* a, const void* b, size_t bytesCount)
+    {
+        return std::memcmp(a, b, bytesCount) == 0;
+    }
+
+    bool BatchMathBenchmark::Run(const BatchMathBenchmarkSettings& settings)
+    {
+        ASTEROID_LOG_INFO_F("Batch math benchmark: %u elements, %u iterations, SIMD levels up to %s.", settings.count,
+            settings.iterationsCount, SimdDispatch::LevelName(SimdDispatch::DetectedLevel()));
+
+        uint32_t count = settings.count;
+        std::mt19937 random(settings.seed);
+        std::uniform_real_distribution<float> uniform(-kMaxCoordinate, kMaxCoordinate);
+        Vector<float> x(count), y(count), z(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            x[i] = uniform(random);
+            y[i] = uniform(random);
+            z[i] = uniform(random);
+        }
+        Vector<Float4x4> a(count), b(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            a[i] = RandomMatrix(random);
+            b[i] = RandomMatrix(random);
+        }
+        Float4x4 transform = RandomMatrix(random);
+
+        Vector<float> outX(count), outY(count), outZ(count);
+        Vector<Float4x4> products(count), sharedProducts(count);
+        Vector<float> referenceX, referenceY, referenceZ;
+        Vector<Float4x4> referenceProducts, referenceSharedProducts;
+
+        bool isValid = true;
+        uint32_t iterationsCount = std::max(settings.iterationsCount, 1u);
+        ESimdLevel previousLevel = SimdDispatch::Level();
+        for (uint32_t iLevel = 0; iLevel <= (uint32_t)SimdDispatch::DetectedLevel(); ++iLevel)
+        {
+            ESimdLevel level = (ESimdLevel)iLevel;
+            SimdDispatch::SetLevel(level);
+
+            BenchmarkClock::time_point start = BenchmarkClock::now();
+            for (uint32_t iIteration = 0; iIteration < iterationsCount; ++iIteration)
+                BatchMath::TransformPoints(transform, x.data(), y.data(), z.data(), count, outX.data(), outY.data(), outZ.data());
+            double transformTime = ElapsedMilliseconds(start) / iterationsCount;
+
+            start = BenchmarkClock::now();
+            for (uint32_t iIteration = 0; iIteration < iterationsCount; ++iIteration)
+                BatchMath::MultiplyMatrices(a.data(), b.data(), count, products.data());
+            double multiplyTime = ElapsedMilliseconds(start) / iterationsCount;
+
+            start = BenchmarkClock::now();
+            for (uint32_t iIteration = 0; iIteration < iterationsCount; ++iIteration)
+                BatchMath::MultiplyMatrices(a.data(), transform, count, sharedProducts.data());
+            double sharedMultiplyTime = ElapsedMilliseconds(start) / iterationsCount;
+
+            ASTEROID_LOG_INFO_F("    %-6s: transform points %8.3f ms, multiply matrices %8.3f ms, multiply by one matrix %8.3f ms",
+                SimdDispatch::LevelName(level), transformTime, multiplyTime, sharedMultiplyTime);
+
+            if (level == ESimdLevel::eScalar)
+            {
+                referenceX = outX;
+                referenceY = outY;
+                referenceZ = outZ;
+                referenceProducts = products;
+                referenceSharedProducts = sharedProducts;
+                continue;
+            }
+
+            if (!SameBits(outX.data(), referenceX.data(), count * sizeof(float)) ||
+                !SameBits(outY.data(), referenceY.data(), count * sizeof(float)) ||
+                !SameBits(outZ.data(), referenceZ.data(), count * sizeof(float)))
+            {
+                ASTEROID_LOG_ERROR_F("BatchMath::TransformPoints at level %s differs from scalar.", SimdDispatch::LevelName(level));
+                isValid = false;
+            }
+            if (!SameBits(products.data(), referenceProducts.data(), count * sizeof(Float4x4)))
+            {
+                ASTEROID_LOG_ERROR_F("BatchMath::MultiplyMatrices at level %s differs from scalar.", SimdDispatch::LevelName(level));
+                isValid = false;
+            }
+            if (!SameBits(sharedProducts.data(), referenceSharedProducts.data(), count * sizeof(Float4x4)))
+            {
+                ASTEROID_LOG_ERROR_F("BatchMath::MultiplyMatrices by one matrix at level %s differs from scalar.",
+                    SimdDispatch::LevelName(level));
+                isValid = false;
+            }
+        }
+        SimdDispatch::SetLevel(previousLevel);
+        return isValid;
+    }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+namespace ASTEROID_NAMESPACE
+{
+    struct BatchMathBenchmarkSettings
+    {
+        /** Points transformed and matrices multiplied per call. */
+        uint32_t    count;
+        /** Calls timed for each function and level. */
+        uint32_t    iterationsCount;
+        uint32_t    seed;
+    };
+
+
+    /**
+     *  Times the BatchMath functions at every SIMD level the CPU supports, from scalar up, on random points and
+     *  matrices. The scalar level is the reference: every other level must produce the same bits.
+     *  @remarks
+     *      Dispatches every kernel with SimdDispatch::SetLevel, so no kernel may run on other threads meanwhile.
+     *      The level in use before is restored.
+     */
+    class BatchMathBenchmark
+    {
+    public:
+        ASTEROID_NO_DEFAULT_CTOR(BatchMathBenchmark)
+        ASTEROID_NON_COPYABLE(BatchMathBenchmark)
+
+        /**
+         *  @return
+         *      False if a level did not match the scalar results.
+         */
+        static bool Run(const BatchMathBenchmarkSettings& settings);
+    };
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  A signed Q16.16 fixed-point number, 16 integer bits and 16 fraction bits in an int32_t.\n
+     *  Every operation is integer arithmetic, so results are the same bits on every compiler and processor,
+     *  which floats only guarantee when the code and the compiler flags are written for it. Values range
+     *  from -32768 to 32768 with a resolution of 1/65536.
+     *  @remarks
+     *      Additions and subtractions wrap around on overflow, multiplications round toward minus infinity
+     *      and divisions toward zero. Dividing by zero is undefined, as for integers. FromFloat saturates
+     *      instead of wrapping, so far away floats stay far away.
+     */
+    class Fixed
+    {
+    public:
+        static const int32_t kFractionBits = 16;
+        static const int32_t kOne = 1 << kFractionBits;
+
+    public:
+        constexpr Fixed() : m_Raw(0) {}
+
+        static constexpr Fixed FromRaw(int32_t raw) { Fixed value; value.m_Raw = raw; return value; }
+        static constexpr Fixed FromInt(int32_t value) { return FromRaw((int32_t)((uint32_t)value << kFractionBits)); }
+        /** Nearest fixed-point value, ties away from zero. NaNs are zero. */
+        static Fixed FromFloat(float value)
+        {
+            // Scaling by a power of two is exact, and so is adding a half in double, the truncation rounds
+            float scaled = value * (float)kOne;
+            if (scaled != scaled)
+                return Fixed();
+            if (scaled >= 2147483648.0f)
+                return FromRaw(INT32_MAX);
+            if (scaled <= -2147483648.0f)
+                return FromRaw(INT32_MIN);
+            return FromRaw((int32_t)((double)scaled + std::copysign(0.5, (double)scaled)));
+        }
+
+        constexpr int32_t Raw() const { return m_Raw; }
+        /** Exact for values below 256, rounded to the nearest float above. */
+        float ToFloat() const { return (float)m_Raw * (1.0f / (float)kOne); }
+        /** Rounded toward minus infinity. */
+        constexpr int32_t ToInt() const { return m_Raw >> kFractionBits; }
+
+        constexpr Fixed operator-() const { return FromRaw((int32_t)(0u - (uint32_t)m_Raw)); }
+        constexpr Fixed operator+(Fixed other) const { return FromRaw((int32_t)((uint32_t)m_Raw + (uint32_t)other.m_Raw)); }
+        constexpr Fixed operator-(Fixed other) const { return FromRaw((int32_t)((uint32_t)m_Raw - (uint32_t)other.m_Raw)); }
+        constexpr Fixed operator*(Fixed other) const { return FromRaw((int32_t)(((int64_t)m_Raw * other.m_Raw) >> kFractionBits)); }
+        constexpr Fixed operator/(Fixed other) const { return FromRaw((int32_t)((int64_t)m_Raw * kOne / other.m_Raw)); }
+        Fixed& operator+=(Fixed other) { return *this = *this + other; }
+        Fixed& operator-=(Fixed other) { return *this = *this - other; }
+        Fixed& operator*=(Fixed other) { return *this = *this * other; }
+        Fixed& operator/=(Fixed other) { return *this = *this / other; }
+
+        constexpr bool operator==(Fixed other) const { return m_Raw == other.m_Raw; }
+        constexpr bool operator!=(Fixed other) const { return m_Raw != other.m_Raw; }
+        constexpr bool operator<(Fixed other) const { return m_Raw < other.m_Raw; }
+        constexpr bool operator<=(Fixed other) const { return m_Raw <= other.m_Raw; }
+        constexpr bool operator>(Fixed other) const { return m_Raw > other.m_Raw; }
+        constexpr bool operator>=(Fixed other) const { return m_Raw >= other.m_Raw; }
+
+        static constexpr Fixed Abs(Fixed value) { return value.m_Raw < 0 ? -value : value; }
+        static constexpr Fixed Min(Fixed a, Fixed b) { return a.m_Raw < b.m_Raw ? a : b; }
+        static constexpr Fixed Max(Fixed a, Fixed b) { return a.m_Raw < b.m_Raw ? b : a; }
+
+        /** Rounded toward zero, negative values are zero. */
+        static Fixed Sqrt(Fixed value)
+        {
+            if (value.m_Raw <= 0)
+                return Fixed();
+
+            // Digit by digit square root of the raw value scaled by one more kOne, one result bit per pass
+            uint64_t remainder = (uint64_t)value.m_Raw << kFractionBits;
+            uint64_t root = 0;
+            for (uint64_t bit = 1ull << 46; bit != 0; bit >>= 2)
+            {
+                if (remainder >= root + bit)
+                {
+                    remainder -= root + bit;
+                    root = (root >> 1) + bit;
+                }
+                else
+                {
+                    root >>= 1;
+                }
+            }
+            return FromRaw((int32_t)root);
+        }
+
+    private:
+        int32_t m_Raw;
+    };
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  Storage types of the math module, plain floats without alignment requirements.\n
+     *  Memory layouts match the corresponding HLSL types, so they can be copied into constant buffers as is.
+     *  Computations load them into the SIMD types of Math/SimdMath.h.
+     */
+    struct Float2
+    {
+        float x;
+        float y;
+
+        Float2() = default;
+        constexpr Float2(float x, float y) : x(x), y(y) {}
+    };
+
+    struct Float3
+    {
+        float x;
+        float y;
+        float z;
+
+        Float3() = default;
+        constexpr Float3(float x, float y, float z) : x(x), y(y), z(z) {}
+    };
+
+    struct Float4
+    {
+        float x;
+        float y;
+        float z;
+        float w;
+
+        Float4() = default;
+        constexpr Float4(float x, float y, float z, float w) : x(x), y(y), z(z), w(w) {}
+    };
+
+    /**
+     *  A row major 4x4 matrix. Points are row vectors transformed as p * M, so translation is in the last row.
+     */
+    struct Float4x4
+    {
+        union
+        {
+            struct
+            {
+                float _11, _12, _13, _14;
+                float _21, _22, _23, _24;
+                float _31, _32, _33, _34;
+                float _41, _42, _43, _44;
+            };
+            float m[4][4];
+        };
+
+        Float4x4() = default;
+        constexpr Float4x4(float m00, float m01, float m02, float m03,
+                           float m10, float m11, float m12, float m13,
+                           float m20, float m21, float m22, float m23,
+                           float m30, float m31, float m32, float m33)
+            : _11(m00), _12(m01), _13(m02), _14(m03),
+              _21(m10), _22(m11), _23(m12), _24(m13),
+              _31(m20), _32(m21), _33(m22), _34(m23),
+              _41(m30), _42(m31), _43(m32), _44(m33)
+        {
+        }
+
+        float  operator()(uint32_t row, uint32_t column) const { return m[row][column]; }
+        float& operator()(uint32_t row, uint32_t column) { return m[row][column]; }
+    };
+}
@@ -0,0 +1,536 @@
+#pragma once
+
+#include "Math/MathTypes.h"
+
+/**
+ *  The backend is selected at compile time: SSE2 on x86, NEON on ARM64 and plain floats everywhere else.
+ *  Define ASTEROID_MATH_FORCE_SCALAR to build the scalar backend on any platform, e.g. to compare results.\n
+ *  Wider instruction sets are used by the batch functions of Math/BatchMath.h, dispatched at runtime.
+ */
+#if defined(ASTEROID_MATH_FORCE_SCALAR)
+    #define ASTEROID_MATH_SCALAR
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    #define ASTEROID_MATH_SSE
+    #include <emmintrin.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+    #define ASTEROID_MATH_NEON
+    #include <arm_neon.h>
+#else
+    #define ASTEROID_MATH_SCALAR
+#endif
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  Four floats in a SIMD register. Lanes are named x, y, z and w.
+     *  @remarks
+     *      3D operations ignore w. Loaded points have w = 1 and directions w = 0.
+     */
+    struct alignas(16) Vec4
+    {
+#if defined(ASTEROID_MATH_SSE)
+        __m128      v;
+#elif defined(ASTEROID_MATH_NEON)
+        float32x4_t v;
+#else
+        float       v[4];
+#endif
+
+        static Vec4 Zero() { return Splat(0.0f); }
+        static Vec4 Splat(float value);
+        static Vec4 Set(float x, float y, float z, float w);
+
+        static Vec4 Load(const float* values);
+        static Vec4 Load(const Float4& value) { return Load(&value.x); }
+        static Vec4 Load(const Float3& value, float w) { return Set(value.x, value.y, value.z, w); }
+        void Store(float* values) const;
+        void Store(Float4& value) const { Store(&value.x); }
+        void Store(Float3& value) const;
+
+        float X() const;
+        float Y() const;
+        float Z() const;
+        float W() const;
+
+        /** A vector with every lane set to one lane of this one. */
+        Vec4 SplatX() const;
+        Vec4 SplatY() const;
+        Vec4 SplatZ() const;
+        Vec4 SplatW() const;
+
+        static Vec4 Min(const Vec4& a, const Vec4& b);
+        static Vec4 Max(const Vec4& a, const Vec4& b);
+        static Vec4 Abs(const Vec4& a);
+        static Vec4 Sqrt(const Vec4& a);
+        /** a * b + c, not fused so results match between backends. */
+        static Vec4 MultiplyAdd(const Vec4& a, const Vec4& b, const Vec4& c);
+        static Vec4 Lerp(const Vec4& a, const Vec4& b, float t);
+        /** Bit i is set when lane i of a <= lane i of b, false for NaNs. */
+        static uint32_t LessEqualMask(const Vec4& a, const Vec4& b);
+
+        static float Dot3(const Vec4& a, const Vec4& b);
+        static float Dot4(const Vec4& a, const Vec4& b);
+        /** The cross product of the xyz parts, w is 0. */
+        static Vec4 Cross3(const Vec4& a, const Vec4& b);
+        static float Length3(const Vec4& a) { return std::sqrt(Dot3(a, a)); }
+        /** @return The xyz part scaled to unit length, or a unchanged if its length is 0. */
+        static Vec4 Normalize3(const Vec4& a);
+    };
+
+    inline Vec4 operator+(const Vec4& a, const Vec4& b);
+    inline Vec4 operator-(const Vec4& a, const Vec4& b);
+    inline Vec4 operator*(const Vec4& a, const Vec4& b);
+    inline Vec4 operator/(const Vec4& a, const Vec4& b);
+    inline Vec4 operator-(const Vec4& a);
+    inline Vec4 operator*(const Vec4& a, float b) { return a * Vec4::Splat(b); }
+    inline Vec4 operator*(float a, const Vec4& b) { return Vec4::Splat(a) * b; }
+    inline Vec4& operator+=(Vec4& a, const Vec4& b) { return a = a + b; }
+    inline Vec4& operator-=(Vec4& a, const Vec4& b) { return a = a - b; }
+    inline Vec4& operator*=(Vec4& a, const Vec4& b) { return a = a * b; }
+
+
+    /**
+     *  A unit quaternion rotation stored as (x, y, z, w) with w the scalar part.
+     */
+    struct alignas(16) Quat
+    {
+        Vec4 v;
+
+        static Quat Identity() { return { Vec4::Set(0.0f, 0.0f, 0.0f, 1.0f) }; }
+        /** @param axis Unit rotation axis. @param angle Radians, a positive angle around +z turns +x toward +y. */
+        static Quat FromAxisAngle(const Vec4& axis, float angle);
+        static Quat Load(const Float4& value) { return { Vec4::Load(value) }; }
+        void Store(Float4& value) const { v.Store(value); }
+
+        /** @return The rotation a followed by b, matching Mat4::Multiply(a, b) of their matrices. */
+        static Quat Multiply(const Quat& a, const Quat& b);
+        static Quat Conjugate(const Quat& q);
+        static Quat Normalize(const Quat& q);
+        /** Rotate the xyz part of a vector, w is 0. */
+        static Vec4 Rotate(const Vec4& vector, const Quat& q);
+        /** Interpolate along the shortest arc with constant angular velocity. */
+        static Quat Slerp(const Quat& a, const Quat& b, float t);
+    };
+
+
+    /**
+     *  A row major 4x4 matrix in registers, the SIMD counterpart of Float4x4.\n
+     *  Vectors are rows transformed as v * M, so Multiply(a, b) applies a first and then b.
+     */
+    struct alignas(16) Mat4
+    {
+        Vec4 r[4];
+
+        static Mat4 Identity();
+        static Mat4 Load(const Float4x4& value);
+        void Store(Float4x4& value) const;
+
+        static Mat4 Multiply(const Mat4& a, const Mat4& b);
+        static Mat4 Transpose(const Mat4& m);
+        /** @return The inverse, not finite if the determinant is 0. */
+        static Mat4 Inverse(const Mat4& m);
+
+        static Mat4 Translation(float x, float y, float z);
+        static Mat4 Scaling(float x, float y, float z);
+        static Mat4 Rotation(const Quat& q);
+        /** Scale, then rotate, then translate. Only the xyz parts of scale and translation are used. */
+        static Mat4 Affine(const Vec4& scale, const Quat& rotation, const Vec4& translation);
+        /** A left-handed view matrix looking from eye at target. */
+        static Mat4 LookAtLH(const Vec4& eye, const Vec4& target, const Vec4& up);
+        /** A left-handed projection to D3D clip space with depth in [0, 1]. */
+        static Mat4 PerspectiveFovLH(float fovY, float aspectRatio, float nearZ, float farZ);
+
+        /** Transform a point, w of the input is taken as 1. */
+        static Vec4 TransformPoint(const Vec4& point, const Mat4& m);
+        /** Transform a direction, translation is ignored. */
+        static Vec4 TransformVector(const Vec4& vector, const Mat4& m);
+        /** Transform all four components. */
+        static Vec4 Transform(const Vec4& vector, const Mat4& m);
+    };
+
+    inline Mat4 operator*(const Mat4& a, const Mat4& b) { return Mat4::Multiply(a, b); }
+
+
+#if defined(ASTEROID_MATH_SSE)
+    inline Vec4 Vec4::Splat(float value) { return { _mm_set1_ps(value) }; }
+    inline Vec4 Vec4::Set(float x, float y, float z, float w) { return { _mm_setr_ps(x, y, z, w) }; }
+    inline Vec4 Vec4::Load(const float* values) { return { _mm_loadu_ps(values) }; }
+    inline void Vec4::Store(float* values) const { _mm_storeu_ps(values, v); }
+
+    inline float Vec4::X() const { return _mm_cvtss_f32(v); }
+    inline float Vec4::Y() const { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))); }
+    inline float Vec4::Z() const { return _mm_cvtss_f32(_mm_movehl_ps(v, v)); }
+    inline float Vec4::W() const { return _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))); }
+
+    inline Vec4 Vec4::SplatX() const { return { _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)) }; }
+    inline Vec4 Vec4::SplatY() const { return { _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)) }; }
+    inline Vec4 Vec4::SplatZ() const { return { _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2)) }; }
+    inline Vec4 Vec4::SplatW() const { return { _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)) }; }
+
+    inline Vec4 operator+(const Vec4& a, const Vec4& b) { return { _mm_add_ps(a.v, b.v) }; }
+    inline Vec4 operator-(const Vec4& a, const Vec4& b) { return { _mm_sub_ps(a.v, b.v) }; }
+    inline Vec4 operator*(const Vec4& a, const Vec4& b) { return { _mm_mul_ps(a.v, b.v) }; }
+    inline Vec4 operator/(const Vec4& a, const Vec4& b) { return { _mm_div_ps(a.v, b.v) }; }
+    inline Vec4 operator-(const Vec4& a) { return { _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)) }; }
+
+    inline Vec4 Vec4::Min(const Vec4& a, const Vec4& b) { return { _mm_min_ps(a.v, b.v) }; }
+    inline Vec4 Vec4::Max(const Vec4& a, const Vec4& b) { return { _mm_max_ps(a.v, b.v) }; }
+    inline Vec4 Vec4::Abs(const Vec4& a) { return { _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v) }; }
+    inline Vec4 Vec4::Sqrt(const Vec4& a) { return { _mm_sqrt_ps(a.v) }; }
+    inline uint32_t Vec4::LessEqualMask(const Vec4& a, const Vec4& b) { return (uint32_t)_mm_movemask_ps(_mm_cmple_ps(a.v, b.v)); }
+
+    inline float Vec4::Dot3(const Vec4& a, const Vec4& b)
+    {
+        __m128 product = _mm_mul_ps(a.v, b.v);
+        __m128 sum = _mm_add_ss(product, _mm_shuffle_ps(product, product, _MM_SHUFFLE(1, 1, 1, 1)));
+        return _mm_cvtss_f32(_mm_add_ss(sum, _mm_movehl_ps(product, product)));
+    }
+
+    inline float Vec4::Dot4(const Vec4& a, const Vec4& b)
+    {
+        __m128 product = _mm_mul_ps(a.v, b.v);
+        __m128 sum = _mm_add_ps(product, _mm_shuffle_ps(product, product, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtss_f32(_mm_add_ss(sum, _mm_movehl_ps(sum, sum)));
+    }
+
+    inline Vec4 Vec4::Cross3(const Vec4& a, const Vec4& b)
+    {
+        __m128 aYZX = _mm_shuffle_ps(a.v, a.v, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 bYZX = _mm_shuffle_ps(b.v, b.v, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 cross = _mm_sub_ps(_mm_mul_ps(a.v, bYZX), _mm_mul_ps(aYZX, b.v));
+        cross = _mm_shuffle_ps(cross, cross, _MM_SHUFFLE(3, 0, 2, 1));
+        // w is a.w * b.w - a.w * b.w, which is not 0 for infinities
+        return { _mm_and_ps(cross, _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0))) };
+    }
+
+    inline Mat4 Mat4::Transpose(const Mat4& m)
+    {
+        Mat4 result = m;
+        _MM_TRANSPOSE4_PS(result.r[0].v, result.r[1].v, result.r[2].v, result.r[3].v);
+        return result;
+    }
+#elif defined(ASTEROID_MATH_NEON)
+    inline Vec4 Vec4::Splat(float value) { return { vdupq_n_f32(value) }; }
+    inline Vec4 Vec4::Set(float x, float y, float z, float w) { float values[4] = { x, y, z, w }; return { vld1q_f32(values) }; }
+    inline Vec4 Vec4::Load(const float* values) { return { vld1q_f32(values) }; }
+    inline void Vec4::Store(float* values) const { vst1q_f32(values, v); }
+
+    inline float Vec4::X() const { return vgetq_lane_f32(v, 0); }
+    inline float Vec4::Y() const { return vgetq_lane_f32(v, 1); }
+    inline float Vec4::Z() const { return vgetq_lane_f32(v, 2); }
+    inline float Vec4::W() const { return vgetq_lane_f32(v, 3); }
+
+    inline Vec4 Vec4::SplatX() const { return { vdupq_laneq_f32(v, 0) }; }
+    inline Vec4 Vec4::SplatY() const { return { vdupq_laneq_f32(v, 1) }; }
+    inline Vec4 Vec4::SplatZ() const { return { vdupq_laneq_f32(v, 2) }; }
+    inline Vec4 Vec4::SplatW() const { return { vdupq_laneq_f32(v, 3) }; }
+
+    inline Vec4 operator+(const Vec4& a, const Vec4& b) { return { vaddq_f32(a.v, b.v) }; }
+    inline Vec4 operator-(const Vec4& a, const Vec4& b) { return { vsubq_f32(a.v, b.v) }; }
+    inline Vec4 operator*(const Vec4& a, const Vec4& b) { return { vmulq_f32(a.v, b.v) }; }
+    inline Vec4 operator/(const Vec4& a, const Vec4& b) { return { vdivq_f32(a.v, b.v) }; }
+    inline Vec4 operator-(const Vec4& a) { return { vnegq_f32(a.v) }; }
+
+    inline Vec4 Vec4::Min(const Vec4& a, const Vec4& b) { return { vminq_f32(a.v, b.v) }; }
+    inline Vec4 Vec4::Max(const Vec4& a, const Vec4& b) { return { vmaxq_f32(a.v, b.v) }; }
+    inline Vec4 Vec4::Abs(const Vec4& a) { return { vabsq_f32(a.v) }; }
+    inline Vec4 Vec4::Sqrt(const Vec4& a) { return { vsqrtq_f32(a.v) }; }
+
+    inline uint32_t Vec4::LessEqualMask(const Vec4& a, const Vec4& b)
+    {
+        const uint32_t laneBits[4] = { 1, 2, 4, 8 };
+        return vaddvq_u32(vandq_u32(vcleq_f32(a.v, b.v), vld1q_u32(laneBits)));
+    }
+
+    inline float Vec4::Dot3(const Vec4& a, const Vec4& b) { return vaddvq_f32(vsetq_lane_f32(0.0f, vmulq_f32(a.v, b.v), 3)); }
+    inline float Vec4::Dot4(const Vec4& a, const Vec4& b) { return vaddvq_f32(vmulq_f32(a.v, b.v)); }
+
+    inline Vec4 Vec4::Cross3(const Vec4& a, const Vec4& b)
+    {
+        return Set(a.Y() * b.Z() - a.Z() * b.Y(), a.Z() * b.X() - a.X() * b.Z(), a.X() * b.Y() - a.Y() * b.X(), 0.0f);
+    }
+
+    inline Mat4 Mat4::Transpose(const Mat4& m)
+    {
+        float32x4_t xz0 = vzip1q_f32(m.r[0].v, m.r[2].v);
+        float32x4_t xz1 = vzip2q_f32(m.r[0].v, m.r[2].v);
+        float32x4_t yw0 = vzip1q_f32(m.r[1].v, m.r[3].v);
+        float32x4_t yw1 = vzip2q_f32(m.r[1].v, m.r[3].v);
+        return { { { vzip1q_f32(xz0, yw0) }, { vzip2q_f32(xz0, yw0) }, { vzip1q_f32(xz1, yw1) }, { vzip2q_f32(xz1, yw1) } } };
+    }
+#else
+    inline Vec4 Vec4::Splat(float value) { return { { value, value, value, value } }; }
+    inline Vec4 Vec4::Set(float x, float y, float z, float w) { return { { x, y, z, w } }; }
+    inline Vec4 Vec4::Load(const float* values) { return { { values[0], values[1], values[2], values[3] } }; }
+    inline void Vec4::Store(float* values) const { std::memcpy(values, v, sizeof(v)); }
+
+    inline float Vec4::X() const { return v[0]; }
+    inline float Vec4::Y() const { return v[1]; }
+    inline float Vec4::Z() const { return v[2]; }
+    inline float Vec4::W() const { return v[3]; }
+
+    inline Vec4 Vec4::SplatX() const { return Splat(v[0]); }
+    inline Vec4 Vec4::SplatY() const { return Splat(v[1]); }
+    inline Vec4 Vec4::SplatZ() const { return Splat(v[2]); }
+    inline Vec4 Vec4::SplatW() const { return Splat(v[3]); }
+
+    inline Vec4 operator+(const Vec4& a, const Vec4& b) { return { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } }; }
+    inline Vec4 operator-(const Vec4& a, const Vec4& b) { return { { a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3] } }; }
+    inline Vec4 operator*(const Vec4& a, const Vec4& b) { return { { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } }; }
+    inline Vec4 operator/(const Vec4& a, const Vec4& b) { return { { a.v[0] / b.v[0], a.v[1] / b.v[1], a.v[2] / b.v[2], a.v[3] / b.v[3] } }; }
+    inline Vec4 operator-(const Vec4& a) { return { { -a.v[0], -a.v[1], -a.v[2], -a.v[3] } }; }
+
+    inline Vec4 Vec4::Min(const Vec4& a, const Vec4& b)
+    {
+        return { { std::min(a.v[0], b.v[0]), std::min(a.v[1], b.v[1]), std::min(a.v[2], b.v[2]), std::min(a.v[3], b.v[3]) } };
+    }
+
+    inline Vec4 Vec4::Max(const Vec4& a, const Vec4& b)
+    {
+        return { { std::max(a.v[0], b.v[0]), std::max(a.v[1], b.v[1]), std::max(a.v[2], b.v[2]), std::max(a.v[3], b.v[3]) } };
+    }
+
+    inline Vec4 Vec4::Abs(const Vec4& a) { return { { std::abs(a.v[0]), std::abs(a.v[1]), std::abs(a.v[2]), std::abs(a.v[3]) } }; }
+    inline Vec4 Vec4::Sqrt(const Vec4& a) { return { { std::sqrt(a.v[0]), std::sqrt(a.v[1]), std::sqrt(a.v[2]), std::sqrt(a.v[3]) } }; }
+
+    inline uint32_t Vec4::LessEqualMask(const Vec4& a, const Vec4& b)
+    {
+        return (a.v[0] <= b.v[0] ? 1u : 0u) | (a.v[1] <= b.v[1] ? 2u : 0u) | (a.v[2] <= b.v[2] ? 4u : 0u) | (a.v[3] <= b.v[3] ? 8u : 0u);
+    }
+
+    inline float Vec4::Dot3(const Vec4& a, const Vec4& b) { return a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2]; }
+    inline float Vec4::Dot4(const Vec4& a, const Vec4& b) { return (a.v[0] * b.v[0] + a.v[1] * b.v[1]) + (a.v[2] * b.v[2] + a.v[3] * b.v[3]); }
+
+    inline Vec4 Vec4::Cross3(const Vec4& a, const Vec4& b)
+    {
+        return { { a.v[1] * b.v[2] - a.v[2] * b.v[1], a.v[2] * b.v[0] - a.v[0] * b.v[2], a.v[0] * b.v[1] - a.v[1] * b.v[0], 0.0f } };
+    }
+
+    inline Mat4 Mat4::Transpose(const Mat4& m)
+    {
+        Mat4 result;
+        for (uint32_t iRow = 0; iRow < 4; ++iRow)
+        {
+            for (uint32_t iColumn = 0; iColumn < 4; ++iColumn)
+                result.r[iRow].v[iColumn] = m.r[iColumn].v[iRow];
+        }
+        return result;
+    }
+#endif
+
+
+    inline void Vec4::Store(Float3& value) const
+    {
+        float values[4];
+        Store(values);
+        value = Float3(values[0], values[1], values[2]);
+    }
+
+    inline Vec4 Vec4::MultiplyAdd(const Vec4& a, const Vec4& b, const Vec4& c) { return a * b + c; }
+    inline Vec4 Vec4::Lerp(const Vec4& a, const Vec4& b, float t) { return MultiplyAdd(b - a, Splat(t), a); }
+
+    inline Vec4 Vec4::Normalize3(const Vec4& a)
+    {
+        float length = Length3(a);
+        return length > 0.0f ? a * (1.0f / length) : a;
+    }
+
+
+    inline Quat Quat::FromAxisAngle(const Vec4& axis, float angle)
+    {
+        float halfAngle = 0.5f * angle;
+        Vec4 xyz = axis * std::sin(halfAngle);
+        return { Vec4::Set(xyz.X(), xyz.Y(), xyz.Z(), std::cos(halfAngle)) };
+    }
+
+    inline Quat Quat::Multiply(const Quat& a, const Quat& b)
+    {
+        // Hamilton product b * a, vectors are rotated as q * v * q^-1
+        float ax = a.v.X(), ay = a.v.Y(), az = a.v.Z(), aw = a.v.W();
+        float bx = b.v.X(), by = b.v.Y(), bz = b.v.Z(), bw = b.v.W();
+        return { Vec4::Set(bw * ax + bx * aw + by * az - bz * ay,
+                           bw * ay - bx * az + by * aw + bz * ax,
+                           bw * az + bx * ay - by * ax + bz * aw,
+                           bw * aw - bx * ax - by * ay - bz * az) };
+    }
+
+    inline Quat Quat::Conjugate(const Quat& q)
+    {
+        return { q.v * Vec4::Set(-1.0f, -1.0f, -1.0f, 1.0f) };
+    }
+
+    inline Quat Quat::Normalize(const Quat& q)
+    {
+        float lengthSquared = Vec4::Dot4(q.v, q.v);
+        return lengthSquared > 0.0f ? Quat{ q.v * (1.0f / std::sqrt(lengthSquared)) } : Identity();
+    }
+
+    inline Vec4 Quat::Rotate(const Vec4& vector, const Quat& q)
+    {
+        // v + w * t + u x t with t = 2 * u x v, u the vector part
+        Vec4 t = Vec4::Cross3(q.v, vector) * 2.0f;
+        Vec4 rotated = vector + q.v.SplatW() * t + Vec4::Cross3(q.v, t);
+        return rotated * Vec4::Set(1.0f, 1.0f, 1.0f, 0.0f);
+    }
+
+    inline Quat Quat::Slerp(const Quat& a, const Quat& b, float t)
+    {
+        float cosAngle = Vec4::Dot4(a.v, b.v);
+        Vec4 target = b.v;
+        if (cosAngle < 0.0f)
+        {
+            cosAngle = -cosAngle;
+            target = -target;
+        }
+
+        // Close rotations divide by a tiny sine, interpolate linearly instead
+        float weightA = 1.0f - t;
+        float weightB = t;
+        if (cosAngle < 0.9995f)
+        {
+            float angle = std::acos(cosAngle);
+            float inverseSin = 1.0f / std::sin(angle);
+            weightA = std::sin(weightA * angle) * inverseSin;
+            weightB = std::sin(weightB * angle) * inverseSin;
+        }
+        return Normalize({ a.v * weightA + target * weightB });
+    }
+
+
+    inline Mat4 Mat4::Identity()
+    {
+        return { { Vec4::Set(1.0f, 0.0f, 0.0f, 0.0f), Vec4::Set(0.0f, 1.0f, 0.0f, 0.0f),
+                   Vec4::Set(0.0f, 0.0f, 1.0f, 0.0f), Vec4::Set(0.0f, 0.0f, 0.0f, 1.0f) } };
+    }
+
+    inline Mat4 Mat4::Load(const Float4x4& value)
+    {
+        return { { Vec4::Load(value.m[0]), Vec4::Load(value.m[1]), Vec4::Load(value.m[2]), Vec4::Load(value.m[3]) } };
+    }
+
+    inline void Mat4::Store(Float4x4& value) const
+    {
+        for (uint32_t iRow = 0; iRow < 4; ++iRow)
+            r[iRow].Store(value.m[iRow]);
+    }
+
+    inline Vec4 Mat4::Transform(const Vec4& vector, const Mat4& m)
+    {
+        Vec4 result = vector.SplatX() * m.r[0];
+        result = Vec4::MultiplyAdd(vector.SplatY(), m.r[1], result);
+        result = Vec4::MultiplyAdd(vector.SplatZ(), m.r[2], result);
+        return Vec4::MultiplyAdd(vector.SplatW(), m.r[3], result);
+    }
+
+    inline Vec4 Mat4::TransformPoint(const Vec4& point, const Mat4& m)
+    {
+        Vec4 result = Vec4::MultiplyAdd(point.SplatX(), m.r[0], m.r[3]);
+        result = Vec4::MultiplyAdd(point.SplatY(), m.r[1], result);
+        return Vec4::MultiplyAdd(point.SplatZ(), m.r[2], result);
+    }
+
+    inline Vec4 Mat4::TransformVector(const Vec4& vector, const Mat4& m)
+    {
+        Vec4 result = vector.SplatX() * m.r[0];
+        result = Vec4::MultiplyAdd(vector.SplatY(), m.r[1], result);
+        return Vec4::MultiplyAdd(vector.SplatZ(), m.r[2], result);
+    }
+
+    inline Mat4 Mat4::Multiply(const Mat4& a, const Mat4& b)
+    {
+        return { { Transform(a.r[0], b), Transform(a.r[1], b), Transform(a.r[2], b), Transform(a.r[3], b) } };
+    }
+
+    inline Mat4 Mat4::Translation(float x, float y, float z)
+    {
+        Mat4 result = Identity();
+        result.r[3] = Vec4::Set(x, y, z, 1.0f);
+        return result;
+    }
+
+    inline Mat4 Mat4::Scaling(float x, float y, float z)
+    {
+        return { { Vec4::Set(x, 0.0f, 0.0f, 0.0f), Vec4::Set(0.0f, y, 0.0f, 0.0f),
+                   Vec4::Set(0.0f, 0.0f, z, 0.0f), Vec4::Set(0.0f, 0.0f, 0.0f, 1.0f) } };
+    }
+
+    inline Mat4 Mat4::Rotation(const Quat& q)
+    {
+        float x = q.v.X(), y = q.v.Y(), z = q.v.Z(), w = q.v.W();
+        float xx = x * x, yy = y * y, zz = z * z;
+        float xy = x * y, xz = x * z, yz = y * z;
+        float xw = x * w, yw = y * w, zw = z * w;
+        return { { Vec4::Set(1.0f - 2.0f * (yy + zz), 2.0f * (xy + zw), 2.0f * (xz - yw), 0.0f),
+                   Vec4::Set(2.0f * (xy - zw), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + xw), 0.0f),
+                   Vec4::Set(2.0f * (xz + yw), 2.0f * (yz - xw), 1.0f - 2.0f * (xx + yy), 0.0f),
+                   Vec4::Set(0.0f, 0.0f, 0.0f, 1.0f) } };
+    }
+
+    inline Mat4 Mat4::Affine(const Vec4& scale, const Quat& rotation, const Vec4& translation)
+    {
+        Mat4 result = Rotation(rotation);
+        result.r[0] = result.r[0] * scale.SplatX();
+        result.r[1] = result.r[1] * scale.SplatY();
+        result.r[2] = result.r[2] * scale.SplatZ();
+        result.r[3] = Vec4::Set(translation.X(), translation.Y(), translation.Z(), 1.0f);
+        return result;
+    }
+
+    inline Mat4 Mat4::LookAtLH(const Vec4& eye, const Vec4& target, const Vec4& up)
+    {
+        Vec4 zAxis = Vec4::Normalize3(target - eye);
+        Vec4 xAxis = Vec4::Normalize3(Vec4::Cross3(up, zAxis));
+        Vec4 yAxis = Vec4::Cross3(zAxis, xAxis);
+        Mat4 rotation = Transpose({ { xAxis, yAxis, zAxis, Vec4::Set(0.0f, 0.0f, 0.0f, 1.0f) } });
+        rotation.r[3] = Vec4::Set(-Vec4::Dot3(xAxis, eye), -Vec4::Dot3(yAxis, eye), -Vec4::Dot3(zAxis, eye), 1.0f);
+        return rotation;
+    }
+
+    inline Mat4 Mat4::PerspectiveFovLH(float fovY, float aspectRatio, float nearZ, float farZ)
+    {
+        float yScale = 1.0f / std::tan(0.5f * fovY);
+        float xScale = yScale / aspectRatio;
+        float zRange = farZ / (farZ - nearZ);
+        return { { Vec4::Set(xScale, 0.0f, 0.0f, 0.0f), Vec4::Set(0.0f, yScale, 0.0f, 0.0f),
+                   Vec4::Set(0.0f, 0.0f, zRange, 1.0f), Vec4::Set(0.0f, 0.0f, -nearZ * zRange, 0.0f) } };
+    }
+
+    inline Mat4 Mat4::Inverse(const Mat4& m)
+    {
+        // Cofactor expansion through 2x2 sub-determinants of the top and bottom row pairs
+        Float4x4 a;
+        m.Store(a);
+        float s0 = a._11 * a._22 - a._21 * a._12;
+        float s1 = a._11 * a._23 - a._21 * a._13;
+        float s2 = a._11 * a._24 - a._21 * a._14;
+        float s3 = a._12 * a._23 - a._22 * a._13;
+        float s4 = a._12 * a._24 - a._22 * a._14;
+        float s5 = a._13 * a._24 - a._23 * a._14;
+        float c5 = a._33 * a._44 - a._43 * a._34;
+        float c4 = a._32 * a._44 - a._42 * a._34;
+        float c3 = a._32 * a._43 - a._42 * a._33;
+        float c2 = a._31 * a._44 - a._41 * a._34;
+        float c1 = a._31 * a._43 - a._41 * a._33;
+        float c0 = a._31 * a._42 - a._41 * a._32;
+
+        float inverseDeterminant = 1.0f / (s0 * c5 - s1 * c4 + s2 * c3 + s3 * c2 - s4 * c1 + s5 * c0);
+        Float4x4 b(
+            ( a._22 * c5 - a._23 * c4 + a._24 * c3) * inverseDeterminant,
+            (-a._12 * c5 + a._13 * c4 - a._14 * c3) * inverseDeterminant,
+            ( a._42 * s5 - a._43 * s4 + a._44 * s3) * inverseDeterminant,
+            (-a._32 * s5 + a._33 * s4 - a._34 * s3) * inverseDeterminant,
+            (-a._21 * c5 + a._23 * c2 - a._24 * c1) * inverseDeterminant,
+            ( a._11 * c5 - a._13 * c2 + a._14 * c1) * inverseDeterminant,
+            (-a._41 * s5 + a._43 * s2 - a._44 * s1) * inverseDeterminant,
+            ( a._31 * s5 - a._33 * s2 + a._34 * s1) * inverseDeterminant,
+            ( a._21 * c4 - a._22 * c2 + a._24 * c0) * inverseDeterminant,
+            (-a._11 * c4 + a._12 * c2 - a._14 * c0) * inverseDeterminant,
+            ( a._41 * s4 - a._42 * s2 + a._44 * s0) * inverseDeterminant,
+            (-a._31 * s4 + a._32 * s2 - a._34 * s0) * inverseDeterminant,
+            (-a._21 * c3 + a._22 * c1 - a._23 * c0) * inverseDeterminant,
+            ( a._11 * c3 - a._12 * c1 + a._13 * c0) * inverseDeterminant,
+            (-a._41 * s3 + a._42 * s1 - a._43 * s0) * inverseDeterminant,
+            ( a._31 * s3 - a._32 * s1 + a._33 * s0) * inverseDeterminant);
+        return Load(b);
+    }
+}
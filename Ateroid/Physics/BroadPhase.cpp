@@ -0,0 +1,48 @@
+#include "Precompile.h"
+#include "BroadPhase.h"
+#include "Util/Debug.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    BroadPhase::ProxyId BroadPhase::CreateProxy(const Bounds& bounds, uint32_t userData)
+    {
+        ProxyId proxy;
+        if (!m_FreeProxies.empty())
+        {
+            proxy = m_FreeProxies.back();
+            m_FreeProxies.pop_back();
+        }
+        else
+        {
+            proxy = (ProxyId)m_Bounds.size();
+            m_Bounds.emplace_back();
+            m_UserData.emplace_back();
+            m_IsAlive.emplace_back();
+        }
+
+        m_Bounds[proxy] = bounds;
+        m_UserData[proxy] = userData;
+        m_IsAlive[proxy] = 1;
+        ++m_ProxiesCount;
+
+        OnProxyCreated(proxy);
+        return proxy;
+    }
+
+    void BroadPhase::DestroyProxy(ProxyId proxy)
+    {
+        ASTEROID_ASSERT(proxy < m_Bounds.size() && IsAlive(proxy), "Invalid broad-phase proxy.");
+        OnProxyDestroyed(proxy);
+
+        m_IsAlive[proxy] = 0;
+        m_FreeProxies.push_back(proxy);
+        --m_ProxiesCount;
+    }
+
+    void BroadPhase::MoveProxy(ProxyId proxy, const Bounds& bounds)
+    {
+        ASTEROID_ASSERT(proxy < m_Bounds.size() && IsAlive(proxy), "Invalid broad-phase proxy.");
+        m_Bounds[proxy] = bounds;
+        OnProxyMoved(proxy);
+    }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Math/MathTypes.h"
+#include "Util/Containers.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /** Coordinate of a point along axis 0 for x, 1 for y and 2 for z. */
+    inline float AxisValue(const Float3& point, uint32_t axis)
+    {
+        return (&point.x)[axis];
+    }
+
+    /** An axis-aligned bounding box. */
+    struct Bounds
+    {
+        Float3  min;
+        Float3  max;
+
+        /** Boxes touching on a face overlap. */
+        static bool Overlap(const Bounds& a, const Bounds& b)
+        {
+            return a.min.x <= b.max.x && b.min.x <= a.max.x &&
+                a.min.y <= b.max.y && b.min.y <= a.max.y &&
+                a.min.z <= b.max.z && b.min.z <= a.max.z;
+        }
+    };
+
+
+    /** Two proxies with overlapping boxes, first < second. */
+    struct BroadPhasePair
+    {
+        uint32_t    first;
+        uint32_t    second;
+    };
+
+
+    /**
+     *  Finds the pairs of overlapping boxes among many moving objects, the first pass of collision detection.\n
+     *  Objects are registered as proxies holding a box and a user value. Implementations update their structure
+     *  incrementally as proxies move, and FindPairs splits its work on the JobSystem if it is created.
+     *  @remarks
+     *      Not thread-safe, proxies are modified and pairs found from the simulation thread.
+     */
+    class BroadPhase
+    {
+    public:
+        typedef uint32_t ProxyId;
+
+        static const ProxyId kInvalidProxy = 0xFFFFFFFF;
+
+    public:
+        virtual ~BroadPhase() {}
+
+        ASTEROID_NON_COPYABLE(BroadPhase)
+
+        /**
+         *  @param userData
+         *      Any value to find the object back from a pair, e.g. its index in the physics arrays.
+         */
+        ProxyId CreateProxy(const Bounds& bounds, uint32_t userData);
+        void DestroyProxy(ProxyId proxy);
+        /** Set the box of a proxy, usually the bounds of its object after a step. */
+        void MoveProxy(ProxyId proxy, const Bounds& bounds);
+
+        const Bounds& ProxyBounds(ProxyId proxy) const { return m_Bounds[proxy]; }
+        uint32_t UserData(ProxyId proxy) const { return m_UserData[proxy]; }
+        uint32_t ProxiesCount() const { return m_ProxiesCount; }
+
+        /**
+         *  Find every pair of proxies whose boxes overlap.
+         *  @param pairs
+         *      Replaced by the pairs. Their order depends on the implementation, but is the same for the same
+         *      sequence of calls whatever the numbers of worker threads.
+         */
+        virtual void FindPairs(Vector<BroadPhasePair>* pairs) = 0;
+
+        virtual const char* Name() const = 0;
+
+    protected:
+        BroadPhase() : m_ProxiesCount(0) {}
+
+        /** Upper bound of the ids in use, ids of destroyed proxies below it are not alive. */
+        uint32_t ProxyIdsCount() const { return (uint32_t)m_Bounds.size(); }
+        bool IsAlive(ProxyId proxy) const { return m_IsAlive[proxy] != 0; }
+
+        /** Called once the proxy is alive with its bounds set. */
+        virtual void OnProxyCreated(ProxyId proxy) = 0;
+        /** Called while the proxy still has its bounds. */
+        virtual void OnProxyDestroyed(ProxyId proxy) = 0;
+        /** Called once the proxy has its new bounds. */
+        virtual void OnProxyMoved(ProxyId proxy) = 0;
+
+    protected:
+        /** Indexed by proxy id. */
+        Vector<Bounds>      m_Bounds;
+
+    private:
+        Vector<uint32_t>    m_UserData;
+        Vector<uint8_t>     m_IsAlive;
+        Vector<ProxyId>     m_FreeProxies;
+        uint32_t            m_ProxiesCount;
+    };
+}
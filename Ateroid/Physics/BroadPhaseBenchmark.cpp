@@ -0,0 +1,265 @@
+#include "Precompile.h"
+#include "BroadPhaseBenchmark.h"
+#include "HashedGrid.h"
+#include "SweepAndPrune.h"
+#include "Util/Debug.h"
+#include <random>
+
+namespace ASTEROID_NAMESPACE
+{
+    static const float kTimestep = 1.0f / 60.0f;
+    /** Average distance between the bodies of uniform scenes. */
+    static const float kSpacing = 12.0f;
+    static const float kMinAsteroidRadius = 0.5f;
+    static const float kMaxAsteroidRadius = 16.0f;
+    /** Exponent of the power law of asteroid sizes, small ones are the most common. */
+    static const float kAsteroidSizeExponent = 2.5f;
+    static const float kMaxAsteroidSpeed = 5.0f;
+    static const float kProjectilesRatio = 0.1f;
+    static const float kProjectileRadius = 0.1f;
+    static const float kProjectileSpeed = 300.0f;
+    static const uint32_t kClustersCount = 16;
+
+    struct BenchmarkBody
+    {
+        Float3  position;
+        Float3  velocity;
+        float   radius;
+    };
+
+    typedef std::chrono::steady_clock BenchmarkClock;
+
+    static double ElapsedMilliseconds(BenchmarkClock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(BenchmarkClock::now() - start).count();
+    }
+
+    static Float3 RandomDirection(std::mt19937& random)
+    {
+        std::normal_distribution<float> normal;
+        Float3 direction(normal(random), normal(random), normal(random));
+        float length = std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+        if (length == 0.0f)
+            return Float3(1.0f, 0.0f, 0.0f);
+        return Float3(direction.x / length, direction.y / length, direction.z / length);
+    }
+
+    static void GenerateBodies(EBodyDistribution distribution, uint32_t count, uint32_t seed, Vector<BenchmarkBody>* bodies)
+    {
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        std::normal_distribution<float> normal;
+
+        float side = std::cbrt((float)count) * kSpacing;
+        Float3 clusterCenters[kClustersCount];
+        for (Float3& center : clusterCenters)
+            center = Float3((uniform(random) - 0.5f) * side, (uniform(random) - 0.5f) * side, (uniform(random) - 0.5f) * side);
+
+        bodies->resize(count);
+        for (BenchmarkBody& body : *bodies)
+        {
+            switch (distribution)
+            {
+            case EBodyDistribution::eUniform:
+                body.position = Float3((uniform(random) - 0.5f) * side, (uniform(random) - 0.5f) * side, (uniform(random) - 0.5f) * side);
+                break;
+            case EBodyDistribution::eClusters:
+            {
+                const Float3& center = clusterCenters[random() % kClustersCount];
+                float sigma = side / 16.0f;
+                body.position = Float3(center.x + normal(random) * sigma, center.y + normal(random) * sigma, center.z + normal(random) * sigma);
+                break;
+            }
+            default:
+            {
+                float angle = uniform(random) * 6.2831853f;
+                float ringRadius = side * 0.75f + normal(random) * side / 20.0f;
+                body.position = Float3(std::cos(angle) * ringRadius, normal(random) * side / 80.0f, std::sin(angle) * ringRadius);
+                break;
+            }
+            }
+
+            Float3 direction = RandomDirection(random);
+            float speed;
+            if (uniform(random) < kProjectilesRatio)
+            {
+                body.radius = kProjectileRadius;
+                speed = kProjectileSpeed;
+            }
+            else
+            {
+                // Inverse of the cumulative distribution of a power law truncated to the radius range
+                float ratio = std::pow(kMinAsteroidRadius / kMaxAsteroidRadius, kAsteroidSizeExponent);
+                body.radius = kMinAsteroidRadius / std::pow(1.0f - uniform(random) * (1.0f - ratio), 1.0f / kAsteroidSizeExponent);
+                speed = uniform(random) * kMaxAsteroidSpeed;
+            }
+            body.velocity = Float3(direction.x * speed, direction.y * speed, direction.z * speed);
+        }
+    }
+
+    /** Bounds of the path of a body during the last step, so fast bodies do not skip pairs. */
+    static Bounds SweptBounds(const BenchmarkBody& body)
+    {
+        Float3 previous(body.position.x - body.velocity.x * kTimestep, body.position.y - body.velocity.y * kTimestep,
+            body.position.z - body.velocity.z * kTimestep);
+        Bounds bounds;
+        bounds.min = Float3(std::min(previous.x, body.position.x) - body.radius, std::min(previous.y, body.position.y) - body.radius,
+            std::min(previous.z, body.position.z) - body.radius);
+        bounds.max = Float3(std::max(previous.x, body.position.x) + body.radius, std::max(previous.y, body.position.y) + body.radius,
+            std::max(previous.z, body.position.z) + body.radius);
+        return bounds;
+    }
+
+    static void FindPairsBruteForce(const Vector<Bounds>& bounds, Vector<BroadPhasePair>* pairs)
+    {
+        pairs->clear();
+        for (uint32_t i = 0; i < bounds.size(); ++i)
+        {
+            for (uint32_t j = i + 1; j < bounds.size(); ++j)
+            {
+                if (Bounds::Overlap(bounds[i], bounds[j]))
+                    pairs->push_back({ i, j });
+            }
+        }
+    }
+
+    static void SortPairs(Vector<BroadPhasePair>* pairs)
+    {
+        std::sort(pairs->begin(), pairs->end(), [](const BroadPhasePair& a, const BroadPhasePair& b)
+        {
+            return a.first < b.first || (a.first == b.first && a.second < b.second);
+        });
+    }
+
+    static bool SamePairs(const Vector<BroadPhasePair>& a, const Vector<BroadPhasePair>& b)
+    {
+        if (a.size() != b.size())
+            return false;
+        for (size_t i = 0; i < a.size(); ++i)
+        {
+            if (a[i].first != b[i].first || a[i].second != b[i].second)
+                return false;
+        }
+        return true;
+    }
+
+    const char* BroadPhaseBenchmark::DistributionName(EBodyDistribution distribution)
+    {
+        switch (distribution)
+        {
+        case EBodyDistribution::eUniform:   return "uniform";
+        case EBodyDistribution::eClusters:  return "clusters";
+        case EBodyDistribution::eBelt:      return "belt";
+        default:                            return "unknown";
+        }
+    }
+
+    bool BroadPhaseBenchmark::Run(const BroadPhaseBenchmarkSettings& settings)
+    {
+        ASTEROID_LOG_INFO_F("Broad-phase benchmark: %u bodies, %u frames.", settings.bodiesCount, settings.framesCount);
+
+        bool isValid = true;
+        Vector<BenchmarkBody> bodies;
+        Vector<Bounds> bounds(settings.bodiesCount);
+        Vector<BroadPhasePair> pairs;
+        Vector<BroadPhasePair> referencePairs;
+
+        for (uint32_t iDistribution = 0; iDistribution < (uint32_t)EBodyDistribution::eCount; ++iDistribution)
+        {
+            EBodyDistribution distribution = (EBodyDistribution)iDistribution;
+            GenerateBodies(distribution, settings.bodiesCount, settings.seed, &bodies);
+            for (uint32_t iBody = 0; iBody < settings.bodiesCount; ++iBody)
+                bounds[iBody] = SweptBounds(bodies[iBody]);
+
+            HashedGridSettings gridSettings;
+            gridSettings.cellSize = 2.0f * kMinAsteroidRadius;
+            gridSettings.levelsCount = 8;
+            SweepAndPrune sweepAndPrune;
+            HashedGrid grid(gridSettings);
+            BroadPhase* broadPhases[] = { &sweepAndPrune, &grid };
+            const uint32_t kBroadPhasesCount = sizeof(broadPhases) / sizeof(broadPhases[0]);
+
+            double createTimes[kBroadPhasesCount] = {};
+            double updateTimes[kBroadPhasesCount] = {};
+            double findTimes[kBroadPhasesCount] = {};
+            uint64_t pairsCounts[kBroadPhasesCount] = {};
+
+            // Proxy ids match body indices, since proxies are created in order in an empty broad-phase
+            for (uint32_t iBroadPhase = 0; iBroadPhase < kBroadPhasesCount; ++iBroadPhase)
+            {
+                BenchmarkClock::time_point start = BenchmarkClock::now();
+                for (uint32_t iBody = 0; iBody < settings.bodiesCount; ++iBody)
+                    broadPhases[iBroadPhase]->CreateProxy(bounds[iBody], iBody);
+                createTimes[iBroadPhase] = ElapsedMilliseconds(start);
+            }
+
+            bool hasReference = false;
+            if (settings.bodiesCount <= settings.maxBruteForceBodiesCount)
+            {
+                BenchmarkClock::time_point start = BenchmarkClock::now();
+                FindPairsBruteForce(bounds, &referencePairs);
+                ASTEROID_LOG_INFO_F("    %-8s brute force: %9.3f ms, %zu pairs", DistributionName(distribution), ElapsedMilliseconds(start),
+                    referencePairs.size());
+                hasReference = true;
+            }
+
+            for (uint32_t iFrame = 0; iFrame < settings.framesCount; ++iFrame)
+            {
+                if (iFrame > 0)
+                {
+                    for (uint32_t iBody = 0; iBody < settings.bodiesCount; ++iBody)
+                    {
+                        BenchmarkBody& body = bodies[iBody];
+                        body.position = Float3(body.position.x + body.velocity.x * kTimestep, body.position.y + body.velocity.y * kTimestep,
+                            body.position.z + body.velocity.z * kTimestep);
+                        bounds[iBody] = SweptBounds(body);
+                    }
+                }
+
+                for (uint32_t iBroadPhase = 0; iBroadPhase < kBroadPhasesCount; ++iBroadPhase)
+                {
+                    BroadPhase* broadPhase = broadPhases[iBroadPhase];
+                    if (iFrame > 0)
+                    {
+                        BenchmarkClock::time_point start = BenchmarkClock::now();
+                        for (uint32_t iBody = 0; iBody < settings.bodiesCount; ++iBody)
+                            broadPhase->MoveProxy(iBody, bounds[iBody]);
+                        updateTimes[iBroadPhase] += ElapsedMilliseconds(start);
+                    }
+
+                    BenchmarkClock::time_point start = BenchmarkClock::now();
+                    broadPhase->FindPairs(&pairs);
+                    findTimes[iBroadPhase] += ElapsedMilliseconds(start);
+                    pairsCounts[iBroadPhase] += pairs.size();
+
+                    // The first implementation is the reference when there is no brute force one
+                    if (iFrame == 0)
+                    {
+                        SortPairs(&pairs);
+                        if (!hasReference)
+                        {
+                            referencePairs.swap(pairs);
+                            hasReference = true;
+                        }
+                        else if (!SamePairs(pairs, referencePairs))
+                        {
+                            ASTEROID_LOG_ERROR_F("%s found %zu pairs instead of %zu in the %s distribution.", broadPhase->Name(),
+                                pairs.size(), referencePairs.size(), DistributionName(distribution));
+                            isValid = false;
+                        }
+                    }
+                }
+            }
+
+            for (uint32_t iBroadPhase = 0; iBroadPhase < kBroadPhasesCount; ++iBroadPhase)
+            {
+                double framesCount = std::max(settings.framesCount, 1u);
+                ASTEROID_LOG_INFO_F("    %-8s %-13s: create %9.3f ms, update %7.3f ms, find pairs %7.3f ms, %.0f pairs per frame",
+                    DistributionName(distribution), broadPhases[iBroadPhase]->Name(), createTimes[iBroadPhase],
+                    updateTimes[iBroadPhase] / std::max(framesCount - 1.0, 1.0), findTimes[iBroadPhase] / framesCount,
+                    pairsCounts[iBroadPhase] / framesCount);
+            }
+        }
+        return isValid;
+    }
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+namespace ASTEROID_NAMESPACE
+{
+    /** How the bodies of a synthetic benchmark scene are laid out. */
+    enum class EBodyDistribution
+    {
+        /** Spread evenly in a cube. */
+        eUniform,
+        /** Gathered in dense gaussian clusters. */
+        eClusters,
+        /** A thin ring around the origin, like a planetary belt. */
+        eBelt,
+        eCount
+    };
+
+
+    struct BroadPhaseBenchmarkSettings
+    {
+        uint32_t    bodiesCount;
+        /** Simulated frames for each distribution. */
+        uint32_t    framesCount;
+        uint32_t    seed;
+        /**
+         *  Also time the O(n^2) test of every pair when there are at most this many bodies, and check the pairs
+         *  of the broad-phases against it.
+         */
+        uint32_t    maxBruteForceBodiesCount;
+    };
+
+
+    /**
+     *  Times the BroadPhase implementations on synthetic asteroid fields: mostly asteroids of sizes following a power
+     *  law, drifting slowly, with a fraction of small fast projectiles. Every frame moves every body, then updates
+     *  the proxies and finds the pairs. Results are logged per distribution, and the first frame of every
+     *  implementation is checked against the others.
+     */
+    class BroadPhaseBenchmark
+    {
+    public:
+        ASTEROID_NO_DEFAULT_CTOR(BroadPhaseBenchmark)
+        ASTEROID_NON_COPYABLE(BroadPhaseBenchmark)
+
+        /**
+         *  @return
+         *      False if implementations did not find the same pairs.
+         */
+        static bool Run(const BroadPhaseBenchmarkSettings& settings);
+
+        static const char* DistributionName(EBodyDistribution distribution);
+    };
+}
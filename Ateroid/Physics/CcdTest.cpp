@@ -0,0 +1,191 @@
+#include "Precompile.h"
+#include "CcdTest.h"
+#include "PhysicsWorld.h"
+#include "Util/Debug.h"
+#include <random>
+
+namespace ASTEROID_NAMESPACE
+{
+    static const float kTimestep = 1.0f / 60.0f;
+    static const float kProjectileRadius = 0.1f;
+    static const float kProjectileSpeed = 300.0f;
+    static const float kSphereRadius = 0.5f;
+    static const float kCapsuleRadius = 0.3f;
+    static const float kCapsuleHalfHeight = 0.5f;
+    static const float kBoxHalfExtent = 0.5f;
+    /** Distance between the targets, far more than a projectile travels in one step. */
+    static const float kSpacing = 20.0f;
+    /**
+     *  Projectiles start this far from the point they are aimed at, less than one step away but with their box
+     *  clear of the box of the target, so only CCD can find the pair in the first step.
+     */
+    static const float kMinStartDistance = 2.5f;
+    static const float kMaxStartDistance = 3.5f;
+    /** Projectiles pass this far from the center of their target at most, relative to its thinnest radius. */
+    static const float kMaxMissRatio = 0.5f;
+
+    static Float3 RandomDirection(std::mt19937& random)
+    {
+        std::normal_distribution<float> normal;
+        Float3 direction(normal(random), normal(random), normal(random));
+        float length = std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+        if (length == 0.0f)
+            return Float3(1.0f, 0.0f, 0.0f);
+        return Float3(direction.x / length, direction.y / length, direction.z / length);
+    }
+
+    static Float4 RandomRotation(std::mt19937& random)
+    {
+        std::normal_distribution<float> normal;
+        Float4 rotation(normal(random), normal(random), normal(random), normal(random));
+        float length = std::sqrt(rotation.x * rotation.x + rotation.y * rotation.y + rotation.z * rotation.z + rotation.w * rotation.w);
+        if (length == 0.0f)
+            return Float4(0.0f, 0.0f, 0.0f, 1.0f);
+        return Float4(rotation.x / length, rotation.y / length, rotation.z / length, rotation.w / length);
+    }
+
+    static const char* ShapeName(EShapeType shape)
+    {
+        switch (shape)
+        {
+        case EShapeType::eSphere:   return "sphere";
+        case EShapeType::eCapsule:  return "capsule";
+        default:                    return "box hull";
+        }
+    }
+
+    /**
+     *  Shoots the projectiles at targets of one shape in a new PhysicsWorld and steps once.
+     *  @return
+     *      Number of projectiles that ended past the far side of their target.
+     */
+    static uint32_t CountTunnelled(const CcdTestSettings& settings, const PhysicsSettings& physicsSettings, EShapeType shape,
+        bool isFast)
+    {
+        PhysicsWorld::Destroy();
+        PhysicsWorld* world = PhysicsWorld::Create(physicsSettings);
+
+        RigidBodyDesc targetDesc = {};
+        targetDesc.shape = shape;
+        targetDesc.transform = TransformSystem::kInvalidHandle;
+        float innerRadius, boundingRadius;
+        switch (shape)
+        {
+        case EShapeType::eSphere:
+            targetDesc.radius = kSphereRadius;
+            innerRadius = kSphereRadius;
+            boundingRadius = kSphereRadius;
+            break;
+        case EShapeType::eCapsule:
+            targetDesc.radius = kCapsuleRadius;
+            targetDesc.halfHeight = kCapsuleHalfHeight;
+            innerRadius = kCapsuleRadius;
+            boundingRadius = kCapsuleRadius + kCapsuleHalfHeight;
+            break;
+        default:
+        {
+            Float3 corners[8];
+            for (uint32_t iCorner = 0; iCorner < 8; ++iCorner)
+            {
+                corners[iCorner] = Float3((iCorner & 1) != 0 ? kBoxHalfExtent : -kBoxHalfExtent,
+                    (iCorner & 2) != 0 ? kBoxHalfExtent : -kBoxHalfExtent, (iCorner & 4) != 0 ? kBoxHalfExtent : -kBoxHalfExtent);
+            }
+            targetDesc.hull = world->CreateConvexHull(corners, 8);
+            ASTEROID_ASSERT(targetDesc.hull != PhysicsWorld::kInvalidHull, "Box hull creation failed.");
+            innerRadius = kBoxHalfExtent;
+            boundingRadius = kBoxHalfExtent * std::sqrt(3.0f);
+            break;
+        }
+        }
+
+        RigidBodyDesc projectileDesc = {};
+        projectileDesc.shape = EShapeType::eSphere;
+        projectileDesc.radius = kProjectileRadius;
+        projectileDesc.mass = 1.0f;
+        projectileDesc.rotation = Float4(0.0f, 0.0f, 0.0f, 1.0f);
+        projectileDesc.isFast = isFast;
+        projectileDesc.transform = TransformSystem::kInvalidHandle;
+
+        // Same seed for both runs, so CCD is the only difference
+        std::mt19937 random(settings.seed);
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        Vector<Float3> targets(settings.projectilesCount);
+        Vector<Float3> directions(settings.projectilesCount);
+        for (uint32_t iProjectile = 0; iProjectile < settings.projectilesCount; ++iProjectile)
+        {
+            Float3 target((float)iProjectile * kSpacing, 0.0f, 0.0f);
+            targetDesc.position = target;
+            targetDesc.rotation = RandomRotation(random);
+            world->AddBody((ObjectInstanceID)(2 * iProjectile), targetDesc);
+
+            // Aimed at a point near the center, so the line goes through the target whatever its rotation
+            Float3 direction = RandomDirection(random);
+            Float3 miss = RandomDirection(random);
+            float missScale = uniform(random) * kMaxMissRatio * innerRadius;
+            float startDistance = kMinStartDistance + uniform(random) * (kMaxStartDistance - kMinStartDistance);
+            Float3 aim(target.x + miss.x * missScale, target.y + miss.y * missScale, target.z + miss.z * missScale);
+            projectileDesc.position = Float3(aim.x - direction.x * startDistance, aim.y - direction.y * startDistance,
+                aim.z - direction.z * startDistance);
+            projectileDesc.linearVelocity = Float3(direction.x * kProjectileSpeed, direction.y * kProjectileSpeed,
+                direction.z * kProjectileSpeed);
+            world->AddBody((ObjectInstanceID)(2 * iProjectile + 1), projectileDesc);
+
+            targets[iProjectile] = target;
+            directions[iProjectile] = direction;
+        }
+
+        world->Step(kTimestep);
+
+        uint32_t tunnelledCount = 0;
+        for (uint32_t iProjectile = 0; iProjectile < settings.projectilesCount; ++iProjectile)
+        {
+            Float3 position = world->Position((ObjectInstanceID)(2 * iProjectile + 1));
+            const Float3& target = targets[iProjectile];
+            const Float3& direction = directions[iProjectile];
+            float distance = (position.x - target.x) * direction.x + (position.y - target.y) * direction.y +
+                (position.z - target.z) * direction.z;
+            if (distance > boundingRadius + kProjectileRadius)
+                ++tunnelledCount;
+        }
+        return tunnelledCount;
+    }
+
+    bool CcdTest::Run(const CcdTestSettings& settings)
+    {
+        ASTEROID_LOG_INFO_F("CCD test: %u projectiles per target shape.", settings.projectilesCount);
+
+        if (PhysicsWorld::Singleton() == nullptr)
+        {
+            ASTEROID_LOG_ERROR("The CCD test needs a PhysicsWorld.");
+            return false;
+        }
+        PhysicsSettings physicsSettings = PhysicsWorld::Singleton()->Settings();
+
+        bool isValid = true;
+        for (EShapeType shape : { EShapeType::eSphere, EShapeType::eCapsule, EShapeType::eConvexHull })
+        {
+            uint32_t discreteCount = CountTunnelled(settings, physicsSettings, shape, false);
+            uint32_t continuousCount = CountTunnelled(settings, physicsSettings, shape, true);
+            ASTEROID_LOG_INFO_F("    %-8s: %u/%u tunnelled without CCD, %u/%u with", ShapeName(shape), discreteCount,
+                settings.projectilesCount, continuousCount, settings.projectilesCount);
+
+            // Without CCD every projectile must tunnel, or the test doesn't test anything
+            if (discreteCount != settings.projectilesCount)
+            {
+                ASTEROID_LOG_ERROR_F("Only %u of %u projectiles tunnelled through a %s without CCD, the scene is too slow to test it.",
+                    discreteCount, settings.projectilesCount, ShapeName(shape));
+                isValid = false;
+            }
+            if (continuousCount != 0)
+            {
+                ASTEROID_LOG_ERROR_F("%u of %u projectiles tunnelled through a %s with CCD.", continuousCount,
+                    settings.projectilesCount, ShapeName(shape));
+                isValid = false;
+            }
+        }
+
+        PhysicsWorld::Destroy();
+        PhysicsWorld::Create(physicsSettings);
+        return isValid;
+    }
+}
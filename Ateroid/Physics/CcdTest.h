@@ -0,0 +1,34 @@
+#pragma once
+
+namespace ASTEROID_NAMESPACE
+{
+    struct CcdTestSettings
+    {
+        /** Projectiles shot at targets of every shape, once without and once with continuous collision detection. */
+        uint32_t    projectilesCount;
+        uint32_t    seed;
+    };
+
+
+    /**
+     *  Checks the continuous collision detection of the PhysicsWorld. Projectiles as fast as the ones of the
+     *  asteroid field start less than one step in front of a small static sphere, capsule or box hull, aimed
+     *  near its center. In one step they travel past the far side of the target, so without CCD every one of
+     *  them must tunnel through, and with CCD none may, whether a speculative contact or the sweep stops it.
+     */
+    class CcdTest
+    {
+    public:
+        ASTEROID_NO_DEFAULT_CTOR(CcdTest)
+        ASTEROID_NON_COPYABLE(CcdTest)
+
+        /**
+         *  @return
+         *      False if any check failed.
+         *  @remarks
+         *      The PhysicsWorld singleton is replaced by empty ones with the same settings, so it must not hold
+         *      bodies the caller still uses.
+         */
+        static bool Run(const CcdTestSettings& settings);
+    };
+}
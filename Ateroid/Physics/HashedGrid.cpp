@@ -0,0 +1,424 @@
+#include "Precompile.h"
+#include "HashedGrid.h"
+#include "Core/JobSystem.h"
+#include "Util/Debug.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    // Cell keys pack the level in 4 bits and each coordinate in 20 bits, coordinates are clamped to fit
+    static const int32_t kCoordinateBias = 1 << 19;
+    static const uint32_t kInitialBucketsCount = 1024;
+    static const uint32_t kMinOccupiedBitsCount = 4096;
+
+    HashedGrid::HashedGrid(const HashedGridSettings& settings)
+        : m_Settings(settings), m_BucketsShift(0), m_OccupiedBitsShift(0)
+    {
+        ASTEROID_ASSERT(settings.cellSize > 0.0f, "HashedGrid cell size must be positive.");
+        ASTEROID_ASSERT(settings.levelsCount >= 1 && settings.levelsCount <= kMaxLevelsCount, "Invalid HashedGrid levels count.");
+
+        float cellSize = settings.cellSize;
+        for (uint32_t iLevel = 0; iLevel < kMaxLevelsCount; ++iLevel)
+        {
+            m_InvCellSizes[iLevel] = 1.0f / cellSize;
+            m_LevelProxiesCounts[iLevel] = 0;
+            cellSize *= 2.0f;
+        }
+
+        ResizeBuckets(kInitialBucketsCount);
+    }
+
+    int32_t HashedGrid::CellCoordinate(float value, uint32_t level) const
+    {
+        float scaled = std::min(std::max(value * m_InvCellSizes[level], -(float)kCoordinateBias), (float)(kCoordinateBias - 1));
+        // Branchless rounding down, std::floor is a library call without SSE4.1 and the sign of coordinates is random
+        int32_t coordinate = (int32_t)scaled;
+        return coordinate - (int32_t)((float)coordinate > scaled);
+    }
+
+    HashedGrid::CellRange HashedGrid::ComputeRange(const Bounds& bounds, uint32_t level) const
+    {
+        CellRange range;
+        for (uint32_t iAxis = 0; iAxis < 3; ++iAxis)
+        {
+            range.min[iAxis] = CellCoordinate(AxisValue(bounds.min, iAxis), level);
+            range.max[iAxis] = CellCoordinate(AxisValue(bounds.max, iAxis), level);
+        }
+        range.level = level;
+        return range;
+    }
+
+    uint32_t HashedGrid::ComputeLevel(const Bounds& bounds) const
+    {
+        float size = std::max(std::max(bounds.max.x - bounds.min.x, bounds.max.y - bounds.min.y), bounds.max.z - bounds.min.z);
+        uint32_t level = 0;
+        float cellSize = m_Settings.cellSize;
+        while (level + 1 < m_Settings.levelsCount && size > cellSize)
+        {
+            ++level;
+            cellSize *= 2.0f;
+        }
+        return level;
+    }
+
+    uint32_t HashedGrid::SpanningAxes(const CellRange& range)
+    {
+        return (range.min[0] != range.max[0] ? 1u : 0u) | (range.min[1] != range.max[1] ? 2u : 0u) | (range.min[2] != range.max[2] ? 4u : 0u);
+    }
+
+    bool HashedGrid::IsReportingCell(const Bounds& a, const Bounds& b, uint32_t level, const int32_t* cell, uint32_t axesMask) const
+    {
+        for (uint32_t iAxis = 0; iAxis < 3; ++iAxis)
+        {
+            if ((axesMask & (1u << iAxis)) != 0 &&
+                CellCoordinate(std::max(AxisValue(a.min, iAxis), AxisValue(b.min, iAxis)), level) != cell[iAxis])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint64_t HashedGrid::CellKey(uint32_t level, int32_t x, int32_t y, int32_t z)
+    {
+        return ((uint64_t)level << 60) | ((uint64_t)(x + kCoordinateBias) << 40) | ((uint64_t)(y + kCoordinateBias) << 20) |
+            (uint64_t)(z + kCoordinateBias);
+    }
+
+    uint64_t HashedGrid::HashKey(uint64_t key)
+    {
+        // Fibonacci hashing, the high bits mix every bit of the key so neighbor cells land far apart
+        return key * 0x9E3779B97F4A7C15ull;
+    }
+
+    uint32_t HashedGrid::BucketIndex(uint64_t key) const
+    {
+        return (uint32_t)(HashKey(key) >> m_BucketsShift);
+    }
+
+    bool HashedGrid::MayBeOccupied(uint64_t key) const
+    {
+        uint64_t bit = HashKey(key) >> m_OccupiedBitsShift;
+        return ((m_OccupiedBits[bit >> 6] >> (bit & 63)) & 1) != 0;
+    }
+
+    void HashedGrid::BuildOccupiedBits()
+    {
+        // About 8 bits per cell keeps false positives near one in ten
+        uint32_t bitsCount = kMinOccupiedBitsCount;
+        m_OccupiedBitsShift = 64;
+        for (uint32_t count = bitsCount; count > 1; count >>= 1)
+            --m_OccupiedBitsShift;
+        while (bitsCount < CellsCount() * 8)
+        {
+            bitsCount *= 2;
+            --m_OccupiedBitsShift;
+        }
+
+        m_OccupiedBits.assign(bitsCount / 64, 0);
+        for (const Cell& cell : m_Cells)
+        {
+            // Only coarser levels are looked up
+            if (!cell.proxies.empty() && (cell.key >> 60) > 0)
+            {
+                uint64_t bit = HashKey(cell.key) >> m_OccupiedBitsShift;
+                m_OccupiedBits[bit >> 6] |= 1ull << (bit & 63);
+            }
+        }
+    }
+
+    uint32_t HashedGrid::FindCell(uint64_t key) const
+    {
+        uint32_t mask = (uint32_t)m_Buckets.size() - 1;
+        for (uint32_t iBucket = BucketIndex(key);; iBucket = (iBucket + 1) & mask)
+        {
+            const Bucket& bucket = m_Buckets[iBucket];
+            if (bucket.cell == kEmptyBucket || bucket.key == key)
+                return bucket.cell;
+        }
+    }
+
+    uint32_t HashedGrid::FindOrAddCell(uint64_t key)
+    {
+        if ((CellsCount() + 1) * 2 > m_Buckets.size())
+            ResizeBuckets((uint32_t)m_Buckets.size() * 2);
+
+        uint32_t mask = (uint32_t)m_Buckets.size() - 1;
+        uint32_t iBucket = BucketIndex(key);
+        for (; m_Buckets[iBucket].cell != kEmptyBucket; iBucket = (iBucket + 1) & mask)
+        {
+            if (m_Buckets[iBucket].key == key)
+                return m_Buckets[iBucket].cell;
+        }
+
+        uint32_t cell;
+        if (!m_FreeCells.empty())
+        {
+            cell = m_FreeCells.back();
+            m_FreeCells.pop_back();
+        }
+        else
+        {
+            cell = (uint32_t)m_Cells.size();
+            m_Cells.emplace_back();
+        }
+        m_Cells[cell].key = key;
+        m_Buckets[iBucket].key = key;
+        m_Buckets[iBucket].cell = cell;
+        return cell;
+    }
+
+    void HashedGrid::RemoveCell(uint64_t key)
+    {
+        uint32_t mask = (uint32_t)m_Buckets.size() - 1;
+        uint32_t iBucket = BucketIndex(key);
+        while (m_Buckets[iBucket].key != key)
+            iBucket = (iBucket + 1) & mask;
+
+        m_FreeCells.push_back(m_Buckets[iBucket].cell);
+
+        // Shift back the entries of the probe sequence that can no longer be reached across the hole
+        uint32_t hole = iBucket;
+        for (uint32_t iNext = (hole + 1) & mask; m_Buckets[iNext].cell != kEmptyBucket; iNext = (iNext + 1) & mask)
+        {
+            uint32_t home = BucketIndex(m_Buckets[iNext].key);
+            bool isReachable = hole <= iNext ? (hole < home && home <= iNext) : (hole < home || home <= iNext);
+            if (!isReachable)
+            {
+                m_Buckets[hole] = m_Buckets[iNext];
+                hole = iNext;
+            }
+        }
+        m_Buckets[hole].cell = kEmptyBucket;
+    }
+
+    void HashedGrid::ResizeBuckets(uint32_t bucketsCount)
+    {
+        Vector<Bucket> oldBuckets;
+        oldBuckets.swap(m_Buckets);
+
+        m_Buckets.assign(bucketsCount, { 0, kEmptyBucket });
+        m_BucketsShift = 64;
+        for (uint32_t count = bucketsCount; count > 1; count >>= 1)
+            --m_BucketsShift;
+
+        uint32_t mask = bucketsCount - 1;
+        for (const Bucket& bucket : oldBuckets)
+        {
+            if (bucket.cell == kEmptyBucket)
+                continue;
+
+            uint32_t iBucket = BucketIndex(bucket.key);
+            while (m_Buckets[iBucket].cell != kEmptyBucket)
+                iBucket = (iBucket + 1) & mask;
+            m_Buckets[iBucket] = bucket;
+        }
+    }
+
+    bool HashedGrid::Contains(const CellRange* range, uint32_t level, int32_t x, int32_t y, int32_t z)
+    {
+        return range && range->level == level && x >= range->min[0] && x <= range->max[0] && y >= range->min[1] &&
+            y <= range->max[1] && z >= range->min[2] && z <= range->max[2];
+    }
+
+    void HashedGrid::Insert(ProxyId proxy, const CellRange& range, const CellRange* skipped)
+    {
+        for (int32_t x = range.min[0]; x <= range.max[0]; ++x)
+        {
+            for (int32_t y = range.min[1]; y <= range.max[1]; ++y)
+            {
+                for (int32_t z = range.min[2]; z <= range.max[2]; ++z)
+                {
+                    if (!Contains(skipped, range.level, x, y, z))
+                        m_Cells[FindOrAddCell(CellKey(range.level, x, y, z))].proxies.push_back(proxy);
+                }
+            }
+        }
+        ++m_LevelProxiesCounts[range.level];
+    }
+
+    void HashedGrid::Remove(ProxyId proxy, const CellRange& range, const CellRange* skipped)
+    {
+        for (int32_t x = range.min[0]; x <= range.max[0]; ++x)
+        {
+            for (int32_t y = range.min[1]; y <= range.max[1]; ++y)
+            {
+                for (int32_t z = range.min[2]; z <= range.max[2]; ++z)
+                {
+                    if (Contains(skipped, range.level, x, y, z))
+                        continue;
+
+                    uint64_t key = CellKey(range.level, x, y, z);
+                    Vector<ProxyId>& proxies = m_Cells[FindCell(key)].proxies;
+                    auto it = std::find(proxies.begin(), proxies.end(), proxy);
+                    ASTEROID_ASSERT(it != proxies.end(), "Proxy missing from a HashedGrid cell.");
+                    *it = proxies.back();
+                    proxies.pop_back();
+
+                    if (proxies.empty())
+                        RemoveCell(key);
+                }
+            }
+        }
+        --m_LevelProxiesCounts[range.level];
+    }
+
+    void HashedGrid::OnProxyCreated(ProxyId proxy)
+    {
+        if (proxy >= m_Ranges.size())
+            m_Ranges.resize(proxy + 1);
+
+        const Bounds& bounds = m_Bounds[proxy];
+        m_Ranges[proxy] = ComputeRange(bounds, ComputeLevel(bounds));
+        Insert(proxy, m_Ranges[proxy], nullptr);
+    }
+
+    void HashedGrid::OnProxyDestroyed(ProxyId proxy)
+    {
+        Remove(proxy, m_Ranges[proxy], nullptr);
+    }
+
+    void HashedGrid::OnProxyMoved(ProxyId proxy)
+    {
+        const Bounds& bounds = m_Bounds[proxy];
+        CellRange range = ComputeRange(bounds, ComputeLevel(bounds));
+        if (range == m_Ranges[proxy])
+            return;
+
+        // Cells in both ranges keep the proxy
+        Remove(proxy, m_Ranges[proxy], &range);
+        Insert(proxy, range, &m_Ranges[proxy]);
+        m_Ranges[proxy] = range;
+    }
+
+    void HashedGrid::FindCellPairs(uint32_t iCell, Vector<BroadPhasePair>* pairs) const
+    {
+        const Cell& cell = m_Cells[iCell];
+        uint32_t level = (uint32_t)(cell.key >> 60);
+        int32_t coordinates[3] = { (int32_t)((cell.key >> 40) & 0xFFFFF) - kCoordinateBias,
+            (int32_t)((cell.key >> 20) & 0xFFFFF) - kCoordinateBias, (int32_t)(cell.key & 0xFFFFF) - kCoordinateBias };
+
+        const Vector<ProxyId>& proxies = cell.proxies;
+        for (uint32_t i = 0; i < proxies.size(); ++i)
+        {
+            ProxyId proxy = proxies[i];
+            const Bounds& bounds = m_Bounds[proxy];
+            uint32_t spanningAxes = SpanningAxes(m_Ranges[proxy]);
+            for (uint32_t j = i + 1; j < proxies.size(); ++j)
+            {
+                ProxyId other = proxies[j];
+                const Bounds& otherBounds = m_Bounds[other];
+                if (Bounds::Overlap(bounds, otherBounds) &&
+                    IsReportingCell(bounds, otherBounds, level, coordinates, spanningAxes & SpanningAxes(m_Ranges[other])))
+                {
+                    if (proxy < other)
+                        pairs->push_back({ proxy, other });
+                    else
+                        pairs->push_back({ other, proxy });
+                }
+            }
+        }
+    }
+
+    void HashedGrid::FindCoarserPairs(ProxyId proxy, uint32_t coarsestLevel, Vector<BroadPhasePair>* pairs) const
+    {
+        const Bounds& bounds = m_Bounds[proxy];
+        for (uint32_t iLevel = m_Ranges[proxy].level + 1; iLevel <= coarsestLevel; ++iLevel)
+        {
+            if (m_LevelProxiesCounts[iLevel] == 0)
+                continue;
+
+            CellRange range = ComputeRange(bounds, iLevel);
+            uint32_t spanningAxes = SpanningAxes(range);
+            int32_t coordinates[3];
+            for (coordinates[0] = range.min[0]; coordinates[0] <= range.max[0]; ++coordinates[0])
+            {
+                for (coordinates[1] = range.min[1]; coordinates[1] <= range.max[1]; ++coordinates[1])
+                {
+                    for (coordinates[2] = range.min[2]; coordinates[2] <= range.max[2]; ++coordinates[2])
+                    {
+                        // Most cells of coarse levels are empty, the bit set rejects them without a cache miss in the table
+                        uint64_t key = CellKey(iLevel, coordinates[0], coordinates[1], coordinates[2]);
+                        if (!MayBeOccupied(key))
+                            continue;
+                        uint32_t iCell = FindCell(key);
+                        if (iCell == kEmptyBucket)
+                            continue;
+
+                        for (ProxyId other : m_Cells[iCell].proxies)
+                        {
+                            const Bounds& otherBounds = m_Bounds[other];
+                            if (Bounds::Overlap(bounds, otherBounds) &&
+                                IsReportingCell(bounds, otherBounds, iLevel, coordinates, spanningAxes & SpanningAxes(m_Ranges[other])))
+                            {
+                                if (proxy < other)
+                                    pairs->push_back({ proxy, other });
+                                else
+                                    pairs->push_back({ other, proxy });
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    void HashedGrid::FindPairs(Vector<BroadPhasePair>* pairs)
+    {
+        // Pairs on the same level are found in the cells they share, pairs across levels by the proxy of the finer
+        // level looking up the cells of the coarser levels. The two passes are split into chunks of one job.
+        uint32_t cellsCount = (uint32_t)m_Cells.size();
+        uint32_t idsCount = ProxyIdsCount();
+        uint32_t cellChunksCount = (cellsCount + kChunkSize - 1) / kChunkSize;
+        uint32_t chunksCount = cellChunksCount + (idsCount + kChunkSize - 1) / kChunkSize;
+        if (m_ChunkPairs.size() < chunksCount)
+            m_ChunkPairs.resize(chunksCount);
+
+        uint32_t coarsestLevel = 0;
+        for (uint32_t iLevel = 0; iLevel < m_Settings.levelsCount; ++iLevel)
+        {
+            if (m_LevelProxiesCounts[iLevel] > 0)
+                coarsestLevel = iLevel;
+        }
+        BuildOccupiedBits();
+
+        // Every chunk adds to its own list, concatenated in chunk order so the result does not depend on threads
+        auto findChunks = [&](uint32_t beginChunk, uint32_t endChunk)
+        {
+            for (uint32_t iChunk = beginChunk; iChunk < endChunk; ++iChunk)
+            {
+                Vector<BroadPhasePair>& chunkPairs = m_ChunkPairs[iChunk];
+                chunkPairs.clear();
+
+                if (iChunk < cellChunksCount)
+                {
+                    uint32_t end = std::min((iChunk + 1) * kChunkSize, cellsCount);
+                    for (uint32_t iCell = iChunk * kChunkSize; iCell < end; ++iCell)
+                    {
+                        if (m_Cells[iCell].proxies.size() > 1)
+                            FindCellPairs(iCell, &chunkPairs);
+                    }
+                }
+                else
+                {
+                    uint32_t begin = (iChunk - cellChunksCount) * kChunkSize;
+                    uint32_t end = std::min(begin + kChunkSize, idsCount);
+                    for (ProxyId proxy = begin; proxy < end; ++proxy)
+                    {
+                        if (IsAlive(proxy) && m_Ranges[proxy].level < coarsestLevel)
+                            FindCoarserPairs(proxy, coarsestLevel, &chunkPairs);
+                    }
+                }
+            }
+        };
+
+        JobSystem* jobSystem = JobSystem::Singleton();
+        if (jobSystem != nullptr)
+            jobSystem->ParallelFor(chunksCount, 1, findChunks);
+        else
+            findChunks(0, chunksCount);
+
+        pairs->clear();
+        for (uint32_t iChunk = 0; iChunk < chunksCount; ++iChunk)
+            pairs->insert(pairs->end(), m_ChunkPairs[iChunk].begin(), m_ChunkPairs[iChunk].end());
+    }
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "BroadPhase.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    struct HashedGridSettings
+    {
+        /** Size of the cells of the finest level, about the size of the smallest objects. */
+        float       cellSize;
+        /** Numbers of levels, each one with cells twice as large as the level before, at most HashedGrid::kMaxLevelsCount. */
+        uint32_t    levelsCount;
+    };
+
+
+    /**
+     *  A BroadPhase storing proxies in the cells of a multi-level grid, only occupied cells are stored in a hash table.\n
+     *  A proxy lives on the finest level whose cells are at least as large as its box, so it overlaps at most two
+     *  cells along each axis. Moving a proxy only touches the table when the cells it overlaps change. Pairs are
+     *  found by testing the proxies sharing each cell, and every proxy against the cells of the coarser levels.
+     *  @remarks
+     *      Cost does not depend on how objects spread, which suits dense clusters. Boxes larger than the cells of
+     *      the coarsest level overlap many cells, pick the levels to cover the largest objects.
+     */
+    class HashedGrid : public BroadPhase
+    {
+    public:
+        static const uint32_t kMaxLevelsCount = 16;
+
+    public:
+        explicit HashedGrid(const HashedGridSettings& settings);
+
+        ASTEROID_NON_COPYABLE(HashedGrid)
+
+        virtual void FindPairs(Vector<BroadPhasePair>* pairs) override;
+        virtual const char* Name() const override { return "HashedGrid"; }
+
+        /** Numbers of occupied cells of every level. */
+        uint32_t CellsCount() const { return (uint32_t)(m_Cells.size() - m_FreeCells.size()); }
+
+    protected:
+        virtual void OnProxyCreated(ProxyId proxy) override;
+        virtual void OnProxyDestroyed(ProxyId proxy) override;
+        virtual void OnProxyMoved(ProxyId proxy) override;
+
+    private:
+        /** The box of cells a proxy overlaps on one level, bounds included. */
+        struct CellRange
+        {
+            int32_t     min[3];
+            int32_t     max[3];
+            uint32_t    level;
+
+            bool operator==(const CellRange& other) const
+            {
+                return level == other.level && std::memcmp(min, other.min, sizeof(min)) == 0 && std::memcmp(max, other.max, sizeof(max)) == 0;
+            }
+        };
+
+        struct Cell
+        {
+            uint64_t        key;
+            /** Empty if the cell is free. */
+            Vector<ProxyId> proxies;
+        };
+
+        /** A slot of the open addressing hash table from cell keys to cells. */
+        struct Bucket
+        {
+            uint64_t    key;
+            uint32_t    cell;
+        };
+
+        static const uint32_t kEmptyBucket = 0xFFFFFFFF;
+        /** Cells or proxies processed per pair finding job. */
+        static const uint32_t kChunkSize = 1024;
+
+        int32_t CellCoordinate(float value, uint32_t level) const;
+        CellRange ComputeRange(const Bounds& bounds, uint32_t level) const;
+        /** The finest level whose cells are at least as large as the box. */
+        uint32_t ComputeLevel(const Bounds& bounds) const;
+        /** Bit i is set if the range spans several cells along axis i. */
+        static uint32_t SpanningAxes(const CellRange& range);
+        /**
+         *  Pairs of overlapping boxes can share several cells, only the cell holding the minimum corner of their
+         *  intersection reports them. The corner is inside both boxes, so only the axes along which both boxes
+         *  span several cells need checking.
+         *  @param axesMask
+         *      Axes to check, bit i for axis i.
+         */
+        bool IsReportingCell(const Bounds& a, const Bounds& b, uint32_t level, const int32_t* cell, uint32_t axesMask) const;
+
+        static uint64_t CellKey(uint32_t level, int32_t x, int32_t y, int32_t z);
+        static uint64_t HashKey(uint64_t key);
+        uint32_t BucketIndex(uint64_t key) const;
+        /** False if the cell is surely empty, see m_OccupiedBits. */
+        bool MayBeOccupied(uint64_t key) const;
+        void BuildOccupiedBits();
+        /** @return The cell, kEmptyBucket if it is not occupied. */
+        uint32_t FindCell(uint64_t key) const;
+        uint32_t FindOrAddCell(uint64_t key);
+        void RemoveCell(uint64_t key);
+        void ResizeBuckets(uint32_t bucketsCount);
+
+        /** @return False if range is null. */
+        static bool Contains(const CellRange* range, uint32_t level, int32_t x, int32_t y, int32_t z);
+        /**
+         *  @param skipped
+         *      Cells the proxy is left in or out of, can be null.
+         */
+        void Insert(ProxyId proxy, const CellRange& range, const CellRange* skipped);
+        void Remove(ProxyId proxy, const CellRange& range, const CellRange* skipped);
+        /** Pairs of proxies sharing a cell, they are on the same level. */
+        void FindCellPairs(uint32_t iCell, Vector<BroadPhasePair>* pairs) const;
+        /** Pairs of a proxy with the proxies of coarser levels up to coarsestLevel. */
+        void FindCoarserPairs(ProxyId proxy, uint32_t coarsestLevel, Vector<BroadPhasePair>* pairs) const;
+
+    private:
+        HashedGridSettings              m_Settings;
+        float                           m_InvCellSizes[kMaxLevelsCount];
+        uint32_t                        m_LevelProxiesCounts[kMaxLevelsCount];
+
+        /** Cells of every proxy, indexed by proxy id. */
+        Vector<CellRange>               m_Ranges;
+        Vector<Cell>                    m_Cells;
+        Vector<uint32_t>                m_FreeCells;
+        /** A power of two numbers of buckets, at most half used. */
+        Vector<Bucket>                  m_Buckets;
+        uint32_t                        m_BucketsShift;
+        /** Bits set at the hashes of the occupied cells of coarse levels, rebuilt by FindPairs. */
+        Vector<uint64_t>                m_OccupiedBits;
+        uint32_t                        m_OccupiedBitsShift;
+
+        Vector<Vector<BroadPhasePair>>  m_ChunkPairs;
+    };
+}
@@ -0,0 +1,666 @@
+#include "Precompile.h"
+#include "NarrowPhase.h"
+#include "Util/SimdDispatch.h"
+#include <cfloat>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ASTEROID_NARROW_PHASE_AVX
+#include <immintrin.h>
+#endif
+
+namespace ASTEROID_NAMESPACE
+{
+    /** Below this length normals are not normalized, they stay zero for centers at the same place. */
+    static const float kMinLength = 1e-6f;
+    /** Hull planes and vertices are matched within this fraction of the size of the hull. */
+    static const float kHullTolerance = 1e-4f;
+
+    /** Index of the lowest set bit, value must not be zero. */
+    static inline uint32_t FindFirstSet(uint32_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, value);
+        return index;
+#else
+        return __builtin_ctz(value);
+#endif
+    }
+
+    static inline float Dot(const Float3& a, const Float3& b)
+    {
+        return (a.x * b.x + a.y * b.y) + a.z * b.z;
+    }
+
+    static inline Float3 Subtract(const Float3& a, const Float3& b)
+    {
+        return Float3(a.x - b.x, a.y - b.y, a.z - b.z);
+    }
+
+    static inline Float3 Cross(const Float3& a, const Float3& b)
+    {
+        return Float3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+    }
+
+    // Every implementation evaluates dot products as (x * x + y * y) + z * z and normalizes by multiplying with
+    // 1 / max(length, kMinLength), so contacts match bit for bit.
+
+    static void CollideSpheresScalar(const SphereContactBatch& batch, uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            float dx = batch.startX[i] - batch.centerX[i];
+            float dy = batch.startY[i] - batch.centerY[i];
+            float dz = batch.startZ[i] - batch.centerZ[i];
+            float length = std::sqrt((dx * dx + dy * dy) + dz * dz);
+            float inverseLength = 1.0f / std::max(length, kMinLength);
+            batch.normalX[i] = dx * inverseLength;
+            batch.normalY[i] = dy * inverseLength;
+            batch.normalZ[i] = dz * inverseLength;
+            batch.separation[i] = length - (batch.radiusA[i] + batch.radiusB[i]);
+        }
+    }
+
+    /** Four pairs at a time in Vec4, SSE on x86 and NEON on ARM. */
+    static void CollideSpheresVec4(const SphereContactBatch& batch, uint32_t begin, uint32_t end)
+    {
+        const Vec4 minLength = Vec4::Splat(kMinLength);
+        const Vec4 one = Vec4::Splat(1.0f);
+
+        uint32_t i = begin;
+        for (; i + 4 <= end; i += 4)
+        {
+            Vec4 dx = Vec4::Load(batch.startX + i) - Vec4::Load(batch.centerX + i);
+            Vec4 dy = Vec4::Load(batch.startY + i) - Vec4::Load(batch.centerY + i);
+            Vec4 dz = Vec4::Load(batch.startZ + i) - Vec4::Load(batch.centerZ + i);
+            Vec4 length = Vec4::Sqrt(Vec4::MultiplyAdd(dz, dz, Vec4::MultiplyAdd(dy, dy, dx * dx)));
+            Vec4 inverseLength = one / Vec4::Max(length, minLength);
+            (dx * inverseLength).Store(batch.normalX + i);
+            (dy * inverseLength).Store(batch.normalY + i);
+            (dz * inverseLength).Store(batch.normalZ + i);
+            (length - (Vec4::Load(batch.radiusA + i) + Vec4::Load(batch.radiusB + i))).Store(batch.separation + i);
+        }
+        CollideSpheresScalar(batch, i, end);
+    }
+
+    static void CollideSphereCapsulesScalar(const SphereContactBatch& batch, uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            float cx = batch.centerX[i], cy = batch.centerY[i], cz = batch.centerZ[i];
+            float sx = batch.startX[i], sy = batch.startY[i], sz = batch.startZ[i];
+            float gx = batch.segmentX[i], gy = batch.segmentY[i], gz = batch.segmentZ[i];
+
+            // Closest point of the segment to the center of the sphere
+            float ex = cx - sx, ey = cy - sy, ez = cz - sz;
+            float segmentLengthSq = (gx * gx + gy * gy) + gz * gz;
+            float t = ((ex * gx + ey * gy) + ez * gz) / std::max(segmentLengthSq, kMinLength);
+            t = std::min(std::max(t, 0.0f), 1.0f);
+            float qx = gx * t + sx, qy = gy * t + sy, qz = gz * t + sz;
+            batch.closestX[i] = qx;
+            batch.closestY[i] = qy;
+            batch.closestZ[i] = qz;
+
+            float dx = qx - cx, dy = qy - cy, dz = qz - cz;
+            float length = std::sqrt((dx * dx + dy * dy) + dz * dz);
+            float inverseLength = 1.0f / std::max(length, kMinLength);
+            batch.normalX[i] = dx * inverseLength;
+            batch.normalY[i] = dy * inverseLength;
+            batch.normalZ[i] = dz * inverseLength;
+            batch.separation[i] = length - (batch.radiusA[i] + batch.radiusB[i]);
+        }
+    }
+
+    static void CollideSphereCapsulesVec4(const SphereContactBatch& batch, uint32_t begin, uint32_t end)
+    {
+        const Vec4 minLength = Vec4::Splat(kMinLength);
+        const Vec4 zero = Vec4::Zero();
+        const Vec4 one = Vec4::Splat(1.0f);
+
+        uint32_t i = begin;
+        for (; i + 4 <= end; i += 4)
+        {
+            Vec4 cx = Vec4::Load(batch.centerX + i), cy = Vec4::Load(batch.centerY + i), cz = Vec4::Load(batch.centerZ + i);
+            Vec4 sx = Vec4::Load(batch.startX + i), sy = Vec4::Load(batch.startY + i), sz = Vec4::Load(batch.startZ + i);
+            Vec4 gx = Vec4::Load(batch.segmentX + i), gy = Vec4::Load(batch.segmentY + i), gz = Vec4::Load(batch.segmentZ + i);
+
+            Vec4 ex = cx - sx, ey = cy - sy, ez = cz - sz;
+            Vec4 segmentLengthSq = Vec4::MultiplyAdd(gz, gz, Vec4::MultiplyAdd(gy, gy, gx * gx));
+            Vec4 t = Vec4::MultiplyAdd(ez, gz, Vec4::MultiplyAdd(ey, gy, ex * gx)) / Vec4::Max(segmentLengthSq, minLength);
+            t = Vec4::Min(Vec4::Max(t, zero), one);
+            Vec4 qx = Vec4::MultiplyAdd(gx, t, sx), qy = Vec4::MultiplyAdd(gy, t, sy), qz = Vec4::MultiplyAdd(gz, t, sz);
+            qx.Store(batch.closestX + i);
+            qy.Store(batch.closestY + i);
+            qz.Store(batch.closestZ + i);
+
+            Vec4 dx = qx - cx, dy = qy - cy, dz = qz - cz;
+            Vec4 length = Vec4::Sqrt(Vec4::MultiplyAdd(dz, dz, Vec4::MultiplyAdd(dy, dy, dx * dx)));
+            Vec4 inverseLength = one / Vec4::Max(length, minLength);
+            (dx * inverseLength).Store(batch.normalX + i);
+            (dy * inverseLength).Store(batch.normalY + i);
+            (dz * inverseLength).Store(batch.normalZ + i);
+            (length - (Vec4::Load(batch.radiusA + i) + Vec4::Load(batch.radiusB + i))).Store(batch.separation + i);
+        }
+        CollideSphereCapsulesScalar(batch, i, end);
+    }
+
+    static void SweepSpheresScalar(const SweptSphereBatch& batch, uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            float px = batch.startX[i], py = batch.startY[i], pz = batch.startZ[i];
+            float dx = batch.motionX[i], dy = batch.motionY[i], dz = batch.motionZ[i];
+            float radius = batch.radius[i];
+
+            // First root of |p + d * t| = radius
+            float a = (dx * dx + dy * dy) + dz * dz;
+            float b = (px * dx + py * dy) + pz * dz;
+            float c = ((px * px + py * py) + pz * pz) - radius * radius;
+            float discriminant = b * b - a * c;
+            // Same as (-b - sqrt(discriminant)) / a without the cancellation
+            float t = c / (std::sqrt(std::max(discriminant, 0.0f)) - b);
+            bool isHit = 0.0f < c && b < 0.0f && 0.0f <= discriminant;
+            batch.timeOfImpact[i] = isHit ? std::min(t, 1.0f) : 1.0f;
+        }
+    }
+
+    /** Lanes set in missMask get no impact. */
+    static inline void StoreTimesOfImpact(const Vec4& t, uint32_t missMask, float* timeOfImpact)
+    {
+        Vec4::Min(t, Vec4::Splat(1.0f)).Store(timeOfImpact);
+        for (uint32_t iLane = 0; iLane < 4; ++iLane)
+        {
+            if (missMask & (1 << iLane))
+                timeOfImpact[iLane] = 1.0f;
+        }
+    }
+
+    static void SweepSpheresVec4(const SweptSphereBatch& batch, uint32_t begin, uint32_t end)
+    {
+        const Vec4 zero = Vec4::Zero();
+
+        uint32_t i = begin;
+        for (; i + 4 <= end; i += 4)
+        {
+            Vec4 px = Vec4::Load(batch.startX + i), py = Vec4::Load(batch.startY + i), pz = Vec4::Load(batch.startZ + i);
+            Vec4 dx = Vec4::Load(batch.motionX + i), dy = Vec4::Load(batch.motionY + i), dz = Vec4::Load(batch.motionZ + i);
+            Vec4 radius = Vec4::Load(batch.radius + i);
+
+            Vec4 a = Vec4::MultiplyAdd(dz, dz, Vec4::MultiplyAdd(dy, dy, dx * dx));
+            Vec4 b = Vec4::MultiplyAdd(pz, dz, Vec4::MultiplyAdd(py, dy, px * dx));
+            Vec4 c = Vec4::MultiplyAdd(pz, pz, Vec4::MultiplyAdd(py, py, px * px)) - radius * radius;
+            Vec4 discriminant = b * b - a * c;
+            Vec4 t = c / (Vec4::Sqrt(Vec4::Max(discriminant, zero)) - b);
+            uint32_t missMask = Vec4::LessEqualMask(c, zero) | Vec4::LessEqualMask(zero, b) | (~Vec4::LessEqualMask(zero, discriminant) & 0xF);
+            StoreTimesOfImpact(t, missMask, batch.timeOfImpact + i);
+        }
+        SweepSpheresScalar(batch, i, end);
+    }
+
+    static void SweepSphereBoxesScalar(const SweptSphereBatch& batch, uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            float radius = batch.radius[i];
+
+            // Slabs of the grown box, a motion of 0 gives infinite times and keeps the slab if the start is in it
+            float inverseX = 1.0f / batch.motionX[i], inverseY = 1.0f / batch.motionY[i], inverseZ = 1.0f / batch.motionZ[i];
+            float extentX = batch.extentX[i] + radius, extentY = batch.extentY[i] + radius, extentZ = batch.extentZ[i] + radius;
+            float t0X = (-extentX - batch.startX[i]) * inverseX, t1X = (extentX - batch.startX[i]) * inverseX;
+            float t0Y = (-extentY - batch.startY[i]) * inverseY, t1Y = (extentY - batch.startY[i]) * inverseY;
+            float t0Z = (-extentZ - batch.startZ[i]) * inverseZ, t1Z = (extentZ - batch.startZ[i]) * inverseZ;
+            float enter = std::max(std::max(std::min(t0X, t1X), std::min(t0Y, t1Y)), std::min(t0Z, t1Z));
+            float exit = std::min(std::min(std::max(t0X, t1X), std::max(t0Y, t1Y)), std::max(t0Z, t1Z));
+            bool isHit = enter <= exit && 0.0f <= enter;
+            batch.timeOfImpact[i] = isHit ? std::min(enter, 1.0f) : 1.0f;
+        }
+    }
+
+    static void SweepSphereBoxesVec4(const SweptSphereBatch& batch, uint32_t begin, uint32_t end)
+    {
+        const Vec4 zero = Vec4::Zero();
+        const Vec4 one = Vec4::Splat(1.0f);
+
+        uint32_t i = begin;
+        for (; i + 4 <= end; i += 4)
+        {
+            Vec4 radius = Vec4::Load(batch.radius + i);
+            Vec4 inverseX = one / Vec4::Load(batch.motionX + i);
+            Vec4 inverseY = one / Vec4::Load(batch.motionY + i);
+            Vec4 inverseZ = one / Vec4::Load(batch.motionZ + i);
+            Vec4 extentX = Vec4::Load(batch.extentX + i) + radius;
+            Vec4 extentY = Vec4::Load(batch.extentY + i) + radius;
+            Vec4 extentZ = Vec4::Load(batch.extentZ + i) + radius;
+            Vec4 px = Vec4::Load(batch.startX + i), py = Vec4::Load(batch.startY + i), pz = Vec4::Load(batch.startZ + i);
+            Vec4 t0X = (-extentX - px) * inverseX, t1X = (extentX - px) * inverseX;
+            Vec4 t0Y = (-extentY - py) * inverseY, t1Y = (extentY - py) * inverseY;
+            Vec4 t0Z = (-extentZ - pz) * inverseZ, t1Z = (extentZ - pz) * inverseZ;
+            Vec4 enter = Vec4::Max(Vec4::Max(Vec4::Min(t0X, t1X), Vec4::Min(t0Y, t1Y)), Vec4::Min(t0Z, t1Z));
+            Vec4 exit = Vec4::Min(Vec4::Min(Vec4::Max(t0X, t1X), Vec4::Max(t0Y, t1Y)), Vec4::Max(t0Z, t1Z));
+            uint32_t missMask = ~(Vec4::LessEqualMask(enter, exit) & Vec4::LessEqualMask(zero, enter)) & 0xF;
+            StoreTimesOfImpact(enter, missMask, batch.timeOfImpact + i);
+        }
+        SweepSphereBoxesScalar(batch, i, end);
+    }
+
+    /** @return The largest signed distance of the point to the planes, and the first plane at that distance. */
+    static float MaxPlaneDistanceScalar(const ConvexHull& hull, float x, float y, float z, uint32_t* plane)
+    {
+        const float* planeX = hull.PlaneX();
+        const float* planeY = hull.PlaneY();
+        const float* planeZ = hull.PlaneZ();
+        const float* planeD = hull.PlaneD();
+        float maxDistance = -FLT_MAX;
+        for (uint32_t i = 0; i < hull.PlanesCount(); ++i)
+        {
+            float distance = ((planeX[i] * x + planeY[i] * y) + planeZ[i] * z) + planeD[i];
+            if (distance > maxDistance)
+            {
+                maxDistance = distance;
+                *plane = i;
+            }
+        }
+        return maxDistance;
+    }
+
+    static float MaxPlaneDistanceVec4(const ConvexHull& hull, float x, float y, float z, uint32_t* plane)
+    {
+        Vec4 px = Vec4::Splat(x), py = Vec4::Splat(y), pz = Vec4::Splat(z);
+        uint32_t paddedCount = (hull.PlanesCount() + ConvexHull::kPlanesAlignment - 1) & ~(ConvexHull::kPlanesAlignment - 1);
+
+        // The maximum first, then the first plane reaching it, which is the plane the scalar loop keeps
+        Vec4 maxDistances = Vec4::Splat(-FLT_MAX);
+        for (uint32_t i = 0; i < paddedCount; i += 4)
+        {
+            Vec4 distance = Vec4::MultiplyAdd(Vec4::Load(hull.PlaneZ() + i), pz,
+                Vec4::MultiplyAdd(Vec4::Load(hull.PlaneY() + i), py, Vec4::Load(hull.PlaneX() + i) * px)) + Vec4::Load(hull.PlaneD() + i);
+            maxDistances = Vec4::Max(maxDistances, distance);
+        }
+        float maxDistance = std::max(std::max(maxDistances.X(), maxDistances.Y()), std::max(maxDistances.Z(), maxDistances.W()));
+
+        Vec4 splatMax = Vec4::Splat(maxDistance);
+        for (uint32_t i = 0; i < paddedCount; i += 4)
+        {
+            Vec4 distance = Vec4::MultiplyAdd(Vec4::Load(hull.PlaneZ() + i), pz,
+                Vec4::MultiplyAdd(Vec4::Load(hull.PlaneY() + i), py, Vec4::Load(hull.PlaneX() + i) * px)) + Vec4::Load(hull.PlaneD() + i);
+            uint32_t mask = Vec4::LessEqualMask(splatMax, distance);
+            if (mask != 0)
+            {
+                *plane = i + FindFirstSet(mask);
+                break;
+            }
+        }
+        return maxDistance;
+    }
+
+#ifdef ASTEROID_NARROW_PHASE_AVX
+    ASTEROID_TARGET_AVX2
+    static void CollideSpheresAVX2(const SphereContactBatch& batch, uint32_t begin, uint32_t end)
+    {
+        const __m256 minLength = _mm256_set1_ps(kMinLength);
+        const __m256 one = _mm256_set1_ps(1.0f);
+
+        uint32_t i = begin;
+        for (; i + 8 <= end; i += 8)
+        {
+            __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(batch.startX + i), _mm256_loadu_ps(batch.centerX + i));
+            __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(batch.startY + i), _mm256_loadu_ps(batch.centerY + i));
+            __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(batch.startZ + i), _mm256_loadu_ps(batch.centerZ + i));
+            __m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)));
+            __m256 inverseLength = _mm256_div_ps(one, _mm256_max_ps(length, minLength));
+            _mm256_storeu_ps(batch.normalX + i, _mm256_mul_ps(dx, inverseLength));
+            _mm256_storeu_ps(batch.normalY + i, _mm256_mul_ps(dy, inverseLength));
+            _mm256_storeu_ps(batch.normalZ + i, _mm256_mul_ps(dz, inverseLength));
+            _mm256_storeu_ps(batch.separation + i,
+                _mm256_sub_ps(length, _mm256_add_ps(_mm256_loadu_ps(batch.radiusA + i), _mm256_loadu_ps(batch.radiusB + i))));
+        }
+        CollideSpheresVec4(batch, i, end);
+    }
+
+    ASTEROID_TARGET_AVX2
+    static void CollideSphereCapsulesAVX2(const SphereContactBatch& batch, uint32_t begin, uint32_t end)
+    {
+        const __m256 minLength = _mm256_set1_ps(kMinLength);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+
+        uint32_t i = begin;
+        for (; i + 8 <= end; i += 8)
+        {
+            __m256 cx = _mm256_loadu_ps(batch.centerX + i), cy = _mm256_loadu_ps(batch.centerY + i), cz = _mm256_loadu_ps(batch.centerZ + i);
+            __m256 sx = _mm256_loadu_ps(batch.startX + i), sy = _mm256_loadu_ps(batch.startY + i), sz = _mm256_loadu_ps(batch.startZ + i);
+            __m256 gx = _mm256_loadu_ps(batch.segmentX + i), gy = _mm256_loadu_ps(batch.segmentY + i), gz = _mm256_loadu_ps(batch.segmentZ + i);
+
+            __m256 ex = _mm256_sub_ps(cx, sx), ey = _mm256_sub_ps(cy, sy), ez = _mm256_sub_ps(cz, sz);
+            __m256 segmentLengthSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(gx, gx), _mm256_mul_ps(gy, gy)), _mm256_mul_ps(gz, gz));
+            __m256 t = _mm256_div_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, gx), _mm256_mul_ps(ey, gy)), _mm256_mul_ps(ez, gz)),
+                _mm256_max_ps(segmentLengthSq, minLength));
+            t = _mm256_min_ps(_mm256_max_ps(t, zero), one);
+            __m256 qx = _mm256_add_ps(_mm256_mul_ps(gx, t), sx);
+            __m256 qy = _mm256_add_ps(_mm256_mul_ps(gy, t), sy);
+            __m256 qz = _mm256_add_ps(_mm256_mul_ps(gz, t), sz);
+            _mm256_storeu_ps(batch.closestX + i, qx);
+            _mm256_storeu_ps(batch.closestY + i, qy);
+            _mm256_storeu_ps(batch.closestZ + i, qz);
+
+            __m256 dx = _mm256_sub_ps(qx, cx), dy = _mm256_sub_ps(qy, cy), dz = _mm256_sub_ps(qz, cz);
+            __m256 length = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz)));
+            __m256 inverseLength = _mm256_div_ps(one, _mm256_max_ps(length, minLength));
+            _mm256_storeu_ps(batch.normalX + i, _mm256_mul_ps(dx, inverseLength));
+            _mm256_storeu_ps(batch.normalY + i, _mm256_mul_ps(dy, inverseLength));
+            _mm256_storeu_ps(batch.normalZ + i, _mm256_mul_ps(dz, inverseLength));
+            _mm256_storeu_ps(batch.separation + i,
+                _mm256_sub_ps(length, _mm256_add_ps(_mm256_loadu_ps(batch.radiusA + i), _mm256_loadu_ps(batch.radiusB + i))));
+        }
+        CollideSphereCapsulesVec4(batch, i, end);
+    }
+
+    ASTEROID_TARGET_AVX2
+    static void SweepSpheresAVX2(const SweptSphereBatch& batch, uint32_t begin, uint32_t end)
+    {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+
+        uint32_t i = begin;
+        for (; i + 8 <= end; i += 8)
+        {
+            __m256 px = _mm256_loadu_ps(batch.startX + i), py = _mm256_loadu_ps(batch.startY + i), pz = _mm256_loadu_ps(batch.startZ + i);
+            __m256 dx = _mm256_loadu_ps(batch.motionX + i), dy = _mm256_loadu_ps(batch.motionY + i), dz = _mm256_loadu_ps(batch.motionZ + i);
+            __m256 radius = _mm256_loadu_ps(batch.radius + i);
+
+            __m256 a = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+            __m256 b = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px, dx), _mm256_mul_ps(py, dy)), _mm256_mul_ps(pz, dz));
+            __m256 c = _mm256_sub_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px, px), _mm256_mul_ps(py, py)), _mm256_mul_ps(pz, pz)),
+                _mm256_mul_ps(radius, radius));
+            __m256 discriminant = _mm256_sub_ps(_mm256_mul_ps(b, b), _mm256_mul_ps(a, c));
+            __m256 t = _mm256_div_ps(c, _mm256_sub_ps(_mm256_sqrt_ps(_mm256_max_ps(discriminant, zero)), b));
+            __m256 isHit = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(zero, c, _CMP_LT_OQ), _mm256_cmp_ps(b, zero, _CMP_LT_OQ)),
+                _mm256_cmp_ps(zero, discriminant, _CMP_LE_OQ));
+            _mm256_storeu_ps(batch.timeOfImpact + i, _mm256_blendv_ps(one, _mm256_min_ps(t, one), isHit));
+        }
+        SweepSpheresVec4(batch, i, end);
+    }
+
+    ASTEROID_TARGET_AVX2
+    static void SweepSphereBoxesAVX2(const SweptSphereBatch& batch, uint32_t begin, uint32_t end)
+    {
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+
+        uint32_t i = begin;
+        for (; i + 8 <= end; i += 8)
+        {
+            __m256 radius = _mm256_loadu_ps(batch.radius + i);
+            __m256 inverseX = _mm256_div_ps(one, _mm256_loadu_ps(batch.motionX + i));
+            __m256 inverseY = _mm256_div_ps(one, _mm256_loadu_ps(batch.motionY + i));
+            __m256 inverseZ = _mm256_div_ps(one, _mm256_loadu_ps(batch.motionZ + i));
+            __m256 extentX = _mm256_add_ps(_mm256_loadu_ps(batch.extentX + i), radius);
+            __m256 extentY = _mm256_add_ps(_mm256_loadu_ps(batch.extentY + i), radius);
+            __m256 extentZ = _mm256_add_ps(_mm256_loadu_ps(batch.extentZ + i), radius);
+            __m256 px = _mm256_loadu_ps(batch.startX + i), py = _mm256_loadu_ps(batch.startY + i), pz = _mm256_loadu_ps(batch.startZ + i);
+            __m256 negative = _mm256_set1_ps(-0.0f);
+            __m256 t0X = _mm256_mul_ps(_mm256_sub_ps(_mm256_xor_ps(extentX, negative), px), inverseX);
+            __m256 t1X = _mm256_mul_ps(_mm256_sub_ps(extentX, px), inverseX);
+            __m256 t0Y = _mm256_mul_ps(_mm256_sub_ps(_mm256_xor_ps(extentY, negative), py), inverseY);
+            __m256 t1Y = _mm256_mul_ps(_mm256_sub_ps(extentY, py), inverseY);
+            __m256 t0Z = _mm256_mul_ps(_mm256_sub_ps(_mm256_xor_ps(extentZ, negative), pz), inverseZ);
+            __m256 t1Z = _mm256_mul_ps(_mm256_sub_ps(extentZ, pz), inverseZ);
+            __m256 enter = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(t0X, t1X), _mm256_min_ps(t0Y, t1Y)), _mm256_min_ps(t0Z, t1Z));
+            __m256 exit = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(t0X, t1X), _mm256_max_ps(t0Y, t1Y)), _mm256_max_ps(t0Z, t1Z));
+            __m256 isHit = _mm256_and_ps(_mm256_cmp_ps(enter, exit, _CMP_LE_OQ), _mm256_cmp_ps(zero, enter, _CMP_LE_OQ));
+            _mm256_storeu_ps(batch.timeOfImpact + i, _mm256_blendv_ps(one, _mm256_min_ps(enter, one), isHit));
+        }
+        SweepSphereBoxesVec4(batch, i, end);
+    }
+
+    ASTEROID_TARGET_AVX2
+    static float MaxPlaneDistanceAVX2(const ConvexHull& hull, float x, float y, float z, uint32_t* plane)
+    {
+        __m256 px = _mm256_set1_ps(x), py = _mm256_set1_ps(y), pz = _mm256_set1_ps(z);
+        uint32_t paddedCount = (hull.PlanesCount() + ConvexHull::kPlanesAlignment - 1) & ~(ConvexHull::kPlanesAlignment - 1);
+
+        __m256 maxDistances = _mm256_set1_ps(-FLT_MAX);
+        for (uint32_t i = 0; i < paddedCount; i += 8)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_load_ps(hull.PlaneX() + i), px),
+                _mm256_mul_ps(_mm256_load_ps(hull.PlaneY() + i), py)), _mm256_mul_ps(_mm256_load_ps(hull.PlaneZ() + i), pz)),
+                _mm256_load_ps(hull.PlaneD() + i));
+            maxDistances = _mm256_max_ps(maxDistances, distance);
+        }
+        __m128 max4 = _mm_max_ps(_mm256_castps256_ps128(maxDistances), _mm256_extractf128_ps(maxDistances, 1));
+        max4 = _mm_max_ps(max4, _mm_shuffle_ps(max4, max4, _MM_SHUFFLE(1, 0, 3, 2)));
+        max4 = _mm_max_ps(max4, _mm_shuffle_ps(max4, max4, _MM_SHUFFLE(2, 3, 0, 1)));
+        float maxDistance = _mm_cvtss_f32(max4);
+
+        __m256 splatMax = _mm256_set1_ps(maxDistance);
+        for (uint32_t i = 0; i < paddedCount; i += 8)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_load_ps(hull.PlaneX() + i), px),
+                _mm256_mul_ps(_mm256_load_ps(hull.PlaneY() + i), py)), _mm256_mul_ps(_mm256_load_ps(hull.PlaneZ() + i), pz)),
+                _mm256_load_ps(hull.PlaneD() + i));
+            uint32_t mask = (uint32_t)_mm256_movemask_ps(_mm256_cmp_ps(splatMax, distance, _CMP_LE_OQ));
+            if (mask != 0)
+            {
+                *plane = i + FindFirstSet(mask);
+                break;
+            }
+        }
+        return maxDistance;
+    }
+#endif
+
+    using CollideFunction = void(*)(const SphereContactBatch& batch, uint32_t begin, uint32_t end);
+    using SweepFunction = void(*)(const SweptSphereBatch& batch, uint32_t begin, uint32_t end);
+    using MaxPlaneDistanceFunction = float(*)(const ConvexHull& hull, float x, float y, float z, uint32_t* plane);
+#ifdef ASTEROID_NARROW_PHASE_AVX
+    static SimdKernel<CollideFunction> CollideSpheresKernel("NarrowPhase.CollideSpheres",
+        CollideSpheresScalar, CollideSpheresVec4, CollideSpheresAVX2);
+    static SimdKernel<CollideFunction> CollideSphereCapsulesKernel("NarrowPhase.CollideSphereCapsules",
+        CollideSphereCapsulesScalar, CollideSphereCapsulesVec4, CollideSphereCapsulesAVX2);
+    static SimdKernel<SweepFunction> SweepSpheresKernel("NarrowPhase.SweepSpheres",
+        SweepSpheresScalar, SweepSpheresVec4, SweepSpheresAVX2);
+    static SimdKernel<SweepFunction> SweepSphereBoxesKernel("NarrowPhase.SweepSphereBoxes",
+        SweepSphereBoxesScalar, SweepSphereBoxesVec4, SweepSphereBoxesAVX2);
+    static SimdKernel<MaxPlaneDistanceFunction> MaxPlaneDistance("NarrowPhase.MaxPlaneDistance",
+        MaxPlaneDistanceScalar, MaxPlaneDistanceVec4, MaxPlaneDistanceAVX2);
+#else
+    static SimdKernel<CollideFunction> CollideSpheresKernel("NarrowPhase.CollideSpheres",
+        CollideSpheresScalar, CollideSpheresVec4);
+    static SimdKernel<CollideFunction> CollideSphereCapsulesKernel("NarrowPhase.CollideSphereCapsules",
+        CollideSphereCapsulesScalar, CollideSphereCapsulesVec4);
+    static SimdKernel<SweepFunction> SweepSpheresKernel("NarrowPhase.SweepSpheres",
+        SweepSpheresScalar, SweepSpheresVec4);
+    static SimdKernel<SweepFunction> SweepSphereBoxesKernel("NarrowPhase.SweepSphereBoxes",
+        SweepSphereBoxesScalar, SweepSphereBoxesVec4);
+    static SimdKernel<MaxPlaneDistanceFunction> MaxPlaneDistance("NarrowPhase.MaxPlaneDistance",
+        MaxPlaneDistanceScalar, MaxPlaneDistanceVec4);
+#endif
+
+
+    bool ConvexHull::Build(const Float3* points, uint32_t count)
+    {
+        if (count < 4 || count > kMaxPointsCount)
+            return false;
+
+        float size = 0.0f;
+        for (uint32_t i = 1; i < count; ++i)
+        {
+            Float3 offset = Subtract(points[i], points[0]);
+            size = std::max(size, Dot(offset, offset));
+        }
+        float tolerance = kHullTolerance * std::sqrt(size);
+
+        // Faces are the planes through three points with no point in front
+        Vector<Float4> planes;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            for (uint32_t j = i + 1; j < count; ++j)
+            {
+                for (uint32_t k = j + 1; k < count; ++k)
+                {
+                    Float3 normal = Cross(Subtract(points[j], points[i]), Subtract(points[k], points[i]));
+                    float length = std::sqrt(Dot(normal, normal));
+                    if (length <= tolerance * tolerance)
+                        continue;
+                    normal = Float3(normal.x / length, normal.y / length, normal.z / length);
+                    float d = -Dot(normal, points[i]);
+
+                    bool hasFront = false, hasBack = false;
+                    for (uint32_t iPoint = 0; iPoint < count && !(hasFront && hasBack); ++iPoint)
+                    {
+                        float distance = Dot(normal, points[iPoint]) + d;
+                        hasFront |= distance > tolerance;
+                        hasBack |= distance < -tolerance;
+                    }
+                    if (hasFront && hasBack)
+                        continue;
+                    if (hasFront)
+                    {
+                        normal = Float3(-normal.x, -normal.y, -normal.z);
+                        d = -d;
+                    }
+
+                    bool isDuplicate = false;
+                    for (const Float4& plane : planes)
+                        isDuplicate |= Dot(normal, Float3(plane.x, plane.y, plane.z)) > 1.0f - kHullTolerance && std::abs(d - plane.w) <= tolerance;
+                    if (!isDuplicate)
+                        planes.push_back(Float4(normal.x, normal.y, normal.z, d));
+                }
+            }
+        }
+        // Points in a plane only have the two sides of that plane
+        if (planes.size() < 4)
+            return false;
+
+        // Corners are the points on three faces at least
+        Vector<uint32_t> vertexPlanes;
+        m_Vertices.clear();
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            bool isDuplicate = false;
+            for (const Float3& vertex : m_Vertices)
+            {
+                Float3 offset = Subtract(vertex, points[i]);
+                isDuplicate |= Dot(offset, offset) <= tolerance * tolerance;
+            }
+
+            uint32_t planesCount = 0;
+            for (const Float4& plane : planes)
+                planesCount += std::abs(Dot(Float3(plane.x, plane.y, plane.z), points[i]) + plane.w) <= tolerance;
+            if (!isDuplicate && planesCount >= 3)
+                m_Vertices.push_back(points[i]);
+        }
+
+        // Edges are the pairs of corners sharing two faces
+        m_Edges.clear();
+        for (uint32_t a = 0; a < m_Vertices.size(); ++a)
+        {
+            for (uint32_t b = a + 1; b < m_Vertices.size(); ++b)
+            {
+                uint32_t sharedCount = 0;
+                for (const Float4& plane : planes)
+                {
+                    Float3 normal(plane.x, plane.y, plane.z);
+                    sharedCount += std::abs(Dot(normal, m_Vertices[a]) + plane.w) <= tolerance &&
+                        std::abs(Dot(normal, m_Vertices[b]) + plane.w) <= tolerance;
+                }
+                if (sharedCount >= 2)
+                    m_Edges.push_back({ (uint8_t)a, (uint8_t)b });
+            }
+        }
+
+        m_BoundingRadius = 0.0f;
+        for (const Float3& vertex : m_Vertices)
+            m_BoundingRadius = std::max(m_BoundingRadius, std::sqrt(Dot(vertex, vertex)));
+
+        m_PlanesCount = (uint32_t)planes.size();
+        uint32_t paddedCount = (m_PlanesCount + kPlanesAlignment - 1) & ~(kPlanesAlignment - 1);
+        // Padding planes are at -FLT_MAX from every point
+        m_PlaneX.assign(paddedCount, 0.0f);
+        m_PlaneY.assign(paddedCount, 0.0f);
+        m_PlaneZ.assign(paddedCount, 0.0f);
+        m_PlaneD.assign(paddedCount, -FLT_MAX);
+        for (uint32_t i = 0; i < m_PlanesCount; ++i)
+        {
+            m_PlaneX[i] = planes[i].x;
+            m_PlaneY[i] = planes[i].y;
+            m_PlaneZ[i] = planes[i].z;
+            m_PlaneD[i] = planes[i].w;
+        }
+        return true;
+    }
+
+
+    void NarrowPhase::CollideSpheres(const SphereContactBatch& batch, uint32_t count)
+    {
+        CollideSpheresKernel(batch, 0, count);
+    }
+
+    void NarrowPhase::CollideSphereCapsules(const SphereContactBatch& batch, uint32_t count)
+    {
+        CollideSphereCapsulesKernel(batch, 0, count);
+    }
+
+    void NarrowPhase::SweepSpheres(const SweptSphereBatch& batch, uint32_t count)
+    {
+        SweepSpheresKernel(batch, 0, count);
+    }
+
+    void NarrowPhase::SweepSphereBoxes(const SweptSphereBatch& batch, uint32_t count)
+    {
+        SweepSphereBoxesKernel(batch, 0, count);
+    }
+
+    bool NarrowPhase::CollideSphereHull(const ConvexHull& hull, const Float3& center, float radius, float maxSeparation,
+        Float3* normal, Float3* point, float* separation)
+    {
+        uint32_t face = 0;
+        float faceDistance = MaxPlaneDistance(hull, center.x, center.y, center.z, &face);
+        if (faceDistance - radius > maxSeparation)
+            return false;
+
+        // The hull is behind every face plane, so the distance to the hull is at least the largest plane distance.
+        // It is exactly that distance if the projection on that face is inside the hull, otherwise the closest
+        // point is on an edge.
+        Float3 faceNormal(hull.PlaneX()[face], hull.PlaneY()[face], hull.PlaneZ()[face]);
+        Float3 closest(center.x - faceNormal.x * faceDistance, center.y - faceNormal.y * faceDistance, center.z - faceNormal.z * faceDistance);
+        Float3 outward = faceNormal;
+        float distance = faceDistance;
+        uint32_t unused;
+        if (faceDistance > 0.0f && MaxPlaneDistance(hull, closest.x, closest.y, closest.z, &unused) > kHullTolerance * hull.BoundingRadius())
+        {
+            float minDistanceSq = FLT_MAX;
+            const Vector<Float3>& vertices = hull.Vertices();
+            for (const ConvexHull::Edge& edge : hull.Edges())
+            {
+                const Float3& start = vertices[edge.a];
+                Float3 segment = Subtract(vertices[edge.b], start);
+                float t = Dot(Subtract(center, start), segment) / std::max(Dot(segment, segment), kMinLength);
+                t = std::min(std::max(t, 0.0f), 1.0f);
+                Float3 edgePoint(segment.x * t + start.x, segment.y * t + start.y, segment.z * t + start.z);
+                Float3 offset = Subtract(center, edgePoint);
+                float distanceSq = Dot(offset, offset);
+                if (distanceSq < minDistanceSq)
+                {
+                    minDistanceSq = distanceSq;
+                    closest = edgePoint;
+                }
+            }
+
+            distance = std::sqrt(minDistanceSq);
+            if (distance - radius > maxSeparation)
+                return false;
+            if (distance > kMinLength)
+            {
+                Float3 offset = Subtract(center, closest);
+                outward = Float3(offset.x / distance, offset.y / distance, offset.z / distance);
+            }
+        }
+
+        *separation = distance - radius;
+        *normal = Float3(-outward.x, -outward.y, -outward.z);
+        float halfSeparation = 0.5f * *separation;
+        *point = Float3(closest.x + outward.x * halfSeparation, closest.y + outward.y * halfSeparation, closest.z + outward.z * halfSeparation);
+        return true;
+    }
+}
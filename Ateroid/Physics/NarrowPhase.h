@@ -0,0 +1,174 @@
+#pragma once
+
+#include "Math/SimdMath.h"
+#include "Util/Containers.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    enum class EShapeType : uint8_t
+    {
+        eSphere,
+        /** Two hemispheres joined by a cylinder, along the local y axis. */
+        eCapsule,
+        eConvexHull
+    };
+
+
+    /**
+     *  A convex polyhedron in the local space of the bodies using it, built from a cloud of points.\n
+     *  Faces are kept as SoA planes for the SIMD distance tests, and edges for the closest points of spheres
+     *  facing an edge or a corner.
+     */
+    class ConvexHull
+    {
+    public:
+        /** Points a hull is built from at most, building is O(n^4). */
+        static const uint32_t kMaxPointsCount = 64;
+        /** Plane arrays are padded to a multiple of this with planes no point is in front of. */
+        static const uint32_t kPlanesAlignment = 8;
+
+        struct Edge
+        {
+            uint8_t a;
+            uint8_t b;
+        };
+
+    public:
+        ConvexHull() : m_PlanesCount(0), m_BoundingRadius(0.0f) {}
+
+        /**
+         *  Build the hull of points, points inside the hull are dropped.
+         *  @param points
+         *      In the local space of the bodies, whose origin is their center of mass.
+         *  @return
+         *      False if there are more than kMaxPointsCount points or if they are all in a plane.
+         */
+        bool Build(const Float3* points, uint32_t count);
+
+        uint32_t PlanesCount() const { return m_PlanesCount; }
+        /** Unit outward normals and offsets, a point p is in front of plane i if Dot(normal, p) + d > 0. */
+        const float* PlaneX() const { return m_PlaneX.data(); }
+        const float* PlaneY() const { return m_PlaneY.data(); }
+        const float* PlaneZ() const { return m_PlaneZ.data(); }
+        const float* PlaneD() const { return m_PlaneD.data(); }
+
+        const Vector<Float3>& Vertices() const { return m_Vertices; }
+        /** Pairs of indices in Vertices(). */
+        const Vector<Edge>& Edges() const { return m_Edges; }
+        /** Distance of the farthest vertex from the origin. */
+        float BoundingRadius() const { return m_BoundingRadius; }
+
+    private:
+        uint32_t            m_PlanesCount;
+        VectorA<float, 32>  m_PlaneX;
+        VectorA<float, 32>  m_PlaneY;
+        VectorA<float, 32>  m_PlaneZ;
+        VectorA<float, 32>  m_PlaneD;
+        Vector<Float3>      m_Vertices;
+        Vector<Edge>        m_Edges;
+        float               m_BoundingRadius;
+    };
+
+
+    /**
+     *  SoA arrays of pairs of a sphere A against a sphere or a capsule B, in world space.
+     *  Inputs are read and outputs written for indices [0, count).
+     */
+    struct SphereContactBatch
+    {
+        const float*    centerX;
+        const float*    centerY;
+        const float*    centerZ;
+        const float*    radiusA;
+        /** Center of sphere B, or the start of the segment of capsule B. */
+        const float*    startX;
+        const float*    startY;
+        const float*    startZ;
+        /** End minus start of the segment of capsule B, unused for spheres. */
+        const float*    segmentX;
+        const float*    segmentY;
+        const float*    segmentZ;
+        const float*    radiusB;
+
+        /** Unit normal from A to B, zero if the centers are at the same place. */
+        float*          normalX;
+        float*          normalY;
+        float*          normalZ;
+        /** Distance between the surfaces, negative when they penetrate. */
+        float*          separation;
+        /** Point of the center or segment of B closest to A, only written for capsules. */
+        float*          closestX;
+        float*          closestY;
+        float*          closestZ;
+    };
+
+
+    /**
+     *  SoA arrays of spheres A moving past shapes B during a step, in the frame of B.
+     *  Inputs are read and outputs written for indices [0, count).
+     */
+    struct SweptSphereBatch
+    {
+        /** Center of A relative to the center of B at the start of the step. */
+        const float*    startX;
+        const float*    startY;
+        const float*    startZ;
+        /** Motion of A relative to B during the step. */
+        const float*    motionX;
+        const float*    motionY;
+        const float*    motionZ;
+        /** Radius of A, plus the radius of B for spheres. */
+        const float*    radius;
+        /** Half extents of box B, unused for spheres. */
+        const float*    extentX;
+        const float*    extentY;
+        const float*    extentZ;
+
+        /** Fraction of the motion before A touches B, 1 if A misses B or already touches it at the start. */
+        float*          timeOfImpact;
+    };
+
+
+    /**
+     *  Contact generation between pairs of shapes, the second pass of collision detection after BroadPhase.\n
+     *  Sphere pairs are batched in SoA arrays and computed several pairs at a time with SimdKernels. Spheres
+     *  against hulls test the sphere against several planes of the hull at a time instead. Swept spheres of
+     *  continuous collision detection are batched like sphere pairs. Every level computes the same operations
+     *  in the same order, so contacts are identical whichever implementation runs.
+     *  @remarks
+     *      Functions run on the calling thread and can run on several threads at once.
+     */
+    class NarrowPhase
+    {
+    public:
+        ASTEROID_NO_DEFAULT_CTOR(NarrowPhase)
+        ASTEROID_NON_COPYABLE(NarrowPhase)
+
+        static void CollideSpheres(const SphereContactBatch& batch, uint32_t count);
+        static void CollideSphereCapsules(const SphereContactBatch& batch, uint32_t count);
+
+        /**
+         *  Times of impact of spheres swept against spheres, for continuous collision detection.
+         */
+        static void SweepSpheres(const SweptSphereBatch& batch, uint32_t count);
+        /**
+         *  Times of impact of spheres swept against axis-aligned boxes. The box grown by the radius stands for
+         *  the rounded box, so spheres heading to a corner stop a little early.
+         */
+        static void SweepSphereBoxes(const SweptSphereBatch& batch, uint32_t count);
+
+        /**
+         *  Contact between a sphere A and a hull B, in the local space of the hull.
+         *  @param maxSeparation
+         *      Farthest the sphere may be from the hull for a contact.
+         *  @param normal
+         *      Unit normal from the sphere to the hull.
+         *  @param point
+         *      Halfway between the surfaces.
+         *  @return
+         *      False if the sphere is farther than maxSeparation, outputs are not written then.
+         */
+        static bool CollideSphereHull(const ConvexHull& hull, const Float3& center, float radius, float maxSeparation,
+            Float3* normal, Float3* point, float* separation);
+    };
+}
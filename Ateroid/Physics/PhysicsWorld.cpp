@@ -0,0 +1,1161 @@
+#include "Precompile.h"
+#include "PhysicsWorld.h"
+#include "Core/JobSystem.h"
+#include "Math/FixedPoint.h"
+#include "Util/Debug.h"
+#include "Util/Hash.h"
+#include "Util/SimdDispatch.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ASTEROID_PHYSICS_WORLD_AVX
+#include <immintrin.h>
+#endif
+
+namespace ASTEROID_NAMESPACE
+{
+    /** Pairs per narrow-phase job. */
+    static const uint32_t kNarrowPhaseChunkSize = 256;
+    /** Bodies per integration job. */
+    static const uint32_t kIntegrationChunkSize = 1024;
+    /** Constraints per solver job. */
+    static const uint32_t kSolverChunkSize = 128;
+    /** Penetration left alone, so resting contacts don't jitter. */
+    static const float kLinearSlop = 0.01f;
+    /** Fraction of the penetration beyond the slop removed per step. */
+    static const float kBaumgarteFactor = 0.2f;
+    /** Fastest speed penetrating bodies are pushed apart at. */
+    static const float kMaxCorrectionSpeed = 5.0f;
+    /** Bodies approaching slower than this don't bounce, so resting contacts settle. */
+    static const float kRestitutionSpeed = 1.0f;
+    /** Moment of inertia of a solid sphere of mass 1 and radius 1. */
+    static const float kSphereInertia = 0.4f;
+
+    /** Index of the lowest set bit, value must not be zero. */
+    static inline uint32_t FindFirstSet64(uint64_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return index;
+#else
+        return __builtin_ctzll(value);
+#endif
+    }
+
+    /** Unit local y axis of capsules rotated by a quaternion. */
+    static inline Float3 RotatedAxisY(float x, float y, float z, float w)
+    {
+        return Float3(2.0f * (x * y - w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + w * x));
+    }
+
+    /** The arrays the integration kernels read and write, indexed by body. */
+    struct IntegrationArrays
+    {
+        float*  positionX;
+        float*  positionY;
+        float*  positionZ;
+        float*  rotationX;
+        float*  rotationY;
+        float*  rotationZ;
+        float*  rotationW;
+        float*  linearVelocityX;
+        float*  linearVelocityY;
+        float*  linearVelocityZ;
+        float*  angularVelocityX;
+        float*  angularVelocityY;
+        float*  angularVelocityZ;
+    };
+
+    // Every implementation evaluates the same operations in the same order without fused multiply-adds, so bodies
+    // move the same whichever implementation runs.
+
+    /** v = (v + gravity * dt) * linearDamping and w = w * angularDamping. */
+    static void IntegrateVelocitiesScalar(const IntegrationArrays& arrays, uint32_t begin, uint32_t end, const Float3& gravityStep,
+        float linearDamping, float angularDamping)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            arrays.linearVelocityX[i] = (arrays.linearVelocityX[i] + gravityStep.x) * linearDamping;
+            arrays.linearVelocityY[i] = (arrays.linearVelocityY[i] + gravityStep.y) * linearDamping;
+            arrays.linearVelocityZ[i] = (arrays.linearVelocityZ[i] + gravityStep.z) * linearDamping;
+            arrays.angularVelocityX[i] *= angularDamping;
+            arrays.angularVelocityY[i] *= angularDamping;
+            arrays.angularVelocityZ[i] *= angularDamping;
+        }
+    }
+
+    /** Four bodies at a time in Vec4, SSE on x86 and NEON on ARM. */
+    static void IntegrateVelocitiesVec4(const IntegrationArrays& arrays, uint32_t begin, uint32_t end, const Float3& gravityStep,
+        float linearDamping, float angularDamping)
+    {
+        Vec4 gx = Vec4::Splat(gravityStep.x), gy = Vec4::Splat(gravityStep.y), gz = Vec4::Splat(gravityStep.z);
+        Vec4 linear = Vec4::Splat(linearDamping), angular = Vec4::Splat(angularDamping);
+
+        uint32_t i = begin;
+        for (; i + 4 <= end; i += 4)
+        {
+            ((Vec4::Load(arrays.linearVelocityX + i) + gx) * linear).Store(arrays.linearVelocityX + i);
+            ((Vec4::Load(arrays.linearVelocityY + i) + gy) * linear).Store(arrays.linearVelocityY + i);
+            ((Vec4::Load(arrays.linearVelocityZ + i) + gz) * linear).Store(arrays.linearVelocityZ + i);
+            (Vec4::Load(arrays.angularVelocityX + i) * angular).Store(arrays.angularVelocityX + i);
+            (Vec4::Load(arrays.angularVelocityY + i) * angular).Store(arrays.angularVelocityY + i);
+            (Vec4::Load(arrays.angularVelocityZ + i) * angular).Store(arrays.angularVelocityZ + i);
+        }
+        IntegrateVelocitiesScalar(arrays, i, end, gravityStep, linearDamping, angularDamping);
+    }
+
+    /**
+     *  p = v * dt + p, and q = q + 0.5 * dt * (w, 0) * q normalized.
+     */
+    static void IntegratePositionsScalar(const IntegrationArrays& arrays, uint32_t begin, uint32_t end, float timestep)
+    {
+        float halfTimestep = 0.5f * timestep;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            arrays.positionX[i] = arrays.linearVelocityX[i] * timestep + arrays.positionX[i];
+            arrays.positionY[i] = arrays.linearVelocityY[i] * timestep + arrays.positionY[i];
+            arrays.positionZ[i] = arrays.linearVelocityZ[i] * timestep + arrays.positionZ[i];
+
+            float wx = arrays.angularVelocityX[i], wy = arrays.angularVelocityY[i], wz = arrays.angularVelocityZ[i];
+            float qx = arrays.rotationX[i], qy = arrays.rotationY[i], qz = arrays.rotationZ[i], qw = arrays.rotationW[i];
+            float x = ((wx * qw + wy * qz) - wz * qy) * halfTimestep + qx;
+            float y = ((wy * qw + wz * qx) - wx * qz) * halfTimestep + qy;
+            float z = ((wz * qw + wx * qy) - wy * qx) * halfTimestep + qz;
+            float w = qw - ((wx * qx + wy * qy) + wz * qz) * halfTimestep;
+            float inverseLength = 1.0f / std::sqrt(((x * x + y * y) + z * z) + w * w);
+            arrays.rotationX[i] = x * inverseLength;
+            arrays.rotationY[i] = y * inverseLength;
+            arrays.rotationZ[i] = z * inverseLength;
+            arrays.rotationW[i] = w * inverseLength;
+        }
+    }
+
+    static void IntegratePositionsVec4(const IntegrationArrays& arrays, uint32_t begin, uint32_t end, float timestep)
+    {
+        Vec4 dt = Vec4::Splat(timestep), halfDt = Vec4::Splat(0.5f * timestep), one = Vec4::Splat(1.0f);
+
+        uint32_t i = begin;
+        for (; i + 4 <= end; i += 4)
+        {
+            Vec4::MultiplyAdd(Vec4::Load(arrays.linearVelocityX + i), dt, Vec4::Load(arrays.positionX + i)).Store(arrays.positionX + i);
+            Vec4::MultiplyAdd(Vec4::Load(arrays.linearVelocityY + i), dt, Vec4::Load(arrays.positionY + i)).Store(arrays.positionY + i);
+            Vec4::MultiplyAdd(Vec4::Load(arrays.linearVelocityZ + i), dt, Vec4::Load(arrays.positionZ + i)).Store(arrays.positionZ + i);
+
+            Vec4 wx = Vec4::Load(arrays.angularVelocityX + i), wy = Vec4::Load(arrays.angularVelocityY + i), wz = Vec4::Load(arrays.angularVelocityZ + i);
+            Vec4 qx = Vec4::Load(arrays.rotationX + i), qy = Vec4::Load(arrays.rotationY + i);
+            Vec4 qz = Vec4::Load(arrays.rotationZ + i), qw = Vec4::Load(arrays.rotationW + i);
+            Vec4 x = Vec4::MultiplyAdd(Vec4::MultiplyAdd(wy, qz, wx * qw) - wz * qy, halfDt, qx);
+            Vec4 y = Vec4::MultiplyAdd(Vec4::MultiplyAdd(wz, qx, wy * qw) - wx * qz, halfDt, qy);
+            Vec4 z = Vec4::MultiplyAdd(Vec4::MultiplyAdd(wx, qy, wz * qw) - wy * qx, halfDt, qz);
+            Vec4 w = qw - Vec4::MultiplyAdd(wz, qz, Vec4::MultiplyAdd(wy, qy, wx * qx)) * halfDt;
+            Vec4 inverseLength = one / Vec4::Sqrt(Vec4::MultiplyAdd(w, w, Vec4::MultiplyAdd(z, z, Vec4::MultiplyAdd(y, y, x * x))));
+            (x * inverseLength).Store(arrays.rotationX + i);
+            (y * inverseLength).Store(arrays.rotationY + i);
+            (z * inverseLength).Store(arrays.rotationZ + i);
+            (w * inverseLength).Store(arrays.rotationW + i);
+        }
+        IntegratePositionsScalar(arrays, i, end, timestep);
+    }
+
+#ifdef ASTEROID_PHYSICS_WORLD_AVX
+    ASTEROID_TARGET_AVX2
+    static void IntegrateVelocitiesAVX2(const IntegrationArrays& arrays, uint32_t begin, uint32_t end, const Float3& gravityStep,
+        float linearDamping, float angularDamping)
+    {
+        __m256 gx = _mm256_set1_ps(gravityStep.x), gy = _mm256_set1_ps(gravityStep.y), gz = _mm256_set1_ps(gravityStep.z);
+        __m256 linear = _mm256_set1_ps(linearDamping), angular = _mm256_set1_ps(angularDamping);
+
+        uint32_t i = begin;
+        for (; i + 8 <= end; i += 8)
+        {
+            _mm256_storeu_ps(arrays.linearVelocityX + i, _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(arrays.linearVelocityX + i), gx), linear));
+            _mm256_storeu_ps(arrays.linearVelocityY + i, _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(arrays.linearVelocityY + i), gy), linear));
+            _mm256_storeu_ps(arrays.linearVelocityZ + i, _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(arrays.linearVelocityZ + i), gz), linear));
+            _mm256_storeu_ps(arrays.angularVelocityX + i, _mm256_mul_ps(_mm256_loadu_ps(arrays.angularVelocityX + i), angular));
+            _mm256_storeu_ps(arrays.angularVelocityY + i, _mm256_mul_ps(_mm256_loadu_ps(arrays.angularVelocityY + i), angular));
+            _mm256_storeu_ps(arrays.angularVelocityZ + i, _mm256_mul_ps(_mm256_loadu_ps(arrays.angularVelocityZ + i), angular));
+        }
+        IntegrateVelocitiesVec4(arrays, i, end, gravityStep, linearDamping, angularDamping);
+    }
+
+    ASTEROID_TARGET_AVX2
+    static void IntegratePositionsAVX2(const IntegrationArrays& arrays, uint32_t begin, uint32_t end, float timestep)
+    {
+        __m256 dt = _mm256_set1_ps(timestep), halfDt = _mm256_set1_ps(0.5f * timestep), one = _mm256_set1_ps(1.0f);
+
+        uint32_t i = begin;
+        for (; i + 8 <= end; i += 8)
+        {
+            _mm256_storeu_ps(arrays.positionX + i, _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(arrays.linearVelocityX + i), dt), _mm256_loadu_ps(arrays.positionX + i)));
+            _mm256_storeu_ps(arrays.positionY + i, _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(arrays.linearVelocityY + i), dt), _mm256_loadu_ps(arrays.positionY + i)));
+            _mm256_storeu_ps(arrays.positionZ + i, _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(arrays.linearVelocityZ + i), dt), _mm256_loadu_ps(arrays.positionZ + i)));
+
+            __m256 wx = _mm256_loadu_ps(arrays.angularVelocityX + i), wy = _mm256_loadu_ps(arrays.angularVelocityY + i), wz = _mm256_loadu_ps(arrays.angularVelocityZ + i);
+            __m256 qx = _mm256_loadu_ps(arrays.rotationX + i), qy = _mm256_loadu_ps(arrays.rotationY + i);
+            __m256 qz = _mm256_loadu_ps(arrays.rotationZ + i), qw = _mm256_loadu_ps(arrays.rotationW + i);
+            __m256 x = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(wx, qw), _mm256_mul_ps(wy, qz)), _mm256_mul_ps(wz, qy)), halfDt), qx);
+            __m256 y = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(wy, qw), _mm256_mul_ps(wz, qx)), _mm256_mul_ps(wx, qz)), halfDt), qy);
+            __m256 z = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_add_ps(_mm256_mul_ps(wz, qw), _mm256_mul_ps(wx, qy)), _mm256_mul_ps(wy, qx)), halfDt), qz);
+            __m256 w = _mm256_sub_ps(qw, _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(wx, qx), _mm256_mul_ps(wy, qy)), _mm256_mul_ps(wz, qz)), halfDt));
+            __m256 lengthSq = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)), _mm256_mul_ps(z, z)), _mm256_mul_ps(w, w));
+            __m256 inverseLength = _mm256_div_ps(one, _mm256_sqrt_ps(lengthSq));
+            _mm256_storeu_ps(arrays.rotationX + i, _mm256_mul_ps(x, inverseLength));
+            _mm256_storeu_ps(arrays.rotationY + i, _mm256_mul_ps(y, inverseLength));
+            _mm256_storeu_ps(arrays.rotationZ + i, _mm256_mul_ps(z, inverseLength));
+            _mm256_storeu_ps(arrays.rotationW + i, _mm256_mul_ps(w, inverseLength));
+        }
+        IntegratePositionsVec4(arrays, i, end, timestep);
+    }
+#endif
+
+    using IntegrateVelocitiesFunction = void(*)(const IntegrationArrays& arrays, uint32_t begin, uint32_t end, const Float3& gravityStep,
+        float linearDamping, float angularDamping);
+    using IntegratePositionsFunction = void(*)(const IntegrationArrays& arrays, uint32_t begin, uint32_t end, float timestep);
+#ifdef ASTEROID_PHYSICS_WORLD_AVX
+    static SimdKernel<IntegrateVelocitiesFunction> IntegrateVelocitiesKernel("PhysicsWorld.IntegrateVelocities",
+        IntegrateVelocitiesScalar, IntegrateVelocitiesVec4, IntegrateVelocitiesAVX2);
+    static SimdKernel<IntegratePositionsFunction> IntegratePositionsKernel("PhysicsWorld.IntegratePositions",
+        IntegratePositionsScalar, IntegratePositionsVec4, IntegratePositionsAVX2);
+#else
+    static SimdKernel<IntegrateVelocitiesFunction> IntegrateVelocitiesKernel("PhysicsWorld.IntegrateVelocities",
+        IntegrateVelocitiesScalar, IntegrateVelocitiesVec4);
+    static SimdKernel<IntegratePositionsFunction> IntegratePositionsKernel("PhysicsWorld.IntegratePositions",
+        IntegratePositionsScalar, IntegratePositionsVec4);
+#endif
+
+
+    PhysicsWorld* PhysicsWorld::_Singleton = nullptr;
+
+    PhysicsWorld::PhysicsWorld(const PhysicsSettings& settings)
+        : m_Settings(settings), m_AwakeCount(0), m_DynamicCount(0), m_ColorsCount(0), m_ImpactsCount(0)
+    {
+    }
+
+    uint32_t PhysicsWorld::CreateConvexHull(const Float3* points, uint32_t count)
+    {
+        m_Hulls.emplace_back();
+        if (!m_Hulls.back().Build(points, count))
+        {
+            m_Hulls.pop_back();
+            return kInvalidHull;
+        }
+        return (uint32_t)m_Hulls.size() - 1;
+    }
+
+    void PhysicsWorld::AddBody(ObjectInstanceID object, const RigidBodyDesc& desc)
+    {
+        ASTEROID_ASSERT(object >= 0 && !HasBody(object), "Object already has a body.");
+        ASTEROID_ASSERT(desc.shape != EShapeType::eConvexHull || desc.hull < m_Hulls.size(), "Invalid convex hull.");
+
+        BodyShape shape;
+        shape.type = desc.shape;
+        shape.radius = desc.radius;
+        shape.halfHeight = desc.halfHeight;
+        shape.hull = desc.hull;
+        shape.isFast = desc.isFast;
+        switch (desc.shape)
+        {
+        case EShapeType::eSphere:   shape.boundingRadius = desc.radius; break;
+        case EShapeType::eCapsule:  shape.boundingRadius = desc.radius + desc.halfHeight; break;
+        default:                    shape.boundingRadius = m_Hulls[desc.hull].BoundingRadius(); break;
+        }
+
+        uint32_t body = (uint32_t)m_Objects.size();
+        for (VectorA<float, 32>& array : m_Arrays)
+            array.push_back(0.0f);
+        m_Arrays[ePositionX][body] = desc.position.x;
+        m_Arrays[ePositionY][body] = desc.position.y;
+        m_Arrays[ePositionZ][body] = desc.position.z;
+        m_Arrays[eRotationX][body] = desc.rotation.x;
+        m_Arrays[eRotationY][body] = desc.rotation.y;
+        m_Arrays[eRotationZ][body] = desc.rotation.z;
+        m_Arrays[eRotationW][body] = desc.rotation.w;
+        if (desc.mass > 0.0f)
+        {
+            m_Arrays[eLinearVelocityX][body] = desc.linearVelocity.x;
+            m_Arrays[eLinearVelocityY][body] = desc.linearVelocity.y;
+            m_Arrays[eLinearVelocityZ][body] = desc.linearVelocity.z;
+            m_Arrays[eAngularVelocityX][body] = desc.angularVelocity.x;
+            m_Arrays[eAngularVelocityY][body] = desc.angularVelocity.y;
+            m_Arrays[eAngularVelocityZ][body] = desc.angularVelocity.z;
+            m_Arrays[eInverseMass][body] = 1.0f / desc.mass;
+            m_Arrays[eInverseInertia][body] = 1.0f / (kSphereInertia * desc.mass * shape.boundingRadius * shape.boundingRadius);
+        }
+        if (m_Settings.isDeterministic)
+            QuantizeBodies(body, body + 1);
+        m_Shapes.push_back(shape);
+        m_Objects.push_back(object);
+        m_Transforms.push_back(desc.transform);
+
+        if ((size_t)object >= m_BodyIndices.size())
+            m_BodyIndices.resize(object + 1, (uint32_t)kNoBody);
+        m_BodyIndices[object] = body;
+
+        BroadPhase::ProxyId proxy = m_BroadPhase.CreateProxy(ComputeBounds(body, 0.0f), (uint32_t)object);
+        if (proxy >= m_ProxyBodies.size())
+            m_ProxyBodies.resize(proxy + 1, (uint32_t)kNoBody);
+        m_ProxyBodies[proxy] = body;
+        m_Proxies.push_back(proxy);
+
+        // Static bodies stay at the end, dynamic ones move to the end of the awake ones
+        if (desc.mass > 0.0f)
+        {
+            SwapBodies(body, m_DynamicCount);
+            SwapBodies(m_DynamicCount, m_AwakeCount);
+            ++m_DynamicCount;
+            ++m_AwakeCount;
+        }
+        WriteTransform(m_BodyIndices[object]);
+    }
+
+    void PhysicsWorld::RemoveBody(ObjectInstanceID object)
+    {
+        uint32_t body = BodyIndex(object);
+        if (body < m_AwakeCount)
+        {
+            SwapBodies(body, m_AwakeCount - 1);
+            body = --m_AwakeCount;
+        }
+        if (body < m_DynamicCount)
+        {
+            SwapBodies(body, m_DynamicCount - 1);
+            body = --m_DynamicCount;
+        }
+        SwapBodies(body, (uint32_t)m_Objects.size() - 1);
+
+        m_BroadPhase.DestroyProxy(m_Proxies.back());
+        m_ProxyBodies[m_Proxies.back()] = kNoBody;
+        m_BodyIndices[object] = kNoBody;
+        for (VectorA<float, 32>& array : m_Arrays)
+            array.pop_back();
+        m_Shapes.pop_back();
+        m_Objects.pop_back();
+        m_Proxies.pop_back();
+        m_Transforms.pop_back();
+    }
+
+    Float3 PhysicsWorld::Position(ObjectInstanceID object) const
+    {
+        uint32_t body = BodyIndex(object);
+        return Float3(m_Arrays[ePositionX][body], m_Arrays[ePositionY][body], m_Arrays[ePositionZ][body]);
+    }
+
+    Float4 PhysicsWorld::Rotation(ObjectInstanceID object) const
+    {
+        uint32_t body = BodyIndex(object);
+        return Float4(m_Arrays[eRotationX][body], m_Arrays[eRotationY][body], m_Arrays[eRotationZ][body], m_Arrays[eRotationW][body]);
+    }
+
+    Float3 PhysicsWorld::LinearVelocity(ObjectInstanceID object) const
+    {
+        uint32_t body = BodyIndex(object);
+        return Float3(m_Arrays[eLinearVelocityX][body], m_Arrays[eLinearVelocityY][body], m_Arrays[eLinearVelocityZ][body]);
+    }
+
+    Float3 PhysicsWorld::AngularVelocity(ObjectInstanceID object) const
+    {
+        uint32_t body = BodyIndex(object);
+        return Float3(m_Arrays[eAngularVelocityX][body], m_Arrays[eAngularVelocityY][body], m_Arrays[eAngularVelocityZ][body]);
+    }
+
+    void PhysicsWorld::SetPose(ObjectInstanceID object, const Float3& position, const Float4& rotation)
+    {
+        uint32_t body = BodyIndex(object);
+        m_Arrays[ePositionX][body] = position.x;
+        m_Arrays[ePositionY][body] = position.y;
+        m_Arrays[ePositionZ][body] = position.z;
+        m_Arrays[eRotationX][body] = rotation.x;
+        m_Arrays[eRotationY][body] = rotation.y;
+        m_Arrays[eRotationZ][body] = rotation.z;
+        m_Arrays[eRotationW][body] = rotation.w;
+        if (m_Settings.isDeterministic)
+            QuantizeBodies(body, body + 1);
+        m_BroadPhase.MoveProxy(m_Proxies[body], ComputeBounds(body, 0.0f));
+        WriteTransform(body);
+        if (IsDynamic(body))
+            Wake(body);
+    }
+
+    void PhysicsWorld::SetVelocity(ObjectInstanceID object, const Float3& linear, const Float3& angular)
+    {
+        uint32_t body = BodyIndex(object);
+        ASTEROID_ASSERT(IsDynamic(body), "Static bodies can't move.");
+        m_Arrays[eLinearVelocityX][body] = linear.x;
+        m_Arrays[eLinearVelocityY][body] = linear.y;
+        m_Arrays[eLinearVelocityZ][body] = linear.z;
+        m_Arrays[eAngularVelocityX][body] = angular.x;
+        m_Arrays[eAngularVelocityY][body] = angular.y;
+        m_Arrays[eAngularVelocityZ][body] = angular.z;
+        if (m_Settings.isDeterministic)
+            QuantizeBodies(body, body + 1);
+        Wake(body);
+    }
+
+    void PhysicsWorld::WakeUp(ObjectInstanceID object)
+    {
+        uint32_t body = BodyIndex(object);
+        if (IsDynamic(body))
+            Wake(body);
+    }
+
+    void PhysicsWorld::Step(float timestep)
+    {
+        for (ObjectInstanceID object : m_PendingWakes)
+        {
+            if (HasBody(object))
+                Wake(m_BodyIndices[object]);
+        }
+        m_PendingWakes.clear();
+
+        IntegrateVelocities(timestep);
+        FindContacts(timestep);
+        SolveContacts(timestep);
+        SweepFastBodies(timestep);
+        IntegratePositions(timestep);
+        if (m_Settings.isDeterministic)
+        {
+            auto quantizeRange = [this](uint32_t begin, uint32_t end) { QuantizeBodies(begin, end); };
+            JobSystem* jobSystem = JobSystem::Singleton();
+            if (jobSystem != nullptr)
+                jobSystem->ParallelFor(m_AwakeCount, kIntegrationChunkSize, quantizeRange);
+            else
+                quantizeRange(0, m_AwakeCount);
+        }
+        FinishStep(timestep);
+    }
+
+    uint64_t PhysicsWorld::StateChecksum() const
+    {
+        // A hash per body summed over the bodies, so the checksum doesn't depend on the order bodies are stored in
+        // and chunks of bodies are hashed in parallel while reading the arrays in order
+        uint32_t bodiesCount = (uint32_t)m_Objects.size();
+        uint32_t chunksCount = (bodiesCount + kIntegrationChunkSize - 1) / kIntegrationChunkSize;
+        Vector<uint64_t> chunkChecksums(chunksCount);
+        auto hashChunks = [this, bodiesCount, &chunkChecksums](uint32_t beginChunk, uint32_t endChunk)
+        {
+            for (uint32_t iChunk = beginChunk; iChunk < endChunk; ++iChunk)
+            {
+                uint64_t checksum = 0;
+                uint32_t end = std::min((iChunk + 1) * kIntegrationChunkSize, bodiesCount);
+                for (uint32_t iBody = iChunk * kIntegrationChunkSize; iBody < end; ++iBody)
+                {
+                    uint32_t state[2 + eAngularVelocityZ + 1];
+                    state[0] = (uint32_t)m_Objects[iBody];
+                    state[1] = iBody < m_AwakeCount;
+                    for (uint32_t iArray = ePositionX; iArray <= eAngularVelocityZ; ++iArray)
+                        state[2 + iArray] = (uint32_t)Fixed::FromFloat(m_Arrays[iArray][iBody]).Raw();
+                    checksum += Hash::Words(state, sizeof(state) / sizeof(state[0]));
+                }
+                chunkChecksums[iChunk] = checksum;
+            }
+        };
+        JobSystem* jobSystem = JobSystem::Singleton();
+        if (jobSystem != nullptr)
+            jobSystem->ParallelFor(chunksCount, 1, hashChunks);
+        else
+            hashChunks(0, chunksCount);
+
+        uint64_t checksum = Hash::kSeed;
+        for (uint64_t chunkChecksum : chunkChecksums)
+            checksum += chunkChecksum;
+        return checksum;
+    }
+
+    uint32_t PhysicsWorld::BodyIndex(ObjectInstanceID object) const
+    {
+        ASTEROID_ASSERT(HasBody(object), "Object has no body.");
+        return m_BodyIndices[object];
+    }
+
+    void PhysicsWorld::SwapBodies(uint32_t a, uint32_t b)
+    {
+        if (a == b)
+            return;
+
+        for (VectorA<float, 32>& array : m_Arrays)
+            std::swap(array[a], array[b]);
+        std::swap(m_Shapes[a], m_Shapes[b]);
+        std::swap(m_Objects[a], m_Objects[b]);
+        std::swap(m_Proxies[a], m_Proxies[b]);
+        std::swap(m_Transforms[a], m_Transforms[b]);
+        m_BodyIndices[m_Objects[a]] = a;
+        m_BodyIndices[m_Objects[b]] = b;
+        m_ProxyBodies[m_Proxies[a]] = a;
+        m_ProxyBodies[m_Proxies[b]] = b;
+    }
+
+    void PhysicsWorld::Wake(uint32_t body)
+    {
+        ASTEROID_ASSERT(IsDynamic(body), "Static bodies never wake.");
+        m_Arrays[eSleepTime][body] = 0.0f;
+        if (body >= m_AwakeCount)
+        {
+            SwapBodies(body, m_AwakeCount);
+            ++m_AwakeCount;
+        }
+    }
+
+    Bounds PhysicsWorld::ComputeBounds(uint32_t body, float timestep) const
+    {
+        const BodyShape& shape = m_Shapes[body];
+        Float3 position(m_Arrays[ePositionX][body], m_Arrays[ePositionY][body], m_Arrays[ePositionZ][body]);
+        float radius = shape.type == EShapeType::eConvexHull ? shape.boundingRadius : shape.radius;
+        Float3 extents(radius, radius, radius);
+        if (shape.type == EShapeType::eCapsule)
+        {
+            Float3 axis = RotatedAxisY(m_Arrays[eRotationX][body], m_Arrays[eRotationY][body], m_Arrays[eRotationZ][body], m_Arrays[eRotationW][body]);
+            extents = Float3(radius + std::abs(axis.x) * shape.halfHeight, radius + std::abs(axis.y) * shape.halfHeight,
+                radius + std::abs(axis.z) * shape.halfHeight);
+        }
+
+        // Also cover where the body goes during the next step, so fast bodies get speculative contacts
+        float margin = m_Settings.contactMargin;
+        Float3 motion(m_Arrays[eLinearVelocityX][body] * timestep, m_Arrays[eLinearVelocityY][body] * timestep,
+            m_Arrays[eLinearVelocityZ][body] * timestep);
+        Bounds bounds;
+        bounds.min = Float3(position.x - extents.x - margin + std::min(motion.x, 0.0f), position.y - extents.y - margin + std::min(motion.y, 0.0f),
+            position.z - extents.z - margin + std::min(motion.z, 0.0f));
+        bounds.max = Float3(position.x + extents.x + margin + std::max(motion.x, 0.0f), position.y + extents.y + margin + std::max(motion.y, 0.0f),
+            position.z + extents.z + margin + std::max(motion.z, 0.0f));
+        return bounds;
+    }
+
+    void PhysicsWorld::WriteTransform(uint32_t body)
+    {
+        TransformSystem::Handle transform = m_Transforms[body];
+        if (transform == TransformSystem::kInvalidHandle || TransformSystem::Singleton() == nullptr)
+            return;
+
+        TransformSystem* transformSystem = TransformSystem::Singleton();
+        transformSystem->SetLocalPosition(transform, Float3(m_Arrays[ePositionX][body], m_Arrays[ePositionY][body], m_Arrays[ePositionZ][body]));
+        transformSystem->SetLocalRotation(transform, Float4(m_Arrays[eRotationX][body], m_Arrays[eRotationY][body],
+            m_Arrays[eRotationZ][body], m_Arrays[eRotationW][body]));
+    }
+
+    void PhysicsWorld::IntegrateVelocities(float timestep)
+    {
+        IntegrationArrays arrays = { Array(ePositionX), Array(ePositionY), Array(ePositionZ), Array(eRotationX), Array(eRotationY),
+            Array(eRotationZ), Array(eRotationW), Array(eLinearVelocityX), Array(eLinearVelocityY), Array(eLinearVelocityZ),
+            Array(eAngularVelocityX), Array(eAngularVelocityY), Array(eAngularVelocityZ) };
+        Float3 gravityStep(m_Settings.gravity.x * timestep, m_Settings.gravity.y * timestep, m_Settings.gravity.z * timestep);
+        float linearDamping = 1.0f / (1.0f + timestep * m_Settings.linearDamping);
+        float angularDamping = 1.0f / (1.0f + timestep * m_Settings.angularDamping);
+
+        auto integrateRange = [&arrays, &gravityStep, linearDamping, angularDamping](uint32_t begin, uint32_t end)
+        {
+            IntegrateVelocitiesKernel(arrays, begin, end, gravityStep, linearDamping, angularDamping);
+        };
+        JobSystem* jobSystem = JobSystem::Singleton();
+        if (jobSystem != nullptr)
+            jobSystem->ParallelFor(m_AwakeCount, kIntegrationChunkSize, integrateRange);
+        else
+            integrateRange(0, m_AwakeCount);
+    }
+
+    void PhysicsWorld::IntegratePositions(float timestep)
+    {
+        IntegrationArrays arrays = { Array(ePositionX), Array(ePositionY), Array(ePositionZ), Array(eRotationX), Array(eRotationY),
+            Array(eRotationZ), Array(eRotationW), Array(eLinearVelocityX), Array(eLinearVelocityY), Array(eLinearVelocityZ),
+            Array(eAngularVelocityX), Array(eAngularVelocityY), Array(eAngularVelocityZ) };
+
+        auto integrateRange = [&arrays, timestep](uint32_t begin, uint32_t end)
+        {
+            IntegratePositionsKernel(arrays, begin, end, timestep);
+        };
+        JobSystem* jobSystem = JobSystem::Singleton();
+        if (jobSystem != nullptr)
+            jobSystem->ParallelFor(m_AwakeCount, kIntegrationChunkSize, integrateRange);
+        else
+            integrateRange(0, m_AwakeCount);
+    }
+
+    void PhysicsWorld::FindContacts(float timestep)
+    {
+        // Boxes of fast bodies swept with their current velocity, so bodies launched since the last step are
+        // swept in their first step too
+        for (uint32_t iBody = 0; iBody < m_AwakeCount; ++iBody)
+        {
+            if (m_Shapes[iBody].isFast)
+                m_BroadPhase.MoveProxy(m_Proxies[iBody], ComputeBounds(iBody, timestep));
+        }
+        m_BroadPhase.FindPairs(&m_Pairs);
+
+        // Sort pairs by kind of narrow-phase test, pairs of bodies that don't move need none
+        m_SpherePairs.clear();
+        m_SphereCapsulePairs.clear();
+        m_SphereHullPairs.clear();
+        m_FastPairs.clear();
+        for (const BroadPhasePair& pair : m_Pairs)
+        {
+            BodyPair bodies = { m_ProxyBodies[pair.first], m_ProxyBodies[pair.second] };
+            if (bodies.bodyA >= m_AwakeCount && bodies.bodyB >= m_AwakeCount)
+                continue;
+
+            bool isFastA = bodies.bodyA < m_AwakeCount && m_Shapes[bodies.bodyA].isFast;
+            bool isFastB = bodies.bodyB < m_AwakeCount && m_Shapes[bodies.bodyB].isFast;
+            if (isFastA || isFastB)
+                m_FastPairs.push_back(isFastA ? bodies : BodyPair{ bodies.bodyB, bodies.bodyA });
+
+            if (m_Shapes[bodies.bodyA].type != EShapeType::eSphere)
+                std::swap(bodies.bodyA, bodies.bodyB);
+            EShapeType typeA = m_Shapes[bodies.bodyA].type;
+            EShapeType typeB = m_Shapes[bodies.bodyB].type;
+            if (typeA == EShapeType::eSphere && typeB == EShapeType::eCapsule)
+                m_SphereCapsulePairs.push_back(bodies);
+            else if (typeA == EShapeType::eSphere && typeB == EShapeType::eConvexHull)
+                m_SphereHullPairs.push_back(bodies);
+            else
+                m_SpherePairs.push_back(bodies);
+        }
+
+        // Chunks of every kind in a row, contacts are concatenated in chunk order so they don't depend on threads
+        uint32_t sphereChunksCount = ((uint32_t)m_SpherePairs.size() + kNarrowPhaseChunkSize - 1) / kNarrowPhaseChunkSize;
+        uint32_t capsuleChunksCount = ((uint32_t)m_SphereCapsulePairs.size() + kNarrowPhaseChunkSize - 1) / kNarrowPhaseChunkSize;
+        uint32_t hullChunksCount = ((uint32_t)m_SphereHullPairs.size() + kNarrowPhaseChunkSize - 1) / kNarrowPhaseChunkSize;
+        uint32_t chunksCount = sphereChunksCount + capsuleChunksCount + hullChunksCount;
+        if (m_ChunkContacts.size() < chunksCount)
+            m_ChunkContacts.resize(chunksCount);
+
+        auto collideChunks = [this, timestep, sphereChunksCount, capsuleChunksCount](uint32_t beginChunk, uint32_t endChunk)
+        {
+            for (uint32_t iChunk = beginChunk; iChunk < endChunk; ++iChunk)
+            {
+                Vector<Contact>& contacts = m_ChunkContacts[iChunk];
+                contacts.clear();
+
+                uint32_t chunk = iChunk;
+                const Vector<BodyPair>* pairs = &m_SpherePairs;
+                if (chunk >= sphereChunksCount)
+                {
+                    chunk -= sphereChunksCount;
+                    pairs = &m_SphereCapsulePairs;
+                    if (chunk >= capsuleChunksCount)
+                    {
+                        chunk -= capsuleChunksCount;
+                        pairs = &m_SphereHullPairs;
+                    }
+                }
+
+                uint32_t begin = chunk * kNarrowPhaseChunkSize;
+                uint32_t count = std::min((uint32_t)pairs->size() - begin, kNarrowPhaseChunkSize);
+                if (pairs == &m_SpherePairs)
+                    CollideSpherePairs(pairs->data() + begin, count, timestep, &contacts);
+                else if (pairs == &m_SphereCapsulePairs)
+                    CollideSphereCapsulePairs(pairs->data() + begin, count, timestep, &contacts);
+                else
+                    CollideSphereHullPairs(pairs->data() + begin, count, timestep, &contacts);
+            }
+        };
+        JobSystem* jobSystem = JobSystem::Singleton();
+        if (jobSystem != nullptr)
+            jobSystem->ParallelFor(chunksCount, 1, collideChunks);
+        else
+            collideChunks(0, chunksCount);
+
+        m_Contacts.clear();
+        for (uint32_t iChunk = 0; iChunk < chunksCount; ++iChunk)
+            m_Contacts.insert(m_Contacts.end(), m_ChunkContacts[iChunk].begin(), m_ChunkContacts[iChunk].end());
+    }
+
+    void PhysicsWorld::CollideSpherePairs(const BodyPair* pairs, uint32_t count, float timestep, Vector<Contact>* contacts) const
+    {
+        alignas(32) float centerX[kNarrowPhaseChunkSize], centerY[kNarrowPhaseChunkSize], centerZ[kNarrowPhaseChunkSize];
+        alignas(32) float startX[kNarrowPhaseChunkSize], startY[kNarrowPhaseChunkSize], startZ[kNarrowPhaseChunkSize];
+        alignas(32) float radiusA[kNarrowPhaseChunkSize], radiusB[kNarrowPhaseChunkSize];
+        alignas(32) float normalX[kNarrowPhaseChunkSize], normalY[kNarrowPhaseChunkSize], normalZ[kNarrowPhaseChunkSize];
+        alignas(32) float separation[kNarrowPhaseChunkSize];
+
+        const float* positionX = Array(ePositionX);
+        const float* positionY = Array(ePositionY);
+        const float* positionZ = Array(ePositionZ);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint32_t a = pairs[i].bodyA, b = pairs[i].bodyB;
+            centerX[i] = positionX[a];
+            centerY[i] = positionY[a];
+            centerZ[i] = positionZ[a];
+            startX[i] = positionX[b];
+            startY[i] = positionY[b];
+            startZ[i] = positionZ[b];
+            // Pairs of other shapes collide as their bounding spheres
+            radiusA[i] = m_Shapes[a].type == EShapeType::eSphere ? m_Shapes[a].radius : m_Shapes[a].boundingRadius;
+            radiusB[i] = m_Shapes[b].type == EShapeType::eSphere ? m_Shapes[b].radius : m_Shapes[b].boundingRadius;
+        }
+
+        SphereContactBatch batch = { centerX, centerY, centerZ, radiusA, startX, startY, startZ, nullptr, nullptr, nullptr, radiusB,
+            normalX, normalY, normalZ, separation, nullptr, nullptr, nullptr };
+        NarrowPhase::CollideSpheres(batch, count);
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            Contact contact;
+            contact.bodyA = pairs[i].bodyA;
+            contact.bodyB = pairs[i].bodyB;
+            contact.normal = Float3(normalX[i], normalY[i], normalZ[i]);
+            if (normalX[i] == 0.0f && normalY[i] == 0.0f && normalZ[i] == 0.0f)
+                contact.normal = Float3(0.0f, 1.0f, 0.0f);
+            contact.separation = separation[i];
+            float offset = radiusA[i] + 0.5f * separation[i];
+            contact.point = Float3(centerX[i] + contact.normal.x * offset, centerY[i] + contact.normal.y * offset, centerZ[i] + contact.normal.z * offset);
+            if (KeepContact(contact, timestep))
+                contacts->push_back(contact);
+        }
+    }
+
+    void PhysicsWorld::CollideSphereCapsulePairs(const BodyPair* pairs, uint32_t count, float timestep, Vector<Contact>* contacts) const
+    {
+        alignas(32) float centerX[kNarrowPhaseChunkSize], centerY[kNarrowPhaseChunkSize], centerZ[kNarrowPhaseChunkSize];
+        alignas(32) float startX[kNarrowPhaseChunkSize], startY[kNarrowPhaseChunkSize], startZ[kNarrowPhaseChunkSize];
+        alignas(32) float segmentX[kNarrowPhaseChunkSize], segmentY[kNarrowPhaseChunkSize], segmentZ[kNarrowPhaseChunkSize];
+        alignas(32) float radiusA[kNarrowPhaseChunkSize], radiusB[kNarrowPhaseChunkSize];
+        alignas(32) float normalX[kNarrowPhaseChunkSize], normalY[kNarrowPhaseChunkSize], normalZ[kNarrowPhaseChunkSize];
+        alignas(32) float separation[kNarrowPhaseChunkSize];
+        alignas(32) float closestX[kNarrowPhaseChunkSize], closestY[kNarrowPhaseChunkSize], closestZ[kNarrowPhaseChunkSize];
+
+        const float* positionX = Array(ePositionX);
+        const float* positionY = Array(ePositionY);
+        const float* positionZ = Array(ePositionZ);
+        const float* rotationX = Array(eRotationX);
+        const float* rotationY = Array(eRotationY);
+        const float* rotationZ = Array(eRotationZ);
+        const float* rotationW = Array(eRotationW);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint32_t a = pairs[i].bodyA, b = pairs[i].bodyB;
+            centerX[i] = positionX[a];
+            centerY[i] = positionY[a];
+            centerZ[i] = positionZ[a];
+            radiusA[i] = m_Shapes[a].radius;
+
+            float halfHeight = m_Shapes[b].halfHeight;
+            Float3 axis = RotatedAxisY(rotationX[b], rotationY[b], rotationZ[b], rotationW[b]);
+            startX[i] = positionX[b] - axis.x * halfHeight;
+            startY[i] = positionY[b] - axis.y * halfHeight;
+            startZ[i] = positionZ[b] - axis.z * halfHeight;
+            segmentX[i] = axis.x * (2.0f * halfHeight);
+            segmentY[i] = axis.y * (2.0f * halfHeight);
+            segmentZ[i] = axis.z * (2.0f * halfHeight);
+            radiusB[i] = m_Shapes[b].radius;
+        }
+
+        SphereContactBatch batch = { centerX, centerY, centerZ, radiusA, startX, startY, startZ, segmentX, segmentY, segmentZ, radiusB,
+            normalX, normalY, normalZ, separation, closestX, closestY, closestZ };
+        NarrowPhase::CollideSphereCapsules(batch, count);
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            Contact contact;
+            contact.bodyA = pairs[i].bodyA;
+            contact.bodyB = pairs[i].bodyB;
+            contact.normal = Float3(normalX[i], normalY[i], normalZ[i]);
+            if (normalX[i] == 0.0f && normalY[i] == 0.0f && normalZ[i] == 0.0f)
+                contact.normal = Float3(0.0f, 1.0f, 0.0f);
+            contact.separation = separation[i];
+            float offset = radiusB[i] + 0.5f * separation[i];
+            contact.point = Float3(closestX[i] - contact.normal.x * offset, closestY[i] - contact.normal.y * offset, closestZ[i] - contact.normal.z * offset);
+            if (KeepContact(contact, timestep))
+                contacts->push_back(contact);
+        }
+    }
+
+    void PhysicsWorld::CollideSphereHullPairs(const BodyPair* pairs, uint32_t count, float timestep, Vector<Contact>* contacts) const
+    {
+        const float* velocityX = Array(eLinearVelocityX);
+        const float* velocityY = Array(eLinearVelocityY);
+        const float* velocityZ = Array(eLinearVelocityZ);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint32_t a = pairs[i].bodyA, b = pairs[i].bodyB;
+            Vec4 centerA = Vec4::Set(m_Arrays[ePositionX][a], m_Arrays[ePositionY][a], m_Arrays[ePositionZ][a], 0.0f);
+            Vec4 positionB = Vec4::Set(m_Arrays[ePositionX][b], m_Arrays[ePositionY][b], m_Arrays[ePositionZ][b], 0.0f);
+            Quat rotationB = { Vec4::Set(m_Arrays[eRotationX][b], m_Arrays[eRotationY][b], m_Arrays[eRotationZ][b], m_Arrays[eRotationW][b]) };
+
+            Float3 localCenter;
+            Quat::Rotate(centerA - positionB, Quat::Conjugate(rotationB)).Store(localCenter);
+            Vec4 relativeVelocity = Vec4::Set(velocityX[b] - velocityX[a], velocityY[b] - velocityY[a], velocityZ[b] - velocityZ[a], 0.0f);
+            float maxSeparation = m_Settings.contactMargin + Vec4::Length3(relativeVelocity) * timestep;
+
+            Float3 normal, point;
+            Contact contact;
+            if (!NarrowPhase::CollideSphereHull(m_Hulls[m_Shapes[b].hull], localCenter, m_Shapes[a].radius, maxSeparation,
+                &normal, &point, &contact.separation))
+            {
+                continue;
+            }
+
+            contact.bodyA = a;
+            contact.bodyB = b;
+            Quat::Rotate(Vec4::Load(normal, 0.0f), rotationB).Store(contact.normal);
+            (Quat::Rotate(Vec4::Load(point, 0.0f), rotationB) + positionB).Store(contact.point);
+            if (KeepContact(contact, timestep))
+                contacts->push_back(contact);
+        }
+    }
+
+    bool PhysicsWorld::KeepContact(const Contact& contact, float timestep) const
+    {
+        if (contact.separation < m_Settings.contactMargin)
+            return true;
+
+        uint32_t a = contact.bodyA, b = contact.bodyB;
+        float approachSpeed = (m_Arrays[eLinearVelocityX][a] - m_Arrays[eLinearVelocityX][b]) * contact.normal.x +
+            (m_Arrays[eLinearVelocityY][a] - m_Arrays[eLinearVelocityY][b]) * contact.normal.y +
+            (m_Arrays[eLinearVelocityZ][a] - m_Arrays[eLinearVelocityZ][b]) * contact.normal.z;
+        return contact.separation - approachSpeed * timestep < m_Settings.contactMargin;
+    }
+
+    void PhysicsWorld::SolveContacts(float timestep)
+    {
+        uint32_t contactsCount = (uint32_t)m_Contacts.size();
+        m_ColorsCount = 0;
+        m_Constraints.resize(contactsCount);
+        if (contactsCount == 0)
+            return;
+
+        // Greedy coloring in contact order, a color never has an awake body twice. Sleeping and static bodies
+        // are not moved by the solver, so any number of contacts of a color can share them.
+        m_BodyColors.assign(m_AwakeCount, 0);
+        m_ContactColors.resize(contactsCount);
+        uint32_t colorCounts[kParallelColorsCount + 1] = {};
+        for (uint32_t iContact = 0; iContact < contactsCount; ++iContact)
+        {
+            uint32_t a = m_Contacts[iContact].bodyA, b = m_Contacts[iContact].bodyB;
+            uint64_t usedColors = (a < m_AwakeCount ? m_BodyColors[a] : 0) | (b < m_AwakeCount ? m_BodyColors[b] : 0);
+            uint32_t color = kParallelColorsCount;
+            if (~usedColors != 0)
+            {
+                color = FindFirstSet64(~usedColors);
+                if (a < m_AwakeCount)
+                    m_BodyColors[a] |= 1ull << color;
+                if (b < m_AwakeCount)
+                    m_BodyColors[b] |= 1ull << color;
+            }
+            m_ContactColors[iContact] = color;
+            ++colorCounts[color];
+        }
+
+        m_ColorOffsets[0] = 0;
+        for (uint32_t iColor = 0; iColor <= kParallelColorsCount; ++iColor)
+        {
+            m_ColorOffsets[iColor + 1] = m_ColorOffsets[iColor] + colorCounts[iColor];
+            m_ColorsCount += colorCounts[iColor] != 0;
+        }
+        // Slot of every contact in m_Constraints, stable within a color
+        uint32_t cursors[kParallelColorsCount + 1];
+        std::memcpy(cursors, m_ColorOffsets, sizeof(cursors));
+        for (uint32_t iContact = 0; iContact < contactsCount; ++iContact)
+            m_ContactColors[iContact] = cursors[m_ContactColors[iContact]]++;
+
+        auto prepareRange = [this, timestep](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t iContact = begin; iContact < end; ++iContact)
+                PrepareConstraint(m_Contacts[iContact], timestep, &m_Constraints[m_ContactColors[iContact]]);
+        };
+        JobSystem* jobSystem = JobSystem::Singleton();
+        if (jobSystem != nullptr)
+            jobSystem->ParallelFor(contactsCount, kSolverChunkSize, prepareRange);
+        else
+            prepareRange(0, contactsCount);
+
+        for (uint32_t iIteration = 0; iIteration < m_Settings.velocityIterations; ++iIteration)
+        {
+            for (uint32_t iColor = 0; iColor <= kParallelColorsCount; ++iColor)
+            {
+                uint32_t begin = m_ColorOffsets[iColor];
+                uint32_t count = m_ColorOffsets[iColor + 1] - begin;
+                auto solveRange = [this, begin](uint32_t rangeBegin, uint32_t rangeEnd)
+                {
+                    for (uint32_t i = begin + rangeBegin; i < begin + rangeEnd; ++i)
+                        SolveConstraint(m_Constraints[i]);
+                };
+                // Contacts left without a color may share bodies, they are solved on this thread
+                if (jobSystem != nullptr && iColor < kParallelColorsCount)
+                    jobSystem->ParallelFor(count, kSolverChunkSize, solveRange);
+                else if (count > 0)
+                    solveRange(0, count);
+            }
+        }
+    }
+
+    void PhysicsWorld::PrepareConstraint(const Contact& contact, float timestep, ContactConstraint* constraint) const
+    {
+        uint32_t a = contact.bodyA, b = contact.bodyB;
+        constraint->bodyA = a;
+        constraint->bodyB = b;
+        constraint->inverseMassA = a < m_AwakeCount ? m_Arrays[eInverseMass][a] : 0.0f;
+        constraint->inverseMassB = b < m_AwakeCount ? m_Arrays[eInverseMass][b] : 0.0f;
+        constraint->inverseInertiaA = a < m_AwakeCount ? m_Arrays[eInverseInertia][a] : 0.0f;
+        constraint->inverseInertiaB = b < m_AwakeCount ? m_Arrays[eInverseInertia][b] : 0.0f;
+
+        Vec4 normal = Vec4::Load(contact.normal, 0.0f);
+        Vec4 tangent1 = std::abs(contact.normal.x) >= 0.57735f ? Vec4::Set(contact.normal.y, -contact.normal.x, 0.0f, 0.0f) :
+            Vec4::Set(0.0f, contact.normal.z, -contact.normal.y, 0.0f);
+        tangent1 = Vec4::Normalize3(tangent1);
+        Vec4 tangent2 = Vec4::Cross3(normal, tangent1);
+        Vec4 point = Vec4::Load(contact.point, 0.0f);
+        Vec4 offsetA = point - Vec4::Set(m_Arrays[ePositionX][a], m_Arrays[ePositionY][a], m_Arrays[ePositionZ][a], 0.0f);
+        Vec4 offsetB = point - Vec4::Set(m_Arrays[ePositionX][b], m_Arrays[ePositionY][b], m_Arrays[ePositionZ][b], 0.0f);
+        tangent1.Store(constraint->tangent1);
+        tangent2.Store(constraint->tangent2);
+        constraint->normal = contact.normal;
+        offsetA.Store(constraint->offsetA);
+        offsetB.Store(constraint->offsetB);
+
+        // Inverse of the mass the impulse sees along a direction, inertia is the same around every axis
+        auto effectiveMass = [constraint, &offsetA, &offsetB](const Vec4& direction)
+        {
+            Vec4 angularA = Vec4::Cross3(offsetA, direction);
+            Vec4 angularB = Vec4::Cross3(offsetB, direction);
+            float inverseMass = constraint->inverseMassA + constraint->inverseMassB +
+                constraint->inverseInertiaA * Vec4::Dot3(angularA, angularA) + constraint->inverseInertiaB * Vec4::Dot3(angularB, angularB);
+            return inverseMass > 0.0f ? 1.0f / inverseMass : 0.0f;
+        };
+        constraint->normalMass = effectiveMass(normal);
+        constraint->tangentMass1 = effectiveMass(tangent1);
+        constraint->tangentMass2 = effectiveMass(tangent2);
+
+        Vec4 velocityA = Vec4::Set(m_Arrays[eLinearVelocityX][a], m_Arrays[eLinearVelocityY][a], m_Arrays[eLinearVelocityZ][a], 0.0f) +
+            Vec4::Cross3(Vec4::Set(m_Arrays[eAngularVelocityX][a], m_Arrays[eAngularVelocityY][a], m_Arrays[eAngularVelocityZ][a], 0.0f), offsetA);
+        Vec4 velocityB = Vec4::Set(m_Arrays[eLinearVelocityX][b], m_Arrays[eLinearVelocityY][b], m_Arrays[eLinearVelocityZ][b], 0.0f) +
+            Vec4::Cross3(Vec4::Set(m_Arrays[eAngularVelocityX][b], m_Arrays[eAngularVelocityY][b], m_Arrays[eAngularVelocityZ][b], 0.0f), offsetB);
+        float normalVelocity = Vec4::Dot3(velocityB - velocityA, normal);
+
+        // Speculative contacts may close their gap during the step, penetrating ones are pushed apart
+        float separation = contact.separation;
+        if (separation > 0.0f)
+        {
+            constraint->targetVelocity = -separation / timestep;
+        }
+        else
+        {
+            constraint->targetVelocity = std::min(kBaumgarteFactor * std::max(-(separation + kLinearSlop), 0.0f) / timestep, kMaxCorrectionSpeed);
+            if (normalVelocity < -kRestitutionSpeed)
+                constraint->targetVelocity = std::max(constraint->targetVelocity, -m_Settings.restitution * normalVelocity);
+        }
+
+        constraint->normalImpulse = 0.0f;
+        constraint->tangentImpulse1 = 0.0f;
+        constraint->tangentImpulse2 = 0.0f;
+    }
+
+    void PhysicsWorld::SolveConstraint(ContactConstraint& constraint)
+    {
+        uint32_t a = constraint.bodyA, b = constraint.bodyB;
+        float* velocityX = Array(eLinearVelocityX);
+        float* velocityY = Array(eLinearVelocityY);
+        float* velocityZ = Array(eLinearVelocityZ);
+        float* angularX = Array(eAngularVelocityX);
+        float* angularY = Array(eAngularVelocityY);
+        float* angularZ = Array(eAngularVelocityZ);
+
+        Vec4 linearA = Vec4::Set(velocityX[a], velocityY[a], velocityZ[a], 0.0f);
+        Vec4 angularA = Vec4::Set(angularX[a], angularY[a], angularZ[a], 0.0f);
+        Vec4 linearB = Vec4::Set(velocityX[b], velocityY[b], velocityZ[b], 0.0f);
+        Vec4 angularB = Vec4::Set(angularX[b], angularY[b], angularZ[b], 0.0f);
+        Vec4 offsetA = Vec4::Load(constraint.offsetA, 0.0f);
+        Vec4 offsetB = Vec4::Load(constraint.offsetB, 0.0f);
+
+        auto applyImpulse = [&](const Vec4& impulse)
+        {
+            linearA -= impulse * constraint.inverseMassA;
+            angularA -= Vec4::Cross3(offsetA, impulse) * constraint.inverseInertiaA;
+            linearB += impulse * constraint.inverseMassB;
+            angularB += Vec4::Cross3(offsetB, impulse) * constraint.inverseInertiaB;
+        };
+        auto relativeVelocity = [&]()
+        {
+            return (linearB + Vec4::Cross3(angularB, offsetB)) - (linearA + Vec4::Cross3(angularA, offsetA));
+        };
+
+        // Friction first, bounded by the normal impulse of the previous iteration
+        float maxFriction = m_Settings.friction * constraint.normalImpulse;
+        Vec4 tangent1 = Vec4::Load(constraint.tangent1, 0.0f);
+        Vec4 tangent2 = Vec4::Load(constraint.tangent2, 0.0f);
+        Vec4 velocity = relativeVelocity();
+        float impulse1 = std::min(std::max(constraint.tangentImpulse1 - Vec4::Dot3(velocity, tangent1) * constraint.tangentMass1, -maxFriction), maxFriction);
+        float impulse2 = std::min(std::max(constraint.tangentImpulse2 - Vec4::Dot3(velocity, tangent2) * constraint.tangentMass2, -maxFriction), maxFriction);
+        applyImpulse(tangent1 * (impulse1 - constraint.tangentImpulse1) + tangent2 * (impulse2 - constraint.tangentImpulse2));
+        constraint.tangentImpulse1 = impulse1;
+        constraint.tangentImpulse2 = impulse2;
+
+        // Bodies can only push each other, the accumulated normal impulse stays positive
+        Vec4 normal = Vec4::Load(constraint.normal, 0.0f);
+        float normalVelocity = Vec4::Dot3(relativeVelocity(), normal);
+        float normalImpulse = std::max(constraint.normalImpulse + (constraint.targetVelocity - normalVelocity) * constraint.normalMass, 0.0f);
+        applyImpulse(normal * (normalImpulse - constraint.normalImpulse));
+        constraint.normalImpulse = normalImpulse;
+
+        // Bodies the solver must not move are shared by contacts solved in parallel, they are never written
+        if (constraint.inverseMassA > 0.0f)
+        {
+            velocityX[a] = linearA.X(); velocityY[a] = linearA.Y(); velocityZ[a] = linearA.Z();
+            angularX[a] = angularA.X(); angularY[a] = angularA.Y(); angularZ[a] = angularA.Z();
+        }
+        if (constraint.inverseMassB > 0.0f)
+        {
+            velocityX[b] = linearB.X(); velocityY[b] = linearB.Y(); velocityZ[b] = linearB.Z();
+            angularX[b] = angularB.X(); angularY[b] = angularB.Y(); angularZ[b] = angularB.Z();
+        }
+    }
+
+    void PhysicsWorld::SweepFastBodies(float timestep)
+    {
+        m_ImpactsCount = 0;
+        uint32_t pairsCount = (uint32_t)m_FastPairs.size();
+        if (pairsCount == 0)
+            return;
+
+        m_PairTimesOfImpact.resize(pairsCount);
+        uint32_t chunksCount = (pairsCount + kNarrowPhaseChunkSize - 1) / kNarrowPhaseChunkSize;
+        auto sweepChunks = [this, timestep, pairsCount](uint32_t beginChunk, uint32_t endChunk)
+        {
+            for (uint32_t iChunk = beginChunk; iChunk < endChunk; ++iChunk)
+            {
+                uint32_t begin = iChunk * kNarrowPhaseChunkSize;
+                uint32_t count = std::min(pairsCount - begin, kNarrowPhaseChunkSize);
+                SweepFastPairs(m_FastPairs.data() + begin, count, timestep, m_PairTimesOfImpact.data() + begin);
+            }
+        };
+        JobSystem* jobSystem = JobSystem::Singleton();
+        if (jobSystem != nullptr)
+            jobSystem->ParallelFor(chunksCount, 1, sweepChunks);
+        else
+            sweepChunks(0, chunksCount);
+
+        // Earliest impact of every fast body over all its pairs
+        m_TimesOfImpact.assign(m_AwakeCount, 1.0f);
+        for (uint32_t iPair = 0; iPair < pairsCount; ++iPair)
+        {
+            for (uint32_t body : { m_FastPairs[iPair].bodyA, m_FastPairs[iPair].bodyB })
+            {
+                if (body < m_AwakeCount && m_Shapes[body].isFast)
+                    m_TimesOfImpact[body] = std::min(m_TimesOfImpact[body], m_PairTimesOfImpact[iPair]);
+            }
+        }
+
+        // Bodies keep their velocity and stop just past the impact, inside the shapes they are swept against, so
+        // the contacts of the next step handle the impact instead of a sweep stopping them again
+        for (const BodyPair& pair : m_FastPairs)
+        {
+            for (uint32_t body : { pair.bodyA, pair.bodyB })
+            {
+                if (body >= m_AwakeCount || m_TimesOfImpact[body] >= 1.0f)
+                    continue;
+
+                float vx = m_Arrays[eLinearVelocityX][body], vy = m_Arrays[eLinearVelocityY][body], vz = m_Arrays[eLinearVelocityZ][body];
+                float speed = std::sqrt((vx * vx + vy * vy) + vz * vz);
+                float lostTime = (1.0f - m_TimesOfImpact[body]) * timestep - m_Settings.contactMargin / speed;
+                m_TimesOfImpact[body] = 1.0f;
+                if (!(lostTime > 0.0f))
+                    continue;
+
+                m_Arrays[ePositionX][body] -= m_Arrays[eLinearVelocityX][body] * lostTime;
+                m_Arrays[ePositionY][body] -= m_Arrays[eLinearVelocityY][body] * lostTime;
+                m_Arrays[ePositionZ][body] -= m_Arrays[eLinearVelocityZ][body] * lostTime;
+                ++m_ImpactsCount;
+            }
+        }
+    }
+
+    void PhysicsWorld::SweepFastPairs(const BodyPair* pairs, uint32_t count, float timestep, float* timesOfImpact) const
+    {
+        alignas(32) float startX[kNarrowPhaseChunkSize], startY[kNarrowPhaseChunkSize], startZ[kNarrowPhaseChunkSize];
+        alignas(32) float motionX[kNarrowPhaseChunkSize], motionY[kNarrowPhaseChunkSize], motionZ[kNarrowPhaseChunkSize];
+        alignas(32) float radius[kNarrowPhaseChunkSize];
+        alignas(32) float extentX[kNarrowPhaseChunkSize], extentY[kNarrowPhaseChunkSize], extentZ[kNarrowPhaseChunkSize];
+        alignas(32) float timeOfImpact[kNarrowPhaseChunkSize];
+        uint32_t pairIndices[kNarrowPhaseChunkSize];
+
+        // Spheres and hulls B from the front of the arrays, capsules as boxes from the back
+        uint32_t spheresCount = 0, boxesBegin = count;
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            uint32_t a = pairs[i].bodyA, b = pairs[i].bodyB;
+            const BodyShape& shapeA = m_Shapes[a];
+            const BodyShape& shapeB = m_Shapes[b];
+            uint32_t slot = shapeB.type != EShapeType::eCapsule ? spheresCount++ : --boxesBegin;
+            pairIndices[slot] = i;
+
+            startX[slot] = m_Arrays[ePositionX][a] - m_Arrays[ePositionX][b];
+            startY[slot] = m_Arrays[ePositionY][a] - m_Arrays[ePositionY][b];
+            startZ[slot] = m_Arrays[ePositionZ][a] - m_Arrays[ePositionZ][b];
+            motionX[slot] = (m_Arrays[eLinearVelocityX][a] - m_Arrays[eLinearVelocityX][b]) * timestep;
+            motionY[slot] = (m_Arrays[eLinearVelocityY][a] - m_Arrays[eLinearVelocityY][b]) * timestep;
+            motionZ[slot] = (m_Arrays[eLinearVelocityZ][a] - m_Arrays[eLinearVelocityZ][b]) * timestep;
+            // Shapes other than spheres are swept as their bounding spheres, but capsules B as their boxes
+            radius[slot] = shapeA.type == EShapeType::eSphere ? shapeA.radius : shapeA.boundingRadius;
+            if (shapeB.type == EShapeType::eCapsule)
+            {
+                Float3 axis = RotatedAxisY(m_Arrays[eRotationX][b], m_Arrays[eRotationY][b], m_Arrays[eRotationZ][b], m_Arrays[eRotationW][b]);
+                extentX[slot] = shapeB.radius + std::abs(axis.x) * shapeB.halfHeight;
+                extentY[slot] = shapeB.radius + std::abs(axis.y) * shapeB.halfHeight;
+                extentZ[slot] = shapeB.radius + std::abs(axis.z) * shapeB.halfHeight;
+            }
+            else
+            {
+                radius[slot] += shapeB.boundingRadius;
+            }
+        }
+
+        auto batchAt = [&](uint32_t offset)
+        {
+            SweptSphereBatch batch = { startX + offset, startY + offset, startZ + offset, motionX + offset, motionY + offset, motionZ + offset,
+                radius + offset, extentX + offset, extentY + offset, extentZ + offset, timeOfImpact + offset };
+            return batch;
+        };
+        NarrowPhase::SweepSpheres(batchAt(0), spheresCount);
+        NarrowPhase::SweepSphereBoxes(batchAt(boxesBegin), count - boxesBegin);
+
+        for (uint32_t slot = 0; slot < count; ++slot)
+            timesOfImpact[pairIndices[slot]] = timeOfImpact[slot];
+    }
+
+    void PhysicsWorld::QuantizeBodies(uint32_t begin, uint32_t end)
+    {
+        for (uint32_t iArray = ePositionX; iArray <= eAngularVelocityZ; ++iArray)
+        {
+            float* values = Array((EBodyArray)iArray);
+            for (uint32_t iBody = begin; iBody < end; ++iBody)
+                values[iBody] = Fixed::FromFloat(values[iBody]).ToFloat();
+        }
+    }
+
+    void PhysicsWorld::FinishStep(float timestep)
+    {
+        float sleepLinearSpeedSq = m_Settings.sleepLinearSpeed * m_Settings.sleepLinearSpeed;
+        float sleepAngularSpeedSq = m_Settings.sleepAngularSpeed * m_Settings.sleepAngularSpeed;
+        float* sleepTimes = Array(eSleepTime);
+        for (uint32_t iBody = 0; iBody < m_AwakeCount; ++iBody)
+        {
+            float vx = m_Arrays[eLinearVelocityX][iBody], vy = m_Arrays[eLinearVelocityY][iBody], vz = m_Arrays[eLinearVelocityZ][iBody];
+            float wx = m_Arrays[eAngularVelocityX][iBody], wy = m_Arrays[eAngularVelocityY][iBody], wz = m_Arrays[eAngularVelocityZ][iBody];
+            bool isSlow = (vx * vx + vy * vy) + vz * vz < sleepLinearSpeedSq && (wx * wx + wy * wy) + wz * wz < sleepAngularSpeedSq;
+            sleepTimes[iBody] = isSlow ? sleepTimes[iBody] + timestep : 0.0f;
+
+            WriteTransform(iBody);
+            m_BroadPhase.MoveProxy(m_Proxies[iBody], ComputeBounds(iBody, timestep));
+        }
+
+        // Bodies still moving wake the sleeping bodies they touch
+        for (const Contact& contact : m_Contacts)
+        {
+            uint32_t a = contact.bodyA, b = contact.bodyB;
+            if (a < m_AwakeCount && sleepTimes[a] == 0.0f && b >= m_AwakeCount && IsDynamic(b))
+                m_PendingWakes.push_back(m_Objects[b]);
+            else if (b < m_AwakeCount && sleepTimes[b] == 0.0f && a >= m_AwakeCount && IsDynamic(a))
+                m_PendingWakes.push_back(m_Objects[a]);
+        }
+
+        // Backward, so the body swapped in from the end was already checked
+        for (uint32_t iBody = m_AwakeCount; iBody-- > 0;)
+        {
+            if (sleepTimes[iBody] < m_Settings.timeToSleep)
+                continue;
+
+            for (EBodyArray array : { eLinearVelocityX, eLinearVelocityY, eLinearVelocityZ, eAngularVelocityX, eAngularVelocityY, eAngularVelocityZ })
+                m_Arrays[array][iBody] = 0.0f;
+            SwapBodies(iBody, m_AwakeCount - 1);
+            --m_AwakeCount;
+        }
+    }
+}
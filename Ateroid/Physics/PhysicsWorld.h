@@ -0,0 +1,309 @@
+#pragma once
+
+#include "NarrowPhase.h"
+#include "SweepAndPrune.h"
+#include "Core/ObjectInstanceID.h"
+#include "Core/TransformSystem.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    struct PhysicsSettings
+    {
+        Float3      gravity;
+        /** Passes of the solver over the contacts per step. */
+        uint32_t    velocityIterations;
+        /** Shapes closer than this get a contact, so resting contacts don't come and go between steps. */
+        float       contactMargin;
+        /** Ratio of the approach speed bodies bounce back with, between 0 and 1. */
+        float       restitution;
+        float       friction;
+        /** Fractions of the velocities lost per second. */
+        float       linearDamping;
+        float       angularDamping;
+        /** Bodies slower than both speeds for timeToSleep seconds fall asleep. */
+        float       sleepLinearSpeed;
+        float       sleepAngularSpeed;
+        float       timeToSleep;
+        /**
+         *  Snap the poses and velocities of bodies to Fixed after every step and when they are set, for lockstep
+         *  and replays. Coordinates must stay within the range of Fixed.
+         */
+        bool        isDeterministic;
+    };
+
+    struct RigidBodyDesc
+    {
+        EShapeType                  shape;
+        /** Radius of spheres and capsules. */
+        float                       radius;
+        /** Half the length of the segment of capsules. */
+        float                       halfHeight;
+        /** Hull of convex hulls, from PhysicsWorld::CreateConvexHull. */
+        uint32_t                    hull;
+        /** 0 for a static body, which never moves. */
+        float                       mass;
+        Float3                      position;
+        /** Unit quaternion (x, y, z, w). */
+        Float4                      rotation;
+        Float3                      linearVelocity;
+        Float3                      angularVelocity;
+        /** Projectiles and other bodies crossing small bodies in one step, they get continuous collision detection. */
+        bool                        isFast;
+        /** Root transform the pose is written to after every step, TransformSystem::kInvalidHandle for none. */
+        TransformSystem::Handle     transform;
+    };
+
+
+    /**
+     *  Rigid body simulation of the objects having a body, e.g. asteroids, debris and projectiles.\n
+     *  Bodies are found by ObjectInstanceID and stored in SoA arrays, awake bodies first, then sleeping ones,
+     *  then static ones, so the integrator and the solver only walk the front of the arrays. A step finds pairs
+     *  with a SweepAndPrune, computes contacts with NarrowPhase, solves them with sequential impulses and
+     *  integrates the awake bodies with SimdKernels.\n
+     *  There are no islands: contacts are colored so no body is twice in a color, and each color is solved in
+     *  parallel on the JobSystem if it is created. Bodies fall asleep on their own once they are slow for long
+     *  enough, and a moving body touching a sleeping one wakes it for the next step.\n
+     *  Fast bodies are swept against the bodies their swept box overlaps and stop where they first touch one,
+     *  the contacts of the next step take over from there.\n
+     *  Steps give the same results whatever the SIMD level and the numbers of workers. The deterministic mode
+     *  also snaps the state to fixed point every step, so the last bits of a float rounded differently by
+     *  another compiler don't add up over the steps, and StateChecksum tells where two runs diverge.
+     *  @remarks
+     *      Inertia is the one of the bounding sphere, which suits round asteroids. Pairs of shapes other than a
+     *      sphere against a sphere, a capsule or a hull collide as their bounding spheres.\n
+     *      Not thread-safe, bodies are modified and stepped from the simulation thread.
+     */
+    class PhysicsWorld
+    {
+    public:
+        static const uint32_t kInvalidHull = 0xFFFFFFFF;
+
+    public:
+        ASTEROID_NON_COPYABLE(PhysicsWorld)
+
+        /**
+         *  Create the PhysicsWorld singleton.
+         */
+        static PhysicsWorld* Create(const PhysicsSettings& settings)
+        {
+            ASTEROID_ASSERT(_Singleton == nullptr, "There is already a PhysicsWorld singleton created.");
+            _Singleton = ASTEROID_NEW PhysicsWorld(settings);
+            return _Singleton;
+        }
+
+        /**
+         *  Destroy the PhysicsWorld singleton. Every body and hull is destroyed with it.
+         */
+        static void Destroy()
+        {
+            ASTEROID_DELETE _Singleton;
+            _Singleton = nullptr;
+        }
+
+        /**
+         *  Current created singleton.
+         *  @return
+         *      Instance of current created singleton. nullptr if no instance created or singleton was destroyed.
+         */
+        static PhysicsWorld* Singleton() { return _Singleton; }
+
+        /**
+         *  Build a hull bodies can share, see ConvexHull::Build.
+         *  @return
+         *      The hull for RigidBodyDesc::hull, kInvalidHull if the points have no volume or are too many.
+         */
+        uint32_t CreateConvexHull(const Float3* points, uint32_t count);
+        const ConvexHull& Hull(uint32_t hull) const { return m_Hulls[hull]; }
+
+        /**
+         *  Give an object a body. Dynamic bodies start awake.
+         */
+        void AddBody(ObjectInstanceID object, const RigidBodyDesc& desc);
+        void RemoveBody(ObjectInstanceID object);
+        bool HasBody(ObjectInstanceID object) const { return object >= 0 && (size_t)object < m_BodyIndices.size() && m_BodyIndices[object] != kNoBody; }
+
+        Float3 Position(ObjectInstanceID object) const;
+        Float4 Rotation(ObjectInstanceID object) const;
+        Float3 LinearVelocity(ObjectInstanceID object) const;
+        Float3 AngularVelocity(ObjectInstanceID object) const;
+        /** Teleport a body, waking it if it is dynamic. */
+        void SetPose(ObjectInstanceID object, const Float3& position, const Float4& rotation);
+        /** Set the velocities of a dynamic body, waking it. */
+        void SetVelocity(ObjectInstanceID object, const Float3& linear, const Float3& angular);
+
+        bool IsAwake(ObjectInstanceID object) const { return m_BodyIndices[object] < m_AwakeCount; }
+        void WakeUp(ObjectInstanceID object);
+
+        /**
+         *  Advance the simulation, usually by the fixed timestep of the FrameScheduler.
+         */
+        void Step(float timestep);
+
+        const PhysicsSettings& Settings() const { return m_Settings; }
+        uint32_t BodiesCount() const { return (uint32_t)m_Objects.size(); }
+        uint32_t AwakeBodiesCount() const { return m_AwakeCount; }
+        /** Pairs of overlapping boxes found by the last step, including pairs of sleeping and static bodies. */
+        uint32_t PairsCount() const { return (uint32_t)m_Pairs.size(); }
+        uint32_t ContactsCount() const { return (uint32_t)m_Contacts.size(); }
+        /** Numbers of colors the contacts of the last step were split into. */
+        uint32_t ColorsCount() const { return m_ColorsCount; }
+        /** Fast bodies the last step stopped at an impact. */
+        uint32_t ImpactsCount() const { return m_ImpactsCount; }
+
+        /**
+         *  Hash of the ObjectInstanceID, the pose and velocities as Fixed and the awake state of every body.
+         *  Runs that are in sync have the same checksums after every step.
+         */
+        uint64_t StateChecksum() const;
+
+    private:
+        /** SoA arrays of the bodies, indexed by body index. */
+        enum EBodyArray
+        {
+            ePositionX, ePositionY, ePositionZ,
+            eRotationX, eRotationY, eRotationZ, eRotationW,
+            eLinearVelocityX, eLinearVelocityY, eLinearVelocityZ,
+            eAngularVelocityX, eAngularVelocityY, eAngularVelocityZ,
+            eInverseMass,
+            eInverseInertia,
+            /** Seconds the body has been slow for. */
+            eSleepTime,
+            eBodyArraysCount
+        };
+
+        struct BodyShape
+        {
+            EShapeType  type;
+            float       radius;
+            float       halfHeight;
+            uint32_t    hull;
+            float       boundingRadius;
+            bool        isFast;
+        };
+
+        /** Two bodies whose shapes may touch, A is the sphere for pairs of a sphere and another shape. */
+        struct BodyPair
+        {
+            uint32_t    bodyA;
+            uint32_t    bodyB;
+        };
+
+        struct Contact
+        {
+            uint32_t    bodyA;
+            uint32_t    bodyB;
+            /** Unit normal from A to B. */
+            Float3      normal;
+            Float3      point;
+            /** Distance between the shapes, negative when they penetrate. */
+            float       separation;
+        };
+
+        /** A contact prepared for the solver, bodies that must not move have no inverse mass. */
+        struct ContactConstraint
+        {
+            uint32_t    bodyA;
+            uint32_t    bodyB;
+            float       inverseMassA;
+            float       inverseMassB;
+            float       inverseInertiaA;
+            float       inverseInertiaB;
+            Float3      normal;
+            Float3      tangent1;
+            Float3      tangent2;
+            /** Contact point relative to the centers of mass. */
+            Float3      offsetA;
+            Float3      offsetB;
+            float       normalMass;
+            float       tangentMass1;
+            float       tangentMass2;
+            /** Normal velocity the solver pushes toward, negative lets speculative contacts close their gap. */
+            float       targetVelocity;
+            float       normalImpulse;
+            float       tangentImpulse1;
+            float       tangentImpulse2;
+        };
+
+        static const uint32_t kNoBody = 0xFFFFFFFF;
+        /** Colors of the parallel solver, the contacts that fit in none are solved last on one thread. */
+        static const uint32_t kParallelColorsCount = 64;
+
+        explicit PhysicsWorld(const PhysicsSettings& settings);
+
+        float* Array(EBodyArray array) { return m_Arrays[array].data(); }
+        const float* Array(EBodyArray array) const { return m_Arrays[array].data(); }
+        uint32_t BodyIndex(ObjectInstanceID object) const;
+        bool IsDynamic(uint32_t body) const { return body < m_DynamicCount; }
+        /** Swap two bodies in every array and fix the indices pointing to them. */
+        void SwapBodies(uint32_t a, uint32_t b);
+        void Wake(uint32_t body);
+        Bounds ComputeBounds(uint32_t body, float timestep) const;
+        void WriteTransform(uint32_t body);
+
+        void IntegrateVelocities(float timestep);
+        void FindContacts(float timestep);
+        /** Append the contacts of at most one narrow-phase chunk of pairs of one kind. */
+        void CollideSpherePairs(const BodyPair* pairs, uint32_t count, float timestep, Vector<Contact>* contacts) const;
+        void CollideSphereCapsulePairs(const BodyPair* pairs, uint32_t count, float timestep, Vector<Contact>* contacts) const;
+        void CollideSphereHullPairs(const BodyPair* pairs, uint32_t count, float timestep, Vector<Contact>* contacts) const;
+        /** Speculative contacts are kept if the bodies may close their gap during the step. */
+        bool KeepContact(const Contact& contact, float timestep) const;
+        void SolveContacts(float timestep);
+        void PrepareConstraint(const Contact& contact, float timestep, ContactConstraint* constraint) const;
+        void SolveConstraint(ContactConstraint& constraint);
+        /** Continuous collision detection, pulls fast bodies back so IntegratePositions stops them at their impacts. */
+        void SweepFastBodies(float timestep);
+        /** Times of impact of at most one narrow-phase chunk of fast pairs. */
+        void SweepFastPairs(const BodyPair* pairs, uint32_t count, float timestep, float* timesOfImpact) const;
+        void IntegratePositions(float timestep);
+        /** Transforms, broad-phase proxies, sleeping and waking. */
+        void FinishStep(float timestep);
+        /** Snap the poses and velocities of bodies [begin, end) to Fixed, for the deterministic mode. */
+        void QuantizeBodies(uint32_t begin, uint32_t end);
+
+    private:
+        static PhysicsWorld* _Singleton;
+
+    private:
+        PhysicsSettings                 m_Settings;
+        Vector<ConvexHull>              m_Hulls;
+
+        VectorA<float, 32>              m_Arrays[eBodyArraysCount];
+        Vector<BodyShape>               m_Shapes;
+        Vector<ObjectInstanceID>        m_Objects;
+        Vector<BroadPhase::ProxyId>     m_Proxies;
+        Vector<TransformSystem::Handle> m_Transforms;
+        uint32_t                        m_AwakeCount;
+        uint32_t                        m_DynamicCount;
+
+        /** Body index of every ObjectInstanceID, kNoBody for objects without a body. */
+        Vector<uint32_t>                m_BodyIndices;
+        /** Body index of every broad-phase proxy. */
+        Vector<uint32_t>                m_ProxyBodies;
+        /** Objects woken by contacts, woken at the beginning of the next step. */
+        Vector<ObjectInstanceID>        m_PendingWakes;
+
+        SweepAndPrune                   m_BroadPhase;
+        Vector<BroadPhasePair>          m_Pairs;
+        Vector<BodyPair>                m_SpherePairs;
+        Vector<BodyPair>                m_SphereCapsulePairs;
+        Vector<BodyPair>                m_SphereHullPairs;
+        /** Pairs of an awake fast body A and any body B, both may be fast. */
+        Vector<BodyPair>                m_FastPairs;
+        Vector<Vector<Contact>>         m_ChunkContacts;
+        Vector<Contact>                 m_Contacts;
+
+        /** Colors used by the contacts of each awake body, bit i for color i. */
+        Vector<uint64_t>                m_BodyColors;
+        Vector<uint32_t>                m_ContactColors;
+        /** Constraints sorted by color, color i in [m_ColorOffsets[i], m_ColorOffsets[i + 1]). */
+        Vector<ContactConstraint>       m_Constraints;
+        uint32_t                        m_ColorOffsets[kParallelColorsCount + 2];
+        uint32_t                        m_ColorsCount;
+
+        Vector<float>                   m_PairTimesOfImpact;
+        /** Earliest time of impact of every awake body, 1 for bodies that hit nothing. */
+        Vector<float>                   m_TimesOfImpact;
+        uint32_t                        m_ImpactsCount;
+    };
+}
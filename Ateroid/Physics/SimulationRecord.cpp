@@ -0,0 +1,96 @@
+#include "Precompile.h"
+#include "SimulationRecord.h"
+#include "Util/Archives.h"
+#include "Util/Debug.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /** "ASTR" in a little-endian file. */
+    static const uint32_t kRecordMagic = 0x52545341;
+    /** Bump when the saved fields change, older records are rejected. */
+    static const uint32_t kRecordVersion = 1;
+
+    template<typename Archive>
+    static void serialize(Archive& archive, Float3& value)
+    {
+        archive(value.x, value.y, value.z);
+    }
+
+    template<typename Archive>
+    static void serialize(Archive& archive, Float4& value)
+    {
+        archive(value.x, value.y, value.z, value.w);
+    }
+
+    template<typename Archive>
+    static void serialize(Archive& archive, PhysicsSettings& settings)
+    {
+        archive(settings.gravity, settings.velocityIterations, settings.contactMargin, settings.restitution, settings.friction,
+            settings.linearDamping, settings.angularDamping, settings.sleepLinearSpeed, settings.sleepAngularSpeed,
+            settings.timeToSleep, settings.isDeterministic);
+    }
+
+    template<typename Archive>
+    static void serialize(Archive& archive, RigidBodyDesc& desc)
+    {
+        uint8_t shape = (uint8_t)desc.shape;
+        archive(shape, desc.radius, desc.halfHeight, desc.hull, desc.mass, desc.position, desc.rotation, desc.linearVelocity,
+            desc.angularVelocity, desc.isFast);
+        desc.shape = (EShapeType)shape;
+    }
+
+    template<typename Archive>
+    static void serialize(Archive& archive, SimulationRecord::Step& step)
+    {
+        archive(step.stateChecksum, step.physicsTime);
+    }
+
+    bool SimulationRecord::Save(const String& path) const
+    {
+        std::ofstream fs(path, std::ios::binary);
+        if (!fs)
+        {
+            ASTEROID_LOG_ERROR_F("Open simulation record \"%s\" failed with err \"%s\"", path.c_str(), strerror(errno));
+            return false;
+        }
+
+        {
+            BinaryOutputArchive archive(fs);
+            archive(kRecordMagic, kRecordVersion, fixedTimestep, physicsSettings, hullPoints, bodies, steps);
+        }
+        return (bool)fs;
+    }
+
+    bool SimulationRecord::Load(const String& path)
+    {
+        std::ifstream fs(path, std::ios::binary);
+        if (!fs)
+        {
+            ASTEROID_LOG_ERROR_F("Open simulation record \"%s\" failed with err \"%s\"", path.c_str(), strerror(errno));
+            return false;
+        }
+
+        // Archives throw on truncated files
+        try
+        {
+            BinaryInputArchive archive(fs);
+            uint32_t magic = 0, version = 0;
+            archive(magic, version);
+            if (magic != kRecordMagic || version != kRecordVersion)
+            {
+                ASTEROID_LOG_ERROR_F("\"%s\" is not a simulation record of version %u.", path.c_str(), kRecordVersion);
+                return false;
+            }
+            archive(fixedTimestep, physicsSettings, hullPoints, bodies, steps);
+        }
+        catch (const cereal::Exception& exception)
+        {
+            ASTEROID_LOG_ERROR_F("Read simulation record \"%s\" failed: %s", path.c_str(), exception.what());
+            return false;
+        }
+
+        for (RigidBodyDesc& desc : bodies)
+            desc.transform = TransformSystem::kInvalidHandle;
+        return true;
+    }
+}
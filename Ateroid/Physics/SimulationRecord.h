@@ -0,0 +1,39 @@
+#pragma once
+
+#include "PhysicsWorld.h"
+#include "Util/String.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  A simulation session saved to run it again, on another build or another machine: the settings, the hulls
+     *  and the bodies it starts from, then the PhysicsWorld::StateChecksum and the time of every step.\n
+     *  Replaying the bodies instead of spawning them again keeps the comparison independent of random number
+     *  distributions and math functions, which differ between standard libraries. Files are portable binary
+     *  archives, floats are saved bit for bit.
+     */
+    struct SimulationRecord
+    {
+        struct Step
+        {
+            uint64_t    stateChecksum;
+            /** Wall-clock seconds spent in PhysicsWorld::Step. */
+            double      physicsTime;
+        };
+
+        double                  fixedTimestep;
+        PhysicsSettings         physicsSettings;
+        /** Points of every hull in the order they are created, so the hull indices of bodies stay valid. */
+        Vector<Vector<Float3>>  hullPoints;
+        /** Bodies in the order they are added, RigidBodyDesc::transform is not saved. */
+        Vector<RigidBodyDesc>   bodies;
+        Vector<Step>            steps;
+
+        bool Save(const String& path) const;
+        /**
+         *  @return
+         *      False if the file can't be read, is not a record or was saved by an incompatible version.
+         */
+        bool Load(const String& path);
+    };
+}
@@ -0,0 +1,388 @@
+#include "Precompile.h"
+#include "SweepAndPrune.h"
+#include "Core/JobSystem.h"
+#include "Math/SimdMath.h"
+#include "Util/SimdDispatch.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ASTEROID_SWEEP_AND_PRUNE_AVX
+#include <immintrin.h>
+#endif
+
+namespace ASTEROID_NAMESPACE
+{
+    /** The sorted arrays a sweep reads, padded with kPaddingCount NaN boxes that fail every comparison. */
+    struct SweepArrays
+    {
+        const float*    minA;
+        const float*    maxA;
+        const float*    minB;
+        const float*    maxB;
+        const float*    minC;
+        const float*    maxC;
+        const uint32_t* proxies;
+    };
+
+    /** Index of the lowest set bit, value must not be zero. */
+    static inline uint32_t FindFirstSet(uint32_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, value);
+        return index;
+#else
+        return __builtin_ctz(value);
+#endif
+    }
+
+    static inline void AddPair(uint32_t a, uint32_t b, Vector<BroadPhasePair>* pairs)
+    {
+        if (a < b)
+            pairs->push_back({ a, b });
+        else
+            pairs->push_back({ b, a });
+    }
+
+    // Every kernel tests box i against the boxes after it in sort order, as long as they start before box i ends
+    // along A, and adds pairs in the same order.
+
+    static void SweepRangeScalar(const SweepArrays& arrays, uint32_t begin, uint32_t end, Vector<BroadPhasePair>* pairs)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            float maxA = arrays.maxA[i];
+            float minB = arrays.minB[i], maxB = arrays.maxB[i];
+            float minC = arrays.minC[i], maxC = arrays.maxC[i];
+            for (uint32_t j = i + 1; arrays.minA[j] <= maxA; ++j)
+            {
+                if (arrays.minB[j] <= maxB && minB <= arrays.maxB[j] && arrays.minC[j] <= maxC && minC <= arrays.maxC[j])
+                    AddPair(arrays.proxies[i], arrays.proxies[j], pairs);
+            }
+        }
+    }
+
+    /** Four boxes at a time in Vec4, SSE on x86 and NEON on ARM. */
+    static void SweepRangeVec4(const SweepArrays& arrays, uint32_t begin, uint32_t end, Vector<BroadPhasePair>* pairs)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            Vec4 maxA = Vec4::Splat(arrays.maxA[i]);
+            Vec4 minB = Vec4::Splat(arrays.minB[i]), maxB = Vec4::Splat(arrays.maxB[i]);
+            Vec4 minC = Vec4::Splat(arrays.minC[i]), maxC = Vec4::Splat(arrays.maxC[i]);
+            for (uint32_t j = i + 1;; j += 4)
+            {
+                // Boxes are sorted along A, so the boxes starting before box i ends are the first lanes
+                uint32_t activeMask = Vec4::LessEqualMask(Vec4::Load(arrays.minA + j), maxA);
+                uint32_t overlapMask = activeMask &
+                    Vec4::LessEqualMask(Vec4::Load(arrays.minB + j), maxB) & Vec4::LessEqualMask(minB, Vec4::Load(arrays.maxB + j)) &
+                    Vec4::LessEqualMask(Vec4::Load(arrays.minC + j), maxC) & Vec4::LessEqualMask(minC, Vec4::Load(arrays.maxC + j));
+                for (; overlapMask != 0; overlapMask &= overlapMask - 1)
+                    AddPair(arrays.proxies[i], arrays.proxies[j + FindFirstSet(overlapMask)], pairs);
+
+                if (activeMask != 0xF)
+                    break;
+            }
+        }
+    }
+
+#ifdef ASTEROID_SWEEP_AND_PRUNE_AVX
+    ASTEROID_TARGET_AVX2
+    static void SweepRangeAVX2(const SweepArrays& arrays, uint32_t begin, uint32_t end, Vector<BroadPhasePair>* pairs)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            __m256 maxA = _mm256_set1_ps(arrays.maxA[i]);
+            __m256 minB = _mm256_set1_ps(arrays.minB[i]), maxB = _mm256_set1_ps(arrays.maxB[i]);
+            __m256 minC = _mm256_set1_ps(arrays.minC[i]), maxC = _mm256_set1_ps(arrays.maxC[i]);
+            for (uint32_t j = i + 1;; j += 8)
+            {
+                __m256 active = _mm256_cmp_ps(_mm256_loadu_ps(arrays.minA + j), maxA, _CMP_LE_OQ);
+                __m256 overlapB = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(arrays.minB + j), maxB, _CMP_LE_OQ),
+                    _mm256_cmp_ps(minB, _mm256_loadu_ps(arrays.maxB + j), _CMP_LE_OQ));
+                __m256 overlapC = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(arrays.minC + j), maxC, _CMP_LE_OQ),
+                    _mm256_cmp_ps(minC, _mm256_loadu_ps(arrays.maxC + j), _CMP_LE_OQ));
+
+                uint32_t activeMask = (uint32_t)_mm256_movemask_ps(active);
+                uint32_t overlapMask = (uint32_t)_mm256_movemask_ps(_mm256_and_ps(active, _mm256_and_ps(overlapB, overlapC)));
+                for (; overlapMask != 0; overlapMask &= overlapMask - 1)
+                    AddPair(arrays.proxies[i], arrays.proxies[j + FindFirstSet(overlapMask)], pairs);
+
+                if (activeMask != 0xFF)
+                    break;
+            }
+        }
+    }
+
+    ASTEROID_TARGET_AVX512
+    static void SweepRangeAVX512(const SweepArrays& arrays, uint32_t begin, uint32_t end, Vector<BroadPhasePair>* pairs)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            __m512 maxA = _mm512_set1_ps(arrays.maxA[i]);
+            __m512 minB = _mm512_set1_ps(arrays.minB[i]), maxB = _mm512_set1_ps(arrays.maxB[i]);
+            __m512 minC = _mm512_set1_ps(arrays.minC[i]), maxC = _mm512_set1_ps(arrays.maxC[i]);
+            for (uint32_t j = i + 1;; j += 16)
+            {
+                // Each comparison only runs on the lanes that passed the previous ones
+                __mmask16 active = _mm512_cmp_ps_mask(_mm512_loadu_ps(arrays.minA + j), maxA, _CMP_LE_OQ);
+                __mmask16 overlap = _mm512_mask_cmp_ps_mask(active, _mm512_loadu_ps(arrays.minB + j), maxB, _CMP_LE_OQ);
+                overlap = _mm512_mask_cmp_ps_mask(overlap, minB, _mm512_loadu_ps(arrays.maxB + j), _CMP_LE_OQ);
+                overlap = _mm512_mask_cmp_ps_mask(overlap, _mm512_loadu_ps(arrays.minC + j), maxC, _CMP_LE_OQ);
+                overlap = _mm512_mask_cmp_ps_mask(overlap, minC, _mm512_loadu_ps(arrays.maxC + j), _CMP_LE_OQ);
+
+                for (uint32_t overlapMask = overlap; overlapMask != 0; overlapMask &= overlapMask - 1)
+                    AddPair(arrays.proxies[i], arrays.proxies[j + FindFirstSet(overlapMask)], pairs);
+
+                if (active != 0xFFFF)
+                    break;
+            }
+        }
+    }
+#endif
+
+    using SweepRangeFunction = void(*)(const SweepArrays& arrays, uint32_t begin, uint32_t end, Vector<BroadPhasePair>* pairs);
+#ifdef ASTEROID_SWEEP_AND_PRUNE_AVX
+    static SimdKernel<SweepRangeFunction> SweepRange("SweepAndPrune.SweepRange", SweepRangeScalar, SweepRangeVec4, SweepRangeAVX2, SweepRangeAVX512);
+#else
+    static SimdKernel<SweepRangeFunction> SweepRange("SweepAndPrune.SweepRange", SweepRangeScalar, SweepRangeVec4);
+#endif
+
+
+    SweepAndPrune::SweepAndPrune()
+        : m_Axis(0)
+    {
+    }
+
+    void SweepAndPrune::OnProxyCreated(ProxyId proxy)
+    {
+        if (proxy >= m_States.size())
+            m_States.resize(proxy + 1, eUnsorted);
+
+        // A proxy destroyed and created again since the last FindPairs is still in the sort order
+        if (m_States[proxy] == eUnsorted)
+        {
+            m_States[proxy] = eAdded;
+            m_AddedProxies.push_back(proxy);
+        }
+    }
+
+    void SweepAndPrune::RefreshKeys()
+    {
+        uint32_t keysCount = 0;
+        for (uint32_t iKey = 0; iKey < m_Keys.size(); ++iKey)
+        {
+            ProxyId proxy = m_Keys[iKey].proxy;
+            if (IsAlive(proxy))
+                m_Keys[keysCount++].proxy = proxy;
+            else
+                m_States[proxy] = eUnsorted;
+        }
+        m_Keys.resize(keysCount);
+
+        // New proxies go at the end, the sort moves them to their place
+        for (ProxyId proxy : m_AddedProxies)
+        {
+            if (IsAlive(proxy))
+            {
+                m_Keys.push_back({ 0.0f, proxy });
+                m_States[proxy] = eSorted;
+            }
+            else
+            {
+                m_States[proxy] = eUnsorted;
+            }
+        }
+        m_AddedProxies.clear();
+
+        // Sort along the axis the boxes spread the most along. Switching needs a clear gain, since it costs a full sort.
+        double sums[3] = { 0.0, 0.0, 0.0 };
+        double squareSums[3] = { 0.0, 0.0, 0.0 };
+        for (const SortKey& key : m_Keys)
+        {
+            const Bounds& bounds = m_Bounds[key.proxy];
+            for (uint32_t iAxis = 0; iAxis < 3; ++iAxis)
+            {
+                double center = 0.5 * ((double)AxisValue(bounds.min, iAxis) + (double)AxisValue(bounds.max, iAxis));
+                sums[iAxis] += center;
+                squareSums[iAxis] += center * center;
+            }
+        }
+
+        if (!m_Keys.empty())
+        {
+            double variances[3];
+            for (uint32_t iAxis = 0; iAxis < 3; ++iAxis)
+            {
+                double mean = sums[iAxis] / m_Keys.size();
+                variances[iAxis] = squareSums[iAxis] / m_Keys.size() - mean * mean;
+            }
+
+            uint32_t bestAxis = 0;
+            for (uint32_t iAxis = 1; iAxis < 3; ++iAxis)
+            {
+                if (variances[iAxis] > variances[bestAxis])
+                    bestAxis = iAxis;
+            }
+            if (variances[bestAxis] > 1.5 * variances[m_Axis])
+                m_Axis = bestAxis;
+        }
+
+        for (SortKey& key : m_Keys)
+            key.min = AxisValue(m_Bounds[key.proxy].min, m_Axis);
+    }
+
+    void SweepAndPrune::RadixSort(Vector<SortKey>* keys, Vector<SortKey>* buffer)
+    {
+        const uint32_t kDigitBits = 11;
+        const uint32_t kDigitsCount = 1 << kDigitBits;
+        const uint32_t kPassesCount = 3;
+
+        // Flip floats to unsigned integers with the same order, negative values have every bit flipped
+        uint32_t keysCount = (uint32_t)keys->size();
+        auto sortableBits = [](float value)
+        {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            return bits ^ ((uint32_t)((int32_t)bits >> 31) | 0x80000000u);
+        };
+
+        Vector<uint32_t> histograms(kPassesCount * kDigitsCount, 0);
+        for (const SortKey& key : *keys)
+        {
+            uint32_t bits = sortableBits(key.min);
+            for (uint32_t iPass = 0; iPass < kPassesCount; ++iPass)
+                ++histograms[iPass * kDigitsCount + ((bits >> (iPass * kDigitBits)) & (kDigitsCount - 1))];
+        }
+
+        buffer->resize(keysCount);
+        for (uint32_t iPass = 0; iPass < kPassesCount; ++iPass)
+        {
+            uint32_t* offsets = histograms.data() + iPass * kDigitsCount;
+            uint32_t offset = 0;
+            for (uint32_t iDigit = 0; iDigit < kDigitsCount; ++iDigit)
+            {
+                uint32_t count = offsets[iDigit];
+                offsets[iDigit] = offset;
+                offset += count;
+            }
+
+            for (const SortKey& key : *keys)
+                (*buffer)[offsets[(sortableBits(key.min) >> (iPass * kDigitBits)) & (kDigitsCount - 1)]++] = key;
+            keys->swap(*buffer);
+        }
+    }
+
+    void SweepAndPrune::Sort()
+    {
+        // Keys out of order with a neighbor are taken out, sorted on their own and merged back. That is linear when
+        // few boxes moved past others since the last call. Otherwise, e.g. in dense fields, after adding many proxies
+        // or switching axis, a radix sort of every key is.
+        m_MovedKeys.clear();
+        uint32_t keysCount = (uint32_t)m_Keys.size();
+        uint32_t keptCount = 0;
+        for (uint32_t iKey = 0; iKey < keysCount; ++iKey)
+        {
+            SortKey key = m_Keys[iKey];
+            bool isInOrder = (keptCount == 0 || !(key < m_Keys[keptCount - 1])) && (iKey + 1 == keysCount || !(m_Keys[iKey + 1] < key));
+            if (isInOrder)
+                m_Keys[keptCount++] = key;
+            else
+                m_MovedKeys.push_back(key);
+        }
+
+        if (m_MovedKeys.empty())
+            return;
+
+        if (m_MovedKeys.size() * kMaxMovedKeysRatio > keysCount)
+        {
+            std::copy(m_MovedKeys.begin(), m_MovedKeys.end(), m_Keys.begin() + keptCount);
+            RadixSort(&m_Keys, &m_SortBuffer);
+            return;
+        }
+
+        std::sort(m_MovedKeys.begin(), m_MovedKeys.end());
+        m_SortBuffer.resize(keysCount);
+        std::merge(m_Keys.begin(), m_Keys.begin() + keptCount, m_MovedKeys.begin(), m_MovedKeys.end(), m_SortBuffer.begin());
+        m_Keys.swap(m_SortBuffer);
+    }
+
+    void SweepAndPrune::Gather()
+    {
+        uint32_t count = (uint32_t)m_Keys.size();
+        uint32_t paddedCount = count + kPaddingCount;
+        m_MinA.resize(paddedCount);
+        m_MaxA.resize(paddedCount);
+        m_MinB.resize(paddedCount);
+        m_MaxB.resize(paddedCount);
+        m_MinC.resize(paddedCount);
+        m_MaxC.resize(paddedCount);
+        m_SortedProxies.resize(paddedCount);
+
+        uint32_t axisB = (m_Axis + 1) % 3;
+        uint32_t axisC = (m_Axis + 2) % 3;
+        auto gatherChunks = [&](uint32_t beginChunk, uint32_t endChunk)
+        {
+            uint32_t end = std::min(endChunk * kChunkSize, count);
+            for (uint32_t i = beginChunk * kChunkSize; i < end; ++i)
+            {
+                ProxyId proxy = m_Keys[i].proxy;
+                const Bounds& bounds = m_Bounds[proxy];
+                m_MinA[i] = AxisValue(bounds.min, m_Axis);
+                m_MaxA[i] = AxisValue(bounds.max, m_Axis);
+                m_MinB[i] = AxisValue(bounds.min, axisB);
+                m_MaxB[i] = AxisValue(bounds.max, axisB);
+                m_MinC[i] = AxisValue(bounds.min, axisC);
+                m_MaxC[i] = AxisValue(bounds.max, axisC);
+                m_SortedProxies[i] = proxy;
+            }
+        };
+
+        uint32_t chunksCount = (count + kChunkSize - 1) / kChunkSize;
+        JobSystem* jobSystem = JobSystem::Singleton();
+        if (jobSystem != nullptr)
+            jobSystem->ParallelFor(chunksCount, 1, gatherChunks);
+        else
+            gatherChunks(0, chunksCount);
+
+        // NaN fails every comparison, so sweeps stop at the padding
+        const float kPadding = std::numeric_limits<float>::quiet_NaN();
+        for (uint32_t i = count; i < paddedCount; ++i)
+        {
+            m_MinA[i] = m_MaxA[i] = m_MinB[i] = m_MaxB[i] = m_MinC[i] = m_MaxC[i] = kPadding;
+            m_SortedProxies[i] = kInvalidProxy;
+        }
+    }
+
+    void SweepAndPrune::FindPairs(Vector<BroadPhasePair>* pairs)
+    {
+        RefreshKeys();
+        Sort();
+        Gather();
+
+        SweepArrays arrays = { m_MinA.data(), m_MaxA.data(), m_MinB.data(), m_MaxB.data(), m_MinC.data(), m_MaxC.data(), m_SortedProxies.data() };
+        uint32_t count = (uint32_t)m_Keys.size();
+        uint32_t chunksCount = (count + kChunkSize - 1) / kChunkSize;
+        if (m_ChunkPairs.size() < chunksCount)
+            m_ChunkPairs.resize(chunksCount);
+
+        // Every chunk adds to its own list, concatenated in chunk order so the result does not depend on threads
+        auto sweepChunks = [&](uint32_t beginChunk, uint32_t endChunk)
+        {
+            for (uint32_t iChunk = beginChunk; iChunk < endChunk; ++iChunk)
+            {
+                m_ChunkPairs[iChunk].clear();
+                SweepRange(arrays, iChunk * kChunkSize, std::min((iChunk + 1) * kChunkSize, count), &m_ChunkPairs[iChunk]);
+            }
+        };
+
+        JobSystem* jobSystem = JobSystem::Singleton();
+        if (jobSystem != nullptr)
+            jobSystem->ParallelFor(chunksCount, 1, sweepChunks);
+        else
+            sweepChunks(0, chunksCount);
+
+        pairs->clear();
+        for (uint32_t iChunk = 0; iChunk < chunksCount; ++iChunk)
+            pairs->insert(pairs->end(), m_ChunkPairs[iChunk].begin(), m_ChunkPairs[iChunk].end());
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "BroadPhase.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  A BroadPhase sorting proxies along one axis and sweeping the sorted boxes for overlaps.\n
+     *  The sort order is kept from one FindPairs to the next and only the boxes that moved out of order are sorted
+     *  again, unless so many did that a radix sort of every box is cheaper. The axis is the one the boxes spread the most along. The sweep tests a box against the next boxes of
+     *  the sorted arrays with a SimdKernel, several boxes at a time.
+     *  @remarks
+     *      Best when objects are spread along at least one axis. Dense clusters on every axis favor HashedGrid.
+     */
+    class SweepAndPrune : public BroadPhase
+    {
+    public:
+        /** Numbers of padding boxes at the end of the sorted arrays, so kernels can always load a full register. */
+        static const uint32_t kPaddingCount = 16;
+
+    public:
+        SweepAndPrune();
+
+        ASTEROID_NON_COPYABLE(SweepAndPrune)
+
+        virtual void FindPairs(Vector<BroadPhasePair>* pairs) override;
+        virtual const char* Name() const override { return "SweepAndPrune"; }
+
+        /** Axis the proxies were sorted along by the last FindPairs, 0 for x, 1 for y and 2 for z. */
+        uint32_t SortAxis() const { return m_Axis; }
+
+    protected:
+        virtual void OnProxyCreated(ProxyId proxy) override;
+        virtual void OnProxyDestroyed(ProxyId) override {}
+        virtual void OnProxyMoved(ProxyId) override {}
+
+    private:
+        struct SortKey
+        {
+            float   min;
+            ProxyId proxy;
+
+            bool operator<(const SortKey& other) const { return min < other.min || (min == other.min && proxy < other.proxy); }
+        };
+
+        enum EProxyState : uint8_t
+        {
+            /** Not in the sort order, the proxy id is free or the proxy was created since the last FindPairs. */
+            eUnsorted,
+            /** Waiting in m_AddedProxies. */
+            eAdded,
+            /** In m_Keys, possibly destroyed since the last FindPairs. */
+            eSorted
+        };
+
+        /** Sorted proxies processed per sweep job. */
+        static const uint32_t kChunkSize = 1024;
+        /** Above one key in this many out of order, every key is sorted again. */
+        static const uint32_t kMaxMovedKeysRatio = 16;
+
+        /** Drop destroyed proxies from the sort order, add the new ones and refresh the keys. */
+        void RefreshKeys();
+        void Sort();
+        /** Stable sort by min only, linear in the numbers of keys. */
+        static void RadixSort(Vector<SortKey>* keys, Vector<SortKey>* buffer);
+        /** Copy the bounds of the proxies to the sorted arrays. */
+        void Gather();
+
+    private:
+        uint32_t                        m_Axis;
+        Vector<SortKey>                 m_Keys;
+        Vector<SortKey>                 m_MovedKeys;
+        Vector<SortKey>                 m_SortBuffer;
+        Vector<ProxyId>                 m_AddedProxies;
+        Vector<uint8_t>                 m_States;
+
+        /** Bounds in sort order along the sort axis A and the two others B and C. */
+        VectorA<float, 32>              m_MinA;
+        VectorA<float, 32>              m_MaxA;
+        VectorA<float, 32>              m_MinB;
+        VectorA<float, 32>              m_MaxB;
+        VectorA<float, 32>              m_MinC;
+        VectorA<float, 32>              m_MaxC;
+        Vector<ProxyId>                 m_SortedProxies;
+
+        Vector<Vector<BroadPhasePair>>  m_ChunkPairs;
+    };
+}
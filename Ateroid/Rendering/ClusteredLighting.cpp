@@ -0,0 +1,246 @@
+#include "Precompile.h"
+#include "ClusteredLighting.h"
+#include "Core/JobSystem.h"
+#include "Math/SimdMath.h"
+#include "Util/Debug.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    ClusteredLighting::ClusteredLighting()
+        : m_SliceScale(0.0f), m_SliceBias(0.0f), m_RowStride(0)
+    {
+        GridDesc desc;
+        desc.tilesX = 16;
+        desc.tilesY = 9;
+        desc.slicesCount = 24;
+        desc.nearZ = 0.1f;
+        desc.farZ = 1000.0f;
+        desc.projectionScaleX = 1.0f;
+        desc.projectionScaleY = 1.0f;
+        SetGrid(desc);
+    }
+
+    void ClusteredLighting::SetGrid(const GridDesc& desc)
+    {
+        ASTEROID_ASSERT(desc.tilesX > 0 && desc.tilesY > 0 && desc.slicesCount > 0, "Cluster grid must not be empty.");
+        ASTEROID_ASSERT(desc.nearZ > 0.0f && desc.farZ > desc.nearZ, "Cluster grid needs 0 < nearZ < farZ.");
+        m_Grid = desc;
+
+        float logDepthRange = std::log(desc.farZ / desc.nearZ);
+        m_SliceScale = (float)desc.slicesCount / logDepthRange;
+        m_SliceBias = -(float)desc.slicesCount * std::log(desc.nearZ) / logDepthRange;
+
+        // Padding lanes get inverted bounds, which no sphere overlaps
+        const float kInfinity = std::numeric_limits<float>::infinity();
+        m_RowStride = (desc.tilesX + 3) & ~3u;
+        uint32_t boundsCount = desc.slicesCount * desc.tilesY * m_RowStride;
+        m_MinX.assign(boundsCount, kInfinity);
+        m_MinY.assign(boundsCount, kInfinity);
+        m_MinZ.assign(boundsCount, kInfinity);
+        m_MaxX.assign(boundsCount, -kInfinity);
+        m_MaxY.assign(boundsCount, -kInfinity);
+        m_MaxZ.assign(boundsCount, -kInfinity);
+
+        m_SliceDepths.resize(desc.slicesCount + 1);
+        for (uint32_t iSlice = 0; iSlice <= desc.slicesCount; ++iSlice)
+            m_SliceDepths[iSlice] = desc.nearZ * std::pow(desc.farZ / desc.nearZ, (float)iSlice / desc.slicesCount);
+
+        for (uint32_t iSlice = 0; iSlice < desc.slicesCount; ++iSlice)
+        {
+            float nearZ = m_SliceDepths[iSlice];
+            float farZ = m_SliceDepths[iSlice + 1];
+            for (uint32_t iTileY = 0; iTileY < desc.tilesY; ++iTileY)
+            {
+                // Tile rows start at the top of the screen
+                float topNdc = 1.0f - 2.0f * iTileY / desc.tilesY;
+                float bottomNdc = 1.0f - 2.0f * (iTileY + 1) / desc.tilesY;
+                for (uint32_t iTileX = 0; iTileX < desc.tilesX; ++iTileX)
+                {
+                    float leftNdc = -1.0f + 2.0f * iTileX / desc.tilesX;
+                    float rightNdc = -1.0f + 2.0f * (iTileX + 1) / desc.tilesX;
+
+                    // The tile's side planes go through the eye, so the extremes are at the near or far depth
+                    uint32_t bounds = (iSlice * desc.tilesY + iTileY) * m_RowStride + iTileX;
+                    m_MinX[bounds] = std::min(leftNdc * nearZ, leftNdc * farZ) / desc.projectionScaleX;
+                    m_MaxX[bounds] = std::max(rightNdc * nearZ, rightNdc * farZ) / desc.projectionScaleX;
+                    m_MinY[bounds] = std::min(bottomNdc * nearZ, bottomNdc * farZ) / desc.projectionScaleY;
+                    m_MaxY[bounds] = std::max(topNdc * nearZ, topNdc * farZ) / desc.projectionScaleY;
+                    m_MinZ[bounds] = nearZ;
+                    m_MaxZ[bounds] = farZ;
+                }
+            }
+        }
+
+        m_Clusters.resize(ClustersCount());
+        m_ClusterCursors.resize(ClustersCount());
+        m_SliceHits.resize(desc.slicesCount);
+    }
+
+    uint32_t ClusteredLighting::Slice(float viewZ) const
+    {
+        if (viewZ <= m_Grid.nearZ)
+            return 0;
+        float slice = std::log(viewZ) * m_SliceScale + m_SliceBias;
+        return std::min((uint32_t)slice, m_Grid.slicesCount - 1);
+    }
+
+    static uint32_t NdcToTile(float ndc, uint32_t tilesCount)
+    {
+        float tile = (ndc + 1.0f) * 0.5f * tilesCount;
+        return (uint32_t)std::min(std::max(tile, 0.0f), (float)(tilesCount - 1));
+    }
+
+    uint32_t ClusteredLighting::Assign(const Float4x4& view, const PointLight* lights, uint32_t lightsCount)
+    {
+        if (lightsCount > kMaxLights)
+        {
+            ASTEROID_LOG_WARNING_F("ClusteredLighting ignores %u lights beyond the maximum.", lightsCount - kMaxLights);
+            lightsCount = kMaxLights;
+        }
+
+        // Conservative cluster ranges per light, the SIMD test in AssignSlice refines them
+        m_ViewLights.resize(lightsCount);
+        for (uint32_t iLight = 0; iLight < lightsCount; ++iLight)
+        {
+            const PointLight& light = lights[iLight];
+            ViewLight& viewLight = m_ViewLights[iLight];
+
+            // Row vector times the affine view matrix
+            const Float3& p = light.position;
+            Float3 center(
+                p.x * view._11 + p.y * view._21 + p.z * view._31 + view._41,
+                p.x * view._12 + p.y * view._22 + p.z * view._32 + view._42,
+                p.x * view._13 + p.y * view._23 + p.z * view._33 + view._43);
+            viewLight.x = center.x;
+            viewLight.y = center.y;
+            viewLight.z = center.z;
+            viewLight.radius = light.radius;
+
+            // An empty slice range skips the light
+            viewLight.minSlice = 1;
+            viewLight.maxSlice = 0;
+            float nearZ = std::max(center.z - light.radius, m_Grid.nearZ);
+            float farZ = std::min(center.z + light.radius, m_Grid.farZ);
+            if (nearZ > farZ)
+                continue;
+
+            // The logarithm may round across a slice boundary the light's depth range still touches
+            uint32_t minSlice = Slice(nearZ), maxSlice = Slice(farZ);
+            while (minSlice > 0 && nearZ <= m_SliceDepths[minSlice])
+                --minSlice;
+            while (maxSlice + 1 < m_Grid.slicesCount && farZ >= m_SliceDepths[maxSlice + 1])
+                ++maxSlice;
+
+            // Cluster bounds span their whole slice and widen with depth, so the corners of the light's box projected
+            // at the depths where its first slice starts and its last one ends bound every tile whose bounds it touches
+            float minNdcX = std::numeric_limits<float>::max(), maxNdcX = -minNdcX;
+            float minNdcY = minNdcX, maxNdcY = -minNdcX;
+            for (float z : { m_SliceDepths[minSlice], m_SliceDepths[maxSlice + 1] })
+            {
+                for (float sign : { -1.0f, 1.0f })
+                {
+                    float ndcX = (center.x + sign * light.radius) * m_Grid.projectionScaleX / z;
+                    float ndcY = (center.y + sign * light.radius) * m_Grid.projectionScaleY / z;
+                    minNdcX = std::min(minNdcX, ndcX);
+                    maxNdcX = std::max(maxNdcX, ndcX);
+                    minNdcY = std::min(minNdcY, ndcY);
+                    maxNdcY = std::max(maxNdcY, ndcY);
+                }
+            }
+            if (maxNdcX < -1.0f || minNdcX > 1.0f || maxNdcY < -1.0f || minNdcY > 1.0f)
+                continue;
+
+            viewLight.minTileX = NdcToTile(minNdcX, m_Grid.tilesX);
+            viewLight.maxTileX = NdcToTile(maxNdcX, m_Grid.tilesX);
+            viewLight.minTileY = m_Grid.tilesY - 1 - NdcToTile(maxNdcY, m_Grid.tilesY);
+            viewLight.maxTileY = m_Grid.tilesY - 1 - NdcToTile(minNdcY, m_Grid.tilesY);
+            viewLight.minSlice = minSlice;
+            viewLight.maxSlice = maxSlice;
+        }
+
+        auto assignSlices = [this](uint32_t beginSlice, uint32_t endSlice)
+        {
+            for (uint32_t iSlice = beginSlice; iSlice < endSlice; ++iSlice)
+                AssignSlice(iSlice);
+        };
+
+        JobSystem* jobSystem = JobSystem::Singleton();
+        if (jobSystem != nullptr)
+            jobSystem->ParallelFor(m_Grid.slicesCount, 1, assignSlices);
+        else
+            assignSlices(0, m_Grid.slicesCount);
+
+        uint32_t indicesCount = 0;
+        for (uint32_t iCluster = 0; iCluster < m_Clusters.size(); ++iCluster)
+        {
+            m_Clusters[iCluster].offset = indicesCount;
+            m_ClusterCursors[iCluster] = indicesCount;
+            indicesCount += m_Clusters[iCluster].count;
+        }
+
+        // Slices own disjoint clusters, so they scatter their hits without synchronization
+        m_LightIndices.resize(indicesCount);
+        auto scatterSlices = [this](uint32_t beginSlice, uint32_t endSlice)
+        {
+            for (uint32_t iSlice = beginSlice; iSlice < endSlice; ++iSlice)
+            {
+                for (const Hit& hit : m_SliceHits[iSlice])
+                    m_LightIndices[m_ClusterCursors[hit.cluster]++] = hit.light;
+            }
+        };
+
+        if (jobSystem != nullptr)
+            jobSystem->ParallelFor(m_Grid.slicesCount, 1, scatterSlices);
+        else
+            scatterSlices(0, m_Grid.slicesCount);
+
+        return indicesCount;
+    }
+
+    void ClusteredLighting::AssignSlice(uint32_t slice)
+    {
+        Vector<Hit>& hits = m_SliceHits[slice];
+        hits.clear();
+        uint32_t firstCluster = ClusterIndex(0, 0, slice);
+        for (uint32_t iCluster = 0; iCluster < m_Grid.tilesX * m_Grid.tilesY; ++iCluster)
+            m_Clusters[firstCluster + iCluster].count = 0;
+
+        const Vec4 kZero = Vec4::Zero();
+        for (uint32_t iLight = 0; iLight < m_ViewLights.size(); ++iLight)
+        {
+            const ViewLight& light = m_ViewLights[iLight];
+            if (slice < light.minSlice || slice > light.maxSlice)
+                continue;
+
+            Vec4 centerX = Vec4::Splat(light.x);
+            Vec4 centerY = Vec4::Splat(light.y);
+            Vec4 centerZ = Vec4::Splat(light.z);
+            Vec4 radiusSq = Vec4::Splat(light.radius * light.radius);
+            for (uint32_t iTileY = light.minTileY; iTileY <= light.maxTileY; ++iTileY)
+            {
+                uint32_t row = (slice * m_Grid.tilesY + iTileY) * m_RowStride;
+                for (uint32_t iTileX = light.minTileX & ~3u; iTileX <= light.maxTileX; iTileX += 4)
+                {
+                    // Squared distance from the light center to four cluster boxes
+                    uint32_t bounds = row + iTileX;
+                    Vec4 dx = Vec4::Max(Vec4::Load(&m_MinX[bounds]) - centerX, kZero) + Vec4::Max(centerX - Vec4::Load(&m_MaxX[bounds]), kZero);
+                    Vec4 dy = Vec4::Max(Vec4::Load(&m_MinY[bounds]) - centerY, kZero) + Vec4::Max(centerY - Vec4::Load(&m_MaxY[bounds]), kZero);
+                    Vec4 dz = Vec4::Max(Vec4::Load(&m_MinZ[bounds]) - centerZ, kZero) + Vec4::Max(centerZ - Vec4::Load(&m_MaxZ[bounds]), kZero);
+                    Vec4 distanceSq = (dx * dx + dy * dy) + dz * dz;
+                    uint32_t mask = Vec4::LessEqualMask(distanceSq, radiusSq);
+
+                    for (uint32_t lane = 0; lane < 4 && mask != 0; ++lane, mask >>= 1)
+                    {
+                        uint32_t tileX = iTileX + lane;
+                        if ((mask & 1) == 0 || tileX < light.minTileX || tileX > light.maxTileX)
+                            continue;
+
+                        Hit hit = { ClusterIndex(tileX, iTileY, slice), (uint16_t)iLight };
+                        hits.push_back(hit);
+                        ++m_Clusters[hit.cluster].count;
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include "Math/MathTypes.h"
+#include "Util/Containers.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  A dynamic point light as uploaded to the GPU.
+     */
+    struct PointLight
+    {
+        Float3              position;
+        /** Distance at which the light has faded out, it doesn't affect anything beyond. */
+        float               radius;
+        Float3              color;
+        float               intensity;
+    };
+
+
+    /**
+     *  Assigns point lights to the clusters of a froxel grid over the view frustum.\n
+     *  The grid splits the screen into tiles and the depth range into exponentially growing slices. Every cluster
+     *  gets a compact range of light indices, which shaders look up by computing the cluster of their pixel.
+     *  Slices are assigned in parallel on the JobSystem if it is created, and each light is tested against four
+     *  clusters of a tile row at a time in Vec4.
+     *  @remarks
+     *      View space is left-handed with +z forward, as produced by XMMatrixLookAtLH.
+     */
+    class ClusteredLighting
+    {
+    public:
+        struct GridDesc
+        {
+            uint32_t    tilesX;
+            uint32_t    tilesY;
+            uint32_t    slicesCount;
+            float       nearZ;
+            float       farZ;
+            /** _11 and _22 of the perspective projection matrix. */
+            float       projectionScaleX;
+            float       projectionScaleY;
+        };
+
+        /** Range of ClusteredLighting::LightIndices belonging to a cluster. */
+        struct ClusterRange
+        {
+            uint32_t    offset;
+            uint32_t    count;
+        };
+
+        /** Light indices are 16 bits to keep the lists compact. */
+        static const uint32_t kMaxLights = 0xFFFF;
+
+    public:
+        ClusteredLighting();
+
+        ASTEROID_NON_COPYABLE(ClusteredLighting)
+
+        /**
+         *  Change the grid, e.g. when the resolution or the projection change. Cluster bounds are rebuilt.
+         */
+        void SetGrid(const GridDesc& desc);
+        const GridDesc& Grid() const { return m_Grid; }
+
+        /**
+         *  Assign lights to clusters.
+         *  @param view
+         *      Row-major view matrix the light positions are transformed by.
+         *  @return
+         *      Numbers of light indices written, the size of LightIndices.
+         */
+        uint32_t Assign(const Float4x4& view, const PointLight* lights, uint32_t lightsCount);
+
+        uint32_t ClustersCount() const { return m_Grid.tilesX * m_Grid.tilesY * m_Grid.slicesCount; }
+        uint32_t ClusterIndex(uint32_t tileX, uint32_t tileY, uint32_t slice) const { return (slice * m_Grid.tilesY + tileY) * m_Grid.tilesX + tileX; }
+
+        /**
+         *  Slice of a view space depth, shaders compute it as log(z) * SliceScale() + SliceBias().
+         */
+        uint32_t Slice(float viewZ) const;
+        float SliceScale() const { return m_SliceScale; }
+        float SliceBias() const { return m_SliceBias; }
+
+        /** Light index range per cluster, indexed by ClusterIndex. */
+        const Vector<ClusterRange>& Clusters() const { return m_Clusters; }
+        /** Light indices of every cluster, one after the other. */
+        const Vector<uint16_t>& LightIndices() const { return m_LightIndices; }
+
+    private:
+        template<typename T>
+        using LaneVector = VectorA<T, 16>;
+
+        /** A light in view space with the clusters its bounds may overlap. */
+        struct ViewLight
+        {
+            float       x, y, z, radius;
+            uint32_t    minTileX, maxTileX;
+            uint32_t    minTileY, maxTileY;
+            uint32_t    minSlice, maxSlice;
+        };
+
+        struct Hit
+        {
+            uint32_t    cluster;
+            uint16_t    light;
+        };
+
+        void AssignSlice(uint32_t slice);
+
+    private:
+        GridDesc    m_Grid;
+        float       m_SliceScale;
+        float       m_SliceBias;
+        /** View space depth where every slice starts, and the far depth last. */
+        Vector<float>   m_SliceDepths;
+
+        /** View space bounds per cluster. Rows of tiles are padded to a multiple of 4 with empty bounds. */
+        uint32_t            m_RowStride;
+        LaneVector<float>   m_MinX, m_MinY, m_MinZ;
+        LaneVector<float>   m_MaxX, m_MaxY, m_MaxZ;
+
+        Vector<ViewLight>       m_ViewLights;
+        Vector<Vector<Hit>>     m_SliceHits;
+        Vector<ClusterRange>    m_Clusters;
+        /** Write positions of the clusters while hits are scattered into the light indices. */
+        Vector<uint32_t>        m_ClusterCursors;
+        Vector<uint16_t>        m_LightIndices;
+    };
+}
@@ -0,0 +1,265 @@
+#include "Precompile.h"
+#include "CullingBenchmark.h"
+#include "FrustumCulling.h"
+#include "OcclusionCulling.h"
+#include "Math/SimdMath.h"
+#include "Util/Debug.h"
+#include "Util/SimdDispatch.h"
+#include <random>
+
+namespace ASTEROID_NAMESPACE
+{
+    /** Average distance between objects. */
+    static const float kSpacing = 12.0f;
+    static const float kMinRadius = 0.5f;
+    static const float kMaxRadius = 16.0f;
+    /** Exponent of the power law of object sizes, small ones are the most common. */
+    static const float kSizeExponent = 2.5f;
+    static const float kBoxesRatio = 0.25f;
+    static const float kFieldOfView = 1.0f;
+    static const float kAspectRatio = 16.0f / 9.0f;
+    static const float kNearPlane = 0.5f;
+    static const uint32_t kOcclusionWidth = 320;
+    static const uint32_t kOcclusionHeight = 180;
+    /** Objects covering the most of the screen are rasterized as box occluders. */
+    static const uint32_t kOccludersCount = 64;
+
+    static const Float3 kBoxPositions[] =
+    {
+        Float3(-1.0f, -1.0f, -1.0f), Float3(1.0f, -1.0f, -1.0f), Float3(-1.0f, 1.0f, -1.0f), Float3(1.0f, 1.0f, -1.0f),
+        Float3(-1.0f, -1.0f, 1.0f), Float3(1.0f, -1.0f, 1.0f), Float3(-1.0f, 1.0f, 1.0f), Float3(1.0f, 1.0f, 1.0f),
+    };
+    static const uint32_t kBoxIndices[] =
+    {
+        0, 2, 1, 1, 2, 3,   4, 5, 6, 5, 7, 6,   0, 1, 4, 1, 5, 4,
+        2, 6, 3, 3, 6, 7,   0, 4, 2, 2, 4, 6,   1, 3, 5, 3, 7, 5,
+    };
+
+    typedef std::chrono::steady_clock BenchmarkClock;
+
+    static double ElapsedMilliseconds(BenchmarkClock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(BenchmarkClock::now() - start).count();
+    }
+
+    static void GenerateObjects(uint32_t count, uint32_t seed, float side, BoundingVolumeArray* volumes)
+    {
+        std::mt19937 random(seed);
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+        volumes->Resize(count);
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            Float3 center((uniform(random) - 0.5f) * side, (uniform(random) - 0.5f) * side, (uniform(random) - 0.5f) * side);
+            // Inverse of the cumulative distribution of a power law truncated to the radius range
+            float ratio = std::pow(kMinRadius / kMaxRadius, kSizeExponent);
+            float radius = kMinRadius / std::pow(1.0f - uniform(random) * (1.0f - ratio), 1.0f / kSizeExponent);
+            if (uniform(random) < kBoxesRatio)
+            {
+                Float3 extents(radius * (0.25f + uniform(random)), radius * (0.25f + uniform(random)), radius * (0.25f + uniform(random)));
+                volumes->SetBox(i, center, extents);
+            }
+            else
+            {
+                volumes->SetSphere(i, center, radius);
+            }
+        }
+    }
+
+    /** The camera in the middle of the field, turning around the vertical axis and looking a bit up or down. */
+    static Float4x4 CameraViewProjection(uint32_t iFrame, uint32_t framesCount, float farPlane)
+    {
+        float yaw = 6.2831853f * (float)iFrame / (float)std::max(framesCount, 1u);
+        float pitch = 0.3f * std::sin(yaw * 3.0f);
+        Vec4 eye = Vec4::Set(0.0f, 0.0f, 0.0f, 1.0f);
+        Vec4 target = Vec4::Set(std::sin(yaw) * std::cos(pitch), std::sin(pitch), std::cos(yaw) * std::cos(pitch), 1.0f);
+        Mat4 view = Mat4::LookAtLH(eye, target, Vec4::Set(0.0f, 1.0f, 0.0f, 0.0f));
+        Mat4 projection = Mat4::PerspectiveFovLH(kFieldOfView, kAspectRatio, kNearPlane, farPlane);
+        Float4x4 viewProjection;
+        (view * projection).Store(viewProjection);
+        return viewProjection;
+    }
+
+    /** The largest objects on screen, the camera is at the origin. */
+    static void SelectOccluders(const BoundingVolumeArray& volumes, const Vector<uint32_t>& visibleIndices, Vector<uint32_t>* occluders)
+    {
+        *occluders = visibleIndices;
+        auto screenSize = [&volumes](uint32_t index)
+        {
+            float x = volumes.CenterX()[index], y = volumes.CenterY()[index], z = volumes.CenterZ()[index];
+            return volumes.Radius()[index] / std::max(std::sqrt(x * x + y * y + z * z), kNearPlane);
+        };
+        uint32_t count = std::min((uint32_t)occluders->size(), kOccludersCount);
+        std::partial_sort(occluders->begin(), occluders->begin() + count, occluders->end(),
+            [&screenSize](uint32_t a, uint32_t b) { return screenSize(a) > screenSize(b) || (screenSize(a) == screenSize(b) && a < b); });
+        occluders->resize(count);
+    }
+
+    /**
+     *  Whether a box is hidden by the full resolution depth buffer, projected the same way as
+     *  OcclusionCuller::IsVisible. The hierarchy may only hide boxes this hides too.
+     */
+    static bool IsHiddenPerPixel(const OcclusionCuller& culler, const Float4x4& viewProjection, const Float3& center, const Float3& extents)
+    {
+        Mat4 m = Mat4::Load(viewProjection);
+        float width = (float)culler.Width(), height = (float)culler.Height();
+        float minX = std::numeric_limits<float>::max(), maxX = -minX;
+        float minY = minX, maxY = -minX;
+        float minZ = minX;
+        for (int iCorner = 0; iCorner < 8; ++iCorner)
+        {
+            float x = center.x + ((iCorner & 1) ? extents.x : -extents.x);
+            float y = center.y + ((iCorner & 2) ? extents.y : -extents.y);
+            float z = center.z + ((iCorner & 4) ? extents.z : -extents.z);
+            Float4 clip;
+            Mat4::TransformPoint(Vec4::Set(x, y, z, 1.0f), m).Store(clip);
+            if (clip.w < 1e-5f)
+                return false;
+            float invW = 1.0f / clip.w;
+            float sx = (clip.x * invW * 0.5f + 0.5f) * width;
+            float sy = (0.5f - clip.y * invW * 0.5f) * height;
+            minX = std::min(minX, sx);
+            maxX = std::max(maxX, sx);
+            minY = std::min(minY, sy);
+            maxY = std::max(maxY, sy);
+            minZ = std::min(minZ, clip.z * invW);
+        }
+        if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height)
+            return false;
+
+        uint32_t x0 = (uint32_t)std::max(minX, 0.0f), x1 = (uint32_t)std::min(maxX, width - 1.0f);
+        uint32_t y0 = (uint32_t)std::max(minY, 0.0f), y1 = (uint32_t)std::min(maxY, height - 1.0f);
+        for (uint32_t y = y0; y <= y1; ++y)
+        {
+            for (uint32_t x = x0; x <= x1; ++x)
+            {
+                if (minZ <= culler.PixelDepth(x, y))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    bool CullingBenchmark::Run(const CullingBenchmarkSettings& settings)
+    {
+        ASTEROID_LOG_INFO_F("Culling benchmark: %u objects, %u frames, SIMD levels up to %s.", settings.objectsCount,
+            settings.framesCount, SimdDispatch::LevelName(SimdDispatch::DetectedLevel()));
+
+        float side = std::cbrt((float)settings.objectsCount) * kSpacing;
+        BoundingVolumeArray volumes;
+        GenerateObjects(settings.objectsCount, settings.seed, side, &volumes);
+
+        uint32_t framesCount = std::max(settings.framesCount, 1u);
+        Vector<Float4x4> viewProjections(framesCount);
+        Vector<Frustum> frustums(framesCount);
+        for (uint32_t iFrame = 0; iFrame < framesCount; ++iFrame)
+        {
+            viewProjections[iFrame] = CameraViewProjection(iFrame, framesCount, side * 0.5f);
+            frustums[iFrame] = Frustum::FromViewProjection(viewProjections[iFrame]);
+        }
+
+        FrustumCuller culler;
+        Vector<uint32_t> visibleIndices;
+        Vector<Vector<uint32_t>> referenceIndices(framesCount);
+
+        bool isValid = true;
+        ESimdLevel previousLevel = SimdDispatch::Level();
+        for (uint32_t iLevel = 0; iLevel <= (uint32_t)SimdDispatch::DetectedLevel(); ++iLevel)
+        {
+            ESimdLevel level = (ESimdLevel)iLevel;
+            SimdDispatch::SetLevel(level);
+
+            double cullTime = 0.0;
+            uint64_t visibleCount = 0;
+            for (uint32_t iFrame = 0; iFrame < framesCount; ++iFrame)
+            {
+                BenchmarkClock::time_point start = BenchmarkClock::now();
+                visibleCount += culler.Cull(frustums[iFrame], volumes, &visibleIndices);
+                cullTime += ElapsedMilliseconds(start);
+
+                if (level == ESimdLevel::eScalar)
+                {
+                    referenceIndices[iFrame] = visibleIndices;
+                }
+                else if (visibleIndices != referenceIndices[iFrame])
+                {
+                    ASTEROID_LOG_ERROR_F("Frustum culling at level %s found %zu visible objects instead of %zu in frame %u.",
+                        SimdDispatch::LevelName(level), visibleIndices.size(), referenceIndices[iFrame].size(), iFrame);
+                    isValid = false;
+                }
+            }
+
+            ASTEROID_LOG_INFO_F("    %-6s: frustum culling %8.3f ms per frame, %.0f visible",
+                SimdDispatch::LevelName(level), cullTime / framesCount, (double)visibleCount / framesCount);
+        }
+        SimdDispatch::SetLevel(previousLevel);
+
+        // Occlusion of what the frustum kept, every hidden object is checked against the depth buffer
+        OcclusionCuller occlusionCuller(kOcclusionWidth, kOcclusionHeight);
+        Vector<uint32_t> occluders;
+        Vector<uint32_t> unoccludedIndices;
+        double addTime = 0.0, rasterizeTime = 0.0, occlusionTime = 0.0;
+        uint64_t testedCount = 0, hiddenCount = 0, trianglesCount = 0, wronglyHiddenCount = 0;
+        for (uint32_t iFrame = 0; iFrame < framesCount; ++iFrame)
+        {
+            culler.Cull(frustums[iFrame], volumes, &visibleIndices);
+            SelectOccluders(volumes, visibleIndices, &occluders);
+
+            BenchmarkClock::time_point start = BenchmarkClock::now();
+            occlusionCuller.BeginFrame(viewProjections[iFrame]);
+            for (uint32_t index : occluders)
+            {
+                Float3 extents(volumes.ExtentX()[index], volumes.ExtentY()[index], volumes.ExtentZ()[index]);
+                Float4x4 world(extents.x, 0.0f, 0.0f, 0.0f,
+                               0.0f, extents.y, 0.0f, 0.0f,
+                               0.0f, 0.0f, extents.z, 0.0f,
+                               volumes.CenterX()[index], volumes.CenterY()[index], volumes.CenterZ()[index], 1.0f);
+                occlusionCuller.AddOccluder(kBoxPositions, 8, kBoxIndices, 36, world);
+            }
+            addTime += ElapsedMilliseconds(start);
+            trianglesCount += occlusionCuller.TrianglesCount();
+
+            start = BenchmarkClock::now();
+            occlusionCuller.RasterizeOccluders();
+            rasterizeTime += ElapsedMilliseconds(start);
+
+            start = BenchmarkClock::now();
+            occlusionCuller.Cull(volumes, visibleIndices.data(), (uint32_t)visibleIndices.size(), &unoccludedIndices);
+            occlusionTime += ElapsedMilliseconds(start);
+            testedCount += visibleIndices.size();
+            hiddenCount += visibleIndices.size() - unoccludedIndices.size();
+
+            // Both lists are in ascending order, so the hidden objects are the gaps
+            size_t iUnoccluded = 0;
+            for (uint32_t index : visibleIndices)
+            {
+                if (iUnoccluded < unoccludedIndices.size() && unoccludedIndices[iUnoccluded] == index)
+                {
+                    ++iUnoccluded;
+                    continue;
+                }
+                Float3 center(volumes.CenterX()[index], volumes.CenterY()[index], volumes.CenterZ()[index]);
+                Float3 extents(volumes.ExtentX()[index], volumes.ExtentY()[index], volumes.ExtentZ()[index]);
+                if (!IsHiddenPerPixel(occlusionCuller, viewProjections[iFrame], center, extents))
+                    ++wronglyHiddenCount;
+            }
+        }
+
+        ASTEROID_LOG_INFO_F("    occlusion %ux%u: add %u occluders %7.3f ms, rasterize %7.3f ms, cull %7.3f ms per frame, "
+            "%.0f triangles, %.0f of %.0f objects hidden", kOcclusionWidth, kOcclusionHeight, kOccludersCount,
+            addTime / framesCount, rasterizeTime / framesCount, occlusionTime / framesCount, (double)trianglesCount / framesCount,
+            (double)hiddenCount / framesCount, (double)testedCount / framesCount);
+        if (wronglyHiddenCount > 0)
+        {
+            ASTEROID_LOG_ERROR_F("Occlusion culling hid %llu objects that are visible in the depth buffer.",
+                (unsigned long long)wronglyHiddenCount);
+            isValid = false;
+        }
+        if (hiddenCount == 0 && testedCount > kOccludersCount * (uint64_t)framesCount)
+        {
+            ASTEROID_LOG_ERROR("Occlusion culling hid no object behind the occluders.");
+            isValid = false;
+        }
+        return isValid;
+    }
+}
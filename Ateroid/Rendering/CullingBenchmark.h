@@ -0,0 +1,38 @@
+#pragma once
+
+namespace ASTEROID_NAMESPACE
+{
+    struct CullingBenchmarkSettings
+    {
+        uint32_t    objectsCount;
+        /** Camera directions culled for each SIMD level, the camera turns around between frames. */
+        uint32_t    framesCount;
+        uint32_t    seed;
+    };
+
+
+    /**
+     *  Times the FrustumCuller at every SIMD level the CPU supports on a field of asteroids around the camera,
+     *  spheres and boxes of sizes following a power law. The scalar level is the reference: every other level must
+     *  find the same visible objects in the same order.\n
+     *  Then times the OcclusionCuller on the objects the frustum kept, with the largest ones on screen as box
+     *  occluders. Every object it hides must be hidden at every pixel of the depth buffer it covers, and it must hide
+     *  some.
+     *  @remarks
+     *      Dispatches every kernel with SimdDispatch::SetLevel, the level in use before is restored. Chunks are
+     *      culled on the JobSystem if it is created.
+     */
+    class CullingBenchmark
+    {
+    public:
+        ASTEROID_NO_DEFAULT_CTOR(CullingBenchmark)
+        ASTEROID_NON_COPYABLE(CullingBenchmark)
+
+        /**
+         *  @return
+         *      False if a level did not find the same visible objects as the scalar one, or occlusion culling
+         *      hid a visible object or nothing at all.
+         */
+        static bool Run(const CullingBenchmarkSettings& settings);
+    };
+}
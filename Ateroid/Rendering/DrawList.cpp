@@ -0,0 +1,147 @@
+#include "Precompile.h"
+#include "DrawList.h"
+#include "Core/JobSystem.h"
+#include "Util/Debug.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    DrawList::DrawList()
+        : m_Arena(nullptr), m_Keys(nullptr), m_Payloads(nullptr), m_Capacity(0), m_Count(0)
+    {
+    }
+
+    bool DrawList::Begin(FrameArena* arena, uint32_t maxDraws)
+    {
+        m_Arena = arena;
+        m_Keys = arena->Allocate<uint64_t>(maxDraws);
+        m_Payloads = arena->Allocate<uint32_t>(maxDraws);
+        m_Capacity = m_Keys != nullptr && m_Payloads != nullptr ? maxDraws : 0;
+        m_Count.store(0, std::memory_order_relaxed);
+        return m_Capacity == maxDraws;
+    }
+
+    bool DrawList::Add(uint64_t key, uint32_t payload)
+    {
+        uint32_t index = m_Count.fetch_add(1, std::memory_order_relaxed);
+        if (index >= m_Capacity)
+            return false;
+
+        m_Keys[index] = key;
+        m_Payloads[index] = payload;
+        return true;
+    }
+
+    void DrawList::Sort()
+    {
+        uint32_t count = Count();
+        m_Count.store(count, std::memory_order_relaxed);
+        if (count < 2)
+            return;
+
+        // Ping-pong buffers for the scatter passes, from the same arena
+        uint64_t* scratchKeys = m_Arena->Allocate<uint64_t>(count);
+        uint32_t* scratchPayloads = m_Arena->Allocate<uint32_t>(count);
+        if (scratchKeys == nullptr || scratchPayloads == nullptr)
+        {
+            ASTEROID_LOG_WARNING("DrawList::Sort fell back to a comparison sort, the frame arena is full.");
+            Vector<std::pair<uint64_t, uint32_t>> entries(count);
+            for (uint32_t iDraw = 0; iDraw < count; ++iDraw)
+                entries[iDraw] = std::make_pair(m_Keys[iDraw], m_Payloads[iDraw]);
+            std::stable_sort(entries.begin(), entries.end(),
+                [](const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b) { return a.first < b.first; });
+            for (uint32_t iDraw = 0; iDraw < count; ++iDraw)
+            {
+                m_Keys[iDraw] = entries[iDraw].first;
+                m_Payloads[iDraw] = entries[iDraw].second;
+            }
+            return;
+        }
+
+        JobSystem* jobSystem = JobSystem::Singleton();
+        uint32_t blocksCount = (count + kBlockKeys - 1) / kBlockKeys;
+        if (jobSystem == nullptr)
+            blocksCount = 1;
+        uint32_t blockKeys = (count + blocksCount - 1) / blocksCount;
+
+        // Histograms per block and digit, the prefix sums turn them into the scatter offsets of each block
+        uint32_t* histograms = m_Arena->Allocate<uint32_t>(blocksCount * kBucketsCount);
+        if (histograms == nullptr)
+        {
+            blocksCount = 1;
+            blockKeys = count;
+            histograms = m_Arena->Allocate<uint32_t>(kBucketsCount);
+            if (histograms == nullptr)
+            {
+                ASTEROID_LOG_WARNING("DrawList::Sort skipped, the frame arena is full.");
+                return;
+            }
+        }
+
+        auto forEachBlock = [&](const std::function<void(uint32_t block, uint32_t begin, uint32_t end)>& function)
+        {
+            auto range = [&](uint32_t blockBegin, uint32_t blockEnd)
+            {
+                for (uint32_t iBlock = blockBegin; iBlock < blockEnd; ++iBlock)
+                    function(iBlock, iBlock * blockKeys, std::min((iBlock + 1) * blockKeys, count));
+            };
+            if (blocksCount > 1)
+                jobSystem->ParallelFor(blocksCount, 1, range);
+            else
+                range(0, 1);
+        };
+
+        uint64_t* sourceKeys = m_Keys;
+        uint32_t* sourcePayloads = m_Payloads;
+        uint64_t* targetKeys = scratchKeys;
+        uint32_t* targetPayloads = scratchPayloads;
+        for (uint32_t shift = 0; shift < 64; shift += kRadixBits)
+        {
+            forEachBlock([&](uint32_t block, uint32_t begin, uint32_t end)
+            {
+                uint32_t* histogram = histograms + block * kBucketsCount;
+                std::memset(histogram, 0, sizeof(uint32_t) * kBucketsCount);
+                for (uint32_t iKey = begin; iKey < end; ++iKey)
+                    ++histogram[(sourceKeys[iKey] >> shift) & (kBucketsCount - 1)];
+            });
+
+            // Every key sharing this digit is common, e.g. unused pass bits, and the pass would be a plain copy
+            uint32_t firstBucket = (sourceKeys[0] >> shift) & (kBucketsCount - 1);
+            uint32_t firstBucketCount = 0;
+            for (uint32_t iBlock = 0; iBlock < blocksCount; ++iBlock)
+                firstBucketCount += histograms[iBlock * kBucketsCount + firstBucket];
+            if (firstBucketCount == count)
+                continue;
+
+            // Offsets ordered by digit then block keep the sort stable
+            uint32_t offset = 0;
+            for (uint32_t iBucket = 0; iBucket < kBucketsCount; ++iBucket)
+            {
+                for (uint32_t iBlock = 0; iBlock < blocksCount; ++iBlock)
+                {
+                    uint32_t& bucket = histograms[iBlock * kBucketsCount + iBucket];
+                    uint32_t bucketCount = bucket;
+                    bucket = offset;
+                    offset += bucketCount;
+                }
+            }
+
+            forEachBlock([&](uint32_t block, uint32_t begin, uint32_t end)
+            {
+                uint32_t* offsets = histograms + block * kBucketsCount;
+                for (uint32_t iKey = begin; iKey < end; ++iKey)
+                {
+                    uint32_t target = offsets[(sourceKeys[iKey] >> shift) & (kBucketsCount - 1)]++;
+                    targetKeys[target] = sourceKeys[iKey];
+                    targetPayloads[target] = sourcePayloads[iKey];
+                }
+            });
+
+            std::swap(sourceKeys, targetKeys);
+            std::swap(sourcePayloads, targetPayloads);
+        }
+
+        // Both buffers live in the arena, so the list simply adopts whichever holds the result
+        m_Keys = sourceKeys;
+        m_Payloads = sourcePayloads;
+    }
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include "Util/FrameArena.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  Packing of draw attributes into 64-bit sort keys, so sorting the keys orders the draws.\n
+     *  Bits from high to low:
+     *  - Opaque: pass 4, layer 4, pipeline 16, mesh 16, depth 24. Draws sharing state are adjacent and
+     *    front to back inside a state.
+     *  - Translucent: pass 4, layer 4, depth 24, pipeline 16, mesh 16. Draws are back to front.
+     */
+    class DrawKey
+    {
+    public:
+        static const uint32_t kPassBits = 4;
+        static const uint32_t kLayerBits = 4;
+        static const uint32_t kPipelineBits = 16;
+        static const uint32_t kMeshBits = 16;
+        static const uint32_t kDepthBits = 24;
+
+    public:
+        ASTEROID_NO_DEFAULT_CTOR(DrawKey)
+
+        /**
+         *  @param pipeline, mesh
+         *      Small ids of the pipeline state and the mesh, only the low bits are kept.
+         *  @param depth
+         *      View depth normalized to [0, 1], clamped.
+         */
+        static uint64_t Opaque(uint32_t pass, uint32_t layer, uint32_t pipeline, uint32_t mesh, float depth)
+        {
+            return Header(pass, layer)
+                | (uint64_t)(pipeline & Mask(kPipelineBits)) << (kMeshBits + kDepthBits)
+                | (uint64_t)(mesh & Mask(kMeshBits)) << kDepthBits
+                | QuantizeDepth(depth);
+        }
+
+        static uint64_t Translucent(uint32_t pass, uint32_t layer, float depth, uint32_t pipeline, uint32_t mesh)
+        {
+            return Header(pass, layer)
+                | (uint64_t)(Mask(kDepthBits) - QuantizeDepth(depth)) << (kPipelineBits + kMeshBits)
+                | (uint64_t)(pipeline & Mask(kPipelineBits)) << kMeshBits
+                | (mesh & Mask(kMeshBits));
+        }
+
+        static uint32_t Pass(uint64_t key) { return (uint32_t)(key >> (64 - kPassBits)); }
+        static uint32_t Layer(uint64_t key) { return (uint32_t)(key >> (64 - kPassBits - kLayerBits)) & Mask(kLayerBits); }
+
+    private:
+        static uint32_t Mask(uint32_t bits) { return (1u << bits) - 1; }
+
+        static uint64_t Header(uint32_t pass, uint32_t layer)
+        {
+            return (uint64_t)(pass & Mask(kPassBits)) << (64 - kPassBits)
+                | (uint64_t)(layer & Mask(kLayerBits)) << (64 - kPassBits - kLayerBits);
+        }
+
+        static uint64_t QuantizeDepth(float depth)
+        {
+            float clamped = std::min(std::max(depth, 0.0f), 1.0f);
+            return (uint64_t)(clamped * (float)Mask(kDepthBits));
+        }
+    };
+
+
+    /**
+     *  Draws of a frame as sort keys with a payload each, stored in a FrameArena.\n
+     *  Keys are added from any thread, Sort orders them with a parallel LSD radix sort and submission walks
+     *  the sorted keys and payloads.
+     *  @remarks
+     *      Usage per frame: Begin, Add from any thread, Sort, then read Keys and Payloads.
+     */
+    class DrawList
+    {
+    public:
+        DrawList();
+
+        ASTEROID_NON_COPYABLE(DrawList)
+
+        /**
+         *  Allocate storage for up to maxDraws draws from the arena, the arena must outlive the list's use.
+         *  @return
+         *      False if the arena is full, every Add fails in that case.
+         */
+        bool Begin(FrameArena* arena, uint32_t maxDraws);
+
+        /**
+         *  Add a draw, safe to call from several threads.
+         *  @param payload
+         *      Caller defined, usually the index of the draw in the caller's own array.
+         *  @return
+         *      False if the list is full.
+         */
+        bool Add(uint64_t key, uint32_t payload);
+
+        /**
+         *  Sort the draws by key. Draws with equal keys keep the order of their payloads in the list,
+         *  which is deterministic only if Add was called from one thread.
+         */
+        void Sort();
+
+        uint32_t Count() const { return std::min(m_Count.load(std::memory_order_relaxed), m_Capacity); }
+        const uint64_t* Keys() const { return m_Keys; }
+        const uint32_t* Payloads() const { return m_Payloads; }
+
+    private:
+        /** Radix digits of 8 bits, 8 passes over 64-bit keys. */
+        static const uint32_t kRadixBits = 8;
+        static const uint32_t kBucketsCount = 1 << kRadixBits;
+        /** Keys per block sorted by one job, smaller lists are sorted on the calling thread. */
+        static const uint32_t kBlockKeys = 16 * 1024;
+
+    private:
+        FrameArena*             m_Arena;
+        uint64_t*               m_Keys;
+        uint32_t*               m_Payloads;
+        uint32_t                m_Capacity;
+        std::atomic<uint32_t>   m_Count;
+    };
+}
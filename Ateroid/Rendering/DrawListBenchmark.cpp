@@ -0,0 +1,111 @@
+#include "Precompile.h"
+#include "DrawListBenchmark.h"
+#include "DrawList.h"
+#include "Util/Debug.h"
+#include <random>
+
+namespace ASTEROID_NAMESPACE
+{
+    static const uint32_t kPassesCount = 3;
+    static const uint32_t kPipelinesCount = 64;
+    static const uint32_t kMeshesCount = 256;
+    static const float kTranslucentRatio = 0.1f;
+    /** Depths are quantized to this many steps, so draws of the same mesh often get equal keys. */
+    static const float kDepthSteps = 1024.0f;
+
+    typedef std::chrono::steady_clock BenchmarkClock;
+    typedef std::pair<uint64_t, uint32_t> KeyPayload;
+
+    static double ElapsedMilliseconds(BenchmarkClock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(BenchmarkClock::now() - start).count();
+    }
+
+    static void GenerateKeys(uint32_t count, std::mt19937& random, Vector<uint64_t>* keys)
+    {
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        keys->resize(count);
+        for (uint64_t& key : *keys)
+        {
+            uint32_t pass = random() % kPassesCount;
+            uint32_t pipeline = random() % kPipelinesCount;
+            uint32_t mesh = random() % kMeshesCount;
+            float depth = std::floor(uniform(random) * kDepthSteps) / kDepthSteps;
+            if (uniform(random) < kTranslucentRatio)
+                key = DrawKey::Translucent(pass, 1, depth, pipeline, mesh);
+            else
+                key = DrawKey::Opaque(pass, 0, pipeline, mesh, depth);
+        }
+    }
+
+    bool DrawListBenchmark::Run(const DrawListBenchmarkSettings& settings)
+    {
+        ASTEROID_LOG_INFO_F("Draw list benchmark: up to %u draws, %u frames.", settings.maxDrawsCount, settings.framesCount);
+
+        // Keys, payloads, the radix sort scratch buffers and histograms
+        FrameArena arena((size_t)settings.maxDrawsCount * 2 * (sizeof(uint64_t) + sizeof(uint32_t)) + 1024 * 1024);
+        std::mt19937 random(settings.seed);
+        Vector<uint64_t> keys;
+        Vector<uint64_t> comparisonKeys;
+        Vector<KeyPayload> reference;
+
+        bool isValid = true;
+        uint32_t framesCount = std::max(settings.framesCount, 1u);
+        uint32_t drawsCounts[] = { settings.maxDrawsCount / 10, settings.maxDrawsCount / 2, settings.maxDrawsCount };
+        for (uint32_t drawsCount : drawsCounts)
+        {
+            if (drawsCount == 0)
+                continue;
+
+            double sortTime = 0.0, comparisonSortTime = 0.0;
+            for (uint32_t iFrame = 0; iFrame < framesCount; ++iFrame)
+            {
+                GenerateKeys(drawsCount, random, &keys);
+
+                arena.Reset();
+                DrawList drawList;
+                drawList.Begin(&arena, drawsCount);
+                for (uint32_t iDraw = 0; iDraw < drawsCount; ++iDraw)
+                    drawList.Add(keys[iDraw], iDraw);
+
+                BenchmarkClock::time_point start = BenchmarkClock::now();
+                drawList.Sort();
+                sortTime += ElapsedMilliseconds(start);
+
+                comparisonKeys = keys;
+                start = BenchmarkClock::now();
+                std::sort(comparisonKeys.begin(), comparisonKeys.end());
+                comparisonSortTime += ElapsedMilliseconds(start);
+
+                // Payloads are the order of Add, so the stable sort is the only correct output
+                reference.resize(drawsCount);
+                for (uint32_t iDraw = 0; iDraw < drawsCount; ++iDraw)
+                    reference[iDraw] = KeyPayload(keys[iDraw], iDraw);
+                std::stable_sort(reference.begin(), reference.end(),
+                    [](const KeyPayload& a, const KeyPayload& b) { return a.first < b.first; });
+
+                if (drawList.Count() != drawsCount)
+                {
+                    ASTEROID_LOG_ERROR_F("DrawList sorted %u draws instead of %u.", drawList.Count(), drawsCount);
+                    isValid = false;
+                    continue;
+                }
+                for (uint32_t iDraw = 0; iDraw < drawsCount; ++iDraw)
+                {
+                    if (drawList.Keys()[iDraw] != reference[iDraw].first || drawList.Payloads()[iDraw] != reference[iDraw].second)
+                    {
+                        ASTEROID_LOG_ERROR_F("DrawList::Sort of %u draws differs from the stable sort at draw %u: key %016llx payload %u, "
+                            "expected key %016llx payload %u.", drawsCount, iDraw, (unsigned long long)drawList.Keys()[iDraw],
+                            drawList.Payloads()[iDraw], (unsigned long long)reference[iDraw].first, reference[iDraw].second);
+                        isValid = false;
+                        break;
+                    }
+                }
+            }
+
+            ASTEROID_LOG_INFO_F("    %8u draws: DrawList::Sort %8.3f ms, std::sort of keys %8.3f ms",
+                drawsCount, sortTime / framesCount, comparisonSortTime / framesCount);
+        }
+        return isValid;
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+namespace ASTEROID_NAMESPACE
+{
+    struct DrawListBenchmarkSettings
+    {
+        /** The largest list sorted, lists of a tenth and half of it are sorted too. */
+        uint32_t    maxDrawsCount;
+        /** Sorts timed for each size. */
+        uint32_t    framesCount;
+        uint32_t    seed;
+    };
+
+
+    /**
+     *  Times DrawList::Sort against std::sort of the keys alone on frames of opaque and translucent draws, with
+     *  few pipelines and meshes so many keys are equal. Every sort is checked against std::stable_sort of the keys
+     *  and payloads: draws must come out in key order, equal keys in the order they were added.
+     */
+    class DrawListBenchmark
+    {
+    public:
+        ASTEROID_NO_DEFAULT_CTOR(DrawListBenchmark)
+        ASTEROID_NON_COPYABLE(DrawListBenchmark)
+
+        /**
+         *  @return
+         *      False if a sorted list differs from the stable reference.
+         */
+        static bool Run(const DrawListBenchmarkSettings& settings);
+    };
+}
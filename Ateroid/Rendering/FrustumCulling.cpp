@@ -0,0 +1,335 @@
+#include "Precompile.h"
+#include "FrustumCulling.h"
+#include "Core/JobSystem.h"
+#include "Math/SimdMath.h"
+#include "Util/Debug.h"
+#include "Util/SimdDispatch.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ASTEROID_FRUSTUM_CULLING_AVX
+#include <immintrin.h>
+#endif
+
+namespace ASTEROID_NAMESPACE
+{
+    static Float4 NormalizePlane(float a, float b, float c, float d)
+    {
+        float invLength = 1.0f / std::sqrt(a * a + b * b + c * c);
+        return Float4(a * invLength, b * invLength, c * invLength, d * invLength);
+    }
+
+    Frustum Frustum::FromViewProjection(const Float4x4& m)
+    {
+        // Row vectors are transformed as v * M, so each clip space component is the dot product
+        // with a column of the matrix.
+        Frustum frustum;
+        frustum.planes[eLeft]   = NormalizePlane(m._14 + m._11, m._24 + m._21, m._34 + m._31, m._44 + m._41);
+        frustum.planes[eRight]  = NormalizePlane(m._14 - m._11, m._24 - m._21, m._34 - m._31, m._44 - m._41);
+        frustum.planes[eBottom] = NormalizePlane(m._14 + m._12, m._24 + m._22, m._34 + m._32, m._44 + m._42);
+        frustum.planes[eTop]    = NormalizePlane(m._14 - m._12, m._24 - m._22, m._34 - m._32, m._44 - m._42);
+        frustum.planes[eNear]   = NormalizePlane(m._13, m._23, m._33, m._43);
+        frustum.planes[eFar]    = NormalizePlane(m._14 - m._13, m._24 - m._23, m._34 - m._33, m._44 - m._43);
+        return frustum;
+    }
+
+    void BoundingVolumeArray::Resize(uint32_t count)
+    {
+        uint32_t oldCount = m_Count;
+        uint32_t paddedCount = (count + kLanesCount - 1) / kLanesCount * kLanesCount;
+
+        m_CenterX.resize(paddedCount);
+        m_CenterY.resize(paddedCount);
+        m_CenterZ.resize(paddedCount);
+        m_ExtentX.resize(paddedCount);
+        m_ExtentY.resize(paddedCount);
+        m_ExtentZ.resize(paddedCount);
+        m_Radius.resize(paddedCount);
+        m_Count = count;
+
+        // A negative infinite radius fails every plane test, which keeps new objects and padding invisible.
+        const float kNeverVisibleRadius = -std::numeric_limits<float>::infinity();
+        for (uint32_t i = std::min(oldCount, count); i < paddedCount; ++i)
+        {
+            m_CenterX[i] = m_CenterY[i] = m_CenterZ[i] = 0.0f;
+            m_ExtentX[i] = m_ExtentY[i] = m_ExtentZ[i] = 0.0f;
+            m_Radius[i] = kNeverVisibleRadius;
+        }
+    }
+
+    void BoundingVolumeArray::Set(uint32_t index, const Float3& center, const Float3& extents, float radius)
+    {
+        ASTEROID_ASSERT(index < m_Count, "Bounding volume index out of range.");
+        m_CenterX[index] = center.x;
+        m_CenterY[index] = center.y;
+        m_CenterZ[index] = center.z;
+        m_ExtentX[index] = extents.x;
+        m_ExtentY[index] = extents.y;
+        m_ExtentZ[index] = extents.z;
+        m_Radius[index] = radius;
+    }
+
+    void BoundingVolumeArray::SetSphere(uint32_t index, const Float3& center, float radius)
+    {
+        Set(index, center, Float3(radius, radius, radius), radius);
+    }
+
+    void BoundingVolumeArray::SetBox(uint32_t index, const Float3& center, const Float3& extents)
+    {
+        float radius = std::sqrt(extents.x * extents.x + extents.y * extents.y + extents.z * extents.z);
+        Set(index, center, extents, radius);
+    }
+
+    /**
+     *  Test objects [begin, end) and write indices of visible ones to output.
+     *  begin must be a multiple of kLanesCount. Returns numbers of indices written.
+     */
+    static uint32_t CullRangeScalar(const Frustum& frustum, const BoundingVolumeArray& volumes, uint32_t begin, uint32_t end, uint32_t* output)
+    {
+        uint32_t visibleCount = 0;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            bool visible = true;
+            for (int iPlane = 0; iPlane < Frustum::ePlanesCount; ++iPlane)
+            {
+                const Float4& plane = frustum.planes[iPlane];
+                // Same operation order as the SIMD kernels, so every level culls the same objects
+                float distance = (volumes.CenterX()[i] * plane.x + volumes.CenterY()[i] * plane.y) + (volumes.CenterZ()[i] * plane.z + plane.w);
+                float boxRadius = (volumes.ExtentX()[i] * std::abs(plane.x) + volumes.ExtentY()[i] * std::abs(plane.y)) +
+                    volumes.ExtentZ()[i] * std::abs(plane.z);
+                float r = std::min(volumes.Radius()[i], boxRadius);
+                visible &= distance + r >= 0.0f;
+            }
+
+            output[visibleCount] = i;
+            visibleCount += visible ? 1 : 0;
+        }
+        return visibleCount;
+    }
+
+    /** Bit i is set when object i of the four passes every plane. */
+    static inline uint32_t TestPlanes(const Vec4& cx, const Vec4& cy, const Vec4& cz, const Vec4& ex, const Vec4& ey, const Vec4& ez,
+        const Vec4& radius, const Vec4* planeX, const Vec4* planeY, const Vec4* planeZ, const Vec4* planeW,
+        const Vec4* absPlaneX, const Vec4* absPlaneY, const Vec4* absPlaneZ)
+    {
+        const Vec4 kZero = Vec4::Zero();
+        uint32_t visible = 0xF;
+        for (int iPlane = 0; iPlane < Frustum::ePlanesCount; ++iPlane)
+        {
+            Vec4 distance = (cx * planeX[iPlane] + cy * planeY[iPlane]) + (cz * planeZ[iPlane] + planeW[iPlane]);
+            Vec4 boxRadius = (ex * absPlaneX[iPlane] + ey * absPlaneY[iPlane]) + ez * absPlaneZ[iPlane];
+            Vec4 r = Vec4::Min(radius, boxRadius);
+            visible &= Vec4::LessEqualMask(kZero, distance + r);
+        }
+        return visible;
+    }
+
+    /**
+     *  Test objects [begin, end) four at a time in Vec4, SSE on x86 and NEON on ARM, and write indices of visible
+     *  ones to output. begin must be a multiple of kLanesCount. Returns numbers of indices written.
+     */
+    static uint32_t CullRangeVec4(const Frustum& frustum, const BoundingVolumeArray& volumes, uint32_t begin, uint32_t end, uint32_t* output)
+    {
+        Vec4 planeX[Frustum::ePlanesCount], planeY[Frustum::ePlanesCount], planeZ[Frustum::ePlanesCount], planeW[Frustum::ePlanesCount];
+        Vec4 absPlaneX[Frustum::ePlanesCount], absPlaneY[Frustum::ePlanesCount], absPlaneZ[Frustum::ePlanesCount];
+        for (int iPlane = 0; iPlane < Frustum::ePlanesCount; ++iPlane)
+        {
+            planeX[iPlane] = Vec4::Splat(frustum.planes[iPlane].x);
+            planeY[iPlane] = Vec4::Splat(frustum.planes[iPlane].y);
+            planeZ[iPlane] = Vec4::Splat(frustum.planes[iPlane].z);
+            planeW[iPlane] = Vec4::Splat(frustum.planes[iPlane].w);
+            absPlaneX[iPlane] = Vec4::Abs(planeX[iPlane]);
+            absPlaneY[iPlane] = Vec4::Abs(planeY[iPlane]);
+            absPlaneZ[iPlane] = Vec4::Abs(planeZ[iPlane]);
+        }
+
+        uint32_t visibleCount = 0;
+        for (uint32_t i = begin; i < end; i += BoundingVolumeArray::kLanesCount)
+        {
+            // Two groups of four per iteration to keep eight objects in flight.
+            uint32_t visibleLow = TestPlanes(
+                Vec4::Load(volumes.CenterX() + i), Vec4::Load(volumes.CenterY() + i), Vec4::Load(volumes.CenterZ() + i),
+                Vec4::Load(volumes.ExtentX() + i), Vec4::Load(volumes.ExtentY() + i), Vec4::Load(volumes.ExtentZ() + i),
+                Vec4::Load(volumes.Radius() + i),
+                planeX, planeY, planeZ, planeW, absPlaneX, absPlaneY, absPlaneZ);
+            uint32_t visibleHigh = TestPlanes(
+                Vec4::Load(volumes.CenterX() + i + 4), Vec4::Load(volumes.CenterY() + i + 4), Vec4::Load(volumes.CenterZ() + i + 4),
+                Vec4::Load(volumes.ExtentX() + i + 4), Vec4::Load(volumes.ExtentY() + i + 4), Vec4::Load(volumes.ExtentZ() + i + 4),
+                Vec4::Load(volumes.Radius() + i + 4),
+                planeX, planeY, planeZ, planeW, absPlaneX, absPlaneY, absPlaneZ);
+
+            // Branchless compaction: always write the index, only advance for visible lanes.
+            uint32_t mask = visibleLow | (visibleHigh << 4);
+            for (uint32_t lane = 0; lane < BoundingVolumeArray::kLanesCount; ++lane)
+            {
+                output[visibleCount] = i + lane;
+                visibleCount += (mask >> lane) & 1;
+            }
+        }
+        return visibleCount;
+    }
+
+#ifdef ASTEROID_FRUSTUM_CULLING_AVX
+    /**
+     *  Test objects [begin, end) and write indices of visible ones to output.
+     *  begin must be a multiple of kLanesCount. Returns numbers of indices written.
+     */
+    ASTEROID_TARGET_AVX2
+    static uint32_t CullRangeAVX2(const Frustum& frustum, const BoundingVolumeArray& volumes, uint32_t begin, uint32_t end, uint32_t* output)
+    {
+        const __m256 kAbsMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+
+        __m256 planeX[Frustum::ePlanesCount], planeY[Frustum::ePlanesCount], planeZ[Frustum::ePlanesCount], planeW[Frustum::ePlanesCount];
+        __m256 absPlaneX[Frustum::ePlanesCount], absPlaneY[Frustum::ePlanesCount], absPlaneZ[Frustum::ePlanesCount];
+        for (int iPlane = 0; iPlane < Frustum::ePlanesCount; ++iPlane)
+        {
+            planeX[iPlane] = _mm256_set1_ps(frustum.planes[iPlane].x);
+            planeY[iPlane] = _mm256_set1_ps(frustum.planes[iPlane].y);
+            planeZ[iPlane] = _mm256_set1_ps(frustum.planes[iPlane].z);
+            planeW[iPlane] = _mm256_set1_ps(frustum.planes[iPlane].w);
+            absPlaneX[iPlane] = _mm256_and_ps(planeX[iPlane], kAbsMask);
+            absPlaneY[iPlane] = _mm256_and_ps(planeY[iPlane], kAbsMask);
+            absPlaneZ[iPlane] = _mm256_and_ps(planeZ[iPlane], kAbsMask);
+        }
+
+        uint32_t visibleCount = 0;
+        for (uint32_t i = begin; i < end; i += BoundingVolumeArray::kLanesCount)
+        {
+            __m256 cx = _mm256_load_ps(volumes.CenterX() + i);
+            __m256 cy = _mm256_load_ps(volumes.CenterY() + i);
+            __m256 cz = _mm256_load_ps(volumes.CenterZ() + i);
+            __m256 ex = _mm256_load_ps(volumes.ExtentX() + i);
+            __m256 ey = _mm256_load_ps(volumes.ExtentY() + i);
+            __m256 ez = _mm256_load_ps(volumes.ExtentZ() + i);
+            __m256 radius = _mm256_load_ps(volumes.Radius() + i);
+
+            __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (int iPlane = 0; iPlane < Frustum::ePlanesCount; ++iPlane)
+            {
+                __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, planeX[iPlane]), _mm256_mul_ps(cy, planeY[iPlane])),
+                    _mm256_add_ps(_mm256_mul_ps(cz, planeZ[iPlane]), planeW[iPlane]));
+                __m256 boxRadius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ex, absPlaneX[iPlane]), _mm256_mul_ps(ey, absPlaneY[iPlane])),
+                    _mm256_mul_ps(ez, absPlaneZ[iPlane]));
+                __m256 r = _mm256_min_ps(radius, boxRadius);
+                visible = _mm256_and_ps(visible, _mm256_cmp_ps(_mm256_add_ps(distance, r), _mm256_setzero_ps(), _CMP_GE_OQ));
+            }
+
+            // Branchless compaction: always write the index, only advance for visible lanes.
+            uint32_t mask = (uint32_t)_mm256_movemask_ps(visible);
+            for (uint32_t lane = 0; lane < BoundingVolumeArray::kLanesCount; ++lane)
+            {
+                output[visibleCount] = i + lane;
+                visibleCount += (mask >> lane) & 1;
+            }
+        }
+        return visibleCount;
+    }
+
+    /**
+     *  Test objects [begin, end) and write indices of visible ones to output, 16 at a time.
+     *  begin must be a multiple of kLanesCount. Returns numbers of indices written.
+     */
+    ASTEROID_TARGET_AVX512
+    static uint32_t CullRangeAVX512(const Frustum& frustum, const BoundingVolumeArray& volumes, uint32_t begin, uint32_t end, uint32_t* output)
+    {
+        __m512 planeX[Frustum::ePlanesCount], planeY[Frustum::ePlanesCount], planeZ[Frustum::ePlanesCount], planeW[Frustum::ePlanesCount];
+        __m512 absPlaneX[Frustum::ePlanesCount], absPlaneY[Frustum::ePlanesCount], absPlaneZ[Frustum::ePlanesCount];
+        for (int iPlane = 0; iPlane < Frustum::ePlanesCount; ++iPlane)
+        {
+            planeX[iPlane] = _mm512_set1_ps(frustum.planes[iPlane].x);
+            planeY[iPlane] = _mm512_set1_ps(frustum.planes[iPlane].y);
+            planeZ[iPlane] = _mm512_set1_ps(frustum.planes[iPlane].z);
+            planeW[iPlane] = _mm512_set1_ps(frustum.planes[iPlane].w);
+            absPlaneX[iPlane] = _mm512_abs_ps(planeX[iPlane]);
+            absPlaneY[iPlane] = _mm512_abs_ps(planeY[iPlane]);
+            absPlaneZ[iPlane] = _mm512_abs_ps(planeZ[iPlane]);
+        }
+
+        // Arrays are aligned for 8 lanes only, hence unaligned loads
+        const uint32_t kLanesCount = 16;
+        uint32_t visibleCount = 0;
+        uint32_t i = begin;
+        for (; i + kLanesCount <= end; i += kLanesCount)
+        {
+            __m512 cx = _mm512_loadu_ps(volumes.CenterX() + i);
+            __m512 cy = _mm512_loadu_ps(volumes.CenterY() + i);
+            __m512 cz = _mm512_loadu_ps(volumes.CenterZ() + i);
+            __m512 ex = _mm512_loadu_ps(volumes.ExtentX() + i);
+            __m512 ey = _mm512_loadu_ps(volumes.ExtentY() + i);
+            __m512 ez = _mm512_loadu_ps(volumes.ExtentZ() + i);
+            __m512 radius = _mm512_loadu_ps(volumes.Radius() + i);
+
+            __mmask16 visible = 0xFFFF;
+            for (int iPlane = 0; iPlane < Frustum::ePlanesCount; ++iPlane)
+            {
+                __m512 distance = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(cx, planeX[iPlane]), _mm512_mul_ps(cy, planeY[iPlane])),
+                    _mm512_add_ps(_mm512_mul_ps(cz, planeZ[iPlane]), planeW[iPlane]));
+                __m512 boxRadius = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(ex, absPlaneX[iPlane]), _mm512_mul_ps(ey, absPlaneY[iPlane])),
+                    _mm512_mul_ps(ez, absPlaneZ[iPlane]));
+                // The zero-masked form computes the same, GCC warns about the undefined pass-through of _mm512_min_ps
+                __m512 r = _mm512_maskz_min_ps(0xFFFF, radius, boxRadius);
+                visible = _mm512_mask_cmp_ps_mask(visible, _mm512_add_ps(distance, r), _mm512_setzero_ps(), _CMP_GE_OQ);
+            }
+
+            // Branchless compaction: always write the index, only advance for visible lanes.
+            uint32_t mask = (uint32_t)visible;
+            for (uint32_t lane = 0; lane < kLanesCount; ++lane)
+            {
+                output[visibleCount] = i + lane;
+                visibleCount += (mask >> lane) & 1;
+            }
+        }
+
+        if (i < end)
+            visibleCount += CullRangeAVX2(frustum, volumes, i, end, output + visibleCount);
+        return visibleCount;
+    }
+#endif
+
+    using CullRangeFunction = uint32_t(*)(const Frustum& frustum, const BoundingVolumeArray& volumes, uint32_t begin, uint32_t end, uint32_t* output);
+#ifdef ASTEROID_FRUSTUM_CULLING_AVX
+    static SimdKernel<CullRangeFunction> CullRange("FrustumCulling.CullRange", CullRangeScalar, CullRangeVec4, CullRangeAVX2, CullRangeAVX512);
+#else
+    static SimdKernel<CullRangeFunction> CullRange("FrustumCulling.CullRange", CullRangeScalar, CullRangeVec4);
+#endif
+
+    uint32_t FrustumCuller::Cull(const Frustum& frustum, const BoundingVolumeArray& volumes, Vector<uint32_t>* visibleIndices)
+    {
+        static_assert(kChunkSize % BoundingVolumeArray::kLanesCount == 0, "Chunks must contain whole kernel iterations.");
+
+        uint32_t paddedCount = volumes.PaddedCount();
+        uint32_t chunksCount = (paddedCount + kChunkSize - 1) / kChunkSize;
+
+        // Every chunk compacts into its own slice of the scratch buffer, then the slices are concatenated.
+        m_ChunkResults.resize(paddedCount);
+        m_ChunkVisibleCounts.resize(chunksCount);
+
+        auto cullChunks = [&](uint32_t beginChunk, uint32_t endChunk)
+        {
+            for (uint32_t iChunk = beginChunk; iChunk < endChunk; ++iChunk)
+            {
+                uint32_t begin = iChunk * kChunkSize;
+                uint32_t end = std::min(begin + kChunkSize, paddedCount);
+                m_ChunkVisibleCounts[iChunk] = CullRange(frustum, volumes, begin, end, m_ChunkResults.data() + begin);
+            }
+        };
+
+        JobSystem* jobSystem = JobSystem::Singleton();
+        if (jobSystem != nullptr)
+            jobSystem->ParallelFor(chunksCount, 1, cullChunks);
+        else
+            cullChunks(0, chunksCount);
+
+        uint32_t visibleCount = 0;
+        for (uint32_t iChunk = 0; iChunk < chunksCount; ++iChunk)
+            visibleCount += m_ChunkVisibleCounts[iChunk];
+
+        visibleIndices->resize(visibleCount);
+        uint32_t* output = visibleIndices->data();
+        for (uint32_t iChunk = 0; iChunk < chunksCount; ++iChunk)
+        {
+            std::memcpy(output, m_ChunkResults.data() + iChunk * kChunkSize, sizeof(uint32_t) * m_ChunkVisibleCounts[iChunk]);
+            output += m_ChunkVisibleCounts[iChunk];
+        }
+        return visibleCount;
+    }
+}
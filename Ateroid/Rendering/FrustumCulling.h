@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Math/MathTypes.h"
+#include "Util/Containers.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  Six world space planes bounding the camera view volume.\n
+     *  Each plane is stored as (normal.x, normal.y, normal.z, distance) with the normal pointing inwards,
+     *  so a point p is inside the plane when dot(normal, p) + distance >= 0.
+     */
+    struct Frustum
+    {
+        enum EPlane
+        {
+            eLeft, eRight, eBottom, eTop, eNear, eFar, ePlanesCount
+        };
+
+        Float4 planes[ePlanesCount];
+
+        /**
+         *  Extract the frustum planes from a row-major view-projection matrix using D3D clip space conventions
+         *  (0 <= z <= w). The planes come out normalized.
+         */
+        static Frustum FromViewProjection(const Float4x4& viewProjection);
+    };
+
+
+    /**
+     *  World space bounding volumes of cullable objects stored as structure of arrays.\n
+     *  Every object has a bounding box (center and half extents) and a bounding sphere sharing the same center.
+     *  The culling test uses whichever of the two is tighter against each plane.
+     *  @remarks
+     *      Arrays are padded up to a multiple of kLanesCount with volumes that always fail the test,
+     *      so kernels never need to handle a partial tail.
+     */
+    class BoundingVolumeArray
+    {
+    public:
+        /** Numbers of objects processed per kernel iteration. */
+        static const uint32_t kLanesCount = 8;
+
+        template<typename T>
+        using LaneVector = VectorA<T, 32>;
+
+    public:
+        BoundingVolumeArray() : m_Count(0) {}
+
+        ASTEROID_NON_COPYABLE(BoundingVolumeArray)
+
+        /** Numbers of objects. */
+        uint32_t Count() const { return m_Count; }
+
+        /** Numbers of objects including padding, always a multiple of kLanesCount. */
+        uint32_t PaddedCount() const { return (uint32_t)m_Radius.size(); }
+
+        /**
+         *  Change the numbers of objects. New objects are initialized to volumes that are never visible.
+         */
+        void Resize(uint32_t count);
+
+        /** Set both bounding volumes of an object. */
+        void Set(uint32_t index, const Float3& center, const Float3& extents, float radius);
+
+        /** Set a bounding sphere, the box is set to the cube enclosing it. */
+        void SetSphere(uint32_t index, const Float3& center, float radius);
+
+        /** Set a bounding box, the sphere is set to the one enclosing it. */
+        void SetBox(uint32_t index, const Float3& center, const Float3& extents);
+
+        const float* CenterX() const { return m_CenterX.data(); }
+        const float* CenterY() const { return m_CenterY.data(); }
+        const float* CenterZ() const { return m_CenterZ.data(); }
+        const float* ExtentX() const { return m_ExtentX.data(); }
+        const float* ExtentY() const { return m_ExtentY.data(); }
+        const float* ExtentZ() const { return m_ExtentZ.data(); }
+        const float* Radius() const { return m_Radius.data(); }
+
+    private:
+        uint32_t            m_Count;
+        LaneVector<float>   m_CenterX;
+        LaneVector<float>   m_CenterY;
+        LaneVector<float>   m_CenterZ;
+        LaneVector<float>   m_ExtentX;
+        LaneVector<float>   m_ExtentY;
+        LaneVector<float>   m_ExtentZ;
+        LaneVector<float>   m_Radius;
+    };
+
+
+    /**
+     *  Tests a BoundingVolumeArray against a Frustum and outputs the indices of visible objects.\n
+     *  The array is split into chunks which are tested in parallel on the JobSystem if it is created.
+     *  The test is the SimdKernel "FrustumCulling.CullRange", dispatched at runtime to scalar, SSE or NEON, AVX2 or
+     *  AVX-512 code, the last two on x86 only. Every level culls the same objects.
+     */
+    class FrustumCuller
+    {
+    public:
+        /** Numbers of objects tested by a single job. */
+        static const uint32_t kChunkSize = 16 * 1024;
+
+    public:
+        FrustumCuller() = default;
+
+        ASTEROID_NON_COPYABLE(FrustumCuller)
+
+        /**
+         *  Cull all objects in the array.
+         *  @param visibleIndices
+         *      Receives the indices of visible objects in ascending order. Previous content is discarded.
+         *  @return
+         *      Numbers of visible objects.
+         */
+        uint32_t Cull(const Frustum& frustum, const BoundingVolumeArray& volumes, Vector<uint32_t>* visibleIndices);
+
+    private:
+        Vector<uint32_t> m_ChunkResults;
+        Vector<uint32_t> m_ChunkVisibleCounts;
+    };
+}
@@ -0,0 +1,249 @@
+#include "Precompile.h"
+#include "GoldenImageTest.h"
+#include "InstanceBatcher.h"
+#include "SoftwareRenderBackend.h"
+#include "Math/SimdMath.h"
+#include "Util/Debug.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    static const ObjectInstanceID kAsteroidMesh = 1;
+    static const ObjectInstanceID kCrateMesh = 2;
+    static const uint32_t kCrateSidesSubmesh = 0;
+    static const uint32_t kCrateCapsSubmesh = 1;
+    /** 0xAABBGGRR colors of the materials, material i + 1 has color i. */
+    static const uint32_t kMaterialColors[] = { 0xFF8090A0, 0xFF5070C0, 0xFF40A0E0, 0xFF30B060 };
+    static const uint32_t kMaterialsCount = sizeof(kMaterialColors) / sizeof(kMaterialColors[0]);
+    static const uint32_t kBackgroundColor = 0xFF201010;
+
+    static const uint32_t kObjectsX = 16;
+    static const uint32_t kObjectsZ = 12;
+    static const float kObjectSpacing = 4.0f;
+
+    /** xorshift32, so scenes are the same with every standard library. */
+    static float RandomFloat(uint32_t* state)
+    {
+        uint32_t x = *state;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        *state = x;
+        return (float)(x >> 8) * (1.0f / 16777216.0f);
+    }
+
+    /** Make every triangle clockwise seen from outside, the front face of the backend. */
+    static void OrientOutward(const Vector<Float3>& positions, Vector<uint32_t>* indices)
+    {
+        for (size_t iIndex = 0; iIndex + 2 < indices->size(); iIndex += 3)
+        {
+            const Float3& a = positions[(*indices)[iIndex]];
+            const Float3& b = positions[(*indices)[iIndex + 1]];
+            const Float3& c = positions[(*indices)[iIndex + 2]];
+            Vec4 normal = Vec4::Cross3(Vec4::Load(b, 0.0f) - Vec4::Load(a, 0.0f), Vec4::Load(c, 0.0f) - Vec4::Load(a, 0.0f));
+            Vec4 center = Vec4::Load(a, 0.0f) + Vec4::Load(b, 0.0f) + Vec4::Load(c, 0.0f);
+            if (Vec4::Dot3(normal, center) < 0.0f)
+                std::swap((*indices)[iIndex + 1], (*indices)[iIndex + 2]);
+        }
+    }
+
+    /** An icosahedron subdivided once, with vertices pushed in by up to a quarter of the radius. */
+    static void CreateAsteroidMesh(uint32_t seed, Vector<Float3>* positions, Vector<uint32_t>* indices)
+    {
+        const float t = 1.6180340f;
+        const float kIcosahedron[12][3] = {
+            { -1, t, 0 }, { 1, t, 0 }, { -1, -t, 0 }, { 1, -t, 0 }, { 0, -1, t }, { 0, 1, t },
+            { 0, -1, -t }, { 0, 1, -t }, { t, 0, -1 }, { t, 0, 1 }, { -t, 0, -1 }, { -t, 0, 1 } };
+        const uint32_t kFaces[20][3] = {
+            { 0, 11, 5 }, { 0, 5, 1 }, { 0, 1, 7 }, { 0, 7, 10 }, { 0, 10, 11 }, { 1, 5, 9 }, { 5, 11, 4 },
+            { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 }, { 3, 9, 4 }, { 3, 4, 2 }, { 3, 2, 6 }, { 3, 6, 8 },
+            { 3, 8, 9 }, { 4, 9, 5 }, { 2, 4, 11 }, { 6, 2, 10 }, { 8, 6, 7 }, { 9, 8, 1 } };
+
+        positions->clear();
+        for (const float* vertex : kIcosahedron)
+            positions->push_back(Float3(vertex[0], vertex[1], vertex[2]));
+
+        // Split every edge once, the midpoint of an edge is shared by its two faces
+        UnorderedMap<uint64_t, uint32_t> midpoints;
+        auto midpoint = [positions, &midpoints](uint32_t a, uint32_t b)
+        {
+            uint64_t key = ((uint64_t)std::min(a, b) << 32) | std::max(a, b);
+            auto found = midpoints.find(key);
+            if (found != midpoints.end())
+                return found->second;
+
+            const Float3& pa = (*positions)[a];
+            const Float3& pb = (*positions)[b];
+            positions->push_back(Float3((pa.x + pb.x) * 0.5f, (pa.y + pb.y) * 0.5f, (pa.z + pb.z) * 0.5f));
+            return midpoints[key] = (uint32_t)positions->size() - 1;
+        };
+
+        indices->clear();
+        for (const uint32_t* face : kFaces)
+        {
+            uint32_t ab = midpoint(face[0], face[1]), bc = midpoint(face[1], face[2]), ca = midpoint(face[2], face[0]);
+            uint32_t triangles[4][3] = { { face[0], ab, ca }, { face[1], bc, ab }, { face[2], ca, bc }, { ab, bc, ca } };
+            for (const uint32_t* triangle : triangles)
+                indices->insert(indices->end(), triangle, triangle + 3);
+        }
+
+        uint32_t random = seed;
+        for (Float3& position : *positions)
+        {
+            float scale = (1.0f - RandomFloat(&random) * 0.25f) / Vec4::Length3(Vec4::Load(position, 0.0f));
+            position = Float3(position.x * scale, position.y * scale, position.z * scale);
+        }
+        OrientOutward(*positions, indices);
+    }
+
+    /** A unit cube, the four sides in one submesh and the top and bottom in another. */
+    static void CreateCrateMesh(Vector<Float3>* positions, Vector<uint32_t>* indices, Vector<SubmeshInfo>* submeshes)
+    {
+        positions->clear();
+        for (uint32_t iVertex = 0; iVertex < 8; ++iVertex)
+            positions->push_back(Float3(iVertex & 1 ? 0.5f : -0.5f, iVertex & 2 ? 0.5f : -0.5f, iVertex & 4 ? 0.5f : -0.5f));
+
+        // Sides are the faces of constant x and z, caps the faces of constant y
+        const uint32_t kSides[] = { 0, 2, 6, 0, 6, 4, 1, 3, 7, 1, 7, 5, 0, 1, 3, 0, 3, 2, 4, 5, 7, 4, 7, 6 };
+        const uint32_t kCaps[] = { 0, 1, 5, 0, 5, 4, 2, 3, 7, 2, 7, 6 };
+        indices->assign(std::begin(kSides), std::end(kSides));
+        indices->insert(indices->end(), std::begin(kCaps), std::end(kCaps));
+        OrientOutward(*positions, indices);
+
+        uint32_t sidesCount = sizeof(kSides) / sizeof(kSides[0]);
+        submeshes->clear();
+        submeshes->push_back({ sidesCount, 0, 0 });
+        submeshes->push_back({ (uint32_t)sizeof(kCaps) / sizeof(kCaps[0]), sidesCount, 0 });
+    }
+
+    static bool ReadImage(const char* path, uint32_t* width, uint32_t* height, Vector<uint8_t>* pixels)
+    {
+        FILE* file = std::fopen(path, "rb");
+        if (file == nullptr)
+        {
+            ASTEROID_LOG_ERROR_F("Failed to open %s for reading the image.", path);
+            return false;
+        }
+
+        // Binary PPM as written by SoftwareRenderBackend::WriteImage, a single whitespace ends the header
+        uint32_t maxValue = 0;
+        bool isRead = std::fscanf(file, "P6 %u %u %u", width, height, &maxValue) == 3 && maxValue == 255 && std::fgetc(file) != EOF;
+        if (isRead)
+        {
+            pixels->resize((size_t)*width * *height * 3);
+            isRead = std::fread(pixels->data(), 1, pixels->size(), file) == pixels->size();
+        }
+        std::fclose(file);
+        if (!isRead)
+            ASTEROID_LOG_ERROR_F("%s is not a binary PPM image with 8 bits per channel.", path);
+        return isRead;
+    }
+
+    bool GoldenImageTest::Run(const GoldenImageTestSettings& settings)
+    {
+        Vector<Float3> positions;
+        Vector<uint32_t> indices;
+        Vector<SubmeshInfo> submeshes;
+        // Crates are drawn as two instances, one per submesh
+        InstanceBatcher batcher(2 * kObjectsX * kObjectsZ, 1);
+        SoftwareRenderBackend backend(settings.width, settings.height, batcher.InstanceStreamBytes());
+        UploadRing uploadRing(&backend, batcher.InstanceStreamBytes());
+
+        CreateAsteroidMesh(1, &positions, &indices);
+        submeshes.assign(1, { (uint32_t)indices.size(), 0, 0 });
+        backend.RegisterMesh(kAsteroidMesh, positions, indices, submeshes);
+        CreateCrateMesh(&positions, &indices, &submeshes);
+        backend.RegisterMesh(kCrateMesh, positions, indices, submeshes);
+        for (uint32_t iMaterial = 0; iMaterial < kMaterialsCount; ++iMaterial)
+            backend.SetMaterialColor((ObjectInstanceID)iMaterial + 1, kMaterialColors[iMaterial]);
+
+        // A field receding from the camera, so objects overlap and get small in the distance
+        uint32_t random = 7;
+        batcher.BeginFrame();
+        for (uint32_t iZ = 0; iZ < kObjectsZ; ++iZ)
+        {
+            for (uint32_t iX = 0; iX < kObjectsX; ++iX)
+            {
+                float x = ((float)iX - (kObjectsX - 1) * 0.5f + RandomFloat(&random) - 0.5f) * kObjectSpacing;
+                float y = (RandomFloat(&random) - 0.5f) * kObjectSpacing;
+                float z = ((float)iZ + RandomFloat(&random) - 0.5f) * kObjectSpacing;
+                float scale = 0.8f + RandomFloat(&random) * 1.2f;
+                Vec4 axis = Vec4::Normalize3(Vec4::Set(RandomFloat(&random) - 0.5f, RandomFloat(&random) - 0.5f, RandomFloat(&random) - 0.5f, 0.0f));
+                Quat rotation = Quat::FromAxisAngle(axis, RandomFloat(&random) * 6.2831853f);
+                Float4x4 world;
+                Mat4::Affine(Vec4::Splat(scale), rotation, Vec4::Set(x, y, z, 1.0f)).Store(world);
+
+                ObjectInstanceID material = (ObjectInstanceID)((iX + iZ) % kMaterialsCount) + 1;
+                if ((iX * 7 + iZ * 3) % 5 == 0)
+                {
+                    batcher.Add(kCrateMesh, kCrateSidesSubmesh, material, world);
+                    batcher.Add(kCrateMesh, kCrateCapsSubmesh, material % kMaterialsCount + 1, world);
+                }
+                else
+                {
+                    batcher.Add(kAsteroidMesh, 0, material, world);
+                }
+            }
+        }
+        batcher.Build();
+
+        Float4x4 viewProjection;
+        Mat4 view = Mat4::LookAtLH(Vec4::Set(0.0f, 8.0f, -14.0f, 1.0f), Vec4::Set(0.0f, 0.0f, 16.0f, 1.0f), Vec4::Set(0.0f, 1.0f, 0.0f, 0.0f));
+        Mat4 projection = Mat4::PerspectiveFovLH(1.0f, (float)settings.width / (float)settings.height, 0.5f, 200.0f);
+        (view * projection).Store(viewProjection);
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        backend.Clear(kBackgroundColor);
+        backend.SetViewProjection(viewProjection);
+        uploadRing.BeginFrame();
+        bool isSubmitted = batcher.Submit(&backend, &uploadRing);
+        uploadRing.EndFrame();
+        if (!isSubmitted)
+            return false;
+        backend.Present();
+        double renderTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        SoftwareRenderBackend::Stats stats = backend.GetStats();
+        ASTEROID_LOG_INFO_F("Golden image: %ux%u, %zu draws, %u triangles, %u rasterized, %u binned, %.3f ms.", settings.width,
+            settings.height, batcher.Draws().size(), stats.trianglesCount, stats.rasterizedTrianglesCount, stats.binnedTrianglesCount,
+            renderTime);
+
+        if (settings.imagePath != nullptr && !backend.WriteImage(settings.imagePath))
+            return false;
+        if (settings.goldenPath == nullptr)
+            return true;
+
+        uint32_t goldenWidth = 0, goldenHeight = 0;
+        Vector<uint8_t> golden;
+        if (!ReadImage(settings.goldenPath, &goldenWidth, &goldenHeight, &golden))
+            return false;
+        if (goldenWidth != settings.width || goldenHeight != settings.height)
+        {
+            ASTEROID_LOG_ERROR_F("The golden image is %ux%u, rendered %ux%u.", goldenWidth, goldenHeight, settings.width, settings.height);
+            return false;
+        }
+
+        uint32_t differentPixelsCount = 0;
+        uint32_t maxDifference = 0;
+        for (uint32_t y = 0; y < settings.height; ++y)
+        {
+            for (uint32_t x = 0; x < settings.width; ++x)
+            {
+                uint32_t pixel = backend.Pixel(x, y);
+                const uint8_t* goldenPixel = &golden[((size_t)y * settings.width + x) * 3];
+                uint32_t difference = 0;
+                for (uint32_t iChannel = 0; iChannel < 3; ++iChannel)
+                    difference = std::max(difference, (uint32_t)std::abs((int)((pixel >> (iChannel * 8)) & 0xFF) - (int)goldenPixel[iChannel]));
+                maxDifference = std::max(maxDifference, difference);
+                if (difference > settings.channelTolerance)
+                    ++differentPixelsCount;
+            }
+        }
+
+        bool isMatching = differentPixelsCount <= settings.maxDifferentPixelsCount;
+        if (isMatching)
+            ASTEROID_LOG_INFO_F("Matches %s: %u pixels differ, largest channel difference %u.", settings.goldenPath, differentPixelsCount, maxDifference);
+        else
+            ASTEROID_LOG_ERROR_F("Differs from %s: %u pixels differ, largest channel difference %u.", settings.goldenPath, differentPixelsCount, maxDifference);
+        return isMatching;
+    }
+}
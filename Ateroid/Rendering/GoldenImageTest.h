@@ -0,0 +1,38 @@
+#pragma once
+
+namespace ASTEROID_NAMESPACE
+{
+    struct GoldenImageTestSettings
+    {
+        uint32_t    width;
+        uint32_t    height;
+        /** Write the rendered image to this PPM file, nullptr to skip. */
+        const char* imagePath;
+        /** Compare the rendered image with this PPM file, nullptr to skip. */
+        const char* goldenPath;
+        /** Pixels whose channels differ by at most this much from the golden image still match. */
+        uint32_t    channelTolerance;
+        /** Numbers of pixels allowed to differ by more than the tolerance. */
+        uint32_t    maxDifferentPixelsCount;
+    };
+
+
+    /**
+     *  Renders a fixed scene with the SoftwareRenderBackend to catch rendering regressions on machines without a
+     *  GPU: a field of lumpy asteroids and crates in several materials, batched by the InstanceBatcher.\n
+     *  The scene is generated without the random number distributions of the standard library, so the image only
+     *  depends on the rasterizer and the math functions.
+     */
+    class GoldenImageTest
+    {
+    public:
+        ASTEROID_NO_DEFAULT_CTOR(GoldenImageTest)
+        ASTEROID_NON_COPYABLE(GoldenImageTest)
+
+        /**
+         *  @return
+         *      False if the image couldn't be written or read, or differs from the golden image.
+         */
+        static bool Run(const GoldenImageTestSettings& settings);
+    };
+}
@@ -0,0 +1,122 @@
+#include "Precompile.h"
+#include "InstanceBatcher.h"
+#include "Core/JobSystem.h"
+#include "Util/Debug.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    InstanceBatcher::InstanceBatcher(uint32_t instancesPerFrame, uint32_t framesInFlight)
+        : m_InstancesPerFrame(instancesPerFrame), m_FramesInFlight(framesInFlight), m_FrameSegment(framesInFlight - 1)
+    {
+        ASTEROID_ASSERT(framesInFlight > 0, "InstanceBatcher needs at least one frame segment.");
+    }
+
+    void InstanceBatcher::BeginFrame()
+    {
+        m_FrameSegment = (m_FrameSegment + 1) % m_FramesInFlight;
+        m_Items.clear();
+        m_Transforms.clear();
+        m_Draws.clear();
+    }
+
+    void InstanceBatcher::Add(ObjectInstanceID mesh, uint32_t submeshIndex, ObjectInstanceID material, const Float4x4& world)
+    {
+        Item item;
+        item.key.material = material;
+        item.key.mesh = mesh;
+        item.key.submeshIndex = submeshIndex;
+        item.transformIndex = (uint32_t)m_Transforms.size();
+        m_Items.push_back(item);
+        m_Transforms.push_back(world);
+    }
+
+    void InstanceBatcher::Build()
+    {
+        m_Draws.clear();
+        std::sort(m_Items.begin(), m_Items.end());
+
+        uint32_t instancesCount = (uint32_t)m_Items.size();
+        if (instancesCount > m_InstancesPerFrame)
+        {
+            ASTEROID_LOG_WARNING_F("InstanceBatcher dropped %u instances exceeding the per frame capacity %u.",
+                instancesCount - m_InstancesPerFrame, m_InstancesPerFrame);
+            instancesCount = m_InstancesPerFrame;
+        }
+
+        // Every item owns the instance slot of its sorted position, so packing needs no synchronization.
+        m_PackedInstances.resize(instancesCount);
+        auto packInstances = [this](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                const Float4x4& world = m_Transforms[m_Items[i].transformIndex];
+                InstanceTransform& instance = m_PackedInstances[i];
+                for (int column = 0; column < 3; ++column)
+                {
+                    for (int row = 0; row < 4; ++row)
+                        instance.rows[column][row] = world.m[row][column];
+                }
+            }
+        };
+
+        JobSystem* jobSystem = JobSystem::Singleton();
+        if (jobSystem != nullptr)
+            jobSystem->ParallelFor(instancesCount, 4096, packInstances);
+        else
+            packInstances(0, instancesCount);
+
+        uint32_t segmentStart = m_FrameSegment * m_InstancesPerFrame;
+        uint32_t groupStart = 0;
+        for (uint32_t i = 1; i <= instancesCount; ++i)
+        {
+            if (i < instancesCount && m_Items[i].key == m_Items[groupStart].key)
+                continue;
+
+            const GroupKey& key = m_Items[groupStart].key;
+            InstancedDraw draw;
+            draw.mesh = key.mesh;
+            draw.submeshIndex = key.submeshIndex;
+            draw.material = key.material;
+            draw.instancesCount = i - groupStart;
+            draw.firstInstance = segmentStart + groupStart;
+            draw.streams = EVertexStreams::eAll;
+            m_Draws.push_back(draw);
+            groupStart = i;
+        }
+    }
+
+    bool InstanceBatcher::Submit(RenderBackend* backend, UploadRing* uploadRing, EVertexStreams streams) const
+    {
+        if (m_PackedInstances.empty())
+            return true;
+
+        uint32_t byteOffset = m_FrameSegment * m_InstancesPerFrame * sizeof(InstanceTransform);
+        uint32_t bytesCount = (uint32_t)(m_PackedInstances.size() * sizeof(InstanceTransform));
+        UploadAllocation allocation = uploadRing->Allocate(bytesCount);
+        if (!allocation.IsValid())
+        {
+            ASTEROID_LOG_ERROR("InstanceBatcher failed to allocate instance data in the upload ring.");
+            return false;
+        }
+
+        std::memcpy(allocation.data, m_PackedInstances.data(), bytesCount);
+        uploadRing->Unmap();
+        if (!backend->CopyToInstanceStream(byteOffset, allocation.offset, bytesCount))
+        {
+            ASTEROID_LOG_ERROR("InstanceBatcher failed to upload instance data.");
+            return false;
+        }
+
+        Draw(backend, streams);
+        return true;
+    }
+
+    void InstanceBatcher::Draw(RenderBackend* backend, EVertexStreams streams) const
+    {
+        for (InstancedDraw draw : m_Draws)
+        {
+            draw.streams = streams;
+            backend->DrawIndexedInstanced(draw);
+        }
+    }
+}
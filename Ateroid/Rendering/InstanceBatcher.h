@@ -0,0 +1,129 @@
+#pragma once
+
+#include "RenderBackend.h"
+#include "UploadRing.h"
+#include "Math/MathTypes.h"
+#include "Util/Containers.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  Per-instance data written to the instance stream.\n
+     *  The affine part of a row-major world matrix stored transposed, so row i is column i of the world matrix
+     *  and a shader computes the world position component i as dot(rows[i], float4(position, 1)).
+     */
+    struct InstanceTransform
+    {
+        float rows[3][4];
+    };
+
+
+    /**
+     *  Groups visible objects sharing mesh, submesh and material into instanced draws.\n
+     *  Per-instance transforms are packed group by group, written to the upload ring and copied from there into a
+     *  ring-buffered instance stream which is split into one segment per frame in flight, so a frame never
+     *  overwrites instances the GPU may still be reading.
+     *  @remarks
+     *      Usage per frame: BeginFrame, Add for every visible object, Build, then Submit between the BeginFrame and
+     *      EndFrame of the upload ring, and Draw for later passes.
+     */
+    class InstanceBatcher
+    {
+    public:
+        /**
+         *  @param instancesPerFrame
+         *      Maximum numbers of instances in a frame. Instances beyond it are dropped with a warning.
+         *  @param framesInFlight
+         *      Numbers of frames the GPU may lag behind, each gets its own instance stream segment.
+         */
+        InstanceBatcher(uint32_t instancesPerFrame, uint32_t framesInFlight);
+
+        ASTEROID_NON_COPYABLE(InstanceBatcher)
+
+        /** Size of the instance stream the backend must provide. */
+        uint32_t InstanceStreamBytes() const { return m_InstancesPerFrame * m_FramesInFlight * sizeof(InstanceTransform); }
+
+        /**
+         *  Start collecting the objects of a new frame and move to the next instance stream segment.
+         */
+        void BeginFrame();
+
+        /**
+         *  Add a visible object.
+         *  @param world
+         *      Row-major world matrix of the object.
+         */
+        void Add(ObjectInstanceID mesh, uint32_t submeshIndex, ObjectInstanceID material, const Float4x4& world);
+
+        /**
+         *  Group the added objects and pack their transforms in draw order.
+         */
+        void Build();
+
+        /**
+         *  Upload the packed transforms and issue one instanced draw per group.
+         *  @param uploadRing
+         *      Ring of the backend the transforms are written to, it is unmapped before the copy to the instance stream.
+         *  @param streams
+         *      Vertex streams the draws bind.
+         *  @return
+         *      False if the upload ring is full or the backend rejected the copy, no draws are issued in that case.
+         */
+        bool Submit(RenderBackend* backend, UploadRing* uploadRing, EVertexStreams streams = EVertexStreams::eAll) const;
+
+        /**
+         *  Issue the draws again without uploading, for further passes over the same objects after Submit,
+         *  e.g. the color pass after a depth prepass.
+         */
+        void Draw(RenderBackend* backend, EVertexStreams streams) const;
+
+        /** Draws built by the last Build. */
+        const Vector<InstancedDraw>& Draws() const { return m_Draws; }
+
+        /** Numbers of objects added since BeginFrame. */
+        uint32_t ObjectsCount() const { return (uint32_t)m_Items.size(); }
+
+    private:
+        struct GroupKey
+        {
+            ObjectInstanceID    material;
+            ObjectInstanceID    mesh;
+            uint32_t            submeshIndex;
+
+            bool operator<(const GroupKey& other) const
+            {
+                if (material != other.material) return material < other.material;
+                if (mesh != other.mesh) return mesh < other.mesh;
+                return submeshIndex < other.submeshIndex;
+            }
+            bool operator==(const GroupKey& other) const
+            {
+                return material == other.material && mesh == other.mesh && submeshIndex == other.submeshIndex;
+            }
+            bool operator!=(const GroupKey& other) const { return !(*this == other); }
+        };
+
+        struct Item
+        {
+            GroupKey    key;
+            uint32_t    transformIndex;
+
+            bool operator<(const Item& other) const
+            {
+                // Keep the order of addition inside a group so that builds are deterministic.
+                if (key != other.key) return key < other.key;
+                return transformIndex < other.transformIndex;
+            }
+        };
+
+    private:
+        uint32_t    m_InstancesPerFrame;
+        uint32_t    m_FramesInFlight;
+        uint32_t    m_FrameSegment;
+
+        Vector<Item>                    m_Items;
+        Vector<Float4x4>                m_Transforms;
+        Vector<InstanceTransform>       m_PackedInstances;
+        Vector<InstancedDraw>           m_Draws;
+    };
+}
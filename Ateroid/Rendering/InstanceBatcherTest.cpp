@@ -0,0 +1,216 @@
+#include "Precompile.h"
+#include "InstanceBatcherTest.h"
+#include "InstanceBatcher.h"
+#include "NullRenderBackend.h"
+#include "UploadRing.h"
+#include "Util/Debug.h"
+#include <random>
+
+namespace ASTEROID_NAMESPACE
+{
+    static const uint32_t kInstancesPerFrame = 4096;
+    static const uint32_t kFramesInFlight = 3;
+    static const uint32_t kMaterialsCount = 5;
+    static const uint32_t kMeshesCount = 7;
+    static const uint32_t kSubmeshesCount = 3;
+    /** Frames adding more objects than the batcher holds. */
+    static const float kOverflowRatio = 0.05f;
+
+    /** An object added to the batcher, with its order of addition. */
+    struct TestObject
+    {
+        ObjectInstanceID    material;
+        ObjectInstanceID    mesh;
+        uint32_t            submeshIndex;
+        uint32_t            addIndex;
+        Float4x4            world;
+    };
+
+    static bool IsSameGroup(const TestObject& a, const TestObject& b)
+    {
+        return a.material == b.material && a.mesh == b.mesh && a.submeshIndex == b.submeshIndex;
+    }
+
+    static bool IsBefore(const TestObject& a, const TestObject& b)
+    {
+        if (a.material != b.material) return a.material < b.material;
+        if (a.mesh != b.mesh) return a.mesh < b.mesh;
+        if (a.submeshIndex != b.submeshIndex) return a.submeshIndex < b.submeshIndex;
+        return a.addIndex < b.addIndex;
+    }
+
+    /** Random affine transform, every element distinct so that misplaced ones are caught. */
+    static Float4x4 RandomWorld(std::mt19937& random)
+    {
+        std::uniform_real_distribution<float> uniform(-100.0f, 100.0f);
+        Float4x4 world;
+        for (int row = 0; row < 4; ++row)
+        {
+            for (int column = 0; column < 3; ++column)
+                world.m[row][column] = uniform(random);
+        }
+        world._14 = world._24 = world._34 = 0.0f;
+        world._44 = 1.0f;
+        return world;
+    }
+
+    static void GenerateObjects(std::mt19937& random, Vector<TestObject>* objects)
+    {
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        uint32_t objectsCount = uniform(random) < kOverflowRatio ? kInstancesPerFrame + 1 + random() % kInstancesPerFrame :
+            1 + random() % kInstancesPerFrame;
+
+        // Object ids of the engine start at 1
+        objects->resize(objectsCount);
+        for (uint32_t iObject = 0; iObject < objectsCount; ++iObject)
+        {
+            TestObject& object = (*objects)[iObject];
+            object.material = (ObjectInstanceID)(1 + random() % kMaterialsCount);
+            object.mesh = (ObjectInstanceID)(1 + random() % kMeshesCount);
+            object.submeshIndex = random() % kSubmeshesCount;
+            object.world = RandomWorld(random);
+        }
+        std::shuffle(objects->begin(), objects->end(), random);
+        for (uint32_t iObject = 0; iObject < objectsCount; ++iObject)
+            (*objects)[iObject].addIndex = iObject;
+    }
+
+    /**
+     *  @return
+     *      False if the draws differ from one per group of the sorted objects.
+     */
+    static bool CheckDraws(const char* label, uint32_t frame, const Vector<InstancedDraw>& draws, const Vector<TestObject>& sorted,
+        uint32_t segmentStart, EVertexStreams streams)
+    {
+        uint32_t drawsCount = 0, groupStart = 0;
+        for (uint32_t i = 1; i <= sorted.size(); ++i)
+        {
+            if (i < sorted.size() && IsSameGroup(sorted[i], sorted[groupStart]))
+                continue;
+
+            const TestObject& object = sorted[groupStart];
+            if (drawsCount >= draws.size())
+            {
+                ASTEROID_LOG_ERROR_F("InstanceBatcher frame %u: %s recorded only %zu draws.", frame, label, draws.size());
+                return false;
+            }
+            const InstancedDraw& draw = draws[drawsCount++];
+            if (draw.material != object.material || draw.mesh != object.mesh || draw.submeshIndex != object.submeshIndex ||
+                draw.firstInstance != segmentStart + groupStart || draw.instancesCount != i - groupStart || draw.streams != streams)
+            {
+                ASTEROID_LOG_ERROR_F("InstanceBatcher frame %u: %s draw %u of material %d mesh %d submesh %u draws %u instances from "
+                    "%u instead of material %d mesh %d submesh %u, %u instances from %u.", frame, label, drawsCount - 1,
+                    draw.material, draw.mesh, draw.submeshIndex, draw.instancesCount, draw.firstInstance, object.material,
+                    object.mesh, object.submeshIndex, i - groupStart, segmentStart + groupStart);
+                return false;
+            }
+            groupStart = i;
+        }
+        if (drawsCount != draws.size())
+        {
+            ASTEROID_LOG_ERROR_F("InstanceBatcher frame %u: %s recorded %zu draws instead of %u.", frame, label, draws.size(), drawsCount);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     *  @return
+     *      False at the first instance of a segment whose rows aren't the transposed world matrix expected there.
+     */
+    static bool CheckInstanceStream(uint32_t frame, const NullRenderBackend& backend, const Vector<Vector<InstanceTransform>>& segments)
+    {
+        const Vector<uint8_t>& stream = backend.InstanceStream();
+        for (uint32_t iSegment = 0; iSegment < segments.size(); ++iSegment)
+        {
+            const Vector<InstanceTransform>& expected = segments[iSegment];
+            size_t segmentOffset = (size_t)iSegment * kInstancesPerFrame * sizeof(InstanceTransform);
+            for (uint32_t iInstance = 0; iInstance < expected.size(); ++iInstance)
+            {
+                InstanceTransform instance;
+                std::memcpy(&instance, stream.data() + segmentOffset + iInstance * sizeof(InstanceTransform), sizeof(instance));
+                if (std::memcmp(&instance, &expected[iInstance], sizeof(instance)) != 0)
+                {
+                    ASTEROID_LOG_ERROR_F("InstanceBatcher frame %u: instance %u of segment %u is not the transposed world matrix "
+                        "expected.", frame, iInstance, iSegment);
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool InstanceBatcherTest::Run(const InstanceBatcherTestSettings& settings)
+    {
+        ASTEROID_LOG_INFO_F("Instance batcher test: %u frames of up to %u instances.", settings.framesCount, kInstancesPerFrame);
+
+        InstanceBatcher batcher(kInstancesPerFrame, kFramesInFlight);
+        NullRenderBackend backend(batcher.InstanceStreamBytes());
+        backend.SetFenceLatency(kFramesInFlight - 1);
+        // One more frame of space for the end of the ring skipped when an allocation wraps
+        UploadRing uploadRing(&backend, batcher.InstanceStreamBytes() + kInstancesPerFrame * sizeof(InstanceTransform));
+
+        std::mt19937 random(settings.seed);
+        Vector<TestObject> objects, sorted;
+        Vector<Vector<InstanceTransform>> segments(kFramesInFlight);
+        uint64_t objectsCount = 0, drawsCount = 0, droppedCount = 0;
+        for (uint32_t iFrame = 0; iFrame < settings.framesCount; ++iFrame)
+        {
+            GenerateObjects(random, &objects);
+            uploadRing.BeginFrame();
+            batcher.BeginFrame();
+            for (const TestObject& object : objects)
+                batcher.Add(object.mesh, object.submeshIndex, object.material, object.world);
+            batcher.Build();
+
+            // Groups in material, mesh and submesh order, objects in order of addition inside a group
+            sorted = objects;
+            std::sort(sorted.begin(), sorted.end(), IsBefore);
+            if (sorted.size() > kInstancesPerFrame)
+            {
+                droppedCount += sorted.size() - kInstancesPerFrame;
+                sorted.resize(kInstancesPerFrame);
+            }
+
+            Vector<InstanceTransform>& segment = segments[iFrame % kFramesInFlight];
+            segment.resize(sorted.size());
+            for (uint32_t iInstance = 0; iInstance < sorted.size(); ++iInstance)
+            {
+                const Float4x4& world = sorted[iInstance].world;
+                for (int row = 0; row < 3; ++row)
+                {
+                    for (int column = 0; column < 4; ++column)
+                        segment[iInstance].rows[row][column] = world.m[column][row];
+                }
+            }
+
+            backend.ClearRecords();
+            bool isSubmitted = batcher.Submit(&backend, &uploadRing);
+            uploadRing.EndFrame();
+            if (!isSubmitted)
+            {
+                ASTEROID_LOG_ERROR_F("InstanceBatcher frame %u: submitting %zu objects failed.", iFrame, objects.size());
+                return false;
+            }
+
+            uint32_t segmentStart = (iFrame % kFramesInFlight) * kInstancesPerFrame;
+            if (!CheckDraws("Build", iFrame, batcher.Draws(), sorted, segmentStart, EVertexStreams::eAll) ||
+                !CheckDraws("Submit", iFrame, backend.RecordedDraws(), sorted, segmentStart, EVertexStreams::eAll) ||
+                !CheckInstanceStream(iFrame, backend, segments))
+                return false;
+
+            // A depth prepass draws the same instances with positions only
+            backend.ClearRecords();
+            batcher.Draw(&backend, EVertexStreams::ePositionOnly);
+            if (!CheckDraws("Draw", iFrame, backend.RecordedDraws(), sorted, segmentStart, EVertexStreams::ePositionOnly))
+                return false;
+
+            objectsCount += objects.size();
+            drawsCount += batcher.Draws().size();
+        }
+
+        ASTEROID_LOG_INFO_F("    %llu objects in %llu draws, %llu dropped beyond the frame capacity",
+            (unsigned long long)objectsCount, (unsigned long long)drawsCount, (unsigned long long)droppedCount);
+        return true;
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+namespace ASTEROID_NAMESPACE
+{
+    struct InstanceBatcherTestSettings
+    {
+        /** Frames of randomly shuffled objects submitted. */
+        uint32_t    framesCount;
+        uint32_t    seed;
+    };
+
+
+    /**
+     *  Submits frames of objects with a shuffled mix of materials, meshes and submeshes through an InstanceBatcher
+     *  to a NullRenderBackend. Every frame must give one draw per group in material, mesh and submesh order, with
+     *  the first instance and instances count of its place in the frame's instance stream segment. The segments of
+     *  every frame in flight must hold the transposed affine rows of the world matrices in the order they were
+     *  added. Some frames add more objects than the batcher holds, the last ones in draw order must be dropped.
+     */
+    class InstanceBatcherTest
+    {
+    public:
+        ASTEROID_NO_DEFAULT_CTOR(InstanceBatcherTest)
+        ASTEROID_NON_COPYABLE(InstanceBatcherTest)
+
+        /**
+         *  @return
+         *      False if any check failed.
+         */
+        static bool Run(const InstanceBatcherTestSettings& settings);
+    };
+}
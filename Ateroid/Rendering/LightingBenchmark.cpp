@@ -0,0 +1,245 @@
+#include "Precompile.h"
+#include "LightingBenchmark.h"
+#include "ClusteredLighting.h"
+#include "Util/Debug.h"
+#include <random>
+
+namespace ASTEROID_NAMESPACE
+{
+    static const uint32_t kTilesX = 16;
+    static const uint32_t kTilesY = 9;
+    static const uint32_t kSlicesCount = 24;
+    static const float kNearZ = 0.1f;
+    static const float kFarZ = 1000.0f;
+    static const float kVerticalFov = 1.0471976f;
+    static const float kAspectRatio = 16.0f / 9.0f;
+    /** Lights are scattered in a box this far from the camera on every side. */
+    static const float kSceneExtent = 300.0f;
+    static const float kMinLightRadius = 0.5f;
+    static const float kMaxLightRadius = 40.0f;
+
+    typedef std::chrono::steady_clock BenchmarkClock;
+
+    static double ElapsedMilliseconds(BenchmarkClock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(BenchmarkClock::now() - start).count();
+    }
+
+    struct ClusterBox
+    {
+        Float3  min;
+        Float3  max;
+    };
+
+    /** View space box of every cluster, computed on its own the way ClusteredLighting::SetGrid documents it. */
+    static void ComputeClusterBoxes(const ClusteredLighting& lighting, Vector<ClusterBox>* boxes)
+    {
+        const ClusteredLighting::GridDesc& desc = lighting.Grid();
+        boxes->resize(lighting.ClustersCount());
+        for (uint32_t iSlice = 0; iSlice < desc.slicesCount; ++iSlice)
+        {
+            float nearZ = desc.nearZ * std::pow(desc.farZ / desc.nearZ, (float)iSlice / desc.slicesCount);
+            float farZ = desc.nearZ * std::pow(desc.farZ / desc.nearZ, (float)(iSlice + 1) / desc.slicesCount);
+            for (uint32_t iTileY = 0; iTileY < desc.tilesY; ++iTileY)
+            {
+                float topNdc = 1.0f - 2.0f * iTileY / desc.tilesY;
+                float bottomNdc = 1.0f - 2.0f * (iTileY + 1) / desc.tilesY;
+                for (uint32_t iTileX = 0; iTileX < desc.tilesX; ++iTileX)
+                {
+                    float leftNdc = -1.0f + 2.0f * iTileX / desc.tilesX;
+                    float rightNdc = -1.0f + 2.0f * (iTileX + 1) / desc.tilesX;
+                    ClusterBox& box = (*boxes)[lighting.ClusterIndex(iTileX, iTileY, iSlice)];
+                    box.min = Float3(std::min(leftNdc * nearZ, leftNdc * farZ) / desc.projectionScaleX,
+                        std::min(bottomNdc * nearZ, bottomNdc * farZ) / desc.projectionScaleY, nearZ);
+                    box.max = Float3(std::max(rightNdc * nearZ, rightNdc * farZ) / desc.projectionScaleX,
+                        std::max(topNdc * nearZ, topNdc * farZ) / desc.projectionScaleY, farZ);
+                }
+            }
+        }
+    }
+
+    /** A camera at a random place turned by a random angle around the vertical axis. */
+    static Float4x4 RandomView(std::mt19937& random)
+    {
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        float angle = uniform(random) * 6.2831853f;
+        float c = std::cos(angle), s = std::sin(angle);
+        Float3 eye((uniform(random) - 0.5f) * kSceneExtent, (uniform(random) - 0.5f) * kSceneExtent * 0.1f,
+            (uniform(random) - 0.5f) * kSceneExtent);
+
+        // Inverse of the camera's rotation, then its position moved to the origin
+        Float4x4 view(c, 0.0f, s, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, -s, 0.0f, c, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+        view._41 = -(eye.x * view._11 + eye.y * view._21 + eye.z * view._31);
+        view._42 = -(eye.x * view._12 + eye.y * view._22 + eye.z * view._32);
+        view._43 = -(eye.x * view._13 + eye.y * view._23 + eye.z * view._33);
+        return view;
+    }
+
+    static void GenerateLights(uint32_t count, const Float4x4& view, std::mt19937& random, Vector<PointLight>* lights)
+    {
+        // Around the camera, in world space
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        Float3 eye(-(view._41 * view._11 + view._42 * view._12 + view._43 * view._13),
+            -(view._41 * view._21 + view._42 * view._22 + view._43 * view._23),
+            -(view._41 * view._31 + view._42 * view._32 + view._43 * view._33));
+        lights->resize(count);
+        for (PointLight& light : *lights)
+        {
+            light.position = Float3(eye.x + (uniform(random) * 2.0f - 1.0f) * kSceneExtent,
+                eye.y + (uniform(random) * 2.0f - 1.0f) * kSceneExtent * 0.2f, eye.z + (uniform(random) * 2.0f - 1.0f) * kSceneExtent);
+            // Mostly small lights, a few large ones
+            float size = uniform(random);
+            light.radius = kMinLightRadius + size * size * size * (kMaxLightRadius - kMinLightRadius);
+            light.color = Float3(uniform(random), uniform(random), uniform(random));
+            light.intensity = 1.0f;
+        }
+    }
+
+    /**
+     *  Tests every light against every cluster box and compares the lists.
+     *  @return
+     *      False at the first cluster whose list differs.
+     */
+    static bool CheckAssignment(const ClusteredLighting& lighting, const Vector<ClusterBox>& boxes, const Float4x4& view,
+        const Vector<PointLight>& lights, uint32_t indicesCount, Vector<Float3>* centers, Vector<uint32_t>* sliceLights,
+        Vector<uint16_t>* expected)
+    {
+        // Same expression as Assign, so centers are bit-identical
+        centers->resize(lights.size());
+        for (size_t iLight = 0; iLight < lights.size(); ++iLight)
+        {
+            const Float3& p = lights[iLight].position;
+            (*centers)[iLight] = Float3(
+                p.x * view._11 + p.y * view._21 + p.z * view._31 + view._41,
+                p.x * view._12 + p.y * view._22 + p.z * view._32 + view._42,
+                p.x * view._13 + p.y * view._23 + p.z * view._33 + view._43);
+        }
+
+        const Vector<ClusteredLighting::ClusterRange>& clusters = lighting.Clusters();
+        const Vector<uint16_t>& indices = lighting.LightIndices();
+        if (indicesCount != indices.size())
+        {
+            ASTEROID_LOG_ERROR_F("ClusteredLighting::Assign returned %u light indices but wrote %zu.", indicesCount, indices.size());
+            return false;
+        }
+
+        uint32_t offset = 0;
+        uint32_t sliceClustersCount = lighting.Grid().tilesX * lighting.Grid().tilesY;
+        for (uint32_t iCluster = 0; iCluster < boxes.size(); ++iCluster)
+        {
+            const ClusterBox& box = boxes[iCluster];
+            if (iCluster % sliceClustersCount == 0)
+            {
+                // The depth distance alone rules out most lights for the whole slice, which keeps checking thousands fast
+                sliceLights->clear();
+                for (uint32_t iLight = 0; iLight < lights.size(); ++iLight)
+                {
+                    const Float3& center = (*centers)[iLight];
+                    float dz = std::max(box.min.z - center.z, 0.0f) + std::max(center.z - box.max.z, 0.0f);
+                    if (dz * dz <= lights[iLight].radius * lights[iLight].radius)
+                        sliceLights->push_back(iLight);
+                }
+            }
+
+            expected->clear();
+            for (uint32_t iLight : *sliceLights)
+            {
+                const Float3& center = (*centers)[iLight];
+                float dx = std::max(box.min.x - center.x, 0.0f) + std::max(center.x - box.max.x, 0.0f);
+                float dy = std::max(box.min.y - center.y, 0.0f) + std::max(center.y - box.max.y, 0.0f);
+                float dz = std::max(box.min.z - center.z, 0.0f) + std::max(center.z - box.max.z, 0.0f);
+                float radius = lights[iLight].radius;
+                if ((dx * dx + dy * dy) + dz * dz <= radius * radius)
+                    expected->push_back((uint16_t)iLight);
+            }
+
+            const ClusteredLighting::ClusterRange& range = clusters[iCluster];
+            if (range.offset != offset || range.offset + range.count > indices.size())
+            {
+                ASTEROID_LOG_ERROR_F("Cluster %u lists lights from %u instead of %u.", iCluster, range.offset, offset);
+                return false;
+            }
+            offset += range.count;
+
+            const uint16_t* list = indices.data() + range.offset;
+            for (uint32_t iIndex = 1; iIndex < range.count; ++iIndex)
+            {
+                if (list[iIndex] <= list[iIndex - 1])
+                {
+                    ASTEROID_LOG_ERROR_F("Cluster %u lists light %u after light %u.", iCluster, list[iIndex], list[iIndex - 1]);
+                    return false;
+                }
+            }
+            if (range.count != expected->size() || !std::equal(expected->begin(), expected->end(), list))
+            {
+                ASTEROID_LOG_ERROR_F("Cluster %u lists %u lights instead of the %zu whose sphere touches its box.", iCluster, range.count,
+                    expected->size());
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool LightingBenchmark::Run(const LightingBenchmarkSettings& settings)
+    {
+        uint32_t maxLightsCount = settings.maxLightsCount;
+        if (maxLightsCount > ClusteredLighting::kMaxLights)
+            maxLightsCount = ClusteredLighting::kMaxLights;
+        ASTEROID_LOG_INFO_F("Lighting benchmark: up to %u lights, %u frames.", maxLightsCount, settings.framesCount);
+
+        ClusteredLighting lighting;
+        ClusteredLighting::GridDesc desc;
+        desc.tilesX = kTilesX;
+        desc.tilesY = kTilesY;
+        desc.slicesCount = kSlicesCount;
+        desc.nearZ = kNearZ;
+        desc.farZ = kFarZ;
+        desc.projectionScaleY = 1.0f / std::tan(kVerticalFov * 0.5f);
+        desc.projectionScaleX = desc.projectionScaleY / kAspectRatio;
+        lighting.SetGrid(desc);
+
+        Vector<ClusterBox> boxes;
+        ComputeClusterBoxes(lighting, &boxes);
+
+        std::mt19937 random(settings.seed);
+        Vector<PointLight> lights;
+        Vector<Float3> centers;
+        Vector<uint32_t> sliceLights;
+        Vector<uint16_t> expected;
+
+        bool isValid = true;
+        uint32_t framesCount = std::max(settings.framesCount, 1u);
+        uint32_t lightsCounts[] = { maxLightsCount / 10, maxLightsCount / 2, maxLightsCount };
+        for (uint32_t lightsCount : lightsCounts)
+        {
+            if (lightsCount == 0 || !isValid)
+                continue;
+
+            double assignTime = 0.0, bruteForceTime = 0.0;
+            uint64_t indicesCount = 0;
+            for (uint32_t iFrame = 0; iFrame < framesCount && isValid; ++iFrame)
+            {
+                Float4x4 view = RandomView(random);
+                GenerateLights(lightsCount, view, random, &lights);
+
+                BenchmarkClock::time_point start = BenchmarkClock::now();
+                uint32_t frameIndicesCount = lighting.Assign(view, lights.data(), lightsCount);
+                assignTime += ElapsedMilliseconds(start);
+                indicesCount += frameIndicesCount;
+
+                start = BenchmarkClock::now();
+                if (!CheckAssignment(lighting, boxes, view, lights, frameIndicesCount, &centers, &sliceLights, &expected))
+                {
+                    ASTEROID_LOG_ERROR_F("ClusteredLighting assignment of %u lights differs from brute force in frame %u.", lightsCount,
+                        iFrame);
+                    isValid = false;
+                }
+                bruteForceTime += ElapsedMilliseconds(start);
+            }
+
+            ASTEROID_LOG_INFO_F("    %6u lights: Assign %8.3f ms, brute force %9.3f ms, %.0f light indices per frame", lightsCount,
+                assignTime / framesCount, bruteForceTime / framesCount, (double)indicesCount / framesCount);
+        }
+        return isValid;
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+namespace ASTEROID_NAMESPACE
+{
+    struct LightingBenchmarkSettings
+    {
+        /** The most lights assigned, a tenth and half of it are assigned too. At most ClusteredLighting::kMaxLights. */
+        uint32_t    maxLightsCount;
+        /** Assignments timed for each count, each with other lights and another camera. */
+        uint32_t    framesCount;
+        uint32_t    seed;
+    };
+
+
+    /**
+     *  Times ClusteredLighting::Assign on a 16x9x24 cluster grid with point lights scattered around a turning
+     *  camera, many of them behind it or off screen. Every assignment is checked against a brute force
+     *  test of every light's sphere against every cluster box: each cluster must list exactly the lights touching
+     *  it, in ascending order.
+     */
+    class LightingBenchmark
+    {
+    public:
+        ASTEROID_NO_DEFAULT_CTOR(LightingBenchmark)
+        ASTEROID_NON_COPYABLE(LightingBenchmark)
+
+        /**
+         *  @return
+         *      False if a cluster list differs from the brute force one.
+         */
+        static bool Run(const LightingBenchmarkSettings& settings);
+    };
+}
@@ -5,6 +5,13 @@
 
 namespace ASTEROID_NAMESPACE
 {
+    Mesh::Mesh()
+        : m_IndexFormat(DXGI_FORMAT_UNKNOWN), m_PositionStream(kNoPositionStream)
+    {
+        m_IndexRange.page = 0;
+        m_IndexRange.allocation.node = TLSFAllocator::kInvalidNode;
+    }
+
     Mesh::~Mesh()
     {
         Destroy();
@@ -20,6 +27,37 @@ namespace ASTEROID_NAMESPACE
     {
         ASTEROID_ASSERT(m_VertexBuffer.size() == 0, "Previous created mesh resource is not destroyed yet.");
 
+        int32_t baseVertex = 0;
+        uint32_t baseIndex = 0;
+        bool created = MeshBufferPool::Singleton() != nullptr
+            ? CreatePooledBuffers(verticesData, verticesDataCount, indicesData, &baseVertex, &baseIndex)
+            : CreateDedicatedBuffers(verticesData, verticesDataCount, indicesData);
+        if (!created)
+            return false;
+
+        if (indicesData != nullptr)
+            m_IndexFormat = indicesData->bytesStride == sizeof(uint16_t) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+
+        // Copy the submesh info, rebased to where the buffers start
+        m_SubmeshesInfo.resize(submeshesCount);
+        std::memcpy(&m_SubmeshesInfo[0], submeshes, sizeof(SubmeshInfo) * submeshesCount);
+        for (SubmeshInfo& submesh : m_SubmeshesInfo)
+        {
+            submesh.indexStart += baseIndex;
+            submesh.vertexOffset += baseVertex;
+        }
+
+        // Identical layouts are shared between meshes
+        PipelineStateCache* pipelineStateCache = PipelineStateCache::Singleton();
+        if (pipelineStateCache != nullptr)
+            m_VertexLayout = pipelineStateCache->AcquireVertexLayout(inputElementDescs, descsCount);
+        m_PositionStream = FindPositionStream(inputElementDescs, descsCount);
+
+        return true;
+    }
+
+    bool Mesh::CreateDedicatedBuffers(const BufferData* verticesData, uint32_t verticesDataCount, const BufferData* indicesData)
+    {
         // Create vertex buffers
         D3D11_BUFFER_DESC bufferDesc;
         bufferDesc.BindFlags = D3D11_BIND_FLAG::D3D11_BIND_VERTEX_BUFFER;
@@ -42,11 +80,13 @@ namespace ASTEROID_NAMESPACE
             if (buffer == nullptr)
             {
                 // Release previous created buffers
-                m_VertexBuffer.clear();
+                ReleaseBuffers();
                 return false;
             }
 
             m_VertexBuffer.push_back(buffer);
+            m_VertexStrides.push_back(vertexData->bytesStride);
+            m_VertexByteOffsets.push_back(0);
         }
 
         // Create index buffer
@@ -64,29 +104,112 @@ namespace ASTEROID_NAMESPACE
             ID3D11BufferPtr buffer = RenderSystem::Singleton()->CreateBuffer(&bufferDesc, &initData);
             if (buffer == nullptr)
             {
-                m_VertexBuffer.clear();
+                ReleaseBuffers();
                 return false;
             }
 
             m_IndexBuffer = buffer;
         }
 
-        // Copy the submesh info
-        m_SubmeshesInfo.resize(submeshesCount);
-        std::memcpy(&m_SubmeshesInfo[0], submeshes, sizeof(SubmeshInfo) * submeshesCount);
+        return true;
+    }
+
+    bool Mesh::CreatePooledBuffers(const BufferData* verticesData, uint32_t verticesDataCount, const BufferData* indicesData,
+        int32_t* baseVertex, uint32_t* baseIndex)
+    {
+        MeshBufferPool* pool = MeshBufferPool::Singleton();
 
-        // Copy the input elements descs
-        m_InputElementDesc.resize(descsCount);
-        std::memcpy(&m_InputElementDesc[0], inputElementDescs, sizeof(D3D11_INPUT_ELEMENT_DESC) * descsCount);
+        // Ranges are aligned to their stride, so every stream starts on a whole vertex of its page
+        uint32_t minVertexStart = std::numeric_limits<uint32_t>::max();
+        for (uint32_t iBuffer = 0; iBuffer < verticesDataCount; ++iBuffer)
+        {
+            const BufferData* vertexData = verticesData + iBuffer;
+            ASTEROID_ASSERT(vertexData->bytesStride > 0, "Pooled vertex buffers need a stride.");
+
+            MeshBufferRange range = pool->Allocate(MeshBufferPool::EBufferType::eVertex,
+                vertexData->sysMem, vertexData->bytesCount, vertexData->bytesStride);
+            if (!range.IsValid())
+            {
+                ReleaseBuffers();
+                return false;
+            }
+
+            m_VertexRanges.push_back(range);
+            m_VertexBuffer.push_back(pool->PageBuffer(MeshBufferPool::EBufferType::eVertex, range.page));
+            m_VertexStrides.push_back(vertexData->bytesStride);
+            minVertexStart = std::min(minVertexStart, range.Offset() / vertexData->bytesStride);
+        }
+
+        // Streams may start at different vertices, the one starting first becomes the base vertex of the submeshes
+        // and the others are bound with the byte offset that lines them up with it.
+        *baseVertex = verticesDataCount > 0 ? (int32_t)minVertexStart : 0;
+        for (uint32_t iBuffer = 0; iBuffer < verticesDataCount; ++iBuffer)
+            m_VertexByteOffsets.push_back(m_VertexRanges[iBuffer].Offset() - (uint32_t)*baseVertex * m_VertexStrides[iBuffer]);
+
+        *baseIndex = 0;
+        if (indicesData != nullptr)
+        {
+            m_IndexRange = pool->Allocate(MeshBufferPool::EBufferType::eIndex,
+                indicesData->sysMem, indicesData->bytesCount, indicesData->bytesStride);
+            if (!m_IndexRange.IsValid())
+            {
+                ReleaseBuffers();
+                return false;
+            }
+
+            m_IndexBuffer = pool->PageBuffer(MeshBufferPool::EBufferType::eIndex, m_IndexRange.page);
+            *baseIndex = m_IndexRange.Offset() / indicesData->bytesStride;
+        }
 
         return true;
     }
 
-    void Mesh::Destroy()
+    uint32_t Mesh::FindPositionStream(const D3D11_INPUT_ELEMENT_DESC* inputElementDescs, uint32_t descsCount)
+    {
+        uint32_t positionSlot = kNoPositionStream;
+        for (uint32_t iDesc = 0; iDesc < descsCount; ++iDesc)
+        {
+            const D3D11_INPUT_ELEMENT_DESC& desc = inputElementDescs[iDesc];
+            if (desc.SemanticIndex == 0 && std::strcmp(desc.SemanticName, "POSITION") == 0)
+                positionSlot = desc.InputSlot;
+        }
+
+        // The stream only counts if nothing else is interleaved with the positions
+        for (uint32_t iDesc = 0; iDesc < descsCount && positionSlot != kNoPositionStream; ++iDesc)
+        {
+            const D3D11_INPUT_ELEMENT_DESC& desc = inputElementDescs[iDesc];
+            bool isPosition = desc.SemanticIndex == 0 && std::strcmp(desc.SemanticName, "POSITION") == 0;
+            if (!isPosition && desc.InputSlot == positionSlot)
+                positionSlot = kNoPositionStream;
+        }
+        return positionSlot;
+    }
+
+    void Mesh::ReleaseBuffers()
     {
+        MeshBufferPool* pool = MeshBufferPool::Singleton();
+        if (pool != nullptr)
+        {
+            for (const MeshBufferRange& range : m_VertexRanges)
+                pool->Free(MeshBufferPool::EBufferType::eVertex, range);
+            if (m_IndexRange.IsValid())
+                pool->Free(MeshBufferPool::EBufferType::eIndex, m_IndexRange);
+        }
+        m_VertexRanges.clear();
+        m_IndexRange.allocation.node = TLSFAllocator::kInvalidNode;
+
         m_VertexBuffer.clear();
+        m_VertexStrides.clear();
+        m_VertexByteOffsets.clear();
         m_IndexBuffer.Reset();
+    }
+
+    void Mesh::Destroy()
+    {
+        ReleaseBuffers();
+        m_IndexFormat = DXGI_FORMAT_UNKNOWN;
+        m_PositionStream = kNoPositionStream;
         m_SubmeshesInfo.clear();
-        m_InputElementDesc.clear();
+        m_VertexLayout.reset();
     }
 }
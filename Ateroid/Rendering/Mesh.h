@@ -1,17 +1,17 @@
 #pragma once
 
 #include "Core/Object.h"
+#include "RenderBackend.h"
+#include "PipelineStateCache.h"
+#include "MeshBufferPool.h"
 
 namespace ASTEROID_NAMESPACE
 {
-    struct SubmeshInfo
-    {
-        uint32_t indicesCount;
-        uint32_t indexStart;
-        int32_t vertexOffset;
-    };
-
-
+    /**
+     *  Vertex and index buffers with their submeshes.\n
+     *  When a MeshBufferPool exists the buffers are suballocated from its pages, and the submeshes are rebased so
+     *  that their index start and vertex offset address the shared buffers directly.
+     */
     class Mesh : public Object
     {
     public:
@@ -22,7 +22,11 @@ namespace ASTEROID_NAMESPACE
             uint32_t bytesStride;
         };
 
+        /** PositionStream value of meshes without a position-only stream. */
+        static const uint32_t kNoPositionStream = 0xFFFFFFFF;
+
     public:
+        Mesh();
         virtual ~Mesh();
 
         bool Create(const BufferData* verticesData,
@@ -35,10 +39,48 @@ namespace ASTEROID_NAMESPACE
 
         void Destroy();
 
+        uint32_t VertexBuffersCount() const { return (uint32_t)m_VertexBuffer.size(); }
+        ID3D11Buffer* VertexBuffer(uint32_t index) const { return m_VertexBuffer[index].Get(); }
+        uint32_t VertexStride(uint32_t index) const { return m_VertexStrides[index]; }
+        /** Byte offset to bind a vertex buffer at, so all streams share the vertex offset of the submeshes. */
+        uint32_t VertexByteOffset(uint32_t index) const { return m_VertexByteOffsets[index]; }
+        ID3D11Buffer* IndexBuffer() const { return m_IndexBuffer.Get(); }
+        DXGI_FORMAT IndexFormat() const { return m_IndexFormat; }
+
+        /**
+         *  The vertex stream holding nothing but positions, kNoPositionStream if positions are interleaved
+         *  with other attributes. See MeshProcessing::SplitPositionStream.
+         */
+        uint32_t PositionStream() const { return m_PositionStream; }
+
+        uint32_t SubmeshesCount() const { return (uint32_t)m_SubmeshesInfo.size(); }
+        const SubmeshInfo& Submesh(uint32_t index) const { return m_SubmeshesInfo[index]; }
+
+        /** The shared vertex layout of this mesh, nullptr if not created or created without a PipelineStateCache. */
+        const VertexLayout::SharedPtrType& GetVertexLayout() const { return m_VertexLayout; }
+
+    private:
+        bool CreateDedicatedBuffers(const BufferData* verticesData, uint32_t verticesDataCount, const BufferData* indicesData);
+        /**
+         *  Suballocate the buffers from the MeshBufferPool.
+         *  @param baseVertex, baseIndex
+         *      Returns where the mesh starts in the shared buffers, to be added to the submeshes.
+         */
+        bool CreatePooledBuffers(const BufferData* verticesData, uint32_t verticesDataCount, const BufferData* indicesData,
+            int32_t* baseVertex, uint32_t* baseIndex);
+        void ReleaseBuffers();
+        static uint32_t FindPositionStream(const D3D11_INPUT_ELEMENT_DESC* inputElementDescs, uint32_t descsCount);
+
     private:
         std::vector<ID3D11BufferPtr> m_VertexBuffer;
+        std::vector<uint32_t> m_VertexStrides;
+        std::vector<uint32_t> m_VertexByteOffsets;
+        std::vector<MeshBufferRange> m_VertexRanges;
         ID3D11BufferPtr m_IndexBuffer;
+        MeshBufferRange m_IndexRange;
+        DXGI_FORMAT m_IndexFormat;
+        uint32_t m_PositionStream;
         std::vector<SubmeshInfo> m_SubmeshesInfo;
-        std::vector<D3D11_INPUT_ELEMENT_DESC> m_InputElementDesc;
+        VertexLayout::SharedPtrType m_VertexLayout;
     };
 }
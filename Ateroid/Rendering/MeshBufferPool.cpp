@@ -0,0 +1,152 @@
+#include "Precompile.h"
+#include "MeshBufferPool.h"
+#include "RenderSystem.h"
+#include "RenderThread.h"
+#include "Util/Debug.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    MeshBufferPool* MeshBufferPool::_Singleton = nullptr;
+
+    MeshBufferPool::MeshBufferPool(uint32_t vertexPageBytes, uint32_t indexPageBytes)
+        : m_VertexPageBytes(vertexPageBytes), m_IndexPageBytes(indexPageBytes)
+    {
+    }
+
+    MeshBufferPool::~MeshBufferPool()
+    {
+        Stats stats = GetStats();
+        if (stats.vertex.allocationsCount > 0 || stats.index.allocationsCount > 0)
+        {
+            ASTEROID_LOG_WARNING_F("MeshBufferPool destroyed with %u vertex and %u index ranges still allocated.",
+                stats.vertex.allocationsCount, stats.index.allocationsCount);
+        }
+        if (!m_PendingUploads.empty())
+            ASTEROID_LOG_WARNING_F("MeshBufferPool destroyed with %zu uploads never recorded.", m_PendingUploads.size());
+    }
+
+    MeshBufferRange MeshBufferPool::Allocate(EBufferType type, const void* data, uint32_t bytesCount, uint32_t alignment)
+    {
+        MeshBufferRange range;
+        range.page = 0;
+        range.allocation.node = TLSFAllocator::kInvalidNode;
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        PageVector& pages = Pages(type);
+        for (uint32_t iPage = 0; iPage < pages.size() && !range.IsValid(); ++iPage)
+        {
+            range.page = iPage;
+            range.allocation = pages[iPage]->allocator.Allocate(bytesCount, alignment);
+        }
+
+        if (!range.IsValid())
+        {
+            uint32_t pageBytes = type == EBufferType::eVertex ? m_VertexPageBytes : m_IndexPageBytes;
+            SharedPtr<Page> page = CreatePage(type, std::max(pageBytes, bytesCount));
+            if (page == nullptr)
+                return range;
+
+            range.page = (uint32_t)pages.size();
+            range.allocation = page->allocator.Allocate(bytesCount, alignment);
+            pages.push_back(page);
+        }
+
+        if (!range.IsValid() || data == nullptr)
+            return range;
+
+        RenderThread* renderThread = RenderThread::Singleton();
+        if (renderThread == nullptr || renderThread->IsRenderThread())
+        {
+            RenderSystem::Singleton()->UpdateBuffer(pages[range.page]->buffer.Get(), range.Offset(), data, bytesCount);
+        }
+        else
+        {
+            PendingUpload upload;
+            upload.buffer = pages[range.page]->buffer;
+            upload.byteOffset = range.Offset();
+            upload.data.assign((const uint8_t*)data, (const uint8_t*)data + bytesCount);
+            m_PendingUploads.push_back(std::move(upload));
+        }
+        return range;
+    }
+
+    void MeshBufferPool::Free(EBufferType type, const MeshBufferRange& range)
+    {
+        // Frames already submitted may still draw from the range, but they execute before the upload of any
+        // range allocated in its place, which is recorded into a later packet.
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        Pages(type)[range.page]->allocator.Free(range.allocation);
+    }
+
+    void MeshBufferPool::RecordUploads(FramePacket* packet)
+    {
+        SharedPtr<Vector<PendingUpload>> uploads = ASTEROID_ALLOCATE_SHARED(Vector<PendingUpload>);
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (m_PendingUploads.empty())
+                return;
+            uploads->swap(m_PendingUploads);
+        }
+
+        packet->Add([uploads](RenderBackend*)
+        {
+            RenderSystem* renderSystem = RenderSystem::Singleton();
+            for (const PendingUpload& upload : *uploads)
+                renderSystem->UpdateBuffer(upload.buffer.Get(), upload.byteOffset, upload.data.data(), (uint32_t)upload.data.size());
+        });
+    }
+
+    uint32_t MeshBufferPool::PendingUploadsCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return (uint32_t)m_PendingUploads.size();
+    }
+
+    MeshBufferPool::Stats MeshBufferPool::GetStats() const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        Stats stats;
+        stats.vertexPagesCount = (uint32_t)m_VertexPages.size();
+        stats.indexPagesCount = (uint32_t)m_IndexPages.size();
+        AccumulateStats(m_VertexPages, &stats.vertex);
+        AccumulateStats(m_IndexPages, &stats.index);
+        return stats;
+    }
+
+    SharedPtr<MeshBufferPool::Page> MeshBufferPool::CreatePage(EBufferType type, uint32_t capacity)
+    {
+        D3D11_BUFFER_DESC bufferDesc;
+        bufferDesc.ByteWidth = capacity;
+        bufferDesc.Usage = D3D11_USAGE::D3D11_USAGE_DEFAULT;
+        bufferDesc.BindFlags = type == EBufferType::eVertex ? D3D11_BIND_FLAG::D3D11_BIND_VERTEX_BUFFER : D3D11_BIND_FLAG::D3D11_BIND_INDEX_BUFFER;
+        bufferDesc.CPUAccessFlags = 0;
+        bufferDesc.MiscFlags = 0;
+        bufferDesc.StructureByteStride = 0;
+
+        ID3D11BufferPtr buffer = RenderSystem::Singleton()->CreateBuffer(&bufferDesc, nullptr);
+        if (buffer == nullptr)
+        {
+            ASTEROID_LOG_ERROR_F("MeshBufferPool failed to create a page of %u bytes.", capacity);
+            return nullptr;
+        }
+
+        SharedPtr<Page> page = ASTEROID_ALLOCATE_SHARED(Page, capacity);
+        page->buffer = buffer;
+        return page;
+    }
+
+    void MeshBufferPool::AccumulateStats(const PageVector& pages, TLSFAllocator::Stats* stats)
+    {
+        std::memset(stats, 0, sizeof(TLSFAllocator::Stats));
+        for (const SharedPtr<Page>& page : pages)
+        {
+            TLSFAllocator::Stats pageStats = page->allocator.GetStats();
+            stats->capacity += pageStats.capacity;
+            stats->usedBytes += pageStats.usedBytes;
+            stats->freeBytes += pageStats.freeBytes;
+            stats->allocationsCount += pageStats.allocationsCount;
+            stats->freeBlocksCount += pageStats.freeBlocksCount;
+            stats->largestFreeBlock = std::max(stats->largestFreeBlock, pageStats.largestFreeBlock);
+        }
+    }
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <mutex>
+#include "Util/Containers.h"
+#include "Util/Pointers.h"
+#include "Util/TLSFAllocator.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    class FramePacket;
+
+
+    /**
+     *  A range suballocated from one of the pages of a MeshBufferPool.
+     */
+    struct MeshBufferRange
+    {
+        uint32_t                    page;
+        TLSFAllocator::Allocation   allocation;
+
+        bool IsValid() const { return allocation.IsValid(); }
+        uint32_t Offset() const { return allocation.offset; }
+    };
+
+
+    /**
+     *  Shared vertex and index megabuffers that meshes are suballocated from.\n
+     *  Every page is one large GPU buffer managed by a TLSFAllocator. Vertex ranges are aligned to their stride and
+     *  index ranges to their index size, so offsets can be expressed in vertices and indices. This lets meshes
+     *  rebase their submeshes into the shared buffers and keep the same buffer binding between draws.
+     *  @remarks
+     *      A new page is created when no existing page can fit an allocation. Allocations larger than a page get
+     *      a dedicated page of their own size.\n
+     *      While a RenderThread exists, uploads requested by other threads are queued and recorded into the next
+     *      frame packet by RecordUploads, since the render thread owns the device context.
+     */
+    class MeshBufferPool
+    {
+    public:
+        enum class EBufferType
+        {
+            eVertex, eIndex
+        };
+
+        struct Stats
+        {
+            uint32_t            vertexPagesCount;
+            uint32_t            indexPagesCount;
+            /** Stats of all vertex pages added together, largestFreeBlock is the largest of any page. */
+            TLSFAllocator::Stats vertex;
+            /** Stats of all index pages added together, largestFreeBlock is the largest of any page. */
+            TLSFAllocator::Stats index;
+        };
+
+    public:
+        ASTEROID_NON_COPYABLE(MeshBufferPool)
+
+        /**
+         *  Create the MeshBufferPool singleton.
+         *  @param vertexPageBytes, indexPageBytes
+         *      Size of each vertex and index page.
+         */
+        static MeshBufferPool* Create(uint32_t vertexPageBytes, uint32_t indexPageBytes)
+        {
+            ASTEROID_ASSERT(_Singleton == nullptr, "There is already a MeshBufferPool singleton created.");
+            _Singleton = ASTEROID_NEW MeshBufferPool(vertexPageBytes, indexPageBytes);
+            return _Singleton;
+        }
+
+        /**
+         *  Destroy the MeshBufferPool singleton.
+         */
+        static void Destroy()
+        {
+            ASTEROID_DELETE _Singleton;
+            _Singleton = nullptr;
+        }
+
+        /**
+         *  Current created singleton.
+         *  @return
+         *      Instance of current created singleton. nullptr if no instance created or singleton was destroyed.
+         */
+        static MeshBufferPool* Singleton() { return _Singleton; }
+
+        ~MeshBufferPool();
+
+        /**
+         *  Allocate a range and upload data into it.
+         *  @param alignment
+         *      The vertex stride or index size.
+         *  @return
+         *      The allocated range, check MeshBufferRange::IsValid for failure.
+         *  @remarks
+         *      While a RenderThread exists it is safe to call from any thread, the data is copied and queued unless
+         *      called on the render thread. Without one the data is uploaded right away by the calling thread.
+         */
+        MeshBufferRange Allocate(EBufferType type, const void* data, uint32_t bytesCount, uint32_t alignment);
+
+        /**
+         *  Free a range returned by Allocate.
+         */
+        void Free(EBufferType type, const MeshBufferRange& range);
+
+        /**
+         *  Add a command uploading the queued data to the packet, called by the main thread before it records
+         *  any draw of the frame.
+         */
+        void RecordUploads(FramePacket* packet);
+
+        /** Numbers of uploads waiting for RecordUploads. */
+        uint32_t PendingUploadsCount() const;
+
+        /** GPU buffer of a page. */
+        const ID3D11BufferPtr& PageBuffer(EBufferType type, uint32_t page) const { return Pages(type)[page]->buffer; }
+
+        Stats GetStats() const;
+
+    private:
+        struct Page
+        {
+            ID3D11BufferPtr buffer;
+            TLSFAllocator   allocator;
+
+            explicit Page(uint32_t capacity) : allocator(capacity) {}
+        };
+
+        typedef Vector<SharedPtr<Page>> PageVector;
+
+        struct PendingUpload
+        {
+            ID3D11BufferPtr buffer;
+            uint32_t        byteOffset;
+            Vector<uint8_t> data;
+        };
+
+        MeshBufferPool(uint32_t vertexPageBytes, uint32_t indexPageBytes);
+
+        PageVector& Pages(EBufferType type) { return type == EBufferType::eVertex ? m_VertexPages : m_IndexPages; }
+        const PageVector& Pages(EBufferType type) const { return type == EBufferType::eVertex ? m_VertexPages : m_IndexPages; }
+
+        SharedPtr<Page> CreatePage(EBufferType type, uint32_t capacity);
+        static void AccumulateStats(const PageVector& pages, TLSFAllocator::Stats* stats);
+
+    private:
+        static MeshBufferPool* _Singleton;
+
+    private:
+        uint32_t    m_VertexPageBytes;
+        uint32_t    m_IndexPageBytes;
+        PageVector  m_VertexPages;
+        PageVector  m_IndexPages;
+        /** Guards the pages and the pending uploads. */
+        mutable std::mutex      m_Mutex;
+        Vector<PendingUpload>   m_PendingUploads;
+    };
+}
@@ -0,0 +1,741 @@
+#include "Precompile.h"
+#include "MeshProcessing.h"
+#include "Core/JobSystem.h"
+#include "Math/SimdMath.h"
+#include "Util/Debug.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ASTEROID_MESH_PROCESSING_SSE
+#include <immintrin.h>
+#endif
+
+namespace ASTEROID_NAMESPACE
+{
+    static bool IsSemantic(const VertexElement& element, const char* semanticName)
+    {
+        return !element.isPerInstance && element.semanticIndex == 0 && std::strcmp(element.semanticName, semanticName) == 0;
+    }
+
+    static bool IsPosition(const VertexElement& element)
+    {
+        return IsSemantic(element, "POSITION");
+    }
+
+    /**
+     *  Copy an element of every vertex out of the vertex streams. T is a float vector and the element must
+     *  store at least as many 32-bit floats.
+     */
+    template<typename T>
+    static bool ExtractElement(const MeshSourceData& data, const char* semanticName, Vector<T>* values)
+    {
+        // Appended elements start where the previous element of their slot ends
+        Vector<uint32_t> slotOffsets(data.vertexStreams.size(), 0);
+        for (const VertexElement& element : data.inputElements)
+        {
+            if (element.isPerInstance || element.inputSlot >= slotOffsets.size())
+                continue;
+
+            uint32_t offset = element.alignedByteOffset == VertexElement::kAppendAligned ? slotOffsets[element.inputSlot] : element.alignedByteOffset;
+            slotOffsets[element.inputSlot] = offset + element.Bytes();
+            if (!IsSemantic(element, semanticName))
+                continue;
+
+            bool isFloat = element.format == EVertexFormat::eRG32Float || element.format == EVertexFormat::eRGB32Float ||
+                element.format == EVertexFormat::eRGBA32Float;
+            if (!isFloat || element.Bytes() < sizeof(T))
+            {
+                ASTEROID_LOG_WARNING_F("Reading %s failed, it isn't stored as enough 32-bit floats.", semanticName);
+                return false;
+            }
+
+            const Vector<uint8_t>& stream = data.vertexStreams[element.inputSlot];
+            uint32_t stride = data.vertexStrides[element.inputSlot];
+            uint32_t verticesCount = stride > 0 ? (uint32_t)(stream.size() / stride) : 0;
+            values->resize(verticesCount);
+            for (uint32_t iVertex = 0; iVertex < verticesCount; ++iVertex)
+                std::memcpy(&(*values)[iVertex], stream.data() + iVertex * stride + offset, sizeof(T));
+            return true;
+        }
+
+        ASTEROID_LOG_WARNING_F("Reading %s failed, the mesh has no such element.", semanticName);
+        return false;
+    }
+
+    template<typename T>
+    using LaneVector = VectorA<T, 16>;
+
+    /** Triangles per job of the geometry passes. */
+    static const uint32_t kTrianglesPerBatch = 16 * 1024;
+
+    static void ParallelBatches(uint32_t count, uint32_t batchSize, const JobSystem::RangeFunction& function)
+    {
+        JobSystem* jobSystem = JobSystem::Singleton();
+        if (jobSystem != nullptr)
+            jobSystem->ParallelFor(count, batchSize, function);
+        else if (count > 0)
+            function(0, count);
+    }
+
+    /**
+     *  Vertex index of every triangle corner with the vertex offset of its submesh applied.
+     *  @param submeshCornerStarts
+     *      Optional, receives the first corner of every submesh followed by the corners count.
+     */
+    static bool ResolveCorners(const MeshSourceData& data, uint32_t verticesCount, Vector<uint32_t>* corners, Vector<uint32_t>* submeshCornerStarts)
+    {
+        uint32_t indicesCount = data.indexStride > 0 ? (uint32_t)(data.indices.size() / data.indexStride) : 0;
+        corners->clear();
+        if (submeshCornerStarts != nullptr)
+            submeshCornerStarts->clear();
+
+        for (const SubmeshInfo& submesh : data.submeshes)
+        {
+            if (submeshCornerStarts != nullptr)
+                submeshCornerStarts->push_back((uint32_t)corners->size());
+
+            uint32_t cornersCount = submesh.indicesCount / 3 * 3;
+            if ((uint64_t)submesh.indexStart + cornersCount > indicesCount)
+            {
+                ASTEROID_LOG_WARNING("Mesh processing failed, a submesh reads past the end of the indices.");
+                return false;
+            }
+
+            for (uint32_t iIndex = submesh.indexStart; iIndex < submesh.indexStart + cornersCount; ++iIndex)
+            {
+                int64_t vertex = data.indexStride == sizeof(uint16_t)
+                    ? reinterpret_cast<const uint16_t*>(data.indices.data())[iIndex]
+                    : reinterpret_cast<const uint32_t*>(data.indices.data())[iIndex];
+                vertex += submesh.vertexOffset;
+                if (vertex < 0 || vertex >= verticesCount)
+                {
+                    ASTEROID_LOG_WARNING("Mesh processing failed, an index is out of the vertex range.");
+                    return false;
+                }
+                corners->push_back((uint32_t)vertex);
+            }
+        }
+
+        if (submeshCornerStarts != nullptr)
+            submeshCornerStarts->push_back((uint32_t)corners->size());
+        return true;
+    }
+
+    /**
+     *  Corners around every vertex, the corners of vertex v are vertexCorners[offsets[v], offsets[v + 1]) in
+     *  ascending order.
+     */
+    static void BuildVertexCorners(const Vector<uint32_t>& corners, uint32_t verticesCount, Vector<uint32_t>* offsets, Vector<uint32_t>* vertexCorners)
+    {
+        offsets->assign(verticesCount + 1, 0);
+        for (uint32_t vertex : corners)
+            ++(*offsets)[vertex + 1];
+        for (uint32_t iVertex = 0; iVertex < verticesCount; ++iVertex)
+            (*offsets)[iVertex + 1] += (*offsets)[iVertex];
+
+        Vector<uint32_t> cursors(offsets->begin(), offsets->end() - 1);
+        vertexCorners->resize(corners.size());
+        for (uint32_t iCorner = 0; iCorner < corners.size(); ++iCorner)
+            (*vertexCorners)[cursors[corners[iCorner]]++] = iCorner;
+    }
+
+    /** Positions padded to four floats for aligned SIMD loads. */
+    static void PadPositions(const Vector<Float3>& positions, LaneVector<Float4>* padded)
+    {
+        padded->resize(positions.size());
+        for (uint32_t iVertex = 0; iVertex < positions.size(); ++iVertex)
+            (*padded)[iVertex] = Float4(positions[iVertex].x, positions[iVertex].y, positions[iVertex].z, 0.0f);
+    }
+
+#ifdef ASTEROID_MESH_PROCESSING_SSE
+    /** Load corner k of four triangles starting at triangle as x, y, z lanes. Triangles past the last repeat it. */
+    static inline void LoadCorner(const Float4* positions, const uint32_t* corners, uint32_t triangle,
+        uint32_t lastTriangle, uint32_t k, __m128* x, __m128* y, __m128* z)
+    {
+        __m128 p0 = _mm_load_ps(&positions[corners[std::min(triangle + 0, lastTriangle) * 3 + k]].x);
+        __m128 p1 = _mm_load_ps(&positions[corners[std::min(triangle + 1, lastTriangle) * 3 + k]].x);
+        __m128 p2 = _mm_load_ps(&positions[corners[std::min(triangle + 2, lastTriangle) * 3 + k]].x);
+        __m128 p3 = _mm_load_ps(&positions[corners[std::min(triangle + 3, lastTriangle) * 3 + k]].x);
+        _MM_TRANSPOSE4_PS(p0, p1, p2, p3);
+        *x = p0;
+        *y = p1;
+        *z = p2;
+    }
+
+    static inline __m128 Dot3(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz)
+    {
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_mul_ps(az, bz));
+    }
+
+    /** Scale four vectors to unit length, zero vectors stay zero. */
+    static inline void Normalize3(__m128* x, __m128* y, __m128* z)
+    {
+        __m128 lengthSq = Dot3(*x, *y, *z, *x, *y, *z);
+        __m128 isValid = _mm_cmpgt_ps(lengthSq, _mm_setzero_ps());
+        __m128 invLength = _mm_and_ps(isValid, _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(lengthSq, _mm_set1_ps(1e-30f)))));
+        *x = _mm_mul_ps(*x, invLength);
+        *y = _mm_mul_ps(*y, invLength);
+        *z = _mm_mul_ps(*z, invLength);
+    }
+
+    /** acos with an absolute error below 7e-5, Abramowitz and Stegun 4.4.45. */
+    static inline __m128 Acos(__m128 x)
+    {
+        const __m128 kOne = _mm_set1_ps(1.0f);
+        __m128 clamped = _mm_min_ps(_mm_max_ps(x, _mm_set1_ps(-1.0f)), kOne);
+        __m128 absX = _mm_andnot_ps(_mm_set1_ps(-0.0f), clamped);
+        __m128 polynomial = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-0.0187293f), absX), _mm_set1_ps(0.0742610f));
+        polynomial = _mm_add_ps(_mm_mul_ps(polynomial, absX), _mm_set1_ps(-0.2121144f));
+        polynomial = _mm_add_ps(_mm_mul_ps(polynomial, absX), _mm_set1_ps(1.5707288f));
+        __m128 result = _mm_mul_ps(polynomial, _mm_sqrt_ps(_mm_sub_ps(kOne, absX)));
+
+        // acos(-x) = pi - acos(x)
+        __m128 isNegative = _mm_cmplt_ps(clamped, _mm_setzero_ps());
+        __m128 reflected = _mm_sub_ps(_mm_set1_ps(3.14159265f), result);
+        return _mm_or_ps(_mm_and_ps(isNegative, reflected), _mm_andnot_ps(isNegative, result));
+    }
+
+    /** Angle between four pairs of vectors, 0 if one of them has no length. */
+    static inline __m128 Angle(__m128 ax, __m128 ay, __m128 az, __m128 bx, __m128 by, __m128 bz)
+    {
+        __m128 lengthsSq = _mm_mul_ps(Dot3(ax, ay, az, ax, ay, az), Dot3(bx, by, bz, bx, by, bz));
+        __m128 isValid = _mm_cmpgt_ps(lengthsSq, _mm_setzero_ps());
+        __m128 cosine = _mm_div_ps(Dot3(ax, ay, az, bx, by, bz), _mm_sqrt_ps(_mm_max_ps(lengthsSq, _mm_set1_ps(1e-30f))));
+        return _mm_and_ps(isValid, Acos(cosine));
+    }
+
+    /** Store four vectors given as x, y, z lanes to consecutive elements, only the first count of them. */
+    static inline void StoreLanes(__m128 x, __m128 y, __m128 z, Float4* output, uint32_t count)
+    {
+        __m128 w = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS(x, y, z, w);
+        __m128 lanes[4] = { x, y, z, w };
+        for (uint32_t iLane = 0; iLane < count; ++iLane)
+            _mm_storeu_ps(&output[iLane].x, lanes[iLane]);
+    }
+
+    /**
+     *  Unit normals and corner angles of the triangles in groups of four [beginGroup, endGroup).
+     */
+    static void ComputeFaceNormals(const Float4* positions, const uint32_t* corners, uint32_t trianglesCount,
+        uint32_t beginGroup, uint32_t endGroup, Float4* faceNormals, float* cornerAngles)
+    {
+        for (uint32_t iGroup = beginGroup; iGroup < endGroup; ++iGroup)
+        {
+            uint32_t triangle = iGroup * 4;
+            uint32_t lanesCount = std::min(trianglesCount - triangle, 4u);
+            __m128 x[3], y[3], z[3];
+            for (uint32_t k = 0; k < 3; ++k)
+                LoadCorner(positions, corners, triangle, trianglesCount - 1, k, &x[k], &y[k], &z[k]);
+
+            __m128 e01x = _mm_sub_ps(x[1], x[0]), e01y = _mm_sub_ps(y[1], y[0]), e01z = _mm_sub_ps(z[1], z[0]);
+            __m128 e02x = _mm_sub_ps(x[2], x[0]), e02y = _mm_sub_ps(y[2], y[0]), e02z = _mm_sub_ps(z[2], z[0]);
+            __m128 e12x = _mm_sub_ps(x[2], x[1]), e12y = _mm_sub_ps(y[2], y[1]), e12z = _mm_sub_ps(z[2], z[1]);
+
+            __m128 nx = _mm_sub_ps(_mm_mul_ps(e01y, e02z), _mm_mul_ps(e01z, e02y));
+            __m128 ny = _mm_sub_ps(_mm_mul_ps(e01z, e02x), _mm_mul_ps(e01x, e02z));
+            __m128 nz = _mm_sub_ps(_mm_mul_ps(e01x, e02y), _mm_mul_ps(e01y, e02x));
+            Normalize3(&nx, &ny, &nz);
+            StoreLanes(nx, ny, nz, faceNormals + triangle, lanesCount);
+
+            const __m128 kMinusOne = _mm_set1_ps(-1.0f);
+            __m128 angles[3];
+            angles[0] = Angle(e01x, e01y, e01z, e02x, e02y, e02z);
+            angles[1] = Angle(_mm_mul_ps(e01x, kMinusOne), _mm_mul_ps(e01y, kMinusOne), _mm_mul_ps(e01z, kMinusOne), e12x, e12y, e12z);
+            angles[2] = Angle(_mm_mul_ps(e02x, kMinusOne), _mm_mul_ps(e02y, kMinusOne), _mm_mul_ps(e02z, kMinusOne),
+                _mm_mul_ps(e12x, kMinusOne), _mm_mul_ps(e12y, kMinusOne), _mm_mul_ps(e12z, kMinusOne));
+
+            alignas(16) float cornerLanes[3][4];
+            for (uint32_t k = 0; k < 3; ++k)
+                _mm_store_ps(cornerLanes[k], angles[k]);
+            for (uint32_t iLane = 0; iLane < lanesCount; ++iLane)
+            {
+                for (uint32_t k = 0; k < 3; ++k)
+                    cornerAngles[(triangle + iLane) * 3 + k] = cornerLanes[k][iLane];
+            }
+        }
+    }
+
+    /**
+     *  Unit tangents and bitangents of the triangles in groups of four [beginGroup, endGroup), from the texture
+     *  coordinate derivatives. They point along increasing u and v, so mirrored triangles get a flipped pair.
+     */
+    static void ComputeFaceTangents(const Float4* positions, const Float2* texcoords, const uint32_t* corners,
+        uint32_t trianglesCount, uint32_t beginGroup, uint32_t endGroup, Float4* faceTangents, Float4* faceBitangents)
+    {
+        for (uint32_t iGroup = beginGroup; iGroup < endGroup; ++iGroup)
+        {
+            uint32_t triangle = iGroup * 4;
+            uint32_t lanesCount = std::min(trianglesCount - triangle, 4u);
+            __m128 x[3], y[3], z[3], u[3], v[3];
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                LoadCorner(positions, corners, triangle, trianglesCount - 1, k, &x[k], &y[k], &z[k]);
+
+                const Float2* uv[4];
+                for (uint32_t iLane = 0; iLane < 4; ++iLane)
+                    uv[iLane] = &texcoords[corners[std::min(triangle + iLane, trianglesCount - 1) * 3 + k]];
+                u[k] = _mm_setr_ps(uv[0]->x, uv[1]->x, uv[2]->x, uv[3]->x);
+                v[k] = _mm_setr_ps(uv[0]->y, uv[1]->y, uv[2]->y, uv[3]->y);
+            }
+
+            __m128 e01x = _mm_sub_ps(x[1], x[0]), e01y = _mm_sub_ps(y[1], y[0]), e01z = _mm_sub_ps(z[1], z[0]);
+            __m128 e02x = _mm_sub_ps(x[2], x[0]), e02y = _mm_sub_ps(y[2], y[0]), e02z = _mm_sub_ps(z[2], z[0]);
+            __m128 du1 = _mm_sub_ps(u[1], u[0]), dv1 = _mm_sub_ps(v[1], v[0]);
+            __m128 du2 = _mm_sub_ps(u[2], u[0]), dv2 = _mm_sub_ps(v[2], v[0]);
+
+            // Only the direction matters, so the sign of the UV area replaces the division by it
+            __m128 area = _mm_sub_ps(_mm_mul_ps(du1, dv2), _mm_mul_ps(du2, dv1));
+            __m128 sign = _mm_or_ps(_mm_and_ps(area, _mm_set1_ps(-0.0f)), _mm_set1_ps(1.0f));
+            sign = _mm_and_ps(sign, _mm_cmpneq_ps(area, _mm_setzero_ps()));
+
+            __m128 tx = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e01x, dv2), _mm_mul_ps(e02x, dv1)), sign);
+            __m128 ty = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e01y, dv2), _mm_mul_ps(e02y, dv1)), sign);
+            __m128 tz = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e01z, dv2), _mm_mul_ps(e02z, dv1)), sign);
+            __m128 bx = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e02x, du1), _mm_mul_ps(e01x, du2)), sign);
+            __m128 by = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e02y, du1), _mm_mul_ps(e01y, du2)), sign);
+            __m128 bz = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e02z, du1), _mm_mul_ps(e01z, du2)), sign);
+            Normalize3(&tx, &ty, &tz);
+            Normalize3(&bx, &by, &bz);
+            StoreLanes(tx, ty, tz, faceTangents + triangle, lanesCount);
+            StoreLanes(bx, by, bz, faceBitangents + triangle, lanesCount);
+        }
+    }
+
+#else
+    // One triangle at a time with the operations of the SSE path, so results are the same on every platform
+
+    static inline float Dot3(const Float3& a, const Float3& b)
+    {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    static inline Float3 Subtract(const Float3& a, const Float3& b)
+    {
+        return Float3(a.x - b.x, a.y - b.y, a.z - b.z);
+    }
+
+    static inline Float3 Negate(const Float3& a)
+    {
+        return Float3(-a.x, -a.y, -a.z);
+    }
+
+    /** Scale a vector to unit length, a zero vector stays zero. */
+    static inline Float3 Normalize3(const Float3& a)
+    {
+        float lengthSq = Dot3(a, a);
+        float invLength = lengthSq > 0.0f ? 1.0f / std::sqrt(std::max(lengthSq, 1e-30f)) : 0.0f;
+        return Float3(a.x * invLength, a.y * invLength, a.z * invLength);
+    }
+
+    /** acos with an absolute error below 7e-5, Abramowitz and Stegun 4.4.45. */
+    static inline float Acos(float x)
+    {
+        float clamped = std::min(std::max(x, -1.0f), 1.0f);
+        float absX = std::abs(clamped);
+        float polynomial = -0.0187293f * absX + 0.0742610f;
+        polynomial = polynomial * absX + -0.2121144f;
+        polynomial = polynomial * absX + 1.5707288f;
+        float result = polynomial * std::sqrt(1.0f - absX);
+
+        // acos(-x) = pi - acos(x)
+        return clamped < 0.0f ? 3.14159265f - result : result;
+    }
+
+    /** Angle between two vectors, 0 if one of them has no length. */
+    static inline float Angle(const Float3& a, const Float3& b)
+    {
+        float lengthsSq = Dot3(a, a) * Dot3(b, b);
+        return lengthsSq > 0.0f ? Acos(Dot3(a, b) / std::sqrt(std::max(lengthsSq, 1e-30f))) : 0.0f;
+    }
+
+    static inline Float3 CornerPosition(const Float4* positions, const uint32_t* corners, uint32_t triangle, uint32_t k)
+    {
+        const Float4& position = positions[corners[triangle * 3 + k]];
+        return Float3(position.x, position.y, position.z);
+    }
+
+    /**
+     *  Unit normals and corner angles of the triangles in groups of four [beginGroup, endGroup).
+     */
+    static void ComputeFaceNormals(const Float4* positions, const uint32_t* corners, uint32_t trianglesCount,
+        uint32_t beginGroup, uint32_t endGroup, Float4* faceNormals, float* cornerAngles)
+    {
+        for (uint32_t triangle = beginGroup * 4; triangle < std::min(endGroup * 4, trianglesCount); ++triangle)
+        {
+            Float3 p0 = CornerPosition(positions, corners, triangle, 0);
+            Float3 p1 = CornerPosition(positions, corners, triangle, 1);
+            Float3 p2 = CornerPosition(positions, corners, triangle, 2);
+            Float3 e01 = Subtract(p1, p0), e02 = Subtract(p2, p0), e12 = Subtract(p2, p1);
+
+            Float3 normal = Normalize3(Float3(e01.y * e02.z - e01.z * e02.y, e01.z * e02.x - e01.x * e02.z, e01.x * e02.y - e01.y * e02.x));
+            faceNormals[triangle] = Float4(normal.x, normal.y, normal.z, 0.0f);
+
+            cornerAngles[triangle * 3 + 0] = Angle(e01, e02);
+            cornerAngles[triangle * 3 + 1] = Angle(Negate(e01), e12);
+            cornerAngles[triangle * 3 + 2] = Angle(Negate(e02), Negate(e12));
+        }
+    }
+
+    /**
+     *  Unit tangents and bitangents of the triangles in groups of four [beginGroup, endGroup), from the texture
+     *  coordinate derivatives. They point along increasing u and v, so mirrored triangles get a flipped pair.
+     */
+    static void ComputeFaceTangents(const Float4* positions, const Float2* texcoords, const uint32_t* corners,
+        uint32_t trianglesCount, uint32_t beginGroup, uint32_t endGroup, Float4* faceTangents, Float4* faceBitangents)
+    {
+        for (uint32_t triangle = beginGroup * 4; triangle < std::min(endGroup * 4, trianglesCount); ++triangle)
+        {
+            Float3 p0 = CornerPosition(positions, corners, triangle, 0);
+            Float3 e01 = Subtract(CornerPosition(positions, corners, triangle, 1), p0);
+            Float3 e02 = Subtract(CornerPosition(positions, corners, triangle, 2), p0);
+            const Float2& uv0 = texcoords[corners[triangle * 3 + 0]];
+            const Float2& uv1 = texcoords[corners[triangle * 3 + 1]];
+            const Float2& uv2 = texcoords[corners[triangle * 3 + 2]];
+            float du1 = uv1.x - uv0.x, dv1 = uv1.y - uv0.y;
+            float du2 = uv2.x - uv0.x, dv2 = uv2.y - uv0.y;
+
+            // Only the direction matters, so the sign of the UV area replaces the division by it
+            float area = du1 * dv2 - du2 * dv1;
+            float sign = area < 0.0f ? -1.0f : area > 0.0f ? 1.0f : 0.0f;
+
+            Float3 tangent = Normalize3(Float3((e01.x * dv2 - e02.x * dv1) * sign, (e01.y * dv2 - e02.y * dv1) * sign,
+                (e01.z * dv2 - e02.z * dv1) * sign));
+            Float3 bitangent = Normalize3(Float3((e02.x * du1 - e01.x * du2) * sign, (e02.y * du1 - e01.y * du2) * sign,
+                (e02.z * du1 - e01.z * du2) * sign));
+            faceTangents[triangle] = Float4(tangent.x, tangent.y, tangent.z, 0.0f);
+            faceBitangents[triangle] = Float4(bitangent.x, bitangent.y, bitangent.z, 0.0f);
+        }
+    }
+#endif
+
+    /** Normalized component of vector perpendicular to the unit normal, zero if there is none. w is expected to be 0. */
+    static inline Vec4 ProjectOnPlane(const Vec4& vector, const Vec4& normal)
+    {
+        Vec4 projected = vector - normal * Vec4::Splat(Vec4::Dot4(normal, vector));
+        float lengthSq = Vec4::Dot4(projected, projected);
+        return lengthSq > 1e-20f ? projected / Vec4::Splat(std::sqrt(std::max(lengthSq, 1e-20f))) : Vec4::Zero();
+    }
+
+    bool MeshProcessing::SplitPositionStream(MeshSourceData* data)
+    {
+        Vector<VertexElement>& elements = data->inputElements;
+
+        // Resolve appended offsets, the elements of a stream are repacked below
+        Vector<uint32_t> slotOffsets(data->vertexStreams.size(), 0);
+        Vector<uint32_t> offsets(elements.size(), 0);
+        uint32_t positionElement = (uint32_t)elements.size();
+        for (uint32_t iElement = 0; iElement < elements.size(); ++iElement)
+        {
+            const VertexElement& element = elements[iElement];
+            if (element.isPerInstance)
+                continue;
+
+            uint32_t elementBytes = element.Bytes();
+            if (elementBytes == 0 || element.inputSlot >= slotOffsets.size())
+            {
+                ASTEROID_LOG_WARNING_F("SplitPositionStream skipped, element %s uses an unknown format or slot.", element.semanticName);
+                return false;
+            }
+
+            uint32_t& slotOffset = slotOffsets[element.inputSlot];
+            offsets[iElement] = element.alignedByteOffset == VertexElement::kAppendAligned ? slotOffset : element.alignedByteOffset;
+            slotOffset = offsets[iElement] + elementBytes;
+
+            if (IsPosition(element))
+                positionElement = iElement;
+        }
+
+        if (positionElement == elements.size())
+        {
+            ASTEROID_LOG_WARNING("SplitPositionStream skipped, the mesh has no POSITION element.");
+            return false;
+        }
+
+        uint32_t positionSlot = elements[positionElement].inputSlot;
+        bool isInterleaved = false;
+        for (uint32_t iElement = 0; iElement < elements.size(); ++iElement)
+        {
+            const VertexElement& element = elements[iElement];
+            if (!element.isPerInstance && element.inputSlot == positionSlot && iElement != positionElement)
+                isInterleaved = true;
+        }
+        if (!isInterleaved)
+            return true;
+
+        // Copy positions out and close the gap they leave in their stream
+        const Vector<uint8_t>& source = data->vertexStreams[positionSlot];
+        uint32_t stride = data->vertexStrides[positionSlot];
+        uint32_t positionOffset = offsets[positionElement];
+        uint32_t positionBytes = elements[positionElement].Bytes();
+        uint32_t remainingStride = stride - positionBytes;
+        uint32_t verticesCount = (uint32_t)(source.size() / stride);
+
+        Vector<uint8_t> positions(verticesCount * positionBytes);
+        Vector<uint8_t> remaining(verticesCount * remainingStride);
+        for (uint32_t iVertex = 0; iVertex < verticesCount; ++iVertex)
+        {
+            const uint8_t* vertex = source.data() + iVertex * stride;
+            uint8_t* remainingVertex = remaining.data() + iVertex * remainingStride;
+            std::memcpy(positions.data() + iVertex * positionBytes, vertex + positionOffset, positionBytes);
+            std::memcpy(remainingVertex, vertex, positionOffset);
+            std::memcpy(remainingVertex + positionOffset, vertex + positionOffset + positionBytes, stride - positionOffset - positionBytes);
+        }
+
+        for (uint32_t iElement = 0; iElement < elements.size(); ++iElement)
+        {
+            VertexElement& element = elements[iElement];
+            if (element.isPerInstance)
+                continue;
+
+            if (iElement == positionElement)
+            {
+                element.inputSlot = 0;
+                element.alignedByteOffset = 0;
+                continue;
+            }
+
+            element.alignedByteOffset = offsets[iElement];
+            if (element.inputSlot == positionSlot && offsets[iElement] > positionOffset)
+                element.alignedByteOffset -= positionBytes;
+            ++element.inputSlot;
+        }
+
+        data->vertexStreams[positionSlot] = std::move(remaining);
+        data->vertexStrides[positionSlot] = remainingStride;
+        data->vertexStreams.insert(data->vertexStreams.begin(), std::move(positions));
+        data->vertexStrides.insert(data->vertexStrides.begin(), positionBytes);
+        return true;
+    }
+
+    bool MeshProcessing::ExtractPositions(const MeshSourceData& data, Vector<Float3>* positions)
+    {
+        return ExtractElement(data, "POSITION", positions);
+    }
+
+    bool MeshProcessing::ComputeSubmeshBounds(const MeshSourceData& data, Vector<SubmeshBounds>* bounds)
+    {
+        Vector<Float3> positions;
+        Vector<uint32_t> corners;
+        Vector<uint32_t> submeshCornerStarts;
+        if (!ExtractPositions(data, &positions) || !ResolveCorners(data, (uint32_t)positions.size(), &corners, &submeshCornerStarts))
+            return false;
+
+        LaneVector<Float4> padded;
+        PadPositions(positions, &padded);
+        const Float4* points = padded.data();
+
+        bounds->resize(data.submeshes.size());
+        LaneVector<Float4> batchMins, batchMaxs;
+        Vector<float> batchRadiiSq;
+        for (uint32_t iSubmesh = 0; iSubmesh < data.submeshes.size(); ++iSubmesh)
+        {
+            const uint32_t* submeshCorners = corners.data() + submeshCornerStarts[iSubmesh];
+            uint32_t cornersCount = submeshCornerStarts[iSubmesh + 1] - submeshCornerStarts[iSubmesh];
+            SubmeshBounds& submeshBounds = (*bounds)[iSubmesh];
+            if (cornersCount == 0)
+            {
+                std::memset(&submeshBounds, 0, sizeof(submeshBounds));
+                continue;
+            }
+
+            // Every batch reduces into its own slot, slots are combined in order afterwards
+            const uint32_t kCornersPerBatch = kTrianglesPerBatch * 3;
+            uint32_t batchesCount = (cornersCount + kCornersPerBatch - 1) / kCornersPerBatch;
+            batchMins.resize(batchesCount);
+            batchMaxs.resize(batchesCount);
+            batchRadiiSq.resize(batchesCount);
+            ParallelBatches(batchesCount, 1, [&](uint32_t beginBatch, uint32_t endBatch)
+            {
+                for (uint32_t iBatch = beginBatch; iBatch < endBatch; ++iBatch)
+                {
+                    uint32_t begin = iBatch * kCornersPerBatch;
+                    uint32_t end = std::min(begin + kCornersPerBatch, cornersCount);
+                    Vec4 minimum = Vec4::Load(points[submeshCorners[begin]]);
+                    Vec4 maximum = minimum;
+                    for (uint32_t iCorner = begin + 1; iCorner < end; ++iCorner)
+                    {
+                        Vec4 point = Vec4::Load(points[submeshCorners[iCorner]]);
+                        minimum = Vec4::Min(minimum, point);
+                        maximum = Vec4::Max(maximum, point);
+                    }
+                    minimum.Store(batchMins[iBatch]);
+                    maximum.Store(batchMaxs[iBatch]);
+                }
+            });
+
+            Vec4 minimum = Vec4::Load(batchMins[0]);
+            Vec4 maximum = Vec4::Load(batchMaxs[0]);
+            for (uint32_t iBatch = 1; iBatch < batchesCount; ++iBatch)
+            {
+                minimum = Vec4::Min(minimum, Vec4::Load(batchMins[iBatch]));
+                maximum = Vec4::Max(maximum, Vec4::Load(batchMaxs[iBatch]));
+            }
+            Vec4 center = (minimum + maximum) * 0.5f;
+            Vec4 extents = (maximum - minimum) * 0.5f;
+
+            // The sphere around the box center reaching the farthest vertex, tighter than enclosing the box
+            ParallelBatches(batchesCount, 1, [&](uint32_t beginBatch, uint32_t endBatch)
+            {
+                for (uint32_t iBatch = beginBatch; iBatch < endBatch; ++iBatch)
+                {
+                    uint32_t begin = iBatch * kCornersPerBatch;
+                    uint32_t end = std::min(begin + kCornersPerBatch, cornersCount);
+                    float radiusSq = 0.0f;
+                    for (uint32_t iCorner = begin; iCorner < end; ++iCorner)
+                    {
+                        Vec4 offset = Vec4::Load(points[submeshCorners[iCorner]]) - center;
+                        radiusSq = std::max(radiusSq, Vec4::Dot4(offset, offset));
+                    }
+                    batchRadiiSq[iBatch] = radiusSq;
+                }
+            });
+
+            float radiusSq = 0.0f;
+            for (float batchRadiusSq : batchRadiiSq)
+                radiusSq = std::max(radiusSq, batchRadiusSq);
+
+            center.Store(submeshBounds.center);
+            extents.Store(submeshBounds.extents);
+            submeshBounds.radius = std::sqrt(radiusSq);
+        }
+        return true;
+    }
+
+    bool MeshProcessing::ComputeNormals(const MeshSourceData& data, Vector<Float3>* normals)
+    {
+        Vector<Float3> positions;
+        Vector<uint32_t> corners;
+        if (!ExtractPositions(data, &positions) || !ResolveCorners(data, (uint32_t)positions.size(), &corners, nullptr))
+            return false;
+
+        LaneVector<Float4> padded;
+        PadPositions(positions, &padded);
+        uint32_t verticesCount = (uint32_t)positions.size();
+        uint32_t trianglesCount = (uint32_t)corners.size() / 3;
+
+        LaneVector<Float4> faceNormals(trianglesCount);
+        Vector<float> cornerAngles(corners.size());
+        ParallelBatches((trianglesCount + 3) / 4, kTrianglesPerBatch / 4, [&](uint32_t beginGroup, uint32_t endGroup)
+        {
+            ComputeFaceNormals(padded.data(), corners.data(), trianglesCount, beginGroup, endGroup, faceNormals.data(), cornerAngles.data());
+        });
+
+        // Vertices gather from their own corners, which needs no synchronization and sums in a fixed order
+        Vector<uint32_t> offsets, vertexCorners;
+        BuildVertexCorners(corners, verticesCount, &offsets, &vertexCorners);
+        normals->resize(verticesCount);
+        ParallelBatches(verticesCount, kTrianglesPerBatch, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t iVertex = begin; iVertex < end; ++iVertex)
+            {
+                Vec4 sum = Vec4::Zero();
+                for (uint32_t iCorner = offsets[iVertex]; iCorner < offsets[iVertex + 1]; ++iCorner)
+                {
+                    uint32_t corner = vertexCorners[iCorner];
+                    sum = sum + Vec4::Load(faceNormals[corner / 3]) * cornerAngles[corner];
+                }
+
+                // Vertices of no or only degenerate triangles still get a unit normal
+                float lengthSq = Vec4::Dot4(sum, sum);
+                if (lengthSq > 0.0f)
+                    (sum / Vec4::Splat(std::sqrt(std::max(lengthSq, 1e-30f)))).Store((*normals)[iVertex]);
+                else
+                    (*normals)[iVertex] = Float3(0.0f, 1.0f, 0.0f);
+            }
+        });
+        return true;
+    }
+
+    bool MeshProcessing::ComputeTangents(const MeshSourceData& data, const Vector<Float3>& normals, Vector<Float4>* tangents)
+    {
+        Vector<Float3> positions;
+        Vector<Float2> texcoords;
+        Vector<uint32_t> corners;
+        if (!ExtractPositions(data, &positions) || !ExtractElement(data, "TEXCOORD", &texcoords) ||
+            !ResolveCorners(data, (uint32_t)positions.size(), &corners, nullptr))
+            return false;
+
+        uint32_t verticesCount = (uint32_t)positions.size();
+        if (texcoords.size() != verticesCount || normals.size() != verticesCount)
+        {
+            ASTEROID_LOG_WARNING("ComputeTangents failed, positions, normals and texture coordinates differ in count.");
+            return false;
+        }
+
+        LaneVector<Float4> padded;
+        PadPositions(positions, &padded);
+        uint32_t trianglesCount = (uint32_t)corners.size() / 3;
+
+        LaneVector<Float4> faceNormals(trianglesCount);
+        LaneVector<Float4> faceTangents(trianglesCount);
+        LaneVector<Float4> faceBitangents(trianglesCount);
+        Vector<float> cornerAngles(corners.size());
+        ParallelBatches((trianglesCount + 3) / 4, kTrianglesPerBatch / 4, [&](uint32_t beginGroup, uint32_t endGroup)
+        {
+            ComputeFaceNormals(padded.data(), corners.data(), trianglesCount, beginGroup, endGroup, faceNormals.data(), cornerAngles.data());
+            ComputeFaceTangents(padded.data(), texcoords.data(), corners.data(), trianglesCount, beginGroup, endGroup,
+                faceTangents.data(), faceBitangents.data());
+        });
+
+        Vector<uint32_t> offsets, vertexCorners;
+        BuildVertexCorners(corners, verticesCount, &offsets, &vertexCorners);
+        tangents->resize(verticesCount);
+        ParallelBatches(verticesCount, kTrianglesPerBatch, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t iVertex = begin; iVertex < end; ++iVertex)
+            {
+                const Float3& n = normals[iVertex];
+                Vec4 normal = Vec4::Load(n, 0.0f);
+
+                // Like MikkTSpace, triangle tangents are projected onto the vertex normal's plane before weighting
+                Vec4 tangentSum = Vec4::Zero();
+                Vec4 bitangentSum = Vec4::Zero();
+                for (uint32_t iCorner = offsets[iVertex]; iCorner < offsets[iVertex + 1]; ++iCorner)
+                {
+                    uint32_t corner = vertexCorners[iCorner];
+                    Vec4 angle = Vec4::Splat(cornerAngles[corner]);
+                    tangentSum = tangentSum + ProjectOnPlane(Vec4::Load(faceTangents[corner / 3]), normal) * angle;
+                    bitangentSum = bitangentSum + ProjectOnPlane(Vec4::Load(faceBitangents[corner / 3]), normal) * angle;
+                }
+
+                Float3 tangent, bitangent;
+                ProjectOnPlane(tangentSum, normal).Store(tangent);
+                bitangentSum.Store(bitangent);
+                if (tangent.x == 0.0f && tangent.y == 0.0f && tangent.z == 0.0f)
+                {
+                    // No usable UV gradient, any direction perpendicular to the normal will do
+                    Vec4 axis = std::abs(n.x) < 0.9f ? Vec4::Set(1.0f, 0.0f, 0.0f, 0.0f) : Vec4::Set(0.0f, 1.0f, 0.0f, 0.0f);
+                    ProjectOnPlane(axis, normal).Store(tangent);
+                }
+
+                // The bitangent the shader reconstructs is cross(normal, tangent) * w
+                float crossX = n.y * tangent.z - n.z * tangent.y;
+                float crossY = n.z * tangent.x - n.x * tangent.z;
+                float crossZ = n.x * tangent.y - n.y * tangent.x;
+                float handedness = crossX * bitangent.x + crossY * bitangent.y + crossZ * bitangent.z < 0.0f ? -1.0f : 1.0f;
+                (*tangents)[iVertex] = Float4(tangent.x, tangent.y, tangent.z, handedness);
+            }
+        });
+        return true;
+    }
+
+    void MeshProcessing::AppendVertexStream(MeshSourceData* data, const char* semanticName, EVertexFormat format,
+        const void* elements, uint32_t elementsCount)
+    {
+        VertexElement element;
+        element.semanticName = semanticName;
+        element.semanticIndex = 0;
+        element.format = format;
+        element.inputSlot = (uint32_t)data->vertexStreams.size();
+        element.alignedByteOffset = 0;
+        element.isPerInstance = false;
+        element.instanceDataStepRate = 0;
+        uint32_t elementBytes = element.Bytes();
+        ASTEROID_ASSERT(elementBytes > 0, "AppendVertexStream needs a format of known size.");
+        data->inputElements.push_back(element);
+
+        const uint8_t* bytes = static_cast<const uint8_t*>(elements);
+        data->vertexStreams.emplace_back(bytes, bytes + (size_t)elementsCount * elementBytes);
+        data->vertexStrides.push_back(elementBytes);
+    }
+}
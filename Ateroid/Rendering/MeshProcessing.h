@@ -0,0 +1,84 @@
+#pragma once
+
+#include "MeshSourceData.h"
+#include "Math/MathTypes.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /** Bounding box and sphere of a submesh in mesh space, the sphere shares the center of the box. */
+    struct SubmeshBounds
+    {
+        Float3              center;
+        Float3              extents;
+        float               radius;
+    };
+
+
+    /**
+     *  Offline style transformations of CPU side mesh data, run before the mesh is created.
+     *  They are cheap enough to run in a MeshStreamer decode function.\n
+     *  Geometry passes are split into batches on the JobSystem if it is created and process four triangles at
+     *  a time with SSE on x86, one at a time elsewhere. Results don't depend on the numbers of threads.
+     */
+    class MeshProcessing
+    {
+    public:
+        ASTEROID_NO_DEFAULT_CTOR(MeshProcessing)
+        ASTEROID_NON_COPYABLE(MeshProcessing)
+
+        /**
+         *  Move the positions into their own tightly packed stream in slot 0.\n
+         *  Depth and shadow passes then fetch only the positions, see EVertexStreams::ePositionOnly.
+         *  Every other per-vertex stream moves up one slot, the remaining attributes of the stream the positions
+         *  came from are packed without them. Per-instance elements are left untouched.
+         *  @return
+         *      False if there is no POSITION element or the layout uses a format whose size is unknown,
+         *      the data is not modified in that case.
+         */
+        static bool SplitPositionStream(MeshSourceData* data);
+
+        /**
+         *  Copy the POSITION of every vertex out of the vertex streams, for CPU side processing of the geometry.
+         *  @return
+         *      False if there is no POSITION element or it isn't stored as 32-bit floats.
+         */
+        static bool ExtractPositions(const MeshSourceData& data, Vector<Float3>* positions);
+
+        /**
+         *  Compute the bounds of the vertices every submesh references.
+         *  @return
+         *      False if the positions can't be read or an index is out of range.
+         */
+        static bool ComputeSubmeshBounds(const MeshSourceData& data, Vector<SubmeshBounds>* bounds);
+
+        /**
+         *  Compute smooth vertex normals, the normals of the triangles around a vertex weighted by their angle
+         *  at the vertex.
+         *  @return
+         *      False if the positions can't be read or an index is out of range.
+         */
+        static bool ComputeNormals(const MeshSourceData& data, Vector<Float3>* normals);
+
+        /**
+         *  Compute tangents from the TEXCOORD derivatives following MikkTSpace conventions: per triangle tangents
+         *  are projected onto the plane of the vertex normal and weighted by angle, w holds the handedness and the
+         *  shader reconstructs the bitangent as cross(normal, tangent.xyz) * tangent.w.
+         *  @param normals
+         *      Vertex normals, e.g. from ComputeNormals.
+         *  @remarks
+         *      Vertices are not split, so meshes need distinct vertices along UV seams and mirrored UVs as
+         *      exporters usually produce.
+         *  @return
+         *      False if positions or texture coordinates can't be read or an index is out of range.
+         */
+        static bool ComputeTangents(const MeshSourceData& data, const Vector<Float3>& normals, Vector<Float4>* tangents);
+
+        /**
+         *  Add a vertex stream holding a single element in the next free slot.
+         *  @param semanticName
+         *      Must stay valid until the mesh is uploaded, see VertexElement::semanticName.
+         */
+        static void AppendVertexStream(MeshSourceData* data, const char* semanticName, EVertexFormat format,
+            const void* elements, uint32_t elementsCount);
+    };
+}
@@ -0,0 +1,598 @@
+#include "Precompile.h"
+#include "MeshProcessingBenchmark.h"
+#include "MeshProcessing.h"
+#include "Core/JobSystem.h"
+#include "Util/Debug.h"
+#include <random>
+
+namespace ASTEROID_NAMESPACE
+{
+    /** Vertices per side of a patch, the vertices of a patch stay in reach of 16-bit indices. */
+    static const uint32_t kPatchSide = 128;
+    /** Workers of the parallel runs at least, so that batches run concurrently even on small machines. */
+    static const uint32_t kMinWorkersCount = 3;
+    /** Slot of the per-instance element, which SplitPositionStream must leave alone. */
+    static const uint32_t kInstanceSlot = 3;
+
+    typedef std::chrono::steady_clock BenchmarkClock;
+
+    static double ElapsedMilliseconds(BenchmarkClock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(BenchmarkClock::now() - start).count();
+    }
+
+    /** Layout of vertex stream 0, the positions are interleaved behind the texture coordinates. */
+    struct BenchmarkVertex
+    {
+        Float2  texcoord;
+        Float3  position;
+        Float3  normal;
+    };
+    static_assert(sizeof(BenchmarkVertex) == 32, "BenchmarkVertex must match the elements of vertex stream 0.");
+
+    struct BenchmarkMesh
+    {
+        MeshSourceData          data;
+        Vector<BenchmarkVertex> vertices;
+        Vector<uint32_t>        colors;
+        /** Vertex of every triangle corner with the vertex offset of its submesh applied. */
+        Vector<uint32_t>        corners;
+        /** First corner of every submesh followed by the corners count. */
+        Vector<uint32_t>        submeshCornerStarts;
+    };
+
+    struct ProcessingResults
+    {
+        Vector<SubmeshBounds>   bounds;
+        Vector<Float3>          normals;
+        Vector<Float4>          tangents;
+        MeshSourceData          split;
+    };
+
+    /** Milliseconds per run of every function. */
+    struct ProcessingTimes
+    {
+        double  bounds;
+        double  normals;
+        double  tangents;
+        double  split;
+    };
+
+    static void GenerateMesh(uint32_t trianglesCount, uint32_t indexStride, std::mt19937& random, BenchmarkMesh* mesh)
+    {
+        std::uniform_real_distribution<float> jitter(-0.3f, 0.3f);
+        std::uniform_real_distribution<float> height(-2.0f, 2.0f);
+        const uint32_t kQuadsPerSide = kPatchSide - 1;
+        const uint32_t trianglesPerPatch = kQuadsPerSide * kQuadsPerSide * 2 + 1;
+        uint32_t patchesCount = std::max((trianglesCount + trianglesPerPatch - 1) / trianglesPerPatch, 1u);
+
+        MeshSourceData& data = mesh->data;
+        Vector<uint32_t> indices;
+        for (uint32_t iPatch = 0; iPatch < patchesCount; ++iPatch)
+        {
+            uint32_t base = (uint32_t)mesh->vertices.size();
+            for (uint32_t row = 0; row < kPatchSide; ++row)
+            {
+                for (uint32_t column = 0; column < kPatchSide; ++column)
+                {
+                    // Texture coordinates are mirrored on the second half of a patch, like on symmetric models
+                    float u = (float)column / kQuadsPerSide;
+                    BenchmarkVertex vertex;
+                    vertex.texcoord = Float2(u <= 0.5f ? u : 1.0f - u, (float)row / kQuadsPerSide);
+                    vertex.position = Float3((float)(iPatch * kPatchSide + column) + jitter(random), height(random), (float)row + jitter(random));
+                    vertex.normal = Float3(0.0f, 1.0f, 0.0f);
+                    mesh->vertices.push_back(vertex);
+                }
+            }
+
+            // Indices of 16-bit meshes are local to their patch, which the submesh vertex offset points to
+            uint32_t indexStart = (uint32_t)indices.size();
+            uint32_t indexBase = indexStride == sizeof(uint16_t) ? 0 : base;
+            for (uint32_t row = 0; row < kQuadsPerSide; ++row)
+            {
+                for (uint32_t column = 0; column < kQuadsPerSide; ++column)
+                {
+                    uint32_t v00 = row * kPatchSide + column, v01 = v00 + 1, v10 = v00 + kPatchSide, v11 = v10 + 1;
+                    for (uint32_t vertex : { v00, v10, v01, v01, v10, v11 })
+                        indices.push_back(indexBase + vertex);
+                }
+            }
+            for (uint32_t vertex : { 0u, 0u, 1u })
+                indices.push_back(indexBase + vertex);
+
+            uint32_t indicesCount = (uint32_t)indices.size() - indexStart;
+            int32_t vertexOffset = indexStride == sizeof(uint16_t) ? (int32_t)base : 0;
+            if (iPatch == 0)
+            {
+                // Two materials share the vertices of the first patch
+                uint32_t firstIndicesCount = indicesCount / 6 * 3;
+                data.submeshes.push_back({ firstIndicesCount, indexStart, vertexOffset });
+                data.submeshes.push_back({ indicesCount - firstIndicesCount, indexStart + firstIndicesCount, vertexOffset });
+            }
+            else
+            {
+                data.submeshes.push_back({ indicesCount, indexStart, vertexOffset });
+            }
+        }
+
+        // A submesh without triangles and a vertex no triangle uses
+        data.submeshes.push_back({ 0, (uint32_t)indices.size(), 0 });
+        BenchmarkVertex unused = mesh->vertices.back();
+        unused.position.y += 10.0f;
+        mesh->vertices.push_back(unused);
+
+        for (const SubmeshInfo& submesh : data.submeshes)
+        {
+            mesh->submeshCornerStarts.push_back((uint32_t)mesh->corners.size());
+            for (uint32_t iIndex = submesh.indexStart; iIndex < submesh.indexStart + submesh.indicesCount; ++iIndex)
+                mesh->corners.push_back(indices[iIndex] + submesh.vertexOffset);
+        }
+        mesh->submeshCornerStarts.push_back((uint32_t)mesh->corners.size());
+
+        data.indexStride = indexStride;
+        data.indices.resize(indices.size() * indexStride);
+        for (uint32_t iIndex = 0; iIndex < indices.size(); ++iIndex)
+        {
+            uint16_t index16 = (uint16_t)indices[iIndex];
+            std::memcpy(data.indices.data() + iIndex * indexStride, indexStride == sizeof(uint16_t) ? (const void*)&index16 : &indices[iIndex], indexStride);
+        }
+
+        mesh->colors.resize(mesh->vertices.size());
+        for (uint32_t& color : mesh->colors)
+            color = (uint32_t)random();
+
+        const uint8_t* vertexBytes = reinterpret_cast<const uint8_t*>(mesh->vertices.data());
+        const uint8_t* colorBytes = reinterpret_cast<const uint8_t*>(mesh->colors.data());
+        data.vertexStreams.emplace_back(vertexBytes, vertexBytes + mesh->vertices.size() * sizeof(BenchmarkVertex));
+        data.vertexStreams.emplace_back(colorBytes, colorBytes + mesh->colors.size() * sizeof(uint32_t));
+        data.vertexStrides = { (uint32_t)sizeof(BenchmarkVertex), (uint32_t)sizeof(uint32_t) };
+        data.inputElements = {
+            { "TEXCOORD", 0, EVertexFormat::eRG32Float, 0, 0, false, 0 },
+            { "POSITION", 0, EVertexFormat::eRGB32Float, 0, VertexElement::kAppendAligned, false, 0 },
+            { "NORMAL", 0, EVertexFormat::eRGB32Float, 0, VertexElement::kAppendAligned, false, 0 },
+            { "COLOR", 0, EVertexFormat::eRGBA8Unorm, 1, 0, false, 0 },
+            { "WORLD", 0, EVertexFormat::eRGBA32Float, kInstanceSlot, 0, true, 1 }
+        };
+    }
+
+    // The reference repeats the operations of MeshProcessing lane by lane. Builds don't contract floating point
+    // operations, so both round the same way.
+
+    /** Same result as _mm_min_ps(a, b). */
+    static float ReferenceMin(float a, float b)
+    {
+        return a < b ? a : b;
+    }
+
+    /** Same result as _mm_max_ps(a, b). */
+    static float ReferenceMax(float a, float b)
+    {
+        return a > b ? a : b;
+    }
+
+    static float ReferenceDot(const Float3& a, const Float3& b)
+    {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    static Float3 ReferenceSubtract(const Float3& a, const Float3& b)
+    {
+        return Float3(a.x - b.x, a.y - b.y, a.z - b.z);
+    }
+
+    static Float3 ReferenceNegate(const Float3& a)
+    {
+        return Float3(-a.x, -a.y, -a.z);
+    }
+
+    static Float3 ReferenceNormalize(const Float3& a)
+    {
+        float lengthSq = ReferenceDot(a, a);
+        float invLength = lengthSq > 0.0f ? 1.0f / std::sqrt(ReferenceMax(lengthSq, 1e-30f)) : 0.0f;
+        return Float3(a.x * invLength, a.y * invLength, a.z * invLength);
+    }
+
+    static float ReferenceAcos(float x)
+    {
+        float clamped = ReferenceMin(ReferenceMax(x, -1.0f), 1.0f);
+        float absX = std::abs(clamped);
+        float polynomial = -0.0187293f * absX + 0.0742610f;
+        polynomial = polynomial * absX + -0.2121144f;
+        polynomial = polynomial * absX + 1.5707288f;
+        float result = polynomial * std::sqrt(1.0f - absX);
+        return clamped < 0.0f ? 3.14159265f - result : result;
+    }
+
+    static float ReferenceAngle(const Float3& a, const Float3& b)
+    {
+        float lengthsSq = ReferenceDot(a, a) * ReferenceDot(b, b);
+        return lengthsSq > 0.0f ? ReferenceAcos(ReferenceDot(a, b) / std::sqrt(ReferenceMax(lengthsSq, 1e-30f))) : 0.0f;
+    }
+
+    static Float3 ReferenceProjectOnPlane(const Float3& vector, const Float3& normal)
+    {
+        float distance = ReferenceDot(normal, vector);
+        Float3 projected(vector.x - normal.x * distance, vector.y - normal.y * distance, vector.z - normal.z * distance);
+        float lengthSq = ReferenceDot(projected, projected);
+        if (!(lengthSq > 1e-20f))
+            return Float3(0.0f, 0.0f, 0.0f);
+        float length = std::sqrt(ReferenceMax(lengthSq, 1e-20f));
+        return Float3(projected.x / length, projected.y / length, projected.z / length);
+    }
+
+    static void ReferenceBounds(const BenchmarkMesh& mesh, Vector<SubmeshBounds>* bounds)
+    {
+        bounds->resize(mesh.submeshCornerStarts.size() - 1);
+        for (uint32_t iSubmesh = 0; iSubmesh < bounds->size(); ++iSubmesh)
+        {
+            uint32_t begin = mesh.submeshCornerStarts[iSubmesh], end = mesh.submeshCornerStarts[iSubmesh + 1];
+            SubmeshBounds& submeshBounds = (*bounds)[iSubmesh];
+            if (begin == end)
+            {
+                std::memset(&submeshBounds, 0, sizeof(submeshBounds));
+                continue;
+            }
+
+            Float3 minimum = mesh.vertices[mesh.corners[begin]].position, maximum = minimum;
+            for (uint32_t iCorner = begin + 1; iCorner < end; ++iCorner)
+            {
+                const Float3& point = mesh.vertices[mesh.corners[iCorner]].position;
+                minimum = Float3(ReferenceMin(minimum.x, point.x), ReferenceMin(minimum.y, point.y), ReferenceMin(minimum.z, point.z));
+                maximum = Float3(ReferenceMax(maximum.x, point.x), ReferenceMax(maximum.y, point.y), ReferenceMax(maximum.z, point.z));
+            }
+            submeshBounds.center = Float3((minimum.x + maximum.x) * 0.5f, (minimum.y + maximum.y) * 0.5f, (minimum.z + maximum.z) * 0.5f);
+            submeshBounds.extents = Float3((maximum.x - minimum.x) * 0.5f, (maximum.y - minimum.y) * 0.5f, (maximum.z - minimum.z) * 0.5f);
+
+            float radiusSq = 0.0f;
+            for (uint32_t iCorner = begin; iCorner < end; ++iCorner)
+            {
+                Float3 offset = ReferenceSubtract(mesh.vertices[mesh.corners[iCorner]].position, submeshBounds.center);
+                radiusSq = ReferenceMax(radiusSq, ReferenceDot(offset, offset));
+            }
+            submeshBounds.radius = std::sqrt(radiusSq);
+        }
+    }
+
+    /** Unit normal and corner angles of a triangle. */
+    static Float3 ReferenceFaceNormal(const BenchmarkMesh& mesh, uint32_t triangle, float* angles)
+    {
+        const Float3& p0 = mesh.vertices[mesh.corners[triangle * 3 + 0]].position;
+        const Float3& p1 = mesh.vertices[mesh.corners[triangle * 3 + 1]].position;
+        const Float3& p2 = mesh.vertices[mesh.corners[triangle * 3 + 2]].position;
+        Float3 e01 = ReferenceSubtract(p1, p0), e02 = ReferenceSubtract(p2, p0), e12 = ReferenceSubtract(p2, p1);
+        angles[0] = ReferenceAngle(e01, e02);
+        angles[1] = ReferenceAngle(ReferenceNegate(e01), e12);
+        angles[2] = ReferenceAngle(ReferenceNegate(e02), ReferenceNegate(e12));
+        return ReferenceNormalize(Float3(e01.y * e02.z - e01.z * e02.y, e01.z * e02.x - e01.x * e02.z, e01.x * e02.y - e01.y * e02.x));
+    }
+
+    /** Corners are visited in ascending order, which is the order MeshProcessing sums the corners of a vertex in. */
+    static void ReferenceNormals(const BenchmarkMesh& mesh, Vector<Float3>* normals)
+    {
+        Vector<Float3> sums(mesh.vertices.size(), Float3(0.0f, 0.0f, 0.0f));
+        for (uint32_t iTriangle = 0; iTriangle < mesh.corners.size() / 3; ++iTriangle)
+        {
+            float angles[3];
+            Float3 faceNormal = ReferenceFaceNormal(mesh, iTriangle, angles);
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                Float3& sum = sums[mesh.corners[iTriangle * 3 + k]];
+                sum = Float3(sum.x + faceNormal.x * angles[k], sum.y + faceNormal.y * angles[k], sum.z + faceNormal.z * angles[k]);
+            }
+        }
+
+        normals->resize(sums.size());
+        for (uint32_t iVertex = 0; iVertex < sums.size(); ++iVertex)
+        {
+            const Float3& sum = sums[iVertex];
+            float lengthSq = ReferenceDot(sum, sum);
+            float length = std::sqrt(ReferenceMax(lengthSq, 1e-30f));
+            (*normals)[iVertex] = lengthSq > 0.0f ? Float3(sum.x / length, sum.y / length, sum.z / length) : Float3(0.0f, 1.0f, 0.0f);
+        }
+    }
+
+    static void ReferenceTangents(const BenchmarkMesh& mesh, const Vector<Float3>& normals, Vector<Float4>* tangents)
+    {
+        Vector<Float3> tangentSums(mesh.vertices.size(), Float3(0.0f, 0.0f, 0.0f));
+        Vector<Float3> bitangentSums(mesh.vertices.size(), Float3(0.0f, 0.0f, 0.0f));
+        for (uint32_t iTriangle = 0; iTriangle < mesh.corners.size() / 3; ++iTriangle)
+        {
+            float angles[3];
+            ReferenceFaceNormal(mesh, iTriangle, angles);
+
+            const BenchmarkVertex& v0 = mesh.vertices[mesh.corners[iTriangle * 3 + 0]];
+            const BenchmarkVertex& v1 = mesh.vertices[mesh.corners[iTriangle * 3 + 1]];
+            const BenchmarkVertex& v2 = mesh.vertices[mesh.corners[iTriangle * 3 + 2]];
+            Float3 e01 = ReferenceSubtract(v1.position, v0.position), e02 = ReferenceSubtract(v2.position, v0.position);
+            float du1 = v1.texcoord.x - v0.texcoord.x, dv1 = v1.texcoord.y - v0.texcoord.y;
+            float du2 = v2.texcoord.x - v0.texcoord.x, dv2 = v2.texcoord.y - v0.texcoord.y;
+            float area = du1 * dv2 - du2 * dv1;
+            float sign = area < 0.0f ? -1.0f : area > 0.0f ? 1.0f : 0.0f;
+
+            Float3 tangent = ReferenceNormalize(Float3((e01.x * dv2 - e02.x * dv1) * sign, (e01.y * dv2 - e02.y * dv1) * sign,
+                (e01.z * dv2 - e02.z * dv1) * sign));
+            Float3 bitangent = ReferenceNormalize(Float3((e02.x * du1 - e01.x * du2) * sign, (e02.y * du1 - e01.y * du2) * sign,
+                (e02.z * du1 - e01.z * du2) * sign));
+            for (uint32_t k = 0; k < 3; ++k)
+            {
+                uint32_t vertex = mesh.corners[iTriangle * 3 + k];
+                Float3 projectedTangent = ReferenceProjectOnPlane(tangent, normals[vertex]);
+                Float3 projectedBitangent = ReferenceProjectOnPlane(bitangent, normals[vertex]);
+                Float3& tangentSum = tangentSums[vertex];
+                Float3& bitangentSum = bitangentSums[vertex];
+                tangentSum = Float3(tangentSum.x + projectedTangent.x * angles[k], tangentSum.y + projectedTangent.y * angles[k],
+                    tangentSum.z + projectedTangent.z * angles[k]);
+                bitangentSum = Float3(bitangentSum.x + projectedBitangent.x * angles[k], bitangentSum.y + projectedBitangent.y * angles[k],
+                    bitangentSum.z + projectedBitangent.z * angles[k]);
+            }
+        }
+
+        tangents->resize(mesh.vertices.size());
+        for (uint32_t iVertex = 0; iVertex < mesh.vertices.size(); ++iVertex)
+        {
+            const Float3& n = normals[iVertex];
+            Float3 tangent = ReferenceProjectOnPlane(tangentSums[iVertex], n);
+            if (tangent.x == 0.0f && tangent.y == 0.0f && tangent.z == 0.0f)
+                tangent = ReferenceProjectOnPlane(std::abs(n.x) < 0.9f ? Float3(1.0f, 0.0f, 0.0f) : Float3(0.0f, 1.0f, 0.0f), n);
+
+            Float3 cross(n.y * tangent.z - n.z * tangent.y, n.z * tangent.x - n.x * tangent.z, n.x * tangent.y - n.y * tangent.x);
+            float handedness = ReferenceDot(cross, bitangentSums[iVertex]) < 0.0f ? -1.0f : 1.0f;
+            (*tangents)[iVertex] = Float4(tangent.x, tangent.y, tangent.z, handedness);
+        }
+    }
+
+    /** The layout SplitPositionStream documents: positions alone in slot 0, the other vertex streams one slot up. */
+    static void ReferenceSplit(const BenchmarkMesh& mesh, MeshSourceData* split)
+    {
+        const uint32_t kRemainingStride = sizeof(Float2) + sizeof(Float3);
+        uint32_t verticesCount = (uint32_t)mesh.vertices.size();
+        Vector<uint8_t> positions(verticesCount * sizeof(Float3));
+        Vector<uint8_t> remaining(verticesCount * kRemainingStride);
+        for (uint32_t iVertex = 0; iVertex < verticesCount; ++iVertex)
+        {
+            const BenchmarkVertex& vertex = mesh.vertices[iVertex];
+            std::memcpy(positions.data() + iVertex * sizeof(Float3), &vertex.position, sizeof(Float3));
+            std::memcpy(remaining.data() + iVertex * kRemainingStride, &vertex.texcoord, sizeof(Float2));
+            std::memcpy(remaining.data() + iVertex * kRemainingStride + sizeof(Float2), &vertex.normal, sizeof(Float3));
+        }
+
+        *split = mesh.data;
+        split->vertexStreams = { positions, remaining, mesh.data.vertexStreams[1] };
+        split->vertexStrides = { (uint32_t)sizeof(Float3), kRemainingStride, (uint32_t)sizeof(uint32_t) };
+        split->inputElements = {
+            { "TEXCOORD", 0, EVertexFormat::eRG32Float, 1, 0, false, 0 },
+            { "POSITION", 0, EVertexFormat::eRGB32Float, 0, 0, false, 0 },
+            { "NORMAL", 0, EVertexFormat::eRGB32Float, 1, sizeof(Float2), false, 0 },
+            { "COLOR", 0, EVertexFormat::eRGBA8Unorm, 2, 0, false, 0 },
+            { "WORLD", 0, EVertexFormat::eRGBA32Float, kInstanceSlot, 0, true, 1 }
+        };
+    }
+
+    template<typename T>
+    static bool IsSame(const Vector<T>& a, const Vector<T>& b)
+    {
+        return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+    }
+
+    static bool IsSame(const VertexElement& a, const VertexElement& b)
+    {
+        return std::strcmp(a.semanticName, b.semanticName) == 0 && a.semanticIndex == b.semanticIndex && a.format == b.format &&
+            a.inputSlot == b.inputSlot && a.alignedByteOffset == b.alignedByteOffset && a.isPerInstance == b.isPerInstance &&
+            a.instanceDataStepRate == b.instanceDataStepRate;
+    }
+
+    static bool IsSame(const MeshSourceData& a, const MeshSourceData& b)
+    {
+        if (a.vertexStreams.size() != b.vertexStreams.size() || a.inputElements.size() != b.inputElements.size() ||
+            !IsSame(a.vertexStrides, b.vertexStrides) || !IsSame(a.indices, b.indices) || a.indexStride != b.indexStride ||
+            !IsSame(a.submeshes, b.submeshes))
+            return false;
+        for (uint32_t iStream = 0; iStream < a.vertexStreams.size(); ++iStream)
+        {
+            if (!IsSame(a.vertexStreams[iStream], b.vertexStreams[iStream]))
+                return false;
+        }
+        for (uint32_t iElement = 0; iElement < a.inputElements.size(); ++iElement)
+        {
+            if (!IsSame(a.inputElements[iElement], b.inputElements[iElement]))
+                return false;
+        }
+        return true;
+    }
+
+    static bool IsSame(const ProcessingResults& a, const ProcessingResults& b)
+    {
+        return IsSame(a.bounds, b.bounds) && IsSame(a.normals, b.normals) && IsSame(a.tangents, b.tangents) && IsSame(a.split, b.split);
+    }
+
+    /**
+     *  @return
+     *      False at the first value differing from the reference.
+     */
+    static bool CheckReference(const char* label, const ProcessingResults& results, const ProcessingResults& reference)
+    {
+        for (uint32_t iSubmesh = 0; iSubmesh < reference.bounds.size(); ++iSubmesh)
+        {
+            const SubmeshBounds& bounds = results.bounds[iSubmesh];
+            const SubmeshBounds& expected = reference.bounds[iSubmesh];
+            if (bounds.center.x != expected.center.x || bounds.center.y != expected.center.y || bounds.center.z != expected.center.z ||
+                bounds.extents.x != expected.extents.x || bounds.extents.y != expected.extents.y || bounds.extents.z != expected.extents.z ||
+                bounds.radius != expected.radius)
+            {
+                ASTEROID_LOG_ERROR_F("MeshProcessing %s: submesh %u has center (%g, %g, %g), extents (%g, %g, %g), radius %g instead of "
+                    "(%g, %g, %g), (%g, %g, %g), %g.", label, iSubmesh, bounds.center.x, bounds.center.y, bounds.center.z,
+                    bounds.extents.x, bounds.extents.y, bounds.extents.z, bounds.radius, expected.center.x, expected.center.y,
+                    expected.center.z, expected.extents.x, expected.extents.y, expected.extents.z, expected.radius);
+                return false;
+            }
+        }
+
+        for (uint32_t iVertex = 0; iVertex < reference.normals.size(); ++iVertex)
+        {
+            const Float3& normal = results.normals[iVertex];
+            const Float3& expected = reference.normals[iVertex];
+            if (normal.x != expected.x || normal.y != expected.y || normal.z != expected.z)
+            {
+                ASTEROID_LOG_ERROR_F("MeshProcessing %s: vertex %u has the normal (%.9g, %.9g, %.9g) instead of (%.9g, %.9g, %.9g).",
+                    label, iVertex, normal.x, normal.y, normal.z, expected.x, expected.y, expected.z);
+                return false;
+            }
+        }
+
+        for (uint32_t iVertex = 0; iVertex < reference.tangents.size(); ++iVertex)
+        {
+            const Float4& tangent = results.tangents[iVertex];
+            const Float4& expected = reference.tangents[iVertex];
+            if (tangent.x != expected.x || tangent.y != expected.y || tangent.z != expected.z || tangent.w != expected.w)
+            {
+                ASTEROID_LOG_ERROR_F("MeshProcessing %s: vertex %u has the tangent (%.9g, %.9g, %.9g, %g) instead of (%.9g, %.9g, %.9g, %g).",
+                    label, iVertex, tangent.x, tangent.y, tangent.z, tangent.w, expected.x, expected.y, expected.z, expected.w);
+                return false;
+            }
+        }
+
+        if (!IsSame(results.split, reference.split))
+        {
+            ASTEROID_LOG_ERROR_F("MeshProcessing %s: SplitPositionStream gives other streams or elements than the documented layout.", label);
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     *  Run every function iterationsCount times on data, results must be the same every time.
+     *  @return
+     *      False if a function failed.
+     */
+    static bool RunProcessing(const MeshSourceData& data, uint32_t iterationsCount, ProcessingResults* results, ProcessingTimes* times)
+    {
+        *times = ProcessingTimes();
+        ProcessingResults previous;
+        for (uint32_t iIteration = 0; iIteration < iterationsCount; ++iIteration)
+        {
+            BenchmarkClock::time_point start = BenchmarkClock::now();
+            bool isValid = MeshProcessing::ComputeSubmeshBounds(data, &results->bounds);
+            times->bounds += ElapsedMilliseconds(start);
+
+            start = BenchmarkClock::now();
+            isValid = MeshProcessing::ComputeNormals(data, &results->normals) && isValid;
+            times->normals += ElapsedMilliseconds(start);
+
+            start = BenchmarkClock::now();
+            isValid = MeshProcessing::ComputeTangents(data, results->normals, &results->tangents) && isValid;
+            times->tangents += ElapsedMilliseconds(start);
+
+            results->split = data;
+            start = BenchmarkClock::now();
+            isValid = MeshProcessing::SplitPositionStream(&results->split) && isValid;
+            times->split += ElapsedMilliseconds(start);
+
+            if (!isValid)
+            {
+                ASTEROID_LOG_ERROR("MeshProcessing failed on a valid mesh.");
+                return false;
+            }
+            if (iIteration > 0 && !IsSame(*results, previous))
+            {
+                ASTEROID_LOG_ERROR_F("MeshProcessing results of run %u differ from the previous run.", iIteration);
+                return false;
+            }
+            previous = *results;
+        }
+
+        times->bounds /= iterationsCount;
+        times->normals /= iterationsCount;
+        times->tangents /= iterationsCount;
+        times->split /= iterationsCount;
+        return true;
+    }
+
+    static void LogTimes(const char* label, const ProcessingTimes& times)
+    {
+        ASTEROID_LOG_INFO_F("        %-10s bounds %8.3f ms, normals %8.3f ms, tangents %8.3f ms, split %8.3f ms", label, times.bounds,
+            times.normals, times.tangents, times.split);
+    }
+
+    static bool RunMesh(uint32_t indexStride, uint32_t workersCount, const MeshProcessingBenchmarkSettings& settings)
+    {
+        std::mt19937 random(settings.seed + indexStride);
+        BenchmarkMesh mesh;
+        GenerateMesh(settings.trianglesCount, indexStride, random, &mesh);
+        ASTEROID_LOG_INFO_F("    %u-bit indices: %zu triangles in %zu submeshes, %zu vertices", indexStride * 8, mesh.corners.size() / 3,
+            mesh.data.submeshes.size(), mesh.vertices.size());
+
+        ProcessingResults reference;
+        ProcessingTimes referenceTimes;
+        BenchmarkClock::time_point start = BenchmarkClock::now();
+        ReferenceBounds(mesh, &reference.bounds);
+        referenceTimes.bounds = ElapsedMilliseconds(start);
+        start = BenchmarkClock::now();
+        ReferenceNormals(mesh, &reference.normals);
+        referenceTimes.normals = ElapsedMilliseconds(start);
+        start = BenchmarkClock::now();
+        ReferenceTangents(mesh, reference.normals, &reference.tangents);
+        referenceTimes.tangents = ElapsedMilliseconds(start);
+        start = BenchmarkClock::now();
+        ReferenceSplit(mesh, &reference.split);
+        referenceTimes.split = ElapsedMilliseconds(start);
+        LogTimes("reference", referenceTimes);
+
+        // Without a JobSystem every pass runs as a single batch on this thread
+        ProcessingResults serial;
+        ProcessingTimes times;
+        if (!RunProcessing(mesh.data, settings.iterationsCount, &serial, &times) || !CheckReference("without JobSystem", serial, reference))
+            return false;
+        LogTimes("serial", times);
+
+        // Positions read from their own stream give the same results, splitting again changes nothing
+        ProcessingResults split;
+        if (!RunProcessing(serial.split, 1, &split, &times))
+            return false;
+        if (!IsSame(split.bounds, serial.bounds) || !IsSame(split.normals, serial.normals) || !IsSame(split.tangents, serial.tangents) ||
+            !IsSame(split.split, serial.split))
+        {
+            ASTEROID_LOG_ERROR("MeshProcessing results differ once the positions are split.");
+            return false;
+        }
+
+        for (uint32_t workers : { 0u, workersCount })
+        {
+            JobSystem::Create(workers);
+            ProcessingResults parallel;
+            bool isValid = RunProcessing(mesh.data, settings.iterationsCount, &parallel, &times);
+            JobSystem::Destroy();
+            if (!isValid)
+                return false;
+            if (!IsSame(parallel, serial))
+            {
+                ASTEROID_LOG_ERROR_F("MeshProcessing results with %u workers differ from the ones without JobSystem.", workers);
+                return false;
+            }
+
+            char label[32];
+            std::snprintf(label, sizeof(label), "%u workers", workers);
+            LogTimes(label, times);
+        }
+        return true;
+    }
+
+    bool MeshProcessingBenchmark::Run(const MeshProcessingBenchmarkSettings& settings)
+    {
+        JobSystem* jobSystem = JobSystem::Singleton();
+        uint32_t previousWorkersCount = jobSystem != nullptr ? jobSystem->WorkersCount() : 0;
+        uint32_t workersCount = std::max(previousWorkersCount, kMinWorkersCount);
+        ASTEROID_LOG_INFO_F("Mesh processing benchmark: %u triangles, %u iterations, up to %u workers.", settings.trianglesCount,
+            settings.iterationsCount, workersCount);
+
+        if (jobSystem != nullptr)
+            JobSystem::Destroy();
+
+        bool isValid = true;
+        for (uint32_t indexStride : { (uint32_t)sizeof(uint16_t), (uint32_t)sizeof(uint32_t) })
+            isValid = isValid && RunMesh(indexStride, workersCount, settings);
+
+        if (jobSystem != nullptr)
+            JobSystem::Create(previousWorkersCount);
+        return isValid;
+    }
+}
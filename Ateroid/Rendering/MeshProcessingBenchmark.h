@@ -0,0 +1,36 @@
+#pragma once
+
+namespace ASTEROID_NAMESPACE
+{
+    struct MeshProcessingBenchmarkSettings
+    {
+        /** Triangles of each generated mesh, rounded up to whole patches. */
+        uint32_t    trianglesCount;
+        /** Timed runs of every function, results are checked after each of them. */
+        uint32_t    iterationsCount;
+        uint32_t    seed;
+    };
+
+
+    /**
+     *  Times MeshProcessing on terrain-like meshes made of patches with mirrored texture coordinates, once with
+     *  16-bit indices reaching the patches through submesh vertex offsets and once with 32-bit indices.
+     *  ComputeSubmeshBounds, ComputeNormals, ComputeTangents and SplitPositionStream are checked against a scalar
+     *  reference doing the same operations in the same order, which gives the same values. The results must be
+     *  bit identical without a JobSystem and with one of 0 or several workers, and after splitting the positions.
+     *  @remarks
+     *      The JobSystem singleton is recreated for the runs with workers and restored at the end.
+     */
+    class MeshProcessingBenchmark
+    {
+    public:
+        ASTEROID_NO_DEFAULT_CTOR(MeshProcessingBenchmark)
+        ASTEROID_NON_COPYABLE(MeshProcessingBenchmark)
+
+        /**
+         *  @return
+         *      False if any check failed.
+         */
+        static bool Run(const MeshProcessingBenchmarkSettings& settings);
+    };
+}
@@ -0,0 +1,158 @@
+#include "Precompile.h"
+#include "MeshRegistry.h"
+#include "Util/Hash.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    MeshRegistry* MeshRegistry::_Singleton = nullptr;
+
+    static const size_t kInitialPurgeThreshold = 64;
+
+    static void AppendBytes(const void* data, size_t bytesCount, Vector<uint8_t>* content)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        content->insert(content->end(), bytes, bytes + bytesCount);
+    }
+
+    template<typename T>
+    static void AppendValue(const T& value, Vector<uint8_t>* content)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be appended bytewise.");
+        AppendBytes(&value, sizeof(T), content);
+    }
+
+    MeshRegistry::MeshRegistry()
+        : m_PurgeThreshold(kInitialPurgeThreshold), m_AcquiresCount(0), m_SharedCount(0), m_SavedBytes(0)
+    {
+    }
+
+    SharedPtr<Mesh> MeshRegistry::Acquire(const Mesh::BufferData* verticesData,
+        uint32_t verticesDataCount,
+        const Mesh::BufferData* indicesData,
+        const SubmeshInfo* submeshes,
+        uint32_t submeshesCount,
+        const D3D11_INPUT_ELEMENT_DESC* inputElementDescs,
+        uint32_t descsCount)
+    {
+        Key key;
+        BuildKey(verticesData, verticesDataCount, indicesData, submeshes, submeshesCount, inputElementDescs, descsCount, &key);
+        uint64_t bytesCount = 0;
+        for (uint32_t iBuffer = 0; iBuffer < verticesDataCount; ++iBuffer)
+            bytesCount += verticesData[iBuffer].bytesCount;
+        if (indicesData != nullptr)
+            bytesCount += indicesData->bytesCount;
+
+        auto it = m_Meshes.find(key);
+        if (it != m_Meshes.end())
+        {
+            SharedPtr<Mesh> mesh = it->second.lock();
+            if (mesh != nullptr)
+            {
+                ++m_AcquiresCount;
+                ++m_SharedCount;
+                m_SavedBytes += bytesCount;
+                return mesh;
+            }
+        }
+
+        SharedPtr<Mesh> mesh = ASTEROID_ALLOCATE_SHARED(Mesh);
+        if (!mesh->Create(verticesData, verticesDataCount, indicesData, submeshes, submeshesCount, inputElementDescs, descsCount))
+            return nullptr;
+
+        ++m_AcquiresCount;
+        m_Meshes[std::move(key)] = mesh;
+        if (m_Meshes.size() > m_PurgeThreshold)
+        {
+            PurgeExpired();
+            m_PurgeThreshold = std::max(kInitialPurgeThreshold, m_Meshes.size() * 2);
+        }
+        return mesh;
+    }
+
+    void MeshRegistry::BuildKey(const Mesh::BufferData* verticesData,
+        uint32_t verticesDataCount,
+        const Mesh::BufferData* indicesData,
+        const SubmeshInfo* submeshes,
+        uint32_t submeshesCount,
+        const D3D11_INPUT_ELEMENT_DESC* inputElementDescs,
+        uint32_t descsCount,
+        Key* key)
+    {
+        Vector<uint8_t>& content = key->content;
+        size_t bytesCount = 0;
+        for (uint32_t iBuffer = 0; iBuffer < verticesDataCount; ++iBuffer)
+            bytesCount += verticesData[iBuffer].bytesCount;
+        if (indicesData != nullptr)
+            bytesCount += indicesData->bytesCount;
+        content.clear();
+        content.reserve(bytesCount + 256);
+
+        // Element by element, semantic names by value, since the pointers differ between callers
+        AppendValue(descsCount, &content);
+        for (uint32_t iDesc = 0; iDesc < descsCount; ++iDesc)
+        {
+            const D3D11_INPUT_ELEMENT_DESC& desc = inputElementDescs[iDesc];
+            AppendBytes(desc.SemanticName, std::strlen(desc.SemanticName) + 1, &content);
+            AppendValue(desc.SemanticIndex, &content);
+            AppendValue(desc.Format, &content);
+            AppendValue(desc.InputSlot, &content);
+            AppendValue(desc.AlignedByteOffset, &content);
+            AppendValue(desc.InputSlotClass, &content);
+            AppendValue(desc.InstanceDataStepRate, &content);
+        }
+
+        AppendValue(verticesDataCount, &content);
+        for (uint32_t iBuffer = 0; iBuffer < verticesDataCount; ++iBuffer)
+        {
+            const Mesh::BufferData& buffer = verticesData[iBuffer];
+            AppendValue(buffer.bytesStride, &content);
+            AppendValue(buffer.bytesCount, &content);
+            AppendBytes(buffer.sysMem, buffer.bytesCount, &content);
+        }
+
+        uint32_t hasIndices = indicesData != nullptr ? 1 : 0;
+        AppendValue(hasIndices, &content);
+        if (indicesData != nullptr)
+        {
+            AppendValue(indicesData->bytesStride, &content);
+            AppendValue(indicesData->bytesCount, &content);
+            AppendBytes(indicesData->sysMem, indicesData->bytesCount, &content);
+        }
+
+        AppendValue(submeshesCount, &content);
+        for (uint32_t iSubmesh = 0; iSubmesh < submeshesCount; ++iSubmesh)
+        {
+            AppendValue(submeshes[iSubmesh].indicesCount, &content);
+            AppendValue(submeshes[iSubmesh].indexStart, &content);
+            AppendValue(submeshes[iSubmesh].vertexOffset, &content);
+        }
+
+        key->hash = Hash::Bytes(content.data(), content.size());
+    }
+
+    MeshRegistry::Stats MeshRegistry::GetStats() const
+    {
+        Stats stats;
+        stats.acquiresCount = m_AcquiresCount;
+        stats.sharedCount = m_SharedCount;
+        stats.uniqueCount = 0;
+        for (const auto& entry : m_Meshes)
+        {
+            if (!entry.second.expired())
+                ++stats.uniqueCount;
+        }
+        stats.savedBytes = m_SavedBytes;
+        return stats;
+    }
+
+    void MeshRegistry::PurgeExpired()
+    {
+        for (auto it = m_Meshes.begin(); it != m_Meshes.end();)
+        {
+            if (it->second.expired())
+                it = m_Meshes.erase(it);
+            else
+                ++it;
+        }
+    }
+}
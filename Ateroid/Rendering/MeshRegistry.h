@@ -0,0 +1,120 @@
+#pragma once
+
+#include "Mesh.h"
+#include "Util/Containers.h"
+#include "Util/Pointers.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  Deduplicates meshes created from identical data.\n
+     *  The vertex data, index data, submeshes and vertex layout are hashed, and acquiring a mesh whose content
+     *  matches a live one returns the live mesh instead of creating new GPU buffers.
+     *  @remarks
+     *      Meshes are shared by reference counting, an entry goes away with the last reference.
+     *      Entries keep a copy of the content they were created from, and a mesh is only shared when the content
+     *      is equal byte for byte, so hash collisions never return the wrong mesh. This doubles the system memory
+     *      of live registered meshes.
+     */
+    class MeshRegistry
+    {
+    public:
+        struct Stats
+        {
+            /** Numbers of successful Acquire calls. */
+            uint32_t    acquiresCount;
+            /** Numbers of Acquire calls answered with an existing mesh. */
+            uint32_t    sharedCount;
+            /** Numbers of live unique meshes. */
+            uint32_t    uniqueCount;
+            /** Buffer bytes that were not uploaded thanks to sharing. */
+            uint64_t    savedBytes;
+        };
+
+    public:
+        ASTEROID_NON_COPYABLE(MeshRegistry)
+
+        /**
+         *  Create the MeshRegistry singleton.
+         */
+        static MeshRegistry* Create()
+        {
+            ASTEROID_ASSERT(_Singleton == nullptr, "There is already a MeshRegistry singleton created.");
+            _Singleton = ASTEROID_NEW MeshRegistry();
+            return _Singleton;
+        }
+
+        /**
+         *  Destroy the MeshRegistry singleton. Acquired meshes stay valid.
+         */
+        static void Destroy()
+        {
+            ASTEROID_DELETE _Singleton;
+            _Singleton = nullptr;
+        }
+
+        /**
+         *  Current created singleton.
+         *  @return
+         *      Instance of current created singleton. nullptr if no instance created or singleton was destroyed.
+         */
+        static MeshRegistry* Singleton() { return _Singleton; }
+
+        /**
+         *  Get a mesh with the given content, creating it only if no live mesh has the same content.
+         *  Parameters are the same as Mesh::Create.
+         *  @return
+         *      The shared mesh, nullptr if creating it failed.
+         */
+        SharedPtr<Mesh> Acquire(const Mesh::BufferData* verticesData,
+            uint32_t verticesDataCount,
+            const Mesh::BufferData* indicesData,
+            const SubmeshInfo* submeshes,
+            uint32_t submeshesCount,
+            const D3D11_INPUT_ELEMENT_DESC* inputElementDescs,
+            uint32_t descsCount);
+
+        Stats GetStats() const;
+
+    private:
+        struct Key
+        {
+            uint64_t        hash;
+            /** Vertex layout, buffer strides, sizes and bytes, and submeshes, one after the other. */
+            Vector<uint8_t> content;
+
+            bool operator==(const Key& other) const { return hash == other.hash && content == other.content; }
+        };
+
+        struct KeyHasher
+        {
+            size_t operator()(const Key& key) const { return (size_t)key.hash; }
+        };
+
+        MeshRegistry();
+
+        /** Serialize everything that makes two meshes the same into key->content and hash it. */
+        static void BuildKey(const Mesh::BufferData* verticesData,
+            uint32_t verticesDataCount,
+            const Mesh::BufferData* indicesData,
+            const SubmeshInfo* submeshes,
+            uint32_t submeshesCount,
+            const D3D11_INPUT_ELEMENT_DESC* inputElementDescs,
+            uint32_t descsCount,
+            Key* key);
+
+        /** Remove the entries of meshes that were destroyed. */
+        void PurgeExpired();
+
+    private:
+        static MeshRegistry* _Singleton;
+
+    private:
+        UnorderedMap<Key, WeakPtr<Mesh>, KeyHasher>    m_Meshes;
+        /** m_Meshes is purged when it grows beyond this size. */
+        size_t                                          m_PurgeThreshold;
+        uint32_t                                        m_AcquiresCount;
+        uint32_t                                        m_SharedCount;
+        uint64_t                                        m_SavedBytes;
+    };
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "RenderBackend.h"
+#include "Util/Containers.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  CPU side data of a mesh, filled by a decode function on a worker thread.
+     */
+    struct MeshSourceData
+    {
+        Vector<Vector<uint8_t>>     vertexStreams;
+        Vector<uint32_t>            vertexStrides;
+        Vector<uint8_t>             indices;
+        uint32_t                    indexStride;
+        Vector<SubmeshInfo>         submeshes;
+        Vector<VertexElement>       inputElements;
+
+        MeshSourceData() : indexStride(sizeof(uint32_t)) {}
+
+        /** Bytes uploaded to the GPU when the mesh is created. */
+        uint32_t UploadBytes() const
+        {
+            uint32_t bytesCount = (uint32_t)indices.size();
+            for (const Vector<uint8_t>& stream : vertexStreams)
+                bytesCount += (uint32_t)stream.size();
+            return bytesCount;
+        }
+    };
+}
@@ -0,0 +1,186 @@
+#include "Precompile.h"
+#include "MeshStreamer.h"
+#include "MeshRegistry.h"
+#include "RenderSystem.h"
+#include "Util/Debug.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    MeshStreamer::MeshStreamer(uint32_t uploadBytesPerFrame, uint32_t maxDecodesInFlight)
+        : m_UploadBytesPerFrame(uploadBytesPerFrame), m_MaxDecodesInFlight(std::max(maxDecodesInFlight, 1u)),
+        m_LastUploadBytes(0), m_DecodesInFlight(0)
+    {
+    }
+
+    MeshStreamer::~MeshStreamer()
+    {
+        // Decode jobs hold their request alive, but must not outlive the counter they decrement.
+        JobSystem::Singleton()->Wait(&m_DecodeJobs);
+    }
+
+    MeshStreamer::Handle MeshStreamer::Request(const DecodeFunction& decode, ObjectInstanceID placeholder, const Float3& position)
+    {
+        SharedPtr<StreamRequest> request = ASTEROID_ALLOCATE_SHARED(StreamRequest);
+        request->decode = decode;
+        request->placeholder = placeholder;
+        request->position = position;
+
+        Handle handle;
+        if (!m_FreeHandles.empty())
+        {
+            handle = m_FreeHandles.back();
+            m_FreeHandles.pop_back();
+            m_Requests[handle] = request;
+        }
+        else
+        {
+            handle = (Handle)m_Requests.size();
+            m_Requests.push_back(request);
+        }
+        return handle;
+    }
+
+    void MeshStreamer::Release(Handle handle)
+    {
+        // A running decode job keeps its own reference, its result is simply dropped.
+        m_Requests[handle] = nullptr;
+        m_FreeHandles.push_back(handle);
+    }
+
+    void MeshStreamer::SetPosition(Handle handle, const Float3& position)
+    {
+        m_Requests[handle]->position = position;
+    }
+
+    void MeshStreamer::Update(const Float3& cameraPosition)
+    {
+        Vector<Handle> handles;
+
+        // Start decoding the nearest queued requests
+        uint32_t decodesInFlight = m_DecodesInFlight.load(std::memory_order_acquire);
+        if (decodesInFlight < m_MaxDecodesInFlight)
+        {
+            SortedRequests(EState::eQueued, cameraPosition, &handles);
+            uint32_t startCount = std::min((uint32_t)handles.size(), m_MaxDecodesInFlight - decodesInFlight);
+            for (uint32_t iHandle = 0; iHandle < startCount; ++iHandle)
+            {
+                SharedPtr<StreamRequest> request = m_Requests[handles[iHandle]];
+                request->state.store(EState::eDecoding, std::memory_order_relaxed);
+                m_DecodesInFlight.fetch_add(1, std::memory_order_relaxed);
+                JobSystem::Singleton()->Schedule([this, request]()
+                {
+                    bool decoded = request->decode(&request->data);
+                    request->state.store(decoded ? EState::eDecoded : EState::eFailed, std::memory_order_release);
+                    m_DecodesInFlight.fetch_sub(1, std::memory_order_release);
+                }, &m_DecodeJobs);
+            }
+        }
+
+        // Upload the nearest decoded requests until the budget is spent
+        m_LastUploadBytes = 0;
+        SortedRequests(EState::eDecoded, cameraPosition, &handles);
+        for (Handle handle : handles)
+        {
+            StreamRequest* request = m_Requests[handle].get();
+            uint32_t uploadBytes = request->data.UploadBytes();
+            if (m_LastUploadBytes > 0 && m_LastUploadBytes + uploadBytes > m_UploadBytesPerFrame)
+                break;
+
+            request->state.store(Upload(request) ? EState::eResident : EState::eFailed, std::memory_order_relaxed);
+            // The CPU copy is not needed any longer
+            request->data = MeshSourceData();
+            m_LastUploadBytes += uploadBytes;
+        }
+    }
+
+    ObjectInstanceID MeshStreamer::Resolve(Handle handle) const
+    {
+        const StreamRequest* request = m_Requests[handle].get();
+        if (request->state.load(std::memory_order_relaxed) == EState::eResident)
+            return request->mesh->InstanceId();
+        return request->placeholder;
+    }
+
+    uint32_t MeshStreamer::PendingCount() const
+    {
+        uint32_t count = 0;
+        for (const SharedPtr<StreamRequest>& request : m_Requests)
+        {
+            if (request == nullptr)
+                continue;
+
+            EState state = request->state.load(std::memory_order_relaxed);
+            if (state != EState::eResident && state != EState::eFailed)
+                ++count;
+        }
+        return count;
+    }
+
+    void MeshStreamer::SortedRequests(EState state, const Float3& cameraPosition, Vector<Handle>* handles) const
+    {
+        typedef std::pair<float, Handle> DistanceHandle;
+        Vector<DistanceHandle> sorted;
+        for (Handle handle = 0; handle < (Handle)m_Requests.size(); ++handle)
+        {
+            const StreamRequest* request = m_Requests[handle].get();
+            if (request == nullptr || request->state.load(std::memory_order_acquire) != state)
+                continue;
+
+            float dx = request->position.x - cameraPosition.x;
+            float dy = request->position.y - cameraPosition.y;
+            float dz = request->position.z - cameraPosition.z;
+            sorted.push_back(std::make_pair(dx * dx + dy * dy + dz * dz, handle));
+        }
+        std::sort(sorted.begin(), sorted.end());
+
+        handles->clear();
+        for (const DistanceHandle& entry : sorted)
+            handles->push_back(entry.second);
+    }
+
+    bool MeshStreamer::Upload(StreamRequest* request)
+    {
+        MeshSourceData& data = request->data;
+
+        Vector<Mesh::BufferData> vertexBuffers(data.vertexStreams.size());
+        for (size_t iStream = 0; iStream < data.vertexStreams.size(); ++iStream)
+        {
+            vertexBuffers[iStream].sysMem = data.vertexStreams[iStream].data();
+            vertexBuffers[iStream].bytesCount = (uint32_t)data.vertexStreams[iStream].size();
+            vertexBuffers[iStream].bytesStride = data.vertexStrides[iStream];
+        }
+
+        Mesh::BufferData indexBuffer;
+        indexBuffer.sysMem = data.indices.data();
+        indexBuffer.bytesCount = (uint32_t)data.indices.size();
+        indexBuffer.bytesStride = data.indexStride;
+
+        const Mesh::BufferData* indexData = data.indices.empty() ? nullptr : &indexBuffer;
+        Vector<D3D11_INPUT_ELEMENT_DESC> inputElementDescs(data.inputElements.size());
+        for (size_t iElement = 0; iElement < data.inputElements.size(); ++iElement)
+            inputElementDescs[iElement] = RenderSystem::ToInputElementDesc(data.inputElements[iElement]);
+
+        MeshRegistry* registry = MeshRegistry::Singleton();
+        if (registry != nullptr)
+        {
+            // Streamed variants often share their content, those share one mesh
+            request->mesh = registry->Acquire(vertexBuffers.data(), (uint32_t)vertexBuffers.size(), indexData,
+                data.submeshes.data(), (uint32_t)data.submeshes.size(),
+                inputElementDescs.data(), (uint32_t)inputElementDescs.size());
+        }
+        else
+        {
+            request->mesh = ASTEROID_ALLOCATE_SHARED(Mesh);
+            if (!request->mesh->Create(vertexBuffers.data(), (uint32_t)vertexBuffers.size(), indexData,
+                data.submeshes.data(), (uint32_t)data.submeshes.size(),
+                inputElementDescs.data(), (uint32_t)inputElementDescs.size()))
+            {
+                request->mesh = nullptr;
+            }
+        }
+
+        if (request->mesh == nullptr)
+            ASTEROID_LOG_ERROR_F("MeshStreamer failed to create a mesh of %u bytes.", data.UploadBytes());
+        return request->mesh != nullptr;
+    }
+}
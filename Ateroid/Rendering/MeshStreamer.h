@@ -0,0 +1,120 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include "Mesh.h"
+#include "MeshSourceData.h"
+#include "Core/JobSystem.h"
+#include "Math/MathTypes.h"
+#include "Util/Containers.h"
+#include "Util/Pointers.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  Loads meshes in the background and uploads them within a per-frame byte budget.\n
+     *  Decoding runs on the JobSystem, uploading happens in Update on the thread owning the render system.
+     *  Both are ordered by the distance of the requests to the camera, and a placeholder mesh is drawn until
+     *  the requested mesh is resident.
+     *  @remarks
+     *      Usage: Request a mesh, call Update once per frame and draw whatever Resolve returns.
+     */
+    class MeshStreamer
+    {
+    public:
+        typedef uint32_t Handle;
+        /** Fill the source data, return false if the mesh couldn't be decoded. Runs on a worker thread. */
+        typedef std::function<bool(MeshSourceData* data)> DecodeFunction;
+
+        static const Handle kInvalidHandle = 0xFFFFFFFF;
+
+        enum class EState
+        {
+            eQueued,
+            eDecoding,
+            eDecoded,
+            eResident,
+            eFailed
+        };
+
+    public:
+        /**
+         *  @param uploadBytesPerFrame
+         *      Bytes uploaded by Update per frame. A mesh larger than the budget is uploaded alone in a frame.
+         *  @param maxDecodesInFlight
+         *      Numbers of decode jobs running at the same time. Keeping it small lets nearer requests made
+         *      later overtake farther ones.
+         */
+        MeshStreamer(uint32_t uploadBytesPerFrame, uint32_t maxDecodesInFlight);
+        ~MeshStreamer();
+
+        ASTEROID_NON_COPYABLE(MeshStreamer)
+
+        /**
+         *  Request a mesh to be streamed in.
+         *  @param placeholder
+         *      Mesh drawn until the requested one is resident, usually a coarse LOD that stays loaded.
+         *  @param position
+         *      World position used to prioritize the request.
+         */
+        Handle Request(const DecodeFunction& decode, ObjectInstanceID placeholder, const Float3& position);
+
+        /**
+         *  Destroy the mesh of a request, or cancel it if it isn't resident yet.
+         */
+        void Release(Handle handle);
+
+        /** Update the position a request is prioritized by. */
+        void SetPosition(Handle handle, const Float3& position);
+
+        /**
+         *  Start decoding the nearest queued requests and upload the nearest decoded ones within the budget.
+         */
+        void Update(const Float3& cameraPosition);
+
+        /**
+         *  Mesh to draw for a request.
+         *  @return
+         *      The streamed mesh if it is resident, the placeholder otherwise.
+         */
+        ObjectInstanceID Resolve(Handle handle) const;
+
+        EState State(Handle handle) const { return m_Requests[handle]->state.load(std::memory_order_acquire); }
+
+        void SetUploadBudget(uint32_t uploadBytesPerFrame) { m_UploadBytesPerFrame = uploadBytesPerFrame; }
+        uint32_t UploadBudget() const { return m_UploadBytesPerFrame; }
+
+        /** Bytes uploaded by the last Update. */
+        uint32_t LastUploadBytes() const { return m_LastUploadBytes; }
+
+        /** Numbers of requests that are not resident or failed yet. */
+        uint32_t PendingCount() const;
+
+    private:
+        struct StreamRequest
+        {
+            DecodeFunction          decode;
+            ObjectInstanceID        placeholder;
+            Float3                  position;
+            std::atomic<EState>     state;
+            MeshSourceData          data;
+            SharedPtr<Mesh>         mesh;
+
+            StreamRequest() : state(EState::eQueued) {}
+        };
+
+        /** Indices of live requests in a given state, nearest to the camera first. */
+        void SortedRequests(EState state, const Float3& cameraPosition, Vector<Handle>* handles) const;
+        bool Upload(StreamRequest* request);
+
+    private:
+        uint32_t                            m_UploadBytesPerFrame;
+        uint32_t                            m_MaxDecodesInFlight;
+        uint32_t                            m_LastUploadBytes;
+        std::atomic<uint32_t>               m_DecodesInFlight;
+        JobCounter                          m_DecodeJobs;
+        /** Released slots are nullptr and reused by later requests. */
+        Vector<SharedPtr<StreamRequest>>    m_Requests;
+        Vector<Handle>                      m_FreeHandles;
+    };
+}
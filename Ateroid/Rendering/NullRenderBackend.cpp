@@ -0,0 +1,102 @@
+#include "Precompile.h"
+#include "NullRenderBackend.h"
+#include "Util/Debug.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    NullRenderBackend::NullRenderBackend(uint32_t instanceStreamBytes)
+        : m_InstanceStream(instanceStreamBytes, 0), m_InstanceBytesWritten(0), m_UploadRingMapped(false),
+        m_SignaledFence(0), m_CompletedFence(0), m_FenceLatency(2), m_TransientHeapBytes(0),
+        m_PresentsCount(0)
+    {
+    }
+
+    bool NullRenderBackend::CopyToInstanceStream(uint32_t byteOffset, uint32_t uploadOffset, uint32_t bytesCount)
+    {
+        ASTEROID_ASSERT(!m_UploadRingMapped, "Copying from the upload ring while it is mapped.");
+        if ((uint64_t)byteOffset + bytesCount > m_InstanceStream.size() || (uint64_t)uploadOffset + bytesCount > m_UploadRing.size())
+            return false;
+
+        std::memcpy(m_InstanceStream.data() + byteOffset, m_UploadRing.data() + uploadOffset, bytesCount);
+        m_InstanceBytesWritten += bytesCount;
+        return true;
+    }
+
+    void NullRenderBackend::DrawIndexedInstanced(const InstancedDraw& draw)
+    {
+        m_Draws.push_back(draw);
+    }
+
+    bool NullRenderBackend::CreateUploadRing(uint32_t bytesCount)
+    {
+        ASTEROID_ASSERT(!m_UploadRingMapped, "Recreating the upload ring while it is mapped.");
+        m_UploadRing.assign(bytesCount, 0);
+        return true;
+    }
+
+    uint8_t* NullRenderBackend::MapUploadRing()
+    {
+        ASTEROID_ASSERT(!m_UploadRingMapped, "The upload ring is already mapped.");
+        m_UploadRingMapped = !m_UploadRing.empty();
+        return m_UploadRingMapped ? m_UploadRing.data() : nullptr;
+    }
+
+    void NullRenderBackend::UnmapUploadRing()
+    {
+        m_UploadRingMapped = false;
+    }
+
+    uint64_t NullRenderBackend::SignalFence()
+    {
+        ++m_SignaledFence;
+        if (m_SignaledFence > m_FenceLatency)
+            m_CompletedFence = std::max(m_CompletedFence, m_SignaledFence - m_FenceLatency);
+        return m_SignaledFence;
+    }
+
+    uint64_t NullRenderBackend::CompletedFence()
+    {
+        return m_CompletedFence;
+    }
+
+    uint64_t NullRenderBackend::TransientTextureBytes(const TransientTextureDesc& desc, uint64_t* alignment)
+    {
+        // Mimic the 64KB placement alignment of GPU heaps, so aliasing savings come out realistic.
+        const uint64_t kPlacementAlignment = 64 * 1024;
+        *alignment = kPlacementAlignment;
+        uint64_t bytesCount = desc.Bytes();
+        return (bytesCount + kPlacementAlignment - 1) / kPlacementAlignment * kPlacementAlignment;
+    }
+
+    bool NullRenderBackend::ReserveTransientHeap(uint64_t bytesCount)
+    {
+        m_TransientHeapBytes = std::max(m_TransientHeapBytes, bytesCount);
+        m_TransientTextures.clear();
+        return true;
+    }
+
+    uint32_t NullRenderBackend::AcquireTransientTexture(const TransientTextureDesc& desc, uint64_t heapOffset)
+    {
+        TransientTextureRecord record = { desc, heapOffset };
+        m_TransientTextures.push_back(record);
+        return (uint32_t)m_TransientTextures.size() - 1;
+    }
+
+    void NullRenderBackend::Barrier(const ResourceBarrier& barrier)
+    {
+        m_Barriers.push_back(barrier);
+    }
+
+    bool NullRenderBackend::Present()
+    {
+        ++m_PresentsCount;
+        return true;
+    }
+
+    void NullRenderBackend::ClearRecords()
+    {
+        m_Draws.clear();
+        m_Barriers.clear();
+        m_InstanceBytesWritten = 0;
+    }
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "RenderBackend.h"
+#include "Util/Containers.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  A RenderBackend without any graphics API behind it.\n
+     *  It keeps a CPU copy of the instance stream and records every command it receives, so rendering code
+     *  can be validated and measured without a GPU.\n
+     *  Fences are emulated by a GPU that lags a fixed numbers of fences behind, see SetFenceLatency.
+     */
+    class NullRenderBackend : public RenderBackend
+    {
+    public:
+        /**
+         *  @param instanceStreamBytes
+         *      Size of the emulated instance stream.
+         */
+        explicit NullRenderBackend(uint32_t instanceStreamBytes);
+
+        ASTEROID_NON_COPYABLE(NullRenderBackend)
+
+        virtual bool CopyToInstanceStream(uint32_t byteOffset, uint32_t uploadOffset, uint32_t bytesCount) override;
+        virtual void DrawIndexedInstanced(const InstancedDraw& draw) override;
+        virtual bool CreateUploadRing(uint32_t bytesCount) override;
+        virtual uint8_t* MapUploadRing() override;
+        virtual void UnmapUploadRing() override;
+        virtual uint64_t SignalFence() override;
+        virtual uint64_t CompletedFence() override;
+        virtual uint64_t TransientTextureBytes(const TransientTextureDesc& desc, uint64_t* alignment) override;
+        virtual bool ReserveTransientHeap(uint64_t bytesCount) override;
+        virtual uint32_t AcquireTransientTexture(const TransientTextureDesc& desc, uint64_t heapOffset) override;
+        virtual void Barrier(const ResourceBarrier& barrier) override;
+        virtual bool Present() override;
+
+        /**
+         *  Set how many fences the emulated GPU lags behind. A fence completes when this many newer fences
+         *  are signaled, 0 completes every fence right away.
+         */
+        void SetFenceLatency(uint32_t fencesCount) { m_FenceLatency = fencesCount; }
+
+        /** Let the emulated GPU catch up with every signaled fence. */
+        void CompleteFences() { m_CompletedFence = m_SignaledFence; }
+
+        /** Forget every recorded command. The instance stream content is kept. */
+        void ClearRecords();
+
+        const Vector<InstancedDraw>& RecordedDraws() const { return m_Draws; }
+        const Vector<uint8_t>& InstanceStream() const { return m_InstanceStream; }
+        const Vector<uint8_t>& UploadRingContent() const { return m_UploadRing; }
+        bool IsUploadRingMapped() const { return m_UploadRingMapped; }
+
+        struct TransientTextureRecord
+        {
+            TransientTextureDesc    desc;
+            uint64_t                heapOffset;
+        };
+
+        /** Transient textures acquired since the last ReserveTransientHeap, indexed by texture id. */
+        const Vector<TransientTextureRecord>& TransientTextures() const { return m_TransientTextures; }
+        const Vector<ResourceBarrier>& RecordedBarriers() const { return m_Barriers; }
+        /** Largest transient heap reserved so far. */
+        uint64_t TransientHeapBytes() const { return m_TransientHeapBytes; }
+
+        /** Numbers of bytes written to the instance stream since the last ClearRecords. */
+        uint64_t InstanceBytesWritten() const { return m_InstanceBytesWritten; }
+
+        /** Numbers of frames presented since the backend was created. */
+        uint64_t PresentsCount() const { return m_PresentsCount; }
+
+    private:
+        Vector<uint8_t>         m_InstanceStream;
+        Vector<InstancedDraw>   m_Draws;
+        uint64_t                m_InstanceBytesWritten;
+        Vector<uint8_t>         m_UploadRing;
+        bool                    m_UploadRingMapped;
+        uint64_t                m_SignaledFence;
+        uint64_t                m_CompletedFence;
+        uint32_t                m_FenceLatency;
+        Vector<TransientTextureRecord> m_TransientTextures;
+        Vector<ResourceBarrier> m_Barriers;
+        uint64_t                m_TransientHeapBytes;
+        uint64_t                m_PresentsCount;
+    };
+}
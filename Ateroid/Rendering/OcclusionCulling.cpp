@@ -0,0 +1,399 @@
+#include "Precompile.h"
+#include "OcclusionCulling.h"
+#include "FrustumCulling.h"
+#include "Core/JobSystem.h"
+#include "Math/SimdMath.h"
+#include "Util/Debug.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ASTEROID_OCCLUSION_CULLING_SSE
+#include <immintrin.h>
+#endif
+
+namespace ASTEROID_NAMESPACE
+{
+    /** Clip space w below which a vertex is treated as crossing the near plane. */
+    static const float kMinClipW = 1e-5f;
+    /** Maximum numbers of hierarchy texels tested per axis for a single object. */
+    static const uint32_t kMaxTestTexels = 4;
+
+    OcclusionCuller::OcclusionCuller(uint32_t width, uint32_t height)
+        : m_TilesCountX((width + kTileSize - 1) / kTileSize)
+        , m_TilesCountY((height + kTileSize - 1) / kTileSize)
+    {
+        ASTEROID_ASSERT(m_TilesCountX > 0 && m_TilesCountY > 0, "Occlusion depth buffer must not be empty.");
+
+        uint32_t tilesCount = m_TilesCountX * m_TilesCountY;
+        m_TileBins.resize(tilesCount);
+        m_Depth.resize(tilesCount * kTileSize * kTileSize, 1.0f);
+
+        uint32_t levelWidth = m_TilesCountX;
+        uint32_t levelHeight = m_TilesCountY;
+        for (;;)
+        {
+            m_Hierarchy.emplace_back(levelWidth * levelHeight, 1.0f);
+            m_HierarchyWidth.push_back(levelWidth);
+            m_HierarchyHeight.push_back(levelHeight);
+            if (levelWidth == 1 && levelHeight == 1)
+                break;
+            levelWidth = (levelWidth + 1) / 2;
+            levelHeight = (levelHeight + 1) / 2;
+        }
+    }
+
+    void OcclusionCuller::BeginFrame(const Float4x4& viewProjection)
+    {
+        m_ViewProjection = viewProjection;
+        m_Triangles.clear();
+        for (Vector<uint32_t>& bin : m_TileBins)
+            bin.clear();
+    }
+
+    void OcclusionCuller::AddOccluder(const Float3* positions,
+        uint32_t verticesCount,
+        const uint32_t* indices,
+        uint32_t indicesCount,
+        const Float4x4& world)
+    {
+        Mat4 worldViewProjection = Mat4::Multiply(Mat4::Load(world), Mat4::Load(m_ViewProjection));
+
+        const float width = (float)Width();
+        const float height = (float)Height();
+
+        // Transform every vertex to screen space once, w <= 0 marks vertices crossing the near plane.
+        m_ScreenVertices.resize(verticesCount);
+        Vector<Float4>& screen = m_ScreenVertices;
+        for (uint32_t iVertex = 0; iVertex < verticesCount; ++iVertex)
+        {
+            const Float3& p = positions[iVertex];
+            Float4 clip;
+            Mat4::TransformPoint(Vec4::Load(p, 1.0f), worldViewProjection).Store(clip);
+
+            Float4& s = screen[iVertex];
+            if (clip.w < kMinClipW || clip.z < 0.0f)
+            {
+                s.w = 0.0f;
+                continue;
+            }
+            float invW = 1.0f / clip.w;
+            s.x = (clip.x * invW * 0.5f + 0.5f) * width;
+            s.y = (0.5f - clip.y * invW * 0.5f) * height;
+            s.z = clip.z * invW;
+            s.w = 1.0f;
+        }
+
+        for (uint32_t i = 0; i + 2 < indicesCount; i += 3)
+        {
+            const Float4& v0 = screen[indices[i]];
+            const Float4& v1 = screen[indices[i + 1]];
+            const Float4& v2 = screen[indices[i + 2]];
+            if (v0.w == 0.0f || v1.w == 0.0f || v2.w == 0.0f)
+                continue;
+
+            float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+            if (std::abs(area) < 1e-6f)
+                continue;
+
+            float minX = std::max(std::min(std::min(v0.x, v1.x), v2.x), 0.0f);
+            float maxX = std::min(std::max(std::max(v0.x, v1.x), v2.x), width - 1.0f);
+            float minY = std::max(std::min(std::min(v0.y, v1.y), v2.y), 0.0f);
+            float maxY = std::min(std::max(std::max(v0.y, v1.y), v2.y), height - 1.0f);
+            if (minX > maxX || minY > maxY)
+                continue;
+
+            // Orient the edges so that inside is positive regardless of the winding.
+            float sign = area > 0.0f ? 1.0f : -1.0f;
+            const Float4* v[3] = { &v0, &v1, &v2 };
+            TriangleSetup setup;
+            for (int iEdge = 0; iEdge < 3; ++iEdge)
+            {
+                const Float4& a = *v[iEdge];
+                const Float4& b = *v[(iEdge + 1) % 3];
+                setup.edgeA[iEdge] = (a.y - b.y) * sign;
+                setup.edgeB[iEdge] = (b.x - a.x) * sign;
+                setup.edgeC[iEdge] = (a.x * b.y - b.x * a.y) * sign;
+            }
+
+            float invArea = 1.0f / area;
+            setup.depthA = ((v1.z - v0.z) * (v2.y - v0.y) - (v2.z - v0.z) * (v1.y - v0.y)) * invArea;
+            setup.depthB = ((v2.z - v0.z) * (v1.x - v0.x) - (v1.z - v0.z) * (v2.x - v0.x)) * invArea;
+            setup.depthC = v0.z - setup.depthA * v0.x - setup.depthB * v0.y;
+
+            uint32_t triangleIndex = (uint32_t)m_Triangles.size();
+            m_Triangles.push_back(setup);
+
+            uint32_t tileMinX = (uint32_t)minX / kTileSize;
+            uint32_t tileMaxX = (uint32_t)maxX / kTileSize;
+            uint32_t tileMinY = (uint32_t)minY / kTileSize;
+            uint32_t tileMaxY = (uint32_t)maxY / kTileSize;
+            for (uint32_t tileY = tileMinY; tileY <= tileMaxY; ++tileY)
+            {
+                for (uint32_t tileX = tileMinX; tileX <= tileMaxX; ++tileX)
+                    m_TileBins[tileY * m_TilesCountX + tileX].push_back(triangleIndex);
+            }
+        }
+    }
+
+    void OcclusionCuller::RasterizeOccluders()
+    {
+        uint32_t tilesCount = m_TilesCountX * m_TilesCountY;
+        auto rasterizeTiles = [this](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t iTile = begin; iTile < end; ++iTile)
+                RasterizeTile(iTile);
+        };
+
+        JobSystem* jobSystem = JobSystem::Singleton();
+        if (jobSystem != nullptr)
+            jobSystem->ParallelFor(tilesCount, m_TilesCountX, rasterizeTiles);
+        else
+            rasterizeTiles(0, tilesCount);
+
+        BuildHierarchy();
+    }
+
+    void OcclusionCuller::RasterizeTile(uint32_t tileIndex)
+    {
+        static_assert(kTileSize == 8, "The tile rasterizer processes rows as two groups of four pixels.");
+
+        float* depth = m_Depth.data() + tileIndex * kTileSize * kTileSize;
+        std::fill(depth, depth + kTileSize * kTileSize, 1.0f);
+
+        const Vector<uint32_t>& bin = m_TileBins[tileIndex];
+        if (bin.empty())
+            return;
+
+        // Pixel centers of the tile.
+        float tileX = (float)((tileIndex % m_TilesCountX) * kTileSize);
+        float tileY = (float)((tileIndex / m_TilesCountX) * kTileSize);
+#ifdef ASTEROID_OCCLUSION_CULLING_SSE
+        const __m128 pixelXLow = _mm_add_ps(_mm_set1_ps(tileX + 0.5f), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+        const __m128 pixelXHigh = _mm_add_ps(pixelXLow, _mm_set1_ps(4.0f));
+        const __m128 zero = _mm_setzero_ps();
+
+        for (uint32_t triangleIndex : bin)
+        {
+            const TriangleSetup& t = m_Triangles[triangleIndex];
+
+            __m128 edgeA[3], edgeRowLow[3], edgeRowHigh[3];
+            for (int iEdge = 0; iEdge < 3; ++iEdge)
+            {
+                edgeA[iEdge] = _mm_set1_ps(t.edgeA[iEdge]);
+                __m128 rowStart = _mm_set1_ps(t.edgeB[iEdge] * (tileY + 0.5f) + t.edgeC[iEdge]);
+                edgeRowLow[iEdge] = _mm_add_ps(_mm_mul_ps(edgeA[iEdge], pixelXLow), rowStart);
+                edgeRowHigh[iEdge] = _mm_add_ps(_mm_mul_ps(edgeA[iEdge], pixelXHigh), rowStart);
+            }
+            __m128 depthA = _mm_set1_ps(t.depthA);
+            __m128 depthRowStart = _mm_set1_ps(t.depthB * (tileY + 0.5f) + t.depthC);
+            __m128 depthRowLow = _mm_add_ps(_mm_mul_ps(depthA, pixelXLow), depthRowStart);
+            __m128 depthRowHigh = _mm_add_ps(_mm_mul_ps(depthA, pixelXHigh), depthRowStart);
+
+            __m128 edgeStepY[3];
+            for (int iEdge = 0; iEdge < 3; ++iEdge)
+                edgeStepY[iEdge] = _mm_set1_ps(t.edgeB[iEdge]);
+            __m128 depthStepY = _mm_set1_ps(t.depthB);
+
+            for (uint32_t row = 0; row < kTileSize; ++row)
+            {
+                __m128 insideLow = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edgeRowLow[0], zero), _mm_cmpge_ps(edgeRowLow[1], zero)),
+                    _mm_cmpge_ps(edgeRowLow[2], zero));
+                __m128 insideHigh = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edgeRowHigh[0], zero), _mm_cmpge_ps(edgeRowHigh[1], zero)),
+                    _mm_cmpge_ps(edgeRowHigh[2], zero));
+
+                float* rowDepth = depth + row * kTileSize;
+                __m128 oldLow = _mm_load_ps(rowDepth);
+                __m128 oldHigh = _mm_load_ps(rowDepth + 4);
+                __m128 newLow = _mm_min_ps(oldLow, depthRowLow);
+                __m128 newHigh = _mm_min_ps(oldHigh, depthRowHigh);
+                _mm_store_ps(rowDepth, _mm_or_ps(_mm_and_ps(insideLow, newLow), _mm_andnot_ps(insideLow, oldLow)));
+                _mm_store_ps(rowDepth + 4, _mm_or_ps(_mm_and_ps(insideHigh, newHigh), _mm_andnot_ps(insideHigh, oldHigh)));
+
+                for (int iEdge = 0; iEdge < 3; ++iEdge)
+                {
+                    edgeRowLow[iEdge] = _mm_add_ps(edgeRowLow[iEdge], edgeStepY[iEdge]);
+                    edgeRowHigh[iEdge] = _mm_add_ps(edgeRowHigh[iEdge], edgeStepY[iEdge]);
+                }
+                depthRowLow = _mm_add_ps(depthRowLow, depthStepY);
+                depthRowHigh = _mm_add_ps(depthRowHigh, depthStepY);
+            }
+        }
+#else
+        // The operations of the SSE path pixel by pixel, so both rasterize the same depths
+        float pixelX[kTileSize];
+        for (uint32_t column = 0; column < 4; ++column)
+        {
+            pixelX[column] = (tileX + 0.5f) + (float)column;
+            pixelX[column + 4] = pixelX[column] + 4.0f;
+        }
+
+        for (uint32_t triangleIndex : bin)
+        {
+            const TriangleSetup& t = m_Triangles[triangleIndex];
+
+            float edgeRow[3][kTileSize], depthRow[kTileSize];
+            for (int iEdge = 0; iEdge < 3; ++iEdge)
+            {
+                float rowStart = t.edgeB[iEdge] * (tileY + 0.5f) + t.edgeC[iEdge];
+                for (uint32_t column = 0; column < kTileSize; ++column)
+                    edgeRow[iEdge][column] = t.edgeA[iEdge] * pixelX[column] + rowStart;
+            }
+            float depthRowStart = t.depthB * (tileY + 0.5f) + t.depthC;
+            for (uint32_t column = 0; column < kTileSize; ++column)
+                depthRow[column] = t.depthA * pixelX[column] + depthRowStart;
+
+            for (uint32_t row = 0; row < kTileSize; ++row)
+            {
+                float* rowDepth = depth + row * kTileSize;
+                for (uint32_t column = 0; column < kTileSize; ++column)
+                {
+                    if (edgeRow[0][column] >= 0.0f && edgeRow[1][column] >= 0.0f && edgeRow[2][column] >= 0.0f)
+                        rowDepth[column] = std::min(rowDepth[column], depthRow[column]);
+
+                    for (int iEdge = 0; iEdge < 3; ++iEdge)
+                        edgeRow[iEdge][column] += t.edgeB[iEdge];
+                    depthRow[column] += t.depthB;
+                }
+            }
+        }
+#endif
+    }
+
+    void OcclusionCuller::BuildHierarchy()
+    {
+        // Level 0 holds the farthest depth of every tile.
+        Vector<float>& level0 = m_Hierarchy[0];
+        uint32_t tilesCount = m_TilesCountX * m_TilesCountY;
+        for (uint32_t iTile = 0; iTile < tilesCount; ++iTile)
+        {
+            const float* depth = m_Depth.data() + iTile * kTileSize * kTileSize;
+            Vec4 maxDepth = Vec4::Load(depth);
+            for (uint32_t i = 4; i < kTileSize * kTileSize; i += 4)
+                maxDepth = Vec4::Max(maxDepth, Vec4::Load(depth + i));
+            level0[iTile] = std::max(std::max(maxDepth.X(), maxDepth.Y()), std::max(maxDepth.Z(), maxDepth.W()));
+        }
+
+        for (size_t iLevel = 1; iLevel < m_Hierarchy.size(); ++iLevel)
+        {
+            const Vector<float>& source = m_Hierarchy[iLevel - 1];
+            uint32_t sourceWidth = m_HierarchyWidth[iLevel - 1];
+            uint32_t sourceHeight = m_HierarchyHeight[iLevel - 1];
+            Vector<float>& target = m_Hierarchy[iLevel];
+            for (uint32_t y = 0; y < m_HierarchyHeight[iLevel]; ++y)
+            {
+                uint32_t y0 = y * 2;
+                uint32_t y1 = std::min(y0 + 1, sourceHeight - 1);
+                for (uint32_t x = 0; x < m_HierarchyWidth[iLevel]; ++x)
+                {
+                    uint32_t x0 = x * 2;
+                    uint32_t x1 = std::min(x0 + 1, sourceWidth - 1);
+                    target[y * m_HierarchyWidth[iLevel] + x] = std::max(
+                        std::max(source[y0 * sourceWidth + x0], source[y0 * sourceWidth + x1]),
+                        std::max(source[y1 * sourceWidth + x0], source[y1 * sourceWidth + x1]));
+                }
+            }
+        }
+    }
+
+    bool OcclusionCuller::IsVisible(const Float3& center, const Float3& extents) const
+    {
+        Mat4 viewProjection = Mat4::Load(m_ViewProjection);
+
+        const float width = (float)Width();
+        const float height = (float)Height();
+
+        float minX = std::numeric_limits<float>::max(), maxX = -minX;
+        float minY = minX, maxY = -minX;
+        float minZ = minX;
+        for (int iCorner = 0; iCorner < 8; ++iCorner)
+        {
+            float x = center.x + ((iCorner & 1) ? extents.x : -extents.x);
+            float y = center.y + ((iCorner & 2) ? extents.y : -extents.y);
+            float z = center.z + ((iCorner & 4) ? extents.z : -extents.z);
+
+            Float4 clip;
+            Mat4::TransformPoint(Vec4::Set(x, y, z, 1.0f), viewProjection).Store(clip);
+            // Boxes crossing the near plane can't be bounded on screen.
+            if (clip.w < kMinClipW)
+                return true;
+
+            float invW = 1.0f / clip.w;
+            float sx = (clip.x * invW * 0.5f + 0.5f) * width;
+            float sy = (0.5f - clip.y * invW * 0.5f) * height;
+            minX = std::min(minX, sx);
+            maxX = std::max(maxX, sx);
+            minY = std::min(minY, sy);
+            maxY = std::max(maxY, sy);
+            minZ = std::min(minZ, clip.z * invW);
+        }
+
+        // Off screen boxes are left to the frustum test.
+        if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height)
+            return true;
+
+        uint32_t x0 = (uint32_t)std::max(minX, 0.0f) / kTileSize;
+        uint32_t x1 = (uint32_t)std::min(maxX, width - 1.0f) / kTileSize;
+        uint32_t y0 = (uint32_t)std::max(minY, 0.0f) / kTileSize;
+        uint32_t y1 = (uint32_t)std::min(maxY, height - 1.0f) / kTileSize;
+
+        // Walk up the hierarchy until the box covers only a few texels.
+        size_t level = 0;
+        while (level + 1 < m_Hierarchy.size() && (x1 - x0 + 1 > kMaxTestTexels || y1 - y0 + 1 > kMaxTestTexels))
+        {
+            x0 /= 2; x1 /= 2; y0 /= 2; y1 /= 2;
+            ++level;
+        }
+
+        const Vector<float>& depth = m_Hierarchy[level];
+        uint32_t levelWidth = m_HierarchyWidth[level];
+        for (uint32_t y = y0; y <= y1; ++y)
+        {
+            for (uint32_t x = x0; x <= x1; ++x)
+            {
+                if (minZ <= depth[y * levelWidth + x])
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    uint32_t OcclusionCuller::Cull(const BoundingVolumeArray& volumes, const uint32_t* indices, uint32_t indicesCount, Vector<uint32_t>* visibleIndices)
+    {
+        m_VisibleFlags.resize(indicesCount);
+        auto testObjects = [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t i = begin; i < end; ++i)
+            {
+                uint32_t index = indices[i];
+                Float3 center(volumes.CenterX()[index], volumes.CenterY()[index], volumes.CenterZ()[index]);
+                Float3 extents(volumes.ExtentX()[index], volumes.ExtentY()[index], volumes.ExtentZ()[index]);
+                m_VisibleFlags[i] = IsVisible(center, extents) ? 1 : 0;
+            }
+        };
+
+        JobSystem* jobSystem = JobSystem::Singleton();
+        if (jobSystem != nullptr)
+            jobSystem->ParallelFor(indicesCount, 1024, testObjects);
+        else
+            testObjects(0, indicesCount);
+
+        // Compact keeping the order, writes never pass reads so indices may alias the output.
+        if (visibleIndices->data() != indices)
+            visibleIndices->resize(indicesCount);
+        uint32_t* output = visibleIndices->data();
+        uint32_t visibleCount = 0;
+        for (uint32_t i = 0; i < indicesCount; ++i)
+        {
+            output[visibleCount] = indices[i];
+            visibleCount += m_VisibleFlags[i];
+        }
+        visibleIndices->resize(visibleCount);
+        return visibleCount;
+    }
+
+    float OcclusionCuller::PixelDepth(uint32_t x, uint32_t y) const
+    {
+        ASTEROID_ASSERT(x < Width() && y < Height(), "Pixel out of the occlusion depth buffer.");
+        uint32_t tileIndex = (y / kTileSize) * m_TilesCountX + x / kTileSize;
+        return m_Depth[tileIndex * kTileSize * kTileSize + (y % kTileSize) * kTileSize + x % kTileSize];
+    }
+}
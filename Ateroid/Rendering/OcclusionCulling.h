@@ -0,0 +1,123 @@
+#pragma once
+
+#include "Math/MathTypes.h"
+#include "Util/Containers.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    class BoundingVolumeArray;
+
+
+    /**
+     *  Software occlusion culling on the CPU.\n
+     *  A small set of occluder meshes is rasterized into a low resolution depth buffer, which is then reduced
+     *  into a hierarchy of max depth levels. Object bounds are tested against the hierarchy without any GPU readback.
+     *  @remarks
+     *      The depth buffer is split into kTileSize x kTileSize tiles. Occluder triangles are binned into tiles
+     *      and the tiles are rasterized in parallel on the JobSystem with SSE edge functions, scalar ones off x86.\n
+     *      Depth follows D3D conventions, 0 is near and 1 is far. Triangles crossing the near plane are dropped,
+     *      which never hides anything that should be visible.\n
+     *      Usage per frame: BeginFrame, AddOccluder for every occluder, RasterizeOccluders, then IsVisible or Cull.
+     */
+    class OcclusionCuller
+    {
+    public:
+        /** Width and height of a tile in pixels. */
+        static const uint32_t kTileSize = 8;
+
+    public:
+        /**
+         *  @param width, height
+         *      Resolution of the depth buffer, rounded up to multiples of kTileSize.
+         */
+        OcclusionCuller(uint32_t width, uint32_t height);
+
+        ASTEROID_NON_COPYABLE(OcclusionCuller)
+
+        /**
+         *  Clear the depth buffer and drop the occluders of the previous frame.
+         *  @param viewProjection
+         *      Row-major view-projection matrix of the camera.
+         */
+        void BeginFrame(const Float4x4& viewProjection);
+
+        /**
+         *  Transform an indexed triangle list and bin its triangles into tiles.
+         *  @param world
+         *      Row-major world matrix of the occluder.
+         */
+        void AddOccluder(const Float3* positions,
+            uint32_t verticesCount,
+            const uint32_t* indices,
+            uint32_t indicesCount,
+            const Float4x4& world);
+
+        /**
+         *  Rasterize all binned triangles and build the depth hierarchy.
+         */
+        void RasterizeOccluders();
+
+        /**
+         *  Test a world space bounding box against the depth hierarchy.
+         *  @return
+         *      False only if the box is entirely hidden behind rasterized occluders.
+         */
+        bool IsVisible(const Float3& center, const Float3& extents) const;
+
+        /**
+         *  Test a list of objects and keep the visible ones.
+         *  @param indices
+         *      Indices into volumes of the objects to test, typically the output of FrustumCuller.
+         *  @param visibleIndices
+         *      Receives the visible subset of indices, keeping their order. May alias indices.
+         *  @return
+         *      Numbers of visible objects.
+         */
+        uint32_t Cull(const BoundingVolumeArray& volumes, const uint32_t* indices, uint32_t indicesCount, Vector<uint32_t>* visibleIndices);
+
+        uint32_t Width() const { return m_TilesCountX * kTileSize; }
+        uint32_t Height() const { return m_TilesCountY * kTileSize; }
+
+        /**
+         *  Read the depth of a pixel, for validation and debug views.
+         */
+        float PixelDepth(uint32_t x, uint32_t y) const;
+
+        /** Numbers of triangles binned since BeginFrame. */
+        uint32_t TrianglesCount() const { return (uint32_t)m_Triangles.size(); }
+
+    private:
+        /** Edge functions and depth plane of a screen space triangle, all evaluated as a*x + b*y + c. */
+        struct TriangleSetup
+        {
+            float edgeA[3];
+            float edgeB[3];
+            float edgeC[3];
+            float depthA;
+            float depthB;
+            float depthC;
+        };
+
+        void RasterizeTile(uint32_t tileIndex);
+        void BuildHierarchy();
+
+    private:
+        uint32_t            m_TilesCountX;
+        uint32_t            m_TilesCountY;
+        Float4x4            m_ViewProjection;
+
+        /** Screen space vertices of the occluder being added, kept to reuse its memory. */
+        Vector<Float4>              m_ScreenVertices;
+        Vector<TriangleSetup>       m_Triangles;
+        Vector<Vector<uint32_t>>    m_TileBins;
+
+        /** Depth of every pixel, stored tile by tile so each tile is contiguous. */
+        VectorA<float, 16>          m_Depth;
+        /** Max depth levels. Level 0 has one texel per tile, every further level halves the resolution. */
+        Vector<Vector<float>>       m_Hierarchy;
+        Vector<uint32_t>            m_HierarchyWidth;
+        Vector<uint32_t>            m_HierarchyHeight;
+
+        Vector<uint8_t>             m_VisibleFlags;
+    };
+}
@@ -0,0 +1,292 @@
+#include "Precompile.h"
+#include "PipelineStateCache.h"
+#include "RenderSystem.h"
+#include "Util/Debug.h"
+#include "Util/Hash.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  Serializes descriptor fields into a cache key. Structs with padding are written field by field
+     *  so that uninitialized padding bytes never leak into the key.
+     */
+    class CacheKeyWriter
+    {
+    public:
+        template<typename T>
+        void Write(const T& value)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be written to a cache key.");
+            WriteBytes(&value, sizeof(T));
+        }
+
+        void WriteString(const char* str)
+        {
+            // Keep the terminator so that consecutive strings can't run into each other.
+            WriteBytes(str, std::strlen(str) + 1);
+        }
+
+        void WriteBytes(const void* data, size_t bytesCount)
+        {
+            const uint8_t* bytes = static_cast<const uint8_t*>(data);
+            m_Bytes.insert(m_Bytes.end(), bytes, bytes + bytesCount);
+        }
+
+        template<typename TKey>
+        TKey Finish()
+        {
+            TKey key;
+            key.hash = Hash::Bytes(m_Bytes.data(), m_Bytes.size());
+            key.bytes = std::move(m_Bytes);
+            return key;
+        }
+
+    private:
+        Vector<uint8_t> m_Bytes;
+    };
+
+    static void WriteInputElementDescs(CacheKeyWriter* writer, const D3D11_INPUT_ELEMENT_DESC* descs, uint32_t descsCount)
+    {
+        writer->Write(descsCount);
+        for (uint32_t iDesc = 0; iDesc < descsCount; ++iDesc)
+        {
+            const D3D11_INPUT_ELEMENT_DESC& desc = descs[iDesc];
+            writer->WriteString(desc.SemanticName);
+            writer->Write(desc.SemanticIndex);
+            writer->Write(desc.Format);
+            writer->Write(desc.InputSlot);
+            writer->Write(desc.AlignedByteOffset);
+            writer->Write(desc.InputSlotClass);
+            writer->Write(desc.InstanceDataStepRate);
+        }
+    }
+
+    static void WriteVertexLayout(CacheKeyWriter* writer, const VertexLayout* layout)
+    {
+        if (layout != nullptr)
+            WriteInputElementDescs(writer, layout->Elements(), layout->ElementsCount());
+        else
+            writer->Write(0xFFFFFFFFu);
+    }
+
+    /** The whole bytecode goes into the key, a hash collision between two shaders must not share their states. */
+    static void WriteBytecode(CacheKeyWriter* writer, const void* bytecode, size_t bytecodeLength)
+    {
+        writer->Write((uint64_t)bytecodeLength);
+        if (bytecodeLength > 0)
+            writer->WriteBytes(bytecode, bytecodeLength);
+    }
+
+    static void WriteBlendDesc(CacheKeyWriter* writer, const D3D11_BLEND_DESC& desc)
+    {
+        writer->Write(desc.AlphaToCoverageEnable);
+        writer->Write(desc.IndependentBlendEnable);
+        // Without independent blending only the first render target is used.
+        int targetsCount = desc.IndependentBlendEnable ? D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT : 1;
+        for (int iTarget = 0; iTarget < targetsCount; ++iTarget)
+        {
+            const D3D11_RENDER_TARGET_BLEND_DESC& target = desc.RenderTarget[iTarget];
+            writer->Write(target.BlendEnable);
+            writer->Write(target.SrcBlend);
+            writer->Write(target.DestBlend);
+            writer->Write(target.BlendOp);
+            writer->Write(target.SrcBlendAlpha);
+            writer->Write(target.DestBlendAlpha);
+            writer->Write(target.BlendOpAlpha);
+            writer->Write(target.RenderTargetWriteMask);
+        }
+    }
+
+    static void WriteStencilOpDesc(CacheKeyWriter* writer, const D3D11_DEPTH_STENCILOP_DESC& desc)
+    {
+        writer->Write(desc.StencilFailOp);
+        writer->Write(desc.StencilDepthFailOp);
+        writer->Write(desc.StencilPassOp);
+        writer->Write(desc.StencilFunc);
+    }
+
+    static void WriteDepthStencilDesc(CacheKeyWriter* writer, const D3D11_DEPTH_STENCIL_DESC& desc)
+    {
+        writer->Write(desc.DepthEnable);
+        writer->Write(desc.DepthWriteMask);
+        writer->Write(desc.DepthFunc);
+        writer->Write(desc.StencilEnable);
+        writer->Write(desc.StencilReadMask);
+        writer->Write(desc.StencilWriteMask);
+        WriteStencilOpDesc(writer, desc.FrontFace);
+        WriteStencilOpDesc(writer, desc.BackFace);
+    }
+
+    VertexLayout::VertexLayout(const D3D11_INPUT_ELEMENT_DESC* descs, uint32_t descsCount, uint64_t hash)
+        : m_Elements(descs, descs + descsCount), m_Hash(hash)
+    {
+        for (D3D11_INPUT_ELEMENT_DESC& element : m_Elements)
+        {
+            m_SemanticNames.emplace_back(element.SemanticName);
+            element.SemanticName = m_SemanticNames.back().c_str();
+        }
+    }
+
+    PipelineStateCache* PipelineStateCache::_Singleton = nullptr;
+
+    PipelineStateCache::PipelineStateCache()
+    {
+    }
+
+    PipelineStateCache::~PipelineStateCache()
+    {
+        WaitForPendingStates();
+    }
+
+    VertexLayout::SharedPtrType PipelineStateCache::AcquireVertexLayout(const D3D11_INPUT_ELEMENT_DESC* descs, uint32_t descsCount)
+    {
+        CacheKeyWriter writer;
+        WriteInputElementDescs(&writer, descs, descsCount);
+        Key key = writer.Finish<Key>();
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto it = m_VertexLayouts.find(key);
+        if (it != m_VertexLayouts.end())
+            return it->second;
+
+        SharedPtr<VertexLayout> layout = ASTEROID_ALLOCATE_SHARED(VertexLayout, descs, descsCount, key.hash);
+        m_VertexLayouts.insert(std::make_pair(std::move(key), layout));
+        return layout;
+    }
+
+    PipelineState::SharedPtrType PipelineStateCache::Request(const PipelineStateDesc& desc)
+    {
+        CacheKeyWriter writer;
+        WriteVertexLayout(&writer, desc.vertexLayout.get());
+        WriteBytecode(&writer, desc.vertexShaderBytecode, desc.vertexShaderBytecodeLength);
+        WriteBytecode(&writer, desc.pixelShaderBytecode, desc.pixelShaderBytecodeLength);
+        writer.Write(desc.topology);
+        writer.Write(desc.rasterizer);
+        WriteBlendDesc(&writer, desc.blend);
+        WriteDepthStencilDesc(&writer, desc.depthStencil);
+        Key key = writer.Finish<Key>();
+
+        SharedPtr<PipelineState> state;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            auto it = m_PipelineStates.find(key);
+            if (it != m_PipelineStates.end())
+                return it->second;
+
+            state = ASTEROID_ALLOCATE_SHARED(PipelineState);
+            state->m_Hash = key.hash;
+            state->m_Topology = desc.topology;
+            m_PipelineStates.insert(std::make_pair(std::move(key), state));
+        }
+
+        // The caller's bytecode is only valid during this call.
+        const uint8_t* vertexShaderBytes = static_cast<const uint8_t*>(desc.vertexShaderBytecode);
+        const uint8_t* pixelShaderBytes = static_cast<const uint8_t*>(desc.pixelShaderBytecode);
+        SharedPtr<Vector<uint8_t>> vertexShader = ASTEROID_ALLOCATE_SHARED(Vector<uint8_t>,
+            vertexShaderBytes, vertexShaderBytes + desc.vertexShaderBytecodeLength);
+        SharedPtr<Vector<uint8_t>> pixelShader = ASTEROID_ALLOCATE_SHARED(Vector<uint8_t>,
+            pixelShaderBytes, pixelShaderBytes + desc.pixelShaderBytecodeLength);
+
+        auto createState = [this, state, desc, vertexShader, pixelShader]()
+        {
+            CreatePipelineState(state.get(), desc, *vertexShader, *pixelShader);
+        };
+
+        JobSystem* jobSystem = JobSystem::Singleton();
+        if (jobSystem != nullptr)
+            jobSystem->Schedule(createState, &m_PendingStates);
+        else
+            createState();
+
+        return state;
+    }
+
+    void PipelineStateCache::WaitForPendingStates()
+    {
+        JobSystem* jobSystem = JobSystem::Singleton();
+        if (jobSystem != nullptr)
+            jobSystem->Wait(&m_PendingStates);
+    }
+
+    size_t PipelineStateCache::VertexLayoutsCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_VertexLayouts.size();
+    }
+
+    size_t PipelineStateCache::InputLayoutsCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_InputLayouts.size();
+    }
+
+    size_t PipelineStateCache::PipelineStatesCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_PipelineStates.size();
+    }
+
+    void PipelineStateCache::CreatePipelineState(PipelineState* state, const PipelineStateDesc& desc,
+        const Vector<uint8_t>& vertexShader, const Vector<uint8_t>& pixelShader)
+    {
+        RenderSystem* renderSystem = RenderSystem::Singleton();
+
+        bool succeeded = true;
+        if (desc.vertexLayout != nullptr)
+        {
+            state->m_InputLayout = AcquireInputLayout(*desc.vertexLayout, vertexShader);
+            succeeded &= state->m_InputLayout != nullptr;
+        }
+
+        state->m_VertexShader = renderSystem->CreateVertexShader(vertexShader.data(), vertexShader.size());
+        succeeded &= state->m_VertexShader != nullptr;
+        if (!pixelShader.empty())
+        {
+            state->m_PixelShader = renderSystem->CreatePixelShader(pixelShader.data(), pixelShader.size());
+            succeeded &= state->m_PixelShader != nullptr;
+        }
+
+        state->m_RasterizerState = renderSystem->CreateRasterizerState(&desc.rasterizer);
+        state->m_BlendState = renderSystem->CreateBlendState(&desc.blend);
+        state->m_DepthStencilState = renderSystem->CreateDepthStencilState(&desc.depthStencil);
+        succeeded &= state->m_RasterizerState != nullptr && state->m_BlendState != nullptr && state->m_DepthStencilState != nullptr;
+
+        if (!succeeded)
+            ASTEROID_LOG_ERROR_F("Create pipeline state %016llx failed.", (unsigned long long)state->m_Hash);
+
+        state->m_State.store(succeeded ? PipelineState::eStateReady : PipelineState::eStateFailed, std::memory_order_release);
+    }
+
+    ID3D11InputLayoutPtr PipelineStateCache::AcquireInputLayout(const VertexLayout& layout, const Vector<uint8_t>& vertexShader)
+    {
+        // Input layouts are validated against the vertex shader input signature, which is part of the bytecode.
+        CacheKeyWriter writer;
+        WriteVertexLayout(&writer, &layout);
+        WriteBytecode(&writer, vertexShader.data(), vertexShader.size());
+        Key key = writer.Finish<Key>();
+
+        SharedPtr<InputLayoutEntry> entry;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            auto it = m_InputLayouts.find(key);
+            if (it != m_InputLayouts.end())
+            {
+                entry = it->second;
+            }
+            else
+            {
+                entry = ASTEROID_ALLOCATE_SHARED(InputLayoutEntry);
+                m_InputLayouts.insert(std::make_pair(std::move(key), entry));
+            }
+        }
+
+        // Only one thread creates a given input layout, others wait for it here.
+        std::lock_guard<std::mutex> entryLock(entry->mutex);
+        if (entry->inputLayout == nullptr)
+        {
+            entry->inputLayout = RenderSystem::Singleton()->CreateInputLayout(layout.Elements(), layout.ElementsCount(),
+                vertexShader.data(), vertexShader.size());
+        }
+        return entry->inputLayout;
+    }
+}
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include "Core/JobSystem.h"
+#include "Util/Containers.h"
+#include "Util/Pointers.h"
+#include "Util/String.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  An immutable, deduplicated vertex input layout description.\n
+     *  Obtained from PipelineStateCache::AcquireVertexLayout, identical layouts share the same instance.
+     */
+    class VertexLayout
+    {
+        friend class PipelineStateCache;
+
+    public:
+        typedef SharedPtr<const VertexLayout> SharedPtrType;
+
+    public:
+        ASTEROID_NON_COPYABLE(VertexLayout)
+
+        const D3D11_INPUT_ELEMENT_DESC* Elements() const { return m_Elements.data(); }
+        uint32_t ElementsCount() const { return (uint32_t)m_Elements.size(); }
+        uint64_t LayoutHash() const { return m_Hash; }
+
+        VertexLayout(const D3D11_INPUT_ELEMENT_DESC* descs, uint32_t descsCount, uint64_t hash);
+
+    private:
+        Vector<D3D11_INPUT_ELEMENT_DESC>    m_Elements;
+        /** Own copies of the semantic names, m_Elements points into them. */
+        List<String>                        m_SemanticNames;
+        uint64_t                            m_Hash;
+    };
+
+
+    /**
+     *  Everything needed to create a PipelineState.
+     *  @remarks
+     *      The shader bytecode is copied by PipelineStateCache::Request, so it only needs to stay valid during the call.
+     */
+    struct PipelineStateDesc
+    {
+        VertexLayout::SharedPtrType vertexLayout;
+        const void*                 vertexShaderBytecode;
+        size_t                      vertexShaderBytecodeLength;
+        const void*                 pixelShaderBytecode;
+        size_t                      pixelShaderBytecodeLength;
+        D3D11_PRIMITIVE_TOPOLOGY    topology;
+        D3D11_RASTERIZER_DESC       rasterizer;
+        D3D11_BLEND_DESC            blend;
+        D3D11_DEPTH_STENCIL_DESC    depthStencil;
+    };
+
+
+    /**
+     *  Immutable set of GPU pipeline objects shared by every user requesting the same PipelineStateDesc.\n
+     *  The objects are created asynchronously, nothing but IsReady may be used before IsReady returns true.
+     */
+    class PipelineState
+    {
+        friend class PipelineStateCache;
+
+    public:
+        typedef SharedPtr<const PipelineState> SharedPtrType;
+
+    public:
+        PipelineState() : m_State(eStatePending) {}
+
+        ASTEROID_NON_COPYABLE(PipelineState)
+
+        /** True once the GPU objects are created successfully. */
+        bool IsReady() const { return m_State.load(std::memory_order_acquire) == eStateReady; }
+        /** True if creating any of the GPU objects failed. */
+        bool IsFailed() const { return m_State.load(std::memory_order_acquire) == eStateFailed; }
+
+        uint64_t StateHash() const { return m_Hash; }
+
+        ID3D11InputLayout*          InputLayout() const { return m_InputLayout.Get(); }
+        ID3D11VertexShader*         VertexShader() const { return m_VertexShader.Get(); }
+        ID3D11PixelShader*          PixelShader() const { return m_PixelShader.Get(); }
+        ID3D11RasterizerState*      RasterizerState() const { return m_RasterizerState.Get(); }
+        ID3D11BlendState*           BlendState() const { return m_BlendState.Get(); }
+        ID3D11DepthStencilState*    DepthStencilState() const { return m_DepthStencilState.Get(); }
+        D3D11_PRIMITIVE_TOPOLOGY    Topology() const { return m_Topology; }
+
+    private:
+        enum EState : uint32_t
+        {
+            eStatePending, eStateReady, eStateFailed
+        };
+
+        std::atomic<uint32_t>       m_State;
+        uint64_t                    m_Hash;
+        ID3D11InputLayoutPtr        m_InputLayout;
+        ID3D11VertexShaderPtr       m_VertexShader;
+        ID3D11PixelShaderPtr        m_PixelShader;
+        ID3D11RasterizerStatePtr    m_RasterizerState;
+        ID3D11BlendStatePtr         m_BlendState;
+        ID3D11DepthStencilStatePtr  m_DepthStencilState;
+        D3D11_PRIMITIVE_TOPOLOGY    m_Topology;
+    };
+
+
+    /**
+     *  A global cache deduplicating vertex layouts, input layouts and pipeline states.\n
+     *  Pipeline states are keyed by their vertex layout elements, shader bytecode and state descriptors. Keys keep
+     *  the serialized descriptions and are compared in full, their hash only picks the bucket.
+     *  The first request of a key returns a pending PipelineState right away and creates its GPU objects
+     *  on the JobSystem, so first use never stalls the calling thread.\n
+     *  Input layouts depend only on the vertex layout and the vertex shader input signature, so pipeline states
+     *  differing only in fixed function state share one input layout.
+     *  @remarks
+     *      All functions are thread safe.
+     */
+    class PipelineStateCache
+    {
+    public:
+        ASTEROID_NON_COPYABLE(PipelineStateCache)
+
+        /**
+         *  Create the PipelineStateCache singleton.
+         */
+        static PipelineStateCache* Create()
+        {
+            ASTEROID_ASSERT(_Singleton == nullptr, "There is already a PipelineStateCache singleton created.");
+            _Singleton = ASTEROID_NEW PipelineStateCache();
+            return _Singleton;
+        }
+
+        /**
+         *  Destroy the PipelineStateCache singleton. Waits for pending creations first.
+         */
+        static void Destroy()
+        {
+            ASTEROID_DELETE _Singleton;
+            _Singleton = nullptr;
+        }
+
+        /**
+         *  Current created singleton.
+         *  @return
+         *      Instance of current created singleton. nullptr if no instance created or singleton was destroyed.
+         */
+        static PipelineStateCache* Singleton() { return _Singleton; }
+
+        ~PipelineStateCache();
+
+        /**
+         *  Get the shared vertex layout matching the given element descs, creating it if needed.
+         */
+        VertexLayout::SharedPtrType AcquireVertexLayout(const D3D11_INPUT_ELEMENT_DESC* descs, uint32_t descsCount);
+
+        /**
+         *  Get the shared pipeline state matching the given desc.
+         *  @return
+         *      The cached state. If the desc is requested for the first time the state is still pending,
+         *      check PipelineState::IsReady before binding it.
+         */
+        PipelineState::SharedPtrType Request(const PipelineStateDesc& desc);
+
+        /**
+         *  Block until every pending pipeline state is created.
+         */
+        void WaitForPendingStates();
+
+        size_t VertexLayoutsCount() const;
+        size_t InputLayoutsCount() const;
+        size_t PipelineStatesCount() const;
+
+    private:
+        struct Key
+        {
+            uint64_t        hash;
+            Vector<uint8_t> bytes;
+
+            bool operator==(const Key& other) const { return hash == other.hash && bytes == other.bytes; }
+        };
+
+        struct KeyHasher
+        {
+            size_t operator()(const Key& key) const { return (size_t)key.hash; }
+        };
+
+        struct InputLayoutEntry
+        {
+            std::mutex              mutex;
+            ID3D11InputLayoutPtr    inputLayout;
+        };
+
+        PipelineStateCache();
+
+        void CreatePipelineState(PipelineState* state, const PipelineStateDesc& desc, const Vector<uint8_t>& vertexShader, const Vector<uint8_t>& pixelShader);
+        ID3D11InputLayoutPtr AcquireInputLayout(const VertexLayout& layout, const Vector<uint8_t>& vertexShader);
+
+    private:
+        static PipelineStateCache* _Singleton;
+
+    private:
+        mutable std::mutex m_Mutex;
+        UnorderedMap<Key, SharedPtr<VertexLayout>, KeyHasher>       m_VertexLayouts;
+        UnorderedMap<Key, SharedPtr<InputLayoutEntry>, KeyHasher>   m_InputLayouts;
+        UnorderedMap<Key, SharedPtr<PipelineState>, KeyHasher>      m_PipelineStates;
+        JobCounter                                                  m_PendingStates;
+    };
+}
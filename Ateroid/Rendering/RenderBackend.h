@@ -0,0 +1,305 @@
+#pragma once
+
+#include "Core/ObjectInstanceID.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /** Range of the index buffer of a mesh drawn with one material. */
+    struct SubmeshInfo
+    {
+        uint32_t indicesCount;
+        uint32_t indexStart;
+        int32_t vertexOffset;
+    };
+
+
+    /** Formats of vertex elements, backends map them to the formats of their API. */
+    enum class EVertexFormat : uint32_t
+    {
+        eUnknown,
+        eR32Float,
+        eRG32Float,
+        eRGB32Float,
+        eRGBA32Float,
+        eR32Uint,
+        eRG32Uint,
+        eRGB32Uint,
+        eRGBA32Uint,
+        eR16Float,
+        eR16Uint,
+        eRG16Float,
+        eRG16Unorm,
+        eRG16Snorm,
+        eRGBA16Float,
+        eRGBA16Unorm,
+        eRGBA16Snorm,
+        eRGBA16Uint,
+        eRGB10A2Unorm,
+        eRG11B10Float,
+        eRGBA8Unorm,
+        eRGBA8Snorm,
+        eRGBA8Uint,
+        eBGRA8Unorm
+    };
+
+    /** An element of the vertex layout of a mesh, backends map it to the input layout of their API. */
+    struct VertexElement
+    {
+        /** The element follows the previous element of its slot. */
+        static const uint32_t kAppendAligned = 0xFFFFFFFF;
+
+        /** Must stay valid until the mesh is uploaded, string literals are the usual choice. */
+        const char*     semanticName;
+        uint32_t        semanticIndex;
+        EVertexFormat   format;
+        uint32_t        inputSlot;
+        /** Offset in the vertex of its slot, or kAppendAligned. */
+        uint32_t        alignedByteOffset;
+        /** Per-instance elements advance every instanceDataStepRate instances instead of every vertex. */
+        bool            isPerInstance;
+        uint32_t        instanceDataStepRate;
+
+        /** Size of the element, 0 for eUnknown. */
+        uint32_t Bytes() const
+        {
+            switch (format)
+            {
+            case EVertexFormat::eRGBA32Float:
+            case EVertexFormat::eRGBA32Uint:
+                return 16;
+            case EVertexFormat::eRGB32Float:
+            case EVertexFormat::eRGB32Uint:
+                return 12;
+            case EVertexFormat::eRG32Float:
+            case EVertexFormat::eRG32Uint:
+            case EVertexFormat::eRGBA16Float:
+            case EVertexFormat::eRGBA16Unorm:
+            case EVertexFormat::eRGBA16Snorm:
+            case EVertexFormat::eRGBA16Uint:
+                return 8;
+            case EVertexFormat::eR32Float:
+            case EVertexFormat::eR32Uint:
+            case EVertexFormat::eRG16Float:
+            case EVertexFormat::eRG16Unorm:
+            case EVertexFormat::eRG16Snorm:
+            case EVertexFormat::eRGB10A2Unorm:
+            case EVertexFormat::eRG11B10Float:
+            case EVertexFormat::eRGBA8Unorm:
+            case EVertexFormat::eRGBA8Snorm:
+            case EVertexFormat::eRGBA8Uint:
+            case EVertexFormat::eBGRA8Unorm:
+                return 4;
+            case EVertexFormat::eR16Float:
+            case EVertexFormat::eR16Uint:
+                return 2;
+            default:
+                return 0;
+            }
+        }
+    };
+
+
+    /** Vertex streams of a mesh bound for a draw. */
+    enum class EVertexStreams
+    {
+        /** Every vertex stream of the mesh. */
+        eAll,
+        /**
+         *  Only the positions, bound to slot 0. Depth and shadow passes use it to skip fetching the other
+         *  attributes of meshes with a split position stream.
+         */
+        ePositionOnly
+    };
+
+
+    /**
+     *  An instanced draw of one submesh with one material.
+     *  Instances are read from the instance stream starting at element firstInstance.
+     */
+    struct InstancedDraw
+    {
+        ObjectInstanceID    mesh;
+        uint32_t            submeshIndex;
+        ObjectInstanceID    material;
+        uint32_t            instancesCount;
+        uint32_t            firstInstance;
+        EVertexStreams      streams;
+    };
+
+
+    /** How a texture may be used, combined as bit flags in TransientTextureDesc::usage. */
+    enum ETextureUsage : uint32_t
+    {
+        eTextureUsageRenderTarget   = 1 << 0,
+        eTextureUsageDepthStencil   = 1 << 1,
+        eTextureUsageShaderResource = 1 << 2,
+        eTextureUsageUnorderedAccess = 1 << 3
+    };
+
+    /** Texel formats of textures, backends map them to the formats of their API. */
+    enum class ETextureFormat : uint32_t
+    {
+        eUnknown,
+        eRGBA8Unorm,
+        eBGRA8Unorm,
+        eRGB10A2Unorm,
+        eRG11B10Float,
+        eRGBA16Float,
+        eRG16Float,
+        eR16Float,
+        eR32Float,
+        eRGBA32Float,
+        eD32Float,
+        eD24UnormS8Uint
+    };
+
+    /** A 2D texture living only during a frame, see RenderGraph. */
+    struct TransientTextureDesc
+    {
+        uint32_t        width;
+        uint32_t        height;
+        ETextureFormat  format;
+        uint32_t        usage;
+
+        bool operator==(const TransientTextureDesc& other) const
+        {
+            return width == other.width && height == other.height && format == other.format && usage == other.usage;
+        }
+
+        /** Size of a texel, 0 for eUnknown. */
+        uint32_t TexelBytes() const
+        {
+            switch (format)
+            {
+            case ETextureFormat::eRGBA32Float:
+                return 16;
+            case ETextureFormat::eRGBA16Float:
+                return 8;
+            case ETextureFormat::eRGBA8Unorm:
+            case ETextureFormat::eBGRA8Unorm:
+            case ETextureFormat::eRGB10A2Unorm:
+            case ETextureFormat::eRG11B10Float:
+            case ETextureFormat::eRG16Float:
+            case ETextureFormat::eR32Float:
+            case ETextureFormat::eD32Float:
+            case ETextureFormat::eD24UnormS8Uint:
+                return 4;
+            case ETextureFormat::eR16Float:
+                return 2;
+            default:
+                return 0;
+            }
+        }
+
+        /** Size of the texels without any padding. */
+        uint64_t Bytes() const { return (uint64_t)width * height * TexelBytes(); }
+    };
+
+    /** The way a resource is accessed, transitions between states require barriers. */
+    enum class EResourceState
+    {
+        /** Content is undefined, e.g. before the first write to a transient resource. */
+        eUndefined,
+        eRenderTarget,
+        eDepthWrite,
+        eDepthRead,
+        eShaderRead,
+        eUnorderedAccess,
+        ePresent
+    };
+
+    /**
+     *  A state transition of a texture.
+     *  A barrier from EResourceState::eUndefined also marks the point where a transient texture starts
+     *  using memory aliased with textures used before.
+     */
+    struct ResourceBarrier
+    {
+        uint32_t        texture;
+        EResourceState  before;
+        EResourceState  after;
+    };
+
+
+    /**
+     *  Interface of the API specific part of rendering.\n
+     *  Resources are referred to by engine object instance IDs, so code built on top of this interface doesn't
+     *  depend on any graphics API and can run against NullRenderBackend.
+     */
+    class RenderBackend
+    {
+    public:
+        virtual ~RenderBackend() {}
+
+        /**
+         *  Copy per-instance data written to the upload ring into the instance stream.
+         *  @param byteOffset
+         *      Offset from the beginning of the instance stream.
+         *  @param uploadOffset
+         *      Offset of the data from the beginning of the upload ring, the ring must not be mapped.
+         *  @return
+         *      False if the range doesn't fit into the instance stream or the upload ring.
+         */
+        virtual bool CopyToInstanceStream(uint32_t byteOffset, uint32_t uploadOffset, uint32_t bytesCount) = 0;
+
+        /**
+         *  Draw instances of a submesh, reading per-instance data from the instance stream.
+         */
+        virtual void DrawIndexedInstanced(const InstancedDraw& draw) = 0;
+
+        /**
+         *  (Re)create the upload ring, a CPU writable buffer the GPU reads per-frame data from.
+         */
+        virtual bool CreateUploadRing(uint32_t bytesCount) = 0;
+
+        /**
+         *  Map the upload ring for writing.
+         *  @return
+         *      Address of the first byte of the ring, nullptr on failure.
+         *  @remarks
+         *      Ranges the GPU may still read must not be written, UploadRing keeps track of them with fences.
+         */
+        virtual uint8_t* MapUploadRing() = 0;
+
+        virtual void UnmapUploadRing() = 0;
+
+        /**
+         *  Insert a fence after all commands submitted so far.
+         *  @return
+         *      The fence value, CompletedFence reaches it once the GPU has passed the fence. Values start at 1 and increase.
+         */
+        virtual uint64_t SignalFence() = 0;
+
+        /**
+         *  Value of the last fence the GPU has passed, 0 if none.
+         */
+        virtual uint64_t CompletedFence() = 0;
+
+        /**
+         *  Memory needed by a transient texture.
+         *  @param alignment
+         *      Returns the required alignment of the texture in the transient heap.
+         */
+        virtual uint64_t TransientTextureBytes(const TransientTextureDesc& desc, uint64_t* alignment) = 0;
+
+        /**
+         *  Make sure the transient heap holds at least bytesCount bytes.
+         */
+        virtual bool ReserveTransientHeap(uint64_t bytesCount) = 0;
+
+        /**
+         *  Get a transient texture placed at an offset of the transient heap. Textures placed at overlapping ranges
+         *  share their memory, the caller guarantees they are never used at the same time.
+         *  @return
+         *      Backend id of the texture, valid until the next call to ReserveTransientHeap.
+         */
+        virtual uint32_t AcquireTransientTexture(const TransientTextureDesc& desc, uint64_t heapOffset) = 0;
+
+        virtual void Barrier(const ResourceBarrier& barrier) = 0;
+
+        /**
+         *  Show the frame rendered so far.
+         */
+        virtual bool Present() = 0;
+    };
+}
@@ -0,0 +1,357 @@
+#include "Precompile.h"
+#include "RenderGraph.h"
+#include "Util/Debug.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    static uint32_t UsageOfState(EResourceState state)
+    {
+        switch (state)
+        {
+        case EResourceState::eRenderTarget:
+            return eTextureUsageRenderTarget;
+        case EResourceState::eDepthWrite:
+        case EResourceState::eDepthRead:
+            return eTextureUsageDepthStencil;
+        case EResourceState::eShaderRead:
+            return eTextureUsageShaderResource;
+        case EResourceState::eUnorderedAccess:
+            return eTextureUsageUnorderedAccess;
+        default:
+            return 0;
+        }
+    }
+
+    void RenderGraph::PassBuilder::Read(ResourceHandle resource, EResourceState state)
+    {
+        Access access = { resource, state, false };
+        m_Graph->m_Passes[m_Pass].accesses.push_back(access);
+    }
+
+    void RenderGraph::PassBuilder::Write(ResourceHandle resource, EResourceState state)
+    {
+        Access access = { resource, state, true };
+        m_Graph->m_Passes[m_Pass].accesses.push_back(access);
+    }
+
+    void RenderGraph::PassBuilder::SideEffect()
+    {
+        m_Graph->m_Passes[m_Pass].sideEffect = true;
+    }
+
+    uint32_t RenderGraph::PassResources::Texture(ResourceHandle resource) const
+    {
+        return m_Graph->m_Resources[resource].backendTexture;
+    }
+
+    RenderGraph::RenderGraph()
+        : m_TransientHeapBytes(0), m_IsCompiled(false)
+    {
+    }
+
+    void RenderGraph::Reset()
+    {
+        m_Resources.clear();
+        m_Passes.clear();
+        m_FinalTransitions.clear();
+        m_TransientHeapBytes = 0;
+        m_IsCompiled = false;
+    }
+
+    RenderGraph::ResourceHandle RenderGraph::CreateTexture(const char* name, uint32_t width, uint32_t height, ETextureFormat format)
+    {
+        Resource resource;
+        resource.name = name;
+        resource.desc.width = width;
+        resource.desc.height = height;
+        resource.desc.format = format;
+        resource.desc.usage = 0;
+        resource.imported = false;
+        resource.initialState = EResourceState::eUndefined;
+        resource.finalState = EResourceState::eUndefined;
+        resource.backendTexture = 0;
+        m_Resources.push_back(resource);
+        return (ResourceHandle)m_Resources.size() - 1;
+    }
+
+    RenderGraph::ResourceHandle RenderGraph::ImportTexture(const char* name, uint32_t backendTexture, EResourceState initialState, EResourceState finalState)
+    {
+        Resource resource;
+        resource.name = name;
+        std::memset(&resource.desc, 0, sizeof(resource.desc));
+        resource.imported = true;
+        resource.initialState = initialState;
+        resource.finalState = finalState;
+        resource.backendTexture = backendTexture;
+        m_Resources.push_back(resource);
+        return (ResourceHandle)m_Resources.size() - 1;
+    }
+
+    void RenderGraph::AddPass(const char* name, const SetupFunction& setup, const ExecuteFunction& execute)
+    {
+        Pass pass;
+        pass.name = name;
+        pass.execute = execute;
+        pass.sideEffect = false;
+        pass.culled = false;
+        m_Passes.push_back(pass);
+
+        PassBuilder builder(this, (uint32_t)m_Passes.size() - 1);
+        setup(builder);
+    }
+
+    bool RenderGraph::Compile(RenderBackend* backend)
+    {
+        // Passes are declared in execution order, so every read must follow a write of an earlier pass
+        Vector<bool> isWritten(m_Resources.size(), false);
+        for (const Pass& pass : m_Passes)
+        {
+            for (const Access& access : pass.accesses)
+            {
+                const Resource& resource = m_Resources[access.resource];
+                if (!access.write && !resource.imported && !isWritten[access.resource])
+                {
+                    ASTEROID_LOG_ERROR_F("RenderGraph pass %s reads %s before any pass writes it.", pass.name.c_str(), resource.name.c_str());
+                    return false;
+                }
+            }
+            for (const Access& access : pass.accesses)
+            {
+                if (access.write)
+                    isWritten[access.resource] = true;
+            }
+        }
+
+        CullPasses();
+        ComputeLifetimes();
+        PlaceTransientTextures(backend);
+        DeriveTransitions();
+        m_IsCompiled = true;
+        return true;
+    }
+
+    void RenderGraph::Execute(RenderBackend* backend)
+    {
+        ASTEROID_ASSERT(m_IsCompiled, "RenderGraph executed without a successful Compile.");
+
+        backend->ReserveTransientHeap(m_TransientHeapBytes);
+        for (Resource& resource : m_Resources)
+        {
+            if (!resource.imported && resource.firstPass != kNoPass)
+                resource.backendTexture = backend->AcquireTransientTexture(resource.desc, resource.heapOffset);
+        }
+
+        PassResources resources(this);
+        for (const Pass& pass : m_Passes)
+        {
+            if (pass.culled)
+                continue;
+
+            IssueTransitions(backend, pass.transitions);
+            if (pass.execute)
+                pass.execute(backend, resources);
+        }
+        IssueTransitions(backend, m_FinalTransitions);
+    }
+
+    RenderGraph::Stats RenderGraph::GetStats() const
+    {
+        Stats stats;
+        stats.passesCount = (uint32_t)m_Passes.size();
+        stats.culledPassesCount = 0;
+        stats.barriersCount = (uint32_t)m_FinalTransitions.size();
+        for (const Pass& pass : m_Passes)
+        {
+            if (pass.culled)
+                ++stats.culledPassesCount;
+            stats.barriersCount += (uint32_t)pass.transitions.size();
+        }
+
+        stats.transientTexturesCount = 0;
+        stats.transientTexturesBytes = 0;
+        for (const Resource& resource : m_Resources)
+        {
+            if (!resource.imported && resource.firstPass != kNoPass)
+            {
+                ++stats.transientTexturesCount;
+                stats.transientTexturesBytes += resource.bytesCount;
+            }
+        }
+        stats.transientHeapBytes = m_TransientHeapBytes;
+        return stats;
+    }
+
+    void RenderGraph::CullPasses()
+    {
+        // Walk backwards from what leaves the graph. Writes keep the previous content, so an alive pass needs
+        // the earlier writers of everything it accesses, not only of what it reads.
+        Vector<bool> isNeeded(m_Resources.size(), false);
+        for (uint32_t iResource = 0; iResource < m_Resources.size(); ++iResource)
+            isNeeded[iResource] = m_Resources[iResource].imported;
+
+        for (uint32_t iPass = (uint32_t)m_Passes.size(); iPass-- > 0;)
+        {
+            Pass& pass = m_Passes[iPass];
+            bool isAlive = pass.sideEffect;
+            for (const Access& access : pass.accesses)
+                isAlive = isAlive || (access.write && isNeeded[access.resource]);
+
+            pass.culled = !isAlive;
+            if (isAlive)
+            {
+                for (const Access& access : pass.accesses)
+                    isNeeded[access.resource] = true;
+            }
+        }
+    }
+
+    void RenderGraph::ComputeLifetimes()
+    {
+        for (Resource& resource : m_Resources)
+        {
+            resource.firstPass = kNoPass;
+            resource.lastPass = kNoPass;
+            resource.bytesCount = 0;
+            resource.heapOffset = 0;
+            if (!resource.imported)
+                resource.desc.usage = 0;
+        }
+
+        for (uint32_t iPass = 0; iPass < m_Passes.size(); ++iPass)
+        {
+            if (m_Passes[iPass].culled)
+                continue;
+
+            for (const Access& access : m_Passes[iPass].accesses)
+            {
+                Resource& resource = m_Resources[access.resource];
+                if (resource.firstPass == kNoPass)
+                    resource.firstPass = iPass;
+                resource.lastPass = iPass;
+                resource.desc.usage |= UsageOfState(access.state);
+            }
+        }
+    }
+
+    void RenderGraph::PlaceTransientTextures(RenderBackend* backend)
+    {
+        struct Placement
+        {
+            ResourceHandle  resource;
+            uint64_t        alignment;
+        };
+
+        Vector<Placement> placements;
+        for (ResourceHandle iResource = 0; iResource < m_Resources.size(); ++iResource)
+        {
+            Resource& resource = m_Resources[iResource];
+            if (resource.imported || resource.firstPass == kNoPass)
+                continue;
+
+            Placement placement;
+            placement.resource = iResource;
+            resource.bytesCount = backend->TransientTextureBytes(resource.desc, &placement.alignment);
+            placement.alignment = std::max(placement.alignment, (uint64_t)1);
+            placements.push_back(placement);
+        }
+
+        // Large textures first leave the small ones to fill the gaps
+        std::sort(placements.begin(), placements.end(), [this](const Placement& a, const Placement& b)
+        {
+            const Resource& resourceA = m_Resources[a.resource];
+            const Resource& resourceB = m_Resources[b.resource];
+            if (resourceA.bytesCount != resourceB.bytesCount)
+                return resourceA.bytesCount > resourceB.bytesCount;
+            return a.resource < b.resource;
+        });
+
+        m_TransientHeapBytes = 0;
+        Vector<ResourceHandle> placed;
+        Vector<ResourceHandle> conflicts;
+        for (const Placement& placement : placements)
+        {
+            Resource& resource = m_Resources[placement.resource];
+
+            // Only textures alive at the same time as this one can't share its memory
+            conflicts.clear();
+            for (ResourceHandle other : placed)
+            {
+                const Resource& otherResource = m_Resources[other];
+                if (otherResource.firstPass <= resource.lastPass && resource.firstPass <= otherResource.lastPass)
+                    conflicts.push_back(other);
+            }
+            std::sort(conflicts.begin(), conflicts.end(), [this](ResourceHandle a, ResourceHandle b)
+            {
+                return m_Resources[a].heapOffset < m_Resources[b].heapOffset;
+            });
+
+            // Lowest gap between conflicting textures that fits
+            uint64_t offset = 0;
+            for (ResourceHandle other : conflicts)
+            {
+                const Resource& otherResource = m_Resources[other];
+                if (AlignUp(offset, placement.alignment) + resource.bytesCount <= otherResource.heapOffset)
+                    break;
+                offset = std::max(offset, otherResource.heapOffset + otherResource.bytesCount);
+            }
+
+            resource.heapOffset = AlignUp(offset, placement.alignment);
+            m_TransientHeapBytes = std::max(m_TransientHeapBytes, resource.heapOffset + resource.bytesCount);
+            placed.push_back(placement.resource);
+        }
+    }
+
+    void RenderGraph::DeriveTransitions()
+    {
+        Vector<EResourceState> states(m_Resources.size());
+        for (uint32_t iResource = 0; iResource < m_Resources.size(); ++iResource)
+            states[iResource] = m_Resources[iResource].initialState;
+
+        for (Pass& pass : m_Passes)
+        {
+            pass.transitions.clear();
+            if (pass.culled)
+                continue;
+
+            // Transient textures start undefined, so their first use always gets the barrier telling the
+            // backend their memory may have been used by another texture before.
+            for (const Access& access : pass.accesses)
+            {
+                if (states[access.resource] != access.state)
+                {
+                    Transition transition = { access.resource, states[access.resource], access.state };
+                    pass.transitions.push_back(transition);
+                    states[access.resource] = access.state;
+                }
+            }
+        }
+
+        m_FinalTransitions.clear();
+        for (uint32_t iResource = 0; iResource < m_Resources.size(); ++iResource)
+        {
+            const Resource& resource = m_Resources[iResource];
+            if (resource.imported && states[iResource] != resource.finalState)
+            {
+                Transition transition = { iResource, states[iResource], resource.finalState };
+                m_FinalTransitions.push_back(transition);
+            }
+        }
+    }
+
+    void RenderGraph::IssueTransitions(RenderBackend* backend, const Vector<Transition>& transitions) const
+    {
+        for (const Transition& transition : transitions)
+        {
+            ResourceBarrier barrier;
+            barrier.texture = m_Resources[transition.resource].backendTexture;
+            barrier.before = transition.before;
+            barrier.after = transition.after;
+            backend->Barrier(barrier);
+        }
+    }
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include "RenderBackend.h"
+#include "Util/Containers.h"
+#include "Util/String.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  Frame graph of render passes and the textures they read and write.\n
+     *  Passes are declared in execution order with their accesses. Compile culls passes whose results are never
+     *  used, computes the lifetime of every transient texture, places transient textures with disjoint lifetimes
+     *  at overlapping ranges of one transient heap and derives the barriers between passes.
+     *  @remarks
+     *      Usage per frame: Reset, CreateTexture/ImportTexture and AddPass, Compile, then Execute.
+     */
+    class RenderGraph
+    {
+    public:
+        typedef uint32_t ResourceHandle;
+
+        static const ResourceHandle kInvalidResource = 0xFFFFFFFF;
+
+        /** Declares the accesses of a pass, handed to the setup function of AddPass. */
+        class PassBuilder
+        {
+            friend class RenderGraph;
+
+        public:
+            /** The pass reads the resource in the given state. */
+            void Read(ResourceHandle resource, EResourceState state);
+            /** The pass writes the resource in the given state. Writes keep the previous content. */
+            void Write(ResourceHandle resource, EResourceState state);
+            /** The pass has effects outside the graph and is never culled. */
+            void SideEffect();
+
+        private:
+            PassBuilder(RenderGraph* graph, uint32_t pass) : m_Graph(graph), m_Pass(pass) {}
+
+        private:
+            RenderGraph*    m_Graph;
+            uint32_t        m_Pass;
+        };
+
+        /** Resolves graph resources to backend textures while a pass executes. */
+        class PassResources
+        {
+            friend class RenderGraph;
+
+        public:
+            /** Backend id of the texture of a resource. */
+            uint32_t Texture(ResourceHandle resource) const;
+
+        private:
+            explicit PassResources(const RenderGraph* graph) : m_Graph(graph) {}
+
+        private:
+            const RenderGraph* m_Graph;
+        };
+
+        typedef std::function<void(PassBuilder& builder)> SetupFunction;
+        typedef std::function<void(RenderBackend* backend, const PassResources& resources)> ExecuteFunction;
+
+        struct Stats
+        {
+            uint32_t passesCount;
+            uint32_t culledPassesCount;
+            uint32_t transientTexturesCount;
+            uint32_t barriersCount;
+            /** Size of the transient heap with aliasing. */
+            uint64_t transientHeapBytes;
+            /** Memory the transient textures would need without aliasing. */
+            uint64_t transientTexturesBytes;
+        };
+
+    public:
+        RenderGraph();
+
+        ASTEROID_NON_COPYABLE(RenderGraph)
+
+        /** Forget every pass and resource to build the graph of a new frame. */
+        void Reset();
+
+        /**
+         *  Declare a transient texture. Its usage flags are derived from the accesses of the passes.
+         */
+        ResourceHandle CreateTexture(const char* name, uint32_t width, uint32_t height, ETextureFormat format);
+
+        /**
+         *  Declare a texture owned outside the graph, e.g. the back buffer. It is never aliased, and passes
+         *  writing it are never culled.
+         *  @param initialState, finalState
+         *      State of the texture before the graph executes, and the state the graph leaves it in.
+         */
+        ResourceHandle ImportTexture(const char* name, uint32_t backendTexture, EResourceState initialState, EResourceState finalState);
+
+        /**
+         *  Add a pass after the passes added so far.
+         *  @param setup
+         *      Called right away to declare the accesses of the pass.
+         *  @param execute
+         *      Called by Execute unless the pass is culled.
+         */
+        void AddPass(const char* name, const SetupFunction& setup, const ExecuteFunction& execute);
+
+        /**
+         *  Cull passes, compute lifetimes, place transient textures and derive barriers.
+         *  @return
+         *      False if a pass reads a transient texture that no earlier pass writes.
+         */
+        bool Compile(RenderBackend* backend);
+
+        /**
+         *  Acquire the transient textures and run the passes that were not culled, with their barriers.
+         */
+        void Execute(RenderBackend* backend);
+
+        Stats GetStats() const;
+
+        bool IsPassCulled(uint32_t pass) const { return m_Passes[pass].culled; }
+        const char* PassName(uint32_t pass) const { return m_Passes[pass].name.c_str(); }
+
+        /** Offset of a transient texture in the transient heap, valid after Compile. */
+        uint64_t HeapOffset(ResourceHandle resource) const { return m_Resources[resource].heapOffset; }
+
+    private:
+        static const uint32_t kNoPass = 0xFFFFFFFF;
+
+        struct Resource
+        {
+            String                  name;
+            TransientTextureDesc    desc;
+            bool                    imported;
+            EResourceState          initialState;
+            EResourceState          finalState;
+            /** Backend texture, the imported one or the acquired transient one. */
+            uint32_t                backendTexture;
+
+            uint32_t                firstPass;
+            uint32_t                lastPass;
+            uint64_t                bytesCount;
+            uint64_t                heapOffset;
+        };
+
+        struct Access
+        {
+            ResourceHandle  resource;
+            EResourceState  state;
+            bool            write;
+        };
+
+        struct Transition
+        {
+            ResourceHandle  resource;
+            EResourceState  before;
+            EResourceState  after;
+        };
+
+        struct Pass
+        {
+            String              name;
+            Vector<Access>      accesses;
+            ExecuteFunction     execute;
+            bool                sideEffect;
+            bool                culled;
+            Vector<Transition>  transitions;
+        };
+
+        void CullPasses();
+        void ComputeLifetimes();
+        void PlaceTransientTextures(RenderBackend* backend);
+        void DeriveTransitions();
+        void IssueTransitions(RenderBackend* backend, const Vector<Transition>& transitions) const;
+
+    private:
+        Vector<Resource>    m_Resources;
+        Vector<Pass>        m_Passes;
+        /** Transitions of imported textures to their final state after the last pass. */
+        Vector<Transition>  m_FinalTransitions;
+        uint64_t            m_TransientHeapBytes;
+        bool                m_IsCompiled;
+    };
+}
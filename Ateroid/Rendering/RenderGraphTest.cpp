@@ -0,0 +1,550 @@
+#include "Precompile.h"
+#include "RenderGraphTest.h"
+#include "NullRenderBackend.h"
+#include "RenderGraph.h"
+#include "Util/Debug.h"
+#include <random>
+
+namespace ASTEROID_NAMESPACE
+{
+    typedef RenderGraph::ResourceHandle ResourceHandle;
+
+    static const uint32_t kNoTexture = 0xFFFFFFFF;
+    static const uint32_t kNoPass = 0xFFFFFFFF;
+    /** Backend id of the imported back buffer, far from the ids of transient textures. */
+    static const uint32_t kBackBufferTexture = 1000;
+    static const uint32_t kMaxRandomTexturesCount = 12;
+    static const uint32_t kMaxRandomPassesCount = 16;
+    static const uint32_t kMaxRandomTextureSide = 2048;
+    static const float kSideEffectRatio = 0.1f;
+    /** Random graphs whose last pass writes the back buffer, the others are culled but for side effects. */
+    static const float kPresentRatio = 0.8f;
+    static const ETextureFormat kRandomFormats[] =
+    {
+        ETextureFormat::eRGBA8Unorm, ETextureFormat::eRGBA16Float, ETextureFormat::eR32Float, ETextureFormat::eD32Float
+    };
+    static const uint32_t kRandomFormatsCount = sizeof(kRandomFormats) / sizeof(kRandomFormats[0]);
+
+    /** A texture of a test graph, imported ones are the back buffer. */
+    struct TestResource
+    {
+        const char*     name;
+        bool            imported;
+        uint32_t        width;
+        uint32_t        height;
+        ETextureFormat  format;
+    };
+
+    struct TestAccess
+    {
+        ResourceHandle  resource;
+        EResourceState  state;
+        bool            write;
+    };
+
+    struct TestPass
+    {
+        const char*         name;
+        Vector<TestAccess>  accesses;
+        bool                sideEffect;
+    };
+
+    /** What compiling and executing a test graph produced. */
+    struct GraphResult
+    {
+        Vector<bool>                culled;
+        Vector<uint32_t>            executedPasses;
+        /** Backend texture of every resource accessed by an executed pass, kNoTexture for the others. */
+        Vector<uint32_t>            textures;
+        Vector<uint64_t>            heapOffsets;
+        RenderGraph::Stats          stats;
+        uint64_t                    reservedHeapBytes;
+        Vector<NullRenderBackend::TransientTextureRecord> acquiredTextures;
+        Vector<ResourceBarrier>     barriers;
+    };
+
+    /** Usage flag a texture needs to be accessed in a state. */
+    static uint32_t UsageOfState(EResourceState state)
+    {
+        switch (state)
+        {
+        case EResourceState::eRenderTarget:     return eTextureUsageRenderTarget;
+        case EResourceState::eDepthWrite:
+        case EResourceState::eDepthRead:        return eTextureUsageDepthStencil;
+        case EResourceState::eShaderRead:       return eTextureUsageShaderResource;
+        case EResourceState::eUnorderedAccess:  return eTextureUsageUnorderedAccess;
+        default:                                return 0;
+        }
+    }
+
+    static bool Accesses(const TestPass& pass, ResourceHandle resource)
+    {
+        for (const TestAccess& access : pass.accesses)
+        {
+            if (access.resource == resource)
+                return true;
+        }
+        return false;
+    }
+
+    static bool RunGraph(const char* label, const Vector<TestResource>& resources, const Vector<TestPass>& passes, GraphResult* result)
+    {
+        NullRenderBackend backend(0);
+        RenderGraph graph;
+        for (const TestResource& resource : resources)
+        {
+            if (resource.imported)
+                graph.ImportTexture(resource.name, kBackBufferTexture, EResourceState::ePresent, EResourceState::ePresent);
+            else
+                graph.CreateTexture(resource.name, resource.width, resource.height, resource.format);
+        }
+
+        result->executedPasses.clear();
+        result->textures.assign(resources.size(), kNoTexture);
+        for (uint32_t iPass = 0; iPass < passes.size(); ++iPass)
+        {
+            const TestPass& pass = passes[iPass];
+            graph.AddPass(pass.name, [&pass](RenderGraph::PassBuilder& builder)
+            {
+                for (const TestAccess& access : pass.accesses)
+                {
+                    if (access.write)
+                        builder.Write(access.resource, access.state);
+                    else
+                        builder.Read(access.resource, access.state);
+                }
+                if (pass.sideEffect)
+                    builder.SideEffect();
+            },
+            [&pass, iPass, result](RenderBackend*, const RenderGraph::PassResources& passResources)
+            {
+                result->executedPasses.push_back(iPass);
+                for (const TestAccess& access : pass.accesses)
+                    result->textures[access.resource] = passResources.Texture(access.resource);
+            });
+        }
+
+        if (!graph.Compile(&backend))
+        {
+            ASTEROID_LOG_ERROR_F("RenderGraph %s: compile failed.", label);
+            return false;
+        }
+        graph.Execute(&backend);
+
+        result->culled.resize(passes.size());
+        for (uint32_t iPass = 0; iPass < passes.size(); ++iPass)
+            result->culled[iPass] = graph.IsPassCulled(iPass);
+        result->heapOffsets.resize(resources.size());
+        for (ResourceHandle iResource = 0; iResource < resources.size(); ++iResource)
+            result->heapOffsets[iResource] = graph.HeapOffset(iResource);
+        result->stats = graph.GetStats();
+        result->reservedHeapBytes = backend.TransientHeapBytes();
+        result->acquiredTextures = backend.TransientTextures();
+        result->barriers = backend.RecordedBarriers();
+        return true;
+    }
+
+    /** Checks a graph against a naive model of culling, lifetimes, placement and barriers. */
+    static bool CheckGraph(const char* label, const Vector<TestResource>& resources, const Vector<TestPass>& passes,
+        const GraphResult& result)
+    {
+        uint32_t passesCount = (uint32_t)passes.size();
+        uint32_t resourcesCount = (uint32_t)resources.size();
+
+        // A pass is needed by an alive later pass accessing what it writes, since writes keep the content.
+        // Propagated until nothing changes, unlike the single backward walk of the graph.
+        Vector<bool> isAlive(passesCount, false);
+        for (uint32_t iPass = 0; iPass < passesCount; ++iPass)
+        {
+            isAlive[iPass] = passes[iPass].sideEffect;
+            for (const TestAccess& access : passes[iPass].accesses)
+                isAlive[iPass] = isAlive[iPass] || (access.write && resources[access.resource].imported);
+        }
+        for (bool isChanged = true; isChanged;)
+        {
+            isChanged = false;
+            for (uint32_t iPass = 0; iPass < passesCount; ++iPass)
+            {
+                for (const TestAccess& access : passes[iPass].accesses)
+                {
+                    for (uint32_t iLater = iPass + 1; access.write && !isAlive[iPass] && iLater < passesCount; ++iLater)
+                    {
+                        if (isAlive[iLater] && Accesses(passes[iLater], access.resource))
+                        {
+                            isAlive[iPass] = true;
+                            isChanged = true;
+                        }
+                    }
+                }
+            }
+        }
+
+        Vector<uint32_t> expectedOrder;
+        uint32_t culledPassesCount = 0;
+        for (uint32_t iPass = 0; iPass < passesCount; ++iPass)
+        {
+            if (result.culled[iPass] == isAlive[iPass])
+            {
+                ASTEROID_LOG_ERROR_F("RenderGraph %s: pass %u (%s) was %s.", label, iPass, passes[iPass].name,
+                    isAlive[iPass] ? "culled but is needed" : "kept but is not needed");
+                return false;
+            }
+            if (isAlive[iPass])
+                expectedOrder.push_back(iPass);
+            else
+                ++culledPassesCount;
+        }
+        if (result.executedPasses != expectedOrder)
+        {
+            ASTEROID_LOG_ERROR_F("RenderGraph %s: %zu passes executed instead of %zu, or out of order.", label,
+                result.executedPasses.size(), expectedOrder.size());
+            return false;
+        }
+
+        // Lifetimes and usage flags over the alive passes only
+        Vector<uint32_t> firstPass(resourcesCount, kNoPass);
+        Vector<uint32_t> lastPass(resourcesCount, kNoPass);
+        Vector<uint32_t> usage(resourcesCount, 0);
+        for (uint32_t iPass : expectedOrder)
+        {
+            for (const TestAccess& access : passes[iPass].accesses)
+            {
+                if (firstPass[access.resource] == kNoPass)
+                    firstPass[access.resource] = iPass;
+                lastPass[access.resource] = iPass;
+                usage[access.resource] |= UsageOfState(access.state);
+            }
+        }
+
+        NullRenderBackend sizer(0);
+        Vector<uint64_t> bytes(resourcesCount, 0);
+        uint64_t texturesBytes = 0, heapBytes = 0;
+        uint32_t transientTexturesCount = 0;
+        for (ResourceHandle iResource = 0; iResource < resourcesCount; ++iResource)
+        {
+            const TestResource& resource = resources[iResource];
+            if (resource.imported || firstPass[iResource] == kNoPass)
+                continue;
+
+            TransientTextureDesc desc = { resource.width, resource.height, resource.format, usage[iResource] };
+            uint64_t alignment = 1;
+            bytes[iResource] = sizer.TransientTextureBytes(desc, &alignment);
+            uint64_t offset = result.heapOffsets[iResource];
+            if (offset % alignment != 0)
+            {
+                ASTEROID_LOG_ERROR_F("RenderGraph %s: %s is at heap offset %llu, not aligned to %llu.", label, resource.name,
+                    (unsigned long long)offset, (unsigned long long)alignment);
+                return false;
+            }
+
+            uint32_t texture = result.textures[iResource];
+            if (texture >= result.acquiredTextures.size() || !(result.acquiredTextures[texture].desc == desc) ||
+                result.acquiredTextures[texture].heapOffset != offset)
+            {
+                ASTEROID_LOG_ERROR_F("RenderGraph %s: %s was not acquired from the backend with its description and heap offset.",
+                    label, resource.name);
+                return false;
+            }
+
+            texturesBytes += bytes[iResource];
+            heapBytes = std::max(heapBytes, offset + bytes[iResource]);
+            ++transientTexturesCount;
+        }
+
+        // Textures alive during a common pass must not share any byte
+        for (ResourceHandle iResource = 0; iResource < resourcesCount; ++iResource)
+        {
+            for (ResourceHandle iOther = iResource + 1; iOther < resourcesCount && bytes[iResource] > 0; ++iOther)
+            {
+                if (bytes[iOther] == 0 || firstPass[iResource] > lastPass[iOther] || firstPass[iOther] > lastPass[iResource])
+                    continue;
+
+                uint64_t offset = result.heapOffsets[iResource], otherOffset = result.heapOffsets[iOther];
+                if (offset < otherOffset + bytes[iOther] && otherOffset < offset + bytes[iResource])
+                {
+                    ASTEROID_LOG_ERROR_F("RenderGraph %s: %s and %s are alive at the same time and overlap in the heap.", label,
+                        resources[iResource].name, resources[iOther].name);
+                    return false;
+                }
+            }
+        }
+
+        const RenderGraph::Stats& stats = result.stats;
+        if (stats.passesCount != passesCount || stats.culledPassesCount != culledPassesCount ||
+            stats.transientTexturesCount != transientTexturesCount || stats.transientTexturesBytes != texturesBytes ||
+            stats.transientHeapBytes != heapBytes || result.reservedHeapBytes != heapBytes ||
+            result.acquiredTextures.size() != transientTexturesCount)
+        {
+            ASTEROID_LOG_ERROR_F("RenderGraph %s: stats of %u passes, %u culled, %u transient textures of %llu bytes in a heap of "
+                "%llu bytes instead of %u, %u, %u, %llu and %llu.", label, stats.passesCount, stats.culledPassesCount,
+                stats.transientTexturesCount, (unsigned long long)stats.transientTexturesBytes,
+                (unsigned long long)stats.transientHeapBytes, passesCount, culledPassesCount, transientTexturesCount,
+                (unsigned long long)texturesBytes, (unsigned long long)heapBytes);
+            return false;
+        }
+
+        // Every change of state gets a barrier right before the pass, and imported textures go back to their
+        // final state after the last one
+        Vector<EResourceState> states(resourcesCount);
+        for (ResourceHandle iResource = 0; iResource < resourcesCount; ++iResource)
+            states[iResource] = resources[iResource].imported ? EResourceState::ePresent : EResourceState::eUndefined;
+        Vector<ResourceBarrier> expectedBarriers;
+        auto textureOf = [&](ResourceHandle resource)
+        {
+            return resources[resource].imported ? kBackBufferTexture : result.textures[resource];
+        };
+        for (uint32_t iPass : expectedOrder)
+        {
+            for (const TestAccess& access : passes[iPass].accesses)
+            {
+                if (states[access.resource] != access.state)
+                {
+                    ResourceBarrier barrier = { textureOf(access.resource), states[access.resource], access.state };
+                    expectedBarriers.push_back(barrier);
+                    states[access.resource] = access.state;
+                }
+            }
+        }
+        for (ResourceHandle iResource = 0; iResource < resourcesCount; ++iResource)
+        {
+            if (resources[iResource].imported && states[iResource] != EResourceState::ePresent)
+            {
+                ResourceBarrier barrier = { textureOf(iResource), states[iResource], EResourceState::ePresent };
+                expectedBarriers.push_back(barrier);
+            }
+        }
+
+        if (result.barriers.size() != expectedBarriers.size() || stats.barriersCount != expectedBarriers.size())
+        {
+            ASTEROID_LOG_ERROR_F("RenderGraph %s: %zu barriers recorded and %u counted instead of %zu.", label, result.barriers.size(),
+                stats.barriersCount, expectedBarriers.size());
+            return false;
+        }
+        for (size_t iBarrier = 0; iBarrier < expectedBarriers.size(); ++iBarrier)
+        {
+            const ResourceBarrier& barrier = result.barriers[iBarrier];
+            const ResourceBarrier& expected = expectedBarriers[iBarrier];
+            if (barrier.texture != expected.texture || barrier.before != expected.before || barrier.after != expected.after)
+            {
+                ASTEROID_LOG_ERROR_F("RenderGraph %s: barrier %zu moves texture %u from state %d to %d instead of texture %u from %d to %d.",
+                    label, iBarrier, barrier.texture, (int)barrier.before, (int)barrier.after, expected.texture, (int)expected.before,
+                    (int)expected.after);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     *  A deferred frame with a debug view nobody reads, which must be culled, and a luminance histogram read back
+     *  by the CPU, which must not. Bloom and the histogram start after the G-buffer is dead and must fit below
+     *  the HDR texture, in the memory of the normals.
+     */
+    static bool CheckFrameGraph()
+    {
+        enum FrameResource : ResourceHandle
+        {
+            eBackBuffer, eDepth, eAlbedo, eNormals, eDebugView, eHdr, eBloom, eHistogram
+        };
+
+        Vector<TestResource> resources =
+        {
+            { "Back buffer", true, 0, 0, ETextureFormat::eUnknown },
+            { "Depth", false, 1920, 1080, ETextureFormat::eD32Float },
+            { "Albedo", false, 1920, 1080, ETextureFormat::eRGBA8Unorm },
+            { "Normals", false, 1920, 1080, ETextureFormat::eRGBA16Float },
+            { "Debug view", false, 1920, 1080, ETextureFormat::eRGBA8Unorm },
+            { "HDR", false, 1920, 1080, ETextureFormat::eRGBA16Float },
+            { "Bloom", false, 960, 540, ETextureFormat::eRGBA16Float },
+            { "Luminance histogram", false, 256, 1, ETextureFormat::eR32Float }
+        };
+
+        const EResourceState kDepthWrite = EResourceState::eDepthWrite, kDepthRead = EResourceState::eDepthRead;
+        const EResourceState kRenderTarget = EResourceState::eRenderTarget, kShaderRead = EResourceState::eShaderRead;
+        Vector<TestPass> passes =
+        {
+            { "Depth prepass", { { eDepth, kDepthWrite, true } }, false },
+            { "G-buffer", { { eDepth, kDepthRead, false }, { eAlbedo, kRenderTarget, true }, { eNormals, kRenderTarget, true } }, false },
+            { "Debug view", { { eAlbedo, kShaderRead, false }, { eDebugView, kRenderTarget, true } }, false },
+            { "Lighting", { { eAlbedo, kShaderRead, false }, { eNormals, kShaderRead, false }, { eDepth, kShaderRead, false },
+                { eHdr, kRenderTarget, true } }, false },
+            { "Bloom", { { eHdr, kShaderRead, false }, { eBloom, kRenderTarget, true } }, false },
+            { "Luminance histogram", { { eBloom, kShaderRead, false }, { eHistogram, EResourceState::eUnorderedAccess, true } }, true },
+            { "Tonemap", { { eHdr, kShaderRead, false }, { eBloom, kShaderRead, false }, { eBackBuffer, kRenderTarget, true } }, false }
+        };
+
+        GraphResult result;
+        if (!RunGraph("frame", resources, passes, &result) || !CheckGraph("frame", resources, passes, result))
+            return false;
+
+        Vector<uint32_t> expectedOrder = { 0, 1, 3, 4, 5, 6 };
+        if (result.executedPasses != expectedOrder)
+        {
+            ASTEROID_LOG_ERROR("RenderGraph frame: only the debug view pass should be culled.");
+            return false;
+        }
+
+        // Placed largest first, each at the lowest offset clear of the textures alive at the same time
+        NullRenderBackend sizer(0);
+        auto bytesOf = [&](ResourceHandle resource)
+        {
+            TransientTextureDesc desc = { resources[resource].width, resources[resource].height, resources[resource].format, 0 };
+            uint64_t alignment = 1;
+            return sizer.TransientTextureBytes(desc, &alignment);
+        };
+        uint64_t expectedOffsets[] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+        expectedOffsets[eNormals] = 0;
+        expectedOffsets[eHdr] = bytesOf(eNormals);
+        expectedOffsets[eDepth] = expectedOffsets[eHdr] + bytesOf(eHdr);
+        expectedOffsets[eAlbedo] = expectedOffsets[eDepth] + bytesOf(eDepth);
+        expectedOffsets[eBloom] = 0;
+        expectedOffsets[eHistogram] = bytesOf(eBloom);
+        uint64_t expectedHeapBytes = expectedOffsets[eAlbedo] + bytesOf(eAlbedo);
+        for (ResourceHandle resource : { eDepth, eAlbedo, eNormals, eHdr, eBloom, eHistogram })
+        {
+            if (result.heapOffsets[resource] != expectedOffsets[resource])
+            {
+                ASTEROID_LOG_ERROR_F("RenderGraph frame: %s is at heap offset %llu instead of %llu.", resources[resource].name,
+                    (unsigned long long)result.heapOffsets[resource], (unsigned long long)expectedOffsets[resource]);
+                return false;
+            }
+        }
+        if (result.stats.transientHeapBytes != expectedHeapBytes || expectedHeapBytes >= result.stats.transientTexturesBytes)
+        {
+            ASTEROID_LOG_ERROR_F("RenderGraph frame: transient heap of %llu bytes instead of %llu, for %llu bytes of textures.",
+                (unsigned long long)result.stats.transientHeapBytes, (unsigned long long)expectedHeapBytes,
+                (unsigned long long)result.stats.transientTexturesBytes);
+            return false;
+        }
+
+        struct ExpectedBarrier
+        {
+            ResourceHandle  resource;
+            EResourceState  before;
+            EResourceState  after;
+        };
+        const EResourceState kUndefined = EResourceState::eUndefined, kPresent = EResourceState::ePresent;
+        const ExpectedBarrier kExpectedBarriers[] =
+        {
+            { eDepth, kUndefined, kDepthWrite },
+            { eDepth, kDepthWrite, kDepthRead }, { eAlbedo, kUndefined, kRenderTarget }, { eNormals, kUndefined, kRenderTarget },
+            { eAlbedo, kRenderTarget, kShaderRead }, { eNormals, kRenderTarget, kShaderRead }, { eDepth, kDepthRead, kShaderRead },
+            { eHdr, kUndefined, kRenderTarget },
+            { eHdr, kRenderTarget, kShaderRead }, { eBloom, kUndefined, kRenderTarget },
+            { eBloom, kRenderTarget, kShaderRead }, { eHistogram, kUndefined, EResourceState::eUnorderedAccess },
+            { eBackBuffer, kPresent, kRenderTarget },
+            { eBackBuffer, kRenderTarget, kPresent }
+        };
+        const size_t kExpectedBarriersCount = sizeof(kExpectedBarriers) / sizeof(kExpectedBarriers[0]);
+        bool isSame = result.barriers.size() == kExpectedBarriersCount;
+        for (size_t iBarrier = 0; isSame && iBarrier < kExpectedBarriersCount; ++iBarrier)
+        {
+            const ExpectedBarrier& expected = kExpectedBarriers[iBarrier];
+            uint32_t texture = expected.resource == eBackBuffer ? kBackBufferTexture : result.textures[expected.resource];
+            const ResourceBarrier& barrier = result.barriers[iBarrier];
+            isSame = barrier.texture == texture && barrier.before == expected.before && barrier.after == expected.after;
+        }
+        if (!isSame)
+        {
+            ASTEROID_LOG_ERROR_F("RenderGraph frame: the %zu recorded barriers differ from the %zu expected ones.", result.barriers.size(),
+                kExpectedBarriersCount);
+            return false;
+        }
+
+        ASTEROID_LOG_INFO_F("    frame graph: %zu of %zu passes executed, %u transient textures in %.1f MB instead of %.1f MB, %u barriers",
+            result.executedPasses.size(), passes.size(), result.stats.transientTexturesCount,
+            result.stats.transientHeapBytes / (1024.0 * 1024.0), result.stats.transientTexturesBytes / (1024.0 * 1024.0),
+            result.stats.barriersCount);
+        return true;
+    }
+
+    /** Passes read only textures written before, so the graph always compiles. */
+    static void GenerateGraph(std::mt19937& random, Vector<TestResource>* resources, Vector<TestPass>* passes)
+    {
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+        resources->clear();
+        resources->push_back({ "Back buffer", true, 0, 0, ETextureFormat::eUnknown });
+        uint32_t texturesCount = 1 + random() % kMaxRandomTexturesCount;
+        for (uint32_t iTexture = 0; iTexture < texturesCount; ++iTexture)
+        {
+            uint32_t width = 1 + random() % kMaxRandomTextureSide;
+            uint32_t height = 1 + random() % kMaxRandomTextureSide;
+            resources->push_back({ "Transient", false, width, height, kRandomFormats[random() % kRandomFormatsCount] });
+        }
+
+        passes->clear();
+        uint32_t passesCount = 1 + random() % kMaxRandomPassesCount;
+        Vector<bool> isWritten(resources->size(), false);
+        isWritten[0] = true;
+        Vector<ResourceHandle> handles(resources->size());
+        for (uint32_t iPass = 0; iPass < passesCount; ++iPass)
+        {
+            TestPass pass;
+            pass.name = "Random";
+            pass.sideEffect = uniform(random) < kSideEffectRatio;
+
+            // Distinct resources per pass, the reads among the textures written so far
+            std::iota(handles.begin(), handles.end(), 0);
+            std::shuffle(handles.begin(), handles.end(), random);
+            uint32_t readsCount = random() % 4, writesCount = 1 + random() % 2;
+            for (ResourceHandle resource : handles)
+            {
+                bool isDepth = (*resources)[resource].format == ETextureFormat::eD32Float;
+                if (readsCount > 0 && isWritten[resource])
+                {
+                    EResourceState state = isDepth && uniform(random) < 0.5f ? EResourceState::eDepthRead : EResourceState::eShaderRead;
+                    pass.accesses.push_back({ resource, state, false });
+                    --readsCount;
+                }
+                else if (writesCount > 0 && !(*resources)[resource].imported)
+                {
+                    EResourceState state = isDepth ? EResourceState::eDepthWrite :
+                        uniform(random) < 0.7f ? EResourceState::eRenderTarget : EResourceState::eUnorderedAccess;
+                    pass.accesses.push_back({ resource, state, true });
+                    --writesCount;
+                }
+            }
+            if (iPass + 1 == passesCount && uniform(random) < kPresentRatio && !Accesses(pass, 0))
+                pass.accesses.push_back({ 0, EResourceState::eRenderTarget, true });
+
+            for (const TestAccess& access : pass.accesses)
+                isWritten[access.resource] = isWritten[access.resource] || access.write;
+            passes->push_back(pass);
+        }
+    }
+
+    bool RenderGraphTest::Run(const RenderGraphTestSettings& settings)
+    {
+        ASTEROID_LOG_INFO_F("Render graph test: a frame graph and %u random graphs.", settings.graphsCount);
+
+        bool isValid = CheckFrameGraph();
+
+        std::mt19937 random(settings.seed);
+        Vector<TestResource> resources;
+        Vector<TestPass> passes;
+        GraphResult result;
+        uint64_t passesCount = 0, culledPassesCount = 0, heapBytes = 0, texturesBytes = 0;
+        for (uint32_t iGraph = 0; iGraph < settings.graphsCount; ++iGraph)
+        {
+            GenerateGraph(random, &resources, &passes);
+            char label[32];
+            std::snprintf(label, sizeof(label), "random %u", iGraph);
+            if (!RunGraph(label, resources, passes, &result) || !CheckGraph(label, resources, passes, result))
+            {
+                isValid = false;
+                break;
+            }
+
+            passesCount += result.stats.passesCount;
+            culledPassesCount += result.stats.culledPassesCount;
+            heapBytes += result.stats.transientHeapBytes;
+            texturesBytes += result.stats.transientTexturesBytes;
+        }
+
+        ASTEROID_LOG_INFO_F("    random graphs: %llu of %llu passes culled, transient heaps %.1f%% of the textures size",
+            (unsigned long long)culledPassesCount, (unsigned long long)passesCount,
+            texturesBytes > 0 ? 100.0 * heapBytes / texturesBytes : 100.0);
+        return isValid;
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+namespace ASTEROID_NAMESPACE
+{
+    struct RenderGraphTestSettings
+    {
+        /** Random graphs checked after the fixed frame graph. */
+        uint32_t    graphsCount;
+        uint32_t    seed;
+    };
+
+
+    /**
+     *  Compiles and executes render graphs against a NullRenderBackend.\n
+     *  A fixed frame graph with a pass whose output nobody reads, a side-effect pass and transient textures
+     *  with overlapping and disjoint lifetimes must give the exact culling, heap offsets and barriers worked
+     *  out by hand. Random graphs are then checked against a naive model: culled passes, executed order, usage
+     *  flags, textures alive at the same time never sharing memory, the heap size and every recorded barrier.
+     */
+    class RenderGraphTest
+    {
+    public:
+        ASTEROID_NO_DEFAULT_CTOR(RenderGraphTest)
+        ASTEROID_NON_COPYABLE(RenderGraphTest)
+
+        /**
+         *  @return
+         *      False if any check failed.
+         */
+        static bool Run(const RenderGraphTestSettings& settings);
+    };
+}
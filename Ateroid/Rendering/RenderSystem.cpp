@@ -1,9 +1,66 @@
 #include "Precompile.h"
 #include "RenderSystem.h"
+#include "PipelineStateCache.h"
+#include "MeshBufferPool.h"
+#include "MeshRegistry.h"
+#include "Mesh.h"
+#include "InstanceBatcher.h"
+#include "RenderThread.h"
+#include "Core/ObjectManager.h"
 #include "Util/Debug.h"
 
 namespace ASTEROID_NAMESPACE
 {
+    static DXGI_FORMAT ToDxgiFormat(ETextureFormat format)
+    {
+        switch (format)
+        {
+        case ETextureFormat::eRGBA8Unorm:       return DXGI_FORMAT_R8G8B8A8_UNORM;
+        case ETextureFormat::eBGRA8Unorm:       return DXGI_FORMAT_B8G8R8A8_UNORM;
+        case ETextureFormat::eRGB10A2Unorm:     return DXGI_FORMAT_R10G10B10A2_UNORM;
+        case ETextureFormat::eRG11B10Float:     return DXGI_FORMAT_R11G11B10_FLOAT;
+        case ETextureFormat::eRGBA16Float:      return DXGI_FORMAT_R16G16B16A16_FLOAT;
+        case ETextureFormat::eRG16Float:        return DXGI_FORMAT_R16G16_FLOAT;
+        case ETextureFormat::eR16Float:         return DXGI_FORMAT_R16_FLOAT;
+        case ETextureFormat::eR32Float:         return DXGI_FORMAT_R32_FLOAT;
+        case ETextureFormat::eRGBA32Float:      return DXGI_FORMAT_R32G32B32A32_FLOAT;
+        case ETextureFormat::eD32Float:         return DXGI_FORMAT_D32_FLOAT;
+        case ETextureFormat::eD24UnormS8Uint:   return DXGI_FORMAT_D24_UNORM_S8_UINT;
+        default:                                return DXGI_FORMAT_UNKNOWN;
+        }
+    }
+
+    static DXGI_FORMAT ToDxgiFormat(EVertexFormat format)
+    {
+        switch (format)
+        {
+        case EVertexFormat::eR32Float:      return DXGI_FORMAT_R32_FLOAT;
+        case EVertexFormat::eRG32Float:     return DXGI_FORMAT_R32G32_FLOAT;
+        case EVertexFormat::eRGB32Float:    return DXGI_FORMAT_R32G32B32_FLOAT;
+        case EVertexFormat::eRGBA32Float:   return DXGI_FORMAT_R32G32B32A32_FLOAT;
+        case EVertexFormat::eR32Uint:       return DXGI_FORMAT_R32_UINT;
+        case EVertexFormat::eRG32Uint:      return DXGI_FORMAT_R32G32_UINT;
+        case EVertexFormat::eRGB32Uint:     return DXGI_FORMAT_R32G32B32_UINT;
+        case EVertexFormat::eRGBA32Uint:    return DXGI_FORMAT_R32G32B32A32_UINT;
+        case EVertexFormat::eR16Float:      return DXGI_FORMAT_R16_FLOAT;
+        case EVertexFormat::eR16Uint:       return DXGI_FORMAT_R16_UINT;
+        case EVertexFormat::eRG16Float:     return DXGI_FORMAT_R16G16_FLOAT;
+        case EVertexFormat::eRG16Unorm:     return DXGI_FORMAT_R16G16_UNORM;
+        case EVertexFormat::eRG16Snorm:     return DXGI_FORMAT_R16G16_SNORM;
+        case EVertexFormat::eRGBA16Float:   return DXGI_FORMAT_R16G16B16A16_FLOAT;
+        case EVertexFormat::eRGBA16Unorm:   return DXGI_FORMAT_R16G16B16A16_UNORM;
+        case EVertexFormat::eRGBA16Snorm:   return DXGI_FORMAT_R16G16B16A16_SNORM;
+        case EVertexFormat::eRGBA16Uint:    return DXGI_FORMAT_R16G16B16A16_UINT;
+        case EVertexFormat::eRGB10A2Unorm:  return DXGI_FORMAT_R10G10B10A2_UNORM;
+        case EVertexFormat::eRG11B10Float:  return DXGI_FORMAT_R11G11B10_FLOAT;
+        case EVertexFormat::eRGBA8Unorm:    return DXGI_FORMAT_R8G8B8A8_UNORM;
+        case EVertexFormat::eRGBA8Snorm:    return DXGI_FORMAT_R8G8B8A8_SNORM;
+        case EVertexFormat::eRGBA8Uint:     return DXGI_FORMAT_R8G8B8A8_UINT;
+        case EVertexFormat::eBGRA8Unorm:    return DXGI_FORMAT_B8G8R8A8_UNORM;
+        default:                            return DXGI_FORMAT_UNKNOWN;
+        }
+    }
+
     RenderSystem* RenderSystem::_Singleton = nullptr;
 
     RenderSystem* RenderSystem::Create(const DXGI_SWAP_CHAIN_DESC& swapChainDesc)
@@ -16,11 +73,18 @@ namespace ASTEROID_NAMESPACE
         if (pFactory->EnumAdapters(0, &pAdapter) == DXGI_ERROR_NOT_FOUND)
         {
             pFactory->Release();
-            return false;
+            return nullptr;
         }
 
         pFactory->Release();
 
+        // The debug layer is only installed with the SDK, release builds must run without it
+#ifdef _DEBUG
+        UINT createFlags = D3D11_CREATE_DEVICE_FLAG::D3D11_CREATE_DEVICE_DEBUG;
+#else
+        UINT createFlags = 0;
+#endif
+
         HRESULT hr = 0;
         D3D_FEATURE_LEVEL featureLevelRequested = D3D_FEATURE_LEVEL::D3D_FEATURE_LEVEL_11_0;
         D3D_FEATURE_LEVEL featureLevelSupported;
@@ -31,7 +95,7 @@ namespace ASTEROID_NAMESPACE
             pAdapter,
             D3D_DRIVER_TYPE::D3D_DRIVER_TYPE_UNKNOWN,
             nullptr,
-            D3D11_CREATE_DEVICE_FLAG::D3D11_CREATE_DEVICE_DEBUG,
+            createFlags,
             &featureLevelRequested,
             1,
             D3D11_SDK_VERSION,
@@ -50,10 +114,15 @@ namespace ASTEROID_NAMESPACE
     }
 
     RenderSystem::RenderSystem(IDXGISwapChain* pSwapChain, ID3D11Device* pDevice, ID3D11DeviceContext* pContext)
-        : m_SwapChain(pSwapChain), m_Device(pDevice), m_Context(pContext)
+        : m_SwapChain(pSwapChain), m_Device(pDevice), m_Context(pContext), m_InstanceStreamBytes(0),
+        m_UploadRingBytes(0), m_UploadRingDiscard(false), m_SignaledFence(0), m_CompletedFence(0), m_TransientFrame(0)
     {
         ASTEROID_ASSERT(_Singleton == nullptr, "There is already a RenderSystem singleton created.");
         _Singleton = this;
+
+        PipelineStateCache::Create();
+        MeshBufferPool::Create(kMeshVertexPageBytes, kMeshIndexPageBytes);
+        MeshRegistry::Create();
     }
 
     RenderSystem::~RenderSystem()
@@ -69,6 +138,410 @@ namespace ASTEROID_NAMESPACE
         return buffer;
     }
 
+    void RenderSystem::UpdateBuffer(ID3D11Buffer* buffer, uint32_t byteOffset, const void* data, uint32_t bytesCount)
+    {
+        D3D11_BOX box;
+        box.left = byteOffset;
+        box.right = byteOffset + bytesCount;
+        box.top = 0;
+        box.bottom = 1;
+        box.front = 0;
+        box.back = 1;
+        m_Context->UpdateSubresource(buffer, 0, &box, data, 0, 0);
+    }
+
+    D3D11_INPUT_ELEMENT_DESC RenderSystem::ToInputElementDesc(const VertexElement& element)
+    {
+        D3D11_INPUT_ELEMENT_DESC desc;
+        desc.SemanticName = element.semanticName;
+        desc.SemanticIndex = element.semanticIndex;
+        desc.Format = ToDxgiFormat(element.format);
+        desc.InputSlot = element.inputSlot;
+        desc.AlignedByteOffset = element.alignedByteOffset == VertexElement::kAppendAligned ? D3D11_APPEND_ALIGNED_ELEMENT : element.alignedByteOffset;
+        desc.InputSlotClass = element.isPerInstance ? D3D11_INPUT_PER_INSTANCE_DATA : D3D11_INPUT_PER_VERTEX_DATA;
+        desc.InstanceDataStepRate = element.instanceDataStepRate;
+        return desc;
+    }
+
+    ID3D11InputLayoutPtr RenderSystem::CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* descs, uint32_t descsCount, const void* shaderBytecode, size_t bytecodeLength)
+    {
+        ID3D11InputLayoutPtr inputLayout = nullptr;
+        HRESULT hr = m_Device->CreateInputLayout(descs, descsCount, shaderBytecode, bytecodeLength, &inputLayout);
+        return inputLayout;
+    }
+
+    ID3D11VertexShaderPtr RenderSystem::CreateVertexShader(const void* shaderBytecode, size_t bytecodeLength)
+    {
+        ID3D11VertexShaderPtr shader = nullptr;
+        HRESULT hr = m_Device->CreateVertexShader(shaderBytecode, bytecodeLength, nullptr, &shader);
+        return shader;
+    }
+
+    ID3D11PixelShaderPtr RenderSystem::CreatePixelShader(const void* shaderBytecode, size_t bytecodeLength)
+    {
+        ID3D11PixelShaderPtr shader = nullptr;
+        HRESULT hr = m_Device->CreatePixelShader(shaderBytecode, bytecodeLength, nullptr, &shader);
+        return shader;
+    }
+
+    ID3D11RasterizerStatePtr RenderSystem::CreateRasterizerState(const D3D11_RASTERIZER_DESC* desc)
+    {
+        ID3D11RasterizerStatePtr state = nullptr;
+        HRESULT hr = m_Device->CreateRasterizerState(desc, &state);
+        return state;
+    }
+
+    ID3D11BlendStatePtr RenderSystem::CreateBlendState(const D3D11_BLEND_DESC* desc)
+    {
+        ID3D11BlendStatePtr state = nullptr;
+        HRESULT hr = m_Device->CreateBlendState(desc, &state);
+        return state;
+    }
+
+    ID3D11DepthStencilStatePtr RenderSystem::CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC* desc)
+    {
+        ID3D11DepthStencilStatePtr state = nullptr;
+        HRESULT hr = m_Device->CreateDepthStencilState(desc, &state);
+        return state;
+    }
+
+    bool RenderSystem::CreateInstanceStream(uint32_t bytesCount)
+    {
+        D3D11_BUFFER_DESC bufferDesc;
+        bufferDesc.ByteWidth = bytesCount;
+        bufferDesc.Usage = D3D11_USAGE::D3D11_USAGE_DEFAULT;
+        bufferDesc.BindFlags = D3D11_BIND_FLAG::D3D11_BIND_VERTEX_BUFFER;
+        bufferDesc.CPUAccessFlags = 0;
+        bufferDesc.MiscFlags = 0;
+        bufferDesc.StructureByteStride = 0;
+
+        m_InstanceStream = CreateBuffer(&bufferDesc, nullptr);
+        m_InstanceStreamBytes = m_InstanceStream != nullptr ? bytesCount : 0;
+        return m_InstanceStream != nullptr;
+    }
+
+    bool RenderSystem::CopyToInstanceStream(uint32_t byteOffset, uint32_t uploadOffset, uint32_t bytesCount)
+    {
+        if (m_InstanceStream == nullptr || (uint64_t)byteOffset + bytesCount > m_InstanceStreamBytes)
+            return false;
+        if (m_UploadRing == nullptr || (uint64_t)uploadOffset + bytesCount > m_UploadRingBytes)
+            return false;
+
+        D3D11_BOX sourceBox;
+        sourceBox.left = uploadOffset;
+        sourceBox.right = uploadOffset + bytesCount;
+        sourceBox.top = 0;
+        sourceBox.bottom = 1;
+        sourceBox.front = 0;
+        sourceBox.back = 1;
+        m_Context->CopySubresourceRegion(m_InstanceStream.Get(), 0, byteOffset, 0, 0, m_UploadRing.Get(), 0, &sourceBox);
+        return true;
+    }
+
+    void RenderSystem::ResolveMesh(const Mesh& mesh, MeshBinding* binding)
+    {
+        binding->vertexBuffers.resize(mesh.VertexBuffersCount());
+        binding->vertexStrides.resize(mesh.VertexBuffersCount());
+        binding->vertexByteOffsets.resize(mesh.VertexBuffersCount());
+        for (uint32_t iBuffer = 0; iBuffer < mesh.VertexBuffersCount(); ++iBuffer)
+        {
+            binding->vertexBuffers[iBuffer] = mesh.VertexBuffer(iBuffer);
+            binding->vertexStrides[iBuffer] = mesh.VertexStride(iBuffer);
+            binding->vertexByteOffsets[iBuffer] = mesh.VertexByteOffset(iBuffer);
+        }
+        binding->positionStream = mesh.PositionStream();
+        binding->indexBuffer = mesh.IndexBuffer();
+        binding->indexFormat = mesh.IndexFormat();
+        binding->submeshes.resize(mesh.SubmeshesCount());
+        for (uint32_t iSubmesh = 0; iSubmesh < mesh.SubmeshesCount(); ++iSubmesh)
+            binding->submeshes[iSubmesh] = mesh.Submesh(iSubmesh);
+    }
+
+    SharedPtr<const RenderSystem::MeshBindingMap> RenderSystem::ResolveMeshes(const Vector<InstancedDraw>& draws)
+    {
+        ASTEROID_ASSERT(RenderThread::Singleton() == nullptr || !RenderThread::Singleton()->IsRenderThread(),
+            "Meshes have to be resolved on the thread owning them.");
+
+        SharedPtr<MeshBindingMap> bindings = ASTEROID_ALLOCATE_SHARED(MeshBindingMap);
+        for (const InstancedDraw& draw : draws)
+        {
+            if (bindings->find(draw.mesh) != bindings->end())
+                continue;
+
+            // Meshes that can't be found are left out, the draw reports them
+            Mesh* mesh = dynamic_cast<Mesh*>(ObjectManager::Singleton()->FindObject(draw.mesh));
+            if (mesh != nullptr)
+                ResolveMesh(*mesh, &(*bindings)[draw.mesh]);
+        }
+        return bindings;
+    }
+
+    void RenderSystem::DrawIndexedInstanced(const InstancedDraw& draw)
+    {
+        const MeshBinding* mesh = nullptr;
+        RenderThread* renderThread = RenderThread::Singleton();
+        if (renderThread != nullptr && renderThread->IsRenderThread())
+        {
+            if (m_MeshBindings != nullptr)
+            {
+                auto found = m_MeshBindings->find(draw.mesh);
+                if (found != m_MeshBindings->end())
+                    mesh = &found->second;
+            }
+        }
+        else
+        {
+            Mesh* object = dynamic_cast<Mesh*>(ObjectManager::Singleton()->FindObject(draw.mesh));
+            if (object != nullptr)
+            {
+                ResolveMesh(*object, &m_ResolvedMesh);
+                mesh = &m_ResolvedMesh;
+            }
+        }
+
+        if (mesh == nullptr || mesh->indexBuffer == nullptr || draw.submeshIndex >= mesh->submeshes.size())
+        {
+            ASTEROID_LOG_ERROR_F("DrawIndexedInstanced skipped, mesh %d submesh %u is not drawable.", draw.mesh, draw.submeshIndex);
+            return;
+        }
+
+        ID3D11Buffer* vertexBuffers[kInstanceStreamSlot + 1] = { nullptr };
+        UINT strides[kInstanceStreamSlot + 1] = { 0 };
+        UINT offsets[kInstanceStreamSlot + 1] = { 0 };
+        uint32_t positionStream = mesh->positionStream;
+        if (draw.streams == EVertexStreams::ePositionOnly && positionStream < mesh->vertexBuffers.size())
+        {
+            // Depth-only input layouts read positions from slot 0
+            vertexBuffers[0] = mesh->vertexBuffers[positionStream].Get();
+            strides[0] = mesh->vertexStrides[positionStream];
+            offsets[0] = mesh->vertexByteOffsets[positionStream];
+        }
+        else
+        {
+            // Interleaved meshes are bound whole, a depth-only layout reads their positions from slot 0
+            uint32_t buffersCount = std::min((uint32_t)mesh->vertexBuffers.size(), kInstanceStreamSlot);
+            for (uint32_t iBuffer = 0; iBuffer < buffersCount; ++iBuffer)
+            {
+                vertexBuffers[iBuffer] = mesh->vertexBuffers[iBuffer].Get();
+                strides[iBuffer] = mesh->vertexStrides[iBuffer];
+                offsets[iBuffer] = mesh->vertexByteOffsets[iBuffer];
+            }
+        }
+        vertexBuffers[kInstanceStreamSlot] = m_InstanceStream.Get();
+        strides[kInstanceStreamSlot] = sizeof(InstanceTransform);
+
+        m_Context->IASetVertexBuffers(0, kInstanceStreamSlot + 1, vertexBuffers, strides, offsets);
+        m_Context->IASetIndexBuffer(mesh->indexBuffer.Get(), mesh->indexFormat, 0);
+
+        // StartInstanceLocation offsets per-instance fetches, which selects the draw's range of the instance stream.
+        const SubmeshInfo& submesh = mesh->submeshes[draw.submeshIndex];
+        m_Context->DrawIndexedInstanced(submesh.indicesCount, draw.instancesCount, submesh.indexStart, submesh.vertexOffset, draw.firstInstance);
+    }
+
+    bool RenderSystem::CreateUploadRing(uint32_t bytesCount)
+    {
+        D3D11_BUFFER_DESC bufferDesc;
+        bufferDesc.ByteWidth = bytesCount;
+        bufferDesc.Usage = D3D11_USAGE::D3D11_USAGE_DYNAMIC;
+        bufferDesc.BindFlags = D3D11_BIND_FLAG::D3D11_BIND_VERTEX_BUFFER | D3D11_BIND_FLAG::D3D11_BIND_INDEX_BUFFER;
+        bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_FLAG::D3D11_CPU_ACCESS_WRITE;
+        bufferDesc.MiscFlags = 0;
+        bufferDesc.StructureByteStride = 0;
+
+        m_UploadRing = CreateBuffer(&bufferDesc, nullptr);
+        m_UploadRingBytes = m_UploadRing != nullptr ? bytesCount : 0;
+        m_UploadRingDiscard = true;
+        return m_UploadRing != nullptr;
+    }
+
+    uint8_t* RenderSystem::MapUploadRing()
+    {
+        if (m_UploadRing == nullptr)
+            return nullptr;
+
+        // The first map of a new buffer has to discard, afterwards the fences guarantee no range in flight is written.
+        D3D11_MAP mapType = m_UploadRingDiscard ? D3D11_MAP::D3D11_MAP_WRITE_DISCARD : D3D11_MAP::D3D11_MAP_WRITE_NO_OVERWRITE;
+        D3D11_MAPPED_SUBRESOURCE mapped;
+        if (FAILED(m_Context->Map(m_UploadRing.Get(), 0, mapType, 0, &mapped)))
+            return nullptr;
+
+        m_UploadRingDiscard = false;
+        return (uint8_t*)mapped.pData;
+    }
+
+    void RenderSystem::UnmapUploadRing()
+    {
+        m_Context->Unmap(m_UploadRing.Get(), 0);
+    }
+
+    uint64_t RenderSystem::SignalFence()
+    {
+        PendingFence fence;
+        fence.value = ++m_SignaledFence;
+        if (!m_FreeFenceQueries.empty())
+        {
+            fence.query = m_FreeFenceQueries.back();
+            m_FreeFenceQueries.pop_back();
+        }
+        else
+        {
+            D3D11_QUERY_DESC queryDesc;
+            queryDesc.Query = D3D11_QUERY::D3D11_QUERY_EVENT;
+            queryDesc.MiscFlags = 0;
+            if (FAILED(m_Device->CreateQuery(&queryDesc, &fence.query)))
+                ASTEROID_LOG_ERROR_F("Failed to create the query of fence %llu.", fence.value);
+        }
+
+        if (fence.query != nullptr)
+            m_Context->End(fence.query.Get());
+        m_PendingFences.push_back(fence);
+        return fence.value;
+    }
+
+    uint64_t RenderSystem::CompletedFence()
+    {
+        while (!m_PendingFences.empty())
+        {
+            // Fences without a query can't be polled, they complete with the next fence that has one.
+            auto queried = std::find_if(m_PendingFences.begin(), m_PendingFences.end(),
+                [](const PendingFence& fence) { return fence.query != nullptr; });
+            if (queried == m_PendingFences.end())
+                break;
+
+            // Don't flush, the fence was submitted by the time the next frame polls it.
+            BOOL passed = FALSE;
+            if (m_Context->GetData(queried->query.Get(), &passed, sizeof(passed), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK || !passed)
+                break;
+
+            m_FreeFenceQueries.push_back(queried->query);
+            m_CompletedFence = queried->value;
+            m_PendingFences.erase(m_PendingFences.begin(), std::next(queried));
+        }
+        return m_CompletedFence;
+    }
+
+    uint64_t RenderSystem::TransientTextureBytes(const TransientTextureDesc& desc, uint64_t* alignment)
+    {
+        // Same estimate as a placed resource, so the render graph places textures like on heap based APIs.
+        const uint64_t kPlacementAlignment = 64 * 1024;
+        *alignment = kPlacementAlignment;
+        uint64_t bytesCount = desc.Bytes();
+        return (bytesCount + kPlacementAlignment - 1) / kPlacementAlignment * kPlacementAlignment;
+    }
+
+    bool RenderSystem::ReserveTransientHeap(uint64_t bytesCount)
+    {
+        ++m_TransientFrame;
+        for (PooledTexture& texture : m_TransientTextures)
+        {
+            if (texture.texture != nullptr && texture.lastUsedFrame + kTransientTextureFrames < m_TransientFrame)
+                texture = PooledTexture();
+        }
+        return true;
+    }
+
+    uint32_t RenderSystem::AcquireTransientTexture(const TransientTextureDesc& desc, uint64_t heapOffset)
+    {
+        uint32_t freeSlot = (uint32_t)m_TransientTextures.size();
+        for (uint32_t iTexture = 0; iTexture < m_TransientTextures.size(); ++iTexture)
+        {
+            PooledTexture& texture = m_TransientTextures[iTexture];
+            if (texture.texture == nullptr)
+            {
+                freeSlot = std::min(freeSlot, iTexture);
+                continue;
+            }
+
+            // Also within a frame, the caller guarantees textures at the same offset have disjoint lifetimes
+            if (texture.heapOffset == heapOffset && texture.desc == desc)
+            {
+                texture.lastUsedFrame = m_TransientFrame;
+                return iTexture;
+            }
+        }
+
+        if (freeSlot == m_TransientTextures.size())
+            m_TransientTextures.emplace_back();
+
+        PooledTexture& texture = m_TransientTextures[freeSlot];
+        texture.desc = desc;
+        texture.heapOffset = heapOffset;
+        texture.lastUsedFrame = m_TransientFrame;
+        if (!CreateTransientTexture(&texture))
+            ASTEROID_LOG_ERROR_F("Failed to create a transient texture of %ux%u.", desc.width, desc.height);
+        return freeSlot;
+    }
+
+    bool RenderSystem::CreateTransientTexture(PooledTexture* texture)
+    {
+        const TransientTextureDesc& desc = texture->desc;
+
+        // Depth textures read by shaders need a typeless format with separate view formats
+        DXGI_FORMAT format = ToDxgiFormat(desc.format);
+        DXGI_FORMAT textureFormat = format;
+        DXGI_FORMAT shaderFormat = format;
+        bool isShaderReadDepth = (desc.usage & eTextureUsageDepthStencil) && (desc.usage & eTextureUsageShaderResource);
+        if (isShaderReadDepth && format == DXGI_FORMAT_D32_FLOAT)
+        {
+            textureFormat = DXGI_FORMAT_R32_TYPELESS;
+            shaderFormat = DXGI_FORMAT_R32_FLOAT;
+        }
+        else if (isShaderReadDepth && format == DXGI_FORMAT_D24_UNORM_S8_UINT)
+        {
+            textureFormat = DXGI_FORMAT_R24G8_TYPELESS;
+            shaderFormat = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+        }
+
+        D3D11_TEXTURE2D_DESC textureDesc;
+        textureDesc.Width = desc.width;
+        textureDesc.Height = desc.height;
+        textureDesc.MipLevels = 1;
+        textureDesc.ArraySize = 1;
+        textureDesc.Format = textureFormat;
+        textureDesc.SampleDesc.Count = 1;
+        textureDesc.SampleDesc.Quality = 0;
+        textureDesc.Usage = D3D11_USAGE::D3D11_USAGE_DEFAULT;
+        textureDesc.BindFlags = 0;
+        textureDesc.CPUAccessFlags = 0;
+        textureDesc.MiscFlags = 0;
+        if (desc.usage & eTextureUsageRenderTarget)
+            textureDesc.BindFlags |= D3D11_BIND_FLAG::D3D11_BIND_RENDER_TARGET;
+        if (desc.usage & eTextureUsageDepthStencil)
+            textureDesc.BindFlags |= D3D11_BIND_FLAG::D3D11_BIND_DEPTH_STENCIL;
+        if (desc.usage & eTextureUsageShaderResource)
+            textureDesc.BindFlags |= D3D11_BIND_FLAG::D3D11_BIND_SHADER_RESOURCE;
+        if (desc.usage & eTextureUsageUnorderedAccess)
+            textureDesc.BindFlags |= D3D11_BIND_FLAG::D3D11_BIND_UNORDERED_ACCESS;
+
+        if (FAILED(m_Device->CreateTexture2D(&textureDesc, nullptr, &texture->texture)))
+            return false;
+
+        HRESULT hr = S_OK;
+        if (desc.usage & eTextureUsageRenderTarget)
+            hr = m_Device->CreateRenderTargetView(texture->texture.Get(), nullptr, &texture->renderTargetView);
+        if (SUCCEEDED(hr) && (desc.usage & eTextureUsageDepthStencil))
+        {
+            D3D11_DEPTH_STENCIL_VIEW_DESC viewDesc;
+            viewDesc.Format = format;
+            viewDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+            viewDesc.Flags = 0;
+            viewDesc.Texture2D.MipSlice = 0;
+            hr = m_Device->CreateDepthStencilView(texture->texture.Get(), &viewDesc, &texture->depthStencilView);
+        }
+        if (SUCCEEDED(hr) && (desc.usage & eTextureUsageShaderResource))
+        {
+            D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc;
+            viewDesc.Format = shaderFormat;
+            viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+            viewDesc.Texture2D.MostDetailedMip = 0;
+            viewDesc.Texture2D.MipLevels = 1;
+            hr = m_Device->CreateShaderResourceView(texture->texture.Get(), &viewDesc, &texture->shaderResourceView);
+        }
+        if (SUCCEEDED(hr) && (desc.usage & eTextureUsageUnorderedAccess))
+            hr = m_Device->CreateUnorderedAccessView(texture->texture.Get(), nullptr, &texture->unorderedAccessView);
+        return SUCCEEDED(hr);
+    }
+
     bool RenderSystem::Present()
     {
         return SUCCEEDED(m_SwapChain->Present(0, 0));
@@ -76,6 +549,19 @@ namespace ASTEROID_NAMESPACE
 
     void RenderSystem::Finalize()
     {
+        // Pending pipeline states are still being created on the device.
+        PipelineStateCache::Destroy();
+        MeshRegistry::Destroy();
+        // Meshes must be destroyed before the render system, so every range is freed by now.
+        MeshBufferPool::Destroy();
+        m_InstanceStream.Reset();
+        m_MeshBindings.reset();
+        m_ResolvedMesh = MeshBinding();
+        m_UploadRing.Reset();
+        m_PendingFences.clear();
+        m_FreeFenceQueries.clear();
+        m_TransientTextures.clear();
+
         m_SwapChain->Release();
         m_Device->Release();
         m_Context->Release();
@@ -1,9 +1,43 @@
 #pragma once
 
+#include "RenderBackend.h"
+#include "Util/Containers.h"
+#include "Util/Pointers.h"
+
 namespace ASTEROID_NAMESPACE
 {
-    class RenderSystem
+    class Mesh;
+
+
+    /**
+     *  Owns the D3D11 device and implements RenderBackend on top of it.
+     */
+    class RenderSystem : public RenderBackend
     {
+    public:
+        /** Vertex buffer slot the instance stream is bound to. Input layouts read per-instance data from this slot. */
+        static const uint32_t kInstanceStreamSlot = 15;
+        /** Page sizes of the MeshBufferPool created with the render system. */
+        static const uint32_t kMeshVertexPageBytes = 64 * 1024 * 1024;
+        static const uint32_t kMeshIndexPageBytes = 16 * 1024 * 1024;
+
+        /**
+         *  What DrawIndexedInstanced reads from a Mesh, so draws on the render thread don't touch Mesh objects the
+         *  main thread may create or destroy meanwhile. The buffers stay alive as long as the binding.
+         */
+        struct MeshBinding
+        {
+            Vector<ID3D11BufferPtr> vertexBuffers;
+            Vector<uint32_t>        vertexStrides;
+            Vector<uint32_t>        vertexByteOffsets;
+            uint32_t                positionStream;
+            ID3D11BufferPtr         indexBuffer;
+            DXGI_FORMAT             indexFormat;
+            Vector<SubmeshInfo>     submeshes;
+        };
+
+        typedef UnorderedMap<ObjectInstanceID, MeshBinding> MeshBindingMap;
+
     public:
         static RenderSystem* Create(const DXGI_SWAP_CHAIN_DESC& swapChainDesc);
 
@@ -11,19 +45,134 @@ namespace ASTEROID_NAMESPACE
 
         ASTEROID_NON_COPYABLE(RenderSystem)
 
-        ~RenderSystem();
+        virtual ~RenderSystem();
 
         ID3D11BufferPtr CreateBuffer(const D3D11_BUFFER_DESC* desc, const D3D11_SUBRESOURCE_DATA* initialData);
 
-        
+        /**
+         *  Copy data into a range of a DEFAULT usage buffer.
+         */
+        void UpdateBuffer(ID3D11Buffer* buffer, uint32_t byteOffset, const void* data, uint32_t bytesCount);
+
+        /** Input layout element of a mesh vertex element. */
+        static D3D11_INPUT_ELEMENT_DESC ToInputElementDesc(const VertexElement& element);
+
+        ID3D11InputLayoutPtr CreateInputLayout(const D3D11_INPUT_ELEMENT_DESC* descs, uint32_t descsCount, const void* shaderBytecode, size_t bytecodeLength);
+
+        ID3D11VertexShaderPtr CreateVertexShader(const void* shaderBytecode, size_t bytecodeLength);
+
+        ID3D11PixelShaderPtr CreatePixelShader(const void* shaderBytecode, size_t bytecodeLength);
+
+        ID3D11RasterizerStatePtr CreateRasterizerState(const D3D11_RASTERIZER_DESC* desc);
+
+        ID3D11BlendStatePtr CreateBlendState(const D3D11_BLEND_DESC* desc);
+
+        ID3D11DepthStencilStatePtr CreateDepthStencilState(const D3D11_DEPTH_STENCIL_DESC* desc);
+
+
+        /**
+         *  (Re)create the instance stream buffer read by DrawIndexedInstanced.
+         */
+        bool CreateInstanceStream(uint32_t bytesCount);
 
-        bool Present();
+        /**
+         *  Override RenderBackend::CopyToInstanceStream
+         *  @remarks
+         *      The instance stream is a DEFAULT buffer, the copy from the upload ring is a CopySubresourceRegion.
+         */
+        virtual bool CopyToInstanceStream(uint32_t byteOffset, uint32_t uploadOffset, uint32_t bytesCount) override;
+
+        /**
+         *  Override RenderBackend::DrawIndexedInstanced
+         *  @remarks
+         *      Binds the mesh buffers and the instance stream. The pipeline state of the material has to be bound
+         *      by the caller.\n
+         *      On the render thread meshes are looked up in the bindings set by SetMeshBindings, elsewhere they are
+         *      resolved through the ObjectManager.
+         */
+        virtual void DrawIndexedInstanced(const InstancedDraw& draw) override;
+
+        /**
+         *  Capture the meshes of draws, on the main thread while recording a frame packet.
+         */
+        static SharedPtr<const MeshBindingMap> ResolveMeshes(const Vector<InstancedDraw>& draws);
+
+        /**
+         *  Meshes the following draws read, set by a packet command with the result of ResolveMeshes.
+         */
+        void SetMeshBindings(const SharedPtr<const MeshBindingMap>& bindings) { m_MeshBindings = bindings; }
+
+        /**
+         *  Override RenderBackend::CreateUploadRing
+         *  @remarks
+         *      The ring is a DYNAMIC buffer bindable as vertex and index buffer. D3D11 can't keep it mapped
+         *      across submissions, so it is mapped with WRITE_NO_OVERWRITE every frame instead.
+         */
+        virtual bool CreateUploadRing(uint32_t bytesCount) override;
+        virtual uint8_t* MapUploadRing() override;
+        virtual void UnmapUploadRing() override;
+
+        /**
+         *  Override RenderBackend::SignalFence
+         *  @remarks
+         *      Fences are emulated with event queries, which are recycled once they are passed. A fence whose query
+         *      couldn't be created completes with the next fence that has one, as the GPU passes them in order.
+         */
+        virtual uint64_t SignalFence() override;
+        virtual uint64_t CompletedFence() override;
+
+        ID3D11Buffer* UploadRingBuffer() const { return m_UploadRing.Get(); }
+
+        /**
+         *  Override RenderBackend::TransientTextureBytes
+         *  @remarks
+         *      D3D11 can't place resources in a heap, so transient textures are pooled instead. A texture is shared
+         *      by every acquisition of the same description at the same heap offset, in the same frame or later ones.
+         *      Textures placed at the same offset are never used at the same time, so the aliasing of the render
+         *      graph turns into sharing between textures with matching descriptions.
+         */
+        virtual uint64_t TransientTextureBytes(const TransientTextureDesc& desc, uint64_t* alignment) override;
+        virtual bool ReserveTransientHeap(uint64_t bytesCount) override;
+        virtual uint32_t AcquireTransientTexture(const TransientTextureDesc& desc, uint64_t heapOffset) override;
+
+        /**
+         *  Override RenderBackend::Barrier
+         *  @remarks
+         *      The D3D11 runtime tracks hazards itself, nothing to do.
+         */
+        virtual void Barrier(const ResourceBarrier& barrier) override {}
+
+        ID3D11Texture2D* TransientTexture(uint32_t texture) const { return m_TransientTextures[texture].texture.Get(); }
+        ID3D11RenderTargetView* TransientRenderTargetView(uint32_t texture) const { return m_TransientTextures[texture].renderTargetView.Get(); }
+        ID3D11DepthStencilView* TransientDepthStencilView(uint32_t texture) const { return m_TransientTextures[texture].depthStencilView.Get(); }
+        ID3D11ShaderResourceView* TransientShaderResourceView(uint32_t texture) const { return m_TransientTextures[texture].shaderResourceView.Get(); }
+        ID3D11UnorderedAccessView* TransientUnorderedAccessView(uint32_t texture) const { return m_TransientTextures[texture].unorderedAccessView.Get(); }
+
+        virtual bool Present() override;
 
     private:
         RenderSystem(IDXGISwapChain* pSwapChain, ID3D11Device* pDevice, ID3D11DeviceContext* pContext);
 
         void Finalize();
 
+        struct PooledTexture
+        {
+            TransientTextureDesc         desc;
+            uint64_t                     heapOffset;
+            uint64_t                     lastUsedFrame;
+            ID3D11Texture2DPtr           texture;
+            ID3D11RenderTargetViewPtr    renderTargetView;
+            ID3D11DepthStencilViewPtr    depthStencilView;
+            ID3D11ShaderResourceViewPtr  shaderResourceView;
+            ID3D11UnorderedAccessViewPtr unorderedAccessView;
+        };
+
+        bool CreateTransientTexture(PooledTexture* texture);
+        static void ResolveMesh(const Mesh& mesh, MeshBinding* binding);
+
+        /** Pooled transient textures not acquired for this many frames are released. */
+        static const uint64_t kTransientTextureFrames = 8;
+
     public:
         static RenderSystem* _Singleton;
 
@@ -31,5 +180,27 @@ namespace ASTEROID_NAMESPACE
         IDXGISwapChain* m_SwapChain;
         ID3D11Device* m_Device;
         ID3D11DeviceContext* m_Context;
+        ID3D11BufferPtr m_InstanceStream;
+        uint32_t m_InstanceStreamBytes;
+        SharedPtr<const MeshBindingMap> m_MeshBindings;
+        /** Mesh of the current draw when not on the render thread, reused to keep its capacity. */
+        MeshBinding m_ResolvedMesh;
+
+        struct PendingFence
+        {
+            uint64_t value;
+            ID3D11QueryPtr query;
+        };
+
+        ID3D11BufferPtr m_UploadRing;
+        uint32_t m_UploadRingBytes;
+        bool m_UploadRingDiscard;
+        List<PendingFence> m_PendingFences;
+        Vector<ID3D11QueryPtr> m_FreeFenceQueries;
+        uint64_t m_SignaledFence;
+        uint64_t m_CompletedFence;
+
+        Vector<PooledTexture> m_TransientTextures;
+        uint64_t m_TransientFrame;
     };
 }
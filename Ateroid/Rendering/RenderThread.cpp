@@ -0,0 +1,112 @@
+#include "Precompile.h"
+#include "RenderThread.h"
+#include "Util/Debug.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    RenderThread* RenderThread::_Singleton = nullptr;
+
+    RenderThread::RenderThread(RenderBackend* backend, uint32_t maxFrameLatency)
+        : m_Backend(backend), m_SubmittedFrames(0), m_CompletedFrames(0), m_MaxFrameLatency(1),
+        m_IsRecording(false), m_IsQuitting(false)
+    {
+        SetMaxFrameLatency(maxFrameLatency);
+
+        // Start last, the thread reads every member above
+        m_Thread = std::thread(&RenderThread::ThreadMain, this);
+        ASTEROID_LOG_INFO_F("RenderThread created with a maximum frame latency of %u.", m_MaxFrameLatency);
+    }
+
+    RenderThread::~RenderThread()
+    {
+        ASTEROID_ASSERT(!m_IsRecording, "RenderThread destroyed between BeginFrame and EndFrame.");
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_IsQuitting = true;
+        }
+        m_SubmitCondition.notify_one();
+        m_Thread.join();
+    }
+
+    FramePacket* RenderThread::BeginFrame()
+    {
+        ASTEROID_ASSERT(!m_IsRecording, "RenderThread::BeginFrame called twice without EndFrame.");
+
+        // At most m_MaxFrameLatency frames are in flight here, so the packet of the new frame is never one the
+        // render thread is still reading.
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_CompleteCondition.wait(lock, [this]() { return m_SubmittedFrames - m_CompletedFrames <= m_MaxFrameLatency; });
+
+        FramePacket* packet = &m_Packets[m_SubmittedFrames % kPacketsCount];
+        packet->m_FrameIndex = m_SubmittedFrames;
+        m_IsRecording = true;
+        return packet;
+    }
+
+    void RenderThread::EndFrame()
+    {
+        ASTEROID_ASSERT(m_IsRecording, "RenderThread::EndFrame called without BeginFrame.");
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            ++m_SubmittedFrames;
+            m_IsRecording = false;
+        }
+        m_SubmitCondition.notify_one();
+    }
+
+    void RenderThread::Flush()
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_CompleteCondition.wait(lock, [this]() { return m_CompletedFrames == m_SubmittedFrames; });
+    }
+
+    void RenderThread::SetMaxFrameLatency(uint32_t framesCount)
+    {
+        // Compared by value, std::min would bind the in-class constant to a reference that has no definition
+        uint32_t latency = std::max(framesCount, 1u);
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_MaxFrameLatency = latency < kMaxFrameLatency ? latency : kMaxFrameLatency;
+        }
+        m_CompleteCondition.notify_all();
+    }
+
+    uint64_t RenderThread::SubmittedFrames() const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_SubmittedFrames;
+    }
+
+    uint64_t RenderThread::CompletedFrames() const
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_CompletedFrames;
+    }
+
+    void RenderThread::ThreadMain()
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        while (true)
+        {
+            // Frames submitted before quitting are still executed
+            m_SubmitCondition.wait(lock, [this]() { return m_CompletedFrames < m_SubmittedFrames || m_IsQuitting; });
+            if (m_CompletedFrames == m_SubmittedFrames)
+                break;
+
+            FramePacket& packet = m_Packets[m_CompletedFrames % kPacketsCount];
+            lock.unlock();
+
+            for (const FramePacket::Command& command : packet.m_Commands)
+                command(m_Backend);
+            if (!m_Backend->Present())
+                ASTEROID_LOG_WARNING_F("RenderThread failed to present frame %llu.", (unsigned long long)packet.m_FrameIndex);
+
+            // Keep the capacity, the packet is reused kPacketsCount frames later
+            packet.m_Commands.clear();
+
+            lock.lock();
+            ++m_CompletedFrames;
+            m_CompleteCondition.notify_all();
+        }
+    }
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "RenderBackend.h"
+#include "Util/Containers.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  Render commands of one frame, recorded by the main thread and executed by the render thread.
+     */
+    class FramePacket
+    {
+        friend class RenderThread;
+
+    public:
+        using Command = std::function<void(RenderBackend* backend)>;
+
+    public:
+        FramePacket() : m_FrameIndex(0) {}
+
+        ASTEROID_NON_COPYABLE(FramePacket)
+
+        /**
+         *  Append a command, commands run in the order they were added.
+         *  @remarks
+         *      The command runs after the main thread has moved on, so it must capture by value whatever it reads.
+         *      Captures are released on the render thread once the frame has been presented.
+         */
+        void Add(const Command& command) { m_Commands.push_back(command); }
+
+        /** Index of the frame, starting at 0. */
+        uint64_t FrameIndex() const { return m_FrameIndex; }
+
+    private:
+        Vector<Command> m_Commands;
+        uint64_t        m_FrameIndex;
+    };
+
+
+    /**
+     *  A thread submitting frames to a RenderBackend, so simulating frame N on the main thread overlaps the
+     *  submission of frame N-1.\n
+     *  Frame packets are kept in a ring of kMaxFrameLatency + 1 packets, which are double buffered with a latency
+     *  of 1 and triple buffered with a latency of 2.
+     *  @remarks
+     *      Once created, the render thread owns the backend: anything touching the device context has to be
+     *      recorded into a packet instead of being called directly. The MeshBufferPool queues its uploads and
+     *      records them with MeshBufferPool::RecordUploads, and commands drawing meshes set the bindings resolved
+     *      with RenderSystem::ResolveMeshes while the packet was recorded.\n
+     *      Usage per frame on the main thread: BeginFrame, add commands to the packet, then EndFrame.
+     */
+    class RenderThread
+    {
+    public:
+        static const uint32_t kMaxFrameLatency = 3;
+
+    public:
+        ASTEROID_NON_COPYABLE(RenderThread)
+
+        /**
+         *  Create the RenderThread singleton and start the thread.
+         *  @param maxFrameLatency
+         *      Numbers of frames the render thread may lag behind the main thread, see SetMaxFrameLatency.
+         */
+        static RenderThread* Create(RenderBackend* backend, uint32_t maxFrameLatency)
+        {
+            ASTEROID_ASSERT(_Singleton == nullptr, "There is already a RenderThread singleton created.");
+            _Singleton = ASTEROID_NEW RenderThread(backend, maxFrameLatency);
+            return _Singleton;
+        }
+
+        /**
+         *  Destroy the RenderThread singleton. Frames already submitted are executed before the thread exits.
+         */
+        static void Destroy()
+        {
+            ASTEROID_DELETE _Singleton;
+            _Singleton = nullptr;
+        }
+
+        static RenderThread* Singleton() { return _Singleton; }
+
+        ~RenderThread();
+
+        /**
+         *  Get the packet of the next frame, blocks while the render thread lags too far behind.
+         */
+        FramePacket* BeginFrame();
+
+        /**
+         *  Hand the packet returned by BeginFrame over to the render thread.
+         */
+        void EndFrame();
+
+        /**
+         *  Block until every submitted frame has been presented, e.g. before destroying resources the packets use.
+         */
+        void Flush();
+
+        /**
+         *  Clamped to [1, kMaxFrameLatency]. Lower values reduce input latency, higher values absorb spikes of
+         *  either thread.
+         */
+        void SetMaxFrameLatency(uint32_t framesCount);
+        uint32_t MaxFrameLatency() const { return m_MaxFrameLatency; }
+
+        /** Numbers of frames handed over by EndFrame. */
+        uint64_t SubmittedFrames() const;
+        /** Numbers of frames the render thread has presented. */
+        uint64_t CompletedFrames() const;
+
+        bool IsRenderThread() const { return std::this_thread::get_id() == m_Thread.get_id(); }
+
+    private:
+        static const uint32_t kPacketsCount = kMaxFrameLatency + 1;
+
+        RenderThread(RenderBackend* backend, uint32_t maxFrameLatency);
+
+        void ThreadMain();
+
+    private:
+        static RenderThread* _Singleton;
+
+    private:
+        RenderBackend*          m_Backend;
+        FramePacket             m_Packets[kPacketsCount];
+        uint64_t                m_SubmittedFrames;
+        uint64_t                m_CompletedFrames;
+        uint32_t                m_MaxFrameLatency;
+        bool                    m_IsRecording;
+        bool                    m_IsQuitting;
+        mutable std::mutex      m_Mutex;
+        std::condition_variable m_SubmitCondition;
+        std::condition_variable m_CompleteCondition;
+        std::thread             m_Thread;
+    };
+}
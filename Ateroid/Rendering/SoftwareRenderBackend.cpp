@@ -0,0 +1,435 @@
+#include "Precompile.h"
+#include "SoftwareRenderBackend.h"
+#include "InstanceBatcher.h"
+#include "Core/JobSystem.h"
+#include "Util/Debug.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ASTEROID_SOFTWARE_RENDER_SSE
+#include <immintrin.h>
+#endif
+
+namespace ASTEROID_NAMESPACE
+{
+    /** Vertices are snapped to 1/16 of a pixel, like hardware rasterizers do. */
+    static const float kSubpixelSteps = 16.0f;
+
+    static float SnapToSubpixel(float value)
+    {
+        return std::floor(value * kSubpixelSteps + 0.5f) / kSubpixelSteps;
+    }
+
+    static Float4 LerpVertex(const Float4& a, const Float4& b, float t)
+    {
+        return Float4(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t, a.z + (b.z - a.z) * t, a.w + (b.w - a.w) * t);
+    }
+
+    SoftwareRenderBackend::SoftwareRenderBackend(uint32_t width, uint32_t height, uint32_t instanceStreamBytes)
+        : m_Width(width), m_Height(height), m_Pitch((width + 3) & ~3u),
+        m_TilesX((width + kTileSize - 1) / kTileSize), m_TilesY((height + kTileSize - 1) / kTileSize),
+        m_Color(m_Pitch * height, 0), m_Depth(m_Pitch * height, 1.0f), m_InstanceStream(instanceStreamBytes, 0),
+        m_SignaledFence(0), m_TransientTexturesCount(0)
+    {
+        static_assert(kTileSize % 4 == 0, "Tiles must contain whole SIMD groups of pixels.");
+
+        m_Bins.resize(m_TilesX * m_TilesY);
+        std::memset(&m_ViewProjection, 0, sizeof(m_ViewProjection));
+        m_ViewProjection._11 = m_ViewProjection._22 = m_ViewProjection._33 = m_ViewProjection._44 = 1.0f;
+        SetLightDirection(Float3(0.3f, -1.0f, 0.5f));
+        std::memset(&m_Stats, 0, sizeof(m_Stats));
+    }
+
+    bool SoftwareRenderBackend::CopyToInstanceStream(uint32_t byteOffset, uint32_t uploadOffset, uint32_t bytesCount)
+    {
+        if ((uint64_t)byteOffset + bytesCount > m_InstanceStream.size() || (uint64_t)uploadOffset + bytesCount > m_UploadRing.size())
+            return false;
+
+        std::memcpy(m_InstanceStream.data() + byteOffset, m_UploadRing.data() + uploadOffset, bytesCount);
+        return true;
+    }
+
+    void SoftwareRenderBackend::DrawIndexedInstanced(const InstancedDraw& draw)
+    {
+        auto foundMesh = m_Meshes.find(draw.mesh);
+        if (foundMesh == m_Meshes.end() || draw.submeshIndex >= foundMesh->second.submeshes.size())
+        {
+            ASTEROID_LOG_ERROR_F("DrawIndexedInstanced skipped, mesh %d submesh %u is not registered.", draw.mesh, draw.submeshIndex);
+            return;
+        }
+        if (((uint64_t)draw.firstInstance + draw.instancesCount) * sizeof(InstanceTransform) > m_InstanceStream.size())
+        {
+            ASTEROID_LOG_ERROR("DrawIndexedInstanced skipped, the instances are outside the instance stream.");
+            return;
+        }
+
+        const SoftwareMesh& mesh = foundMesh->second;
+        const SubmeshInfo& submesh = mesh.submeshes[draw.submeshIndex];
+        auto foundColor = m_MaterialColors.find(draw.material);
+        uint32_t materialColor = foundColor != m_MaterialColors.end() ? foundColor->second : 0xFFFFFFFF;
+        const Float4x4& m = m_ViewProjection;
+
+        const InstanceTransform* instances = reinterpret_cast<const InstanceTransform*>(m_InstanceStream.data()) + draw.firstInstance;
+        for (uint32_t iInstance = 0; iInstance < draw.instancesCount; ++iInstance)
+        {
+            const InstanceTransform& instance = instances[iInstance];
+            for (uint32_t iIndex = 0; iIndex + 2 < submesh.indicesCount; iIndex += 3)
+            {
+                Float3 world[3];
+                Float4 clip[3];
+                bool isValid = true;
+                for (uint32_t iVertex = 0; iVertex < 3; ++iVertex)
+                {
+                    uint32_t index = submesh.indexStart + iIndex + iVertex;
+                    int64_t vertex = index < mesh.indices.size() ? (int64_t)mesh.indices[index] + submesh.vertexOffset : -1;
+                    if (vertex < 0 || vertex >= (int64_t)mesh.positions.size())
+                    {
+                        isValid = false;
+                        break;
+                    }
+
+                    // Same math as the vertex shader, see InstanceTransform
+                    const Float3& p = mesh.positions[(size_t)vertex];
+                    const float(*rows)[4] = instance.rows;
+                    world[iVertex] = Float3(
+                        rows[0][0] * p.x + rows[0][1] * p.y + rows[0][2] * p.z + rows[0][3],
+                        rows[1][0] * p.x + rows[1][1] * p.y + rows[1][2] * p.z + rows[1][3],
+                        rows[2][0] * p.x + rows[2][1] * p.y + rows[2][2] * p.z + rows[2][3]);
+                    const Float3& w = world[iVertex];
+                    clip[iVertex] = Float4(
+                        w.x * m._11 + w.y * m._21 + w.z * m._31 + m._41,
+                        w.x * m._12 + w.y * m._22 + w.z * m._32 + m._42,
+                        w.x * m._13 + w.y * m._23 + w.z * m._33 + m._43,
+                        w.x * m._14 + w.y * m._24 + w.z * m._34 + m._44);
+                }
+                ++m_Stats.trianglesCount;
+                if (!isValid)
+                    continue;
+
+                // Flat lambert shading with the world space face normal
+                float e1x = world[1].x - world[0].x, e1y = world[1].y - world[0].y, e1z = world[1].z - world[0].z;
+                float e2x = world[2].x - world[0].x, e2y = world[2].y - world[0].y, e2z = world[2].z - world[0].z;
+                float nx = e1y * e2z - e1z * e2y, ny = e1z * e2x - e1x * e2z, nz = e1x * e2y - e1y * e2x;
+                float length = std::sqrt(nx * nx + ny * ny + nz * nz);
+                float lambert = length > 0.0f
+                    ? -(nx * m_LightDirection.x + ny * m_LightDirection.y + nz * m_LightDirection.z) / length
+                    : 0.0f;
+                float intensity = 0.2f + 0.8f * std::max(lambert, 0.0f);
+
+                uint32_t color = materialColor & 0xFF000000;
+                for (uint32_t shift = 0; shift < 24; shift += 8)
+                    color |= (uint32_t)(((materialColor >> shift) & 0xFF) * intensity + 0.5f) << shift;
+
+                SetupTriangle(clip, color);
+            }
+        }
+    }
+
+    void SoftwareRenderBackend::SetupTriangle(const Float4* clip, uint32_t color)
+    {
+        // Clip against the near plane z >= 0 only, x and y are handled by clamping to the screen
+        Float4 polygon[4];
+        uint32_t verticesCount = 0;
+        bool isBeyondFar = true;
+        for (uint32_t iVertex = 0; iVertex < 3; ++iVertex)
+        {
+            const Float4& current = clip[iVertex];
+            const Float4& next = clip[(iVertex + 1) % 3];
+            isBeyondFar = isBeyondFar && current.z > current.w;
+            if (current.z >= 0.0f)
+                polygon[verticesCount++] = current;
+            if ((current.z >= 0.0f) != (next.z >= 0.0f))
+                polygon[verticesCount++] = LerpVertex(current, next, current.z / (current.z - next.z));
+        }
+        if (verticesCount < 3 || isBeyondFar)
+            return;
+
+        for (uint32_t iVertex = 0; iVertex < verticesCount; ++iVertex)
+        {
+            Float4& v = polygon[iVertex];
+            if (v.w <= 0.0f)
+                return;
+
+            float invW = 1.0f / v.w;
+            v.x = SnapToSubpixel((v.x * invW * 0.5f + 0.5f) * m_Width);
+            v.y = SnapToSubpixel((0.5f - v.y * invW * 0.5f) * m_Height);
+            v.z = v.z * invW;
+        }
+
+        BinTriangle(polygon[0], polygon[1], polygon[2], color);
+        if (verticesCount == 4)
+            BinTriangle(polygon[0], polygon[2], polygon[3], color);
+    }
+
+    void SoftwareRenderBackend::BinTriangle(const Float4& v0, const Float4& v1, const Float4& v2, uint32_t color)
+    {
+        // Clockwise on screen is a positive area with y pointing down, anything else faces away
+        float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+        if (area <= 0.0f)
+            return;
+
+        float minX = std::max(std::min(std::min(v0.x, v1.x), v2.x), 0.0f);
+        float minY = std::max(std::min(std::min(v0.y, v1.y), v2.y), 0.0f);
+        float maxX = std::min(std::max(std::max(v0.x, v1.x), v2.x), (float)m_Width - 1.0f);
+        float maxY = std::min(std::max(std::max(v0.y, v1.y), v2.y), (float)m_Height - 1.0f);
+        if (minX > maxX || minY > maxY)
+            return;
+
+        Triangle triangle;
+        const Float4* vertices[3] = { &v0, &v1, &v2 };
+        for (uint32_t iEdge = 0; iEdge < 3; ++iEdge)
+        {
+            // Edge i is opposite to vertex i, so its function divided by the area is the barycentric of vertex i
+            const Float4& a = *vertices[(iEdge + 1) % 3];
+            const Float4& b = *vertices[(iEdge + 2) % 3];
+            float dx = b.x - a.x;
+            float dy = b.y - a.y;
+            triangle.edgeA[iEdge] = -dy;
+            triangle.edgeB[iEdge] = dx;
+            triangle.edgeC[iEdge] = dy * a.x - dx * a.y;
+            triangle.isTopLeft[iEdge] = dy < 0.0f || (dy == 0.0f && dx > 0.0f);
+        }
+
+        float invArea = 1.0f / area;
+        triangle.depthA = (triangle.edgeA[0] * v0.z + triangle.edgeA[1] * v1.z + triangle.edgeA[2] * v2.z) * invArea;
+        triangle.depthB = (triangle.edgeB[0] * v0.z + triangle.edgeB[1] * v1.z + triangle.edgeB[2] * v2.z) * invArea;
+        triangle.depthC = (triangle.edgeC[0] * v0.z + triangle.edgeC[1] * v1.z + triangle.edgeC[2] * v2.z) * invArea;
+        triangle.minX = (uint32_t)minX;
+        triangle.minY = (uint32_t)minY;
+        triangle.maxX = (uint32_t)maxX;
+        triangle.maxY = (uint32_t)maxY;
+        triangle.color = color;
+
+        uint32_t triangleIndex = (uint32_t)m_Triangles.size();
+        m_Triangles.push_back(triangle);
+        ++m_Stats.rasterizedTrianglesCount;
+        for (uint32_t iTileY = triangle.minY / kTileSize; iTileY <= triangle.maxY / kTileSize; ++iTileY)
+        {
+            for (uint32_t iTileX = triangle.minX / kTileSize; iTileX <= triangle.maxX / kTileSize; ++iTileX)
+            {
+                m_Bins[iTileY * m_TilesX + iTileX].push_back(triangleIndex);
+                ++m_Stats.binnedTrianglesCount;
+            }
+        }
+    }
+
+    void SoftwareRenderBackend::RasterizeTile(uint32_t tile)
+    {
+        uint32_t tileMinX = (tile % m_TilesX) * kTileSize;
+        uint32_t tileMinY = (tile / m_TilesX) * kTileSize;
+        uint32_t tileMaxX = std::min(tileMinX + kTileSize, m_Width) - 1;
+        uint32_t tileMaxY = std::min(tileMinY + kTileSize, m_Height) - 1;
+#ifdef ASTEROID_SOFTWARE_RENDER_SSE
+        const __m128 kLaneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        const __m128 kZero = _mm_setzero_ps();
+        const __m128 kOne = _mm_set1_ps(1.0f);
+
+        for (uint32_t triangleIndex : m_Bins[tile])
+        {
+            const Triangle& triangle = m_Triangles[triangleIndex];
+            uint32_t minX = std::max(triangle.minX, tileMinX) & ~3u;
+            uint32_t maxX = std::min(triangle.maxX, tileMaxX);
+            uint32_t minY = std::max(triangle.minY, tileMinY);
+            uint32_t maxY = std::min(triangle.maxY, tileMaxY);
+
+            __m128 edgeA[3], edgeB[3], edgeC[3];
+            for (uint32_t iEdge = 0; iEdge < 3; ++iEdge)
+            {
+                edgeA[iEdge] = _mm_set1_ps(triangle.edgeA[iEdge]);
+                edgeB[iEdge] = _mm_set1_ps(triangle.edgeB[iEdge]);
+                edgeC[iEdge] = _mm_set1_ps(triangle.edgeC[iEdge]);
+            }
+            __m128 depthA = _mm_set1_ps(triangle.depthA);
+            __m128 depthB = _mm_set1_ps(triangle.depthB);
+            __m128 depthC = _mm_set1_ps(triangle.depthC);
+            __m128i color = _mm_set1_epi32((int)triangle.color);
+
+            for (uint32_t y = minY; y <= maxY; ++y)
+            {
+                __m128 pixelY = _mm_set1_ps(y + 0.5f);
+                for (uint32_t x = minX; x <= maxX; x += 4)
+                {
+                    // Pixel centers of four neighbours. Lanes outside the triangle's bounds fail the edge tests,
+                    // and lanes past the image end only touch the row padding.
+                    __m128 pixelX = _mm_add_ps(_mm_set1_ps((float)x), kLaneOffsets);
+                    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                    for (uint32_t iEdge = 0; iEdge < 3; ++iEdge)
+                    {
+                        __m128 edge = _mm_add_ps(_mm_add_ps(_mm_mul_ps(edgeA[iEdge], pixelX), _mm_mul_ps(edgeB[iEdge], pixelY)), edgeC[iEdge]);
+                        inside = _mm_and_ps(inside, triangle.isTopLeft[iEdge] ? _mm_cmpge_ps(edge, kZero) : _mm_cmpgt_ps(edge, kZero));
+                    }
+                    if (_mm_movemask_ps(inside) == 0)
+                        continue;
+
+                    uint32_t pixel = y * m_Pitch + x;
+                    __m128 depth = _mm_add_ps(_mm_add_ps(_mm_mul_ps(depthA, pixelX), _mm_mul_ps(depthB, pixelY)), depthC);
+                    __m128 storedDepth = _mm_load_ps(&m_Depth[pixel]);
+                    inside = _mm_and_ps(inside, _mm_cmplt_ps(depth, storedDepth));
+                    inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpge_ps(depth, kZero), _mm_cmple_ps(depth, kOne)));
+
+                    __m128i writeMask = _mm_castps_si128(inside);
+                    _mm_store_ps(&m_Depth[pixel], _mm_or_ps(_mm_and_ps(inside, depth), _mm_andnot_ps(inside, storedDepth)));
+                    __m128i storedColor = _mm_load_si128(reinterpret_cast<const __m128i*>(&m_Color[pixel]));
+                    _mm_store_si128(reinterpret_cast<__m128i*>(&m_Color[pixel]),
+                        _mm_or_si128(_mm_and_si128(writeMask, color), _mm_andnot_si128(writeMask, storedColor)));
+                }
+            }
+        }
+#else
+        // The tests of the SSE path pixel by pixel, so both render the same images
+        const float kLaneOffsets[4] = { 0.5f, 1.5f, 2.5f, 3.5f };
+        for (uint32_t triangleIndex : m_Bins[tile])
+        {
+            const Triangle& triangle = m_Triangles[triangleIndex];
+            uint32_t minX = std::max(triangle.minX, tileMinX) & ~3u;
+            uint32_t maxX = std::min(triangle.maxX, tileMaxX);
+            uint32_t minY = std::max(triangle.minY, tileMinY);
+            uint32_t maxY = std::min(triangle.maxY, tileMaxY);
+
+            for (uint32_t y = minY; y <= maxY; ++y)
+            {
+                float pixelY = y + 0.5f;
+                for (uint32_t x = minX; x <= maxX; x += 4)
+                {
+                    for (uint32_t lane = 0; lane < 4; ++lane)
+                    {
+                        float pixelX = (float)x + kLaneOffsets[lane];
+                        bool isInside = true;
+                        for (uint32_t iEdge = 0; iEdge < 3; ++iEdge)
+                        {
+                            float edge = (triangle.edgeA[iEdge] * pixelX + triangle.edgeB[iEdge] * pixelY) + triangle.edgeC[iEdge];
+                            isInside = isInside && (triangle.isTopLeft[iEdge] ? edge >= 0.0f : edge > 0.0f);
+                        }
+
+                        uint32_t pixel = y * m_Pitch + x + lane;
+                        float depth = (triangle.depthA * pixelX + triangle.depthB * pixelY) + triangle.depthC;
+                        if (isInside && depth < m_Depth[pixel] && depth >= 0.0f && depth <= 1.0f)
+                        {
+                            m_Depth[pixel] = depth;
+                            m_Color[pixel] = triangle.color;
+                        }
+                    }
+                }
+            }
+        }
+#endif
+    }
+
+    bool SoftwareRenderBackend::CreateUploadRing(uint32_t bytesCount)
+    {
+        m_UploadRing.assign(bytesCount, 0);
+        return true;
+    }
+
+    uint8_t* SoftwareRenderBackend::MapUploadRing()
+    {
+        return m_UploadRing.empty() ? nullptr : m_UploadRing.data();
+    }
+
+    void SoftwareRenderBackend::UnmapUploadRing()
+    {
+    }
+
+    uint64_t SoftwareRenderBackend::SignalFence()
+    {
+        return ++m_SignaledFence;
+    }
+
+    uint64_t SoftwareRenderBackend::CompletedFence()
+    {
+        return m_SignaledFence;
+    }
+
+    uint64_t SoftwareRenderBackend::TransientTextureBytes(const TransientTextureDesc& desc, uint64_t* alignment)
+    {
+        *alignment = 256;
+        uint64_t bytesCount = desc.Bytes();
+        return (bytesCount + 255) / 256 * 256;
+    }
+
+    bool SoftwareRenderBackend::ReserveTransientHeap(uint64_t)
+    {
+        m_TransientTexturesCount = 0;
+        return true;
+    }
+
+    uint32_t SoftwareRenderBackend::AcquireTransientTexture(const TransientTextureDesc&, uint64_t)
+    {
+        return m_TransientTexturesCount++;
+    }
+
+    bool SoftwareRenderBackend::Present()
+    {
+        auto rasterizeTiles = [this](uint32_t beginTile, uint32_t endTile)
+        {
+            for (uint32_t iTile = beginTile; iTile < endTile; ++iTile)
+                RasterizeTile(iTile);
+        };
+
+        // Tiles own disjoint pixels, so they run in parallel without synchronization
+        uint32_t tilesCount = (uint32_t)m_Bins.size();
+        JobSystem* jobSystem = JobSystem::Singleton();
+        if (jobSystem != nullptr)
+            jobSystem->ParallelFor(tilesCount, 1, rasterizeTiles);
+        else
+            rasterizeTiles(0, tilesCount);
+
+        m_Triangles.clear();
+        for (Vector<uint32_t>& bin : m_Bins)
+            bin.clear();
+        return true;
+    }
+
+    void SoftwareRenderBackend::SetLightDirection(const Float3& direction)
+    {
+        float length = std::sqrt(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+        m_LightDirection = length > 0.0f
+            ? Float3(direction.x / length, direction.y / length, direction.z / length)
+            : Float3(0.0f, -1.0f, 0.0f);
+    }
+
+    void SoftwareRenderBackend::RegisterMesh(ObjectInstanceID mesh, const Vector<Float3>& positions, const Vector<uint32_t>& indices,
+        const Vector<SubmeshInfo>& submeshes)
+    {
+        SoftwareMesh& softwareMesh = m_Meshes[mesh];
+        softwareMesh.positions = positions;
+        softwareMesh.indices = indices;
+        softwareMesh.submeshes = submeshes;
+    }
+
+    void SoftwareRenderBackend::Clear(uint32_t color, float depth)
+    {
+        std::fill(m_Color.begin(), m_Color.end(), color);
+        std::fill(m_Depth.begin(), m_Depth.end(), depth);
+        m_Triangles.clear();
+        for (Vector<uint32_t>& bin : m_Bins)
+            bin.clear();
+        std::memset(&m_Stats, 0, sizeof(m_Stats));
+    }
+
+    bool SoftwareRenderBackend::WriteImage(const char* path) const
+    {
+        FILE* file = std::fopen(path, "wb");
+        if (file == nullptr)
+        {
+            ASTEROID_LOG_ERROR_F("Failed to open %s for writing the image.", path);
+            return false;
+        }
+
+        std::fprintf(file, "P6\n%u %u\n255\n", m_Width, m_Height);
+        Vector<uint8_t> row(m_Width * 3);
+        bool isWritten = true;
+        for (uint32_t y = 0; y < m_Height && isWritten; ++y)
+        {
+            for (uint32_t x = 0; x < m_Width; ++x)
+            {
+                uint32_t pixel = Pixel(x, y);
+                row[x * 3 + 0] = (uint8_t)(pixel & 0xFF);
+                row[x * 3 + 1] = (uint8_t)((pixel >> 8) & 0xFF);
+                row[x * 3 + 2] = (uint8_t)((pixel >> 16) & 0xFF);
+            }
+            isWritten = std::fwrite(row.data(), 1, row.size(), file) == row.size();
+        }
+        std::fclose(file);
+        return isWritten;
+    }
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "RenderBackend.h"
+#include "Math/MathTypes.h"
+#include "Util/Containers.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  A RenderBackend rasterizing on the CPU, for rendering without a GPU such as benchmarks and golden image
+     *  tests on build servers.\n
+     *  Draws are transformed, clipped against the near plane and binned into screen tiles right away. Present
+     *  rasterizes the tiles in parallel on the JobSystem with SSE edge functions, four pixels at a time, or with the
+     *  same tests one pixel at a time off x86. Every tile processes its triangles in submission order, so images
+     *  don't depend on the numbers of threads.
+     *  @remarks
+     *      Meshes and materials are registered with the backend since it can't read GPU buffers. Triangles are
+     *      drawn flat shaded in the color of their material with a single directional light, depth tested with
+     *      LESS and culled like the default D3D11 rasterizer state, clockwise triangles facing the camera.\n
+     *      Usage per frame: Clear, SetViewProjection, draws, then Present and read or write the image.
+     */
+    class SoftwareRenderBackend : public RenderBackend
+    {
+    public:
+        /** Side of the square screen tiles triangles are binned into, a multiple of 4. */
+        static const uint32_t kTileSize = 32;
+
+        struct Stats
+        {
+            /** Triangles of every draw instance since the last Clear. */
+            uint32_t trianglesCount;
+            /** Triangles left after clipping and culling. */
+            uint32_t rasterizedTrianglesCount;
+            /** Sum of the tiles every rasterized triangle was binned into. */
+            uint32_t binnedTrianglesCount;
+        };
+
+    public:
+        SoftwareRenderBackend(uint32_t width, uint32_t height, uint32_t instanceStreamBytes);
+
+        ASTEROID_NON_COPYABLE(SoftwareRenderBackend)
+
+        virtual bool CopyToInstanceStream(uint32_t byteOffset, uint32_t uploadOffset, uint32_t bytesCount) override;
+        virtual void DrawIndexedInstanced(const InstancedDraw& draw) override;
+        virtual bool CreateUploadRing(uint32_t bytesCount) override;
+        virtual uint8_t* MapUploadRing() override;
+        virtual void UnmapUploadRing() override;
+
+        /**
+         *  Override RenderBackend::SignalFence
+         *  @remarks
+         *      Draws read their data when they are issued, so fences complete right away.
+         */
+        virtual uint64_t SignalFence() override;
+        virtual uint64_t CompletedFence() override;
+
+        /**
+         *  Override RenderBackend::TransientTextureBytes
+         *  @remarks
+         *      Only the back buffer is rendered to. Transient textures are accounted for but have no storage.
+         */
+        virtual uint64_t TransientTextureBytes(const TransientTextureDesc& desc, uint64_t* alignment) override;
+        virtual bool ReserveTransientHeap(uint64_t bytesCount) override;
+        virtual uint32_t AcquireTransientTexture(const TransientTextureDesc& desc, uint64_t heapOffset) override;
+        virtual void Barrier(const ResourceBarrier&) override {}
+
+        /**
+         *  Override RenderBackend::Present
+         *  @remarks
+         *      Rasterizes the triangles binned since the last Present, the image is complete afterwards.
+         */
+        virtual bool Present() override;
+
+        /**
+         *  Make the geometry of a mesh drawable, draws refer to it by the id. MeshProcessing::ExtractPositions
+         *  reads the positions out of mesh source data.
+         *  @param indices
+         *      Indices of all submeshes, relative to the vertex offset of their submesh.
+         */
+        void RegisterMesh(ObjectInstanceID mesh, const Vector<Float3>& positions, const Vector<uint32_t>& indices,
+            const Vector<SubmeshInfo>& submeshes);
+        void UnregisterMesh(ObjectInstanceID mesh) { m_Meshes.erase(mesh); }
+
+        /** Color of a material as 0xAABBGGRR, unregistered materials are drawn white. */
+        void SetMaterialColor(ObjectInstanceID material, uint32_t color) { m_MaterialColors[material] = color; }
+
+        /** Row-major view-projection matrix used by the following draws. */
+        void SetViewProjection(const Float4x4& viewProjection) { m_ViewProjection = viewProjection; }
+
+        /** World space direction the light shines in. */
+        void SetLightDirection(const Float3& direction);
+
+        /**
+         *  Clear the image and the depth buffer and drop any triangle not presented yet.
+         *  @param color
+         *      0xAABBGGRR
+         */
+        void Clear(uint32_t color, float depth = 1.0f);
+
+        uint32_t Width() const { return m_Width; }
+        uint32_t Height() const { return m_Height; }
+
+        /** Pixel of the image as 0xAABBGGRR. */
+        uint32_t Pixel(uint32_t x, uint32_t y) const { return m_Color[y * m_Pitch + x]; }
+        float Depth(uint32_t x, uint32_t y) const { return m_Depth[y * m_Pitch + x]; }
+
+        /**
+         *  Write the image as a binary PPM file.
+         */
+        bool WriteImage(const char* path) const;
+
+        Stats GetStats() const { return m_Stats; }
+
+    private:
+        struct SoftwareMesh
+        {
+            Vector<Float3>              positions;
+            Vector<uint32_t>            indices;
+            Vector<SubmeshInfo>         submeshes;
+        };
+
+        /** Screen space triangle with its edge functions E(x, y) = a * x + b * y + c, inside where all are positive. */
+        struct Triangle
+        {
+            float       edgeA[3];
+            float       edgeB[3];
+            float       edgeC[3];
+            /** The edge owns pixels exactly on it, by the top-left rule. */
+            bool        isTopLeft[3];
+            /** Depth plane, z = depthA * x + depthB * y + depthC. */
+            float       depthA, depthB, depthC;
+            uint32_t    minX, minY, maxX, maxY;
+            uint32_t    color;
+        };
+
+        void SetupTriangle(const Float4* clip, uint32_t color);
+        void BinTriangle(const Float4& v0, const Float4& v1, const Float4& v2, uint32_t color);
+        void RasterizeTile(uint32_t tile);
+
+    private:
+        uint32_t                m_Width;
+        uint32_t                m_Height;
+        /** Pixels per row, padded to a multiple of 4 for the SIMD loops. */
+        uint32_t                m_Pitch;
+        uint32_t                m_TilesX;
+        uint32_t                m_TilesY;
+        VectorA<uint32_t, 16>   m_Color;
+        VectorA<float, 16>      m_Depth;
+
+        UnorderedMap<ObjectInstanceID, SoftwareMesh>    m_Meshes;
+        UnorderedMap<ObjectInstanceID, uint32_t>        m_MaterialColors;
+        Float4x4                                        m_ViewProjection;
+        Float3                                          m_LightDirection;
+
+        Vector<Triangle>            m_Triangles;
+        Vector<Vector<uint32_t>>    m_Bins;
+        Stats                       m_Stats;
+
+        Vector<uint8_t>     m_InstanceStream;
+        Vector<uint8_t>     m_UploadRing;
+        uint64_t            m_SignaledFence;
+        uint32_t            m_TransientTexturesCount;
+    };
+}
@@ -0,0 +1,105 @@
+#include "Precompile.h"
+#include "UploadRing.h"
+#include "Util/Debug.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    UploadRing::UploadRing(RenderBackend* backend, uint32_t capacity)
+        : m_Backend(backend), m_Mapped(nullptr), m_IsInFrame(false), m_Capacity(0), m_Head(0), m_UsedBytes(0), m_FrameBytes(0)
+    {
+        if (m_Backend->CreateUploadRing(capacity))
+            m_Capacity = capacity;
+        else
+            ASTEROID_LOG_ERROR_F("UploadRing failed to create a ring of %u bytes.", capacity);
+    }
+
+    UploadRing::~UploadRing()
+    {
+        if (m_Mapped != nullptr)
+            m_Backend->UnmapUploadRing();
+    }
+
+    bool UploadRing::BeginFrame()
+    {
+        ASTEROID_ASSERT(!m_IsInFrame, "UploadRing::BeginFrame called twice without EndFrame.");
+        m_IsInFrame = true;
+
+        Reclaim(m_Backend->CompletedFence());
+        if (m_UsedBytes == 0)
+            m_Head = 0;
+
+        m_Mapped = m_Capacity > 0 ? m_Backend->MapUploadRing() : nullptr;
+        return m_Mapped != nullptr;
+    }
+
+    UploadAllocation UploadRing::Allocate(uint32_t bytesCount, uint32_t alignment)
+    {
+        UploadAllocation allocation = { nullptr, 0 };
+        if (!m_IsInFrame || m_Capacity == 0 || bytesCount == 0)
+            return allocation;
+        if (m_Mapped == nullptr)
+        {
+            m_Mapped = m_Backend->MapUploadRing();
+            if (m_Mapped == nullptr)
+                return allocation;
+        }
+
+        alignment = std::max(alignment, 1u);
+        uint64_t offset = ((uint64_t)m_Head + alignment - 1) / alignment * alignment;
+        uint64_t consumed = offset - m_Head;
+        if (offset + bytesCount > m_Capacity)
+        {
+            // Skip the end of the ring, the allocation restarts at offset 0.
+            consumed = m_Capacity - m_Head;
+            offset = 0;
+        }
+        consumed += bytesCount;
+
+        // The free space is contiguous from the head, wrapping around to the oldest frame still in flight.
+        if (m_UsedBytes + consumed > m_Capacity)
+        {
+            ASTEROID_LOG_WARNING_F("UploadRing is full, %u bytes requested with %u of %u bytes in flight.",
+                bytesCount, m_UsedBytes, m_Capacity);
+            return allocation;
+        }
+
+        m_Head = (uint32_t)((offset + bytesCount) % m_Capacity);
+        m_UsedBytes += (uint32_t)consumed;
+        m_FrameBytes += (uint32_t)consumed;
+
+        allocation.data = m_Mapped + offset;
+        allocation.offset = (uint32_t)offset;
+        return allocation;
+    }
+
+    void UploadRing::Unmap()
+    {
+        if (m_Mapped != nullptr)
+        {
+            m_Backend->UnmapUploadRing();
+            m_Mapped = nullptr;
+        }
+    }
+
+    void UploadRing::EndFrame()
+    {
+        Unmap();
+        m_IsInFrame = false;
+
+        FrameMark frame;
+        frame.fence = m_Backend->SignalFence();
+        frame.bytesCount = m_FrameBytes;
+        m_Frames.push_back(frame);
+        m_FrameBytes = 0;
+    }
+
+    void UploadRing::Reclaim(uint64_t completedFence)
+    {
+        // Frames are released in the order they were submitted, so the space is always given back at the tail.
+        while (!m_Frames.empty() && m_Frames.front().fence <= completedFence)
+        {
+            m_UsedBytes -= m_Frames.front().bytesCount;
+            m_Frames.pop_front();
+        }
+    }
+}
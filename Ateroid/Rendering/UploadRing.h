@@ -0,0 +1,94 @@
+#pragma once
+
+#include "RenderBackend.h"
+#include "Util/Containers.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /** A range of the upload ring written by the CPU this frame. */
+    struct UploadAllocation
+    {
+        uint8_t*    data;
+        /** Offset from the beginning of the upload ring, for binding the range on the GPU. */
+        uint32_t    offset;
+
+        bool IsValid() const { return data != nullptr; }
+    };
+
+
+    /**
+     *  Linear allocator over the backend's upload ring for per-frame dynamic data such as constants and instances.\n
+     *  Allocations of a frame are tagged with a fence signaled at EndFrame, and their space is reclaimed once the
+     *  GPU has passed that fence. Nothing is created or destroyed per frame.
+     *  @remarks
+     *      Usage per frame: BeginFrame, Allocate and write as many ranges as needed, Unmap before submitting the
+     *      commands reading them, then EndFrame. Allocating after Unmap maps the ring again without overwriting.
+     */
+    class UploadRing
+    {
+    public:
+        /**
+         *  @param backend
+         *      Backend providing the ring buffer and the fences, the ring is created by the constructor.
+         */
+        UploadRing(RenderBackend* backend, uint32_t capacity);
+        ~UploadRing();
+
+        ASTEROID_NON_COPYABLE(UploadRing)
+
+        /**
+         *  Reclaim the space of frames the GPU has finished and map the ring.
+         *  @return
+         *      False if the ring couldn't be mapped, Allocate tries to map it again.
+         */
+        bool BeginFrame();
+
+        /**
+         *  Allocate a range for this frame.
+         *  @param alignment
+         *      The returned offset is a multiple of it, doesn't have to be a power of two.
+         *  @return
+         *      The allocated range, check UploadAllocation::IsValid for failure. Allocations fail when the ring is
+         *      full of data of frames still in flight.
+         */
+        UploadAllocation Allocate(uint32_t bytesCount, uint32_t alignment = 16);
+
+        /**
+         *  Unmap the ring so the GPU may read the ranges written so far. Their data pointers are invalid afterwards.
+         */
+        void Unmap();
+
+        /**
+         *  Unmap the ring and tag this frame's allocations with a new fence.
+         */
+        void EndFrame();
+
+        uint32_t Capacity() const { return m_Capacity; }
+
+        /** Bytes held by this frame and by frames still in flight. */
+        uint32_t UsedBytes() const { return m_UsedBytes; }
+
+        /** Numbers of ended frames whose space is not reclaimed yet. */
+        uint32_t FramesInFlight() const { return (uint32_t)m_Frames.size(); }
+
+    private:
+        struct FrameMark
+        {
+            uint64_t    fence;
+            uint32_t    bytesCount;
+        };
+
+        void Reclaim(uint64_t completedFence);
+
+    private:
+        RenderBackend*  m_Backend;
+        uint8_t*        m_Mapped;
+        bool            m_IsInFrame;
+        uint32_t        m_Capacity;
+        uint32_t        m_Head;
+        uint32_t        m_UsedBytes;
+        /** Bytes taken by the current frame, including alignment and wrap padding. */
+        uint32_t        m_FrameBytes;
+        List<FrameMark> m_Frames;
+    };
+}
@@ -0,0 +1,274 @@
+#include "Precompile.h"
+#include "UploadRingTest.h"
+#include "NullRenderBackend.h"
+#include "UploadRing.h"
+#include "Util/Debug.h"
+#include <random>
+
+namespace ASTEROID_NAMESPACE
+{
+    static const uint32_t kCapacity = 64 * 1024;
+    /** A few of the largest allocations fill the ring, so frames in flight often leave too little space. */
+    static const uint32_t kMaxAllocationBytes = kCapacity / 8;
+    static const uint32_t kMaxAllocationsPerFrame = 6;
+    static const uint32_t kAlignments[] = { 1, 4, 16, 48, 256 };
+    static const uint32_t kAlignmentsCount = sizeof(kAlignments) / sizeof(kAlignments[0]);
+    static const float kRemapRatio = 0.2f;
+
+    /** A range written by the test, filled with bytes derived from its id. */
+    struct TestRange
+    {
+        uint32_t    id;
+        uint32_t    offset;
+        uint32_t    bytesCount;
+    };
+
+    struct TestFrame
+    {
+        uint64_t            fence;
+        Vector<TestRange>   ranges;
+    };
+
+    static uint8_t RangeByte(const TestRange& range, uint32_t index)
+    {
+        return (uint8_t)(range.id * 7 + index);
+    }
+
+    static const TestRange* FindOverlap(const Vector<TestRange>& ranges, uint32_t offset, uint32_t bytesCount)
+    {
+        for (const TestRange& range : ranges)
+        {
+            if (offset < range.offset + range.bytesCount && range.offset < offset + bytesCount)
+                return &range;
+        }
+        return nullptr;
+    }
+
+    /**
+     *  Counts bytes the way the ring hands them out: from the head, wrapping around to the end of the last range
+     *  of the newest frame reclaimed, which takes the alignment and wrap padding of the frames in flight into account.
+     */
+    class RingModel
+    {
+    public:
+        explicit RingModel(uint32_t capacity)
+            : m_Capacity(capacity), m_Head(0), m_UsedBytes(0)
+        {
+        }
+
+        uint32_t Head() const { return m_Head; }
+        uint32_t UsedBytes() const { return m_UsedBytes; }
+
+        /**
+         *  Give back the space of the frames the GPU finished.
+         *  @param tail
+         *      End of the last range of the newest frame reclaimed.
+         *  @param isEmpty
+         *      True if no range is in flight, the ring then restarts at its beginning.
+         */
+        void Reclaim(uint32_t tail, bool isEmpty)
+        {
+            if (isEmpty)
+                m_Head = m_UsedBytes = 0;
+            else
+                m_UsedBytes = m_Head == tail ? m_Capacity : (m_Head + m_Capacity - tail) % m_Capacity;
+        }
+
+        /**
+         *  @return
+         *      False if the allocation doesn't fit, with nothing changed.
+         */
+        bool Allocate(uint32_t bytesCount, uint32_t alignment, uint32_t* offset)
+        {
+            uint64_t aligned = ((uint64_t)m_Head + alignment - 1) / alignment * alignment;
+            uint64_t consumed = aligned + bytesCount <= m_Capacity ? aligned - m_Head + bytesCount : m_Capacity - m_Head + bytesCount;
+            if (aligned + bytesCount > m_Capacity)
+                aligned = 0;
+            if (m_UsedBytes + consumed > m_Capacity)
+                return false;
+
+            *offset = (uint32_t)aligned;
+            m_Head = (uint32_t)((aligned + bytesCount) % m_Capacity);
+            m_UsedBytes += (uint32_t)consumed;
+            return true;
+        }
+
+    private:
+        uint32_t    m_Capacity;
+        uint32_t    m_Head;
+        uint32_t    m_UsedBytes;
+    };
+
+    /**
+     *  @return
+     *      False at the first range the GPU may still read whose content changed.
+     */
+    static bool CheckContent(const NullRenderBackend& backend, const List<TestFrame>& frames, uint32_t latency, uint32_t frame)
+    {
+        const Vector<uint8_t>& content = backend.UploadRingContent();
+        for (const TestFrame& testFrame : frames)
+        {
+            for (const TestRange& range : testFrame.ranges)
+            {
+                for (uint32_t iByte = 0; iByte < range.bytesCount; ++iByte)
+                {
+                    if (content[range.offset + iByte] != RangeByte(range, iByte))
+                    {
+                        ASTEROID_LOG_ERROR_F("UploadRing latency %u frame %u: range %u at offset %u of the frame fenced by %llu was "
+                            "overwritten.", latency, frame, range.id, range.offset, (unsigned long long)testFrame.fence);
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    static bool RunLatency(uint32_t latency, const UploadRingTestSettings& settings)
+    {
+        NullRenderBackend backend(0);
+        backend.SetFenceLatency(latency);
+        UploadRing ring(&backend, kCapacity);
+        RingModel model(kCapacity);
+        if (ring.Capacity() != kCapacity)
+        {
+            ASTEROID_LOG_ERROR_F("UploadRing latency %u: capacity of %u bytes instead of %u.", latency, ring.Capacity(), kCapacity);
+            return false;
+        }
+
+        std::mt19937 random(settings.seed + latency);
+        std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+        // The ring is the only one signaling fences, so the one of a frame is its number counting from 1
+        List<TestFrame> inFlight;
+        uint32_t nextId = 0, tail = 0;
+        uint64_t allocationsCount = 0, wrapsCount = 0, failuresCount = 0, maxFramesInFlight = 0;
+        for (uint32_t iFrame = 0; iFrame < settings.framesCount; ++iFrame)
+        {
+            if (!ring.BeginFrame() || !backend.IsUploadRingMapped())
+            {
+                ASTEROID_LOG_ERROR_F("UploadRing latency %u frame %u: the ring is not mapped by BeginFrame.", latency, iFrame);
+                return false;
+            }
+
+            uint64_t completedFence = backend.CompletedFence();
+            while (!inFlight.empty() && inFlight.front().fence <= completedFence)
+            {
+                if (!inFlight.front().ranges.empty())
+                {
+                    const TestRange& last = inFlight.front().ranges.back();
+                    tail = (last.offset + last.bytesCount) % kCapacity;
+                }
+                inFlight.pop_front();
+            }
+            bool isEmpty = true;
+            for (const TestFrame& testFrame : inFlight)
+                isEmpty = isEmpty && testFrame.ranges.empty();
+            model.Reclaim(tail, isEmpty);
+            maxFramesInFlight = std::max<uint64_t>(maxFramesInFlight, inFlight.size());
+
+            if (ring.FramesInFlight() != inFlight.size() || ring.UsedBytes() != model.UsedBytes())
+            {
+                ASTEROID_LOG_ERROR_F("UploadRing latency %u frame %u: %u frames in flight holding %u bytes instead of %zu holding %u.",
+                    latency, iFrame, ring.FramesInFlight(), ring.UsedBytes(), inFlight.size(), model.UsedBytes());
+                return false;
+            }
+
+            TestFrame frame;
+            frame.fence = iFrame + 1;
+            uint32_t allocationsCountThisFrame = 1 + random() % kMaxAllocationsPerFrame;
+            for (uint32_t iAllocation = 0; iAllocation < allocationsCountThisFrame; ++iAllocation)
+            {
+                if (uniform(random) < kRemapRatio)
+                    ring.Unmap();
+
+                uint32_t bytesCount = 1 + random() % kMaxAllocationBytes;
+                uint32_t alignment = kAlignments[random() % kAlignmentsCount];
+                uint32_t previousHead = model.Head(), usedBytes = ring.UsedBytes();
+                uint32_t expectedOffset = 0;
+                bool isExpected = model.Allocate(bytesCount, alignment, &expectedOffset);
+                UploadAllocation allocation = ring.Allocate(bytesCount, alignment);
+                if (!allocation.IsValid())
+                {
+                    if (isExpected)
+                    {
+                        ASTEROID_LOG_ERROR_F("UploadRing latency %u frame %u: %u bytes aligned to %u failed with %u of %u bytes in use.",
+                            latency, iFrame, bytesCount, alignment, usedBytes, kCapacity);
+                        return false;
+                    }
+                    if (ring.UsedBytes() != usedBytes)
+                    {
+                        ASTEROID_LOG_ERROR_F("UploadRing latency %u frame %u: a failed allocation changed the used bytes from %u to %u.",
+                            latency, iFrame, usedBytes, ring.UsedBytes());
+                        return false;
+                    }
+                    ++failuresCount;
+                    continue;
+                }
+
+                if (!isExpected)
+                {
+                    ASTEROID_LOG_ERROR_F("UploadRing latency %u frame %u: %u bytes aligned to %u fit with %u of %u bytes in use.",
+                        latency, iFrame, bytesCount, alignment, usedBytes, kCapacity);
+                    return false;
+                }
+                if (allocation.offset != expectedOffset || allocation.offset % alignment != 0 ||
+                    allocation.data != backend.UploadRingContent().data() + allocation.offset || !backend.IsUploadRingMapped())
+                {
+                    ASTEROID_LOG_ERROR_F("UploadRing latency %u frame %u: %u bytes aligned to %u at offset %u instead of %u.",
+                        latency, iFrame, bytesCount, alignment, allocation.offset, expectedOffset);
+                    return false;
+                }
+
+                // Whatever the byte counting, the range must not touch one the GPU may still read or one of this frame
+                const TestRange* overlapped = FindOverlap(frame.ranges, allocation.offset, bytesCount);
+                for (auto it = inFlight.begin(); overlapped == nullptr && it != inFlight.end(); ++it)
+                    overlapped = FindOverlap(it->ranges, allocation.offset, bytesCount);
+                if (overlapped != nullptr)
+                {
+                    ASTEROID_LOG_ERROR_F("UploadRing latency %u frame %u: %u bytes at offset %u overlap range %u at offset %u.",
+                        latency, iFrame, bytesCount, allocation.offset, overlapped->id, overlapped->offset);
+                    return false;
+                }
+
+                TestRange range = { nextId++, allocation.offset, bytesCount };
+                for (uint32_t iByte = 0; iByte < bytesCount; ++iByte)
+                    allocation.data[iByte] = RangeByte(range, iByte);
+                frame.ranges.push_back(range);
+                ++allocationsCount;
+                if (allocation.offset < previousHead)
+                    ++wrapsCount;
+            }
+
+            ring.EndFrame();
+            if (backend.IsUploadRingMapped())
+            {
+                ASTEROID_LOG_ERROR_F("UploadRing latency %u frame %u: the ring is still mapped after EndFrame.", latency, iFrame);
+                return false;
+            }
+            inFlight.push_back(frame);
+            if (!CheckContent(backend, inFlight, latency, iFrame))
+                return false;
+        }
+
+        ASTEROID_LOG_INFO_F("    fence latency %u: %llu allocations, %llu wraps, %llu failed with the ring full, up to %llu frames in flight",
+            latency, (unsigned long long)allocationsCount, (unsigned long long)wrapsCount, (unsigned long long)failuresCount,
+            (unsigned long long)maxFramesInFlight);
+        if (wrapsCount == 0 || failuresCount == 0)
+        {
+            ASTEROID_LOG_ERROR_F("UploadRing latency %u: %u frames are too few to wrap the ring and fill it.", latency,
+                settings.framesCount);
+            return false;
+        }
+        return true;
+    }
+
+    bool UploadRingTest::Run(const UploadRingTestSettings& settings)
+    {
+        ASTEROID_LOG_INFO_F("Upload ring test: %u frames of %u bytes rings.", settings.framesCount, kCapacity);
+
+        bool isValid = true;
+        for (uint32_t latency : { 2u, 3u })
+            isValid = RunLatency(latency, settings) && isValid;
+        return isValid;
+    }
+}
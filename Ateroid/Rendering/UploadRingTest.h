@@ -0,0 +1,32 @@
+#pragma once
+
+namespace ASTEROID_NAMESPACE
+{
+    struct UploadRingTestSettings
+    {
+        /** Frames run at each fence latency. */
+        uint32_t    framesCount;
+        uint32_t    seed;
+    };
+
+
+    /**
+     *  Runs an UploadRing over a NullRenderBackend whose GPU lags 2 and then 3 fences behind. Every frame makes
+     *  random allocations large enough to wrap the ring and fill it with frames in flight, sometimes unmapping
+     *  and allocating again. Ranges must be aligned and must not overlap the ones the GPU may still read, whose
+     *  content is checked after every frame. Allocations must fail exactly when the free space left by the
+     *  frames in flight is too small, without changing the ring.
+     */
+    class UploadRingTest
+    {
+    public:
+        ASTEROID_NO_DEFAULT_CTOR(UploadRingTest)
+        ASTEROID_NON_COPYABLE(UploadRingTest)
+
+        /**
+         *  @return
+         *      False if any check failed.
+         */
+        static bool Run(const UploadRingTestSettings& settings);
+    };
+}
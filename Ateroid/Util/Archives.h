@@ -1,11 +1,16 @@
 #pragma once
 
 #include "cereal/archives/json.hpp"
+#include "cereal/archives/portable_binary.hpp"
 
 namespace ASTEROID_NAMESPACE
 {
     using JSONOutputArchive = cereal::JSONOutputArchive;
     using JSONInputArchive  = cereal::JSONInputArchive;
+
+    /** Little-endian binary whatever the platform, floats are saved bit for bit. */
+    using BinaryOutputArchive = cereal::PortableBinaryOutputArchive;
+    using BinaryInputArchive  = cereal::PortableBinaryInputArchive;
 }
 
 #ifndef ASTEROID_ARCHIVE_MAKE_NVP
@@ -21,7 +21,7 @@ namespace ASTEROID_NAMESPACE
             : m_Name(name), m_IsPersistent(isPersistent)
         {
         }
-        virtual ~BaseConsoleVariable() = 0 {}
+        virtual ~BaseConsoleVariable() = 0;
 
         /** Read value from a input stream. */
         virtual void ReadValue(std::istream& is) = 0;
@@ -40,6 +40,8 @@ namespace ASTEROID_NAMESPACE
         bool    m_IsPersistent;
     };
 
+    inline BaseConsoleVariable::~BaseConsoleVariable() {}
+
 
     /**
      *  A global manager class that manages all registered console variable in the game.
@@ -85,7 +87,7 @@ namespace ASTEROID_NAMESPACE
         void Register(BaseConsoleVariable::SharedPtrType pVar)
         {
             ASTEROID_ASSERT_F(m_Variables.find(pVar->Name()) == m_Variables.end(), 
-                "There is already a variable with name \"%s\" registered.", pVar->Name());
+                "There is already a variable with name \"%s\" registered.", pVar->Name().c_str());
             m_Variables.insert(std::make_pair(pVar->Name(), pVar));
         }
 
@@ -220,11 +222,11 @@ namespace ASTEROID_NAMESPACE
                 {
                     var = std::dynamic_pointer_cast<ConsoleVariable<T>>(regVar);
                     if (var == nullptr)
-                        ASTEROID_LOG_ERROR_F("There is already a variable with name \"%s\" registered but it's a different type.", name);
+                        ASTEROID_LOG_ERROR_F("There is already a variable with name \"%s\" registered but it's a different type.", name.c_str());
                 }
                 else
                 {
-                    ASTEROID_LOG_ERROR_F("There is already a variable with name \"%s\" registered but it has different persistency property.", name);
+                    ASTEROID_LOG_ERROR_F("There is already a variable with name \"%s\" registered but it has different persistency property.", name.c_str());
                 }
                 return var;
             }
@@ -2,10 +2,14 @@
 #include "Debug.h"
 #include "String.h"
 
+#ifndef _WIN32
+#include <csignal>
+#include <execinfo.h>
+#endif
 
 namespace ASTEROID_NAMESPACE
 {
-    static const char kLogFilepath[] = ".\\LastRun.log";
+    static const char kLogFilepath[] = "LastRun.log";
     // A temopary string buffer for string formatting.
     static char gLogStringFormatBuffer[Debug::kMaxLogStringByteLength] = { 0 };
 
@@ -15,7 +19,7 @@ namespace ASTEROID_NAMESPACE
     };
 
     template<class _Elem, class _Traits> 
-    std::basic_ostream<_Elem, _Traits>& __CLRCALL_OR_CDECL LogTimeStamp(std::basic_ostream<_Elem, _Traits>& _Ostr)
+    std::basic_ostream<_Elem, _Traits>& LogTimeStamp(std::basic_ostream<_Elem, _Traits>& _Ostr)
     {	
         std::time_t t = std::time(nullptr);
         std::tm* now = std::localtime(&t);
@@ -40,7 +44,9 @@ namespace ASTEROID_NAMESPACE
         }
 
         const std::string& str = ss.str();
+#ifdef _WIN32
         OutputDebugStringA(str.c_str());
+#endif
 
         std::cerr << LogTimeStamp << str;
     }
@@ -57,16 +63,20 @@ namespace ASTEROID_NAMESPACE
         }
 
         const std::string& str = ss.str();
+#ifdef _WIN32
         OutputDebugStringA(str.c_str());
+#endif
 
         std::cerr << LogTimeStamp << str;
     }
 
     void Debug::Initialize()
     {
+#ifdef _WIN32
         HANDLE process = GetCurrentProcess();
         SymSetOptions(SYMOPT_LOAD_LINES); 
         SymInitialize(process, NULL, TRUE);  
+#endif
 
         // Redirect std::cerr to log file
         freopen(kLogFilepath, "w", stderr);
@@ -76,8 +86,10 @@ namespace ASTEROID_NAMESPACE
     {
         fflush(stderr);
 
+#ifdef _WIN32
         HANDLE process = GetCurrentProcess();
         SymCleanup(process);
+#endif
     }
 
     void Debug::Log(ELogType type, const char* str, bool stackTrace)
@@ -95,14 +107,25 @@ namespace ASTEROID_NAMESPACE
 
     void Debug::Break()
     {
+#ifdef _WIN32
         DebugBreak();
+#else
+        std::raise(SIGTRAP);
+#endif
     }
 
     void Debug::Assert(const wchar_t* expression, const wchar_t* file, int line)
     {
+#ifdef _WIN32
         _wassert(expression, file, line); 
+#else
+        fprintf(stderr, "Assertion failed: %ls, file %ls, line %d\n", expression, file, line);
+        fflush(stderr);
+        std::abort();
+#endif
     }
 
+#ifdef _WIN32
     StackTrace::StackTrace()
     {
         m_FrameCount = CaptureStackBackTrace(1, kMaxFrameCount, m_Frames, NULL);
@@ -130,4 +153,24 @@ namespace ASTEROID_NAMESPACE
         }
         return o;
     }
+#else
+    StackTrace::StackTrace()
+    {
+        // backtrace includes this constructor, skip it like CaptureStackBackTrace does
+        void* frames[kMaxFrameCount + 1];
+        int framesCount = backtrace(frames, kMaxFrameCount + 1);
+        m_FrameCount = std::max(framesCount - 1, 0);
+        std::copy(frames + 1, frames + 1 + m_FrameCount, m_Frames);
+    }
+
+    std::ostream& operator<<(std::ostream& o, const StackTrace& st)
+    {
+        // Names are mangled and without lines, addr2line resolves the addresses
+        char** symbols = backtrace_symbols(const_cast<void* const*>(st.m_Frames), st.m_FrameCount);
+        for (int i = 0; i < st.m_FrameCount; i++)
+            o << (symbols != nullptr ? symbols[i] : "?") << std::endl;
+        free(symbols);
+        return o;
+    }
+#endif
 }
@@ -99,27 +99,31 @@ namespace ASTEROID_NAMESPACE
 }
 
 
+/** Wide string literal of a narrow one, e.g. of a stringized expression or __FILE__. */
+#define ASTEROID_WIDE_STRING_(s) L ## s
+#define ASTEROID_WIDE_STRING(s) ASTEROID_WIDE_STRING_(s)
+
 #ifdef _DEBUG
     /** Assert and output a log if failed */
-    #define ASTEROID_ASSERT(c, m)                                                               \
-        do {                                                                                    \
-            if (!(c)) {                                                                         \
-                ASTEROID_NAMESPACE::Debug::Log(ASTEROID_NAMESPACE::ELogType::eAssert, m, true); \
-                ASTEROID_NAMESPACE::Debug::Assert(_CRT_WIDE_(#c), __FILEW__, __LINE__);         \
-            }                                                                                   \
+    #define ASTEROID_ASSERT(c, m)                                                                                      \
+        do {                                                                                                           \
+            if (!(c)) {                                                                                                \
+                ASTEROID_NAMESPACE::Debug::Log(ASTEROID_NAMESPACE::ELogType::eAssert, m, true);                        \
+                ASTEROID_NAMESPACE::Debug::Assert(ASTEROID_WIDE_STRING(#c), ASTEROID_WIDE_STRING(__FILE__), __LINE__); \
+            }                                                                                                          \
         } while(false)
 
     /** Assert and output a formatted log if failed */
-    #define ASTEROID_ASSERT_F(c, format, ...)                                                                           \
-        do {                                                                                                            \
-            if (!(c)) {                                                                                                 \
-                ASTEROID_NAMESPACE::Debug::LogFormat(ASTEROID_NAMESPACE::ELogType::eAssert, format, true, __VA_ARGS__); \
-                ASTEROID_NAMESPACE::Debug::Assert(_CRT_WIDE_(#c), __FILEW__, __LINE__);                                 \
-            }                                                                                                           \
+    #define ASTEROID_ASSERT_F(c, format, ...)                                                                             \
+        do {                                                                                                              \
+            if (!(c)) {                                                                                                   \
+                ASTEROID_NAMESPACE::Debug::LogFormat(ASTEROID_NAMESPACE::ELogType::eAssert, format, true, ##__VA_ARGS__); \
+                ASTEROID_NAMESPACE::Debug::Assert(ASTEROID_WIDE_STRING(#c), ASTEROID_WIDE_STRING(__FILE__), __LINE__);    \
+            }                                                                                                             \
         } while(false)
 #else
     #define ASTEROID_ASSERT(c, m) ((void)0)
-    #define ASTEROID_ASSERT_F(c, m) ((void)0)
+    #define ASTEROID_ASSERT_F(c, m, ...) ((void)0)
 #endif
 
 #ifndef ASTEROID_NO_LOG_INFO
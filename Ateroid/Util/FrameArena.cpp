@@ -0,0 +1,27 @@
+#include "Precompile.h"
+#include "FrameArena.h"
+#include "Debug.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    FrameArena::FrameArena(size_t capacity)
+        : m_Memory(capacity), m_UsedBytes(0)
+    {
+    }
+
+    void* FrameArena::Allocate(size_t bytesCount, size_t alignment)
+    {
+        ASTEROID_ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0 && alignment <= kAlignment,
+            "FrameArena alignment must be a power of two not larger than kAlignment.");
+
+        // Reserve enough for the worst alignment padding, the claimed range is aligned afterwards
+        size_t begin = m_UsedBytes.fetch_add(bytesCount + alignment - 1, std::memory_order_relaxed);
+        size_t alignedBegin = (begin + alignment - 1) & ~(alignment - 1);
+        if (alignedBegin + bytesCount > m_Memory.size())
+        {
+            ASTEROID_LOG_WARNING_F("FrameArena out of memory, %zu bytes requested.", bytesCount);
+            return nullptr;
+        }
+        return m_Memory.data() + alignedBegin;
+    }
+}
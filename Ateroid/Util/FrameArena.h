@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include "Containers.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  Linear allocator for data living one frame.\n
+     *  Allocating is a single atomic add, so any thread may allocate concurrently. Nothing is freed individually,
+     *  Reset releases everything at once and the memory is reused by the next frame.
+     *  @remarks
+     *      Data read by the render thread lives until that frame is presented, keep one arena per frame in flight.
+     */
+    class FrameArena
+    {
+    public:
+        static const size_t kAlignment = 64;
+
+    public:
+        explicit FrameArena(size_t capacity);
+
+        ASTEROID_NON_COPYABLE(FrameArena)
+
+        /**
+         *  Allocate uninitialized memory.
+         *  @param alignment
+         *      Power of two, at most kAlignment.
+         *  @return
+         *      nullptr if the arena is full.
+         */
+        void* Allocate(size_t bytesCount, size_t alignment = 16);
+
+        /** Allocate an uninitialized array, constructors are not run. */
+        template<typename T>
+        T* Allocate(size_t count)
+        {
+            static_assert(std::is_trivially_destructible<T>::value, "FrameArena never runs destructors.");
+            return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+        }
+
+        /**
+         *  Release every allocation. No allocation may be in use or in progress.
+         */
+        void Reset() { m_UsedBytes.store(0, std::memory_order_relaxed); }
+
+        size_t UsedBytes() const { return std::min(m_UsedBytes.load(std::memory_order_relaxed), m_Memory.size()); }
+        size_t Capacity() const { return m_Memory.size(); }
+
+    private:
+        VectorA<uint8_t, kAlignment>    m_Memory;
+        std::atomic<size_t>             m_UsedBytes;
+    };
+}
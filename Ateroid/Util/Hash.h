@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  Non-cryptographic hash functions for building cache keys.
+     */
+    class Hash
+    {
+    public:
+        ASTEROID_NO_DEFAULT_CTOR(Hash)
+        ASTEROID_NON_COPYABLE(Hash)
+
+        /** Initial value for incremental hashing. */
+        static const uint64_t kSeed = 14695981039346656037ULL;
+
+        /**
+         *  64 bit FNV-1a hash of a byte range.
+         *  @param seed
+         *      Result of a previous call to continue hashing incrementally, or kSeed.
+         */
+        static uint64_t Bytes(const void* data, size_t bytesCount, uint64_t seed = kSeed)
+        {
+            const uint8_t* bytes = static_cast<const uint8_t*>(data);
+            uint64_t hash = seed;
+            for (size_t i = 0; i < bytesCount; ++i)
+            {
+                hash ^= bytes[i];
+                hash *= 1099511628211ULL;
+            }
+            return hash;
+        }
+
+        /**
+         *  64 bit FNV-1a hash of 32 bit words, a multiplication per word instead of per byte.
+         *  Not the same hash as Bytes over the same memory.
+         */
+        static uint64_t Words(const uint32_t* words, size_t wordsCount, uint64_t seed = kSeed)
+        {
+            uint64_t hash = seed;
+            for (size_t i = 0; i < wordsCount; ++i)
+            {
+                hash ^= words[i];
+                hash *= 1099511628211ULL;
+            }
+            return hash;
+        }
+
+        /**
+         *  Hash a zero terminated string, nullptr hashes like an empty string.
+         */
+        static uint64_t String(const char* str, uint64_t seed = kSeed)
+        {
+            return str != nullptr ? Bytes(str, std::strlen(str), seed) : seed;
+        }
+
+        /**
+         *  Mix a value into an existing hash.
+         */
+        template<typename T>
+        static uint64_t Combine(uint64_t seed, const T& value)
+        {
+            static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be hashed bytewise.");
+            return Bytes(&value, sizeof(T), seed);
+        }
+    };
+}
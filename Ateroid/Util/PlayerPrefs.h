@@ -193,7 +193,7 @@ namespace ASTEROID_NAMESPACE
         template <typename T>
         T GetValue(const String& name, const T& defaultValue)
         {
-            static_assert(false, "GetValue with type T is not supported.");
+            static_assert(sizeof(T) == 0, "GetValue with type T is not supported.");
         }
         /**
          *  A function template for set value of type T by name.
@@ -203,58 +203,7 @@ namespace ASTEROID_NAMESPACE
         template <typename T>
         void SetValue(const String& name, const T& value)
         {
-            static_assert(false, "SetValue with type T is not supported.");
-        }
-
-        /**
-         *  Generic version of PlayerPrefs::GetInteger
-         */
-        template <>
-        int GetValue<int>(const String& name, const int& defaultValue)
-        {
-            return GetInteger(name, defaultValue);
-        }
-        /**
-         *  Generic version of PlayerPrefs::SetInteger
-         */
-        template <>
-        void SetValue<int>(const String& name, const int& value)
-        {
-            SetInteger(name, value);
-        }
-
-        /**
-         *  Generic version of PlayerPrefs::GetSingle
-         */
-        template <>
-        float GetValue<float>(const String& name, const float& defaultValue)
-        {
-            return GetSingle(name, defaultValue);
-        }
-        /**
-         *  Generic version of PlayerPrefs::SetSingle
-         */
-        template <>
-        void SetValue<float>(const String& name, const float& value)
-        {
-            SetSingle(name, value);
-        }
-
-        /**
-         *  Generic version of PlayerPrefs::GetString
-         */
-        template <>
-        String GetValue<String>(const String& name, const String& defaultValue)
-        {
-            return GetString(name, defaultValue);
-        }
-        /**
-         *  Generic version of PlayerPrefs::SetString
-         */
-        template <>
-        void SetValue<String>(const String& name, const String& value)
-        {
-            SetString(name, value);
+            static_assert(sizeof(T) == 0, "SetValue with type T is not supported.");
         }
 
     private:
@@ -268,5 +217,56 @@ namespace ASTEROID_NAMESPACE
         NamedValueMap<float>    m_SingleValues;
         NamedValueMap<String>   m_StringValues;
     };
-    
+
+
+    /**
+     *  Generic version of PlayerPrefs::GetInteger
+     */
+    template <>
+    inline int PlayerPrefs::GetValue<int>(const String& name, const int& defaultValue)
+    {
+        return GetInteger(name, defaultValue);
+    }
+    /**
+     *  Generic version of PlayerPrefs::SetInteger
+     */
+    template <>
+    inline void PlayerPrefs::SetValue<int>(const String& name, const int& value)
+    {
+        SetInteger(name, value);
+    }
+
+    /**
+     *  Generic version of PlayerPrefs::GetSingle
+     */
+    template <>
+    inline float PlayerPrefs::GetValue<float>(const String& name, const float& defaultValue)
+    {
+        return GetSingle(name, defaultValue);
+    }
+    /**
+     *  Generic version of PlayerPrefs::SetSingle
+     */
+    template <>
+    inline void PlayerPrefs::SetValue<float>(const String& name, const float& value)
+    {
+        SetSingle(name, value);
+    }
+
+    /**
+     *  Generic version of PlayerPrefs::GetString
+     */
+    template <>
+    inline String PlayerPrefs::GetValue<String>(const String& name, const String& defaultValue)
+    {
+        return GetString(name, defaultValue);
+    }
+    /**
+     *  Generic version of PlayerPrefs::SetString
+     */
+    template <>
+    inline void PlayerPrefs::SetValue<String>(const String& name, const String& value)
+    {
+        SetString(name, value);
+    }
 }
\ No newline at end of file
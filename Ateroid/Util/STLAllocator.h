@@ -32,12 +32,21 @@ namespace ASTEROID_NAMESPACE
     private:
         static void* Allocate(size_t size)
         {
+#ifdef _WIN32
             return _aligned_malloc(size, Alignment);
+#else
+            // aligned_alloc wants a size multiple of the alignment
+            return aligned_alloc(Alignment, (size + Alignment - 1) / Alignment * Alignment);
+#endif
         }
 
         static void Deallocate(void* ptr)
         {
+#ifdef _WIN32
             return _aligned_free(ptr);
+#else
+            return free(ptr);
+#endif
         }
     };
 
@@ -87,12 +96,12 @@ namespace ASTEROID_NAMESPACE
         }
 
         constexpr STLAllocator(const STLAllocator&) noexcept = default;
-        template<typename Other, typename Alloc>
+        template<typename Other>
         constexpr STLAllocator(const STLAllocator<Other, Alloc>&) noexcept
         {	
         }
 
-        void deallocate(T* const ptr, const size_t count)
+        void deallocate(T* const ptr, const size_t)
         {	
             Alloc::Deallocate(ptr);
         }
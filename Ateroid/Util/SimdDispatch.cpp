@@ -0,0 +1,89 @@
+#include "Precompile.h"
+#include "SimdDispatch.h"
+#include "Debug.h"
+#include "SystemInfo.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    static const char* kLevelNames[] = { "scalar", "sse", "avx2", "avx512" };
+    static const char kLevelVariableName[] = "simd.level";
+    static const char kAutoLevelName[] = "auto";
+
+    ESimdLevel SimdDispatch::_DetectedLevel = ESimdLevel::eScalar;
+    ESimdLevel SimdDispatch::_Level = ESimdLevel::eScalar;
+    BaseSimdKernel* SimdDispatch::_Kernels = nullptr;
+    ConsoleVariable<String>::SharedPtrType SimdDispatch::_LevelVariable;
+
+    void SimdDispatch::Initialize()
+    {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+        _DetectedLevel = ESimdLevel::eSSE;
+        if (SystemInfo::HasCpuFeature(eCpuFeatureAVX2) && SystemInfo::HasCpuFeature(eCpuFeatureFMA3))
+            _DetectedLevel = ESimdLevel::eAVX2;
+        if (_DetectedLevel == ESimdLevel::eAVX2 && SystemInfo::HasCpuFeature(eCpuFeatureAVX512F))
+            _DetectedLevel = ESimdLevel::eAVX512;
+#elif defined(_M_ARM64) || defined(__aarch64__)
+        // NEON is part of ARMv8, kernels written with Vec4 run it at the SSE level
+        _DetectedLevel = ESimdLevel::eSSE;
+#else
+        _DetectedLevel = ESimdLevel::eScalar;
+#endif
+
+        ESimdLevel level = _DetectedLevel;
+        if (ConsoleVariableManager::Singleton() != nullptr)
+        {
+            _LevelVariable = ConsoleVariable<String>::Create(kLevelVariableName, true, kAutoLevelName);
+            String levelName = kAutoLevelName;
+            if (_LevelVariable != nullptr)
+                levelName = static_cast<String&>(*_LevelVariable);
+            if (levelName != kAutoLevelName)
+            {
+                auto it = std::find_if(std::begin(kLevelNames), std::end(kLevelNames),
+                    [&levelName](const char* name) { return levelName == name; });
+                if (it != std::end(kLevelNames))
+                    level = (ESimdLevel)(it - std::begin(kLevelNames));
+                else
+                    ASTEROID_LOG_WARNING_F("Unknown %s \"%s\", using the detected level.", kLevelVariableName, levelName.c_str());
+            }
+        }
+
+        if (!SetLevel(level))
+            ASTEROID_LOG_WARNING_F("SIMD level %s is not supported by this CPU.", LevelName(level));
+        ASTEROID_LOG_INFO_F("SIMD kernels dispatched to %s, detected %s.", LevelName(_Level), LevelName(_DetectedLevel));
+    }
+
+    bool SimdDispatch::SetLevel(ESimdLevel level)
+    {
+        bool isSupported = level <= _DetectedLevel;
+        _Level = isSupported ? level : _DetectedLevel;
+        ResolveKernels();
+        return isSupported;
+    }
+
+    const char* SimdDispatch::LevelName(ESimdLevel level)
+    {
+        return level < ESimdLevel::eCount ? kLevelNames[(uint32_t)level] : "unknown";
+    }
+
+    void SimdDispatch::ResolveKernels()
+    {
+        for (BaseSimdKernel* kernel = _Kernels; kernel != nullptr; kernel = kernel->m_Next)
+            kernel->Resolve(_Level);
+    }
+
+    BaseSimdKernel::BaseSimdKernel(const char* name)
+        : m_SelectedLevel(ESimdLevel::eScalar), m_Name(name), m_Next(SimdDispatch::_Kernels)
+    {
+        // Constant initialized, so registering from static constructors of other translation units is safe
+        SimdDispatch::_Kernels = this;
+    }
+
+    BaseSimdKernel::~BaseSimdKernel()
+    {
+        BaseSimdKernel** link = &SimdDispatch::_Kernels;
+        while (*link != nullptr && *link != this)
+            link = &(*link)->m_Next;
+        if (*link == this)
+            *link = m_Next;
+    }
+}
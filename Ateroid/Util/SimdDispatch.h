@@ -0,0 +1,153 @@
+#pragma once
+
+#include "Util/ConsoleVariable.h"
+
+/**
+ *  Enable an instruction set for a single function, so kernels for every level live in one binary built for the
+ *  baseline. MSVC accepts any intrinsic without it.
+ */
+#if defined(_MSC_VER) && !defined(__clang__)
+    #define ASTEROID_TARGET_AVX2
+    #define ASTEROID_TARGET_AVX512
+#else
+    #define ASTEROID_TARGET_AVX2    __attribute__((target("avx2,fma")))
+    #define ASTEROID_TARGET_AVX512  __attribute__((target("avx512f,avx2,fma")))
+#endif
+
+namespace ASTEROID_NAMESPACE
+{
+    /** Instruction set levels kernels are written for, each one implies the ones before. */
+    enum class ESimdLevel : uint32_t
+    {
+        eScalar,
+        /** SSE2, the x64 baseline, or NEON on ARM64 for kernels written with Vec4. */
+        eSSE,
+        /** AVX2 and FMA3. */
+        eAVX2,
+        eAVX512,
+        eCount
+    };
+
+
+    class BaseSimdKernel;
+
+    /**
+     *  Selects implementations of registered SIMD kernels for the best level the CPU supports.\n
+     *  Initialize picks the level from SystemInfo once at startup. The persistent console variable "simd.level"
+     *  forces a lower level for testing, with one of the values auto, scalar, sse, avx2 or avx512.
+     */
+    class SimdDispatch
+    {
+        friend class BaseSimdKernel;
+
+    public:
+        ASTEROID_NO_DEFAULT_CTOR(SimdDispatch)
+        ASTEROID_NON_COPYABLE(SimdDispatch)
+
+        /**
+         *  Detect the supported level and select the implementations of every registered kernel.
+         *  @remarks
+         *      Requires SystemInfo to be initialized. The console variable is only read if ConsoleVariableManager
+         *      is created. Kernels called before are dispatched to their scalar implementation.
+         */
+        static void Initialize();
+
+        /** The best level the CPU and OS support. */
+        static ESimdLevel DetectedLevel() { return _DetectedLevel; }
+        /** The level kernels are currently dispatched to. */
+        static ESimdLevel Level() { return _Level; }
+
+        /**
+         *  Dispatch every kernel to a level, e.g. to compare levels in benchmarks.
+         *  @return
+         *      False if the level is not supported, kernels then use the detected level.
+         *  @remarks
+         *      Not thread-safe, no kernel may run during the call.
+         */
+        static bool SetLevel(ESimdLevel level);
+
+        static const char* LevelName(ESimdLevel level);
+
+    private:
+        static void ResolveKernels();
+
+    private:
+        static ESimdLevel _DetectedLevel;
+        static ESimdLevel _Level;
+        static BaseSimdKernel* _Kernels;
+        static ConsoleVariable<String>::SharedPtrType _LevelVariable;
+    };
+
+
+    /**
+     *  A kernel registered with SimdDispatch. Kernels are meant to be static objects, they register in their
+     *  constructor and must outlive every dispatch.
+     */
+    class BaseSimdKernel
+    {
+        friend class SimdDispatch;
+
+    public:
+        explicit BaseSimdKernel(const char* name);
+        virtual ~BaseSimdKernel();
+
+        ASTEROID_NON_COPYABLE(BaseSimdKernel)
+
+        const char* Name() const { return m_Name; }
+        /** The level of the implementation in use, may be lower than SimdDispatch::Level. */
+        ESimdLevel SelectedLevel() const { return m_SelectedLevel; }
+
+    protected:
+        /** Select the best implementation up to a level. */
+        virtual void Resolve(ESimdLevel level) = 0;
+
+    protected:
+        ESimdLevel      m_SelectedLevel;
+
+    private:
+        const char*     m_Name;
+        BaseSimdKernel* m_Next;
+    };
+
+
+    /**
+     *  Implementations of a function for each ESimdLevel, called through operator().
+     *  @remarks
+     *      Levels without an implementation are nullptr and fall back to the next lower level, so a scalar
+     *      implementation is required.
+     */
+    template<typename Function>
+    class SimdKernel : public BaseSimdKernel
+    {
+    public:
+        SimdKernel(const char* name, Function scalar, Function sse, Function avx2 = nullptr, Function avx512 = nullptr)
+            : BaseSimdKernel(name), m_Implementations{ scalar, sse, avx2, avx512 }
+        {
+            ASTEROID_ASSERT(scalar != nullptr, "SimdKernel needs a scalar implementation.");
+            Resolve(SimdDispatch::Level());
+        }
+
+        template<typename... Args>
+        auto operator()(Args&&... args) const
+        {
+            return m_Selected(std::forward<Args>(args)...);
+        }
+
+        /** Implementation written for a level, nullptr if there is none. */
+        Function Implementation(ESimdLevel level) const { return m_Implementations[(uint32_t)level]; }
+
+    protected:
+        virtual void Resolve(ESimdLevel level) override
+        {
+            uint32_t iLevel = (uint32_t)level;
+            while (m_Implementations[iLevel] == nullptr)
+                --iLevel;
+            m_Selected = m_Implementations[iLevel];
+            m_SelectedLevel = (ESimdLevel)iLevel;
+        }
+
+    private:
+        Function    m_Implementations[(uint32_t)ESimdLevel::eCount];
+        Function    m_Selected;
+    };
+}
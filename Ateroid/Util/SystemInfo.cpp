@@ -1,21 +1,315 @@
 #include "Precompile.h"
 #include "SystemInfo.h"
+#include "Containers.h"
 #include "Debug.h"
+
+#ifdef _WIN32
+#include <intrin.h>
 #include "WindowsUtil.h"
+#else
+#include <dirent.h>
+#include <unistd.h>
+#include <map>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ASTEROID_CPU_X86
+#endif
 
 namespace ASTEROID_NAMESPACE
 {
-    SYSTEM_INFO SystemInfo::_SystemInfo;
-    ULONGLONG   SystemInfo::_TotalMemoryKilobytes;
+    uint32_t SystemInfo::_ProcessorsCount;
+    uint32_t SystemInfo::_PhysicalCoresCount;
+    uint32_t SystemInfo::_ThreadsPerCore;
+    uint32_t SystemInfo::_NumaNodesCount;
+    uint32_t SystemInfo::_CacheBytes[kMaxCacheLevel];
+    uint32_t SystemInfo::_CacheLineBytes;
+    uint32_t SystemInfo::_CpuFeatures;
+    uint64_t SystemInfo::_TotalMemoryKilobytes;
+
+    static const uint32_t kDefaultCacheLineBytes = 64;
+
+#ifndef _WIN32
+    /** First line of a small system file, empty if it can't be read. */
+    static std::string ReadLine(const std::string& path)
+    {
+        std::ifstream fs(path);
+        std::string line;
+        std::getline(fs, line);
+        return line;
+    }
+
+    /** A size like "48K" or "32M" as in sysfs cache descriptions. */
+    static uint32_t ParseSize(const std::string& text)
+    {
+        char* suffix = nullptr;
+        unsigned long long size = std::strtoull(text.c_str(), &suffix, 10);
+        if (suffix != nullptr && *suffix == 'K')
+            size *= 1024;
+        else if (suffix != nullptr && *suffix == 'M')
+            size *= 1024 * 1024;
+        return (uint32_t)size;
+    }
+
+    /** Numbers of directory entries named prefix followed by a number, e.g. cpu12 or node1. */
+    static Vector<uint32_t> ListNumberedEntries(const char* directory, const char* prefix)
+    {
+        Vector<uint32_t> numbers;
+        DIR* dir = opendir(directory);
+        if (dir == nullptr)
+            return numbers;
+
+        size_t prefixLength = std::strlen(prefix);
+        while (dirent* entry = readdir(dir))
+        {
+            const char* name = entry->d_name;
+            if (std::strncmp(name, prefix, prefixLength) == 0 && name[prefixLength] >= '0' && name[prefixLength] <= '9')
+                numbers.push_back((uint32_t)std::strtoul(name + prefixLength, nullptr, 10));
+        }
+        closedir(dir);
+        std::sort(numbers.begin(), numbers.end());
+        return numbers;
+    }
+
+    /** Value of a /proc/meminfo line in kilobytes, 0 if missing. */
+    static uint64_t ReadMemInfo(const char* key)
+    {
+        std::ifstream fs("/proc/meminfo");
+        std::string name;
+        uint64_t kilobytes;
+        std::string unit;
+        while (fs >> name >> kilobytes >> unit)
+        {
+            if (name.size() > 1 && name.compare(0, name.size() - 1, key) == 0)
+                return kilobytes;
+        }
+        return 0;
+    }
+#endif
 
     bool SystemInfo::Initialize()
     {
+        QueryTopology();
+        QueryCpuFeatures();
+
+#ifdef _WIN32
+        MEMORYSTATUSEX memoryStatus;
+        memoryStatus.dwLength = sizeof(memoryStatus);
+        if (GlobalMemoryStatusEx(&memoryStatus))
+            _TotalMemoryKilobytes = memoryStatus.ullTotalPhys / 1024;
+        else
+            ASTEROID_LOG_WARNING_F("GlobalMemoryStatusEx failed: %s", WindowsUtil::GetLastErrorString().c_str());
+#else
+        long pagesCount = sysconf(_SC_PHYS_PAGES);
+        long pageBytes = sysconf(_SC_PAGE_SIZE);
+        _TotalMemoryKilobytes = pagesCount > 0 && pageBytes > 0 ? (uint64_t)pagesCount * (uint64_t)pageBytes / 1024 : 0;
+#endif
+
         LogInfo();
 
         return true;
     }
 
+    uint64_t SystemInfo::AvailableMemoryKilobytes()
+    {
+#ifdef _WIN32
+        MEMORYSTATUSEX memoryStatus;
+        memoryStatus.dwLength = sizeof(memoryStatus);
+        return GlobalMemoryStatusEx(&memoryStatus) ? memoryStatus.ullAvailPhys / 1024 : 0;
+#else
+        // Unlike free pages, MemAvailable counts page cache the kernel can reclaim
+        uint64_t kilobytes = ReadMemInfo("MemAvailable");
+        if (kilobytes == 0)
+        {
+            long pagesCount = sysconf(_SC_AVPHYS_PAGES);
+            long pageBytes = sysconf(_SC_PAGE_SIZE);
+            kilobytes = pagesCount > 0 && pageBytes > 0 ? (uint64_t)pagesCount * (uint64_t)pageBytes / 1024 : 0;
+        }
+        return kilobytes;
+#endif
+    }
+
+    void SystemInfo::QueryTopology()
+    {
+        _PhysicalCoresCount = 0;
+        _ThreadsPerCore = 1;
+        _NumaNodesCount = 0;
+        std::fill(std::begin(_CacheBytes), std::end(_CacheBytes), 0);
+        _CacheLineBytes = 0;
+
+#ifdef _WIN32
+        // Counts every processor group, GetSystemInfo only sees the group of the calling thread
+        _ProcessorsCount = GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+
+        DWORD bufferBytes = 0;
+        GetLogicalProcessorInformationEx(RelationAll, nullptr, &bufferBytes);
+        Vector<uint8_t> buffer(bufferBytes);
+        if (bufferBytes > 0 && GetLogicalProcessorInformationEx(RelationAll,
+            reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data()), &bufferBytes))
+        {
+            for (DWORD offset = 0; offset < bufferBytes;)
+            {
+                const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX* info =
+                    reinterpret_cast<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(buffer.data() + offset);
+                if (info->Relationship == RelationProcessorCore)
+                {
+                    uint32_t threadsCount = 0;
+                    for (WORD iGroup = 0; iGroup < info->Processor.GroupCount; ++iGroup)
+                        threadsCount += (uint32_t)__popcnt64(info->Processor.GroupMask[iGroup].Mask);
+                    ++_PhysicalCoresCount;
+                    _ThreadsPerCore = std::max(_ThreadsPerCore, threadsCount);
+                }
+                else if (info->Relationship == RelationNumaNode)
+                {
+                    ++_NumaNodesCount;
+                }
+                else if (info->Relationship == RelationCache)
+                {
+                    const CACHE_RELATIONSHIP& cache = info->Cache;
+                    if (cache.Level >= 1 && cache.Level <= kMaxCacheLevel && (cache.Type == CacheData || cache.Type == CacheUnified))
+                    {
+                        _CacheBytes[cache.Level - 1] = std::max(_CacheBytes[cache.Level - 1], (uint32_t)cache.CacheSize);
+                        if (cache.Level == 1)
+                            _CacheLineBytes = cache.LineSize;
+                    }
+                }
+                offset += info->Size;
+            }
+        }
+        else
+        {
+            ASTEROID_LOG_WARNING_F("GetLogicalProcessorInformationEx failed: %s", WindowsUtil::GetLastErrorString().c_str());
+        }
+#else
+        long processorsCount = sysconf(_SC_NPROCESSORS_ONLN);
+        _ProcessorsCount = processorsCount > 0 ? (uint32_t)processorsCount : 1;
+
+        // A core is a distinct (package, core) pair, offline processors have no topology directory
+        std::map<std::pair<uint32_t, uint32_t>, uint32_t> coreThreads;
+        std::string cpuDirectory = "/sys/devices/system/cpu/cpu";
+        for (uint32_t cpu : ListNumberedEntries("/sys/devices/system/cpu", "cpu"))
+        {
+            std::string topology = cpuDirectory + std::to_string(cpu) + "/topology/";
+            std::string package = ReadLine(topology + "physical_package_id");
+            std::string core = ReadLine(topology + "core_id");
+            if (package.empty() || core.empty())
+                continue;
+
+            uint32_t& threadsCount = coreThreads[std::make_pair((uint32_t)std::stoul(package), (uint32_t)std::stoul(core))];
+            ++threadsCount;
+            _ThreadsPerCore = std::max(_ThreadsPerCore, threadsCount);
+        }
+        _PhysicalCoresCount = (uint32_t)coreThreads.size();
+        _NumaNodesCount = (uint32_t)ListNumberedEntries("/sys/devices/system/node", "node").size();
+
+        std::string cacheDirectory = cpuDirectory + "0/cache/index";
+        for (uint32_t index : ListNumberedEntries("/sys/devices/system/cpu/cpu0/cache", "index"))
+        {
+            std::string cache = cacheDirectory + std::to_string(index) + "/";
+            uint32_t level = (uint32_t)std::strtoul(ReadLine(cache + "level").c_str(), nullptr, 10);
+            std::string type = ReadLine(cache + "type");
+            if (level < 1 || level > kMaxCacheLevel || (type != "Data" && type != "Unified"))
+                continue;
+
+            _CacheBytes[level - 1] = std::max(_CacheBytes[level - 1], ParseSize(ReadLine(cache + "size")));
+            if (level == 1)
+                _CacheLineBytes = (uint32_t)std::strtoul(ReadLine(cache + "coherency_line_size").c_str(), nullptr, 10);
+        }
+#endif
+
+        // Containers and virtual machines may hide parts of the topology
+        if (_PhysicalCoresCount == 0)
+        {
+            _PhysicalCoresCount = _ProcessorsCount;
+            _ThreadsPerCore = 1;
+        }
+        if (_NumaNodesCount == 0)
+            _NumaNodesCount = 1;
+        if (_CacheLineBytes == 0)
+            _CacheLineBytes = kDefaultCacheLineBytes;
+    }
+
+    void SystemInfo::QueryCpuFeatures()
+    {
+        _CpuFeatures = 0;
+
+#if defined(ASTEROID_CPU_X86)
+        auto cpuid = [](uint32_t leaf, uint32_t subleaf, uint32_t registers[4])
+        {
+#ifdef _MSC_VER
+            __cpuidex(reinterpret_cast<int*>(registers), (int)leaf, (int)subleaf);
+#else
+            __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+        };
+
+        uint32_t registers[4];
+        cpuid(0, 0, registers);
+        uint32_t maxLeaf = registers[0];
+
+        cpuid(1, 0, registers);
+        uint32_t features1 = registers[2];
+        if (features1 & (1u << 20))
+            _CpuFeatures |= eCpuFeatureSSE42;
+
+        // AVX registers are only usable if the OS saves them on context switches, which XCR0 tells
+        uint64_t xcr0 = 0;
+        if (features1 & (1u << 27))
+        {
+#ifdef _MSC_VER
+            xcr0 = _xgetbv(0);
+#else
+            uint32_t xcr0Low, xcr0High;
+            __asm__ volatile("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+            xcr0 = ((uint64_t)xcr0High << 32) | xcr0Low;
+#endif
+        }
+        const uint64_t kYmmState = 0x6;
+        const uint64_t kZmmState = 0xE6;
+        bool hasYmmState = (xcr0 & kYmmState) == kYmmState;
+        bool hasZmmState = (xcr0 & kZmmState) == kZmmState;
+
+        if (hasYmmState && (features1 & (1u << 28)))
+        {
+            _CpuFeatures |= eCpuFeatureAVX;
+            if (features1 & (1u << 12))
+                _CpuFeatures |= eCpuFeatureFMA3;
+        }
+
+        if (maxLeaf >= 7)
+        {
+            cpuid(7, 0, registers);
+            uint32_t features7 = registers[1];
+            if (hasYmmState && (features7 & (1u << 5)))
+                _CpuFeatures |= eCpuFeatureAVX2;
+            if (hasZmmState && (features7 & (1u << 16)))
+                _CpuFeatures |= eCpuFeatureAVX512F;
+        }
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+        // Part of every AArch64 processor
+        _CpuFeatures |= eCpuFeatureNEON;
+#endif
+    }
+
     void SystemInfo::LogInfo()
     {
+        static const char* kFeatureNames[] = { "SSE4.2", "AVX", "AVX2", "FMA3", "AVX-512F", "NEON" };
+        std::string features;
+        for (uint32_t iFeature = 0; iFeature < std::size(kFeatureNames); ++iFeature)
+        {
+            if (_CpuFeatures & (1u << iFeature))
+                features += std::string(features.empty() ? "" : " ") + kFeatureNames[iFeature];
+        }
+
+        ASTEROID_LOG_INFO_F("Processors: %u logical, %u physical cores, %u threads per core, %u NUMA nodes",
+            _ProcessorsCount, _PhysicalCoresCount, _ThreadsPerCore, _NumaNodesCount);
+        ASTEROID_LOG_INFO_F("Caches: L1d %u KB, L2 %u KB, L3 %u KB, %u byte lines",
+            _CacheBytes[0] / 1024, _CacheBytes[1] / 1024, _CacheBytes[2] / 1024, _CacheLineBytes);
+        ASTEROID_LOG_INFO_F("SIMD: %s", features.empty() ? "none" : features.c_str());
+        ASTEROID_LOG_INFO_F("Memory: %llu MB total, %llu MB available",
+            (unsigned long long)(_TotalMemoryKilobytes / 1024), (unsigned long long)(AvailableMemoryKilobytes() / 1024));
     }
 }
@@ -2,6 +2,25 @@
 
 namespace ASTEROID_NAMESPACE
 {
+    /** SIMD instruction sets, combined as bit flags in SystemInfo::CpuFeatures. */
+    enum ECpuFeature : uint32_t
+    {
+        eCpuFeatureSSE42    = 1 << 0,
+        eCpuFeatureAVX      = 1 << 1,
+        eCpuFeatureAVX2     = 1 << 2,
+        eCpuFeatureFMA3     = 1 << 3,
+        eCpuFeatureAVX512F  = 1 << 4,
+        eCpuFeatureNEON     = 1 << 5
+    };
+
+
+    /**
+     *  Hardware the engine runs on, queried once by Initialize and logged at startup.\n
+     *  Thread pools, allocators and SIMD kernels size themselves from it.
+     *  @remarks
+     *      Counts that can't be queried on a platform fall back to the logical processors count for cores
+     *      and 1 for NUMA nodes. Unknown cache sizes are 0.
+     */
     class SystemInfo
     {
     public:
@@ -10,13 +29,47 @@ namespace ASTEROID_NAMESPACE
 
         static bool Initialize();
 
-        static uint32_t ProcessorsCount() { return _SystemInfo.dwNumberOfProcessors; }
+        /** Numbers of logical processors, i.e. hardware threads. */
+        static uint32_t ProcessorsCount() { return _ProcessorsCount; }
+        static uint32_t PhysicalCoresCount() { return _PhysicalCoresCount; }
+        /** Hardware threads sharing a physical core, 1 without SMT. */
+        static uint32_t ThreadsPerCore() { return _ThreadsPerCore; }
+        static uint32_t NumaNodesCount() { return _NumaNodesCount; }
+
+        /**
+         *  Size of one cache of a level, the data cache for L1.
+         *  @param level
+         *      1 to 3.
+         *  @return
+         *      Size in bytes, 0 if there is no such cache or it is unknown.
+         */
+        static uint32_t CacheBytes(uint32_t level) { return level >= 1 && level <= kMaxCacheLevel ? _CacheBytes[level - 1] : 0; }
+        static uint32_t CacheLineBytes() { return _CacheLineBytes; }
+
+        /** Supported SIMD instruction sets, a combination of ECpuFeature flags. */
+        static uint32_t CpuFeatures() { return _CpuFeatures; }
+        static bool HasCpuFeature(ECpuFeature feature) { return (_CpuFeatures & feature) != 0; }
+
+        static uint64_t TotalMemoryKilobytes() { return _TotalMemoryKilobytes; }
+        /** Physical memory currently available to processes, queried on each call. */
+        static uint64_t AvailableMemoryKilobytes();
+
+    public:
+        static const uint32_t kMaxCacheLevel = 3;
 
     private:
+        static void QueryTopology();
+        static void QueryCpuFeatures();
         static void LogInfo();
 
     private:
-        static SYSTEM_INFO _SystemInfo;
-        static ULONGLONG _TotalMemoryKilobytes;
+        static uint32_t _ProcessorsCount;
+        static uint32_t _PhysicalCoresCount;
+        static uint32_t _ThreadsPerCore;
+        static uint32_t _NumaNodesCount;
+        static uint32_t _CacheBytes[kMaxCacheLevel];
+        static uint32_t _CacheLineBytes;
+        static uint32_t _CpuFeatures;
+        static uint64_t _TotalMemoryKilobytes;
     };
 }
\ No newline at end of file
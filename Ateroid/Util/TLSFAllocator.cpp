@@ -0,0 +1,288 @@
+#include "Precompile.h"
+#include "TLSFAllocator.h"
+#include "Debug.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /** Index of the highest set bit, value must not be zero. */
+    static inline uint32_t FindLastSet(uint32_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanReverse(&index, value);
+        return index;
+#else
+        return 31 - __builtin_clz(value);
+#endif
+    }
+
+    /** Index of the lowest set bit, value must not be zero. */
+    static inline uint32_t FindFirstSet(uint32_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward(&index, value);
+        return index;
+#else
+        return __builtin_ctz(value);
+#endif
+    }
+
+    TLSFAllocator::TLSFAllocator(uint32_t capacity)
+        : m_Capacity(capacity), m_UsedBytes(0), m_AllocationsCount(0), m_FirstLevelBitmap(0)
+    {
+        std::memset(m_SecondLevelBitmaps, 0, sizeof(m_SecondLevelBitmaps));
+        for (uint32_t fl = 0; fl < kFirstLevelCount; ++fl)
+        {
+            for (uint32_t sl = 0; sl < kSecondLevelCount; ++sl)
+                m_FreeHeads[fl][sl] = kInvalidNode;
+        }
+
+        if (capacity > 0)
+        {
+            uint32_t node = NewNode();
+            m_Nodes[node].offset = 0;
+            m_Nodes[node].size = capacity;
+            InsertFree(node);
+        }
+    }
+
+    void TLSFAllocator::MappingInsert(uint32_t size, uint32_t* firstLevel, uint32_t* secondLevel)
+    {
+        if (size < kSmallBlockSize)
+        {
+            *firstLevel = 0;
+            *secondLevel = size;
+        }
+        else
+        {
+            uint32_t lastSet = FindLastSet(size);
+            *secondLevel = (size >> (lastSet - kSecondLevelLog2)) ^ kSecondLevelCount;
+            *firstLevel = lastSet - kSecondLevelLog2 + 1;
+        }
+    }
+
+    bool TLSFAllocator::MappingSearch(uint32_t size, uint32_t* firstLevel, uint32_t* secondLevel)
+    {
+        // Round up to the next list boundary, so any block in the found list is large enough.
+        uint64_t roundedSize = size;
+        if (size >= kSmallBlockSize)
+            roundedSize += (1ULL << (FindLastSet(size) - kSecondLevelLog2)) - 1;
+        if (roundedSize > 0xFFFFFFFFULL)
+            return false;
+
+        MappingInsert((uint32_t)roundedSize, firstLevel, secondLevel);
+        return true;
+    }
+
+    uint32_t TLSFAllocator::NewNode()
+    {
+        uint32_t node;
+        if (!m_UnusedNodes.empty())
+        {
+            node = m_UnusedNodes.back();
+            m_UnusedNodes.pop_back();
+        }
+        else
+        {
+            node = (uint32_t)m_Nodes.size();
+            m_Nodes.emplace_back();
+        }
+
+        Node& n = m_Nodes[node];
+        n.offset = 0;
+        n.size = 0;
+        n.prevPhysical = kInvalidNode;
+        n.nextPhysical = kInvalidNode;
+        n.prevFree = kInvalidNode;
+        n.nextFree = kInvalidNode;
+        n.isFree = false;
+        return node;
+    }
+
+    void TLSFAllocator::DeleteNode(uint32_t node)
+    {
+        m_UnusedNodes.push_back(node);
+    }
+
+    void TLSFAllocator::InsertFree(uint32_t node)
+    {
+        Node& n = m_Nodes[node];
+        uint32_t fl, sl;
+        MappingInsert(n.size, &fl, &sl);
+
+        n.isFree = true;
+        n.prevFree = kInvalidNode;
+        n.nextFree = m_FreeHeads[fl][sl];
+        if (n.nextFree != kInvalidNode)
+            m_Nodes[n.nextFree].prevFree = node;
+        m_FreeHeads[fl][sl] = node;
+
+        m_FirstLevelBitmap |= 1u << fl;
+        m_SecondLevelBitmaps[fl] |= 1u << sl;
+    }
+
+    void TLSFAllocator::RemoveFree(uint32_t node)
+    {
+        Node& n = m_Nodes[node];
+        uint32_t fl, sl;
+        MappingInsert(n.size, &fl, &sl);
+
+        if (n.prevFree != kInvalidNode)
+            m_Nodes[n.prevFree].nextFree = n.nextFree;
+        else
+            m_FreeHeads[fl][sl] = n.nextFree;
+        if (n.nextFree != kInvalidNode)
+            m_Nodes[n.nextFree].prevFree = n.prevFree;
+
+        if (m_FreeHeads[fl][sl] == kInvalidNode)
+        {
+            m_SecondLevelBitmaps[fl] &= ~(1u << sl);
+            if (m_SecondLevelBitmaps[fl] == 0)
+                m_FirstLevelBitmap &= ~(1u << fl);
+        }
+
+        n.isFree = false;
+        n.prevFree = kInvalidNode;
+        n.nextFree = kInvalidNode;
+    }
+
+    uint32_t TLSFAllocator::FindFree(uint32_t size)
+    {
+        uint32_t fl, sl;
+        if (!MappingSearch(size, &fl, &sl) || fl >= kFirstLevelCount)
+            return kInvalidNode;
+
+        uint32_t secondLevelMap = m_SecondLevelBitmaps[fl] & (~0u << sl);
+        if (secondLevelMap == 0)
+        {
+            uint32_t firstLevelMap = fl + 1 < kFirstLevelCount ? m_FirstLevelBitmap & (~0u << (fl + 1)) : 0;
+            if (firstLevelMap == 0)
+                return kInvalidNode;
+
+            fl = FindFirstSet(firstLevelMap);
+            secondLevelMap = m_SecondLevelBitmaps[fl];
+        }
+        sl = FindFirstSet(secondLevelMap);
+        return m_FreeHeads[fl][sl];
+    }
+
+    void TLSFAllocator::SplitTail(uint32_t node, uint32_t size)
+    {
+        uint32_t remainder = NewNode();
+        // NewNode may grow the vector, take references afterwards.
+        Node& n = m_Nodes[node];
+        Node& r = m_Nodes[remainder];
+        r.offset = n.offset + size;
+        r.size = n.size - size;
+        r.prevPhysical = node;
+        r.nextPhysical = n.nextPhysical;
+        if (n.nextPhysical != kInvalidNode)
+            m_Nodes[n.nextPhysical].prevPhysical = remainder;
+        n.nextPhysical = remainder;
+        n.size = size;
+        InsertFree(remainder);
+    }
+
+    TLSFAllocator::Allocation TLSFAllocator::Allocate(uint32_t size, uint32_t alignment)
+    {
+        Allocation allocation = { 0, 0, kInvalidNode };
+        if (size == 0)
+            return allocation;
+
+        alignment = std::max(alignment, 1u);
+        uint64_t searchSize = (uint64_t)size + alignment - 1;
+        if (searchSize > 0xFFFFFFFFULL)
+            return allocation;
+
+        uint32_t node = FindFree((uint32_t)searchSize);
+        if (node == kInvalidNode)
+            return allocation;
+
+        RemoveFree(node);
+
+        // Give the bytes skipped for alignment back as a free block in front of the allocation.
+        // The physical neighbours of a free block are never free, so no merging is needed here.
+        uint32_t offset = m_Nodes[node].offset;
+        uint32_t padding = (alignment - offset % alignment) % alignment;
+        if (padding > 0)
+        {
+            SplitTail(node, padding);
+            uint32_t padNode = node;
+            node = m_Nodes[padNode].nextPhysical;
+            RemoveFree(node);
+            InsertFree(padNode);
+        }
+
+        if (m_Nodes[node].size > size)
+            SplitTail(node, size);
+
+        m_UsedBytes += size;
+        ++m_AllocationsCount;
+
+        allocation.offset = m_Nodes[node].offset;
+        allocation.size = size;
+        allocation.node = node;
+        return allocation;
+    }
+
+    void TLSFAllocator::Free(const Allocation& allocation)
+    {
+        ASTEROID_ASSERT(allocation.IsValid() && !m_Nodes[allocation.node].isFree, "Freeing an invalid TLSF allocation.");
+
+        uint32_t node = allocation.node;
+        m_UsedBytes -= m_Nodes[node].size;
+        --m_AllocationsCount;
+
+        // Merge with the previous block.
+        uint32_t prev = m_Nodes[node].prevPhysical;
+        if (prev != kInvalidNode && m_Nodes[prev].isFree)
+        {
+            RemoveFree(prev);
+            m_Nodes[prev].size += m_Nodes[node].size;
+            m_Nodes[prev].nextPhysical = m_Nodes[node].nextPhysical;
+            if (m_Nodes[node].nextPhysical != kInvalidNode)
+                m_Nodes[m_Nodes[node].nextPhysical].prevPhysical = prev;
+            DeleteNode(node);
+            node = prev;
+        }
+
+        // Merge with the next block.
+        uint32_t next = m_Nodes[node].nextPhysical;
+        if (next != kInvalidNode && m_Nodes[next].isFree)
+        {
+            RemoveFree(next);
+            m_Nodes[node].size += m_Nodes[next].size;
+            m_Nodes[node].nextPhysical = m_Nodes[next].nextPhysical;
+            if (m_Nodes[next].nextPhysical != kInvalidNode)
+                m_Nodes[m_Nodes[next].nextPhysical].prevPhysical = node;
+            DeleteNode(next);
+        }
+
+        InsertFree(node);
+    }
+
+    TLSFAllocator::Stats TLSFAllocator::GetStats() const
+    {
+        Stats stats;
+        stats.capacity = m_Capacity;
+        stats.usedBytes = m_UsedBytes;
+        stats.freeBytes = m_Capacity - m_UsedBytes;
+        stats.allocationsCount = m_AllocationsCount;
+        stats.largestFreeBlock = 0;
+        stats.freeBlocksCount = 0;
+
+        for (uint32_t fl = 0; fl < kFirstLevelCount; ++fl)
+        {
+            for (uint32_t sl = 0; sl < kSecondLevelCount; ++sl)
+            {
+                for (uint32_t node = m_FreeHeads[fl][sl]; node != kInvalidNode; node = m_Nodes[node].nextFree)
+                {
+                    stats.largestFreeBlock = std::max(stats.largestFreeBlock, m_Nodes[node].size);
+                    ++stats.freeBlocksCount;
+                }
+            }
+        }
+        return stats;
+    }
+}
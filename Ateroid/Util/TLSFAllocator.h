@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Containers.h"
+
+namespace ASTEROID_NAMESPACE
+{
+    /**
+     *  Two-Level Segregated Fit allocator managing offsets in [0, capacity).\n
+     *  It never touches the memory it manages, which makes it suitable for suballocating GPU buffers.
+     *  Allocation and free run in constant time, free blocks are coalesced with their physical neighbours right away.
+     *  @remarks
+     *      Alignments don't have to be powers of two, which allows aligning vertex data to its stride.
+     */
+    class TLSFAllocator
+    {
+    public:
+        static const uint32_t kInvalidNode = 0xFFFFFFFF;
+
+        /** A suballocated range. Keep it to free the range later. */
+        struct Allocation
+        {
+            uint32_t offset;
+            uint32_t size;
+            uint32_t node;
+
+            bool IsValid() const { return node != kInvalidNode; }
+        };
+
+        /** Fragmentation statistics. */
+        struct Stats
+        {
+            uint32_t capacity;
+            uint32_t usedBytes;
+            uint32_t freeBytes;
+            uint32_t largestFreeBlock;
+            uint32_t allocationsCount;
+            uint32_t freeBlocksCount;
+
+            /** 0 when all free space is contiguous, approaching 1 as it gets scattered into small blocks. */
+            float Fragmentation() const
+            {
+                return freeBytes > 0 ? 1.0f - (float)largestFreeBlock / (float)freeBytes : 0.0f;
+            }
+        };
+
+    public:
+        explicit TLSFAllocator(uint32_t capacity);
+
+        ASTEROID_NON_COPYABLE(TLSFAllocator)
+
+        /**
+         *  Allocate a range.
+         *  @param alignment
+         *      The returned offset is a multiple of it. Zero and one mean no alignment.
+         *  @return
+         *      The allocated range, check Allocation::IsValid for failure.
+         */
+        Allocation Allocate(uint32_t size, uint32_t alignment = 1);
+
+        /**
+         *  Free a range returned by Allocate.
+         */
+        void Free(const Allocation& allocation);
+
+        uint32_t Capacity() const { return m_Capacity; }
+
+        Stats GetStats() const;
+
+    private:
+        static const uint32_t kSecondLevelLog2 = 4;
+        static const uint32_t kSecondLevelCount = 1 << kSecondLevelLog2;
+        /** Sizes below this are mapped linearly into first level 0. */
+        static const uint32_t kSmallBlockSize = kSecondLevelCount;
+        static const uint32_t kFirstLevelCount = 32;
+
+        struct Node
+        {
+            uint32_t offset;
+            uint32_t size;
+            uint32_t prevPhysical;
+            uint32_t nextPhysical;
+            uint32_t prevFree;
+            uint32_t nextFree;
+            bool     isFree;
+        };
+
+        static void MappingInsert(uint32_t size, uint32_t* firstLevel, uint32_t* secondLevel);
+        static bool MappingSearch(uint32_t size, uint32_t* firstLevel, uint32_t* secondLevel);
+
+        uint32_t NewNode();
+        void DeleteNode(uint32_t node);
+        void InsertFree(uint32_t node);
+        void RemoveFree(uint32_t node);
+        uint32_t FindFree(uint32_t size);
+        /** Split the first size bytes off a node, the remainder becomes a new free node after it. */
+        void SplitTail(uint32_t node, uint32_t size);
+
+    private:
+        uint32_t        m_Capacity;
+        uint32_t        m_UsedBytes;
+        uint32_t        m_AllocationsCount;
+        uint32_t        m_FirstLevelBitmap;
+        uint32_t        m_SecondLevelBitmaps[kFirstLevelCount];
+        uint32_t        m_FreeHeads[kFirstLevelCount][kSecondLevelCount];
+        Vector<Node>    m_Nodes;
+        Vector<uint32_t> m_UnusedNodes;
+    };
+}
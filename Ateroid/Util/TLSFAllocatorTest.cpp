@@ -0,0 +1,210 @@
+#include "Precompile.h"
+#include "TLSFAllocatorTest.h"
+#include "TLSFAllocator.h"
+#include "Debug.h"
+#include <random>
+
+namespace ASTEROID_NAMESPACE
+{
+    /** Vertex strides and index sizes, most of them not powers of two. */
+    static const uint32_t kAlignments[] = { 1, 2, 4, 12, 16, 20, 24, 32, 36, 48, 256 };
+    static const uint32_t kAlignmentsCount = sizeof(kAlignments) / sizeof(kAlignments[0]);
+    /** The stress part validates every range after this many operations. */
+    static const uint32_t kValidationInterval = 64;
+
+    struct LiveAllocation
+    {
+        TLSFAllocator::Allocation   allocation;
+        uint32_t                    alignment;
+    };
+
+    static bool CheckStats(const TLSFAllocator& allocator, uint32_t usedBytes, uint32_t allocationsCount, uint32_t freeBlocksCount,
+        const char* step)
+    {
+        TLSFAllocator::Stats stats = allocator.GetStats();
+        if (stats.usedBytes != usedBytes || stats.freeBytes != allocator.Capacity() - usedBytes ||
+            stats.allocationsCount != allocationsCount || stats.freeBlocksCount != freeBlocksCount)
+        {
+            ASTEROID_LOG_ERROR_F("TLSF %s: %u used bytes, %u allocations and %u free blocks instead of %u, %u and %u.", step,
+                stats.usedBytes, stats.allocationsCount, stats.freeBlocksCount, usedBytes, allocationsCount, freeBlocksCount);
+            return false;
+        }
+        return true;
+    }
+
+    static bool TestCoalescing()
+    {
+        const uint32_t kBlockSize = 256;
+        TLSFAllocator allocator(4 * kBlockSize);
+        TLSFAllocator::Allocation blocks[4];
+        for (uint32_t iBlock = 0; iBlock < 4; ++iBlock)
+        {
+            blocks[iBlock] = allocator.Allocate(kBlockSize);
+            if (!blocks[iBlock].IsValid() || blocks[iBlock].offset != iBlock * kBlockSize)
+            {
+                ASTEROID_LOG_ERROR_F("TLSF coalescing: block %u was not allocated at offset %u.", iBlock, iBlock * kBlockSize);
+                return false;
+            }
+        }
+
+        bool isValid = CheckStats(allocator, 4 * kBlockSize, 4, 0, "full");
+        if (allocator.Allocate(1).IsValid())
+        {
+            ASTEROID_LOG_ERROR("TLSF coalescing: allocated a byte from a full allocator.");
+            isValid = false;
+        }
+
+        // Two blocks apart stay apart, the block between them joins both
+        allocator.Free(blocks[0]);
+        allocator.Free(blocks[2]);
+        isValid &= CheckStats(allocator, 2 * kBlockSize, 2, 2, "two separate blocks freed");
+        allocator.Free(blocks[1]);
+        isValid &= CheckStats(allocator, kBlockSize, 1, 1, "middle block freed");
+        if (allocator.GetStats().largestFreeBlock != 3 * kBlockSize)
+        {
+            ASTEROID_LOG_ERROR_F("TLSF coalescing: the largest free block is %u bytes instead of %u.",
+                allocator.GetStats().largestFreeBlock, 3 * kBlockSize);
+            isValid = false;
+        }
+
+        TLSFAllocator::Allocation merged = allocator.Allocate(3 * kBlockSize);
+        if (!merged.IsValid() || merged.offset != 0)
+        {
+            ASTEROID_LOG_ERROR("TLSF coalescing: the merged blocks couldn't be allocated at once.");
+            return false;
+        }
+        allocator.Free(merged);
+        allocator.Free(blocks[3]);
+        isValid &= CheckStats(allocator, 0, 0, 1, "all blocks freed");
+        return isValid;
+    }
+
+    static bool TestAlignment()
+    {
+        bool isValid = true;
+        TLSFAllocator allocator(64 * 1024);
+        Vector<TLSFAllocator::Allocation> allocations;
+        // An odd sized allocation first, so the next offsets are misaligned unless padded
+        allocations.push_back(allocator.Allocate(7));
+        for (uint32_t alignment : kAlignments)
+        {
+            TLSFAllocator::Allocation allocation = allocator.Allocate(alignment * 3 + 1, alignment);
+            if (!allocation.IsValid() || allocation.offset % alignment != 0)
+            {
+                ASTEROID_LOG_ERROR_F("TLSF alignment: offset %u is not aligned to %u.", allocation.offset, alignment);
+                isValid = false;
+            }
+            allocations.push_back(allocation);
+        }
+
+        // The padding skipped for alignment is given back, freeing every allocation leaves one free block
+        for (const TLSFAllocator::Allocation& allocation : allocations)
+        {
+            if (allocation.IsValid())
+                allocator.Free(allocation);
+        }
+        isValid &= CheckStats(allocator, 0, 0, 1, "aligned allocations freed");
+        return isValid;
+    }
+
+    static bool ValidateRanges(const TLSFAllocator& allocator, Vector<LiveAllocation> live, uint32_t operation)
+    {
+        std::sort(live.begin(), live.end(), [](const LiveAllocation& a, const LiveAllocation& b)
+        {
+            return a.allocation.offset < b.allocation.offset;
+        });
+
+        uint64_t usedBytes = 0;
+        uint64_t end = 0;
+        for (const LiveAllocation& range : live)
+        {
+            const TLSFAllocator::Allocation& allocation = range.allocation;
+            if (allocation.offset < end || (uint64_t)allocation.offset + allocation.size > allocator.Capacity() ||
+                allocation.offset % range.alignment != 0)
+            {
+                ASTEROID_LOG_ERROR_F("TLSF operation %u: range [%u, %u) aligned to %u overlaps, overflows or is misaligned.",
+                    operation, allocation.offset, allocation.offset + allocation.size, range.alignment);
+                return false;
+            }
+            end = (uint64_t)allocation.offset + allocation.size;
+            usedBytes += allocation.size;
+        }
+
+        TLSFAllocator::Stats stats = allocator.GetStats();
+        if (stats.usedBytes != usedBytes || stats.allocationsCount != live.size() || stats.largestFreeBlock > stats.freeBytes)
+        {
+            ASTEROID_LOG_ERROR_F("TLSF operation %u: stats report %u used bytes in %u allocations instead of %llu in %zu.",
+                operation, stats.usedBytes, stats.allocationsCount, (unsigned long long)usedBytes, live.size());
+            return false;
+        }
+        return true;
+    }
+
+    static bool TestRandomOperations(const TLSFAllocatorTestSettings& settings)
+    {
+        TLSFAllocator allocator(settings.capacity);
+        Vector<LiveAllocation> live;
+        std::mt19937 random(settings.seed);
+        uint32_t maxSize = std::max(settings.capacity / 64, 1u);
+        uint32_t failedCount = 0;
+        float maxFragmentation = 0.0f;
+
+        for (uint32_t iOperation = 0; iOperation < settings.operationsCount; ++iOperation)
+        {
+            // Lean towards allocating until the allocator is half full, then keep it around there
+            bool isAllocating = live.empty() || random() % 100 < (allocator.GetStats().usedBytes < settings.capacity / 2 ? 65u : 45u);
+            if (isAllocating)
+            {
+                LiveAllocation range;
+                range.alignment = kAlignments[random() % kAlignmentsCount];
+                range.allocation = allocator.Allocate(1 + random() % maxSize, range.alignment);
+                if (range.allocation.IsValid())
+                    live.push_back(range);
+                else
+                    ++failedCount;
+            }
+            else
+            {
+                uint32_t index = random() % (uint32_t)live.size();
+                allocator.Free(live[index].allocation);
+                live[index] = live.back();
+                live.pop_back();
+            }
+
+            maxFragmentation = std::max(maxFragmentation, allocator.GetStats().Fragmentation());
+            if ((iOperation + 1) % kValidationInterval == 0 && !ValidateRanges(allocator, live, iOperation))
+                return false;
+        }
+        if (!ValidateRanges(allocator, live, settings.operationsCount))
+            return false;
+
+        ASTEROID_LOG_INFO_F("    %u operations, %zu ranges alive, %u failed allocations, fragmentation up to %.3f", settings.operationsCount,
+            live.size(), failedCount, maxFragmentation);
+
+        while (!live.empty())
+        {
+            uint32_t index = random() % (uint32_t)live.size();
+            allocator.Free(live[index].allocation);
+            live[index] = live.back();
+            live.pop_back();
+        }
+        if (!CheckStats(allocator, 0, 0, 1, "random ranges freed"))
+            return false;
+        if (!allocator.Allocate(settings.capacity).IsValid())
+        {
+            ASTEROID_LOG_ERROR("TLSF: the whole capacity couldn't be allocated after freeing everything.");
+            return false;
+        }
+        return true;
+    }
+
+    bool TLSFAllocatorTest::Run(const TLSFAllocatorTestSettings& settings)
+    {
+        ASTEROID_LOG_INFO_F("TLSF allocator test: %u operations in %u bytes.", settings.operationsCount, settings.capacity);
+
+        bool isValid = TestCoalescing();
+        isValid &= TestAlignment();
+        isValid &= TestRandomOperations(settings);
+        return isValid;
+    }
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+namespace ASTEROID_NAMESPACE
+{
+    struct TLSFAllocatorTestSettings
+    {
+        /** Random allocations and frees of the stress part. */
+        uint32_t    operationsCount;
+        uint32_t    capacity;
+        uint32_t    seed;
+    };
+
+
+    /**
+     *  Checks the TLSFAllocator: coalescing of freed neighbours, alignments that are not powers of two, and a
+     *  random mix of allocations and frees whose ranges must stay aligned, disjoint and inside the capacity, with
+     *  statistics matching them. Freeing everything must leave a single free block of the whole capacity.
+     */
+    class TLSFAllocatorTest
+    {
+    public:
+        ASTEROID_NO_DEFAULT_CTOR(TLSFAllocatorTest)
+        ASTEROID_NON_COPYABLE(TLSFAllocatorTest)
+
+        /**
+         *  @return
+         *      False if any check failed.
+         */
+        static bool Run(const TLSFAllocatorTestSettings& settings);
+    };
+}
@@ -1,15 +1,29 @@
 #include "Precompile.h"
 #include "WindowsApplication.h"
+#include "Core/FrameScheduler.h"
+#include "Core/JobSystem.h"
+#include "Core/TransformSystem.h"
+#include "Physics/PhysicsWorld.h"
+#include "Rendering/MeshBufferPool.h"
+#include "Rendering/RenderSystem.h"
+#include "Rendering/RenderThread.h"
 #include "Util/STLAllocator.h"
 #include "Util/ConsoleVariable.h"
 #include "Util/Debug.h"
 #include "Util/PlayerPrefs.h"
+#include "Util/SimdDispatch.h"
 #include "Util/SystemInfo.h"
 
 namespace ASTEROID_NAMESPACE
 {
     static const TCHAR kMainWindowClassName[] = L"MainWindow";
 
+    static const double kFixedTimestep = 1.0 / 60.0;
+    static const uint32_t kMaxStepsPerFrame = 5;
+    static const double kMaxFrameRate = 144.0;
+    /** Frames the render thread may lag behind the main thread. */
+    static const uint32_t kMaxFrameLatency = 2;
+
     LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
 
     static ATOM RegisterMainWindowClass(HINSTANCE hInstance)
@@ -56,7 +70,7 @@ namespace ASTEROID_NAMESPACE
     WindowsApplication* WindowsApplication::_Singleton = nullptr;
 
     WindowsApplication::WindowsApplication(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPWSTR cmdLine, int cmdShow)
-        : m_hInstance(hInstance), m_CmdShow(cmdShow)
+        : m_hInstance(hInstance), m_CmdShow(cmdShow), m_hWnd(NULL), m_FrameScheduler(nullptr)
     {
 #ifdef _DEBUG
         _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
@@ -106,6 +120,9 @@ namespace ASTEROID_NAMESPACE
             return false;
         }
 
+        // The thread waiting on jobs helps executing them, so leave one processor for it.
+        JobSystem::Create(std::max(SystemInfo::ProcessorsCount(), 1u) - 1);
+
         PlayerPrefs::Create();
         if (!PlayerPrefs::Singleton()->Load())
         {
@@ -115,18 +132,82 @@ namespace ASTEROID_NAMESPACE
 
         ConsoleVariableManager::Create(PlayerPrefs::Singleton());
 
+        // Reads its console variable, so it comes after ConsoleVariableManager
+        SimdDispatch::Initialize();
+
+        TransformSystem::Create();
+
+        // Asteroids drift in space, nothing pulls them anywhere
+        PhysicsSettings physicsSettings;
+        physicsSettings.gravity = Float3(0.0f, 0.0f, 0.0f);
+        physicsSettings.velocityIterations = 4;
+        physicsSettings.contactMargin = 0.05f;
+        physicsSettings.restitution = 0.3f;
+        physicsSettings.friction = 0.5f;
+        physicsSettings.linearDamping = 0.0f;
+        physicsSettings.angularDamping = 0.05f;
+        physicsSettings.sleepLinearSpeed = 0.05f;
+        physicsSettings.sleepAngularSpeed = 0.05f;
+        physicsSettings.timeToSleep = 0.5f;
+        physicsSettings.isDeterministic = false;
+        PhysicsWorld::Create(physicsSettings);
+
+        FrameSchedulerSettings schedulerSettings;
+        schedulerSettings.fixedTimestep = kFixedTimestep;
+        schedulerSettings.maxStepsPerFrame = kMaxStepsPerFrame;
+        schedulerSettings.maxFrameRate = kMaxFrameRate;
+        schedulerSettings.clock = EFrameClock::eRealTime;
+        m_FrameScheduler = ASTEROID_NEW FrameScheduler(schedulerSettings);
+
         RegisterMainWindowClass(m_hInstance);
         m_hWnd = CreateMainWindow(m_hInstance, m_CmdShow);
         if (m_hWnd == NULL)
             return false;
 
+        RECT clientRect;
+        GetClientRect(m_hWnd, &clientRect);
+        DXGI_SWAP_CHAIN_DESC swapChainDesc;
+        std::memset(&swapChainDesc, 0, sizeof(swapChainDesc));
+        swapChainDesc.BufferDesc.Width = clientRect.right - clientRect.left;
+        swapChainDesc.BufferDesc.Height = clientRect.bottom - clientRect.top;
+        swapChainDesc.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+        swapChainDesc.SampleDesc.Count = 1;
+        swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+        swapChainDesc.BufferCount = 2;
+        swapChainDesc.OutputWindow = m_hWnd;
+        swapChainDesc.Windowed = TRUE;
+        swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_DISCARD;
+        if (RenderSystem::Create(swapChainDesc) == nullptr)
+        {
+            ASTEROID_LOG_ERROR("Application init failed: RenderSystem creation failed.");
+            return false;
+        }
+
+        // From here on the render thread owns the device context, see RenderThread
+        RenderThread::Create(RenderSystem::Singleton(), kMaxFrameLatency);
+
         return true;
     }
 
     void WindowsApplication::Finalize()
     {
+        // Submitted frames still reference engine resources, finish them first.
+        if (RenderThread::Singleton())
+            RenderThread::Destroy();
+
+        delete RenderSystem::Singleton();
+
         DestroyWindow(m_hWnd);
 
+        ASTEROID_DELETE m_FrameScheduler;
+        m_FrameScheduler = nullptr;
+
+        if (PhysicsWorld::Singleton())
+            PhysicsWorld::Destroy();
+
+        if (TransformSystem::Singleton())
+            TransformSystem::Destroy();
+
         if (ConsoleVariableManager::Singleton())
         {
             // Unregister all variables, all persistent variables will be saved.
@@ -140,30 +221,65 @@ namespace ASTEROID_NAMESPACE
             PlayerPrefs::Destroy();
         }
 
+        if (JobSystem::Singleton())
+            JobSystem::Destroy();
+
         Debug::Finalize();
     }
 
     int WindowsApplication::MainMessageLoop()
     {
         MSG msg;
-        PeekMessage(&msg, NULL, 0U, 0U, PM_REMOVE);
+        msg.message = WM_NULL;
 
-        while (msg.message != WM_QUIT)
+        for (;;)
         {
-            if (PeekMessage(&msg, NULL, 0U, 0U, PM_REMOVE))
+            // Drain every pending message, handling one per frame would let input lag behind at capped frame rates
+            while (PeekMessage(&msg, NULL, 0U, 0U, PM_REMOVE))
             {
+                if (msg.message == WM_QUIT)
+                    return (int)msg.wParam;
+
                 TranslateMessage(&msg);
                 DispatchMessage(&msg);
             }
 
             PerformMainLoop();
         }
-        return msg.wParam;
     }
 
     void WindowsApplication::PerformMainLoop()
     {
+        uint32_t stepsCount = m_FrameScheduler->BeginFrame();
+        for (uint32_t iStep = 0; iStep < stepsCount; ++iStep)
+            FixedUpdate(m_FrameScheduler->FixedTimestep());
+
+        // Frame submission runs on the render thread, this frame's simulation overlaps the submission of the
+        // previous ones. Draws recorded into the packet capture their data by value and read meshes resolved with
+        // RenderSystem::ResolveMeshes.
+        RenderThread* renderThread = RenderThread::Singleton();
+        if (renderThread != nullptr)
+        {
+            FramePacket* packet = renderThread->BeginFrame();
+            // Meshes created since the last frame are uploaded before anything draws them
+            if (MeshBufferPool::Singleton())
+                MeshBufferPool::Singleton()->RecordUploads(packet);
+            renderThread->EndFrame();
+        }
+
+        // Sleep off the rest of the frame instead of spinning on the message queue
+        m_FrameScheduler->EndFrame();
     }
 
-}
+    void WindowsApplication::FixedUpdate(double timestep)
+    {
+        // Simulation running at the fixed timestep goes here, rendering interpolates between its states with
+        // FrameScheduler::InterpolationAlpha.
+
+        PhysicsWorld::Singleton()->Step((float)timestep);
+
+        // World matrices of everything the step moved
+        TransformSystem::Singleton()->Update();
+    }
 
+}
\ No newline at end of file
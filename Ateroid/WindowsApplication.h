@@ -3,6 +3,7 @@
 namespace ASTEROID_NAMESPACE
 {
     class ConsoleVariableManager;
+    class FrameScheduler;
     class PlayerPrefs;
     
 
@@ -32,10 +33,12 @@ namespace ASTEROID_NAMESPACE
         void Finalize();
         int MainMessageLoop();
         void PerformMainLoop();
+        void FixedUpdate(double timestep);
 
     private:
         HINSTANCE   m_hInstance;
         int         m_CmdShow;
         HWND        m_hWnd;
+        FrameScheduler* m_FrameScheduler;
     };
 }
\ No newline at end of file